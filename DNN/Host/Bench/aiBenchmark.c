@@ -0,0 +1,661 @@
+/**
+  ******************************************************************************
+  * @file    aiBenchmark.c
+  * @brief   Host benchmark of the embedded network(s)
+  ******************************************************************************
+  * @attention
+  *
+  * Linux counterpart of aiTestPerformance(): the network is driven through the
+  * same ai_mnetwork_* API, the latency of each ai_mnetwork_run() call is
+  * recorded (after a warm-up phase) and reported as a distribution, on stdout
+  * and optionally as a JSON document.
+  *
+  * usage: aiBenchmark [-n iterations] [-w warmup] [-b batch] [-c cpu] [-z|-a]
+  *                    [-m model.tflite] [-o report.json|-] [-p trace.json]
+  *
+  * With -z, the I/O buffers are bound once (ai_mnetwork_bind_io) and the
+  * calls are ai_mnetwork_run_bound(): the per-call descriptor handling is
+  * removed from the measurement.
+  *
+  * With -a, the calls are ai_network_aot_run() of the ahead-of-time compiled
+  * model (aiCompile, Makefile AOT=1) instead of the runtime: its outputs are
+  * first checked against the ones of the runtime on the same inputs.
+  *
+  * With -m, the benchmarked network is a .tflite model loaded at run time
+  * (ai_mnetwork_load, Makefile TFLITE=1) instead of the generated one.
+  *
+  * With -p, a separate profiling pass (aiProfiler) follows the measurement:
+  * its per c-node table is printed and its events exported as a Chrome trace.
+  *
+  ******************************************************************************
+  */
+
+#define _GNU_SOURCE
+
+/* System headers */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <inttypes.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <sched.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_HAS_TSC
+#endif
+
+/* AI header files */
+#include "app_x-cube-ai.h"
+#include "ai_platform_interface.h"
+#include "aiProfiler.h"
+#if defined(AI_MNETWORK_WITH_NETWORK_AOT)
+#include "network_aot.h"
+#endif
+
+#define _BENCH_NAME_            "AI benchmark (host)"
+
+#define _BENCH_ITER_            10000   /* default number of measured calls */
+#define _BENCH_WARMUP_          1000    /* default number of warm-up calls */
+#define _BENCH_PROF_ITER_       1000    /* max number of profiled calls */
+
+struct bench_config {
+    int n_iter;
+    int n_warmup;
+    int batch;
+    int cpu;                /* -1: no pinning */
+    bool bound;             /* I/O bound once, see ai_mnetwork_bind_io */
+    bool aot;               /* ahead-of-time compiled model, see aiCompile */
+    const char *model;      /* NULL: generated network, else .tflite file */
+    const char *json;       /* NULL: no JSON report, "-": stdout */
+    const char *trace;      /* NULL: no profiling pass */
+};
+
+/* latency distribution of the measured calls (per call) */
+struct bench_stats {
+    int n;
+    double min;
+    double max;
+    double mean;
+    double stddev;
+    double median;
+    double p90;
+    double p99;
+    double p999;
+};
+
+struct bench_result {
+    const ai_network_report *report;
+    const struct bench_config *cfg;
+    int cpu;
+    double total_s;
+    double throughput;      /* inferences (samples) per second */
+    struct bench_stats ns;
+    bool has_cycles;
+    struct bench_stats cycles;
+    double cycles_per_macc; /* median call cycles / (batch * MACC) */
+};
+
+/* human readable report: stderr when the JSON report goes to stdout */
+static FILE *bench_log;
+
+#define benchLog(...)  fprintf(bench_log, __VA_ARGS__)
+
+/* -----------------------------------------------------------------------------
+ * Host-related functions
+ * -----------------------------------------------------------------------------
+ */
+
+static inline uint64_t benchGetNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static inline uint64_t benchGetCycles(void)
+{
+#if defined(BENCH_HAS_TSC)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static int benchPinCpu(int cpu)
+{
+    cpu_set_t set;
+
+    if (cpu < 0)
+        return sched_getcpu();
+
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set)) {
+        perror("W: sched_setaffinity");
+        return -1;
+    }
+    return cpu;
+}
+
+/* -----------------------------------------------------------------------------
+ * Statistics
+ * -----------------------------------------------------------------------------
+ */
+
+static int benchCmpU64(const void *a, const void *b)
+{
+    const uint64_t va = *(const uint64_t *)a;
+    const uint64_t vb = *(const uint64_t *)b;
+    return (va > vb) - (va < vb);
+}
+
+/* nearest-rank percentile of a sorted set */
+static double benchPercentile(const uint64_t *sorted, int n, double p)
+{
+    int rank = (int)ceil(p * (double)n);
+    if (rank < 1)
+        rank = 1;
+    if (rank > n)
+        rank = n;
+    return (double)sorted[rank - 1];
+}
+
+/* samples are sorted in place */
+static void benchStats(uint64_t *samples, int n, struct bench_stats *s)
+{
+    double mean = 0.0;
+    double m2 = 0.0;
+
+    memset(s, 0, sizeof(*s));
+    if (n <= 0)
+        return;
+
+    /* Welford: numerically stable mean/variance */
+    for (int i = 0; i < n; i++) {
+        const double delta = (double)samples[i] - mean;
+        mean += delta / (double)(i + 1);
+        m2 += delta * ((double)samples[i] - mean);
+    }
+
+    qsort(samples, (size_t)n, sizeof(uint64_t), benchCmpU64);
+
+    s->n = n;
+    s->min = (double)samples[0];
+    s->max = (double)samples[n - 1];
+    s->mean = mean;
+    s->stddev = (n > 1) ? sqrt(m2 / (double)(n - 1)) : 0.0;
+    s->median = benchPercentile(samples, n, 0.50);
+    s->p90 = benchPercentile(samples, n, 0.90);
+    s->p99 = benchPercentile(samples, n, 0.99);
+    s->p999 = benchPercentile(samples, n, 0.999);
+}
+
+/* -----------------------------------------------------------------------------
+ * Reports
+ * -----------------------------------------------------------------------------
+ */
+
+static void benchPrintStats(const char *name, const char *unit,
+        const struct bench_stats *s, double scale)
+{
+    char label[32];
+
+    snprintf(label, sizeof(label), "%s (%s)", name, unit);
+    benchLog(" %-14s: median %.3f  p90 %.3f  p99 %.3f  p99.9 %.3f\n",
+            label, s->median * scale, s->p90 * scale, s->p99 * scale,
+            s->p999 * scale);
+    benchLog(" %-14s: mean %.3f  stddev %.3f  min %.3f  max %.3f\n",
+            "", s->mean * scale, s->stddev * scale, s->min * scale,
+            s->max * scale);
+}
+
+static void benchPrintResult(const struct bench_result *r)
+{
+    benchLog("\nResults for \"%s\", %d calls of %d samples (complexity: %u MACC)\n",
+            r->report->model_name, r->ns.n, r->cfg->batch,
+            (unsigned)r->report->n_macc);
+    benchLog(" warm-up       : %d calls\n", r->cfg->n_warmup);
+    benchLog(" cpu           : %d%s\n", r->cpu, (r->cfg->cpu < 0) ? " (not pinned)" : "");
+    benchPrintStats("latency", "us", &r->ns, 1e-3);
+    if (r->has_cycles) {
+        benchPrintStats("TSC", "kcycles", &r->cycles, 1e-3);
+        benchLog(" cycles/MACC   : %.3f (median)\n", r->cycles_per_macc);
+    }
+    benchLog(" throughput    : %.1f inferences/s\n", r->throughput);
+}
+
+static void benchJsonStats(FILE *f, const char *name,
+        const struct bench_stats *s, const char *sep)
+{
+    fprintf(f, "  \"%s\": {\"min\": %.1f, \"max\": %.1f, \"mean\": %.3f, "
+            "\"stddev\": %.3f, \"median\": %.1f, \"p90\": %.1f, "
+            "\"p99\": %.1f, \"p99.9\": %.1f}%s\n",
+            name, s->min, s->max, s->mean, s->stddev, s->median, s->p90,
+            s->p99, s->p999, sep);
+}
+
+static int benchWriteJson(const struct bench_result *r, const char *path)
+{
+    const bool to_stdout = (strcmp(path, "-") == 0);
+    FILE *f = to_stdout ? stdout : fopen(path, "w");
+
+    if (!f) {
+        perror("E: unable to open the JSON report");
+        return -1;
+    }
+
+    fprintf(f, "{\n");
+    fprintf(f, "  \"model\": \"%s\",\n", r->report->model_name);
+    fprintf(f, "  \"signature\": \"%s\",\n", r->report->model_signature);
+    fprintf(f, "  \"macc\": %u,\n", (unsigned)r->report->n_macc);
+    fprintf(f, "  \"iterations\": %d,\n", r->ns.n);
+    fprintf(f, "  \"warmup\": %d,\n", r->cfg->n_warmup);
+    fprintf(f, "  \"batch\": %d,\n", r->cfg->batch);
+    fprintf(f, "  \"cpu\": %d,\n", r->cpu);
+    fprintf(f, "  \"pinned\": %s,\n", (r->cfg->cpu < 0) ? "false" : "true");
+    fprintf(f, "  \"io_bound\": %s,\n", (r->cfg->bound) ? "true" : "false");
+    fprintf(f, "  \"aot\": %s,\n", (r->cfg->aot) ? "true" : "false");
+    fprintf(f, "  \"total_s\": %.6f,\n", r->total_s);
+    fprintf(f, "  \"throughput_ips\": %.3f,\n", r->throughput);
+    if (r->has_cycles) {
+        fprintf(f, "  \"cycles_per_macc\": %.4f,\n", r->cycles_per_macc);
+        benchJsonStats(f, "cycles", &r->cycles, ",");
+    }
+    benchJsonStats(f, "latency_ns", &r->ns, "");
+    fprintf(f, "}\n");
+
+    if (!to_stdout)
+        fclose(f);
+    return 0;
+}
+
+/* -----------------------------------------------------------------------------
+ * Benchmark
+ * -----------------------------------------------------------------------------
+ */
+
+static void benchFillInputs(ai_buffer *inputs, int n_inputs)
+{
+    for (int i = 0; i < n_inputs; i++) {
+        const ai_buffer_format fmt = AI_BUFFER_FORMAT(&inputs[i]);
+        const ai_size n = AI_BUFFER_SIZE(&inputs[i]) * inputs[i].n_batches;
+        ai_i8 *in_data = (ai_i8 *)inputs[i].data;
+        for (ai_size j = 0; j < n; ++j) {
+            /* uniform distribution between -1.0 and 1.0 */
+            const float v = 2.0f * (ai_float) rand() / (ai_float) RAND_MAX - 1.0f;
+            if (AI_BUFFER_FMT_GET_TYPE(fmt) == AI_BUFFER_FMT_TYPE_FLOAT)
+                ((ai_float *)in_data)[j] = v;
+            else
+                in_data[j] = (ai_i8)(v * 127);
+        }
+    }
+}
+
+/* one inference call, on the bound buffers with -z, compiled model with -a */
+static inline ai_i32 benchCall(ai_handle handle, const struct bench_config *cfg,
+        const ai_buffer *ai_input, ai_buffer *ai_output)
+{
+#if defined(AI_MNETWORK_WITH_NETWORK_AOT)
+    if (cfg->aot)
+        return ai_network_aot_run(AI_HANDLE_NULL, ai_input, ai_output);
+#endif
+    if (cfg->bound)
+        return ai_mnetwork_run_bound(handle);
+    return ai_mnetwork_run(handle, ai_input, ai_output);
+}
+
+static void *benchAlloc(const ai_buffer *buffer, int batch)
+{
+    const ai_size bytes = AI_BUFFER_BYTE_SIZE(AI_BUFFER_SIZE(buffer),
+            buffer->format) * (ai_size)batch;
+    /* aligned_alloc() requires a multiple of the alignment */
+    return aligned_alloc(64, (bytes + 63) & ~(ai_size)63);
+}
+
+#if defined(AI_MNETWORK_WITH_NETWORK_AOT)
+/* outputs of the compiled model vs the ones of the runtime, same inputs */
+static int benchCheckAot(ai_handle handle, const ai_network_report *report,
+        const struct bench_config *cfg, const ai_buffer *ai_input,
+        ai_buffer *ai_output)
+{
+    const ai_size n = AI_BUFFER_SIZE(&ai_output[0]) * (ai_size)cfg->batch;
+    ai_float *ref;
+    float max_diff = 0.0f;
+
+    if (strcmp(report->model_signature, AI_NETWORK_AOT_SOURCE_SIGNATURE)) {
+        benchLog("E: \"%s\" is not compiled from this model (make aot)\n",
+                AI_NETWORK_AOT_MODEL_NAME);
+        return -1;
+    }
+
+    ref = malloc(n * sizeof(ai_float));
+    if (!ref)
+        return -1;
+    if (ai_mnetwork_run(handle, ai_input, ai_output) != cfg->batch) {
+        free(ref);
+        return -1;
+    }
+    memcpy(ref, ai_output[0].data, n * sizeof(ai_float));
+    if (ai_network_aot_run(AI_HANDLE_NULL, ai_input, ai_output) != cfg->batch) {
+        benchLog("E: ai_network_aot_run() failed\n");
+        free(ref);
+        return -1;
+    }
+    for (ai_size i = 0; i < n; i++)
+        max_diff = fmaxf(max_diff, fabsf(ref[i] - ((ai_float *)ai_output[0].data)[i]));
+    free(ref);
+
+    benchLog(" AOT check     : max |runtime - %s| = %g\n",
+            AI_NETWORK_AOT_MODEL_NAME, max_diff);
+    return 0;
+}
+#endif
+
+/* not timed: the observer callback adds its own cost to each c-node */
+static int benchProfile(ai_handle handle, const ai_network_report *report,
+        const struct bench_config *cfg, ai_buffer *ai_input, ai_buffer *ai_output)
+{
+    struct profiler_ctx prof;
+    ai_network_params net_params;
+    ai_handle net_hdl;
+    const int n_iter = (cfg->n_iter < _BENCH_PROF_ITER_) ? cfg->n_iter : _BENCH_PROF_ITER_;
+    int res = 0;
+
+    /* retrieve real handle */
+    if (ai_mnetwork_get_private_handle(handle, &net_hdl, &net_params))
+        return -1;
+    if (aiProfilerInit(&prof, net_hdl, (int)report->n_nodes,
+            n_iter * (int)report->n_nodes))
+        return -1;
+
+    for (int iter = 0; iter < n_iter; iter++) {
+        if (benchCall(handle, cfg, ai_input, ai_output) != cfg->batch) {
+            res = -1;
+            break;
+        }
+    }
+
+    if (!res) {
+        benchLog("\nProfiling pass: %d calls\n", n_iter);
+        aiProfilerPrint(&prof, bench_log);
+        res = aiProfilerWriteTrace(&prof, cfg->trace);
+        if (!res)
+            benchLog(" trace         : %s\n", cfg->trace);
+    }
+    aiProfilerDeInit(&prof);
+    return res;
+}
+
+static int benchRun(ai_handle handle, const ai_network_report *report,
+        const struct bench_config *cfg)
+{
+    ai_buffer ai_input[AI_MNETWORK_IN_NUM];
+    ai_buffer ai_output[AI_MNETWORK_OUT_NUM];
+    struct bench_result r;
+    uint64_t *t_ns;
+    uint64_t *t_cycles;
+    uint64_t t_total;
+    int res = -1;
+
+    if ((report->n_inputs > AI_MNETWORK_IN_NUM) ||
+            (report->n_outputs > AI_MNETWORK_OUT_NUM)) {
+        benchLog("E: AI_MNETWORK_IN/OUT_NUM definition are incoherent\n");
+        return -1;
+    }
+
+    memset(ai_input, 0, sizeof(ai_input));
+    memset(ai_output, 0, sizeof(ai_output));
+    for (int i = 0; i < report->n_inputs; i++) {
+        ai_input[i] = report->inputs[i];
+        ai_input[i].n_batches = cfg->batch;
+        ai_input[i].data = AI_HANDLE_PTR(benchAlloc(&report->inputs[i], cfg->batch));
+    }
+    for (int i = 0; i < report->n_outputs; i++) {
+        ai_output[i] = report->outputs[i];
+        ai_output[i].n_batches = cfg->batch;
+        ai_output[i].data = AI_HANDLE_PTR(benchAlloc(&report->outputs[i], cfg->batch));
+    }
+
+    t_ns = malloc((size_t)cfg->n_iter * sizeof(uint64_t));
+    t_cycles = malloc((size_t)cfg->n_iter * sizeof(uint64_t));
+    if (!t_ns || !t_cycles)
+        goto done;
+    for (int i = 0; i < report->n_inputs; i++)
+        if (!ai_input[i].data)
+            goto done;
+    for (int i = 0; i < report->n_outputs; i++)
+        if (!ai_output[i].data)
+            goto done;
+
+    /* the inputs are generated once: only the inference is measured */
+    benchFillInputs(ai_input, report->n_inputs);
+
+    benchLog("\nRunning benchmark on \"%s\" (%d warm-up + %d calls, batch=%d%s)...\n",
+            report->model_name, cfg->n_warmup, cfg->n_iter, cfg->batch,
+            (cfg->bound) ? ", I/O bound" : (cfg->aot) ? ", AOT compiled" : "");
+
+#if defined(AI_MNETWORK_WITH_NETWORK_AOT)
+    if (cfg->aot && benchCheckAot(handle, report, cfg, ai_input, ai_output))
+        goto done;
+#endif
+
+    if (cfg->bound &&
+            (ai_mnetwork_bind_io(handle, ai_input, ai_output) != cfg->batch)) {
+        ai_error err = ai_mnetwork_get_error(handle);
+        benchLog("E: AI error (ai_mnetwork_bind_io) - type=%d code=%d\n",
+                err.type, err.code);
+        goto done;
+    }
+
+    for (int iter = 0; iter < cfg->n_warmup; iter++) {
+        if (benchCall(handle, cfg, ai_input, ai_output) != cfg->batch) {
+            ai_error err = ai_mnetwork_get_error(handle);
+            benchLog("E: AI error (ai_mnetwork_run) - type=%d code=%d\n",
+                    err.type, err.code);
+            goto done;
+        }
+    }
+
+    t_total = benchGetNs();
+    for (int iter = 0; iter < cfg->n_iter; iter++) {
+        const uint64_t c_start = benchGetCycles();
+        const uint64_t t_start = benchGetNs();
+        const ai_i32 batch = benchCall(handle, cfg, ai_input, ai_output);
+        const uint64_t t_end = benchGetNs();
+        const uint64_t c_end = benchGetCycles();
+        if (batch != cfg->batch) {
+            ai_error err = ai_mnetwork_get_error(handle);
+            benchLog("E: AI error (ai_mnetwork_run) - type=%d code=%d\n",
+                    err.type, err.code);
+            goto done;
+        }
+        t_ns[iter] = t_end - t_start;
+        t_cycles[iter] = c_end - c_start;
+    }
+    t_total = benchGetNs() - t_total;
+
+    memset(&r, 0, sizeof(r));
+    r.report = report;
+    r.cfg = cfg;
+    r.cpu = sched_getcpu();
+    r.total_s = (double)t_total * 1e-9;
+    r.throughput = (double)cfg->n_iter * (double)cfg->batch / r.total_s;
+    benchStats(t_ns, cfg->n_iter, &r.ns);
+#if defined(BENCH_HAS_TSC)
+    r.has_cycles = true;
+    benchStats(t_cycles, cfg->n_iter, &r.cycles);
+    if (report->n_macc)
+        r.cycles_per_macc = r.cycles.median /
+                ((double)cfg->batch * (double)report->n_macc);
+#endif
+
+    benchPrintResult(&r);
+    res = (cfg->json) ? benchWriteJson(&r, cfg->json) : 0;
+    if (!res && cfg->trace)
+        res = benchProfile(handle, report, cfg, ai_input, ai_output);
+
+done:
+    if (res)
+        benchLog("E: benchmark failed\n");
+    free(t_ns);
+    free(t_cycles);
+    for (int i = 0; i < report->n_inputs; i++)
+        free(ai_input[i].data);
+    for (int i = 0; i < report->n_outputs; i++)
+        free(ai_output[i].data);
+    return res;
+}
+
+/* -----------------------------------------------------------------------------
+ * Entry point
+ * -----------------------------------------------------------------------------
+ */
+
+static void benchUsage(const char *prog)
+{
+    printf("usage: %s [-n iterations] [-w warmup] [-b batch] [-c cpu] [-z|-a]"
+            " [-m model.tflite] [-o report.json|-] [-p trace.json]\n", prog);
+    printf("  -n  measured ai_mnetwork_run() calls (default %d)\n", _BENCH_ITER_);
+    printf("  -w  warm-up calls, not measured (default %d)\n", _BENCH_WARMUP_);
+    printf("  -b  samples per call (default %d)\n", AI_NETWORK_N_BATCHES);
+    printf("  -c  cpu to pin the benchmark on (default: not pinned)\n");
+    printf("  -z  bind the I/O buffers once, calls to ai_mnetwork_run_bound()\n");
+    printf("  -a  calls to the ahead-of-time compiled model (AOT=1 build)\n");
+    printf("  -m  .tflite model loaded at run time (TFLITE=1 build)\n");
+    printf("  -o  JSON report file, '-' for stdout\n");
+    printf("  -p  per c-node profiling pass, Chrome trace file\n");
+}
+
+int main(int argc, char *argv[])
+{
+    struct bench_config cfg = {
+            .n_iter = _BENCH_ITER_,
+            .n_warmup = _BENCH_WARMUP_,
+            .batch = AI_NETWORK_N_BATCHES,
+            .cpu = -1,
+            .bound = false,
+            .aot = false,
+            .model = NULL,
+            .json = NULL,
+            .trace = NULL,
+    };
+    ai_network_report report;
+    ai_handle handle = AI_HANDLE_NULL;
+    ai_u8 *activations = NULL;
+    ai_u32 act_addr, act_size;
+    const char *nn_name;
+    ai_error err;
+    int res = 1;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:w:b:c:zam:o:p:h")) != -1) {
+        switch (opt) {
+        case 'n': cfg.n_iter = atoi(optarg); break;
+        case 'w': cfg.n_warmup = atoi(optarg); break;
+        case 'b': cfg.batch = atoi(optarg); break;
+        case 'c': cfg.cpu = atoi(optarg); break;
+        case 'z': cfg.bound = true; break;
+        case 'a': cfg.aot = true; break;
+        case 'm': cfg.model = optarg; break;
+        case 'o': cfg.json = optarg; break;
+        case 'p': cfg.trace = optarg; break;
+        default:
+            benchUsage(argv[0]);
+            return (opt == 'h') ? 0 : 1;
+        }
+    }
+    if ((cfg.n_iter <= 0) || (cfg.n_warmup < 0) || (cfg.batch <= 0) ||
+            (cfg.aot && (cfg.bound || cfg.trace || cfg.model))) {
+        benchUsage(argv[0]);
+        return 1;
+    }
+#if !defined(AI_MNETWORK_WITH_NETWORK_AOT)
+    if (cfg.aot) {
+        fprintf(stderr, "E: built without the compiled model (AOT=0)\n");
+        return 1;
+    }
+#endif
+#if !defined(AI_MNETWORK_WITH_TFLITE)
+    if (cfg.model) {
+        fprintf(stderr, "E: built without the .tflite loader (TFLITE=0)\n");
+        return 1;
+    }
+#endif
+
+    /* the JSON document alone on stdout */
+    bench_log = (cfg.json && (strcmp(cfg.json, "-") == 0)) ? stderr : stdout;
+
+    benchLog("# %s\n", _BENCH_NAME_);
+
+    if (benchPinCpu(cfg.cpu) < 0 && cfg.cpu >= 0)
+        return 1;
+
+    srand(3); /* deterministic inputs */
+
+#if defined(AI_MNETWORK_WITH_TFLITE)
+    if (cfg.model) {
+        err = ai_mnetwork_load(cfg.model, &handle);
+        if (err.type) {
+            benchLog("E: AI error (ai_mnetwork_load %s) - type=%d code=%d\n",
+                    cfg.model, err.type, err.code);
+            return 1;
+        }
+        /* the loaded model follows the generated ones */
+        nn_name = ai_mnetwork_find(NULL, AI_MNETWORK_NUMBER);
+    }
+#endif
+    if (!cfg.model) {
+        nn_name = ai_mnetwork_find(NULL, 0);
+        if (!nn_name) {
+            benchLog("E: no embedded network\n");
+            return 1;
+        }
+
+        err = ai_mnetwork_create(nn_name, &handle, NULL);
+        if (err.type) {
+            benchLog("E: AI error (ai_mnetwork_create) - type=%d code=%d\n",
+                    err.type, err.code);
+            return 1;
+        }
+    }
+
+    /* activations buffer sized for the planned batch, 1 sample at least */
+    if (ai_mnetwork_get_ext_data_activations(handle, &act_addr, &act_size))
+        act_size = AI_MNETWORK_DATA_ACTIVATIONS_INT_SIZE;
+    activations = aligned_alloc(64, (act_size + 64) & ~63);
+    ai_network_params params = {
+            AI_BUFFER_OBJ_INIT(AI_BUFFER_FORMAT_NONE|AI_BUFFER_FMT_FLAG_CONST,
+                    0, 0, 0, 0, NULL),
+            AI_BUFFER_OBJ_INIT(AI_BUFFER_FORMAT_NONE|AI_BUFFER_FMT_FLAG_CONST,
+                    0, 0, 0, 0, AI_HANDLE_PTR(activations)) };
+
+    if (!activations || !ai_mnetwork_init(handle, &params)) {
+        err = ai_mnetwork_get_error(handle);
+        benchLog("E: AI error (ai_mnetwork_init) - type=%d code=%d\n",
+                err.type, err.code);
+        goto done;
+    }
+
+    if (!ai_mnetwork_get_info(handle, &report)) {
+        err = ai_mnetwork_get_error(handle);
+        benchLog("E: AI error (ai_mnetwork_get_info) - type=%d code=%d\n",
+                err.type, err.code);
+        goto done;
+    }
+
+    res = benchRun(handle, &report, &cfg) ? 1 : 0;
+
+done:
+    ai_mnetwork_destroy(handle);
+#if defined(AI_MNETWORK_WITH_TFLITE)
+    if (cfg.model)
+        ai_mnetwork_unload(nn_name);
+#endif
+    free(activations);
+    return res;
+}
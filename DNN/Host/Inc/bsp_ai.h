@@ -0,0 +1,35 @@
+/**
+  ******************************************************************************
+  * @file           : bsp_ai.h
+  * @brief          : Link to host resources
+  ******************************************************************************
+  * @attention
+  *
+  * Host (x86-64 Linux) replacement of Inc/bsp_ai.h: the UART and the HAL
+  * services used by the AI application are mapped to stdio and POSIX.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef BSP_H
+#define BSP_H
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#include <stdint.h>
+#include "app_x-cube-ai.h"
+#include "constants_ai.h"
+
+#define MX_UARTx_Init MX_HOST_UART_Init
+
+void MX_HOST_UART_Init(void);
+void HAL_Delay(uint32_t Delay);
+uint32_t HAL_GetTick(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BSP_H */
@@ -0,0 +1,712 @@
+/**
+  ******************************************************************************
+  * @file    aiSystemPerformance.c
+  * @brief   Host port of the AI system performance application
+  ******************************************************************************
+  * @attention
+  *
+  * Same flow as Src/aiSystemPerformance.c (bootstrap, perf. test with the
+  * per c-node observer, y = 6x + 10 demo) where the DWT cycle counter is
+  * replaced by the POSIX monotonic clock and the UART by stdout.
+  * All the embedded networks are measured and run on the demo samples (the
+  * int8 ones through their quantized I/O).
+  *
+  ******************************************************************************
+  */
+
+#define _POSIX_C_SOURCE 199309L
+
+/* System headers */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <inttypes.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+
+#define USE_OBSERVER         1 /* 0: remove the registration of the user CB to evaluate the inference time by layer */
+
+#include <aiSystemPerformance.h>
+#include <bsp_ai.h>
+
+/* AI header files */
+#include "ai_platform_interface.h"
+
+#define _APP_VERSION_MAJOR_     (0x05)
+#define _APP_VERSION_MINOR_     (0x00)
+
+#define _APP_NAME_      "AI system performance measurement (host)"
+
+#define _APP_ITER_       16  /* number of iteration for perf. test */
+
+#define _APP_DEMO_ITER_  8   /* number of samples of the y = 6x + 10 demo */
+
+/* number of samples passed to each ai_mnetwork_run() call of the perf. test:
+ * by default the batch planned in the activations (one graph walk per call) */
+#ifndef _APP_BATCH_
+#define _APP_BATCH_      AI_NETWORK_N_BATCHES
+#endif
+
+/* the host is fast enough for the c-nodes to run in less than 1ms:
+ * durations are reported in us (with a ns fraction) */
+struct hostTime {
+    int us;
+    int ns;
+};
+
+/* -----------------------------------------------------------------------------
+ * Host-related functions
+ * -----------------------------------------------------------------------------
+ */
+
+static inline uint64_t hostGetNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static int hostNsToTime(uint64_t ns, struct hostTime *t)
+{
+    if (!t)
+        return -1;
+    t->us = (int)(ns / 1000ULL);
+    t->ns = (int)(ns % 1000ULL);
+    return 0;
+}
+
+/* -----------------------------------------------------------------------------
+ * AI-related functions
+ * -----------------------------------------------------------------------------
+ */
+
+/* DEF_DATA_IN/DEF_DATA_OUT sized for _APP_BATCH_ samples */
+AI_ALIGNED(4) ai_i8 data_in_1[AI_MNETWORK_IN_1_SIZE_BYTES * _APP_BATCH_];
+static ai_i8* data_ins[] = {
+    data_in_1
+};
+
+AI_ALIGNED(4) ai_i8 data_out_1[AI_MNETWORK_OUT_1_SIZE_BYTES * _APP_BATCH_];
+static ai_i8* data_outs[] = {
+    data_out_1
+};
+
+struct network_exec_ctx {
+    ai_handle handle;
+    ai_network_report report;
+} net_exec_ctx[AI_MNETWORK_NUMBER] = {0};
+
+#define AI_BUFFER_NULL(ptr_)  \
+        AI_BUFFER_OBJ_INIT( \
+                AI_BUFFER_FORMAT_NONE|AI_BUFFER_FMT_FLAG_CONST, \
+                0, 0, 0, 0, \
+                AI_HANDLE_PTR(ptr_))
+
+#if AI_MNETWORK_DATA_ACTIVATIONS_INT_SIZE != 0
+AI_ALIGNED(4)
+static ai_u8 activations[AI_MNETWORK_DATA_ACTIVATIONS_INT_SIZE];
+#else
+AI_ALIGNED(4)
+static ai_u8 activations[1];
+#endif
+
+static inline void aiLogErr(const ai_error err, const char *fct)
+{
+    if (fct)
+        printf("E: AI error (%s) - type=%d code=%d\r\n", fct,
+                err.type, err.code);
+    else
+        printf("E: AI error - type=%d code=%d\r\n", err.type, err.code);
+}
+
+static inline void aiPrintLayoutBuffer(const char *msg, int idx,
+        const ai_buffer* buffer)
+{
+    uint32_t type_id = AI_BUFFER_FMT_GET_TYPE(buffer->format);
+    printf("%s[%d] ",msg, idx);
+    if (type_id == AI_BUFFER_FMT_TYPE_Q) {
+        printf(" %s%d,",
+                AI_BUFFER_FMT_GET_SIGN(buffer->format)?"s":"u",
+                        (int)AI_BUFFER_FMT_GET_BITS(buffer->format));
+        if (AI_BUFFER_META_INFO_INTQ(buffer->meta_info)) {
+            ai_float scale = AI_BUFFER_META_INFO_INTQ_GET_SCALE(buffer->meta_info, 0);
+            int zero_point = AI_BUFFER_META_INFO_INTQ_GET_ZEROPOINT(buffer->meta_info, 0);
+            printf("scale=%f, zero=%d,", scale, zero_point);
+        } else {
+            printf("Q%d.%d,",
+                    (int)AI_BUFFER_FMT_GET_BITS(buffer->format)
+                    - ((int)AI_BUFFER_FMT_GET_FBITS(buffer->format) +
+                            (int)AI_BUFFER_FMT_GET_SIGN(buffer->format)),
+                            (int)AI_BUFFER_FMT_GET_FBITS(buffer->format));
+        }
+    }
+    else if (type_id == AI_BUFFER_FMT_TYPE_FLOAT)
+        printf(" float%d,",
+                (int)AI_BUFFER_FMT_GET_BITS(buffer->format));
+    else
+        printf("NONE");
+    printf(" %u bytes, shape=(%d,%d,%u)",
+            (unsigned)AI_BUFFER_BYTE_SIZE(AI_BUFFER_SIZE(buffer), buffer->format),
+            buffer->height, buffer->width, (unsigned)buffer->channels);
+    if (buffer->data)
+        printf(" (@%p)\r\n", buffer->data);
+    else
+        printf(" (USER domain)\r\n");
+}
+
+static inline void aiPrintNetworkInfo(const ai_network_report* report)
+{
+    int i;
+    printf("Network informations...\r\n");
+    printf(" model name         : %s\r\n", report->model_name);
+    printf(" model signature    : %s\r\n", report->model_signature);
+    printf(" model datetime     : %s\r\n", report->model_datetime);
+    printf(" compile datetime   : %s\r\n", report->compile_datetime);
+    printf(" runtime version    : %d.%d.%d\r\n",
+            report->runtime_version.major,
+            report->runtime_version.minor,
+            report->runtime_version.micro);
+    if (report->tool_revision[0])
+        printf(" Tool revision      : %s\r\n", report->tool_revision);
+    printf(" tools version      : %d.%d.%d\r\n",
+            report->tool_version.major,
+            report->tool_version.minor,
+            report->tool_version.micro);
+    printf(" complexity         : %u MACC\r\n", (unsigned)report->n_macc);
+    printf(" c-nodes            : %u\r\n", (unsigned)report->n_nodes);
+    printf(" activations        : %u bytes (@%p)\r\n",
+            (unsigned)(AI_BUFFER_SIZE(&report->activations) *
+                    (report->activations.n_batches ? report->activations.n_batches : 1)),
+            report->activations.data);
+    printf(" weights            : %u bytes (@%p)\r\n",
+            (unsigned)AI_BUFFER_SIZE(&report->params), report->params.data);
+    printf(" inputs/outputs     : %u/%u\r\n", report->n_inputs,
+            report->n_outputs);
+    for (i=0; i<report->n_inputs; i++)
+        aiPrintLayoutBuffer("  I", i, &report->inputs[i]);
+    for (i=0; i<report->n_outputs; i++)
+        aiPrintLayoutBuffer("  O", i, &report->outputs[i]);
+}
+
+static int aiBootstrap(const char *nn_name, const int idx)
+{
+    ai_error err;
+    ai_u32 ext_addr, sz;
+
+    /* Creating the network */
+    printf("Creating instance for \"%s\"..\r\n", nn_name);
+    err = ai_mnetwork_create(nn_name, &net_exec_ctx[idx].handle, NULL);
+    if (err.type) {
+        aiLogErr(err, "ai_mnetwork_create");
+        return -1;
+    }
+
+    /* Initialize the instance */
+    printf("Initializing..\r\n");
+
+    /* build params structure to provide the reference of the
+     * activation and weight buffers */
+    ai_network_params params = {
+            AI_BUFFER_NULL(NULL),
+            AI_BUFFER_NULL(NULL) };
+
+    if (ai_mnetwork_get_ext_data_activations(net_exec_ctx[idx].handle, &ext_addr, &sz) == 0) {
+        /* no external memory on the host: always the internal buffer */
+        params.activations.data = (ai_handle)activations;
+    }
+
+    if (!ai_mnetwork_init(net_exec_ctx[idx].handle, &params)) {
+        err = ai_mnetwork_get_error(net_exec_ctx[idx].handle);
+        aiLogErr(err, "ai_mnetwork_init");
+        ai_mnetwork_destroy(net_exec_ctx[idx].handle);
+        net_exec_ctx[idx].handle = AI_HANDLE_NULL;
+        return -4;
+    }
+
+    /* Query the created network to get relevant info from it */
+    if (ai_mnetwork_get_info(net_exec_ctx[idx].handle, &net_exec_ctx[idx].report)) {
+        aiPrintNetworkInfo(&net_exec_ctx[idx].report);
+    } else {
+        err = ai_mnetwork_get_error(net_exec_ctx[idx].handle);
+        aiLogErr(err, "ai_mnetwork_get_info");
+        ai_mnetwork_destroy(net_exec_ctx[idx].handle);
+        net_exec_ctx[idx].handle = AI_HANDLE_NULL;
+        return -2;
+    }
+
+    return 0;
+}
+
+static int aiInit(void)
+{
+    const char *nn_name;
+    int idx;
+
+    printf("\r\nAI Network (AI platform API %d.%d.%d)...\r\n",
+            AI_PLATFORM_API_MAJOR,
+            AI_PLATFORM_API_MINOR,
+            AI_PLATFORM_API_MICRO);
+
+    /* Discover and init the embedded network */
+    idx = 0;
+    do {
+        nn_name = ai_mnetwork_find(NULL, idx);
+        if (nn_name) {
+            printf("\r\nFound the network \"%s\"\r\n", nn_name);
+            if (aiBootstrap(nn_name, idx))
+                return -1;
+        }
+        idx++;
+    } while (nn_name && idx < AI_MNETWORK_NUMBER);
+
+    return 0;
+}
+
+static void aiDeInit(void)
+{
+    ai_error err;
+    int idx;
+
+    printf("Releasing the network(s)...\r\n");
+
+    for (idx=0; idx<AI_MNETWORK_NUMBER; idx++) {
+        if (net_exec_ctx[idx].handle) {
+            if (ai_mnetwork_destroy(net_exec_ctx[idx].handle) != AI_HANDLE_NULL) {
+                err = ai_mnetwork_get_error(net_exec_ctx[idx].handle);
+                aiLogErr(err, "ai_mnetwork_destroy");
+            }
+            net_exec_ctx[idx].handle = NULL;
+        }
+    }
+}
+
+#if defined(USE_OBSERVER) && USE_OBSERVER == 1
+
+struct u_node_stat {
+    uint64_t dur;
+    uint32_t n_runs;
+};
+
+struct u_observer_ctx {
+    uint64_t n_cb;
+    uint64_t start_t;
+    uint64_t u_dur_t;
+    uint64_t k_dur_t;
+    struct u_node_stat *nodes;
+};
+
+static struct u_observer_ctx u_observer_ctx;
+
+/* User callback */
+static ai_u32 user_observer_cb(const ai_handle cookie,
+    const ai_u32 flags,
+    const ai_observer_node *node) {
+
+  struct u_observer_ctx *u_obs;
+
+  const uint64_t ts = hostGetNs(); /* time stamp entry */
+
+  u_obs = (struct u_observer_ctx *)cookie;
+  u_obs->n_cb += 1;
+
+  if (flags & AI_OBSERVER_POST_EVT) {
+    const uint64_t end_t = ts - u_obs->start_t;
+    u_obs->k_dur_t += end_t;
+    u_obs->nodes[node->c_idx].dur += end_t;
+    u_obs->nodes[node->c_idx].n_runs += 1;
+  }
+
+  u_obs->start_t = hostGetNs(); /* time stamp exit */
+  u_obs->u_dur_t += u_obs->start_t  - ts; /* cumulate time used by the CB */
+  return 0;
+}
+
+static void aiObserverInit(struct network_exec_ctx *net_ctx)
+{
+  ai_handle  net_hdl;
+  ai_network_params net_params;
+  ai_bool res;
+  int sz;
+
+  if (!net_ctx || (net_ctx->handle == AI_HANDLE_NULL) || !net_ctx->report.n_nodes)
+    return;
+
+  /* retrieve real handle */
+  ai_mnetwork_get_private_handle(net_ctx->handle, &net_hdl, &net_params);
+
+  memset((void *)&u_observer_ctx, 0, sizeof(struct u_observer_ctx));
+
+  /* allocate resources to store the state of the nodes */
+  sz = net_ctx->report.n_nodes * sizeof(struct u_node_stat);
+  u_observer_ctx.nodes = (struct u_node_stat*)malloc(sz);
+  if (!u_observer_ctx.nodes) {
+    printf("W: enable to allocate the u_node_stats (sz=%d) ..\r\n", sz);
+    return;
+  }
+
+  memset(u_observer_ctx.nodes, 0, sz);
+
+  /* register the callback */
+  res = ai_platform_observer_register(net_hdl, user_observer_cb,
+      (ai_handle)&u_observer_ctx, AI_OBSERVER_PRE_EVT | AI_OBSERVER_POST_EVT);
+  if (!res) {
+    printf("W: enable to register the user CB\r\n");
+    free(u_observer_ctx.nodes);
+    u_observer_ctx.nodes = NULL;
+    return;
+  }
+}
+
+extern const char* ai_layer_type_name(const ai_u16 type);
+
+static void aiObserverDone(struct network_exec_ctx *net_ctx)
+{
+  ai_handle  net_hdl;
+  ai_network_params net_params;
+  struct hostTime t;
+  uint64_t cumul;
+  ai_observer_node node_info;
+
+  if (!net_ctx || (net_ctx->handle == AI_HANDLE_NULL) ||
+      !net_ctx->report.n_nodes || !u_observer_ctx.nodes)
+    return;
+
+  /* retrieve real handle */
+  ai_mnetwork_get_private_handle(net_ctx->handle, &net_hdl, &net_params);
+
+  ai_platform_observer_unregister(net_hdl, user_observer_cb,
+      (ai_handle)&u_observer_ctx);
+
+  if (!u_observer_ctx.nodes[0].n_runs) {
+    free(u_observer_ctx.nodes);
+    memset((void *)&u_observer_ctx, 0, sizeof(struct u_observer_ctx));
+    return;
+  }
+
+  printf("\r\n Inference time by c-node\r\n");
+  hostNsToTime(u_observer_ctx.k_dur_t / u_observer_ctx.nodes[0].n_runs, &t);
+  printf("  kernel  : %d,%03dus (time passed in the c-kernel fcts)\n", t.us, t.ns);
+  hostNsToTime(u_observer_ctx.u_dur_t / u_observer_ctx.nodes[0].n_runs, &t);
+  printf("  user    : %d,%03dus (time passed in the user cb)\n", t.us, t.ns);
+
+  printf("\r\n %-6s%-20s%-7s %s\r\n", "c_id", "type", "id", "time (us)");
+  printf(" -------------------------------------------------\r\n");
+
+  cumul = 0;
+  node_info.c_idx = 0;
+  while (ai_platform_observer_node_info(net_hdl, &node_info)) {
+    struct u_node_stat *sn = &u_observer_ctx.nodes[node_info.c_idx];
+    const char *fmt;
+    cumul +=  sn->dur;
+    hostNsToTime(sn->dur / (uint64_t)sn->n_runs, &t);
+    if ((node_info.type & (ai_u16)0x8000) >> 15)
+      fmt = " %-6dTD-%-17s%-5d %4d,%03d %6.02f %c\n";
+    else
+      fmt = " %-6d%-20s%-5d %4d,%03d %6.02f %c\n";
+
+    printf(fmt, node_info.c_idx,
+        ai_layer_type_name(node_info.type  & (ai_u16)0x7FFF),
+        (int)node_info.id,
+        t.us, t.ns,
+        ((float)sn->dur * 100.0f) / (float)u_observer_ctx.k_dur_t,
+        '%');
+    node_info.c_idx++;
+  }
+  /* the last lookup is out of range: clear the pending error */
+  ai_mnetwork_get_error(net_ctx->handle);
+
+  printf(" -------------------------------------------------\r\n");
+  cumul /= u_observer_ctx.nodes[0].n_runs;
+  hostNsToTime(cumul, &t);
+  printf(" %31s %4d,%03d us\r\n", "", t.us, t.ns);
+
+  free(u_observer_ctx.nodes);
+  memset((void *)&u_observer_ctx, 0, sizeof(struct u_observer_ctx));
+
+  return;
+}
+#endif
+
+
+/* -----------------------------------------------------------------------------
+ * Specific APP/test functions
+ * -----------------------------------------------------------------------------
+ */
+
+static int aiTestPerformance(int idx)
+{
+    int iter;
+    ai_i32 batch;
+    int niter;
+
+    struct hostTime t;
+    uint64_t tcumul;
+    uint64_t tstart;
+    uint64_t tend;
+    uint64_t tmin;
+    uint64_t tmax;
+
+    ai_buffer ai_input[AI_MNETWORK_IN_NUM];
+    ai_buffer ai_output[AI_MNETWORK_OUT_NUM];
+
+    if (net_exec_ctx[idx].handle == AI_HANDLE_NULL) {
+        printf("E: network handle is NULL\r\n");
+        return -1;
+    }
+
+    niter = _APP_ITER_;
+
+    printf("\r\nRunning PerfTest on \"%s\" with random inputs (%d iterations)...\r\n",
+            net_exec_ctx[idx].report.model_name, niter);
+
+    /* reset/init the counters */
+    tcumul = 0ULL;
+    tmin = UINT64_MAX;
+    tmax = 0UL;
+
+    if ((net_exec_ctx[idx].report.n_inputs > AI_MNETWORK_IN_NUM) ||
+            (net_exec_ctx[idx].report.n_outputs > AI_MNETWORK_OUT_NUM))
+    {
+        printf("E: AI_MNETWORK_IN/OUT_NUM definition are incoherent\r\n");
+        return -1;
+    }
+
+    /* Fill the input tensor descriptors */
+    for (int i = 0; i < net_exec_ctx[idx].report.n_inputs; i++) {
+        ai_input[i] = net_exec_ctx[idx].report.inputs[i];
+        ai_input[i].n_batches  = _APP_BATCH_;
+        if (net_exec_ctx[idx].report.inputs[i].data)
+            ai_input[i].data = AI_HANDLE_PTR(net_exec_ctx[idx].report.inputs[i].data);
+        else
+            ai_input[i].data = AI_HANDLE_PTR(data_ins[i]);
+    }
+
+    /* Fill the output tensor descriptors */
+    for (int i = 0; i < net_exec_ctx[idx].report.n_outputs; i++) {
+        ai_output[i] = net_exec_ctx[idx].report.outputs[i];
+        ai_output[i].n_batches = _APP_BATCH_;
+        ai_output[i].data = AI_HANDLE_PTR(data_outs[i]);
+    }
+
+    /* the buffers are bound once, the runs only execute the layers */
+    batch = ai_mnetwork_bind_io(net_exec_ctx[idx].handle, ai_input, ai_output);
+    if (batch != _APP_BATCH_) {
+        aiLogErr(ai_mnetwork_get_error(net_exec_ctx[idx].handle),
+                "ai_mnetwork_bind_io");
+        return -1;
+    }
+
+#if defined(USE_OBSERVER) && USE_OBSERVER == 1
+    /* Enable observer */
+    aiObserverInit(&net_exec_ctx[idx]);
+#endif
+
+    /* Main inference loop */
+    for (iter = 0; iter < niter; iter++) {
+
+        /* Fill input tensors with random data */
+        for (int i = 0; i < net_exec_ctx[idx].report.n_inputs; i++) {
+            const ai_buffer_format fmt = AI_BUFFER_FORMAT(&ai_input[i]);
+            ai_i8 *in_data = (ai_i8 *)ai_input[i].data;
+            for (ai_size j = 0; j < AI_BUFFER_SIZE(&ai_input[i]) * _APP_BATCH_; ++j) {
+                /* uniform distribution between -1.0 and 1.0 */
+                const float v = 2.0f * (ai_float) rand() / (ai_float) RAND_MAX - 1.0f;
+                if  (AI_BUFFER_FMT_GET_TYPE(fmt) == AI_BUFFER_FMT_TYPE_FLOAT) {
+                    *(ai_float *)(in_data + j * 4) = v;
+                }
+                else {
+                    in_data[j] = (ai_i8)(v * 127);
+                }
+            }
+        }
+
+        tstart = hostGetNs();
+        batch = ai_mnetwork_run_bound(net_exec_ctx[idx].handle);
+        if (batch != _APP_BATCH_) {
+            aiLogErr(ai_mnetwork_get_error(net_exec_ctx[idx].handle),
+                    "ai_mnetwork_run_bound");
+            break;
+        }
+        tend = hostGetNs() - tstart;
+
+        if (tend < tmin)
+            tmin = tend;
+
+        if (tend > tmax)
+            tmax = tend;
+
+        tcumul += tend;
+
+        printf(".");
+        fflush(stdout);
+    }
+
+    printf("\r\n");
+
+    if (iter == 0) {
+#if defined(USE_OBSERVER) && USE_OBSERVER == 1
+        aiObserverDone(&net_exec_ctx[idx]);
+#endif
+        return -1;
+    }
+
+    printf("\r\n");
+
+#if defined(USE_OBSERVER) && USE_OBSERVER == 1
+    tmin = tmin - u_observer_ctx.u_dur_t / (uint64_t)iter;
+    tmax = tmax - u_observer_ctx.u_dur_t / (uint64_t)iter;
+    tcumul -= u_observer_ctx.u_dur_t;
+#endif
+
+    /* durations are reported per inference (sample) */
+    tcumul /= (uint64_t)iter * _APP_BATCH_;
+    tmin /= _APP_BATCH_;
+    tmax /= _APP_BATCH_;
+
+    hostNsToTime(tcumul, &t);
+
+    printf("Results for \"%s\", %d inferences (complexity: %u MACC)\r\n",
+            net_exec_ctx[idx].report.model_name, iter * _APP_BATCH_,
+            (unsigned)net_exec_ctx[idx].report.n_macc);
+    printf(" batch        : %d samples per call\r\n", _APP_BATCH_);
+
+    printf(" duration     : %d.%03d us (average)\r\n", t.us, t.ns);
+    printf(" ns           : %" PRIu64 " -%" PRIu64 "/+%" PRIu64 " (average,-/+)\r\n",
+            tcumul, tcumul - tmin, tmax - tcumul);
+    printf(" ns/MACC      : %.2f (average for all layers)\r\n",
+            (double)tcumul / (double)net_exec_ctx[idx].report.n_macc);
+
+#if defined(USE_OBSERVER) && USE_OBSERVER == 1
+    aiObserverDone(&net_exec_ctx[idx]);
+#endif
+
+    return 0;
+}
+
+
+/* -----------------------------------------------------------------------------
+ * Exported/Public functions
+ * -----------------------------------------------------------------------------
+ */
+
+int aiSystemPerformanceInit(void)
+{
+    printf("\r\n#\r\n");
+    printf("# %s %d.%d\r\n", _APP_NAME_ , _APP_VERSION_MAJOR_,
+            _APP_VERSION_MINOR_ );
+    printf("#\r\n");
+
+#if defined(__clang__)
+    printf("Compiled with Clang %d.%d.%d\r\n", __clang_major__,
+            __clang_minor__, __clang_patchlevel__);
+#elif defined(__GNUC__)
+    printf("Compiled with GCC %d.%d.%d\r\n", __GNUC__, __GNUC_MINOR__,
+            __GNUC_PATCHLEVEL__);
+#endif
+
+    aiInit();
+
+    srand(3); /* deterministic outcome */
+
+    return 0;
+}
+
+/* runs the demo samples on the network idx: the float inputs/outputs are
+ * (de)quantized with the scale/zero point of the integer I/O buffers */
+static int aiDemoRun(int idx, const ai_float *input, ai_float *output, int n)
+{
+    ai_buffer ai_input[AI_MNETWORK_IN_NUM];
+    ai_buffer ai_output[AI_MNETWORK_OUT_NUM];
+    ai_i8 in_q[_APP_DEMO_ITER_];
+    ai_i8 out_q[_APP_DEMO_ITER_];
+    const ai_buffer_meta_info *in_meta;
+    const ai_buffer_meta_info *out_meta;
+    ai_i32 batch;
+
+    ai_input[0] = net_exec_ctx[idx].report.inputs[0];
+    ai_output[0] = net_exec_ctx[idx].report.outputs[0];
+    in_meta = ai_input[0].meta_info;
+    out_meta = ai_output[0].meta_info;
+
+    ai_input[0].n_batches = n;
+    ai_output[0].n_batches = n;
+    if (AI_BUFFER_META_INFO_INTQ(in_meta)) {
+        const ai_float scale = AI_BUFFER_META_INFO_INTQ_GET_SCALE(in_meta, 0);
+        const int zp = AI_BUFFER_META_INFO_INTQ_GET_ZEROPOINT(in_meta, 0);
+        for (int i = 0; i < n; i++) {
+            const int q = (int)lroundf(input[i] / scale) + zp;
+            in_q[i] = (ai_i8)((q < -128) ? -128 : ((q > 127) ? 127 : q));
+        }
+        ai_input[0].data = AI_HANDLE_PTR(in_q);
+    } else {
+        ai_input[0].data = AI_HANDLE_PTR(input);
+    }
+    ai_output[0].data = (AI_BUFFER_META_INFO_INTQ(out_meta)) ?
+            AI_HANDLE_PTR(out_q) : AI_HANDLE_PTR(output);
+
+    batch = ai_mnetwork_run(net_exec_ctx[idx].handle, &ai_input[0], &ai_output[0]);
+    if (batch != n) {
+        aiLogErr(ai_mnetwork_get_error(net_exec_ctx[idx].handle),
+                "ai_mnetwork_run");
+        return -1;
+    }
+
+    if (AI_BUFFER_META_INFO_INTQ(out_meta)) {
+        const ai_float scale = AI_BUFFER_META_INFO_INTQ_GET_SCALE(out_meta, 0);
+        const int zp = AI_BUFFER_META_INFO_INTQ_GET_ZEROPOINT(out_meta, 0);
+        for (int i = 0; i < n; i++)
+            output[i] = scale * (ai_float)(out_q[i] - zp);
+    }
+    return 0;
+}
+
+int aiSystemPerformanceProcess(void)
+{
+    int idx;
+    float y_pred;
+
+    ai_float input[_APP_DEMO_ITER_] = {0};  // initial
+    ai_float output[AI_MNETWORK_NUMBER][_APP_DEMO_ITER_] = {{0}};
+
+    for (idx = 0; idx < AI_MNETWORK_NUMBER; idx++) {
+        if (net_exec_ctx[idx].handle == AI_HANDLE_NULL)
+        {
+            printf("E: network handle is NULL\r\n");
+            return -1;
+        }
+
+        if (aiTestPerformance(idx))
+            return -1;
+    }
+
+    /* all the demo samples are processed by a single call */
+    for (int i=0; i < _APP_DEMO_ITER_; i++)
+        input[i] = rand()%20 - 15;
+    for (idx = 0; idx < AI_MNETWORK_NUMBER; idx++) {
+        if (aiDemoRun(idx, input, output[idx], _APP_DEMO_ITER_))
+            return -1;
+    }
+
+    printf("\r\n");
+    for (int i=0; i < _APP_DEMO_ITER_; i++)
+    {
+        y_pred = 6 * input[i] + 10;
+        printf("input  : %8.2f   y_pre  : %8.2f", input[i], output[0][i]);
+        /* the other networks: int8 versions of the model */
+        for (idx = 1; idx < AI_MNETWORK_NUMBER; idx++)
+            printf("   %s : %8.2f", net_exec_ctx[idx].report.model_name,
+                    output[idx][i]);
+        printf("   y_true : %8.2f\r\n", y_pred);
+    }
+
+    return 0;
+}
+
+void aiSystemPerformanceDeInit(void)
+{
+    printf("\r\n");
+    aiDeInit();
+    printf("bye bye ...\r\n");
+}
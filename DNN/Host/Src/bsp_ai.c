@@ -0,0 +1,35 @@
+/**
+  ******************************************************************************
+  * @file           : bsp_ai.c
+  * @brief          : Host implementation of the board services
+  ******************************************************************************
+  */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <time.h>
+
+#include "bsp_ai.h"
+
+void MX_HOST_UART_Init(void)
+{
+    /* stdout is the console: line buffered to mimic the UART behaviour */
+    setvbuf(stdout, NULL, _IOLBF, 0);
+}
+
+void HAL_Delay(uint32_t Delay)
+{
+    struct timespec ts;
+    ts.tv_sec = Delay / 1000;
+    ts.tv_nsec = (long)(Delay % 1000) * 1000000L;
+    while (nanosleep(&ts, &ts))
+        ;
+}
+
+uint32_t HAL_GetTick(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
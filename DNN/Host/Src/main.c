@@ -0,0 +1,26 @@
+/**
+  ******************************************************************************
+  * @file           : main.c
+  * @brief          : Host program body
+  ******************************************************************************
+  * @attention
+  *
+  * Runs the X-CUBE-AI application once on the host, against the open runtime
+  * of Middlewares/ST/AI/Src.
+  *
+  ******************************************************************************
+  */
+
+#include "app_x-cube-ai.h"
+#include "aiSystemPerformance.h"
+
+int main(void)
+{
+    MX_X_CUBE_AI_Init();
+
+    MX_X_CUBE_AI_Process();
+
+    aiSystemPerformanceDeInit();
+
+    return 0;
+}
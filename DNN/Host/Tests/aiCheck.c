@@ -0,0 +1,531 @@
+/**
+  ******************************************************************************
+  * @file    aiCheck.c
+  * @brief   Host checks of the runtime kernels
+  ******************************************************************************
+  * @attention
+  *
+  * Each pass runs the checks in a child process with AI_CPU_FEATURES (and
+  * AI_MATH_ACCURACY for the checks of the math tiers) set before the first
+  * kernel dispatch: the generic kernels (none), then the AVX2 and the
+  * AVX-512 ones when the cpu has them. A check compares its results with a
+  * naive reference; the results of the SIMD passes are compared with the
+  * ones of the generic pass of the same tier.
+  *
+  * usage: aiCheck [-v] [-l] [check ...]
+  *
+  ******************************************************************************
+  */
+
+/* System headers */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+/* AI header files */
+#include "network.h"
+#include "network_data.h"
+#include "core_cpu.h"
+#include "core_graph.h"
+#include "core_network.h"
+
+#include "aiCheck.h"
+
+#define _CHECK_NAME_            "AI kernel checks (host)"
+
+#define CHECK_WHAT_SIZE         (64)
+#define CHECK_MAX_REPORTS       (4)
+
+static const struct check_entry checks[] = {
+    { "dense",        false, checkDense },
+    { "conv",         false, checkConv },
+    { "conv_nl_pool", false, checkConvNlPool },
+    { "conv_dw_pw",   false, checkConvDwPw },
+    { "pool",         false, checkPool },
+    { "math",         true,  checkMath },
+    { "softmax",      false, checkSoftmax },
+    { "tflite",       false, checkTflite },
+    { "plan",         false, checkPlan },
+    { "batch",        false, checkBatch },
+    { "mnetwork",     false, checkMnetwork },
+};
+
+#define CHECK_N         (sizeof(checks) / sizeof(checks[0]))
+
+/* AI_CPU_FEATURES of the passes, the first one is the reference */
+static const char *const check_features[] = {
+    "none", "f16c,avx2", "f16c,avx512",
+};
+
+#define CHECK_N_FEATURES \
+    (sizeof(check_features) / sizeof(check_features[0]))
+
+/* AI_MATH_ACCURACY of the passes: NULL for the default tier */
+static const char *const check_tiers[] = { NULL, "libm", "ulp2", "fast" };
+
+#define CHECK_N_TIERS   (sizeof(check_tiers) / sizeof(check_tiers[0]))
+
+/* a recorded result, followed by n doubles */
+struct check_record {
+    char what[CHECK_WHAT_SIZE];
+    uint32_t is_int;
+    uint32_t n;
+    double tol;
+};
+
+/* results of a pass */
+struct check_results {
+    uint8_t *data;
+    size_t size;
+};
+
+static struct {
+    bool verbose;
+    int out_fd;             /* records of the running pass */
+    const char *tier;
+    const char *check;      /* running check */
+    uint32_t seed;
+    long failures;
+    long results;
+    ai_handle network;
+    ai_node *input_node;    /* of the network before checkGraphFold */
+} check_ctx;
+
+/* -------------------------------------------------------------------------- */
+static void checkFail(const char *fmt, ...)
+{
+    va_list ap;
+
+    if (check_ctx.failures++ < 32) {
+        printf("    FAIL %s: ", check_ctx.check);
+        va_start(ap, fmt);
+        vprintf(fmt, ap);
+        va_end(ap);
+        printf("\n");
+    }
+}
+
+static bool checkMatch(double out, double ref, double tol, bool is_int)
+{
+    if (isnan(ref) || isnan(out))
+        return isnan(ref) && isnan(out);
+    if (isinf(ref) || isinf(out))
+        return out == ref;
+    if (is_int)
+        return fabs(out - ref) <= tol;
+    return fabs(out - ref) <= tol * fmax(1.0, fabs(ref));
+}
+
+static void checkWrite(const void *data, size_t size)
+{
+    const uint8_t *p = data;
+
+    while (size) {
+        ssize_t n = write(check_ctx.out_fd, p, size);
+        if (n <= 0) {
+            perror("E: write");
+            exit(2);
+        }
+        p += n;
+        size -= (size_t)n;
+    }
+}
+
+static void checkRecord(const char *what, const double *values, size_t n,
+        double tol, bool is_int)
+{
+    struct check_record r = { { 0 } };
+
+    snprintf(r.what, sizeof(r.what), "%s/%s", check_ctx.check, what);
+    r.is_int = is_int;
+    r.n = (uint32_t)n;
+    r.tol = tol;
+    checkWrite(&r, sizeof(r));
+    checkWrite(values, n * sizeof(double));
+    check_ctx.results++;
+}
+
+static void checkValues(const char *what, const double *out,
+        const double *ref, size_t n, double tol, bool is_int)
+{
+    size_t bad = 0, first = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        if (!checkMatch(out[i], ref[i], tol, is_int) && !bad++)
+            first = i;
+    }
+    if (bad)
+        checkFail("%s: %zu/%zu results off the reference, [%zu] %.9g "
+                "instead of %.9g", what, bad, n, first, out[first],
+                ref[first]);
+    else if (check_ctx.verbose)
+        printf("    %s/%s: %zu results ok\n", check_ctx.check, what, n);
+    checkRecord(what, out, n, tol, is_int);
+}
+
+/* -------------------------------------------------------------------------- */
+const char *checkTier(void)
+{
+    return check_ctx.tier;
+}
+
+float checkRand(void)
+{
+    /* xorshift32 */
+    uint32_t x = check_ctx.seed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    check_ctx.seed = x;
+    return (float)((int32_t)x >> 8) * (1.0f / (1 << 23));
+}
+
+void checkFill(ai_float *data, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        data[i] = checkRand();
+}
+
+int32_t checkRandInt(int32_t lo, int32_t hi)
+{
+    const float u = 0.5f * (checkRand() + 1.0f);
+    int32_t v = lo + (int32_t)(u * (float)(hi - lo + 1));
+    return (v > hi) ? hi : v;
+}
+
+void checkFloats(const char *what, const ai_float *out, const ai_float *ref,
+        size_t n, double tol)
+{
+    double *o = malloc(2 * n * sizeof(double) + 1);
+
+    for (size_t i = 0; i < n; i++) {
+        o[i] = out[i];
+        o[n + i] = ref[i];
+    }
+    checkValues(what, o, o + n, n, tol, false);
+    free(o);
+}
+
+void checkInts(const char *what, const int32_t *out, const int32_t *ref,
+        size_t n, int32_t tol)
+{
+    double *o = malloc(2 * n * sizeof(double) + 1);
+
+    for (size_t i = 0; i < n; i++) {
+        o[i] = out[i];
+        o[n + i] = ref[i];
+    }
+    checkValues(what, o, o + n, n, tol, true);
+    free(o);
+}
+
+void checkS8(const char *what, const ai_i8 *out, const ai_i8 *ref,
+        size_t n, int32_t tol)
+{
+    double *o = malloc(2 * n * sizeof(double) + 1);
+
+    for (size_t i = 0; i < n; i++) {
+        o[i] = out[i];
+        o[n + i] = ref[i];
+    }
+    checkValues(what, o, o + n, n, tol, true);
+    free(o);
+}
+
+void checkU8(const char *what, const ai_u8 *out, const ai_u8 *ref,
+        size_t n, int32_t tol)
+{
+    double *o = malloc(2 * n * sizeof(double) + 1);
+
+    for (size_t i = 0; i < n; i++) {
+        o[i] = out[i];
+        o[n + i] = ref[i];
+    }
+    checkValues(what, o, o + n, n, tol, true);
+    free(o);
+}
+
+void checkBound(const char *what, double value, double bound)
+{
+    if (!(value <= bound))
+        checkFail("%s: %.4g above the bound %.4g", what, value, bound);
+    else if (check_ctx.verbose)
+        printf("    %s/%s: %.4g (bound %.4g)\n", check_ctx.check, what,
+                value, bound);
+}
+
+void checkTrue(const char *what, bool cond)
+{
+    if (!cond)
+        checkFail("%s", what);
+}
+
+/* -------------------------------------------------------------------------- */
+void checkTensorInit(struct check_tensor *t, ai_array_format fmt,
+        void *data, size_t size, ai_i32 in_ch, ai_i32 ch, ai_i32 w, ai_i32 h,
+        ai_intq_info_list *intq)
+{
+    const ai_i32 elem = (ai_i32)AI_FMT_GET_BITS(fmt) / 8;
+
+    memset(t, 0, sizeof(*t));
+    t->shape[AI_SHAPE_IN_CHANNEL] = in_ch;
+    t->shape[AI_SHAPE_CHANNEL] = ch;
+    t->shape[AI_SHAPE_WIDTH] = w;
+    t->shape[AI_SHAPE_HEIGHT] = h;
+    t->stride[AI_SHAPE_IN_CHANNEL] = (elem > 0) ? elem : 1;
+    t->stride[AI_SHAPE_CHANNEL] = t->stride[AI_SHAPE_IN_CHANNEL] * in_ch;
+    t->stride[AI_SHAPE_WIDTH] = t->stride[AI_SHAPE_CHANNEL] * ch;
+    t->stride[AI_SHAPE_HEIGHT] = t->stride[AI_SHAPE_WIDTH] * w;
+
+    t->array = (ai_array)AI_ARRAY_OBJ_INIT(fmt, data, data, size);
+    t->tensor = (ai_tensor)AI_TENSOR_OBJ_INIT(0, 0,
+            AI_SHAPE_INIT_FROM_BUFFER(AI_SHAPE_MAX_DIMENSION, t->shape),
+            AI_STRIDE_INIT_FROM_BUFFER(AI_SHAPE_MAX_DIMENSION, t->stride),
+            1, &t->array, intq);
+}
+
+ai_network *checkNetwork(void)
+{
+    if (!check_ctx.network) {
+        ai_error err = ai_network_create(&check_ctx.network,
+                AI_NETWORK_DATA_CONFIG);
+        if (err.type) {
+            fprintf(stderr, "E: AI error (ai_network_create) - type=%d "
+                    "code=%d\n", err.type, err.code);
+            exit(2);
+        }
+        check_ctx.input_node = ((ai_network *)check_ctx.network)->input_node;
+    }
+    return (ai_network *)check_ctx.network;
+}
+
+ai_u32 checkGraphFold(ai_layer *first)
+{
+    ai_network *net = checkNetwork();
+
+    net->input_node = (ai_node *)first;
+    return core_graph_fold(net);
+}
+
+void checkGraphUnfold(void)
+{
+    if (!check_ctx.network)
+        return;
+    core_graph_unfold((ai_network *)check_ctx.network);
+    ((ai_network *)check_ctx.network)->input_node = check_ctx.input_node;
+}
+
+/* -------------------------------------------------------------------------- */
+static bool checkSelected(const char *name, int argc, char *argv[])
+{
+    if (argc <= 0)
+        return true;
+    for (int i = 0; i < argc; i++) {
+        if (!strcmp(argv[i], name))
+            return true;
+    }
+    return false;
+}
+
+/* child: runs the selected checks, writes the records to fd */
+static int checkPass(const char *features, const char *tier, int fd,
+        int argc, char *argv[])
+{
+    setenv("AI_CPU_FEATURES", features, 1);
+    if (tier)
+        setenv("AI_MATH_ACCURACY", tier, 1);
+    else
+        unsetenv("AI_MATH_ACCURACY");
+    check_ctx.out_fd = fd;
+    check_ctx.tier = tier;
+
+    printf("pass %s%s%s (cpu features 0x%x)\n", features,
+            tier ? ", accuracy " : "", tier ? tier : "",
+            (unsigned)core_cpu_get_features());
+    for (size_t c = 0; c < CHECK_N; c++) {
+        if ((tier != NULL) != checks[c].per_tier)
+            continue;
+        if (!checkSelected(checks[c].name, argc, argv))
+            continue;
+
+        const long failures = check_ctx.failures;
+        const long results = check_ctx.results;
+        check_ctx.check = checks[c].name;
+        check_ctx.seed = 0x2545F491u;
+        checks[c].run();
+        checkGraphUnfold();
+        if (check_ctx.network)
+            ai_network_destroy(check_ctx.network);
+        check_ctx.network = AI_HANDLE_NULL;
+        printf("  %-14s %s (%ld results)\n", checks[c].name,
+                (check_ctx.failures == failures) ? "ok" : "FAILED",
+                check_ctx.results - results);
+    }
+    fflush(stdout);
+    return (check_ctx.failures > 0) ? 1 : 0;
+}
+
+/* parent: runs a pass in a child process, collects its records */
+static int checkRunPass(const char *features, const char *tier,
+        struct check_results *res, int argc, char *argv[])
+{
+    int fds[2];
+    int status = 0;
+    pid_t pid;
+    size_t cap = 1 << 16;
+
+    res->data = NULL;
+    res->size = 0;
+    fflush(stdout);
+    if (pipe(fds)) {
+        perror("E: pipe");
+        return -1;
+    }
+    pid = fork();
+    if (pid < 0) {
+        perror("E: fork");
+        return -1;
+    }
+    if (pid == 0) {
+        close(fds[0]);
+        _exit(checkPass(features, tier, fds[1], argc, argv));
+    }
+    close(fds[1]);
+
+    res->data = malloc(cap);
+    for (;;) {
+        if (res->size == cap) {
+            cap *= 2;
+            res->data = realloc(res->data, cap);
+        }
+        ssize_t n = read(fds[0], res->data + res->size, cap - res->size);
+        if (n <= 0)
+            break;
+        res->size += (size_t)n;
+    }
+    close(fds[0]);
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || (WEXITSTATUS(status) > 1)) {
+        printf("  pass %s aborted (status 0x%x)\n", features, status);
+        return -1;
+    }
+    return WEXITSTATUS(status);
+}
+
+/* SIMD pass results against the generic ones, record by record */
+static long checkComparePasses(const char *features,
+        const struct check_results *simd, const struct check_results *ref)
+{
+    size_t o = 0;
+    long mismatches = 0;
+    long n_records = 0;
+
+    if (simd->size != ref->size) {
+        printf("  %s: results layout differs from the generic pass\n",
+                features);
+        return 1;
+    }
+    while (o < ref->size) {
+        const struct check_record *r = (const void *)(ref->data + o);
+        const struct check_record *s = (const void *)(simd->data + o);
+        const double *rv = (const double *)(r + 1);
+        const double *sv = (const double *)(s + 1);
+        size_t bad = 0, first = 0;
+
+        if (strcmp(r->what, s->what) || (r->n != s->n)) {
+            printf("  %s: results layout differs from the generic pass\n",
+                    features);
+            return mismatches + 1;
+        }
+        for (uint32_t i = 0; i < r->n; i++) {
+            if (!checkMatch(sv[i], rv[i], r->tol, r->is_int) && !bad++)
+                first = i;
+        }
+        if (bad && (mismatches++ < CHECK_MAX_REPORTS * 8))
+            printf("    FAIL %s vs none: %s: %zu/%u results differ, [%zu] "
+                    "%.9g instead of %.9g\n", features, r->what, bad,
+                    (unsigned)r->n, first, sv[first], rv[first]);
+        n_records++;
+        o += sizeof(*r) + r->n * sizeof(double);
+    }
+    printf("  %s vs none: %ld results, %s\n", features, n_records,
+            mismatches ? "MISMATCHES" : "same as the generic kernels");
+    return mismatches;
+}
+
+static void checkUsage(const char *prog)
+{
+    printf("usage: %s [-v] [-l] [check ...]\n", prog);
+    printf("  -v  report every result\n");
+    printf("  -l  list the checks\n");
+}
+
+int main(int argc, char *argv[])
+{
+    struct check_results res[CHECK_N_FEATURES];
+    long failures = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "vlh")) != -1) {
+        switch (opt) {
+        case 'v': check_ctx.verbose = true; break;
+        case 'l':
+            for (size_t c = 0; c < CHECK_N; c++)
+                printf("%s%s\n", checks[c].name,
+                        checks[c].per_tier ? " (per accuracy tier)" : "");
+            return 0;
+        default:
+            checkUsage(argv[0]);
+            return (opt == 'h') ? 0 : 1;
+        }
+    }
+    argc -= optind;
+    argv += optind;
+    for (int i = 0; i < argc; i++) {
+        size_t c = 0;
+        while ((c < CHECK_N) && strcmp(checks[c].name, argv[i]))
+            c++;
+        if (c == CHECK_N) {
+            fprintf(stderr, "E: no check \"%s\" (-l lists them)\n", argv[i]);
+            return 1;
+        }
+    }
+
+    printf("# %s\n", _CHECK_NAME_);
+
+    for (size_t t = 0; t < CHECK_N_TIERS; t++) {
+        bool any = false;
+        for (size_t c = 0; c < CHECK_N; c++) {
+            if (((check_tiers[t] != NULL) == checks[c].per_tier) &&
+                    checkSelected(checks[c].name, argc, argv))
+                any = true;
+        }
+        if (!any)
+            continue;
+
+        for (size_t f = 0; f < CHECK_N_FEATURES; f++) {
+            const int r = checkRunPass(check_features[f], check_tiers[t],
+                    &res[f], argc, argv);
+            if (r < 0) {
+                res[f].size = 0;
+                failures++;
+                continue;
+            }
+            failures += r;
+            if (f > 0)
+                failures += checkComparePasses(check_features[f], &res[f],
+                        &res[0]);
+        }
+        for (size_t f = 0; f < CHECK_N_FEATURES; f++)
+            free(res[f].data);
+    }
+
+    printf("%s\n", failures ? "FAILURES" : "All checks passed");
+    return failures ? 1 : 0;
+}
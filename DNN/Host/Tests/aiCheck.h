@@ -0,0 +1,120 @@
+/**
+  ******************************************************************************
+  * @file    aiCheck.h
+  * @brief   Host checks of the runtime kernels
+  ******************************************************************************
+  * @attention
+  *
+  * A check computes the outputs of a kernel (or of a layer forward) on
+  * pseudo random data and compares them with a naive reference computed in
+  * the check itself. aiCheck runs every check once per cpu features setting
+  * (AI_CPU_FEATURES) and compares the outputs of the SIMD passes with the
+  * ones of the generic pass.
+  *
+  ******************************************************************************
+  */
+
+#ifndef __AI_CHECK_H_
+#define __AI_CHECK_H_
+
+/* System headers */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/* AI header files */
+#include "ai_platform_interface.h"
+#include "layers_common.h"
+
+/* a check: named, run with AI_MATH_ACCURACY unset or once per tier */
+struct check_entry {
+    const char *name;
+    bool per_tier;          /* run once per AI_MATH_ACCURACY tier */
+    void (*run)(void);
+};
+
+/* the checks, one function per kernels family */
+void checkDense(void);
+void checkConv(void);
+void checkConvNlPool(void);
+void checkConvDwPw(void);
+void checkPool(void);
+void checkMath(void);
+void checkSoftmax(void);
+void checkTflite(void);
+void checkPlan(void);
+void checkBatch(void);
+void checkMnetwork(void);
+
+/* AI_MATH_ACCURACY of the running pass, NULL for the default tier */
+const char *checkTier(void);
+
+/* pseudo random values, the same sequence in every pass of a check */
+float checkRand(void);                    /* uniform in [-1, 1) */
+int32_t checkRandInt(int32_t lo, int32_t hi);   /* uniform in [lo, hi] */
+
+/*
+ * Results of a check, compared with the reference and recorded for the
+ * comparison of the passes: |out - ref| <= tol * max(1, |ref|) for the
+ * floats, |out - ref| <= tol for the integers (NaN matches NaN).
+ */
+void checkFloats(const char *what, const ai_float *out, const ai_float *ref,
+        size_t n, double tol);
+void checkInts(const char *what, const int32_t *out, const int32_t *ref,
+        size_t n, int32_t tol);
+void checkS8(const char *what, const ai_i8 *out, const ai_i8 *ref,
+        size_t n, int32_t tol);
+void checkU8(const char *what, const ai_u8 *out, const ai_u8 *ref,
+        size_t n, int32_t tol);
+
+/* fill with checkRand() values */
+void checkFill(ai_float *data, size_t n);
+
+/* a property of the results: value <= bound (reported, not recorded) */
+void checkBound(const char *what, double value, double bound);
+void checkTrue(const char *what, bool cond);
+
+/* a tensor of a layer under check, with its own shape and stride */
+struct check_tensor {
+    ai_array array;
+    ai_tensor tensor;
+    ai_shape_dimension shape[AI_SHAPE_MAX_DIMENSION];
+    ai_stride_dimension stride[AI_SHAPE_MAX_DIMENSION];
+};
+
+void checkTensorInit(struct check_tensor *t, ai_array_format fmt,
+        void *data, size_t size, ai_i32 in_ch, ai_i32 ch, ai_i32 w, ai_i32 h,
+        ai_intq_info_list *intq);
+
+/* a 2D convolution: in_h x in_w x in_ch inputs, out_ch filters */
+struct check_conv {
+    ai_i32 in_h, in_w, in_ch, out_ch;
+    ai_i32 k_h, k_w, stride, pad, dil, groups;
+    ai_i32 n_batches;
+};
+
+/* outputs along an axis */
+ai_i32 checkConvOut(ai_i32 in, ai_i32 k, ai_i32 stride, ai_i32 pad,
+        ai_i32 dil);
+
+/* one sample, double accumulation, weights [out_ch][k_h][k_w][k_ch] */
+void checkConvRef(ai_float *out, const ai_float *in, const ai_float *w,
+        const ai_float *b, const struct check_conv *c, bool relu);
+
+/*
+ * Network instance hosting the layers of a check (scratch buffers, graph
+ * state): created on first use, destroyed after the check.
+ */
+ai_network *checkNetwork(void);
+
+/* fold/fuse the layers chain starting at first as done at network init */
+ai_u32 checkGraphFold(ai_layer *first);
+
+/*
+ * restore the layers folded by checkGraphFold and release the weights
+ * prepared for the layers (a check calls it before its layer goes out of
+ * scope: a later layer at the same address is prepared again)
+ */
+void checkGraphUnfold(void);
+
+#endif /* __AI_CHECK_H_ */
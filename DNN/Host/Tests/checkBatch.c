@@ -0,0 +1,234 @@
+/**
+  ******************************************************************************
+  * @file    checkBatch.c
+  * @brief   Checks of the batched runs of the generated networks
+  ******************************************************************************
+  * @attention
+  *
+  * Each generated network is run on n samples at once, n within the first
+  * chunk of AI_NETWORK_N_BATCHES samples, on the chunk boundaries and up to
+  * the end of the ai_u16 range (the last chunks of 65535 samples), and its
+  * outputs compared with the ones of the same samples run one at a time:
+  * they are identical and nothing is written after the n-th output.
+  *
+  * The same samples are run on buffers bound once (ai_mnetwork_bind_io):
+  * each ai_mnetwork_run_bound reads the inputs written in place since the
+  * previous run. A regular run drops the binding.
+  *
+  ******************************************************************************
+  */
+
+/* System headers */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+/* AI header files */
+#include "app_x-cube-ai.h"
+
+#include "aiCheck.h"
+
+/* samples of the largest run */
+#define BATCH_N_SAMPLES     (65535)
+
+/* bytes after the outputs of a run, left untouched */
+#define BATCH_CANARY        (64)
+#define BATCH_CANARY_BYTE   (0x5A)
+
+/* samples of the runs: one chunk, around the chunk boundaries, across many
+ * chunks and up to the ai_u16 limit (65472 = 1023 chunks of 64) */
+static const ai_u16 batch_counts[] = {
+    1, 2, AI_NETWORK_N_BATCHES - 1, AI_NETWORK_N_BATCHES,
+    AI_NETWORK_N_BATCHES + 1, 2 * AI_NETWORK_N_BATCHES - 1,
+    2 * AI_NETWORK_N_BATCHES + 1, 1000, 65472, 65473, BATCH_N_SAMPLES,
+};
+
+#define BATCH_N_COUNTS      (sizeof(batch_counts) / sizeof(batch_counts[0]))
+
+/* an instance of a network with its I/O */
+struct batch_net {
+    const char *name;
+    ai_handle net;
+    void *activations;
+    ai_buffer input;                /* one sample */
+    ai_buffer output;
+    size_t in_size;                 /* bytes of a sample */
+    size_t out_size;
+    ai_u8 *in;                      /* BATCH_N_SAMPLES samples */
+    ai_u8 *ref;                     /* outputs of the runs of one sample */
+    ai_u8 *bound;                   /* bound inputs */
+    ai_u8 *out;                     /* outputs of a run, then the canary */
+};
+
+/* -------------------------------------------------------------------------- */
+static bool batchOpen(struct batch_net *b, const char *name)
+{
+    ai_network_report report;
+    ai_u32 act_addr, act_size;
+    ai_error err;
+
+    memset(b, 0, sizeof(*b));
+    b->name = name;
+    err = ai_mnetwork_create(name, &b->net, NULL);
+    if (err.type != AI_ERROR_NONE) {
+        b->net = AI_HANDLE_NULL;
+        return false;
+    }
+    if (ai_mnetwork_get_ext_data_activations(b->net, &act_addr, &act_size))
+        return false;
+    b->activations = aligned_alloc(64, (act_size + 64) & ~63u);
+    ai_network_params params = {
+            AI_BUFFER_OBJ_INIT(AI_BUFFER_FORMAT_NONE|AI_BUFFER_FMT_FLAG_CONST,
+                    0, 0, 0, 0, NULL),
+            AI_BUFFER_OBJ_INIT(AI_BUFFER_FORMAT_NONE|AI_BUFFER_FMT_FLAG_CONST,
+                    0, 0, 0, 0, AI_HANDLE_PTR(b->activations)) };
+    if (!b->activations || !ai_mnetwork_init(b->net, &params) ||
+            !ai_mnetwork_get_info(b->net, &report) ||
+            (report.n_inputs != 1) || (report.n_outputs != 1))
+        return false;
+
+    b->input = report.inputs[0];
+    b->output = report.outputs[0];
+    b->in_size = AI_BUFFER_BYTE_SIZE(AI_BUFFER_SIZE(&b->input),
+            b->input.format);
+    b->out_size = AI_BUFFER_BYTE_SIZE(AI_BUFFER_SIZE(&b->output),
+            b->output.format);
+    b->in = malloc(b->in_size * BATCH_N_SAMPLES);
+    b->ref = malloc(b->out_size * BATCH_N_SAMPLES);
+    b->out = malloc(b->out_size * BATCH_N_SAMPLES + BATCH_CANARY);
+    b->bound = malloc(b->in_size * BATCH_N_SAMPLES);
+    return b->in && b->ref && b->out && b->bound;
+}
+
+static void batchClose(struct batch_net *b)
+{
+    if (b->net)
+        checkTrue("destroy", ai_mnetwork_destroy(b->net) == AI_HANDLE_NULL);
+    free(b->activations);
+    free(b->in);
+    free(b->ref);
+    free(b->out);
+    free(b->bound);
+}
+
+/* n samples from the first one of in to out */
+static bool batchRun(struct batch_net *b, const ai_u8 *in, ai_u8 *out,
+        ai_u16 n)
+{
+    ai_buffer input = b->input;
+    ai_buffer output = b->output;
+
+    input.n_batches = n;
+    output.n_batches = n;
+    input.data = AI_HANDLE_PTR(in);
+    output.data = AI_HANDLE_PTR(out);
+    return (ai_mnetwork_run(b->net, &input, &output) == (ai_i32)n);
+}
+
+/* random samples: floats in [-1, 1), integers on the whole range */
+static void batchFill(struct batch_net *b)
+{
+    const size_t n = b->in_size * BATCH_N_SAMPLES;
+
+    if (AI_BUFFER_FMT_GET_FLOAT(b->input.format)) {
+        checkFill((ai_float *)b->in, n / sizeof(ai_float));
+        return;
+    }
+    for (size_t i = 0; i < n; i++)
+        b->in[i] = (ai_u8)checkRandInt(0, 255);
+}
+
+/* the outputs of n samples from the first one against the reference, the
+ * canary untouched */
+static void batchCompare(struct batch_net *b, const char *what, ai_u32 first,
+        ai_u16 n)
+{
+    const ai_u8 *ref = b->ref + b->out_size * first;
+    const ai_u8 *canary = b->out + b->out_size * n;
+    bool untouched = true;
+
+    if (AI_BUFFER_FMT_GET_FLOAT(b->output.format))
+        checkFloats(what, (const ai_float *)b->out, (const ai_float *)ref,
+                b->out_size * n / sizeof(ai_float), 0);
+    else
+        checkU8(what, b->out, ref, b->out_size * n, 0);
+    for (int i = 0; i < BATCH_CANARY; i++)
+        untouched &= (canary[i] == BATCH_CANARY_BYTE);
+    checkTrue("written after the outputs", untouched);
+}
+
+/* -------------------------------------------------------------------------- */
+/* the batched runs */
+static void batchCheckNetwork(struct batch_net *b)
+{
+    char what[64];
+    bool ok = true;
+
+    batchFill(b);
+    for (ai_u32 i = 0; (i < BATCH_N_SAMPLES) && ok; i++)
+        ok = batchRun(b, b->in + b->in_size * i, b->ref + b->out_size * i, 1);
+    checkTrue("run of one sample", ok);
+    if (!ok)
+        return;
+
+    for (size_t c = 0; c < BATCH_N_COUNTS; c++) {
+        const ai_u16 n = batch_counts[c];
+
+        memset(b->out, BATCH_CANARY_BYTE, b->out_size * n + BATCH_CANARY);
+        snprintf(what, sizeof(what), "%s run of %u samples", b->name,
+                (unsigned)n);
+        checkTrue(what, batchRun(b, b->in, b->out, n));
+        batchCompare(b, what, 0, n);
+    }
+}
+
+/* bind once, run many: the first samples then the last ones written in
+ * place in the bound inputs */
+static void batchCheckBound(struct batch_net *b)
+{
+    ai_buffer input = b->input;
+    ai_buffer output = b->output;
+    char what[64];
+
+    for (size_t c = 0; c < BATCH_N_COUNTS; c++) {
+        const ai_u16 n = batch_counts[c];
+
+        memset(b->out, BATCH_CANARY_BYTE, b->out_size * n + BATCH_CANARY);
+        snprintf(what, sizeof(what), "%s bound run of %u samples", b->name,
+                (unsigned)n);
+        input.n_batches = n;
+        output.n_batches = n;
+        input.data = AI_HANDLE_PTR(b->bound);
+        output.data = AI_HANDLE_PTR(b->out);
+        checkTrue(what, ai_mnetwork_bind_io(b->net, &input, &output) ==
+                (ai_i32)n);
+        for (int r = 0; r < 2; r++) {
+            const ai_u32 first = r ? (ai_u32)(BATCH_N_SAMPLES - n) : 0;
+
+            memcpy(b->bound, b->in + b->in_size * first, b->in_size * n);
+            checkTrue(what, ai_mnetwork_run_bound(b->net) == (ai_i32)n);
+            batchCompare(b, what, first, n);
+        }
+    }
+
+    checkTrue("run", batchRun(b, b->in, b->out, 1));
+    checkTrue("bound run after a run", ai_mnetwork_run_bound(b->net) <= 0);
+}
+
+void checkBatch(void)
+{
+    struct batch_net b;
+    const char *name;
+
+    for (int i = 0; (name = ai_mnetwork_find(NULL, i)) != NULL; i++) {
+        const bool ready = batchOpen(&b, name);
+        checkTrue("instance", ready);
+        if (ready) {
+            batchCheckNetwork(&b);
+            batchCheckBound(&b);
+        }
+        batchClose(&b);
+    }
+}
@@ -0,0 +1,327 @@
+/**
+  ******************************************************************************
+  * @file    checkConv.c
+  * @brief   Checks of the 2D convolution layers
+  ******************************************************************************
+  * @attention
+  *
+  * forward_conv2d on geometries selecting each algorithm (direct, im2col,
+  * Winograd, depthwise, pointwise), against a direct double accumulation.
+  * The layers are called twice, the second call running on the weights
+  * prepared by the first one, then once with other weights. The int8 layers
+  * (per tensor and per channel weights scales) must match the reference
+  * exactly.
+  *
+  ******************************************************************************
+  */
+
+/* System headers */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+/* AI header files */
+#include "layers_conv2d.h"
+#include "layers_nl.h"
+#include "ai_math_helpers.h"
+
+#include "aiCheck.h"
+
+/* a convolution and the algorithm selected for its float variant */
+struct conv_case {
+    struct check_conv g;
+    ai_conv2d_algo algo;
+};
+
+static const struct conv_case conv_cases[] = {
+    /*  h   w  ich och kh kw  s  p  d  g  b   algo */
+    { {  9,  7,  3,  4, 3, 3, 1, 1, 1, 1, 2 }, AI_CONV2D_ALGO_DIRECT },
+    { { 11, 10,  5,  3, 3, 3, 1, 2, 2, 1, 1 }, AI_CONV2D_ALGO_DIRECT },
+    { {  8,  9,  6,  8, 3, 3, 1, 1, 1, 2, 2 }, AI_CONV2D_ALGO_DIRECT },
+    { {  9,  7,  5, 16, 3, 3, 2, 1, 1, 1, 2 }, AI_CONV2D_ALGO_IM2COL },
+    { { 12, 13,  7, 19, 5, 3, 1, 2, 1, 1, 1 }, AI_CONV2D_ALGO_IM2COL },
+    { { 10, 10, 16, 33, 3, 3, 1, 1, 2, 1, 1 }, AI_CONV2D_ALGO_IM2COL },
+    { { 40, 40,  3, 24, 3, 3, 1, 1, 1, 1, 1 }, AI_CONV2D_ALGO_IM2COL },
+    { { 24, 22,  8, 12, 3, 3, 1, 1, 1, 1, 2 }, AI_CONV2D_ALGO_WINOGRAD },
+    { { 23, 25, 17,  9, 3, 3, 1, 1, 1, 1, 1 }, AI_CONV2D_ALGO_WINOGRAD },
+    { { 26, 26, 10, 20, 3, 3, 1, 0, 1, 1, 1 }, AI_CONV2D_ALGO_WINOGRAD },
+    { { 10, 10, 17, 17, 3, 3, 2, 1, 1, 17, 2 }, AI_CONV2D_ALGO_DEPTHWISE },
+    { {  8,  9, 24, 24, 5, 5, 1, 2, 1, 24, 1 }, AI_CONV2D_ALGO_DEPTHWISE },
+    { {  9,  9, 35, 35, 3, 3, 1, 1, 2, 35, 1 }, AI_CONV2D_ALGO_DEPTHWISE },
+    { {  7,  7, 13, 40, 1, 1, 1, 0, 1, 1, 2 }, AI_CONV2D_ALGO_POINTWISE },
+    { {  6,  5, 64, 17, 1, 1, 1, 0, 1, 1, 1 }, AI_CONV2D_ALGO_POINTWISE },
+};
+
+#define CONV_N_CASES    (sizeof(conv_cases) / sizeof(conv_cases[0]))
+
+/* float results: sums of up to a few hundred products of [-1, 1) values */
+#define CONV_TOL_F32        (1e-4)
+/* the Winograd transforms add a few roundings per output */
+#define CONV_TOL_WINOGRAD   (5e-4)
+
+/* -------------------------------------------------------------------------- */
+ai_i32 checkConvOut(ai_i32 in, ai_i32 k, ai_i32 stride, ai_i32 pad,
+        ai_i32 dil)
+{
+    return (in + 2 * pad - dil * (k - 1) - 1) / stride + 1;
+}
+
+void checkConvRef(ai_float *out, const ai_float *in, const ai_float *w,
+        const ai_float *b, const struct check_conv *c, bool relu)
+{
+    const ai_i32 out_h = checkConvOut(c->in_h, c->k_h, c->stride, c->pad,
+            c->dil);
+    const ai_i32 out_w = checkConvOut(c->in_w, c->k_w, c->stride, c->pad,
+            c->dil);
+    const ai_i32 k_ch = c->in_ch / c->groups;
+    const ai_i32 per_group = c->out_ch / c->groups;
+
+    for (ai_i32 oy = 0; oy < out_h; oy++) {
+        for (ai_i32 ox = 0; ox < out_w; ox++) {
+            for (ai_i32 o = 0; o < c->out_ch; o++) {
+                const ai_i32 c0 = (o / per_group) * k_ch;
+                double acc = b ? b[o] : 0.0;
+                for (ai_i32 ky = 0; ky < c->k_h; ky++) {
+                    const ai_i32 y = oy * c->stride - c->pad + ky * c->dil;
+                    if ((y < 0) || (y >= c->in_h))
+                        continue;
+                    for (ai_i32 kx = 0; kx < c->k_w; kx++) {
+                        const ai_i32 x = ox * c->stride - c->pad + kx * c->dil;
+                        if ((x < 0) || (x >= c->in_w))
+                            continue;
+                        const ai_float *p = in + ((size_t)y * c->in_w + x) *
+                                c->in_ch + c0;
+                        const ai_float *q = w + (((size_t)o * c->k_h + ky) *
+                                c->k_w + kx) * k_ch;
+                        for (ai_i32 i = 0; i < k_ch; i++)
+                            acc += (double)p[i] * q[i];
+                    }
+                }
+                if (relu && (acc < 0.0))
+                    acc = 0.0;
+                *out++ = (ai_float)acc;
+            }
+        }
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+static void convCheckF32(const struct conv_case *cc, bool relu)
+{
+    const struct check_conv *c = &cc->g;
+    const ai_i32 out_h = checkConvOut(c->in_h, c->k_h, c->stride, c->pad,
+            c->dil);
+    const ai_i32 out_w = checkConvOut(c->in_w, c->k_w, c->stride, c->pad,
+            c->dil);
+    const ai_i32 k_ch = c->in_ch / c->groups;
+    const size_t in_size = (size_t)c->in_h * c->in_w * c->in_ch;
+    const size_t out_size = (size_t)out_h * out_w * c->out_ch;
+    const size_t w_size = (size_t)c->out_ch * c->k_h * c->k_w * k_ch;
+    const double tol = (cc->algo == AI_CONV2D_ALGO_WINOGRAD) ?
+            CONV_TOL_WINOGRAD : CONV_TOL_F32;
+
+    ai_float *in = malloc(c->n_batches * in_size * sizeof(ai_float));
+    ai_float *w = malloc(2 * w_size * sizeof(ai_float));
+    ai_float *b = malloc(2 * c->out_ch * sizeof(ai_float));
+    ai_float *out = malloc(c->n_batches * out_size * sizeof(ai_float));
+    ai_float *ref = malloc(c->n_batches * out_size * sizeof(ai_float));
+    struct check_tensor t_in, t_out, t_w, t_b;
+    ai_layer_conv2d l = { 0 };
+    char what[64];
+
+    checkFill(in, c->n_batches * in_size);
+    checkFill(w, 2 * w_size);
+    checkFill(b, 2 * c->out_ch);
+
+    checkTensorInit(&t_in, AI_ARRAY_FORMAT_FLOAT, in,
+            c->n_batches * in_size, 1, c->in_ch, c->in_w, c->in_h, NULL);
+    checkTensorInit(&t_out, AI_ARRAY_FORMAT_FLOAT, out,
+            c->n_batches * out_size, 1, c->out_ch, out_w, out_h, NULL);
+    checkTensorInit(&t_w, AI_ARRAY_FORMAT_FLOAT, w, w_size,
+            k_ch, c->k_w, c->k_h, c->out_ch, NULL);
+    checkTensorInit(&t_b, AI_ARRAY_FORMAT_FLOAT, b, c->out_ch,
+            1, c->out_ch, 1, 1, NULL);
+    ai_tensor_chain chain = AI_TENSOR_CHAIN_OBJ_INIT(AI_FLAG_NONE, 4,
+            AI_TENSOR_LIST_OBJ_INIT(AI_FLAG_NONE, 1, &t_in.tensor),
+            AI_TENSOR_LIST_OBJ_INIT(AI_FLAG_NONE, 1, &t_out.tensor),
+            AI_TENSOR_LIST_OBJ_INIT(AI_FLAG_NONE, 2, &t_w.tensor, &t_b.tensor),
+            AI_TENSOR_LIST_OBJ_EMPTY);
+
+    l.network = checkNetwork();
+    l.tensors = &chain;
+    l.groups = c->groups;
+    l.nl_func = relu ? nl_func_relu_array_f32 : NULL;
+    l.filter_stride = (ai_shape_2d)AI_SHAPE_2D_INIT(c->stride, c->stride);
+    l.dilation = (ai_shape_2d)AI_SHAPE_2D_INIT(c->dil, c->dil);
+    l.filter_pad = (ai_shape)AI_SHAPE_INIT(4, c->pad, c->pad, c->pad, c->pad);
+
+    snprintf(what, sizeof(what), "f32 %dx%dx%d->%d k%dx%d s%d p%d d%d g%d%s",
+            (int)c->in_h, (int)c->in_w, (int)c->in_ch, (int)c->out_ch,
+            (int)c->k_h, (int)c->k_w, (int)c->stride, (int)c->pad,
+            (int)c->dil, (int)c->groups, relu ? " relu" : "");
+    checkTrue(what, conv2d_algo_select(&l) == cc->algo);
+
+    for (ai_i32 n = 0; n < c->n_batches; n++)
+        checkConvRef(ref + n * out_size, in + n * in_size, w, b, c, relu);
+
+    /* first call prepares the weights, the second one reuses them */
+    for (int call = 0; call < 2; call++) {
+        memset(out, 0, c->n_batches * out_size * sizeof(ai_float));
+        forward_conv2d((ai_layer *)&l);
+        checkFloats(what, out, ref, c->n_batches * out_size, tol);
+    }
+
+    /* other weights: prepared again */
+    t_w.array.data = t_w.array.data_start = AI_PTR(w + w_size);
+    t_b.array.data = t_b.array.data_start = AI_PTR(b + c->out_ch);
+    for (ai_i32 n = 0; n < c->n_batches; n++)
+        checkConvRef(ref + n * out_size, in + n * in_size, w + w_size,
+                b + c->out_ch, c, relu);
+    forward_conv2d((ai_layer *)&l);
+    checkFloats(what, out, ref, c->n_batches * out_size, tol);
+
+    /* the layer goes out of scope: its prepared weights are released */
+    checkGraphUnfold();
+
+    free(in);
+    free(w);
+    free(b);
+    free(out);
+    free(ref);
+}
+
+/* -------------------------------------------------------------------------- */
+static void convCheckS8(const struct check_conv *c, bool per_channel)
+{
+    const ai_i32 out_h = checkConvOut(c->in_h, c->k_h, c->stride, c->pad,
+            c->dil);
+    const ai_i32 out_w = checkConvOut(c->in_w, c->k_w, c->stride, c->pad,
+            c->dil);
+    const ai_i32 k_ch = c->in_ch / c->groups;
+    const ai_i32 per_group = c->out_ch / c->groups;
+    const size_t in_size = (size_t)c->in_h * c->in_w * c->in_ch;
+    const size_t out_size = (size_t)out_h * out_w * c->out_ch;
+    const size_t w_size = (size_t)c->out_ch * c->k_h * c->k_w * k_ch;
+
+    ai_i8 *in = malloc(c->n_batches * in_size);
+    ai_i8 *w = malloc(w_size);
+    ai_i32 *b = malloc(c->out_ch * sizeof(ai_i32));
+    ai_i8 *out = malloc(c->n_batches * out_size);
+    ai_i8 *ref = malloc(c->n_batches * out_size);
+    ai_float *s_w = malloc(c->out_ch * sizeof(ai_float));
+    ai_i8 *zp_w = calloc(c->out_ch, 1);
+    ai_float s_in = 0.05f, s_out = 0.9f;
+    ai_i8 zp_in = -3, zp_out = 5;
+    struct check_tensor t_in, t_out, t_w, t_b;
+    ai_layer_conv2d l = { 0 };
+    char what[64];
+
+    for (size_t i = 0; i < c->n_batches * in_size; i++)
+        in[i] = (ai_i8)checkRandInt(-128, 127);
+    for (size_t i = 0; i < w_size; i++)
+        w[i] = (ai_i8)checkRandInt(-127, 127);
+    for (ai_i32 o = 0; o < c->out_ch; o++) {
+        b[o] = checkRandInt(-1000, 1000);
+        s_w[o] = 0.002f * (1 + o % 7);
+    }
+
+    ai_intq_info q_in_info = { &s_in, &zp_in };
+    ai_intq_info q_out_info = { &s_out, &zp_out };
+    ai_intq_info q_w_info = { s_w, zp_w };
+    ai_intq_info_list q_in = { AI_BUFFER_META_FLAG_SCALE_FLOAT |
+            AI_BUFFER_META_FLAG_ZEROPOINT_S8, 1, &q_in_info };
+    ai_intq_info_list q_out = { AI_BUFFER_META_FLAG_SCALE_FLOAT |
+            AI_BUFFER_META_FLAG_ZEROPOINT_S8, 1, &q_out_info };
+    ai_intq_info_list q_w = { AI_BUFFER_META_FLAG_SCALE_FLOAT |
+            AI_BUFFER_META_FLAG_ZEROPOINT_S8,
+            (ai_u16)(per_channel ? c->out_ch : 1), &q_w_info };
+
+    checkTensorInit(&t_in, AI_ARRAY_FORMAT_S8, in, c->n_batches * in_size,
+            1, c->in_ch, c->in_w, c->in_h, &q_in);
+    checkTensorInit(&t_out, AI_ARRAY_FORMAT_S8, out,
+            c->n_batches * out_size, 1, c->out_ch, out_w, out_h, &q_out);
+    checkTensorInit(&t_w, AI_ARRAY_FORMAT_S8, w, w_size,
+            k_ch, c->k_w, c->k_h, c->out_ch, &q_w);
+    checkTensorInit(&t_b, AI_ARRAY_FORMAT_S32, b, c->out_ch,
+            1, c->out_ch, 1, 1, NULL);
+    ai_tensor_chain chain = AI_TENSOR_CHAIN_OBJ_INIT(AI_FLAG_NONE, 4,
+            AI_TENSOR_LIST_OBJ_INIT(AI_FLAG_NONE, 1, &t_in.tensor),
+            AI_TENSOR_LIST_OBJ_INIT(AI_FLAG_NONE, 1, &t_out.tensor),
+            AI_TENSOR_LIST_OBJ_INIT(AI_FLAG_NONE, 2, &t_w.tensor, &t_b.tensor),
+            AI_TENSOR_LIST_OBJ_EMPTY);
+
+    l.network = checkNetwork();
+    l.tensors = &chain;
+    l.groups = c->groups;
+    l.filter_stride = (ai_shape_2d)AI_SHAPE_2D_INIT(c->stride, c->stride);
+    l.dilation = (ai_shape_2d)AI_SHAPE_2D_INIT(c->dil, c->dil);
+    l.filter_pad = (ai_shape)AI_SHAPE_INIT(4, c->pad, c->pad, c->pad, c->pad);
+
+    for (ai_i32 n = 0; n < c->n_batches; n++) {
+        const ai_i8 *in_n = in + n * in_size;
+        ai_i8 *r = ref + n * out_size;
+        for (ai_i32 oy = 0; oy < out_h; oy++) {
+            for (ai_i32 ox = 0; ox < out_w; ox++) {
+                for (ai_i32 o = 0; o < c->out_ch; o++) {
+                    const ai_i32 c0 = (o / per_group) * k_ch;
+                    ai_i32 acc = b[o];
+                    for (ai_i32 ky = 0; ky < c->k_h; ky++) {
+                        for (ai_i32 kx = 0; kx < c->k_w; kx++) {
+                            const ai_i32 y = oy * c->stride - c->pad +
+                                    ky * c->dil;
+                            const ai_i32 x = ox * c->stride - c->pad +
+                                    kx * c->dil;
+                            if ((y < 0) || (y >= c->in_h) || (x < 0) ||
+                                    (x >= c->in_w))
+                                continue;
+                            for (ai_i32 i = 0; i < k_ch; i++)
+                                acc += (in_n[((size_t)y * c->in_w + x) *
+                                        c->in_ch + c0 + i] - zp_in) *
+                                        w[(((size_t)o * c->k_h + ky) *
+                                        c->k_w + kx) * k_ch + i];
+                        }
+                    }
+                    *r++ = AI_MATH_REQUANTIZE_S8(acc,
+                            (s_in / s_out) * s_w[per_channel ? o : 0],
+                            zp_out);
+                }
+            }
+        }
+    }
+
+    snprintf(what, sizeof(what), "s8%s %dx%dx%d->%d k%dx%d s%d p%d d%d g%d",
+            per_channel ? " ch" : "", (int)c->in_h, (int)c->in_w,
+            (int)c->in_ch, (int)c->out_ch, (int)c->k_h, (int)c->k_w,
+            (int)c->stride, (int)c->pad, (int)c->dil, (int)c->groups);
+    if (per_channel)
+        forward_conv2d_integer_SSSA_ch((ai_layer *)&l);
+    else
+        forward_conv2d_integer_SSSA((ai_layer *)&l);
+    checkS8(what, out, ref, c->n_batches * out_size, 0);
+
+    /* the layer goes out of scope: its prepared weights are released */
+    checkGraphUnfold();
+
+    free(in);
+    free(w);
+    free(b);
+    free(out);
+    free(ref);
+    free(s_w);
+    free(zp_w);
+}
+
+/* -------------------------------------------------------------------------- */
+void checkConv(void)
+{
+    for (size_t i = 0; i < CONV_N_CASES; i++) {
+        convCheckF32(&conv_cases[i], false);
+        convCheckS8(&conv_cases[i].g, (i & 1) != 0);
+    }
+    /* nonlinearity applied by the layer on its outputs */
+    convCheckF32(&conv_cases[3], true);
+    convCheckF32(&conv_cases[7], true);
+    convCheckF32(&conv_cases[10], true);
+}
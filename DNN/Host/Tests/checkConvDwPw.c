@@ -0,0 +1,168 @@
+/**
+  ******************************************************************************
+  * @file    checkConvDwPw.c
+  * @brief   Checks of the fused depthwise -> pointwise convolutions
+  ******************************************************************************
+  * @attention
+  *
+  * A depthwise layer followed by a pointwise one (relu after each) is fused
+  * by the graph optimizations (checkGraphFold, as at network init) and run
+  * by forward_conv2d_dw_pw. Its outputs, and the ones of the two layers run
+  * one after the other, are compared with the reference convolutions.
+  *
+  ******************************************************************************
+  */
+
+/* System headers */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+/* AI header files */
+#include "layers_conv2d.h"
+#include "layers_nl.h"
+
+#include "aiCheck.h"
+
+/* depthwise h x w x ch, filter k x k, then pointwise to out_ch */
+struct dw_pw_case {
+    ai_i32 in_h, in_w, ch, k, stride, pad, out_ch, n_batches;
+};
+
+static const struct dw_pw_case dw_pw_cases[] = {
+    /*  h   w   ch  k  s  p  och  b */
+    {   9,  7,   5, 3, 1, 1,   6, 2 },
+    {  10, 10,  17, 3, 2, 1,   9, 1 },
+    {   8,  9,  24, 5, 1, 2,  32, 2 },
+    {  12, 12,  33, 3, 1, 1,   3, 1 },
+    {  30, 30,  32, 3, 1, 1,  64, 1 },
+    {  15, 17,  16, 3, 2, 0,  40, 1 },
+};
+
+#define DW_PW_N_CASES   (sizeof(dw_pw_cases) / sizeof(dw_pw_cases[0]))
+
+#define DW_PW_TOL       (1e-4)
+
+/* -------------------------------------------------------------------------- */
+static void dwPwCheck(const struct dw_pw_case *c)
+{
+    const struct check_conv g_dw = { c->in_h, c->in_w, c->ch, c->ch,
+            c->k, c->k, c->stride, c->pad, 1, c->ch, c->n_batches };
+    const ai_i32 mid_h = checkConvOut(c->in_h, c->k, c->stride, c->pad, 1);
+    const ai_i32 mid_w = checkConvOut(c->in_w, c->k, c->stride, c->pad, 1);
+    const struct check_conv g_pw = { mid_h, mid_w, c->ch, c->out_ch,
+            1, 1, 1, 0, 1, 1, c->n_batches };
+    const size_t in_size = (size_t)c->in_h * c->in_w * c->ch;
+    const size_t mid_size = (size_t)mid_h * mid_w * c->ch;
+    const size_t out_size = (size_t)mid_h * mid_w * c->out_ch;
+    const size_t n_out = c->n_batches * out_size;
+
+    ai_float *in = malloc(c->n_batches * in_size * sizeof(ai_float));
+    ai_float *w_dw = malloc((size_t)c->ch * c->k * c->k * sizeof(ai_float));
+    ai_float *b_dw = malloc(c->ch * sizeof(ai_float));
+    ai_float *w_pw = malloc((size_t)c->out_ch * c->ch * sizeof(ai_float));
+    ai_float *b_pw = malloc(c->out_ch * sizeof(ai_float));
+    ai_float *mid = malloc(c->n_batches * mid_size * sizeof(ai_float));
+    ai_float *mid_ref = malloc(mid_size * sizeof(ai_float));
+    ai_float *out = malloc(n_out * sizeof(ai_float));
+    ai_float *ref = malloc(n_out * sizeof(ai_float));
+    struct check_tensor t_in, t_mid, t_out, t_w_dw, t_b_dw, t_w_pw, t_b_pw;
+    ai_layer_conv2d dw = { 0 }, pw = { 0 };
+    char what[64];
+
+    checkFill(in, c->n_batches * in_size);
+    checkFill(w_dw, (size_t)c->ch * c->k * c->k);
+    checkFill(b_dw, c->ch);
+    checkFill(w_pw, (size_t)c->out_ch * c->ch);
+    checkFill(b_pw, c->out_ch);
+    for (ai_i32 n = 0; n < c->n_batches; n++) {
+        checkConvRef(mid_ref, in + n * in_size, w_dw, b_dw, &g_dw, true);
+        checkConvRef(ref + n * out_size, mid_ref, w_pw, b_pw, &g_pw, true);
+    }
+
+    checkTensorInit(&t_in, AI_ARRAY_FORMAT_FLOAT, in,
+            c->n_batches * in_size, 1, c->ch, c->in_w, c->in_h, NULL);
+    checkTensorInit(&t_mid, AI_ARRAY_FORMAT_FLOAT, mid,
+            c->n_batches * mid_size, 1, c->ch, mid_w, mid_h, NULL);
+    checkTensorInit(&t_out, AI_ARRAY_FORMAT_FLOAT, out, n_out,
+            1, c->out_ch, mid_w, mid_h, NULL);
+    checkTensorInit(&t_w_dw, AI_ARRAY_FORMAT_FLOAT, w_dw,
+            (size_t)c->ch * c->k * c->k, 1, c->k, c->k, c->ch, NULL);
+    checkTensorInit(&t_b_dw, AI_ARRAY_FORMAT_FLOAT, b_dw, c->ch,
+            1, c->ch, 1, 1, NULL);
+    checkTensorInit(&t_w_pw, AI_ARRAY_FORMAT_FLOAT, w_pw,
+            (size_t)c->out_ch * c->ch, c->ch, 1, 1, c->out_ch, NULL);
+    checkTensorInit(&t_b_pw, AI_ARRAY_FORMAT_FLOAT, b_pw, c->out_ch,
+            1, c->out_ch, 1, 1, NULL);
+    ai_tensor_chain chain_dw = AI_TENSOR_CHAIN_OBJ_INIT(AI_FLAG_NONE, 4,
+            AI_TENSOR_LIST_OBJ_INIT(AI_FLAG_NONE, 1, &t_in.tensor),
+            AI_TENSOR_LIST_OBJ_INIT(AI_FLAG_NONE, 1, &t_mid.tensor),
+            AI_TENSOR_LIST_OBJ_INIT(AI_FLAG_NONE, 2, &t_w_dw.tensor,
+                    &t_b_dw.tensor),
+            AI_TENSOR_LIST_OBJ_EMPTY);
+    ai_tensor_chain chain_pw = AI_TENSOR_CHAIN_OBJ_INIT(AI_FLAG_NONE, 4,
+            AI_TENSOR_LIST_OBJ_INIT(AI_FLAG_NONE, 1, &t_mid.tensor),
+            AI_TENSOR_LIST_OBJ_INIT(AI_FLAG_NONE, 1, &t_out.tensor),
+            AI_TENSOR_LIST_OBJ_INIT(AI_FLAG_NONE, 2, &t_w_pw.tensor,
+                    &t_b_pw.tensor),
+            AI_TENSOR_LIST_OBJ_EMPTY);
+
+    dw.type = AI_LAYER_CONV2D_TYPE;
+    dw.network = checkNetwork();
+    dw.next = (ai_node *)&pw;
+    dw.forward = AI_LAYER_FORWARD_FUNC(forward_conv2d);
+    dw.tensors = &chain_dw;
+    dw.groups = c->ch;
+    dw.nl_func = nl_func_relu_array_f32;
+    dw.filter_stride = (ai_shape_2d)AI_SHAPE_2D_INIT(c->stride, c->stride);
+    dw.dilation = (ai_shape_2d)AI_SHAPE_2D_INIT(1, 1);
+    dw.filter_pad = (ai_shape)AI_SHAPE_INIT(4, c->pad, c->pad, c->pad, c->pad);
+    pw = dw;
+    pw.next = (ai_node *)&pw;
+    pw.tensors = &chain_pw;
+    pw.groups = 1;
+    pw.filter_stride = (ai_shape_2d)AI_SHAPE_2D_INIT(1, 1);
+    pw.filter_pad = (ai_shape)AI_SHAPE_INIT(4, 0, 0, 0, 0);
+
+    snprintf(what, sizeof(what), "%dx%dx%d k%d s%d p%d ->%d",
+            (int)c->in_h, (int)c->in_w, (int)c->ch, (int)c->k,
+            (int)c->stride, (int)c->pad, (int)c->out_ch);
+    checkTrue(what, conv2d_dw_pw_is_fusable(&dw, &pw));
+
+    /* the layers one after the other */
+    forward_conv2d((ai_layer *)&dw);
+    forward_conv2d((ai_layer *)&pw);
+    checkFloats(what, out, ref, n_out, DW_PW_TOL);
+
+    /* fused: the intermediate activations are not written */
+    memset(mid, 0, c->n_batches * mid_size * sizeof(ai_float));
+    checkTrue(what, checkGraphFold((ai_layer *)&dw) == 1);
+    checkTrue(what,
+            dw.forward == AI_LAYER_FORWARD_FUNC(forward_conv2d_dw_pw));
+    for (int call = 0; call < 2; call++) {
+        memset(out, 0, n_out * sizeof(ai_float));
+        dw.forward((ai_layer *)&dw);
+        checkFloats(what, out, ref, n_out, DW_PW_TOL);
+    }
+    checkGraphUnfold();
+    checkTrue(what, dw.forward == AI_LAYER_FORWARD_FUNC(forward_conv2d));
+
+    free(in);
+    free(w_dw);
+    free(b_dw);
+    free(w_pw);
+    free(b_pw);
+    free(mid);
+    free(mid_ref);
+    free(out);
+    free(ref);
+}
+
+/* -------------------------------------------------------------------------- */
+void checkConvDwPw(void)
+{
+    for (size_t i = 0; i < DW_PW_N_CASES; i++)
+        dwPwCheck(&dw_pw_cases[i]);
+}
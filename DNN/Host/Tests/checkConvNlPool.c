@@ -0,0 +1,187 @@
+/**
+  ******************************************************************************
+  * @file    checkConvNlPool.c
+  * @brief   Checks of the fused convolution + nonlinearity + pooling layer
+  ******************************************************************************
+  * @attention
+  *
+  * forward_conv2d_nl_pool against the reference convolution, nonlinearity
+  * and pooling applied one after the other, for max and average pooling
+  * with pads, strides and several samples. The nonlinearity is applied
+  * before the pooling by the reference, after it by the fused max pooling.
+  *
+  ******************************************************************************
+  */
+
+/* System headers */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+/* AI header files */
+#include "layers_conv2d.h"
+#include "layers_nl.h"
+#include "layers_pool.h"
+
+#include "aiCheck.h"
+
+enum nl_pool_nl { NL_NONE, NL_RELU, NL_TANH };
+
+/* a convolution, its nonlinearity and its pooling */
+struct nl_pool_case {
+    struct check_conv g;
+    enum nl_pool_nl nl;
+    bool is_max;
+    ai_i32 pool_size, pool_stride, pool_pad;
+};
+
+static const struct nl_pool_case nl_pool_cases[] = {
+    /*  h   w  ich och kh kw  s  p  d  g  b      nl     max  ps st pp */
+    { {  8,  8,  3,  8, 3, 3, 1, 1, 1, 1, 2 }, NL_RELU, true,  2, 2, 0 },
+    { {  9,  7,  3,  8, 3, 3, 1, 1, 1, 1, 1 }, NL_RELU, false, 2, 2, 0 },
+    { {  9,  9,  8, 16, 3, 3, 1, 1, 1, 1, 2 }, NL_TANH, true,  3, 2, 1 },
+    { {  9,  9,  8, 16, 3, 3, 1, 1, 1, 1, 1 }, NL_TANH, false, 3, 2, 1 },
+    { { 10, 11,  6, 10, 3, 3, 2, 1, 1, 1, 1 }, NL_NONE, true,  2, 2, 0 },
+    { { 12, 12, 16, 24, 1, 1, 1, 0, 1, 1, 2 }, NL_RELU, false, 2, 2, 0 },
+    { { 30, 30, 16, 32, 3, 3, 1, 1, 1, 1, 1 }, NL_RELU, true,  2, 2, 0 },
+    { { 30, 30, 16, 32, 3, 3, 1, 1, 1, 1, 1 }, NL_NONE, false, 3, 3, 0 },
+    { { 13, 14,  9,  3, 3, 3, 1, 0, 1, 1, 1 }, NL_RELU, true,  3, 1, 1 },
+};
+
+#define NL_POOL_N_CASES     (sizeof(nl_pool_cases) / sizeof(nl_pool_cases[0]))
+
+#define NL_POOL_TOL         (1e-4)
+
+/* -------------------------------------------------------------------------- */
+/* pooling of one sample: over the valid positions of the window (0 if none),
+ * the average divides by their number */
+static void nlPoolRef(ai_float *out, const ai_float *in, ai_i32 in_h,
+        ai_i32 in_w, ai_i32 ch, const struct nl_pool_case *c, ai_i32 out_h,
+        ai_i32 out_w)
+{
+    for (ai_i32 oy = 0; oy < out_h; oy++) {
+        for (ai_i32 ox = 0; ox < out_w; ox++) {
+            for (ai_i32 o = 0; o < ch; o++) {
+                double acc = 0.0;
+                ai_i32 n = 0;
+                for (ai_i32 ky = 0; ky < c->pool_size; ky++) {
+                    const ai_i32 y = oy * c->pool_stride - c->pool_pad + ky;
+                    for (ai_i32 kx = 0; kx < c->pool_size; kx++) {
+                        const ai_i32 x = ox * c->pool_stride - c->pool_pad +
+                                kx;
+                        if ((y < 0) || (y >= in_h) || (x < 0) || (x >= in_w))
+                            continue;
+                        const double v = in[((size_t)y * in_w + x) * ch + o];
+                        if (!n++)
+                            acc = v;
+                        else
+                            acc = c->is_max ? fmax(acc, v) : acc + v;
+                    }
+                }
+                *out++ = (ai_float)((n && !c->is_max) ? acc / n : acc);
+            }
+        }
+    }
+}
+
+static void nlPoolCheck(const struct nl_pool_case *cc)
+{
+    const struct check_conv *c = &cc->g;
+    const ai_i32 conv_h = checkConvOut(c->in_h, c->k_h, c->stride, c->pad,
+            c->dil);
+    const ai_i32 conv_w = checkConvOut(c->in_w, c->k_w, c->stride, c->pad,
+            c->dil);
+    const ai_i32 out_h = checkConvOut(conv_h, cc->pool_size,
+            cc->pool_stride, cc->pool_pad, 1);
+    const ai_i32 out_w = checkConvOut(conv_w, cc->pool_size,
+            cc->pool_stride, cc->pool_pad, 1);
+    const size_t in_size = (size_t)c->in_h * c->in_w * c->in_ch;
+    const size_t conv_size = (size_t)conv_h * conv_w * c->out_ch;
+    const size_t out_size = (size_t)out_h * out_w * c->out_ch;
+    const size_t w_size = (size_t)c->out_ch * c->k_h * c->k_w * c->in_ch;
+
+    ai_float *in = malloc(c->n_batches * in_size * sizeof(ai_float));
+    ai_float *w = malloc(w_size * sizeof(ai_float));
+    ai_float *b = malloc(c->out_ch * sizeof(ai_float));
+    ai_float *conv = malloc(conv_size * sizeof(ai_float));
+    ai_float *out = malloc(c->n_batches * out_size * sizeof(ai_float));
+    ai_float *ref = malloc(c->n_batches * out_size * sizeof(ai_float));
+    struct check_tensor t_in, t_out, t_w, t_b;
+    ai_layer_conv2d_nl_pool l = { 0 };
+    char what[64];
+
+    checkFill(in, c->n_batches * in_size);
+    checkFill(w, w_size);
+    checkFill(b, c->out_ch);
+
+    for (ai_i32 n = 0; n < c->n_batches; n++) {
+        checkConvRef(conv, in + n * in_size, w, b, c, cc->nl == NL_RELU);
+        if (cc->nl == NL_TANH) {
+            for (size_t i = 0; i < conv_size; i++)
+                conv[i] = (ai_float)tanh(conv[i]);
+        }
+        nlPoolRef(ref + n * out_size, conv, conv_h, conv_w, c->out_ch, cc,
+                out_h, out_w);
+    }
+
+    checkTensorInit(&t_in, AI_ARRAY_FORMAT_FLOAT, in,
+            c->n_batches * in_size, 1, c->in_ch, c->in_w, c->in_h, NULL);
+    checkTensorInit(&t_out, AI_ARRAY_FORMAT_FLOAT, out,
+            c->n_batches * out_size, 1, c->out_ch, out_w, out_h, NULL);
+    checkTensorInit(&t_w, AI_ARRAY_FORMAT_FLOAT, w, w_size,
+            c->in_ch, c->k_w, c->k_h, c->out_ch, NULL);
+    checkTensorInit(&t_b, AI_ARRAY_FORMAT_FLOAT, b, c->out_ch,
+            1, c->out_ch, 1, 1, NULL);
+    ai_tensor_chain chain = AI_TENSOR_CHAIN_OBJ_INIT(AI_FLAG_NONE, 4,
+            AI_TENSOR_LIST_OBJ_INIT(AI_FLAG_NONE, 1, &t_in.tensor),
+            AI_TENSOR_LIST_OBJ_INIT(AI_FLAG_NONE, 1, &t_out.tensor),
+            AI_TENSOR_LIST_OBJ_INIT(AI_FLAG_NONE, 2, &t_w.tensor, &t_b.tensor),
+            AI_TENSOR_LIST_OBJ_EMPTY);
+
+    l.network = checkNetwork();
+    l.tensors = &chain;
+    l.groups = 1;
+    l.nl_func = (cc->nl == NL_RELU) ? nl_func_relu_array_f32 :
+            (cc->nl == NL_TANH) ? nl_func_tanh_array_f32 : NULL;
+    l.filter_stride = (ai_shape_2d)AI_SHAPE_2D_INIT(c->stride, c->stride);
+    l.dilation = (ai_shape_2d)AI_SHAPE_2D_INIT(1, 1);
+    l.filter_pad = (ai_shape)AI_SHAPE_INIT(4, c->pad, c->pad, c->pad, c->pad);
+    l.pool_size = (ai_shape_2d)AI_SHAPE_2D_INIT(cc->pool_size, cc->pool_size);
+    l.pool_stride = (ai_shape_2d)AI_SHAPE_2D_INIT(cc->pool_stride,
+            cc->pool_stride);
+    l.pool_pad = (ai_shape)AI_SHAPE_INIT(4, cc->pool_pad, cc->pool_pad,
+            cc->pool_pad, cc->pool_pad);
+    l.pool_func = cc->is_max ? pool_func_mp_array_f32 : pool_func_ap_array_f32;
+
+    snprintf(what, sizeof(what), "%dx%dx%d->%d k%d s%d p%d %s %s%d/%d/%d",
+            (int)c->in_h, (int)c->in_w, (int)c->in_ch, (int)c->out_ch,
+            (int)c->k_h, (int)c->stride, (int)c->pad,
+            (cc->nl == NL_RELU) ? "relu" : (cc->nl == NL_TANH) ? "tanh" : "-",
+            cc->is_max ? "max" : "avg", (int)cc->pool_size,
+            (int)cc->pool_stride, (int)cc->pool_pad);
+    for (int call = 0; call < 2; call++) {
+        memset(out, 0, c->n_batches * out_size * sizeof(ai_float));
+        forward_conv2d_nl_pool((ai_layer *)&l);
+        checkFloats(what, out, ref, c->n_batches * out_size, NL_POOL_TOL);
+    }
+
+    /* the layer goes out of scope: its prepared weights are released */
+    checkGraphUnfold();
+
+    free(in);
+    free(w);
+    free(b);
+    free(conv);
+    free(out);
+    free(ref);
+}
+
+/* -------------------------------------------------------------------------- */
+void checkConvNlPool(void)
+{
+    for (size_t i = 0; i < NL_POOL_N_CASES; i++)
+        nlPoolCheck(&nl_pool_cases[i]);
+}
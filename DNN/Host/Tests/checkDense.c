@@ -0,0 +1,481 @@
+/**
+  ******************************************************************************
+  * @file    checkDense.c
+  * @brief   Checks of the dense kernels
+  ******************************************************************************
+  * @attention
+  *
+  * The kernel selected for the cpu (dense_kernel_*_get, which follows
+  * AI_CPU_FEATURES) and the generic one are run on the same data and
+  * compared with a naive reference accumulated in double. The sizes cover
+  * the SIMD tails: inputs and outputs below, at and above the vector widths.
+  *
+  ******************************************************************************
+  */
+
+/* System headers */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+/* AI header files */
+#include "layers_dense.h"
+
+#include "aiCheck.h"
+
+/* n_rows x n_in inputs, n_out outputs */
+struct dense_case {
+    ai_size n_rows, n_in, n_out;
+    bool bias;
+};
+
+static const struct dense_case dense_cases[] = {
+    /* rows   in   out  bias */
+    {  1,     1,    1, true  },
+    {  1,     3,    5, false },
+    {  2,     8,    4, true  },
+    {  3,    15,   17, true  },
+    {  1,    16,   16, false },
+    {  5,    17,    3, true  },
+    {  2,    33,   32, true  },
+    {  4,    64,    9, false },
+    {  1,   100,   33, true  },
+    {  3,   257,   12, true  },
+    {  2,  1000,    7, true  },
+};
+
+#define DENSE_N_CASES   (sizeof(dense_cases) / sizeof(dense_cases[0]))
+
+/* relative to max(1, |ref|): the float rounding of the sums of n_in terms
+ * (of magnitude n_in / 4 at most) grows with n_in */
+#define DENSE_TOL(n_in_)    (1e-6 + 1e-7 * (double)(n_in_))
+
+/* the inputs, weights and outputs of a case */
+struct dense_data {
+    const struct dense_case *c;
+    ai_float *in;
+    ai_float *bias;         /* NULL without bias */
+    ai_float *out;
+    ai_float *ref;
+    char what[48];
+};
+
+/* -------------------------------------------------------------------------- */
+static void denseInit(struct dense_data *d, const struct dense_case *c,
+        const char *kind)
+{
+    const size_t n_in = (size_t)c->n_rows * c->n_in;
+    const size_t n_out = (size_t)c->n_rows * c->n_out;
+
+    d->c = c;
+    d->in = malloc(n_in * sizeof(ai_float) + 1);
+    d->bias = c->bias ? malloc(c->n_out * sizeof(ai_float)) : NULL;
+    d->out = malloc(n_out * sizeof(ai_float) + 1);
+    d->ref = malloc(n_out * sizeof(ai_float) + 1);
+    checkFill(d->in, n_in);
+    if (d->bias)
+        checkFill(d->bias, c->n_out);
+    snprintf(d->what, sizeof(d->what), "%s %ux%u->%u%s", kind,
+            (unsigned)c->n_rows, (unsigned)c->n_in, (unsigned)c->n_out,
+            c->bias ? " bias" : "");
+}
+
+static void denseFree(struct dense_data *d)
+{
+    free(d->in);
+    free(d->bias);
+    free(d->out);
+    free(d->ref);
+}
+
+/* reference: w(o, i) is the weight of the output o for the input i */
+static void denseRef(struct dense_data *d,
+        double (*w)(const void *ctx, ai_size o, ai_size i), const void *ctx)
+{
+    const struct dense_case *c = d->c;
+
+    for (ai_size r = 0; r < c->n_rows; r++) {
+        for (ai_size o = 0; o < c->n_out; o++) {
+            double acc = d->bias ? d->bias[o] : 0.0;
+            for (ai_size i = 0; i < c->n_in; i++)
+                acc += (double)d->in[r * c->n_in + i] * w(ctx, o, i);
+            d->ref[r * c->n_out + o] = (ai_float)acc;
+        }
+    }
+}
+
+/* outputs poisoned before each run: every output must be written */
+static void densePoison(struct dense_data *d)
+{
+    memset(d->out, 0xff, (size_t)d->c->n_rows * d->c->n_out *
+            sizeof(ai_float));
+}
+
+static void denseResult(struct dense_data *d, const char *kernel)
+{
+    char what[64];
+
+    snprintf(what, sizeof(what), "%s %s", d->what, kernel);
+    checkFloats(what, d->out, d->ref, (size_t)d->c->n_rows * d->c->n_out,
+            DENSE_TOL(d->c->n_in));
+}
+
+/* -------------------------------------------------------------------------- */
+/* float weights [n_out][n_in] */
+struct dense_f32 {
+    const ai_float *w;
+    ai_size n_in;
+};
+
+static double denseWeightF32(const void *ctx, ai_size o, ai_size i)
+{
+    const struct dense_f32 *p = ctx;
+    return p->w[o * p->n_in + i];
+}
+
+static void denseCheckF32(const struct dense_case *c)
+{
+    const ai_dense_kernel_f32 *k = dense_kernel_f32_get();
+    struct dense_data d;
+    ai_float *w = malloc((size_t)c->n_out * c->n_in * sizeof(ai_float));
+    const struct dense_f32 ctx = { w, c->n_in };
+
+    denseInit(&d, c, "f32");
+    checkFill(w, (size_t)c->n_out * c->n_in);
+    denseRef(&d, denseWeightF32, &ctx);
+
+    densePoison(&d);
+    k->func(d.out, d.in, w, d.bias, c->n_rows, c->n_in, c->n_out);
+    denseResult(&d, "dispatched");
+    densePoison(&d);
+    func_dense_f32_generic(d.out, d.in, w, d.bias, c->n_rows, c->n_in,
+            c->n_out);
+    denseResult(&d, "generic");
+
+    denseFree(&d);
+    free(w);
+}
+
+/* -------------------------------------------------------------------------- */
+/* half precision weights: normal values of magnitude in [2^-6, 2) */
+static ai_u16 denseRandF16(void)
+{
+    const ai_u16 sign = (checkRand() < 0.0f) ? 0x8000 : 0;
+    const ai_u16 exp = (ai_u16)checkRandInt(15 - 6, 15);
+    const ai_u16 mant = (ai_u16)checkRandInt(0, 0x3ff);
+    return sign | (ai_u16)(exp << 10) | mant;
+}
+
+static double denseHalf(ai_u16 h)
+{
+    const int exp = (h >> 10) & 0x1f;
+    const double v = ldexp(1.0 + (h & 0x3ff) / 1024.0, exp - 15);
+    return (h & 0x8000) ? -v : v;
+}
+
+struct dense_f16 {
+    const ai_u16 *w;
+    ai_size n_in;
+};
+
+static double denseWeightF16(const void *ctx, ai_size o, ai_size i)
+{
+    const struct dense_f16 *p = ctx;
+    return denseHalf(p->w[o * p->n_in + i]);
+}
+
+static void denseCheckF16(const struct dense_case *c)
+{
+    const ai_dense_kernel_f16 *k = dense_kernel_f16_get();
+    const size_t n_w = (size_t)c->n_out * c->n_in;
+    struct dense_data d;
+    ai_u16 *w = malloc(n_w * sizeof(ai_u16) + 1);
+    const struct dense_f16 ctx = { w, c->n_in };
+
+    denseInit(&d, c, "f16");
+    for (size_t i = 0; i < n_w; i++)
+        w[i] = denseRandF16();
+    denseRef(&d, denseWeightF16, &ctx);
+
+    densePoison(&d);
+    k->func(d.out, d.in, w, d.bias, c->n_rows, c->n_in, c->n_out);
+    denseResult(&d, "dispatched");
+    densePoison(&d);
+    func_dense_f16_generic(d.out, d.in, w, d.bias, c->n_rows, c->n_in,
+            c->n_out);
+    denseResult(&d, "generic");
+
+    denseFree(&d);
+    free(w);
+}
+
+/* -------------------------------------------------------------------------- */
+/* codebook weights: lut[indices[o][i]], LUT4 indices packed by pairs (first
+ * one in the high nibble, rows padded to a byte) */
+struct dense_lut {
+    const ai_u8 *indices;
+    const ai_float *lut;
+    ai_size row_size;
+    bool lut4;
+};
+
+static double denseWeightLut(const void *ctx, ai_size o, ai_size i)
+{
+    const struct dense_lut *p = ctx;
+    ai_u32 idx;
+
+    if (p->lut4) {
+        const ai_u8 b = p->indices[o * p->row_size + (i >> 1)];
+        idx = (i & 1) ? (b & 0xf) : (b >> 4);
+    } else {
+        idx = p->indices[o * p->row_size + i];
+    }
+    return p->lut[idx];
+}
+
+static void denseCheckLut(const struct dense_case *c, bool lut4)
+{
+    const ai_dense_kernel_lut *k = dense_kernel_lut_get();
+    const ai_size row_size = lut4 ? AI_DENSE_LUT4_ROW_SIZE(c->n_in) : c->n_in;
+    const size_t n_idx = (size_t)c->n_out * row_size;
+    const ai_size n_lut = lut4 ? 16 : 256;
+    struct dense_data d;
+    ai_u8 *indices = malloc(n_idx + 1);
+    ai_float lut[256];
+    const struct dense_lut ctx = { indices, lut, row_size, lut4 };
+
+    denseInit(&d, c, lut4 ? "lut4" : "lut8");
+    checkFill(lut, n_lut);
+    for (size_t i = 0; i < n_idx; i++)
+        indices[i] = (ai_u8)checkRandInt(0, 255);
+    if (lut4 && (c->n_in & 1)) {
+        /* the padding nibble of each row is not a weight */
+        for (ai_size o = 0; o < c->n_out; o++)
+            indices[o * row_size + row_size - 1] |= 0xf;
+    }
+    denseRef(&d, denseWeightLut, &ctx);
+
+    densePoison(&d);
+    (lut4 ? k->lut4 : k->lut8)(d.out, d.in, indices, lut, d.bias, c->n_rows,
+            c->n_in, c->n_out);
+    denseResult(&d, "dispatched");
+    densePoison(&d);
+    (lut4 ? func_dense_lut4_generic : func_dense_lut8_generic)(d.out, d.in,
+            indices, lut, d.bias, c->n_rows, c->n_in, c->n_out);
+    denseResult(&d, "generic");
+
+    denseFree(&d);
+    free(indices);
+}
+
+/* -------------------------------------------------------------------------- */
+/* int8 x int4 dot products, one per output row of packed S4 / U4 weights */
+static void denseCheckQ4(const struct dense_case *c, bool is_signed)
+{
+    const ai_dense_kernel_q4 *k = dense_kernel_q4_get();
+    const ai_size row_size = AI_DENSE_Q4_ROW_SIZE(c->n_in);
+    const func_dense_dot_q4 dot = is_signed ? k->s4 : k->u4;
+    const func_dense_dot_q4 generic = is_signed ? func_dense_dot_s4_generic :
+            func_dense_dot_u4_generic;
+    const ai_i32 zp_in = checkRandInt(-128, 127);
+    const ai_i32 zp_w = is_signed ? 0 : checkRandInt(0, 15);
+    ai_i8 *in = malloc(c->n_in + 1);
+    ai_u8 *w = malloc((size_t)c->n_out * row_size + 1);
+    int32_t *out = malloc(c->n_out * sizeof(int32_t) + 1);
+    int32_t *ref = malloc(c->n_out * sizeof(int32_t) + 1);
+    char what[64];
+
+    for (ai_size i = 0; i < c->n_in; i++)
+        in[i] = (ai_i8)checkRandInt(-128, 127);
+    for (size_t i = 0; i < (size_t)c->n_out * row_size; i++)
+        w[i] = (ai_u8)checkRandInt(0, 255);
+    for (ai_size o = 0; o < c->n_out; o++) {
+        const ai_u8 *row = w + o * row_size;
+        int64_t acc = 0;
+        for (ai_size i = 0; i < c->n_in; i++) {
+            ai_i32 q = (i & 1) ? (row[i >> 1] & 0xf) : (row[i >> 1] >> 4);
+            if (is_signed)
+                q = (q ^ 8) - 8;
+            acc += (int64_t)(in[i] - zp_in) * (q - zp_w);
+        }
+        ref[o] = (int32_t)acc;
+    }
+
+    snprintf(what, sizeof(what), "%s dot %u zp %d/%d dispatched",
+            is_signed ? "s4" : "u4", (unsigned)c->n_in, (int)zp_in,
+            (int)zp_w);
+    for (ai_size o = 0; o < c->n_out; o++)
+        out[o] = dot(in, w + o * row_size, zp_in, zp_w, c->n_in);
+    checkInts(what, out, ref, c->n_out, 0);
+    snprintf(what, sizeof(what), "%s dot %u zp %d/%d generic",
+            is_signed ? "s4" : "u4", (unsigned)c->n_in, (int)zp_in,
+            (int)zp_w);
+    for (ai_size o = 0; o < c->n_out; o++)
+        out[o] = generic(in, w + o * row_size, zp_in, zp_w, c->n_in);
+    checkInts(what, out, ref, c->n_out, 0);
+
+    free(in);
+    free(w);
+    free(out);
+    free(ref);
+}
+
+/* -------------------------------------------------------------------------- */
+/* block sparse weights: about a third of the blocks stored, the reference
+ * uses the equivalent dense weights */
+static void denseCheckBsr(const struct dense_case *c)
+{
+    const ai_dense_kernel_bsr *k = dense_kernel_bsr_get();
+    const ai_size n_groups = AI_DENSE_BSR_GROUPS(c->n_out);
+    const size_t n_blocks_max = (size_t)n_groups * c->n_in;
+    struct dense_data d;
+    ai_float *w = calloc((size_t)c->n_out * c->n_in + 1, sizeof(ai_float));
+    ai_float *values = malloc(n_blocks_max * AI_DENSE_BSR_BLOCK *
+            sizeof(ai_float) + 1);
+    ai_u32 *index = malloc((n_groups + 1 + n_blocks_max) * sizeof(ai_u32));
+    ai_u32 *columns = index + n_groups + 1;     /* after the offsets */
+    const struct dense_f32 ctx = { w, c->n_in };
+    ai_u32 n_blocks = 0;
+
+    denseInit(&d, c, "bsr");
+    for (ai_size g = 0; g < n_groups; g++) {
+        index[g] = n_blocks;
+        for (ai_size i = 0; i < c->n_in; i++) {
+            if (checkRand() > -0.33f)
+                continue;
+            ai_float *block = values + n_blocks * AI_DENSE_BSR_BLOCK;
+            checkFill(block, AI_DENSE_BSR_BLOCK);
+            for (ai_size j = 0; j < AI_DENSE_BSR_BLOCK; j++) {
+                const ai_size o = g * AI_DENSE_BSR_BLOCK + j;
+                if (o < c->n_out)
+                    w[o * c->n_in + i] = block[j];
+                else
+                    block[j] = 0.0f;
+            }
+            columns[n_blocks++] = i;
+        }
+    }
+    index[n_groups] = n_blocks;
+    denseRef(&d, denseWeightF32, &ctx);
+
+    densePoison(&d);
+    k->func(d.out, d.in, values, index, d.bias, c->n_rows, c->n_in,
+            c->n_out);
+    denseResult(&d, "dispatched");
+    densePoison(&d);
+    func_dense_bsr_generic(d.out, d.in, values, index, d.bias, c->n_rows,
+            c->n_in, c->n_out);
+    denseResult(&d, "generic");
+
+    denseFree(&d);
+    free(w);
+    free(values);
+    free(index);
+}
+
+/* -------------------------------------------------------------------------- */
+/* transposed weights GEMM: weights [n_in][n_out], n_in can be 0 */
+struct dense_gemm {
+    const ai_float *w;
+    ai_size n_out;
+};
+
+static const struct dense_case dense_gemm_cases[] = {
+    /* rows   in   out  bias */
+    {  3,     0,   20, true  },
+    {  2,     0,    5, false },
+};
+
+#define DENSE_GEMM_N_CASES \
+    (sizeof(dense_gemm_cases) / sizeof(dense_gemm_cases[0]))
+
+static double denseWeightGemm(const void *ctx, ai_size o, ai_size i)
+{
+    const struct dense_gemm *p = ctx;
+    return p->w[i * p->n_out + o];
+}
+
+static void denseCheckGemm(const struct dense_case *c)
+{
+    const ai_dense_kernel_gemm *k = dense_kernel_gemm_get();
+    struct dense_data d;
+    ai_float *w = malloc((size_t)c->n_in * c->n_out * sizeof(ai_float) + 1);
+    const struct dense_gemm ctx = { w, c->n_out };
+
+    denseInit(&d, c, "gemm");
+    checkFill(w, (size_t)c->n_in * c->n_out);
+    denseRef(&d, denseWeightGemm, &ctx);
+
+    densePoison(&d);
+    k->func(d.out, d.in, w, d.bias, c->n_rows, c->n_in, c->n_out);
+    denseResult(&d, "dispatched");
+    densePoison(&d);
+    func_dense_gemm_generic(d.out, d.in, w, d.bias, c->n_rows, c->n_in,
+            c->n_out);
+    denseResult(&d, "generic");
+
+    denseFree(&d);
+    free(w);
+}
+
+/* -------------------------------------------------------------------------- */
+/* int8 x int8 dot products, one per output row of weights */
+static void denseCheckS8(const struct dense_case *c)
+{
+    const ai_dense_kernel_s8 *k = dense_kernel_s8_get();
+    const ai_i32 zp_in = checkRandInt(-128, 127);
+    ai_i8 *in = malloc(c->n_in + 1);
+    ai_i8 *w = malloc((size_t)c->n_out * c->n_in + 1);
+    int32_t *out = malloc(c->n_out * sizeof(int32_t) + 1);
+    int32_t *ref = malloc(c->n_out * sizeof(int32_t) + 1);
+    char what[64];
+
+    for (ai_size i = 0; i < c->n_in; i++)
+        in[i] = (ai_i8)checkRandInt(-128, 127);
+    for (size_t i = 0; i < (size_t)c->n_out * c->n_in; i++)
+        w[i] = (ai_i8)checkRandInt(-128, 127);
+    for (ai_size o = 0; o < c->n_out; o++) {
+        int64_t acc = 0;
+        for (ai_size i = 0; i < c->n_in; i++)
+            acc += (int64_t)(in[i] - zp_in) * w[o * c->n_in + i];
+        ref[o] = (int32_t)acc;
+    }
+
+    snprintf(what, sizeof(what), "s8 dot %u zp %d dispatched",
+            (unsigned)c->n_in, (int)zp_in);
+    for (ai_size o = 0; o < c->n_out; o++)
+        out[o] = k->func(in, w + o * c->n_in, zp_in, c->n_in);
+    checkInts(what, out, ref, c->n_out, 0);
+    snprintf(what, sizeof(what), "s8 dot %u zp %d generic",
+            (unsigned)c->n_in, (int)zp_in);
+    for (ai_size o = 0; o < c->n_out; o++)
+        out[o] = func_dense_dot_s8_generic(in, w + o * c->n_in, zp_in,
+                c->n_in);
+    checkInts(what, out, ref, c->n_out, 0);
+
+    free(in);
+    free(w);
+    free(out);
+    free(ref);
+}
+
+/* -------------------------------------------------------------------------- */
+void checkDense(void)
+{
+    for (size_t i = 0; i < DENSE_N_CASES; i++) {
+        denseCheckF32(&dense_cases[i]);
+        denseCheckF16(&dense_cases[i]);
+        denseCheckLut(&dense_cases[i], false);
+        denseCheckLut(&dense_cases[i], true);
+        denseCheckQ4(&dense_cases[i], true);
+        denseCheckQ4(&dense_cases[i], false);
+        denseCheckBsr(&dense_cases[i]);
+        denseCheckGemm(&dense_cases[i]);
+        denseCheckS8(&dense_cases[i]);
+    }
+    for (size_t i = 0; i < DENSE_GEMM_N_CASES; i++)
+        denseCheckGemm(&dense_gemm_cases[i]);
+}
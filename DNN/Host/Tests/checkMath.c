@@ -0,0 +1,241 @@
+/**
+  ******************************************************************************
+  * @file    checkMath.c
+  * @brief   Checks of the core math functions, per accuracy tier
+  ******************************************************************************
+  * @attention
+  *
+  * The errors of exp, log, tanh, sigmoid and erf are measured against a
+  * long double reference on a sweep of the float bit patterns (a subset of
+  * the one input out of 5 sweep of core_math.h) and asserted to be within
+  * the bounds documented in core_math.h for the running AI_MATH_ACCURACY
+  * tier (the libm tier is measured, not asserted). The special values
+  * (NaN, +/-inf, +/-0, exp overflow and flush to zero) are checked in
+  * every tier.
+  *
+  ******************************************************************************
+  */
+
+/* System headers */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+
+/* AI header files */
+#include "core_math.h"
+
+#include "aiCheck.h"
+
+/* sweep stride: a multiple of 5, every input of the sweep was measured */
+#define MATH_SWEEP_STRIDE   (5u * 821u)
+#define MATH_SWEEP_CHUNK    (4096)
+
+/* sampled outputs recorded for the comparison of the passes */
+#define MATH_N_SAMPLES      (512)
+
+/* the relative errors of exp are measured above this result */
+#define MATH_REL_MIN        (1e-30L)
+
+enum math_error { MATH_ULP, MATH_ABS, MATH_REL };
+
+/* error bound of a function in a tier */
+struct math_bound {
+    enum math_error error;
+    double bound;
+};
+
+struct math_func {
+    const char *name;
+    void (*func)(ai_float *out, const ai_float *in, const ai_size size);
+    long double (*ref)(long double x);
+    struct math_bound ulp2, fast;   /* see core_math.h */
+    float lo, hi;                   /* range of the sampled outputs */
+};
+
+static long double mathExpRef(long double x) { return expl(x); }
+static long double mathLogRef(long double x) { return logl(x); }
+static long double mathTanhRef(long double x) { return tanhl(x); }
+static long double mathErfRef(long double x) { return erfl(x); }
+
+static long double mathSigmoidRef(long double x)
+{
+    return 1.0L / (1.0L + expl(-x));
+}
+
+static const struct math_func math_funcs[] = {
+    { "exp", core_math_exp_array_f32, mathExpRef,
+      { MATH_ULP, 1.01 }, { MATH_REL, 5.6e-5 }, -20.0f, 20.0f },
+    { "log", core_math_log_array_f32, mathLogRef,
+      { MATH_ULP, 0.82 }, { MATH_ULP, 0.82 }, 1e-3f, 1e3f },
+    { "tanh", core_math_tanh_array_f32, mathTanhRef,
+      { MATH_ULP, 1.33 }, { MATH_ABS, 1.5e-5 }, -8.0f, 8.0f },
+    { "sigmoid", core_math_sigmoid_array_f32, mathSigmoidRef,
+      { MATH_ULP, 1.48 }, { MATH_ABS, 1.4e-5 }, -16.0f, 16.0f },
+    { "erf", core_math_erf_array_f32, mathErfRef,
+      { MATH_ULP, 1.40 }, { MATH_ABS, 5e-6 }, -4.0f, 4.0f },
+};
+
+#define MATH_N_FUNCS    (sizeof(math_funcs) / sizeof(math_funcs[0]))
+
+static const char *const math_errors[] = { "ulp", "abs", "rel" };
+
+/* -------------------------------------------------------------------------- */
+/* unit in the last place of the float nearest to r */
+static long double mathUlp(long double r)
+{
+    const float f = (float)fabsl(r);
+    int e;
+
+    if (f < FLT_MIN)
+        return ldexpl(1.0L, -149);
+    if (isinf(f))
+        return ldexpl(1.0L, 104);
+    frexpf(f, &e);
+    return ldexpl(1.0L, e - 24);
+}
+
+static const struct math_bound *mathBound(const struct math_func *f)
+{
+    const char *tier = checkTier();
+
+    if (tier && !strcmp(tier, "ulp2"))
+        return &f->ulp2;
+    if (tier && !strcmp(tier, "fast"))
+        return &f->fast;
+    return NULL;
+}
+
+/* errors over the sweep: the NaN and the inf must match the reference */
+static void mathSweep(const struct math_func *f)
+{
+    static ai_float in[MATH_SWEEP_CHUNK], out[MATH_SWEEP_CHUNK];
+    const struct math_bound *b = mathBound(f);
+    long double max[3] = { 0.0L, 0.0L, 0.0L };
+    float worst = 0.0f;
+    uint64_t bits = 0;
+    long bad = 0;
+    char what[48];
+
+    while (bits < 0x100000000ull) {
+        ai_size n = 0;
+        while ((n < MATH_SWEEP_CHUNK) && (bits < 0x100000000ull)) {
+            const uint32_t u = (uint32_t)bits;
+            memcpy(&in[n++], &u, sizeof(u));
+            bits += MATH_SWEEP_STRIDE;
+        }
+        f->func(out, in, n);
+        for (ai_size i = 0; i < n; i++) {
+            const long double r = f->ref(in[i]);
+            const float y = out[i];
+            if (isnan(r) || isnan(y) || isinf((float)r) || isinf(y)) {
+                if (!(isnan(r) && isnan(y)) && (y != (float)r))
+                    bad++;
+                continue;
+            }
+            const long double d = fabsl((long double)y - r);
+            if (d / mathUlp(r) > max[MATH_ULP]) {
+                max[MATH_ULP] = d / mathUlp(r);
+                if (b && (b->error == MATH_ULP))
+                    worst = in[i];
+            }
+            if (d > max[MATH_ABS]) {
+                max[MATH_ABS] = d;
+                if (b && (b->error == MATH_ABS))
+                    worst = in[i];
+            }
+            if ((fabsl(r) > MATH_REL_MIN) && (d / fabsl(r) > max[MATH_REL])) {
+                max[MATH_REL] = d / fabsl(r);
+                if (b && (b->error == MATH_REL))
+                    worst = in[i];
+            }
+        }
+    }
+
+    snprintf(what, sizeof(what), "%s special values of the sweep", f->name);
+    checkTrue(what, bad == 0);
+    if (!b) {
+        /* the C library: reported (-v), not asserted */
+        snprintf(what, sizeof(what), "%s max ulp error", f->name);
+        checkBound(what, (double)max[MATH_ULP], INFINITY);
+        return;
+    }
+    snprintf(what, sizeof(what), "%s max %s error (x=%a)", f->name,
+            math_errors[b->error], (double)worst);
+    checkBound(what, (double)max[b->error], b->bound);
+}
+
+/* -------------------------------------------------------------------------- */
+/* outputs at random points of a grid of the range of the function, within
+ * the tolerance of the tier */
+static void mathSamples(const struct math_func *f)
+{
+    const struct math_bound *b = mathBound(f);
+    ai_float in[MATH_N_SAMPLES], out[MATH_N_SAMPLES], ref[MATH_N_SAMPLES];
+    double tol = 4.0 * FLT_EPSILON;
+    char what[48];
+
+    if (b && (b->error != MATH_ULP))
+        tol = 2.0 * b->bound;
+    for (int i = 0; i < MATH_N_SAMPLES; i++) {
+        const float u = ((float)i + 0.5f + 0.5f * checkRand()) /
+                MATH_N_SAMPLES;
+        in[i] = f->lo + (f->hi - f->lo) * u;
+        ref[i] = (ai_float)f->ref(in[i]);
+    }
+    f->func(out, in, MATH_N_SAMPLES);
+    snprintf(what, sizeof(what), "%s samples", f->name);
+    checkFloats(what, out, ref, MATH_N_SAMPLES, tol);
+}
+
+/* -------------------------------------------------------------------------- */
+/* special values: as the C library, exp overflow above 88.72, flush to zero
+ * below -103.9, odd functions keep the sign of zero */
+static const float math_specials[] = {
+    0.0f, -0.0f, INFINITY, -INFINITY, NAN, -1.0f, FLT_MIN, 1.0f,
+    88.72f, 88.73f, -103.0f, -104.5f,
+};
+
+#define MATH_N_SPECIALS (sizeof(math_specials) / sizeof(math_specials[0]))
+
+static void mathSpecials(const struct math_func *f)
+{
+    ai_float out[MATH_N_SPECIALS], ref[MATH_N_SPECIALS];
+    char what[48];
+
+    for (size_t i = 0; i < MATH_N_SPECIALS; i++)
+        ref[i] = (ai_float)f->ref(math_specials[i]);
+    f->func(out, math_specials, MATH_N_SPECIALS);
+    snprintf(what, sizeof(what), "%s special values", f->name);
+    /* exact for the special values, within the tier elsewhere */
+    checkFloats(what, out, ref, MATH_N_SPECIALS, 1e-4);
+
+    if (f->func == core_math_exp_array_f32) {
+        checkTrue("exp(88.73) overflows", isinf(out[9]) && (out[9] > 0.0f));
+        checkTrue("exp(88.72) is finite", isfinite(out[8]));
+        checkTrue("exp(-104.5) flushes to zero", out[11] == 0.0f);
+        checkTrue("exp(-103) is not zero", out[10] > 0.0f);
+    }
+    if ((f->func == core_math_tanh_array_f32) ||
+            (f->func == core_math_erf_array_f32)) {
+        snprintf(what, sizeof(what), "%s(-0) is -0", f->name);
+        checkTrue(what, (out[1] == 0.0f) && signbit(out[1]));
+        snprintf(what, sizeof(what), "%s(+0) is +0", f->name);
+        checkTrue(what, (out[0] == 0.0f) && !signbit(out[0]));
+    }
+    if (f->func == core_math_log_array_f32)
+        checkTrue("log(-0) is -inf", isinf(out[1]) && (out[1] < 0.0f));
+}
+
+/* -------------------------------------------------------------------------- */
+void checkMath(void)
+{
+    for (size_t i = 0; i < MATH_N_FUNCS; i++) {
+        mathSpecials(&math_funcs[i]);
+        mathSamples(&math_funcs[i]);
+        mathSweep(&math_funcs[i]);
+    }
+}
@@ -0,0 +1,479 @@
+/**
+  ******************************************************************************
+  * @file    checkMnetwork.c
+  * @brief   Checks of the ai_mnetwork instance pool and weights hot swap
+  ******************************************************************************
+  * @attention
+  *
+  * The instances of the generated network are acquired, run and released
+  * by concurrent workers while another thread destroys and creates them
+  * again: every run gives the outputs of the reference (computed on the
+  * weights of network_data.c), an instance is never handed to two workers
+  * and ai_mnetwork_destroy never succeeds on an acquired instance.
+  *
+  * Meanwhile the network is switched between two weights blobs (the
+  * compiled-in weights and random ones) with ai_mnetwork_weights_publish,
+  * from the handler of an interval timer signal which interrupts the
+  * workers anywhere, in their runs too, on a single cpu as well: every run
+  * gives the outputs of one of them. Once a publication succeeds, the blob
+  * published before the previous one is released: it is overwritten with
+  * NaN, a run still reading it (the weights are folded when an instance
+  * switches to a blob) gives NaN. The threads only count the failures,
+  * reported once they are joined.
+  *
+  ******************************************************************************
+  */
+
+/* System headers */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/time.h>
+
+/* AI header files */
+#include "app_x-cube-ai.h"
+
+#include "aiCheck.h"
+
+#define MNET_N_INSTANCES    (AI_MNETWORK_INSTANCE_NUMBER)
+
+/* one worker more than instances: the pool is sometimes empty */
+#define MNET_N_WORKERS      (MNET_N_INSTANCES + 1)
+#define MNET_N_RUNS         (200)
+
+/* samples of a run: long runs, mostly interrupted by the publications */
+#define MNET_N_SAMPLES      (8192)
+
+/* float kernels against the double reference */
+#define MNET_TOL            (1e-6)
+
+/* weights of the generated network (see network.c): dense 1->5, dense 5->1 */
+#define MNET_W1             (0)
+#define MNET_B1             (5)
+#define MNET_W2             (10)
+#define MNET_B2             (15)
+#define MNET_N_HIDDEN       (5)
+#define MNET_N_WEIGHTS      (AI_NETWORK_DATA_WEIGHTS_SIZE / sizeof(ai_float))
+
+/* blobs of the publications, the k-th one in blob[k % MNET_N_BLOBS]: the
+ * current one, the previous one and a released one */
+#define MNET_N_BLOBS        (3)
+#define MNET_BLOB_SIZE      (AI_MNETWORK_WEIGHTS_ALIGN + \
+                             AI_NETWORK_DATA_WEIGHTS_SIZE)
+
+/* period of the publications (SIGALRM) */
+#define MNET_PUBLISH_US     (50)
+
+struct mnet_ctx {
+    ai_handle net[MNET_N_INSTANCES];
+    void *activations[MNET_N_INSTANCES];
+    ai_u32 held[MNET_N_INSTANCES];  /* workers owning the instance */
+    ai_float in[MNET_N_SAMPLES];
+    /* the compiled-in weights (published by the even publications), the
+     * random ones (odd publications) and their outputs */
+    ai_float weights[2][MNET_N_WEIGHTS];
+    ai_float ref[2][MNET_N_SAMPLES];
+    const char *signature;
+    AI_ALIGNED(64) ai_u8 blob[MNET_N_BLOBS][MNET_BLOB_SIZE];
+    ai_u32 published;               /* publications */
+    ai_u32 publishing;              /* a handler is publishing */
+    ai_handle publisher;            /* instance of the publications */
+    ai_u32 done;                    /* the workers are joined */
+    /* failures counted by the threads */
+    ai_u32 bad_runs;
+    ai_u32 bad_acquires;
+    ai_u32 bad_releases;
+    ai_u32 bad_destroys;
+    ai_u32 bad_creates;
+};
+
+static struct mnet_ctx mnet;
+
+/* -------------------------------------------------------------------------- */
+static void mnetRef(ai_float *ref, const ai_float *w, const ai_float *in,
+        ai_u32 n)
+{
+    for (ai_u32 i = 0; i < n; i++) {
+        double acc = w[MNET_B2];
+        for (int j = 0; j < MNET_N_HIDDEN; j++)
+            acc += (double)w[MNET_W2 + j] *
+                    ((double)w[MNET_W1 + j] * in[i] + w[MNET_B1 + j]);
+        ref[i] = (ai_float)acc;
+    }
+}
+
+static bool mnetMatches(const ai_float *out, const ai_float *ref, ai_u32 n)
+{
+    for (ai_u32 i = 0; i < n; i++) {
+        if (!(fabs((double)out[i] - ref[i]) <=
+                MNET_TOL * fmax(1.0, fabs(ref[i]))))
+            return false;
+    }
+    return true;
+}
+
+/* without weights buffer: the instance follows the published weights */
+static bool mnetInit(ai_handle net, void *activations)
+{
+    ai_network_params params = {
+            AI_BUFFER_OBJ_INIT(AI_BUFFER_FORMAT_NONE|AI_BUFFER_FMT_FLAG_CONST,
+                    0, 0, 0, 0, NULL),
+            AI_BUFFER_OBJ_INIT(AI_BUFFER_FORMAT_NONE|AI_BUFFER_FMT_FLAG_CONST,
+                    0, 0, 0, 0, AI_HANDLE_PTR(activations)) };
+
+    return ai_mnetwork_init(net, &params);
+}
+
+static bool mnetRun(ai_handle net, const ai_float *in, ai_float *out,
+        ai_u32 n)
+{
+    ai_network_report report;
+    ai_buffer input, output;
+
+    if (!ai_mnetwork_get_info(net, &report) || (report.n_inputs != 1) ||
+            (report.n_outputs != 1))
+        return false;
+    input = report.inputs[0];
+    output = report.outputs[0];
+    input.n_batches = (ai_u16)n;
+    output.n_batches = (ai_u16)n;
+    input.data = AI_HANDLE_PTR(in);
+    output.data = AI_HANDLE_PTR(out);
+    return (ai_mnetwork_run(net, &input, &output) == (ai_i32)n);
+}
+
+/* the k-th publication: blob[k % MNET_N_BLOBS] */
+static ai_u8 *mnetBlob(ai_u32 k)
+{
+    ai_u8 *blob = mnet.blob[k % MNET_N_BLOBS];
+
+    memcpy(blob + AI_MNETWORK_WEIGHTS_ALIGN, mnet.weights[k & 1],
+            AI_NETWORK_DATA_WEIGHTS_SIZE);
+    ai_mnetwork_weights_header_init((ai_mnetwork_weights_header *)blob,
+            mnet.signature, blob + AI_MNETWORK_WEIGHTS_ALIGN,
+            AI_NETWORK_DATA_WEIGHTS_SIZE);
+    return blob;
+}
+
+/* a released blob: a run reading it gives NaN */
+static void mnetPoison(ai_u32 k)
+{
+    ai_float *w = (ai_float *)(mnet.blob[k % MNET_N_BLOBS] +
+            AI_MNETWORK_WEIGHTS_ALIGN);
+
+    for (size_t i = 0; i < MNET_N_WEIGHTS; i++)
+        w[i] = NAN;
+}
+
+static int mnetSlot(ai_handle net)
+{
+    for (int i = 0; i < MNET_N_INSTANCES; i++) {
+        if (__atomic_load_n(&mnet.net[i], __ATOMIC_ACQUIRE) == net)
+            return i;
+    }
+    return -1;
+}
+
+static void mnetCount(ai_u32 *count)
+{
+    __atomic_add_fetch(count, 1, __ATOMIC_RELAXED);
+}
+
+/* -------------------------------------------------------------------------- */
+/* acquire, run and release MNET_N_RUNS times, interrupted by the
+ * publications */
+static void *mnetWorker(void *arg)
+{
+    ai_float out[MNET_N_SAMPLES];
+    sigset_t alarm;
+    int runs = 0;
+
+    (void)arg;
+    sigemptyset(&alarm);
+    sigaddset(&alarm, SIGALRM);
+    pthread_sigmask(SIG_UNBLOCK, &alarm, NULL);
+    while (runs < MNET_N_RUNS) {
+        ai_handle net = ai_mnetwork_pool_acquire(AI_NETWORK_MODEL_NAME);
+        int slot;
+
+        if (!net) {
+            sched_yield();
+            continue;
+        }
+        slot = mnetSlot(net);
+        if (slot < 0) {
+            mnetCount(&mnet.bad_acquires);
+            ai_mnetwork_pool_release(net);
+            continue;
+        }
+        if (__atomic_add_fetch(&mnet.held[slot], 1, __ATOMIC_SEQ_CST) != 1)
+            mnetCount(&mnet.bad_acquires);
+        /* the other threads run while the instance is owned, on a single
+         * cpu too */
+        sched_yield();
+        memset(out, 0, sizeof(out));
+        if (!mnetRun(net, mnet.in, out, MNET_N_SAMPLES) ||
+                !(mnetMatches(out, mnet.ref[0], MNET_N_SAMPLES) ||
+                  mnetMatches(out, mnet.ref[1], MNET_N_SAMPLES)))
+            mnetCount(&mnet.bad_runs);
+        sched_yield();
+        __atomic_sub_fetch(&mnet.held[slot], 1, __ATOMIC_SEQ_CST);
+        if (!ai_mnetwork_pool_release(net))
+            mnetCount(&mnet.bad_releases);
+        runs++;
+    }
+    return NULL;
+}
+
+/* destroy random instances until the workers are done, each destroyed
+ * instance is created again (in the slot it freed) */
+static void *mnetDestroyer(void *arg)
+{
+    unsigned int seed = 1;
+
+    (void)arg;
+    while (!__atomic_load_n(&mnet.done, __ATOMIC_ACQUIRE)) {
+        const int slot = (int)(rand_r(&seed) % MNET_N_INSTANCES);
+        ai_handle net = mnet.net[slot];
+        ai_error err;
+
+        if (ai_mnetwork_destroy(net) != AI_HANDLE_NULL) {
+            sched_yield();
+            continue;
+        }
+        if (__atomic_load_n(&mnet.held[slot], __ATOMIC_SEQ_CST))
+            mnetCount(&mnet.bad_destroys);
+        err = ai_mnetwork_create(AI_NETWORK_MODEL_NAME, &net, NULL);
+        if ((err.type != AI_ERROR_NONE) || (net != mnet.net[slot]) ||
+                !mnetInit(net, mnet.activations[slot])) {
+            mnetCount(&mnet.bad_creates);
+            break;
+        }
+    }
+    return NULL;
+}
+
+/* SIGALRM: publish the next two blobs, at most one handler at a time (the
+ * second publication fails while the interrupted run, if any, uses the blob
+ * published before the current one) */
+static void mnetPublish(int sig)
+{
+    ai_u32 idle = 0;
+
+    (void)sig;
+    if (!__atomic_compare_exchange_n(&mnet.publishing, &idle, 1, false,
+            __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+        return;
+    for (int i = 0; i < 2; i++) {
+        const ai_u32 k = mnet.published + 1;
+        if (!ai_mnetwork_weights_publish(mnet.publisher, mnetBlob(k)))
+            break;
+        /* the blob published before the previous one is released */
+        mnetPoison(k + 1);
+        mnet.published = k;
+    }
+    __atomic_store_n(&mnet.publishing, 0, __ATOMIC_RELEASE);
+}
+
+/* -------------------------------------------------------------------------- */
+/* ownership of the instances, single thread */
+static void mnetCheckOwnership(void)
+{
+    ai_float out[MNET_N_SAMPLES];
+    ai_handle acquired[MNET_N_INSTANCES];
+    char what[64];
+    ai_error err;
+
+    for (int i = 0; i < MNET_N_INSTANCES; i++) {
+        acquired[i] = ai_mnetwork_pool_acquire(AI_NETWORK_MODEL_NAME);
+        checkTrue("acquire", mnetSlot(acquired[i]) >= 0);
+        for (int j = 0; j < i; j++)
+            checkTrue("acquired twice", acquired[i] != acquired[j]);
+    }
+    checkTrue("acquire from an empty pool",
+            ai_mnetwork_pool_acquire(AI_NETWORK_MODEL_NAME) == AI_HANDLE_NULL);
+
+    for (int i = 0; i < MNET_N_INSTANCES; i++) {
+        checkTrue("destroy an acquired instance",
+                ai_mnetwork_destroy(acquired[i]) == acquired[i]);
+        memset(out, 0, sizeof(out));
+        checkTrue("run", mnetRun(acquired[i], mnet.in, out, MNET_N_SAMPLES));
+        snprintf(what, sizeof(what), "instance %d outputs", i);
+        checkFloats(what, out, mnet.ref[0], MNET_N_SAMPLES, MNET_TOL);
+        checkTrue("release", ai_mnetwork_pool_release(acquired[i]));
+        checkTrue("release twice", !ai_mnetwork_pool_release(acquired[i]));
+    }
+
+    /* released: destroyed, its slot is the one created next */
+    checkTrue("destroy", ai_mnetwork_destroy(mnet.net[0]) == AI_HANDLE_NULL);
+    checkTrue("release a destroyed instance",
+            ai_mnetwork_pool_release(mnet.net[0]) == false);
+    err = ai_mnetwork_create(AI_NETWORK_MODEL_NAME, &acquired[0], NULL);
+    checkTrue("create again", (err.type == AI_ERROR_NONE) &&
+            (acquired[0] == mnet.net[0]));
+    checkTrue("init again", mnetInit(mnet.net[0], mnet.activations[0]));
+}
+
+/* publications, single thread */
+static void mnetCheckPublish(void)
+{
+    ai_mnetwork_weights_header *header =
+            (ai_mnetwork_weights_header *)mnet.blob[0];
+    ai_float out[MNET_N_SAMPLES];
+    ai_handle net;
+
+    /* rejected: blob[0] is not published before the race */
+    mnetBlob(1);
+    checkTrue("publish a misaligned blob",
+            !ai_mnetwork_weights_publish(mnet.net[0], mnet.blob[1] + 2));
+    mnetBlob(0);
+    header->checksum ^= 1;
+    checkTrue("publish a wrong checksum",
+            !ai_mnetwork_weights_publish(mnet.net[0], header));
+    mnetBlob(0);
+    header->signature[0] ^= 1;
+    checkTrue("publish a wrong signature",
+            !ai_mnetwork_weights_publish(mnet.net[0], header));
+    mnetBlob(0);
+    header->size += sizeof(ai_float);
+    checkTrue("publish a wrong size",
+            !ai_mnetwork_weights_publish(mnet.net[0], header));
+
+    /* an instance, acquired or not, switches before its next run */
+    checkTrue("publish", ai_mnetwork_weights_publish(mnet.net[0],
+            mnetBlob(++mnet.published)));
+    memset(out, 0, sizeof(out));
+    checkTrue("run", mnetRun(mnet.net[1], mnet.in, out, MNET_N_SAMPLES));
+    checkFloats("published outputs", out, mnet.ref[1], MNET_N_SAMPLES,
+            MNET_TOL);
+    net = ai_mnetwork_pool_acquire(AI_NETWORK_MODEL_NAME);
+    checkTrue("publish", ai_mnetwork_weights_publish(mnet.net[0],
+            mnetBlob(++mnet.published)));
+    memset(out, 0, sizeof(out));
+    checkTrue("run", mnetRun(net, mnet.in, out, MNET_N_SAMPLES));
+    checkFloats("published outputs (acquired)", out, mnet.ref[0],
+            MNET_N_SAMPLES, MNET_TOL);
+    checkTrue("release", ai_mnetwork_pool_release(net));
+}
+
+/* workers, destroyer and publications */
+static void mnetCheckRace(void)
+{
+    struct itimerval period = {
+            { 0, MNET_PUBLISH_US }, { 0, MNET_PUBLISH_US } };
+    struct itimerval stop = { { 0, 0 }, { 0, 0 } };
+    pthread_t workers[MNET_N_WORKERS];
+    pthread_t destroyer;
+    ai_float out[MNET_N_SAMPLES];
+    sigset_t alarm, mask;
+    int n_workers = 0;
+    bool destroying;
+    int slot;
+
+    /* the instance of the publications can not be destroyed */
+    mnet.publisher = ai_mnetwork_pool_acquire(AI_NETWORK_MODEL_NAME);
+    slot = mnetSlot(mnet.publisher);
+    checkTrue("acquire", slot >= 0);
+    if (slot < 0)
+        return;
+    mnet.held[slot] = 1;
+
+    /* only the workers take the signal */
+    sigemptyset(&alarm);
+    sigaddset(&alarm, SIGALRM);
+    pthread_sigmask(SIG_BLOCK, &alarm, &mask);
+    signal(SIGALRM, mnetPublish);
+    setitimer(ITIMER_REAL, &period, NULL);
+
+    destroying = !pthread_create(&destroyer, NULL, mnetDestroyer, NULL);
+    checkTrue("destroyer thread", destroying);
+    for (int i = 0; i < MNET_N_WORKERS; i++) {
+        if (pthread_create(&workers[n_workers], NULL, mnetWorker, NULL))
+            break;
+        n_workers++;
+    }
+    checkTrue("worker threads", n_workers == MNET_N_WORKERS);
+    for (int i = 0; i < n_workers; i++)
+        pthread_join(workers[i], NULL);
+    __atomic_store_n(&mnet.done, 1, __ATOMIC_RELEASE);
+    if (destroying)
+        pthread_join(destroyer, NULL);
+
+    /* a pending signal is discarded */
+    setitimer(ITIMER_REAL, &stop, NULL);
+    signal(SIGALRM, SIG_IGN);
+    pthread_sigmask(SIG_SETMASK, &mask, NULL);
+    checkTrue("race: publications", mnet.published > 2);
+    /* the compiled-in weights are published last */
+    if (mnet.published & 1)
+        checkTrue("race: last publication", ai_mnetwork_weights_publish(
+                mnet.publisher, mnetBlob(++mnet.published)));
+    mnet.held[slot] = 0;
+    checkTrue("release", ai_mnetwork_pool_release(mnet.publisher));
+
+    checkTrue("race: runs off the reference", mnet.bad_runs == 0);
+    checkTrue("race: instance acquired twice", mnet.bad_acquires == 0);
+    checkTrue("race: release failed", mnet.bad_releases == 0);
+    checkTrue("race: acquired instance destroyed", mnet.bad_destroys == 0);
+    checkTrue("race: instance not created again", mnet.bad_creates == 0);
+
+    memset(out, 0, sizeof(out));
+    checkTrue("run", mnetRun(mnet.publisher, mnet.in, out, MNET_N_SAMPLES));
+    checkFloats("outputs after the race", out, mnet.ref[0], MNET_N_SAMPLES,
+            MNET_TOL);
+}
+
+/* -------------------------------------------------------------------------- */
+void checkMnetwork(void)
+{
+    ai_network_report report;
+    ai_u32 act_addr, act_size;
+    bool ready = true;
+    ai_error err;
+
+    memset(&mnet, 0, sizeof(mnet));
+    checkFill(mnet.in, MNET_N_SAMPLES);
+    memcpy(mnet.weights[0], ai_network_data_weights_get(),
+            AI_NETWORK_DATA_WEIGHTS_SIZE);
+    checkFill(mnet.weights[1], MNET_N_WEIGHTS);
+    for (int i = 0; i < 2; i++)
+        mnetRef(mnet.ref[i], mnet.weights[i], mnet.in, MNET_N_SAMPLES);
+
+    for (int i = 0; (i < MNET_N_INSTANCES) && ready; i++) {
+        err = ai_mnetwork_create(AI_NETWORK_MODEL_NAME, &mnet.net[i], NULL);
+        ready = (err.type == AI_ERROR_NONE) &&
+                !ai_mnetwork_get_ext_data_activations(mnet.net[i], &act_addr,
+                        &act_size);
+        if (ready) {
+            mnet.activations[i] = aligned_alloc(64, (act_size + 64) & ~63u);
+            ready = mnet.activations[i] &&
+                    mnetInit(mnet.net[i], mnet.activations[i]);
+        }
+    }
+    checkTrue("instances", ready);
+    if (ready) {
+        ready = ai_mnetwork_get_info(mnet.net[0], &report) &&
+                report.model_signature;
+        mnet.signature = report.model_signature;
+        checkTrue("signature", ready);
+    }
+
+    if (ready) {
+        mnetCheckOwnership();
+        mnetCheckPublish();
+        mnetCheckRace();
+    }
+
+    for (int i = 0; i < MNET_N_INSTANCES; i++) {
+        if (mnet.net[i])
+            checkTrue("destroy",
+                    ai_mnetwork_destroy(mnet.net[i]) == AI_HANDLE_NULL);
+        free(mnet.activations[i]);
+    }
+}
@@ -0,0 +1,411 @@
+/**
+  ******************************************************************************
+  * @file    checkPlan.c
+  * @brief   Checks of the activations planner
+  ******************************************************************************
+  * @attention
+  *
+  * core_plan_pack on random buffer sets: aligned offsets, buffers alive at
+  * the same c-node never overlap, the arena lies between the peak of the
+  * live sizes and their sum. core_plan_activations on small layer chains
+  * (pointwise nonlinearities, add and eltwise with broadcast operands, a
+  * softmax): two arrays alive at the same c-node only share memory when the
+  * output of a pointwise node is aliased on an input of the same size dying
+  * at this node which is neither the network input nor an array starting
+  * after its data_start; the planned run gives the outputs of the generated
+  * (unplanned) layout.
+  *
+  ******************************************************************************
+  */
+
+/* System headers */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+/* AI header files */
+#include "core_plan.h"
+#include "core_network.h"
+#include "layers_generic.h"
+#include "layers_nl.h"
+#include "ai_math_helpers.h"
+
+#include "aiCheck.h"
+
+/* random buffer sets: buffers, c-nodes, largest buffer (bytes) */
+struct plan_set {
+    ai_size n_buffers;
+    ai_u16 n_nodes;
+    ai_size max_size;
+};
+
+static const struct plan_set plan_sets[] = {
+    {   1,   1,    64 },
+    {   2,   2,    13 },
+    {   5,   4,   100 },
+    {  17,  12,  4096 },
+    {  64,  40,  1000 },
+    { 200, 100, 65536 },
+};
+
+#define PLAN_N_SETS     (sizeof(plan_sets) / sizeof(plan_sets[0]))
+#define PLAN_SET_REPEAT (8)
+
+#define PLAN_ALIGNED(size_) \
+    (((size_) + AI_PLAN_ALIGN - 1) & ~(ai_size)(AI_PLAN_ALIGN - 1))
+
+/* -------------------------------------------------------------------------- */
+static bool planOverlap(ai_size a0, ai_size a1, ai_size b0, ai_size b1)
+{
+    return (a0 < b1) && (b0 < a1);
+}
+
+static void planCheckSet(const struct plan_set *s, int repeat)
+{
+    ai_plan_buffer *b = malloc(s->n_buffers * sizeof(ai_plan_buffer));
+    ai_size peak = 0, sum = 0, arena;
+    long bad_overlap = 0, bad_align = 0;
+    int32_t out, ref;
+    char what[64];
+
+    for (ai_size i = 0; i < s->n_buffers; i++) {
+        const ai_u16 first = (ai_u16)checkRandInt(0, s->n_nodes - 1);
+        b[i].size = (ai_size)checkRandInt(1, (int32_t)s->max_size);
+        b[i].first = first;
+        b[i].last = (ai_u16)checkRandInt(first, AI_MIN(s->n_nodes - 1,
+                first + 3));
+        b[i].offset = 0xdead;
+        sum += PLAN_ALIGNED(b[i].size);
+    }
+    arena = core_plan_pack(b, s->n_buffers);
+
+    for (ai_u16 c = 0; c < s->n_nodes; c++) {
+        ai_size live = 0;
+        for (ai_size i = 0; i < s->n_buffers; i++) {
+            if ((b[i].first <= c) && (c <= b[i].last))
+                live += b[i].size;
+        }
+        peak = AI_MAX(peak, live);
+    }
+    for (ai_size i = 0; i < s->n_buffers; i++) {
+        if ((b[i].offset % AI_PLAN_ALIGN) || (b[i].offset + b[i].size > arena))
+            bad_align++;
+        for (ai_size j = i + 1; j < s->n_buffers; j++) {
+            if ((b[i].first <= b[j].last) && (b[j].first <= b[i].last) &&
+                    planOverlap(b[i].offset, b[i].offset + b[i].size,
+                    b[j].offset, b[j].offset + b[j].size))
+                bad_overlap++;
+        }
+    }
+
+    snprintf(what, sizeof(what), "pack %u buffers #%d overlaps",
+            (unsigned)s->n_buffers, repeat);
+    checkTrue(what, bad_overlap == 0);
+    snprintf(what, sizeof(what), "pack %u buffers #%d offsets",
+            (unsigned)s->n_buffers, repeat);
+    checkTrue(what, bad_align == 0);
+    snprintf(what, sizeof(what), "pack %u buffers #%d arena",
+            (unsigned)s->n_buffers, repeat);
+    checkTrue(what, (arena >= peak) && (arena <= sum) &&
+            !(arena % AI_PLAN_ALIGN));
+    out = (int32_t)arena;
+    ref = (int32_t)arena;
+    checkInts(what, &out, &ref, 1, 0);
+    free(b);
+}
+
+/* -------------------------------------------------------------------------- */
+#define PLAN_MAX_TENSORS    (8)
+#define PLAN_MAX_NODES      (6)
+
+/* floats between data_start and data of a shifted array */
+#define PLAN_SHIFT          (4)
+
+/* a node of a chain: inputs and output (tensor indices, in[1] -1 if none) */
+struct plan_node {
+    layer_forward_func forward;
+    func_binary op;             /* eltwise operation */
+    bool pointwise;             /* may be aliased (see core_plan.c) */
+    int in[2];
+    int out;
+};
+
+/*
+ * A chain: tensor 0 is the network input, output the network output, both
+ * in the activations; a constant operand (-1 if none) is not planned, a
+ * shifted array (-1 if none) has its data PLAN_SHIFT floats after its
+ * data_start.
+ */
+struct plan_chain {
+    const char *name;
+    ai_size sizes[PLAN_MAX_TENSORS];    /* floats, 0 past the last tensor */
+    struct plan_node nodes[PLAN_MAX_NODES];
+    int n_nodes;
+    int output;
+    int constant;
+    int shifted;
+    int n_aliases;                      /* expected aliased outputs */
+};
+
+#define PLAN_NL(f_, in_, out_)      { f_, NULL, true, { in_, -1 }, out_ }
+#define PLAN_ADD(a_, b_, out_)      { forward_add, NULL, true, { a_, b_ }, out_ }
+#define PLAN_ELTWISE(op_, a_, b_, out_) \
+    { forward_eltwise, op_, true, { a_, b_ }, out_ }
+
+static const struct plan_chain plan_chains[] = {
+    /* a chain of pointwise nodes on a single buffer, except the input */
+    { "chain", { 64, 64, 64, 64, 64, 16 }, {
+        PLAN_NL(forward_relu, 0, 1),
+        PLAN_NL(forward_tanh, 1, 2),
+        PLAN_ADD(2, 5, 3),
+        PLAN_ELTWISE(ai_max, 3, 0, 4),
+      }, 4, 4, 5, -1, 3 },
+    /* t1 is used after the sigmoid, the softmax is not pointwise */
+    { "skip", { 32, 32, 32, 32, 32, 32 }, {
+        PLAN_NL(forward_neg, 0, 1),
+        PLAN_NL(forward_sigmoid, 1, 2),
+        PLAN_ADD(1, 2, 3),
+        { forward_sm, NULL, false, { 3, -1 }, 4 },
+        PLAN_NL(forward_exp, 4, 5),
+      }, 5, 5, -1, -1, 2 },
+    /* broadcast operands: 16 floats against 64, only the full size input
+     * holds the output */
+    { "broadcast", { 16, 16, 64, 64, 64, 64 }, {
+        PLAN_NL(forward_abs, 0, 1),
+        PLAN_ELTWISE(ai_sub, 1, 2, 3),
+        PLAN_ADD(3, 1, 4),
+        PLAN_ELTWISE(ai_mul, 1, 4, 5),
+      }, 4, 5, 2, -1, 2 },
+    /* broadcast operand of the add computed in the activations */
+    { "broadcast_act", { 16, 16, 64, 64, 64 }, {
+        PLAN_NL(forward_relu, 0, 1),
+        PLAN_ELTWISE(ai_mul, 2, 1, 3),
+        PLAN_ADD(1, 3, 4),
+      }, 3, 4, 2, -1, 1 },
+    /* the shifted output and input are never aliased */
+    { "shifted", { 32, 32, 32, 32, 32 }, {
+        PLAN_NL(forward_neg, 0, 1),
+        PLAN_NL(forward_relu, 1, 2),
+        PLAN_NL(forward_tanh, 2, 3),
+        PLAN_ELTWISE(ai_max, 3, 0, 4),
+      }, 4, 4, -1, 1, 2 },
+};
+
+#define PLAN_N_CHAINS   (sizeof(plan_chains) / sizeof(plan_chains[0]))
+
+/* the layers and tensors of a chain */
+struct plan_net {
+    const struct plan_chain *c;
+    int n_tensors;
+    struct check_tensor t[PLAN_MAX_TENSORS];
+    ai_u16 first[PLAN_MAX_TENSORS], last[PLAN_MAX_TENSORS];
+    union {
+        ai_layer_nl nl;
+        ai_layer_add add;
+        ai_layer_eltwise eltwise;
+    } layers[PLAN_MAX_NODES];
+    ai_tensor *refs[PLAN_MAX_NODES][3];
+    ai_tensor_list lists[PLAN_MAX_NODES][AI_TENSOR_CHAIN_SIZE];
+    ai_tensor_chain chains[PLAN_MAX_NODES];
+    ai_tensor *io_refs[2];
+    ai_tensor_list io_lists[2];
+    uint8_t *activations;
+    ai_size avail;
+    ai_float *constant;
+};
+
+static ai_size planBytes(const struct plan_net *p, int t)
+{
+    return (p->c->sizes[t] + ((t == p->c->shifted) ? PLAN_SHIFT : 0)) *
+            sizeof(ai_float);
+}
+
+/* generated layout: the arrays one after the other in the activations */
+static void planNetInit(struct plan_net *p, const struct plan_chain *c)
+{
+    ai_network *net = checkNetwork();
+    ai_size offset = 0;
+
+    memset(p, 0, sizeof(*p));
+    p->c = c;
+    while ((p->n_tensors < PLAN_MAX_TENSORS) && c->sizes[p->n_tensors])
+        p->n_tensors++;
+    for (int t = 0; t < p->n_tensors; t++)
+        p->avail += planBytes(p, t);
+    p->activations = aligned_alloc(64, (p->avail + 63) & ~(ai_size)63);
+
+    for (int t = 0; t < p->n_tensors; t++) {
+        const ai_size shift = (t == c->shifted) ? PLAN_SHIFT : 0;
+        ai_float *start = (ai_float *)(p->activations + offset);
+
+        if (t == c->constant) {
+            p->constant = malloc(c->sizes[t] * sizeof(ai_float));
+            checkFill(p->constant, c->sizes[t]);
+            start = p->constant;
+        } else
+            offset += planBytes(p, t);
+        checkTensorInit(&p->t[t], AI_ARRAY_FORMAT_FLOAT, start + shift,
+                c->sizes[t], 1, (ai_i32)c->sizes[t], 1, 1, NULL);
+        p->t[t].array.data_start = AI_PTR(start);
+        if (t == c->constant)
+            p->t[t].array.format |= AI_FMT_FLAG_CONST;
+        p->first[t] = 0xFFFF;
+    }
+
+    for (int k = 0; k < c->n_nodes; k++) {
+        const struct plan_node *n = &c->nodes[k];
+        const ai_u16 n_in = (n->in[1] >= 0) ? 2 : 1;
+        ai_node *node = (ai_node *)&p->layers[k];
+        ai_tensor **refs = p->refs[k];
+
+        refs[0] = &p->t[n->in[0]].tensor;
+        refs[1] = (n_in > 1) ? &p->t[n->in[1]].tensor : NULL;
+        refs[n_in] = &p->t[n->out].tensor;
+        p->lists[k][AI_TENSOR_CHAIN_INPUT] = (ai_tensor_list) {
+            .size = n_in, .flags = AI_FLAG_NONE, .tensor = refs };
+        p->lists[k][AI_TENSOR_CHAIN_OUTPUT] = (ai_tensor_list) {
+            .size = 1, .flags = AI_FLAG_NONE, .tensor = refs + n_in };
+        p->lists[k][AI_TENSOR_CHAIN_WEIGHTS] = (ai_tensor_list) {
+            .size = 0, .flags = AI_FLAG_NONE, .tensor = refs + n_in + 1 };
+        p->lists[k][AI_TENSOR_CHAIN_SCRATCH] = (ai_tensor_list) {
+            .size = 0, .flags = AI_FLAG_NONE, .tensor = refs + n_in + 1 };
+        p->chains[k] = (ai_tensor_chain) {
+            .size = AI_TENSOR_CHAIN_SIZE, .flags = AI_FLAG_NONE,
+            .chain = p->lists[k] };
+
+        node->network = net;
+        node->forward = n->forward;
+        node->tensors = &p->chains[k];
+        node->next = (k + 1 < c->n_nodes) ? (ai_node *)&p->layers[k + 1] :
+                node;
+        if (n->forward == forward_eltwise)
+            p->layers[k].eltwise.operation = n->op;
+
+        /* lifetimes, as seen by the planner */
+        for (int i = 0; i < 3; i++) {
+            const int t = (i < 2) ? n->in[i] : n->out;
+            if (t < 0)
+                continue;
+            p->first[t] = AI_MIN(p->first[t], (ai_u16)k);
+            p->last[t] = AI_MAX(p->last[t], (ai_u16)k);
+        }
+    }
+    /* the network input is valid from the first node, the output up to
+     * the last one */
+    p->first[0] = 0;
+    p->last[c->output] = (ai_u16)(c->n_nodes - 1);
+
+    p->io_refs[0] = &p->t[0].tensor;
+    p->io_refs[1] = &p->t[c->output].tensor;
+    for (int l = 0; l < 2; l++)
+        p->io_lists[l] = (ai_tensor_list) {
+            .size = 1, .flags = AI_FLAG_NONE, .tensor = &p->io_refs[l] };
+}
+
+static void planNetRun(struct plan_net *p, const ai_float *in, ai_float *out)
+{
+    const struct plan_chain *c = p->c;
+
+    memcpy(AI_ARRAY_OBJ_DATA(&p->t[0].array, ai_float), in,
+            c->sizes[0] * sizeof(ai_float));
+    for (int k = 0; k < c->n_nodes; k++)
+        c->nodes[k].forward((ai_layer *)&p->layers[k]);
+    memcpy(out, AI_ARRAY_OBJ_DATA(&p->t[c->output].array, ai_float),
+            c->sizes[c->output] * sizeof(ai_float));
+}
+
+/* two arrays alive at the same node may only share memory as the input and
+ * the output of a pointwise node, the input dying there */
+static bool planIsAlias(const struct plan_net *p, int a, int b)
+{
+    const struct plan_chain *c = p->c;
+
+    for (int k = 0; k < c->n_nodes; k++) {
+        const struct plan_node *n = &c->nodes[k];
+        if (!n->pointwise || (n->out != b) || (p->first[b] != k))
+            continue;
+        if ((n->in[0] != a) && (n->in[1] != a))
+            continue;
+        return (p->last[a] == k) && (planBytes(p, a) == planBytes(p, b)) &&
+                (a != 0) && (a != c->shifted) && (b != c->shifted) &&
+                (p->t[a].array.data_start == p->t[b].array.data_start);
+    }
+    return false;
+}
+
+static void planCheckChain(const struct plan_chain *c)
+{
+    ai_network *net = checkNetwork();
+    ai_size *arena_size = core_network_get_arena_size(net);
+    const ai_network saved = *net;
+    const ai_size saved_arena = *arena_size;
+    ai_float in[64], ref[64], out[64];
+    struct plan_net p;
+    long bad = 0;
+    int32_t n_aliases = 0;
+    ai_size planned;
+    char what[64];
+
+    planNetInit(&p, c);
+    checkFill(in, c->sizes[0]);
+    memset(p.activations, 0xff, p.avail);
+    planNetRun(&p, in, ref);
+
+    net->activations = (ai_buffer)AI_BUFFER_OBJ_INIT(AI_BUFFER_FORMAT_U8,
+            1, 1, p.avail, 1, p.activations);
+    net->input_node = (ai_node *)&p.layers[0];
+    net->tensors = (ai_tensor_chain) {
+        .size = 2, .flags = AI_FLAG_NONE, .chain = p.io_lists };
+    planned = core_plan_activations(net);
+    *net = saved;
+    *arena_size = saved_arena;
+
+    snprintf(what, sizeof(what), "%s planned", c->name);
+    checkTrue(what, (planned != AI_PLAN_SIZE_NONE) && (planned <= p.avail));
+
+    /* memory shared by arrays alive at the same node */
+    for (int a = 0; a < p.n_tensors; a++) {
+        for (int b = 0; b < p.n_tensors; b++) {
+            const uint8_t *a0 = AI_PTR(p.t[a].array.data_start);
+            const uint8_t *b0 = AI_PTR(p.t[b].array.data_start);
+            if ((a == b) || (a == c->constant) || (b == c->constant) ||
+                    (p.first[a] > p.last[b]) || (p.first[b] > p.last[a]) ||
+                    !planOverlap((ai_size)(a0 - p.activations),
+                    (ai_size)(a0 - p.activations) + planBytes(&p, a),
+                    (ai_size)(b0 - p.activations),
+                    (ai_size)(b0 - p.activations) + planBytes(&p, b)))
+                continue;
+            if (planIsAlias(&p, a, b))
+                n_aliases++;
+            else if (!planIsAlias(&p, b, a) && !bad++)
+                printf("    %s: t%d and t%d share memory\n", c->name, a, b);
+        }
+    }
+    snprintf(what, sizeof(what), "%s live arrays overlap", c->name);
+    checkTrue(what, bad == 0);
+    snprintf(what, sizeof(what), "%s aliased outputs", c->name);
+    checkInts(what, &n_aliases, &c->n_aliases, 1, 0);
+
+    /* planned layout: the outputs of the generated one */
+    memset(p.activations, 0xff, p.avail);
+    planNetRun(&p, in, out);
+    snprintf(what, sizeof(what), "%s outputs", c->name);
+    checkFloats(what, out, ref, c->sizes[c->output], 0.0);
+
+    free(p.activations);
+    free(p.constant);
+}
+
+/* -------------------------------------------------------------------------- */
+void checkPlan(void)
+{
+    checkTrue("pack no buffer", core_plan_pack(NULL, 0) == 0);
+    for (size_t i = 0; i < PLAN_N_SETS; i++) {
+        for (int r = 0; r < PLAN_SET_REPEAT; r++)
+            planCheckSet(&plan_sets[i], r);
+    }
+    for (size_t i = 0; i < PLAN_N_CHAINS; i++)
+        planCheckChain(&plan_chains[i]);
+}
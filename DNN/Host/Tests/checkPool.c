@@ -0,0 +1,461 @@
+/**
+  ******************************************************************************
+  * @file    checkPool.c
+  * @brief   Checks of the pooling kernels and layers
+  ******************************************************************************
+  * @attention
+  *
+  * Max and average pooling (windows reduced in registers, clipped borders,
+  * global pooling, channels beyond AI_POOL_ACC_CHUNK) against a naive
+  * reference: float, 8-bits integer (in the input quantization, then
+  * requantized once from the int32 sums by the layers) and 8/16-bits fixed
+  * point with different input and output formats.
+  *
+  ******************************************************************************
+  */
+
+/* System headers */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+/* AI header files */
+#include "layers_pool.h"
+
+#include "aiCheck.h"
+
+/* h x w x ch inputs, k x k windows */
+struct pool_case {
+    ai_i32 in_h, in_w, ch, k, stride, pad, n_batches;
+};
+
+static const struct pool_case pool_cases[] = {
+    /*  h    w   ch    k  s  p  b */
+    {   8,   8,    3,  2, 2, 0, 2 },
+    {   7,   9,   17,  3, 2, 1, 1 },
+    {  10,  10,   40,  3, 1, 1, 2 },
+    {   7,   7,   33,  7, 1, 0, 1 },
+    {  11,  13,  300,  4, 3, 1, 1 },
+    {   6,   6,  600,  6, 1, 0, 1 },
+    {   9,   5,   16,  3, 2, 0, 1 },
+    {  14,  14,   64, 14, 1, 0, 2 },
+};
+
+#define POOL_N_CASES    (sizeof(pool_cases) / sizeof(pool_cases[0]))
+
+#define POOL_TOL_F32    (1e-6)
+
+/* a pooling layer and its tensors (no compound literal: the chain and the
+ * pads outlive poolLayerInit) */
+struct pool_layer {
+    struct check_tensor t_in, t_out;
+    ai_shape_dimension pad[4];
+    ai_tensor *io[3];       /* input, output, none */
+    ai_tensor_list lists[4];
+    ai_tensor_chain chain;
+    ai_layer_pool l;
+};
+
+/* -------------------------------------------------------------------------- */
+static ai_i32 poolOut(const struct pool_case *c, ai_i32 in)
+{
+    return checkConvOut(in, c->k, c->stride, c->pad, 1);
+}
+
+/*
+ * reference of one sample: the max or the sum of the valid positions of
+ * each window, with the number of positions of the average (the window
+ * size if count_pad, 0 for an empty window)
+ */
+static void poolRef(double *acc, ai_i32 *n, const double *in,
+        const struct pool_case *c, bool is_max, bool count_pad)
+{
+    const ai_i32 out_h = poolOut(c, c->in_h);
+    const ai_i32 out_w = poolOut(c, c->in_w);
+
+    for (ai_i32 oy = 0; oy < out_h; oy++) {
+        for (ai_i32 ox = 0; ox < out_w; ox++) {
+            for (ai_i32 o = 0; o < c->ch; o++) {
+                double a = 0.0;
+                ai_i32 n_valid = 0;
+                for (ai_i32 ky = 0; ky < c->k; ky++) {
+                    const ai_i32 y = oy * c->stride - c->pad + ky;
+                    for (ai_i32 kx = 0; kx < c->k; kx++) {
+                        const ai_i32 x = ox * c->stride - c->pad + kx;
+                        if ((y < 0) || (y >= c->in_h) || (x < 0) ||
+                                (x >= c->in_w))
+                            continue;
+                        const double v = in[((size_t)y * c->in_w + x) *
+                                c->ch + o];
+                        if (!n_valid++)
+                            a = v;
+                        else
+                            a = is_max ? fmax(a, v) : a + v;
+                    }
+                }
+                *acc++ = a;
+                *n++ = (n_valid && count_pad) ? c->k * c->k : n_valid;
+            }
+        }
+    }
+}
+
+static void poolLayerInit(struct pool_layer *p, const struct pool_case *c,
+        ai_array_format fmt, void *in, void *out, ai_intq_info_list *q_in,
+        ai_intq_info_list *q_out, bool count_pad)
+{
+    const size_t in_size = (size_t)c->in_h * c->in_w * c->ch;
+    const size_t out_size = (size_t)poolOut(c, c->in_h) *
+            poolOut(c, c->in_w) * c->ch;
+
+    checkTensorInit(&p->t_in, fmt, in, c->n_batches * in_size,
+            1, c->ch, c->in_w, c->in_h, q_in);
+    checkTensorInit(&p->t_out, fmt, out, c->n_batches * out_size,
+            1, c->ch, poolOut(c, c->in_w), poolOut(c, c->in_h), q_out);
+    p->io[0] = &p->t_in.tensor;
+    p->io[1] = &p->t_out.tensor;
+    p->io[2] = NULL;
+    for (int i = 0; i < 4; i++) {
+        p->lists[i] = (ai_tensor_list){ .size = (i < 2) ? 1 : 0,
+                .flags = AI_FLAG_NONE, .tensor = &p->io[(i < 2) ? i : 2],
+                .info = NULL };
+    }
+    p->chain = (ai_tensor_chain){ .size = 4, .flags = AI_FLAG_NONE,
+            .chain = p->lists };
+    memset(&p->l, 0, sizeof(p->l));
+    p->l.network = checkNetwork();
+    p->l.tensors = &p->chain;
+    p->l.pool_size = (ai_shape_2d)AI_SHAPE_2D_INIT(c->k, c->k);
+    p->l.pool_stride = (ai_shape_2d)AI_SHAPE_2D_INIT(c->stride, c->stride);
+    for (int i = 0; i < 4; i++)
+        p->pad[i] = c->pad;
+    p->l.pool_pad = (ai_shape)AI_SHAPE_INIT_FROM_BUFFER(4, p->pad);
+    p->l.count_include_pad = count_pad;
+}
+
+/* -------------------------------------------------------------------------- */
+static void poolCheckF32(const struct pool_case *c, bool is_max)
+{
+    const ai_i32 out_h = poolOut(c, c->in_h);
+    const ai_i32 out_w = poolOut(c, c->in_w);
+    const size_t in_size = (size_t)c->in_h * c->in_w * c->ch;
+    const size_t out_size = (size_t)out_h * out_w * c->ch;
+    const size_t n_out = c->n_batches * out_size;
+
+    ai_float *in = malloc(c->n_batches * in_size * sizeof(ai_float));
+    double *in_d = malloc(in_size * sizeof(double));
+    double *acc = malloc(out_size * sizeof(double));
+    ai_i32 *n = malloc(out_size * sizeof(ai_i32));
+    ai_float *out = malloc(n_out * sizeof(ai_float));
+    ai_float *ref = malloc(n_out * sizeof(ai_float));
+    ai_float *ref_pad = malloc(n_out * sizeof(ai_float));
+    struct pool_layer p;
+    char what[64];
+
+    checkFill(in, c->n_batches * in_size);
+    for (ai_i32 b = 0; b < c->n_batches; b++) {
+        for (size_t i = 0; i < in_size; i++)
+            in_d[i] = in[b * in_size + i];
+        for (int count_pad = 0; count_pad < 2; count_pad++) {
+            ai_float *r = (count_pad ? ref_pad : ref) + b * out_size;
+            poolRef(acc, n, in_d, c, is_max, count_pad);
+            for (size_t i = 0; i < out_size; i++)
+                r[i] = (ai_float)((is_max || !n[i]) ? acc[i] : acc[i] / n[i]);
+        }
+    }
+
+    snprintf(what, sizeof(what), "f32 %s %dx%dx%d k%d s%d p%d",
+            is_max ? "max" : "avg", (int)c->in_h, (int)c->in_w, (int)c->ch,
+            (int)c->k, (int)c->stride, (int)c->pad);
+    memset(out, 0, n_out * sizeof(ai_float));
+    for (ai_i32 b = 0; b < c->n_batches; b++) {
+        (is_max ? pool_func_mp_array_f32 : pool_func_ap_array_f32)(
+                in + b * in_size, c->in_w, c->in_h, c->ch, c->k, c->k,
+                c->pad, c->pad, c->stride, c->stride, out_w, out_h,
+                out + b * out_size);
+    }
+    checkFloats(what, out, ref, n_out, POOL_TOL_F32);
+
+    /* layer: all the samples, the padded positions counted by the average */
+    poolLayerInit(&p, c, AI_ARRAY_FORMAT_FLOAT, in, out, NULL, NULL,
+            !is_max);
+    memset(out, 0, n_out * sizeof(ai_float));
+    (is_max ? forward_mp : forward_ap)((ai_layer *)&p.l);
+    checkFloats(what, out, is_max ? ref : ref_pad, n_out, POOL_TOL_F32);
+
+    free(in);
+    free(in_d);
+    free(acc);
+    free(n);
+    free(out);
+    free(ref);
+    free(ref_pad);
+}
+
+/* -------------------------------------------------------------------------- */
+/* 8-bits value of an element, as an int32 */
+static ai_i32 poolI8(const ai_u8 *data, size_t i, bool is_signed)
+{
+    return is_signed ? (ai_i32)((const ai_i8 *)data)[i] : (ai_i32)data[i];
+}
+
+static ai_i32 poolSat8(ai_i32 v, bool is_signed)
+{
+    const ai_i32 lo = is_signed ? -128 : 0;
+    const ai_i32 hi = is_signed ? 127 : 255;
+    return (v < lo) ? lo : (v > hi) ? hi : v;
+}
+
+static void poolCheckI8(const struct pool_case *c, bool is_max,
+        bool is_signed)
+{
+    const ai_i32 out_h = poolOut(c, c->in_h);
+    const ai_i32 out_w = poolOut(c, c->in_w);
+    const size_t in_size = (size_t)c->in_h * c->in_w * c->ch;
+    const size_t out_size = (size_t)out_h * out_w * c->ch;
+    const size_t n_out = c->n_batches * out_size;
+    const ai_array_format fmt = is_signed ? AI_ARRAY_FORMAT_S8 :
+            AI_ARRAY_FORMAT_U8;
+
+    ai_u8 *in = malloc(c->n_batches * in_size);
+    double *in_d = malloc(in_size * sizeof(double));
+    double *acc = malloc(out_size * sizeof(double));
+    ai_i32 *n = malloc(out_size * sizeof(ai_i32));
+    ai_i32 *nv = malloc(out_size * sizeof(ai_i32));
+    ai_u8 *out = malloc(n_out);
+    ai_i32 *out_i = malloc(n_out * sizeof(ai_i32));
+    ai_i32 *ref = malloc(n_out * sizeof(ai_i32));
+    ai_i32 *ref_q = malloc(n_out * sizeof(ai_i32));
+    /* requantized: zero points ai_i8 or ai_u8 */
+    ai_float s_in = 0.04f, s_out = 0.07f;
+    ai_i8 zp_in_s = -7, zp_out_s = 11;
+    ai_u8 zp_in_u = 121, zp_out_u = 133;
+    const ai_i32 zp_in = is_signed ? zp_in_s : zp_in_u;
+    const ai_i32 zp_out = is_signed ? zp_out_s : zp_out_u;
+    const ai_float in_out = s_in / s_out;
+    const ai_u32 zp_flag = is_signed ? AI_BUFFER_META_FLAG_ZEROPOINT_S8 :
+            AI_BUFFER_META_FLAG_ZEROPOINT_U8;
+    ai_intq_info q_in_info = { &s_in,
+            is_signed ? (ai_handle)&zp_in_s : (ai_handle)&zp_in_u };
+    ai_intq_info q_out_info = { &s_out,
+            is_signed ? (ai_handle)&zp_out_s : (ai_handle)&zp_out_u };
+    ai_intq_info_list q_in = { AI_BUFFER_META_FLAG_SCALE_FLOAT | zp_flag, 1,
+            &q_in_info };
+    ai_intq_info_list q_out = { AI_BUFFER_META_FLAG_SCALE_FLOAT | zp_flag, 1,
+            &q_out_info };
+    struct pool_layer p;
+    char what[64];
+
+    for (size_t i = 0; i < c->n_batches * in_size; i++)
+        in[i] = (ai_u8)checkRandInt(0, 255);
+
+    for (ai_i32 b = 0; b < c->n_batches; b++) {
+        for (size_t i = 0; i < in_size; i++)
+            in_d[i] = poolI8(in, b * in_size + i, is_signed);
+        poolRef(acc, nv, in_d, c, is_max, false);
+        poolRef(acc, n, in_d, c, is_max, !is_max);
+        for (size_t i = 0; i < out_size; i++) {
+            const ai_i32 a = (ai_i32)acc[i];
+            ai_i32 *r = ref + b * out_size + i;
+            ai_i32 *rq = ref_q + b * out_size + i;
+            if (!nv[i]) {
+                *r = 0;
+                *rq = zp_out;
+            } else if (is_max) {
+                *r = a;
+                *rq = poolSat8((ai_i32)roundf((ai_float)(a - zp_in) *
+                        in_out) + zp_out, is_signed);
+            } else {
+                /* the padded positions are zp_in, rounded once */
+                *r = (ai_i32)roundf((ai_float)a * (1.0f / (ai_float)nv[i]));
+                *rq = poolSat8((ai_i32)roundf(
+                        (ai_float)(a + (n[i] - nv[i]) * zp_in -
+                        n[i] * zp_in) * (in_out / (ai_float)n[i])) + zp_out,
+                        is_signed);
+            }
+        }
+    }
+
+    snprintf(what, sizeof(what), "%s %s %dx%dx%d k%d s%d p%d",
+            is_signed ? "s8" : "u8", is_max ? "max" : "avg", (int)c->in_h,
+            (int)c->in_w, (int)c->ch, (int)c->k, (int)c->stride,
+            (int)c->pad);
+
+    /* kernels of the data, in the input quantization */
+    func_pool func = is_max ?
+            (is_signed ? pool_func_mp_array_integer_INT8 :
+                    pool_func_mp_array_integer_UINT8) :
+            (is_signed ? pool_func_ap_array_integer_INT8 :
+                    pool_func_ap_array_integer_UINT8);
+    memset(out, 0, n_out);
+    for (ai_i32 b = 0; b < c->n_batches; b++) {
+        func(in + b * in_size, c->in_w, c->in_h, c->ch, c->k, c->k,
+                c->pad, c->pad, c->stride, c->stride, out_w, out_h,
+                out + b * out_size);
+    }
+    for (size_t i = 0; i < n_out; i++)
+        out_i[i] = poolI8(out, i, is_signed);
+    checkInts(what, out_i, ref, n_out, 0);
+
+    /* kernels of the arrays (format read from them), all the samples */
+    poolLayerInit(&p, c, fmt, in, out, NULL, NULL, false);
+    memset(out, 0, n_out);
+    (is_max ? pool_func_mp_array_integer : pool_func_ap_array_integer)(
+            &p.t_in.array, c->in_w, c->in_h, c->ch, c->k, c->k, c->pad,
+            c->pad, c->stride, c->stride, out_w, out_h, &p.t_out.array);
+    for (size_t i = 0; i < n_out; i++)
+        out_i[i] = poolI8(out, i, is_signed);
+    checkInts(what, out_i, ref, n_out, 0);
+
+    /* layers: requantized, the padded positions counted by the average */
+    poolLayerInit(&p, c, fmt, in, out, &q_in, &q_out, !is_max);
+    for (int generic = 0; generic < 2; generic++) {
+        memset(out, 0, n_out);
+        if (generic)
+            (is_max ? forward_mp_integer : forward_ap_integer)(
+                    (ai_layer *)&p.l);
+        else if (is_max)
+            (is_signed ? forward_mp_integer_INT8 : forward_mp_integer_UINT8)(
+                    (ai_layer *)&p.l);
+        else
+            (is_signed ? forward_ap_integer_INT8 : forward_ap_integer_UINT8)(
+                    (ai_layer *)&p.l);
+        for (size_t i = 0; i < n_out; i++)
+            out_i[i] = poolI8(out, i, is_signed);
+        checkInts(what, out_i, ref_q, n_out, 0);
+    }
+
+    free(in);
+    free(in_d);
+    free(acc);
+    free(n);
+    free(nv);
+    free(out);
+    free(out_i);
+    free(ref);
+    free(ref_q);
+}
+
+/* -------------------------------------------------------------------------- */
+/* a fixed point format: bits, fractional bits */
+struct pool_fixed_fmt {
+    ai_i32 bits, fbits;
+};
+
+static ai_i32 poolFixedGet(const void *data, size_t i, ai_i32 bits)
+{
+    return (bits == 16) ? (ai_i32)((const ai_i16 *)data)[i] :
+            (ai_i32)((const ai_i8 *)data)[i];
+}
+
+static void poolCheckFixed(const struct pool_case *c, bool is_max,
+        struct pool_fixed_fmt f_in, struct pool_fixed_fmt f_out)
+{
+    const ai_i32 out_h = poolOut(c, c->in_h);
+    const ai_i32 out_w = poolOut(c, c->in_w);
+    const size_t in_size = (size_t)c->in_h * c->in_w * c->ch;
+    const size_t out_size = (size_t)out_h * out_w * c->ch;
+    const size_t n_out = c->n_batches * out_size;
+    const ai_i32 q_max = (1 << (f_out.bits - 1)) - 1;
+    const ai_i32 shift = f_out.fbits - f_in.fbits;
+    const ai_float to_out = ldexpf(1.0f, shift);
+
+    void *in = malloc(c->n_batches * in_size * (f_in.bits / 8));
+    void *out = malloc(n_out * (f_out.bits / 8));
+    double *in_d = malloc(in_size * sizeof(double));
+    double *acc = malloc(out_size * sizeof(double));
+    ai_i32 *n = malloc(out_size * sizeof(ai_i32));
+    ai_i32 *out_i = malloc(n_out * sizeof(ai_i32));
+    ai_i32 *ref = malloc(n_out * sizeof(ai_i32));
+    struct check_tensor t_in, t_out;
+    char what[64];
+
+    for (size_t i = 0; i < c->n_batches * in_size; i++) {
+        const ai_i32 v = checkRandInt(-(1 << (f_in.bits - 1)),
+                (1 << (f_in.bits - 1)) - 1);
+        if (f_in.bits == 16)
+            ((ai_i16 *)in)[i] = (ai_i16)v;
+        else
+            ((ai_i8 *)in)[i] = (ai_i8)v;
+    }
+    for (ai_i32 b = 0; b < c->n_batches; b++) {
+        for (size_t i = 0; i < in_size; i++)
+            in_d[i] = poolFixedGet(in, b * in_size + i, f_in.bits);
+        poolRef(acc, n, in_d, c, is_max, false);
+        for (size_t i = 0; i < out_size; i++) {
+            const ai_float scale = (is_max || !n[i]) ? to_out :
+                    to_out / (ai_float)n[i];
+            ai_i32 q = (ai_i32)roundf((ai_float)acc[i] * scale);
+            q = (q < -q_max - 1) ? -q_max - 1 : (q > q_max) ? q_max : q;
+            ref[b * out_size + i] = q;
+        }
+    }
+
+    snprintf(what, sizeof(what), "q%d.%d->q%d.%d %s %dx%dx%d k%d s%d p%d",
+            (int)f_in.bits, (int)f_in.fbits, (int)f_out.bits,
+            (int)f_out.fbits, is_max ? "max" : "avg", (int)c->in_h,
+            (int)c->in_w, (int)c->ch, (int)c->k, (int)c->stride,
+            (int)c->pad);
+
+    checkTensorInit(&t_in, AI_ARRAY_FMT_SET_Q(f_in.bits, f_in.fbits), in,
+            c->n_batches * in_size, 1, c->ch, c->in_w, c->in_h, NULL);
+    checkTensorInit(&t_out, AI_ARRAY_FMT_SET_Q(f_out.bits, f_out.fbits), out,
+            n_out, 1, c->ch, out_w, out_h, NULL);
+    ai_tensor_chain chain = AI_TENSOR_CHAIN_OBJ_INIT(AI_FLAG_NONE, 4,
+            AI_TENSOR_LIST_OBJ_INIT(AI_FLAG_NONE, 1, &t_in.tensor),
+            AI_TENSOR_LIST_OBJ_INIT(AI_FLAG_NONE, 1, &t_out.tensor),
+            AI_TENSOR_LIST_OBJ_EMPTY, AI_TENSOR_LIST_OBJ_EMPTY);
+    ai_layer_pool l = { 0 };
+    l.network = checkNetwork();
+    l.tensors = &chain;
+    l.pool_size = (ai_shape_2d)AI_SHAPE_2D_INIT(c->k, c->k);
+    l.pool_stride = (ai_shape_2d)AI_SHAPE_2D_INIT(c->stride, c->stride);
+    l.pool_pad = (ai_shape)AI_SHAPE_INIT(4, c->pad, c->pad, c->pad, c->pad);
+
+    /* kernel of the arrays, then layer */
+    for (int layer = 0; layer < 2; layer++) {
+        memset(out, 0, n_out * (f_out.bits / 8));
+        if (layer)
+            (is_max ? forward_mp_fixed : forward_ap_fixed)((ai_layer *)&l);
+        else
+            (is_max ? pool_func_mp_array_fixed : pool_func_ap_array_fixed)(
+                    &t_in.array, c->in_w, c->in_h, c->ch, c->k, c->k, c->pad,
+                    c->pad, c->stride, c->stride, out_w, out_h, &t_out.array);
+        for (size_t i = 0; i < n_out; i++)
+            out_i[i] = poolFixedGet(out, i, f_out.bits);
+        checkInts(what, out_i, ref, n_out, 0);
+    }
+
+    free(in);
+    free(out);
+    free(in_d);
+    free(acc);
+    free(n);
+    free(out_i);
+    free(ref);
+}
+
+/* -------------------------------------------------------------------------- */
+void checkPool(void)
+{
+    static const struct pool_fixed_fmt fixed_fmts[][2] = {
+        { { 8, 7 }, { 8, 7 } },
+        { { 8, 7 }, { 16, 12 } },
+        { { 16, 12 }, { 8, 5 } },     /* saturated */
+        { { 16, 8 }, { 16, 10 } },
+    };
+
+    for (size_t i = 0; i < POOL_N_CASES; i++) {
+        for (int is_max = 0; is_max < 2; is_max++) {
+            poolCheckF32(&pool_cases[i], is_max);
+            poolCheckI8(&pool_cases[i], is_max, true);
+            poolCheckI8(&pool_cases[i], is_max, false);
+            for (size_t f = 0; f < 4; f++)
+                poolCheckFixed(&pool_cases[i], is_max, fixed_fmts[f][0],
+                        fixed_fmts[f][1]);
+        }
+    }
+}
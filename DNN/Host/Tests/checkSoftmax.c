@@ -0,0 +1,234 @@
+/**
+  ******************************************************************************
+  * @file    checkSoftmax.c
+  * @brief   Checks of the single pass softmax kernels
+  ******************************************************************************
+  * @attention
+  *
+  * The float softmax (channels of an array, one channel, in place, -inf
+  * inputs) against a double reference, and the fixed point one for signed
+  * and unsigned 8/16-bits formats: its outputs are within 0.51 LSB of the
+  * rounded reference (saturated to the output format).
+  *
+  ******************************************************************************
+  */
+
+/* System headers */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+/* AI header files */
+#include "layers_nl.h"
+#include "layers_sm.h"
+
+#include "aiCheck.h"
+
+/* channel sizes around the vector widths */
+static const ai_size sm_sizes[] = { 1, 2, 7, 10, 31, 33, 64, 65, 100, 1000 };
+
+#define SM_N_SIZES      (sizeof(sm_sizes) / sizeof(sm_sizes[0]))
+#define SM_N_CHANNELS   (3)
+
+/* float: relative error of the outputs above SM_REL_MIN, absolute below:
+ * the float rounding of x - max (|x - max| < 40) is 2.4e-6 relative */
+#define SM_TOL          (5e-6)
+#define SM_REL_MIN      (1e-30)
+
+/* fixed point: error to the exact result, in LSB of the output */
+#define SM_FIXED_LSB    (0.51)
+
+/* -------------------------------------------------------------------------- */
+static void smRef(double *out, const double *in, ai_size n)
+{
+    double max = -INFINITY, sum = 0.0;
+
+    for (ai_size i = 0; i < n; i++)
+        max = fmax(max, in[i]);
+    for (ai_size i = 0; i < n; i++) {
+        out[i] = exp(in[i] - max);
+        sum += out[i];
+    }
+    for (ai_size i = 0; i < n; i++)
+        out[i] /= sum;
+}
+
+static void smArrayInit(ai_array *a, ai_array_format fmt, void *data,
+        ai_size size)
+{
+    *a = (ai_array)AI_ARRAY_OBJ_INIT(fmt, data, data, size);
+}
+
+/* -------------------------------------------------------------------------- */
+static void smCheckF32(ai_size n)
+{
+    const ai_size size = n * SM_N_CHANNELS;
+    ai_float *in = malloc(size * sizeof(ai_float));
+    ai_float *out = malloc(size * sizeof(ai_float));
+    ai_float *ref = malloc(size * sizeof(ai_float));
+    ai_float *inplace = malloc(size * sizeof(ai_float));
+    double *xd = malloc(n * sizeof(double));
+    double *yd = malloc(n * sizeof(double));
+    double max_err = 0.0, max_sum_err = 0.0;
+    ai_array a_in, a_out, a_inplace;
+    char what[48];
+
+    for (ai_size i = 0; i < size; i++)
+        in[i] = 20.0f * checkRand();
+    if (n > 5)
+        in[3] = -INFINITY;
+    for (ai_size c = 0; c < SM_N_CHANNELS; c++) {
+        for (ai_size i = 0; i < n; i++)
+            xd[i] = in[c * n + i];
+        smRef(yd, xd, n);
+        for (ai_size i = 0; i < n; i++)
+            ref[c * n + i] = (ai_float)yd[i];
+    }
+
+    smArrayInit(&a_in, AI_ARRAY_FORMAT_FLOAT, in, size);
+    smArrayInit(&a_out, AI_ARRAY_FORMAT_FLOAT, out, size);
+    nl_func_sm_array_f32(&a_out, &a_in, size, n, n, n);
+    for (ai_size c = 0; c < SM_N_CHANNELS; c++) {
+        double sum = 0.0;
+        for (ai_size i = 0; i < n; i++) {
+            const double r = ref[c * n + i];
+            const double e = fabs(out[c * n + i] - r) /
+                    ((r > SM_REL_MIN) ? r : 1.0);
+            max_err = fmax(max_err, e);
+            sum += out[c * n + i];
+        }
+        max_sum_err = fmax(max_sum_err, fabs(sum - 1.0));
+    }
+    snprintf(what, sizeof(what), "f32 %u x %d", (unsigned)n, SM_N_CHANNELS);
+    checkFloats(what, out, ref, size, SM_TOL);
+    snprintf(what, sizeof(what), "f32 %u relative error", (unsigned)n);
+    checkBound(what, max_err, SM_TOL);
+    snprintf(what, sizeof(what), "f32 %u sums", (unsigned)n);
+    checkBound(what, max_sum_err, 1e-5);
+    if (n > 5) {
+        snprintf(what, sizeof(what), "f32 %u exp(-inf) is 0", (unsigned)n);
+        checkTrue(what, out[3] == 0.0f);
+    }
+
+    /* in place, and the single channel entry */
+    memcpy(inplace, in, size * sizeof(ai_float));
+    smArrayInit(&a_inplace, AI_ARRAY_FORMAT_FLOAT, inplace, size);
+    nl_func_sm_array_f32(&a_inplace, &a_inplace, size, n, n, n);
+    snprintf(what, sizeof(what), "f32 %u in place", (unsigned)n);
+    checkTrue(what, !memcmp(inplace, out, size * sizeof(ai_float)));
+    checkTrue(what, a_inplace.data == (ai_ptr)inplace);
+    memset(out, 0, size * sizeof(ai_float));
+    nl_func_sm_channel_f32(&a_out, &a_in, n, NULL);
+    snprintf(what, sizeof(what), "f32 %u channel", (unsigned)n);
+    checkFloats(what, out, ref, n, SM_TOL);
+
+    free(in);
+    free(out);
+    free(ref);
+    free(inplace);
+    free(xd);
+    free(yd);
+}
+
+/* -------------------------------------------------------------------------- */
+/* a fixed point format: bits, fractional bits, signed */
+struct sm_fixed {
+    ai_i32 bits, fbits;
+    bool is_signed;
+};
+
+static const struct sm_fixed sm_fixed_in[] = {
+    { 8, 7, true }, { 16, 15, true }, { 8, 7, false }, { 16, 15, false },
+    { 8, 4, true }, { 16, 8, true }, { 8, 0, false }, { 16, 12, false },
+};
+
+static const struct sm_fixed sm_fixed_out[] = {
+    { 8, 7, true }, { 16, 15, true }, { 8, 8, false }, { 16, 16, false },
+    { 8, 7, false }, { 16, 14, true },
+};
+
+#define SM_N_FIXED_IN   (sizeof(sm_fixed_in) / sizeof(sm_fixed_in[0]))
+#define SM_N_FIXED_OUT  (sizeof(sm_fixed_out) / sizeof(sm_fixed_out[0]))
+
+#define SM_FIXED_SIZE   (257)
+
+static ai_array_format smFixedFormat(const struct sm_fixed *f)
+{
+    return f->is_signed ? AI_ARRAY_FMT_SET_Q(f->bits, f->fbits) :
+            AI_ARRAY_FMT_SET_UQ(f->bits, f->fbits);
+}
+
+static int32_t smFixedGet(const struct sm_fixed *f, const void *data,
+        ai_size i)
+{
+    if (f->bits == 8)
+        return f->is_signed ? ((const int8_t *)data)[i] :
+                ((const uint8_t *)data)[i];
+    return f->is_signed ? ((const int16_t *)data)[i] :
+            ((const uint16_t *)data)[i];
+}
+
+static void smCheckFixed(const struct sm_fixed *fi, const struct sm_fixed *fo)
+{
+    const ai_size n = SM_FIXED_SIZE;
+    const ai_size size = n * SM_N_CHANNELS;
+    const int32_t out_max = fo->is_signed ? (1 << (fo->bits - 1)) - 1 :
+            (1 << fo->bits) - 1;
+    void *in = malloc(size * (fi->bits / 8));
+    void *out = malloc(size * (fo->bits / 8));
+    int32_t *o = malloc(size * sizeof(int32_t));
+    int32_t *ref = malloc(size * sizeof(int32_t));
+    double xd[SM_FIXED_SIZE], yd[SM_FIXED_SIZE];
+    double max_err = 0.0;
+    ai_array a_in, a_out;
+    char what[48];
+
+    for (ai_size i = 0; i < size; i++) {
+        const int32_t v = checkRandInt(0, (1 << fi->bits) - 1);
+        if (fi->bits == 8)
+            ((uint8_t *)in)[i] = (uint8_t)v;
+        else
+            ((uint16_t *)in)[i] = (uint16_t)v;
+    }
+    smArrayInit(&a_in, smFixedFormat(fi), in, size);
+    smArrayInit(&a_out, smFixedFormat(fo), out, size);
+    sm_func_sm_array_fixed(&a_out, &a_in, size, n, n, n);
+
+    for (ai_size c = 0; c < SM_N_CHANNELS; c++) {
+        for (ai_size i = 0; i < n; i++)
+            xd[i] = ldexp(smFixedGet(fi, in, c * n + i), -fi->fbits);
+        smRef(yd, xd, n);
+        for (ai_size i = 0; i < n; i++) {
+            const double r = fmin(ldexp(yd[i], fo->fbits), out_max);
+            o[c * n + i] = smFixedGet(fo, out, c * n + i);
+            ref[c * n + i] = (int32_t)lround(r);
+            max_err = fmax(max_err, fabs(o[c * n + i] - r));
+        }
+    }
+
+    snprintf(what, sizeof(what), "%c%d.%d -> %c%d.%d",
+            fi->is_signed ? 's' : 'u', (int)fi->bits, (int)fi->fbits,
+            fo->is_signed ? 's' : 'u', (int)fo->bits, (int)fo->fbits);
+    checkInts(what, o, ref, size, 1);
+    strncat(what, " LSB error", sizeof(what) - strlen(what) - 1);
+    checkBound(what, max_err, SM_FIXED_LSB);
+
+    free(in);
+    free(out);
+    free(o);
+    free(ref);
+}
+
+/* -------------------------------------------------------------------------- */
+void checkSoftmax(void)
+{
+    for (size_t i = 0; i < SM_N_SIZES; i++)
+        smCheckF32(sm_sizes[i]);
+    for (size_t i = 0; i < SM_N_FIXED_IN; i++) {
+        for (size_t o = 0; o < SM_N_FIXED_OUT; o++)
+            smCheckFixed(&sm_fixed_in[i], &sm_fixed_out[o]);
+    }
+}
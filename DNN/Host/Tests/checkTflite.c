@@ -0,0 +1,508 @@
+/**
+  ******************************************************************************
+  * @file    checkTflite.c
+  * @brief   Checks of the runtime .tflite model loader
+  ******************************************************************************
+  * @attention
+  *
+  * model/linear.tflite is loaded with core_tflite_open and with
+  * ai_mnetwork_load, and its outputs compared with a reference computed on
+  * the weights read from the flatbuffer. Damaged copies of the flatbuffer
+  * (truncated, offsets and lengths out of range, oversized shapes) must be
+  * rejected with AI_ERROR_CODE_INVALID_FORMAT; every word of the model is
+  * also overwritten in turn, the loader must fail cleanly or build a model
+  * which runs. A flatbuffer under check ends on an inaccessible page: a read
+  * past its end faults (the pass aborts).
+  *
+  ******************************************************************************
+  */
+
+/* System headers */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+/* AI header files */
+#include "app_x-cube-ai.h"
+#include "core_tflite.h"
+
+#include "aiCheck.h"
+
+/* relative to the directory of make check */
+#ifndef TFL_MODEL_PATH
+#define TFL_MODEL_PATH      "../../model/linear.tflite"
+#endif
+
+/* samples run: more than a chunk of the loader batch */
+#define TFL_N_SAMPLES       (37)
+#define TFL_N_BATCHES       (8)
+
+/* the same weights, the kernels may sum in another order */
+#define TFL_TOL             (1e-6)
+
+/* largest layer of the reference */
+#define TFL_REF_MAX         (64)
+
+/* schema (see core_tflite.c) */
+#define TFL_OP_FULLY_CONNECTED  (9)
+#define TFL_ACT_RELU            (1)
+#define TFL_MODEL_OPERATOR_CODES (1)
+#define TFL_MODEL_SUBGRAPHS     (2)
+#define TFL_MODEL_BUFFERS       (4)
+#define TFL_SUBGRAPH_TENSORS    (0)
+#define TFL_SUBGRAPH_OPERATORS  (3)
+#define TFL_TENSOR_SHAPE        (0)
+#define TFL_TENSOR_BUFFER       (2)
+#define TFL_OPCODE_DEPRECATED_CODE (0)
+#define TFL_OPCODE_BUILTIN_CODE (3)
+#define TFL_OPERATOR_OPCODE_INDEX (0)
+#define TFL_OPERATOR_INPUTS     (1)
+#define TFL_OPERATOR_OUTPUTS    (2)
+#define TFL_OPERATOR_OPTIONS    (4)
+#define TFL_OPTIONS_ACTIVATION  (0)
+#define TFL_BUFFER_DATA         (0)
+
+/* a flatbuffer ending on an inaccessible page */
+struct tfl_guarded {
+    uint8_t *map;
+    size_t map_size;
+    uint8_t *data;
+};
+
+/* -------------------------------------------------------------------------- */
+static uint8_t *tflReadFile(const char *path, size_t *size)
+{
+    FILE *f = fopen(path, "rb");
+    uint8_t *data = NULL;
+    long n;
+
+    *size = 0;
+    if (!f)
+        return NULL;
+    n = (fseek(f, 0, SEEK_END) == 0) ? ftell(f) : -1;
+    if ((n > 0) && (fseek(f, 0, SEEK_SET) == 0))
+        data = malloc((size_t)n);
+    if (data && (fread(data, 1, (size_t)n, f) != (size_t)n)) {
+        free(data);
+        data = NULL;
+    }
+    fclose(f);
+    if (data)
+        *size = (size_t)n;
+    return data;
+}
+
+static bool tflGuard(struct tfl_guarded *g, const uint8_t *data, size_t size)
+{
+    const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    const size_t pages = (size + page - 1) / page;
+
+    g->map_size = (pages + 1) * page;
+    g->map = mmap(NULL, g->map_size, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (g->map == MAP_FAILED)
+        return false;
+    if (mprotect(g->map + pages * page, page, PROT_NONE)) {
+        munmap(g->map, g->map_size);
+        return false;
+    }
+    g->data = g->map + pages * page - size;
+    memcpy(g->data, data, size);
+    return true;
+}
+
+static void tflUnguard(struct tfl_guarded *g)
+{
+    munmap(g->map, g->map_size);
+}
+
+/* -------------------------------------------------------------------------- */
+/* reader of the (trusted) original model, to locate the damaged words */
+static uint32_t tflU32(const uint8_t *data, size_t pos)
+{
+    uint32_t v;
+
+    memcpy(&v, data + pos, sizeof(v));
+    return v;
+}
+
+static size_t tflDeref(const uint8_t *data, size_t pos)
+{
+    return pos + tflU32(data, pos);
+}
+
+/* position of the field id of a table, 0 if not set */
+static size_t tflField(const uint8_t *data, size_t table, int id)
+{
+    const size_t vtable = table - (int32_t)tflU32(data, table);
+    uint16_t vt_size, offset = 0;
+
+    memcpy(&vt_size, data + vtable, sizeof(vt_size));
+    if (4 + 2 * id + 2 <= vt_size)
+        memcpy(&offset, data + vtable + 4 + 2 * id, sizeof(offset));
+    return (offset) ? table + offset : 0;
+}
+
+/* position of the element idx of the vector field id of a table */
+static size_t tflElem(const uint8_t *data, size_t table, int id, size_t idx)
+{
+    return tflDeref(data, tflField(data, table, id)) + 4 + 4 * idx;
+}
+
+static size_t tflTable(const uint8_t *data, size_t table, int id, size_t idx)
+{
+    return tflDeref(data, tflElem(data, table, id, idx));
+}
+
+static size_t tflTensor(const uint8_t *data, size_t subgraph, size_t idx)
+{
+    return tflTable(data, subgraph, TFL_SUBGRAPH_TENSORS, idx);
+}
+
+static size_t tflLength(const uint8_t *data, size_t table, int id)
+{
+    return tflU32(data, tflDeref(data, tflField(data, table, id)));
+}
+
+/* -------------------------------------------------------------------------- */
+/* reference of the model, a chain of fully connected operators: double
+ * accumulation on the weights of the flatbuffer (false for another model) */
+static bool tflRef(const uint8_t *data, const ai_float *in, ai_float *ref,
+        size_t n)
+{
+    const size_t root = tflU32(data, 0);
+    const size_t subgraph = tflTable(data, root, TFL_MODEL_SUBGRAPHS, 0);
+    const size_t n_ops = tflLength(data, subgraph, TFL_SUBGRAPH_OPERATORS);
+    double x[TFL_REF_MAX], y[TFL_REF_MAX];
+
+    for (size_t s = 0; s < n; s++) {
+        size_t n_x = 1;
+
+        x[0] = in[s];
+        for (size_t k = 0; k < n_ops; k++) {
+            const size_t op = tflTable(data, subgraph,
+                    TFL_SUBGRAPH_OPERATORS, k);
+            const size_t opcode = tflField(data, op,
+                    TFL_OPERATOR_OPCODE_INDEX);
+            const size_t code = tflTable(data, root,
+                    TFL_MODEL_OPERATOR_CODES,
+                    (opcode) ? tflU32(data, opcode) : 0);
+            const size_t deprecated = tflField(data, code,
+                    TFL_OPCODE_DEPRECATED_CODE);
+            const size_t builtin = tflField(data, code,
+                    TFL_OPCODE_BUILTIN_CODE);
+            const size_t options = tflField(data, op, TFL_OPERATOR_OPTIONS);
+            const size_t act = (options) ? tflField(data,
+                    tflDeref(data, options), TFL_OPTIONS_ACTIVATION) : 0;
+            size_t params[2], n_out = 0;
+
+            /* the deprecated code is the only one set by older converters */
+            if ((!deprecated || (data[deprecated] != TFL_OP_FULLY_CONNECTED))
+                    && (!builtin || (tflU32(data, builtin) !=
+                    TFL_OP_FULLY_CONNECTED)))
+                return false;
+            if ((tflLength(data, op, TFL_OPERATOR_INPUTS) != 3) ||
+                    (act && (data[act] > TFL_ACT_RELU)))
+                return false;
+            /* weights [n_out][n_x], bias [n_out] */
+            for (int p = 0; p < 2; p++) {
+                const size_t t = tflTensor(data, subgraph, tflU32(data,
+                        tflElem(data, op, TFL_OPERATOR_INPUTS, 1 + p)));
+                const size_t buffer = tflTable(data, root, TFL_MODEL_BUFFERS,
+                        tflU32(data, tflField(data, t, TFL_TENSOR_BUFFER)));
+                params[p] = tflElem(data, buffer, TFL_BUFFER_DATA, 0);
+                if (!p)
+                    n_out = tflLength(data, buffer, TFL_BUFFER_DATA) /
+                            sizeof(float) / n_x;
+            }
+            if (!n_out || (n_out > TFL_REF_MAX))
+                return false;
+            for (size_t o = 0; o < n_out; o++) {
+                float v;
+                memcpy(&v, data + params[1] + 4 * o, sizeof(v));
+                y[o] = v;
+                for (size_t i = 0; i < n_x; i++) {
+                    memcpy(&v, data + params[0] + 4 * (o * n_x + i),
+                            sizeof(v));
+                    y[o] += (double)v * x[i];
+                }
+                if (act && (data[act] == TFL_ACT_RELU))
+                    y[o] = fmax(y[o], 0.0);
+            }
+            memcpy(x, y, n_out * sizeof(double));
+            n_x = n_out;
+        }
+        if (n_x != 1)
+            return false;
+        ref[s] = (ai_float)x[0];
+    }
+    return true;
+}
+
+/* -------------------------------------------------------------------------- */
+/* n samples through a model built by the loader (false if it does not run) */
+static bool tflRun(ai_handle model, const ai_float *in, ai_float *out,
+        ai_u32 n)
+{
+    ai_buffer config = { 0 };
+    ai_network_params params;
+    ai_network_report report;
+    ai_buffer input, output;
+    ai_handle net = AI_HANDLE_NULL;
+    uint8_t *activations;
+    bool ok = false;
+
+    if (!core_tflite_get_params(model, &params))
+        return false;
+    activations = malloc(AI_BUFFER_SIZE(&params.activations) + 4);
+    params.activations.data = AI_HANDLE_PTR(activations);
+    config.data = model;
+    if (activations && (ai_tflite_create(&net, &config).type == AI_ERROR_NONE)
+            && ai_tflite_init(net, &params) && ai_tflite_get_info(net, &report)
+            && (report.n_inputs == 1) && (report.n_outputs == 1)) {
+        input = report.inputs[0];
+        output = report.outputs[0];
+        input.n_batches = (ai_u16)n;
+        output.n_batches = (ai_u16)n;
+        input.data = AI_HANDLE_PTR(in);
+        output.data = AI_HANDLE_PTR(out);
+        ok = (ai_tflite_run(net, &input, &output) == (ai_i32)n);
+    }
+    if (net)
+        ai_tflite_destroy(net);
+    free(activations);
+    return ok;
+}
+
+/* n samples through an instance of the ai_mnetwork API */
+static bool tflMnetworkRun(ai_handle net, const ai_float *in, ai_float *out,
+        ai_u32 n)
+{
+    ai_network_report report;
+    ai_buffer input, output;
+    ai_u32 act_addr, act_size;
+    void *activations;
+    bool ok = false;
+
+    if (ai_mnetwork_get_ext_data_activations(net, &act_addr, &act_size))
+        return false;
+    activations = aligned_alloc(64, (act_size + 64) & ~63u);
+    ai_network_params params = {
+            AI_BUFFER_OBJ_INIT(AI_BUFFER_FORMAT_NONE|AI_BUFFER_FMT_FLAG_CONST,
+                    0, 0, 0, 0, NULL),
+            AI_BUFFER_OBJ_INIT(AI_BUFFER_FORMAT_NONE|AI_BUFFER_FMT_FLAG_CONST,
+                    0, 0, 0, 0, AI_HANDLE_PTR(activations)) };
+    if (activations && ai_mnetwork_init(net, &params) &&
+            ai_mnetwork_get_info(net, &report) && (report.n_inputs == 1) &&
+            (report.n_outputs == 1)) {
+        input = report.inputs[0];
+        output = report.outputs[0];
+        input.n_batches = (ai_u16)n;
+        output.n_batches = (ai_u16)n;
+        input.data = AI_HANDLE_PTR(in);
+        output.data = AI_HANDLE_PTR(out);
+        ok = (ai_mnetwork_run(net, &input, &output) == (ai_i32)n);
+    }
+    free(activations);
+    return ok;
+}
+
+static bool tflIsInvalidFormat(ai_error err)
+{
+    return (err.type == AI_ERROR_INVALID_PARAM) &&
+            (err.code == AI_ERROR_CODE_INVALID_FORMAT);
+}
+
+/* -------------------------------------------------------------------------- */
+/* the model against the reference */
+static void tflCheckModel(const uint8_t *data, size_t size, const ai_float *in,
+        const ai_float *ref)
+{
+    ai_float out[TFL_N_SAMPLES];
+    struct tfl_guarded g;
+    ai_handle model, net;
+    ai_error err;
+
+    checkTrue("guarded copy", tflGuard(&g, data, size));
+    err = core_tflite_open(&model, "linear", g.data, (ai_size)size,
+            TFL_N_BATCHES);
+    checkTrue("core_tflite_open", err.type == AI_ERROR_NONE);
+    if (err.type == AI_ERROR_NONE) {
+        memset(out, 0, sizeof(out));
+        checkTrue("core_tflite_open run",
+                tflRun(model, in, out, TFL_N_SAMPLES));
+        checkFloats("core_tflite_open outputs", out, ref, TFL_N_SAMPLES,
+                TFL_TOL);
+        core_tflite_close(model);
+    }
+    tflUnguard(&g);
+
+#if defined(AI_MNETWORK_WITH_TFLITE)
+    /* the file, served by the ai_mnetwork API */
+    err = ai_mnetwork_load(TFL_MODEL_PATH, &net);
+    checkTrue("ai_mnetwork_load", err.type == AI_ERROR_NONE);
+    if (err.type == AI_ERROR_NONE) {
+        memset(out, 0, sizeof(out));
+        checkTrue("ai_mnetwork_load run",
+                tflMnetworkRun(net, in, out, TFL_N_SAMPLES));
+        checkFloats("ai_mnetwork_load outputs", out, ref, TFL_N_SAMPLES,
+                TFL_TOL);
+        checkTrue("destroy", ai_mnetwork_destroy(net) == AI_HANDLE_NULL);
+        checkTrue("unload", ai_mnetwork_unload("linear"));
+    }
+#else
+    (void)net;
+#endif
+}
+
+/* -------------------------------------------------------------------------- */
+/* open a copy of the size first bytes, the word at pos set to value (none
+ * past the end): rejected as an invalid format */
+static void tflCheckRejected(const char *what, const uint8_t *data,
+        size_t size, size_t pos, uint32_t value)
+{
+    struct tfl_guarded g;
+    ai_handle model = AI_HANDLE_NULL;
+    ai_error err;
+
+    if (!tflGuard(&g, data, size)) {
+        checkTrue(what, false);
+        return;
+    }
+    if (pos + 4 <= size)
+        memcpy(g.data + pos, &value, sizeof(value));
+    err = core_tflite_open(&model, "damaged", g.data, (ai_size)size, 1);
+    checkTrue(what, tflIsInvalidFormat(err) && (model == AI_HANDLE_NULL));
+    if (err.type == AI_ERROR_NONE)
+        core_tflite_close(model);
+    tflUnguard(&g);
+}
+
+static void tflCheckDamaged(const uint8_t *data, size_t size)
+{
+    const size_t root = tflU32(data, 0);
+    const size_t subgraph = tflTable(data, root, TFL_MODEL_SUBGRAPHS, 0);
+    const size_t op = tflTable(data, subgraph, TFL_SUBGRAPH_OPERATORS, 0);
+    const size_t op_in = tflElem(data, op, TFL_OPERATOR_INPUTS, 0);
+    const size_t op_w = tflElem(data, op, TFL_OPERATOR_INPUTS, 1);
+    const size_t op_out = tflElem(data, op, TFL_OPERATOR_OUTPUTS, 0);
+    const size_t weights = tflTensor(data, subgraph, tflU32(data, op_w));
+    const size_t act = tflTensor(data, subgraph, tflU32(data, op_out));
+    const size_t act_rank = tflDeref(data, tflField(data, act,
+            TFL_TENSOR_SHAPE));
+    const size_t w_buffer = tflTable(data, root, TFL_MODEL_BUFFERS,
+            tflU32(data, tflField(data, weights, TFL_TENSOR_BUFFER)));
+    const size_t w_bytes = tflDeref(data, tflField(data, w_buffer,
+            TFL_BUFFER_DATA));
+    char what[64];
+
+    /* truncated: every length down to the identifier */
+    for (size_t n = size - 1; n >= 8; n--) {
+        snprintf(what, sizeof(what), "truncated to %zu bytes", n);
+        tflCheckRejected(what, data, n, size, 0);
+    }
+
+    /* offsets out of the flatbuffer */
+    tflCheckRejected("root offset", data, size, 0, 0x7FFFFFF0u);
+    tflCheckRejected("subgraphs offset", data, size,
+            tflField(data, root, TFL_MODEL_SUBGRAPHS), (uint32_t)size);
+    tflCheckRejected("subgraph offset", data, size,
+            tflElem(data, root, TFL_MODEL_SUBGRAPHS, 0), 0xFFFFFFF0u);
+    tflCheckRejected("tensor vtable", data, size, weights, 0x80000000u);
+    tflCheckRejected("operator input index", data, size, op_in, 0x10000u);
+    tflCheckRejected("operator output index", data, size, op_out,
+            0xFFFFFFFEu);
+
+    /* lengths out of the flatbuffer */
+    tflCheckRejected("tensors length", data, size,
+            tflDeref(data, tflField(data, subgraph, TFL_SUBGRAPH_TENSORS)),
+            0x40000000u);
+    tflCheckRejected("operators length", data, size,
+            tflDeref(data, tflField(data, subgraph, TFL_SUBGRAPH_OPERATORS)),
+            0xFFFFFFFFu);
+    tflCheckRejected("weights bytes", data, size, w_bytes, 0x7FFFFFFFu);
+
+    /* oversized shapes: weights [2^30 + 1, 1], activation [1, 2^29] (2 GiB
+     * of floats) and [1, 2^28] (not the dense outputs) */
+    tflCheckRejected("weights shape", data, size,
+            tflDeref(data, tflField(data, weights, TFL_TENSOR_SHAPE)) + 4,
+            0x40000001u);
+    tflCheckRejected("activation shape 2^29", data, size,
+            act_rank + 4 * tflU32(data, act_rank), 0x20000000u);
+    tflCheckRejected("activation shape 2^28", data, size,
+            act_rank + 4 * tflU32(data, act_rank), 0x10000000u);
+    tflCheckRejected("negative dimension", data, size,
+            act_rank + 4 * tflU32(data, act_rank), 0xFFFFFFFBu);
+}
+
+/* every word overwritten in turn: rejected, or a model which runs */
+static void tflCheckWords(const uint8_t *data, size_t size, const ai_float *in)
+{
+    static const uint32_t values[] = { 0xFFFFFFFFu, 0x7FFFFFFFu, 0x80000000u,
+            0x00000000u, 0x00010001u };
+    ai_float out[TFL_N_SAMPLES];
+    long rejected = 0, loaded = 0, bad = 0;
+    char what[96];
+
+    for (size_t pos = 0; pos + 4 <= size; pos += 4) {
+        for (size_t v = 0; v < sizeof(values) / sizeof(values[0]); v++) {
+            struct tfl_guarded g;
+            ai_handle model;
+            ai_error err;
+
+            if (!tflGuard(&g, data, size)) {
+                bad++;
+                continue;
+            }
+            memcpy(g.data + pos, &values[v], sizeof(values[v]));
+            err = core_tflite_open(&model, "damaged", g.data, (ai_size)size,
+                    TFL_N_BATCHES);
+            if (err.type == AI_ERROR_NONE) {
+                /* weights or unused fields: the model must run */
+                if (!tflRun(model, in, out, TFL_N_SAMPLES))
+                    bad++;
+                core_tflite_close(model);
+                loaded++;
+            } else if (tflIsInvalidFormat(err) && (model == AI_HANDLE_NULL)) {
+                rejected++;
+            } else {
+                if (!bad)
+                    printf("    word %zu = 0x%08x: error type=%d code=%d\n",
+                            pos, (unsigned)values[v], err.type, err.code);
+                bad++;
+            }
+            tflUnguard(&g);
+        }
+    }
+    snprintf(what, sizeof(what), "overwritten words failed (%ld rejected, "
+            "%ld loaded)", rejected, loaded);
+    checkBound(what, (double)bad, 0.0);
+    checkTrue("overwritten words rejected and loaded", rejected && loaded);
+}
+
+/* -------------------------------------------------------------------------- */
+void checkTflite(void)
+{
+    ai_float in[TFL_N_SAMPLES], ref[TFL_N_SAMPLES];
+    uint8_t *data;
+    size_t size;
+
+    data = tflReadFile(TFL_MODEL_PATH, &size);
+    checkTrue("read " TFL_MODEL_PATH, data != NULL);
+    if (!data)
+        return;
+
+    for (int i = 0; i < TFL_N_SAMPLES; i++)
+        in[i] = 4.0f * checkRand();
+    checkTrue("reference", tflRef(data, in, ref, TFL_N_SAMPLES));
+
+    tflCheckModel(data, size, in, ref);
+    tflCheckDamaged(data, size);
+    tflCheckWords(data, size, in);
+    free(data);
+}
@@ -0,0 +1,707 @@
+/**
+  ******************************************************************************
+  * @file    aiCompile.c
+  * @brief   Ahead-of-time compilation of an embedded network to C++
+  ******************************************************************************
+  * @attention
+  *
+  * The float network is initialized through the ai_mnetwork_* API (the graph
+  * optimizations of the runtime included) and its executed graph is emitted
+  * as a self-contained C++ source (<name>.cpp, <name>.h): no graph walk, no
+  * tensor chain lookup and no runtime check left, only the arithmetic of the
+  * c-nodes with their shapes known at compile time.
+  *  - a c-node of at most -u MACC (default 64, one per element for a
+  *    nonlinearity) is fully unrolled: one statement per output element,
+  *    the weights as literals
+  *  - a larger one is an instance of a kernel template parameterized by its
+  *    shape, its weights as constant arrays
+  * The generated source exposes ai_<name>_run(), with the signature of the
+  * ai_network_run() of the generated models. It only depends on
+  * ai_platform.h and the C++ standard library <cmath>.
+  *
+  * usage: aiCompile [-m model] [-n name] [-o dir] [-H dir] [-u max_macc]
+  *
+  * Supported c-nodes: float dense and the float pointwise nonlinearities
+  * without parameter (relu, sigmoid, tanh, ...), chained.
+  *
+  ******************************************************************************
+  */
+
+#define _GNU_SOURCE
+
+/* System headers */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <unistd.h>
+
+/* AI header files */
+#include "app_x-cube-ai.h"
+#include "ai_platform_interface.h"
+#include "core_common.h"
+#include "layers.h"
+
+#define _AOT_NAME_              "AI ahead-of-time compiler (host)"
+
+#define _AOT_DEF_NAME_          "network_aot"
+#define _AOT_DEF_UNROLL_        64
+
+struct aot_config {
+    const char *model;      /* NULL: first embedded network */
+    const char *name;
+    const char *dir;
+    const char *inc_dir;    /* NULL: dir */
+    int unroll;             /* max MACC of a fully unrolled c-node */
+};
+
+/* pointwise nonlinearities: runtime kernel and emitted C++ expression of x */
+struct aot_nl {
+    layer_forward_func forward;
+    const char *name;
+    const char *expr;
+};
+
+static const struct aot_nl aot_nl_table[] = {
+    { forward_relu,        "relu",        "(x < 0.0f) ? 0.0f : x" },
+    { forward_sigmoid,     "sigmoid",     "1.0f / (1.0f + std::exp(-x))" },
+    { forward_tanh,        "tanh",        "std::tanh(x)" },
+    { forward_abs,         "abs",         "std::fabs(x)" },
+    { forward_neg,         "neg",         "-x" },
+    { forward_exp,         "exp",         "std::exp(x)" },
+    { forward_log,         "log",         "std::log(x)" },
+    { forward_sqrt,        "sqrt",        "std::sqrt(x)" },
+    { forward_rsqrt,       "rsqrt",       "1.0f / std::sqrt(x)" },
+    { forward_reciprocal,  "reciprocal",  "1.0f / x" },
+    { forward_soft_plus,   "soft_plus",   "std::log(1.0f + std::exp(x))" },
+    { forward_soft_sign,   "soft_sign",   "x / (1.0f + std::fabs(x))" },
+    { forward_floor,       "floor",       "std::floor(x)" },
+    { forward_ceil,        "ceil",        "std::ceil(x)" },
+    { forward_round,       "round",       "std::round(x)" },
+};
+
+#define AOT_N_NL        (int)(sizeof(aot_nl_table) / sizeof(aot_nl_table[0]))
+
+struct aot_node {
+    int id;
+    int n_in;
+    int n_out;
+    const ai_tensor *w;     /* dense only */
+    const ai_tensor *b;     /* dense only, NULL: no bias */
+    const struct aot_nl *nl;    /* nonlinearity only */
+    bool unrolled;
+};
+
+struct aot_ctx {
+    int n_nodes;
+    struct aot_node *nodes;
+    int n_in;               /* floats per input sample */
+    int n_out;              /* floats per output sample */
+    uint32_t n_macc;
+    bool used_nl[AOT_N_NL];
+    bool dense_tmpl;        /* a dense c-node is not unrolled */
+    bool pointwise_tmpl;    /* a nonlinearity c-node is not unrolled */
+};
+
+/* -----------------------------------------------------------------------------
+ * Graph inspection
+ * -----------------------------------------------------------------------------
+ */
+
+static bool aotTensorIsF32(const ai_tensor *t)
+{
+    const ai_array_format fmt = AI_ARRAY_OBJ_FMT(t->data);
+    return (AI_FMT_GET_TYPE(fmt) == AI_FMT_FLOAT) && (AI_FMT_GET_BITS(fmt) == 32);
+}
+
+static const struct aot_nl *aotFindNl(const ai_node *node)
+{
+    if (AI_LAYER_TYPE(node->type) != AI_LAYER_NL_TYPE)
+        return NULL;
+    if (((const ai_layer_nl *)node)->nl_params)
+        return NULL;
+    for (int i = 0; i < AOT_N_NL; i++)
+        if (node->forward == aot_nl_table[i].forward)
+            return &aot_nl_table[i];
+    return NULL;
+}
+
+static int aotGraphInit(struct aot_ctx *ctx, ai_network *net, int unroll)
+{
+    const ai_tensor *prev = NULL;
+    int n = 0;
+
+    AI_FOR_EACH_NODE_DO(node, net->input_node) {
+        n++;
+    }
+    ctx->n_nodes = n;
+    ctx->nodes = calloc(n, sizeof(struct aot_node));
+    if (!ctx->nodes)
+        return -1;
+
+    n = 0;
+    AI_FOR_EACH_NODE_DO(node, net->input_node) {
+        struct aot_node *an = &ctx->nodes[n];
+        const ai_tensor *in, *out;
+
+        if ((GET_TENSOR_LIST_SIZE(GET_TENSOR_LIST_IN(node->tensors)) != 1) ||
+                (GET_TENSOR_LIST_SIZE(GET_TENSOR_LIST_OUT(node->tensors)) != 1) ||
+                (prev && (GET_TENSOR_IN(node->tensors, 0) != prev))) {
+            fprintf(stderr, "E: c-node %d is not part of a chain\n", n);
+            return -1;
+        }
+        in = GET_TENSOR_IN(node->tensors, 0);
+        out = GET_TENSOR_OUT(node->tensors, 0);
+        if (!aotTensorIsF32(in) || !aotTensorIsF32(out)) {
+            fprintf(stderr, "E: c-node %d is not a float layer\n", n);
+            return -1;
+        }
+
+        an->id = (int)node->id;
+        if ((AI_LAYER_TYPE(node->type) == AI_LAYER_DENSE_TYPE) &&
+                (node->forward == forward_dense)) {
+            AI_LAYER_WEIGHTS_GET(node, w, b)
+            if (!aotTensorIsF32(w) || (b && !aotTensorIsF32(b))) {
+                fprintf(stderr, "E: c-node %d is not a float layer\n", n);
+                return -1;
+            }
+            an->w = w;
+            an->b = b;
+            an->n_in = AI_SHAPE_IN_CH(&w->shape);
+            an->n_out = AI_SHAPE_CH(&w->shape);
+        } else if ((an->nl = aotFindNl(node)) != NULL) {
+            an->n_in = an->n_out = AI_SHAPE_CH(&out->shape);
+            ctx->used_nl[an->nl - aot_nl_table] = true;
+        } else {
+            fprintf(stderr, "E: c-node %d (%s) is not supported\n", n,
+                    ai_layer_type_name(AI_LAYER_TYPE(node->type)));
+            return -1;
+        }
+
+        /* one sample per ai_<name>_run() iteration */
+        if ((AI_SHAPE_H(&in->shape) * AI_SHAPE_W(&in->shape) != 1) ||
+                (AI_SHAPE_H(&out->shape) * AI_SHAPE_W(&out->shape) != 1) ||
+                ((int)AI_SHAPE_CH(&in->shape) != an->n_in) ||
+                ((int)AI_SHAPE_CH(&out->shape) != an->n_out)) {
+            fprintf(stderr, "E: c-node %d: unexpected tensor shapes\n", n);
+            return -1;
+        }
+
+        /* operations of the c-node, one per output element at least */
+        const int n_ops = (an->w) ? an->n_in * an->n_out : an->n_out;
+        an->unrolled = (n_ops <= unroll);
+        if (!an->unrolled && an->w)
+            ctx->dense_tmpl = true;
+        else if (!an->unrolled)
+            ctx->pointwise_tmpl = true;
+        if (an->w)
+            ctx->n_macc += (uint32_t)n_ops;
+        if (n == 0)
+            ctx->n_in = an->n_in;
+        ctx->n_out = an->n_out;
+        prev = out;
+        n++;
+    }
+    return (n > 0) ? 0 : -1;
+}
+
+/* -----------------------------------------------------------------------------
+ * Emitter
+ * -----------------------------------------------------------------------------
+ */
+
+struct aot_names {
+    const char *name;       /* e.g. network_aot */
+    char upper[64];         /* e.g. NETWORK_AOT */
+    char date[32];
+    const char *source;     /* compiled model */
+    const char *signature;  /* signature of the compiled model */
+};
+
+/* writes tmpl, replacing @name@, @NAME@, @date@, @source@ and @signature@ */
+static void aotTemplate(FILE *f, const struct aot_names *names,
+        const char *tmpl)
+{
+    static const char *keys[] = { "@name@", "@NAME@", "@date@", "@source@",
+            "@signature@" };
+    const char *values[] = { names->name, names->upper, names->date,
+            names->source, names->signature };
+
+    while (*tmpl) {
+        int k;
+        for (k = 0; k < 5; k++) {
+            const size_t len = strlen(keys[k]);
+            if (strncmp(tmpl, keys[k], len) == 0) {
+                fputs(values[k], f);
+                tmpl += len;
+                break;
+            }
+        }
+        if (k == 5)
+            fputc(*tmpl++, f);
+    }
+}
+
+static const char *aot_tmpl_banner =
+"/**\n"
+"  ******************************************************************************\n"
+"  * @file    @name@%s\n"
+"  * @author  AST Embedded Analytics Research Platform\n"
+"  * @date    @date@\n"
+"  * @brief   AI ahead-of-time compiled network (model \"@source@\")\n"
+"  ******************************************************************************\n"
+"  * @attention\n"
+"  *\n"
+"  * Copyright (c) 2018 STMicroelectronics.\n"
+"  * All rights reserved.\n"
+"  *\n"
+"  * This software component is licensed by ST under Ultimate Liberty license\n"
+"  * SLA0044, the \"License\"; You may not use this file except in compliance with\n"
+"  * the License. You may obtain a copy of the License at:\n"
+"  *                             www.st.com/SLA0044\n"
+"  *\n"
+"  ******************************************************************************\n"
+"  */\n";
+
+static void aotBanner(FILE *f, const struct aot_names *names,
+        const char *suffix)
+{
+    char *banner = NULL;
+    if (asprintf(&banner, aot_tmpl_banner, suffix) < 0)
+        return;
+    aotTemplate(f, names, banner);
+    free(banner);
+}
+
+static const char *aot_tmpl_header =
+"\n"
+"#ifndef __AI_@NAME@_H__\n"
+"#define __AI_@NAME@_H__\n"
+"#pragma once\n"
+"\n"
+"#include \"ai_platform.h\"\n"
+"\n"
+"#define AI_@NAME@_MODEL_NAME          \"@name@\"\n"
+"#define AI_@NAME@_SOURCE_NAME         \"@source@\"\n"
+"#define AI_@NAME@_SOURCE_SIGNATURE    \"@signature@\"\n"
+"\n"
+"#define AI_@NAME@_IN_NUM       (1)\n"
+"#define AI_@NAME@_IN_1_SIZE    (%d)\n"
+"#define AI_@NAME@_OUT_NUM      (1)\n"
+"#define AI_@NAME@_OUT_1_SIZE   (%d)\n"
+"\n"
+"#define AI_@NAME@_N_NODES      (%d)\n"
+"#define AI_@NAME@_MACC         (%u)\n"
+"\n"
+"AI_API_DECLARE_BEGIN\n"
+"\n"
+"/*!\n"
+" * @defgroup @name@\n"
+" * @brief Ahead-of-time compiled neural network\n"
+" * @details The c-nodes of the model are compiled to straight-line code:\n"
+" * the network has no context, no activations buffer and no weights buffer.\n"
+" */\n"
+"\n"
+"/*!\n"
+" * @brief Run the network on the samples of the input buffer.\n"
+" * @ingroup @name@\n"
+" * @param network not used (stateless network), may be AI_HANDLE_NULL\n"
+" * @param[in] input float input buffer, n_batches samples of\n"
+" * AI_@NAME@_IN_1_SIZE elements\n"
+" * @param[out] output float output buffer, n_batches samples (at least the\n"
+" * ones of the input) of AI_@NAME@_OUT_1_SIZE elements\n"
+" * @return the number of processed samples, 0 if the buffers are invalid\n"
+" */\n"
+"AI_API_ENTRY\n"
+"ai_i32 ai_@name@_run(\n"
+"  ai_handle network, const ai_buffer* input, ai_buffer* output);\n"
+"\n"
+"AI_API_DECLARE_END\n"
+"\n"
+"#endif /* __AI_@NAME@_H__ */\n";
+
+static const char *aot_tmpl_dense =
+"\n"
+"/* out[o] = b[o] + sum_i(w[o][i] * in[i]) */\n"
+"template <int N_IN, int N_OUT>\n"
+"inline void dense(float* out, const float* in,\n"
+"                  const float (&w)[N_OUT][N_IN], const float (&b)[N_OUT])\n"
+"{\n"
+"  for (int o = 0; o < N_OUT; o++) {\n"
+"    float acc = b[o];\n"
+"    for (int i = 0; i < N_IN; i++)\n"
+"      acc += w[o][i] * in[i];\n"
+"    out[o] = acc;\n"
+"  }\n"
+"}\n"
+"\n"
+"template <int N_IN, int N_OUT>\n"
+"inline void dense(float* out, const float* in,\n"
+"                  const float (&w)[N_OUT][N_IN])\n"
+"{\n"
+"  for (int o = 0; o < N_OUT; o++) {\n"
+"    float acc = 0.0f;\n"
+"    for (int i = 0; i < N_IN; i++)\n"
+"      acc += w[o][i] * in[i];\n"
+"    out[o] = acc;\n"
+"  }\n"
+"}\n";
+
+static const char *aot_tmpl_pointwise =
+"\n"
+"/* out[i] = F(in[i]), out may be in */\n"
+"template <int N, float (*F)(float)>\n"
+"inline void pointwise(float* out, const float* in)\n"
+"{\n"
+"  for (int i = 0; i < N; i++)\n"
+"    out[i] = F(in[i]);\n"
+"}\n";
+
+static const char *aot_tmpl_run =
+"\n"
+"} /* namespace */\n"
+"\n"
+"AI_API_ENTRY\n"
+"ai_i32 ai_@name@_run(\n"
+"  ai_handle network, const ai_buffer* input, ai_buffer* output)\n"
+"{\n"
+"  (void)network;\n"
+"  if (!input || !output || !input->data || !output->data)\n"
+"    return 0;\n"
+"  if ((AI_BUFFER_FMT_GET_TYPE(input->format) != AI_BUFFER_FMT_TYPE_FLOAT) ||\n"
+"      (AI_BUFFER_FMT_GET_TYPE(output->format) != AI_BUFFER_FMT_TYPE_FLOAT) ||\n"
+"      (AI_BUFFER_SIZE(input) != AI_@NAME@_IN_1_SIZE) ||\n"
+"      (AI_BUFFER_SIZE(output) != AI_@NAME@_OUT_1_SIZE))\n"
+"    return 0;\n"
+"\n"
+"  const ai_i32 n_batches = (input->n_batches > 0) ? input->n_batches : 1;\n"
+"  if ((output->n_batches > 0) ? (output->n_batches < n_batches) : (n_batches > 1))\n"
+"    return 0;\n"
+"\n"
+"  const float* in = static_cast<const float*>(input->data);\n"
+"  float* out = static_cast<float*>(output->data);\n"
+"  for (ai_i32 b = 0; b < n_batches; b++) {\n"
+"    forward(out, in);\n"
+"    in += AI_@NAME@_IN_1_SIZE;\n"
+"    out += AI_@NAME@_OUT_1_SIZE;\n"
+"  }\n"
+"  return n_batches;\n"
+"}\n";
+
+/* float literal, rounds-trips to the same float */
+static void aotFloat(FILE *f, float v)
+{
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.9g", v);
+    fputs(buf, f);
+    if (!strpbrk(buf, ".en"))
+        fputs(".0", f);
+    fputc('f', f);
+}
+
+/* name of the float array holding the output of c-node k */
+static void aotActName(char *buf, size_t len, const struct aot_ctx *ctx, int k)
+{
+    if (k < 0)
+        snprintf(buf, len, "in");
+    else if (k == ctx->n_nodes - 1)
+        snprintf(buf, len, "out");
+    else
+        snprintf(buf, len, "a%d", k);
+}
+
+static void aotEmitWeights(FILE *f, const struct aot_node *an, int k)
+{
+    const ai_float *w = AI_ARRAY_OBJ_DATA(an->w->data, ai_float);
+
+    fprintf(f, "\nconst float node%d_w[%d][%d] = {\n", k, an->n_out, an->n_in);
+    for (int o = 0; o < an->n_out; o++) {
+        fprintf(f, "  {");
+        for (int i = 0; i < an->n_in; i++) {
+            fputs(((an->n_in > 6) && !(i % 6)) ? "\n    " : " ", f);
+            aotFloat(f, w[o * an->n_in + i]);
+            fputc(',', f);
+        }
+        fprintf(f, "%s},\n", (an->n_in > 6) ? "\n  " : " ");
+    }
+    fprintf(f, "};\n");
+    if (an->b) {
+        const ai_float *b = AI_ARRAY_OBJ_DATA(an->b->data, ai_float);
+        fprintf(f, "\nconst float node%d_b[%d] = {", k, an->n_out);
+        for (int o = 0; o < an->n_out; o++) {
+            fputs((o % 6) ? " " : "\n  ", f);
+            aotFloat(f, b[o]);
+            fputc(',', f);
+        }
+        fprintf(f, "\n};\n");
+    }
+}
+
+static void aotEmitDenseUnrolled(FILE *f, const struct aot_node *an,
+        const char *in, const char *out)
+{
+    const ai_float *w = AI_ARRAY_OBJ_DATA(an->w->data, ai_float);
+    const ai_float *b = (an->b) ? AI_ARRAY_OBJ_DATA(an->b->data, ai_float) : NULL;
+
+    for (int o = 0; o < an->n_out; o++) {
+        fprintf(f, "  %s[%d] = ", out, o);
+        if (b)
+            aotFloat(f, b[o]);
+        else
+            fputs("0.0f", f);
+        /* same accumulation order as the runtime kernel: bias first */
+        for (int i = 0; i < an->n_in; i++) {
+            const float v = w[o * an->n_in + i];
+            fputs((i && !(i % 4)) ? "\n      " : " ", f);
+            fputs((v < 0.0f) ? "- " : "+ ", f);
+            aotFloat(f, (v < 0.0f) ? -v : v);
+            fprintf(f, " * %s[%d]", in, i);
+        }
+        fprintf(f, ";\n");
+    }
+}
+
+static int aotEmitSource(FILE *f, const struct aot_ctx *ctx,
+        const struct aot_names *names)
+{
+    char in[16], out[16];
+
+    aotBanner(f, names, ".cpp");
+    fprintf(f, "\n#include <cmath>\n\n");
+    aotTemplate(f, names, "#include \"@name@.h\"\n\nnamespace {\n");
+
+    if (ctx->dense_tmpl)
+        fputs(aot_tmpl_dense, f);
+    if (ctx->pointwise_tmpl)
+        fputs(aot_tmpl_pointwise, f);
+    for (int i = 0; i < AOT_N_NL; i++) {
+        if (!ctx->used_nl[i])
+            continue;
+        fprintf(f, "\ninline float nl_%s(float x)\n{\n  return %s;\n}\n",
+                aot_nl_table[i].name, aot_nl_table[i].expr);
+    }
+
+    for (int k = 0; k < ctx->n_nodes; k++) {
+        const struct aot_node *an = &ctx->nodes[k];
+        if (an->w && !an->unrolled)
+            aotEmitWeights(f, an, k);
+    }
+
+    fprintf(f, "\n/* one sample, %d c-node(s), %u MACC */\n", ctx->n_nodes,
+            (unsigned)ctx->n_macc);
+    fprintf(f, "inline void forward(float* out, const float* in)\n{\n");
+    for (int k = 0; k < ctx->n_nodes - 1; k++)
+        fprintf(f, "  float a%d[%d];\n", k, ctx->nodes[k].n_out);
+
+    for (int k = 0; k < ctx->n_nodes; k++) {
+        const struct aot_node *an = &ctx->nodes[k];
+        aotActName(in, sizeof(in), ctx, k - 1);
+        aotActName(out, sizeof(out), ctx, k);
+
+        fprintf(f, "%s  /* c-node %d: %s %dx%d (id %d)%s */\n",
+                (k || ctx->n_nodes > 1) ? "\n" : "", k,
+                (an->w) ? "dense" : an->nl->name, an->n_in, an->n_out,
+                an->id, (an->unrolled) ? ", unrolled" : "");
+        if (an->w && an->unrolled) {
+            aotEmitDenseUnrolled(f, an, in, out);
+        } else if (an->w) {
+            fprintf(f, "  dense(%s, %s, node%d_w", out, in, k);
+            if (an->b)
+                fprintf(f, ", node%d_b", k);
+            fprintf(f, ");\n");
+        } else if (an->unrolled) {
+            for (int i = 0; i < an->n_out; i++)
+                fprintf(f, "  %s[%d] = nl_%s(%s[%d]);\n", out, i,
+                        an->nl->name, in, i);
+        } else {
+            fprintf(f, "  pointwise<%d, nl_%s>(%s, %s);\n", an->n_out,
+                    an->nl->name, out, in);
+        }
+    }
+    fprintf(f, "}\n");
+
+    aotTemplate(f, names, aot_tmpl_run);
+    return ferror(f) ? -1 : 0;
+}
+
+static int aotEmitHeader(FILE *f, const struct aot_ctx *ctx,
+        const struct aot_names *names)
+{
+    char *header = NULL;
+
+    aotBanner(f, names, ".h");
+    if (asprintf(&header, aot_tmpl_header, ctx->n_in, ctx->n_out,
+            ctx->n_nodes, (unsigned)ctx->n_macc) < 0)
+        return -1;
+    aotTemplate(f, names, header);
+    free(header);
+    return ferror(f) ? -1 : 0;
+}
+
+typedef int (*aot_emit_fn)(FILE *f, const struct aot_ctx *ctx,
+        const struct aot_names *names);
+
+static int aotEmitFile(const char *dir, const char *suffix,
+        const struct aot_ctx *ctx, const struct aot_names *names,
+        aot_emit_fn emit)
+{
+    char path[512];
+    FILE *f;
+    int res;
+
+    snprintf(path, sizeof(path), "%s/%s%s", dir, names->name, suffix);
+    f = fopen(path, "w");
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+    res = emit(f, ctx, names);
+    if (fclose(f) || res) {
+        fprintf(stderr, "E: unable to write %s\n", path);
+        return -1;
+    }
+    printf("  %s\n", path);
+    return 0;
+}
+
+static int aotEmit(const struct aot_config *cfg, const struct aot_ctx *ctx,
+        const ai_network_report *report)
+{
+    struct aot_names names = {
+            .name = cfg->name,
+            .source = report->model_name,
+            .signature = report->model_signature,
+    };
+    const char *inc_dir = (cfg->inc_dir) ? cfg->inc_dir : cfg->dir;
+    const time_t now = time(NULL);
+
+    for (size_t i = 0; cfg->name[i] && i < sizeof(names.upper) - 1; i++)
+        names.upper[i] = (char)toupper((unsigned char)cfg->name[i]);
+    strftime(names.date, sizeof(names.date), "%a %b %e %H:%M:%S %Y",
+            localtime(&now));
+
+    printf("Generating \"%s\"...\n", cfg->name);
+    if (aotEmitFile(inc_dir, ".h", ctx, &names, aotEmitHeader) ||
+            aotEmitFile(cfg->dir, ".cpp", ctx, &names, aotEmitSource))
+        return -1;
+    return 0;
+}
+
+/* -----------------------------------------------------------------------------
+ * Main
+ * -----------------------------------------------------------------------------
+ */
+
+static void aotPrint(const struct aot_ctx *ctx)
+{
+    printf(" c_id  type         shape        code\n");
+    for (int k = 0; k < ctx->n_nodes; k++) {
+        const struct aot_node *an = &ctx->nodes[k];
+        char shape[32];
+        snprintf(shape, sizeof(shape), "%dx%d", an->n_in, an->n_out);
+        printf(" %-5d %-12s %-12s %s\n", k, (an->w) ? "dense" : an->nl->name,
+                shape, (an->unrolled) ? "unrolled" : "template");
+    }
+}
+
+static void aotUsage(const char *prog)
+{
+    printf("usage: %s [-m model] [-n name] [-o dir] [-H dir] [-u max_macc]\n",
+            prog);
+    printf("  -m  embedded float model to compile (default: the first one)\n");
+    printf("  -n  name of the generated network (default %s)\n", _AOT_DEF_NAME_);
+    printf("  -o  output directory of the generated source (default .)\n");
+    printf("  -H  output directory of the generated header (default: -o)\n");
+    printf("  -u  max MACC of a fully unrolled c-node (default %d)\n",
+            _AOT_DEF_UNROLL_);
+}
+
+int main(int argc, char *argv[])
+{
+    struct aot_config cfg = {
+            .model = NULL,
+            .name = _AOT_DEF_NAME_,
+            .dir = ".",
+            .inc_dir = NULL,
+            .unroll = _AOT_DEF_UNROLL_,
+    };
+    struct aot_ctx ctx = { 0 };
+    ai_network_report report;
+    ai_handle handle = AI_HANDLE_NULL;
+    ai_handle net_hdl;
+    ai_network_params net_params;
+    ai_u8 *activations = NULL;
+    const char *nn_name;
+    ai_error err;
+    int res = 1;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "m:n:o:H:u:h")) != -1) {
+        switch (opt) {
+        case 'm': cfg.model = optarg; break;
+        case 'n': cfg.name = optarg; break;
+        case 'o': cfg.dir = optarg; break;
+        case 'H': cfg.inc_dir = optarg; break;
+        case 'u': cfg.unroll = atoi(optarg); break;
+        default:
+            aotUsage(argv[0]);
+            return (opt == 'h') ? 0 : 1;
+        }
+    }
+
+    printf("# %s\n", _AOT_NAME_);
+
+    /* ai_mnetwork_find() falls back on the first network if name is unknown */
+    nn_name = ai_mnetwork_find(cfg.model, 0);
+    if (!nn_name || (cfg.model && strcmp(nn_name, cfg.model))) {
+        fprintf(stderr, "E: no embedded network \"%s\"\n",
+                cfg.model ? cfg.model : "");
+        return 1;
+    }
+
+    err = ai_mnetwork_create(nn_name, &handle, NULL);
+    if (err.type) {
+        fprintf(stderr, "E: AI error (ai_mnetwork_create) - type=%d code=%d\n",
+                err.type, err.code);
+        return 1;
+    }
+
+    activations = malloc(AI_MNETWORK_DATA_ACTIVATIONS_INT_SIZE + 4);
+    ai_network_params params = {
+            AI_BUFFER_OBJ_INIT(AI_BUFFER_FORMAT_NONE|AI_BUFFER_FMT_FLAG_CONST,
+                    0, 0, 0, 0, NULL),
+            AI_BUFFER_OBJ_INIT(AI_BUFFER_FORMAT_NONE|AI_BUFFER_FMT_FLAG_CONST,
+                    0, 0, 0, 0, AI_HANDLE_PTR(activations)) };
+
+    if (!activations || !ai_mnetwork_init(handle, &params) ||
+            !ai_mnetwork_get_info(handle, &report)) {
+        err = ai_mnetwork_get_error(handle);
+        fprintf(stderr, "E: AI error (ai_mnetwork_init) - type=%d code=%d\n",
+                err.type, err.code);
+        goto done;
+    }
+    printf("Compiling \"%s\" (%u c-nodes, %u MACC)\n", nn_name,
+            (unsigned)report.n_nodes, (unsigned)report.n_macc);
+
+    if ((report.n_inputs != 1) || (report.n_outputs != 1) ||
+            (AI_BUFFER_FMT_GET_TYPE(report.inputs[0].format) != AI_BUFFER_FMT_TYPE_FLOAT)) {
+        fprintf(stderr, "E: a float model with a single input/output is expected\n");
+        goto done;
+    }
+
+    ai_mnetwork_get_private_handle(handle, &net_hdl, &net_params);
+    if (aotGraphInit(&ctx, AI_NETWORK_ACQUIRE_CTX(net_hdl), cfg.unroll))
+        goto done;
+    aotPrint(&ctx);
+
+    res = aotEmit(&cfg, &ctx, &report) ? 1 : 0;
+
+done:
+    free(ctx.nodes);
+    ai_mnetwork_destroy(handle);
+    free(activations);
+    return res;
+}
@@ -0,0 +1,1839 @@
+/**
+  ******************************************************************************
+  * @file    aiQuantize.c
+  * @brief   Post-training int8 quantization / weights compression of an
+  *          embedded network
+  ******************************************************************************
+  * @attention
+  *
+  * The float network is initialized through the ai_mnetwork_* API (the graph
+  * optimizations of the runtime included) and run on representative inputs,
+  * an observer recording the range of each activation tensor. The executed
+  * graph is then quantized with the SSSA scheme of the runtime:
+  *  - weights: int8, symmetric, one scale per output channel (or per layer
+  *    with -t); with -w 4 packed int4 (S4 format, two per byte, the rows
+  *    padded to a byte), halving the weights size
+  *  - activations (and network I/O): int8, asymmetric, one scale/zero point
+  *    per tensor, derived from the observed min/max (0 always included)
+  *  - bias: int32 in the accumulator scale (s_in * s_w)
+  * and emitted as a generated model (<name>.c/.h, <name>_data.c/.h) in the
+  * layout of the X-CUBE-AI generated files, the scales and zero points being
+  * declared as the intq info of the tensors.
+  *
+  * With -l 8 or -l 4 the weights are compressed instead (no calibration):
+  * the weights of each layer are clustered (1-D k-means) on a codebook of
+  * 256 or 16 float centroids and stored as 8 or 4 bits indices
+  * (LUT8_FLOAT / LUT4_FLOAT formats: the table then the indices, the 4 bits
+  * rows padded to a byte), the bias and the activations staying in float.
+  *
+  * With -s density the model stays in float and the weights of the layers
+  * whose density of non zero blocks (AI_DENSE_BSR_BLOCK outputs x 1 input)
+  * is at most the given one are stored block sparse (BSR_FLOAT format: the
+  * blocks index then the non zero blocks), the other layers keeping dense
+  * float weights.
+  *
+  * usage: aiQuantize -i calibration.txt [-m model] [-n name] [-o dir]
+  *                   [-H dir] [-t] [-w 8|4]
+  *        aiQuantize -l 8|4 [-m model] [-n name] [-o dir] [-H dir]
+  *        aiQuantize -s density [-m model] [-n name] [-o dir] [-H dir]
+  *
+  * The calibration file holds the float input samples as text (whitespace
+  * separated, '#' starts a comment), one sample after the other.
+  * Only the dense layers are supported by the emitter.
+  *
+  ******************************************************************************
+  */
+
+#define _GNU_SOURCE
+
+/* System headers */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+
+/* AI header files */
+#include "app_x-cube-ai.h"
+#include "ai_platform_interface.h"
+#include "core_common.h"
+#include "core_plan.h"
+#include "layers.h"
+#include "ai_math_helpers.h"
+
+#define _QUANT_NAME_            "AI int8 post-training quantization / weights compression (host)"
+
+#define _QUANT_DEF_NAME_        "network_q"
+#define _QUANT_DEF_Q4_NAME_     "network_q4"
+#define _QUANT_DEF_LUT_NAME_    "network_lut"
+#define _QUANT_DEF_BSR_NAME_    "network_sparse"
+
+/* Lloyd iterations of the weights clustering */
+#define _QUANT_LUT_ITERATIONS_  (32)
+
+struct quant_config {
+    const char *calib;
+    const char *model;      /* NULL: first embedded network */
+    const char *name;
+    const char *dir;
+    const char *inc_dir;    /* NULL: dir */
+    bool per_channel;
+    int w_bits;             /* 8: int8, 4: packed int4 weights */
+    int lut_bits;           /* 0: int8, 8 or 4: codebook compressed weights */
+    float sparse;           /* > 0: max density of the block sparse weights */
+};
+
+/* quantization parameters of an activation tensor */
+struct quant_act {
+    float lo;
+    float hi;
+    float scale;
+    int zp;
+};
+
+struct quant_node {
+    int id;
+    int n_in;
+    int n_out;
+    const ai_tensor *w;
+    const ai_tensor *b;
+    int n_scales;
+    float *w_scale;
+    int8_t *w_q;            /* one weight per byte (int4 values with -w 4) */
+    int32_t *b_q;           /* NULL: no bias */
+    float *lut;             /* codebook (lut_bits) */
+    uint8_t *w_idx;         /* indices of the weights (lut_bits) */
+    size_t w_idx_size;
+    uint32_t *bsr_index;    /* block sparse weights (sparse) */
+    float *bsr_values;
+    size_t n_blocks;
+    float density;          /* non zero blocks / blocks */
+    bool bsr;               /* stored block sparse */
+    size_t lut_off;         /* data_start: codebook or blocks index */
+    size_t w_off;           /* weights blob offsets */
+    size_t b_off;
+    size_t act_off;         /* activations offset of the output (inner) */
+};
+
+struct quant_ctx {
+    int w_bits;
+    int lut_bits;
+    float sparse;
+    int n_nodes;
+    struct quant_node *nodes;
+    /* acts[0]: network input, acts[k+1]: output of the c-node k */
+    struct quant_act *acts;
+    const ai_tensor **tensors;
+    uint8_t *blob;
+    size_t blob_size;
+    size_t act_size;
+    uint32_t n_macc;
+    uint64_t n_samples;
+};
+
+/* -----------------------------------------------------------------------------
+ * Graph inspection and calibration
+ * -----------------------------------------------------------------------------
+ */
+
+static void quantRange(struct quant_act *act, const ai_tensor *t)
+{
+    const ai_float *data = AI_ARRAY_OBJ_DATA(t->data, ai_float);
+    const ai_size size = AI_ARRAY_OBJ_SIZE(t->data);
+    for (ai_size i = 0; i < size; i++) {
+        if (data[i] < act->lo)
+            act->lo = data[i];
+        if (data[i] > act->hi)
+            act->hi = data[i];
+    }
+}
+
+static ai_u32 quantObserverCb(const ai_handle cookie, const ai_u32 flags,
+        const ai_observer_node *node)
+{
+    struct quant_ctx *ctx = (struct quant_ctx *)cookie;
+
+    if (node->c_idx >= ctx->n_nodes)
+        return 0;
+    if ((flags & AI_OBSERVER_PRE_EVT) && (node->c_idx == 0))
+        quantRange(&ctx->acts[0], GET_TENSOR_IN(node->tensors, 0));
+    if (flags & AI_OBSERVER_POST_EVT)
+        quantRange(&ctx->acts[node->c_idx + 1],
+                GET_TENSOR_OUT(node->tensors, 0));
+    return 0;
+}
+
+static bool quantTensorIsF32(const ai_tensor *t)
+{
+    const ai_array_format fmt = AI_ARRAY_OBJ_FMT(t->data);
+    return (AI_FMT_GET_TYPE(fmt) == AI_FMT_FLOAT) && (AI_FMT_GET_BITS(fmt) == 32);
+}
+
+/* the executed graph should be a chain of float dense layers */
+static int quantGraphInit(struct quant_ctx *ctx, ai_network *net)
+{
+    const ai_tensor *prev = NULL;
+    int n = 0;
+
+    AI_FOR_EACH_NODE_DO(node, net->input_node) {
+        n++;
+    }
+    ctx->n_nodes = n;
+    ctx->nodes = calloc(n, sizeof(struct quant_node));
+    ctx->acts = calloc(n + 1, sizeof(struct quant_act));
+    ctx->tensors = calloc(n + 1, sizeof(ai_tensor *));
+    if (!ctx->nodes || !ctx->acts || !ctx->tensors)
+        return -1;
+
+    n = 0;
+    AI_FOR_EACH_NODE_DO(node, net->input_node) {
+        struct quant_node *qn = &ctx->nodes[n];
+        if ((AI_LAYER_TYPE(node->type) != AI_LAYER_DENSE_TYPE) ||
+                (node->forward != forward_dense)) {
+            fprintf(stderr, "E: c-node %d (%s) is not supported\n", n,
+                    ai_layer_type_name(AI_LAYER_TYPE(node->type)));
+            return -1;
+        }
+        if ((GET_TENSOR_LIST_SIZE(GET_TENSOR_LIST_IN(node->tensors)) != 1) ||
+                (GET_TENSOR_LIST_SIZE(GET_TENSOR_LIST_OUT(node->tensors)) != 1) ||
+                (prev && (GET_TENSOR_IN(node->tensors, 0) != prev))) {
+            fprintf(stderr, "E: c-node %d is not part of a chain\n", n);
+            return -1;
+        }
+        AI_LAYER_WEIGHTS_GET(node, w, b)
+        if (!quantTensorIsF32(w) || (b && !quantTensorIsF32(b)) ||
+                !quantTensorIsF32(GET_TENSOR_OUT(node->tensors, 0))) {
+            fprintf(stderr, "E: c-node %d is not a float layer\n", n);
+            return -1;
+        }
+        qn->id = (int)node->id;
+        qn->w = w;
+        qn->b = b;
+        qn->n_in = AI_SHAPE_IN_CH(&w->shape);
+        qn->n_out = AI_SHAPE_CH(&w->shape);
+        ctx->n_macc += (uint32_t)(qn->n_in * qn->n_out);
+        if (n == 0)
+            ctx->tensors[0] = GET_TENSOR_IN(node->tensors, 0);
+        prev = ctx->tensors[n + 1] = GET_TENSOR_OUT(node->tensors, 0);
+        n++;
+    }
+
+    for (int i = 0; i <= ctx->n_nodes; i++) {
+        ctx->acts[i].lo = INFINITY;
+        ctx->acts[i].hi = -INFINITY;
+    }
+    return 0;
+}
+
+static float *quantReadSamples(const char *path, size_t *n_values)
+{
+    FILE *f = (strcmp(path, "-") == 0) ? stdin : fopen(path, "r");
+    float *values = NULL;
+    size_t n = 0, cap = 0;
+    char tok[64];
+    int c;
+
+    if (!f) {
+        perror(path);
+        return NULL;
+    }
+
+    for (;;) {
+        size_t len = 0;
+        while (((c = fgetc(f)) != EOF) && isspace(c))
+            ;
+        if (c == '#') {
+            while (((c = fgetc(f)) != EOF) && (c != '\n'))
+                ;
+            continue;
+        }
+        if (c == EOF)
+            break;
+        do {
+            if (len < sizeof(tok) - 1)
+                tok[len++] = (char)c;
+        } while (((c = fgetc(f)) != EOF) && !isspace(c) && (c != '#'));
+        if (c == '#')
+            ungetc(c, f);
+        tok[len] = 0;
+
+        char *end;
+        const float v = strtof(tok, &end);
+        if (*end) {
+            fprintf(stderr, "E: %s: invalid value \"%s\"\n", path, tok);
+            free(values);
+            values = NULL;
+            n = 0;
+            break;
+        }
+        if (n == cap) {
+            cap = cap ? 2 * cap : 256;
+            float *p = realloc(values, cap * sizeof(float));
+            if (!p) {
+                free(values);
+                values = NULL;
+                n = 0;
+                break;
+            }
+            values = p;
+        }
+        values[n++] = v;
+    }
+
+    if (f != stdin)
+        fclose(f);
+    *n_values = n;
+    return values;
+}
+
+static int quantCalibrate(struct quant_ctx *ctx, ai_handle handle,
+        const ai_network_report *report, const float *samples, size_t n_values)
+{
+    const ai_size in_size = AI_BUFFER_SIZE(&report->inputs[0]);
+    const ai_size out_size = AI_BUFFER_SIZE(&report->outputs[0]);
+    const size_t n_samples = n_values / in_size;
+    const int batch = AI_MAX(report->activations.n_batches, 1);
+    ai_float *out = malloc(out_size * batch * sizeof(ai_float));
+    ai_buffer ai_input = report->inputs[0];
+    ai_buffer ai_output = report->outputs[0];
+    int res = 0;
+
+    if (!out)
+        return -1;
+
+    for (size_t s = 0; s < n_samples; s += batch) {
+        const int n = (int)AI_MIN((size_t)batch, n_samples - s);
+        ai_input.n_batches = (ai_u16)n;
+        ai_input.data = AI_HANDLE_PTR(samples + s * in_size);
+        ai_output.n_batches = (ai_u16)n;
+        ai_output.data = AI_HANDLE_PTR(out);
+        if (ai_mnetwork_run(handle, &ai_input, &ai_output) != n) {
+            const ai_error err = ai_mnetwork_get_error(handle);
+            fprintf(stderr, "E: AI error (ai_mnetwork_run) - type=%d code=%d\n",
+                    err.type, err.code);
+            res = -1;
+            break;
+        }
+    }
+    ctx->n_samples = n_samples;
+
+    free(out);
+    return res;
+}
+
+/* -----------------------------------------------------------------------------
+ * Quantization
+ * -----------------------------------------------------------------------------
+ */
+
+static void quantActParams(struct quant_act *act)
+{
+    const float lo = AI_MIN(act->lo, 0.0f);
+    float hi = AI_MAX(act->hi, 0.0f);
+    if (hi - lo < 1e-6f)
+        hi = lo + 1e-6f;
+    act->scale = (hi - lo) / 255.0f;
+    act->zp = (int)AI_CLAMP(lroundf(-128.0f - lo / act->scale), -128, 127);
+}
+
+static size_t quantAlign4(size_t v)
+{
+    return (v + 3) & ~(size_t)3;
+}
+
+static int quantNode(struct quant_node *qn, const struct quant_act *in,
+        bool per_channel, int w_bits)
+{
+    const int q_max = (1 << (w_bits - 1)) - 1;
+    const ai_float *w = AI_ARRAY_OBJ_DATA(qn->w->data, ai_float);
+    const ai_float *b = (qn->b) ? AI_ARRAY_OBJ_DATA(qn->b->data, ai_float) : NULL;
+
+    qn->n_scales = (per_channel) ? qn->n_out : 1;
+    qn->w_scale = calloc(qn->n_scales, sizeof(float));
+    qn->w_q = malloc((size_t)qn->n_out * qn->n_in);
+    qn->b_q = (b) ? malloc(qn->n_out * sizeof(int32_t)) : NULL;
+    if (!qn->w_scale || !qn->w_q || (b && !qn->b_q))
+        return -1;
+
+    for (int o = 0; o < qn->n_out; o++) {
+        float *s = &qn->w_scale[(per_channel) ? o : 0];
+        for (int i = 0; i < qn->n_in; i++)
+            *s = AI_MAX(*s, fabsf(w[o * qn->n_in + i]));
+    }
+    for (int i = 0; i < qn->n_scales; i++)
+        qn->w_scale[i] = (qn->w_scale[i] > 0.0f) ? qn->w_scale[i] / q_max : 1.0f;
+
+    for (int o = 0; o < qn->n_out; o++) {
+        const float s = qn->w_scale[(per_channel) ? o : 0];
+        for (int i = 0; i < qn->n_in; i++)
+            qn->w_q[o * qn->n_in + i] =
+                    (int8_t)AI_CLAMP(lroundf(w[o * qn->n_in + i] / s), -q_max, q_max);
+        if (b)
+            qn->b_q[o] = (int32_t)lroundf(b[o] / (in->scale * s));
+    }
+    return 0;
+}
+
+/* activations: the inner outputs (one sample), the I/O are user buffers.
+ * The output of the c-node k lives until its use by the c-node k+1 */
+static int quantPlan(struct quant_ctx *ctx, size_t elem_size)
+{
+    ctx->act_size = 0;
+    if (ctx->n_nodes > 1) {
+        ai_plan_buffer *plan = calloc(ctx->n_nodes - 1, sizeof(ai_plan_buffer));
+        if (!plan)
+            return -1;
+        for (int k = 0; k < ctx->n_nodes - 1; k++) {
+            plan[k].size = AI_TENSOR_SIZE(ctx->tensors[k + 1]) * elem_size;
+            plan[k].first = (ai_u16)k;
+            plan[k].last = (ai_u16)(k + 1);
+        }
+        ctx->act_size = core_plan_pack(plan, ctx->n_nodes - 1);
+        for (int k = 0; k < ctx->n_nodes - 1; k++)
+            ctx->nodes[k].act_off = plan[k].offset;
+        free(plan);
+        if (!ctx->act_size)
+            return -1;
+    }
+    return 0;
+}
+
+/* bytes of a weights row: int8, or int4 packed as the runtime expects */
+static size_t quantRowSize(const struct quant_ctx *ctx, int n_in)
+{
+    return (ctx->w_bits == 4) ? AI_DENSE_Q4_ROW_SIZE(n_in) : (size_t)n_in;
+}
+
+static void quantPackWeights(const struct quant_ctx *ctx,
+        const struct quant_node *qn, uint8_t *dst)
+{
+    const size_t row = quantRowSize(ctx, qn->n_in);
+
+    if (ctx->w_bits != 4) {
+        memcpy(dst, qn->w_q, (size_t)qn->n_out * qn->n_in);
+        return;
+    }
+    /* first weight of a pair in the high nibble */
+    for (int o = 0; o < qn->n_out; o++) {
+        for (int i = 0; i < qn->n_in; i++) {
+            const uint8_t v = (uint8_t)qn->w_q[o * qn->n_in + i] & 0xF;
+            dst[o * row + (i >> 1)] |= (i & 1) ? v : (uint8_t)(v << 4);
+        }
+    }
+}
+
+static int quantGraph(struct quant_ctx *ctx, bool per_channel)
+{
+    for (int i = 0; i <= ctx->n_nodes; i++)
+        quantActParams(&ctx->acts[i]);
+
+    /* weights blob: per layer, the int8 (int4) weights then the int32 bias */
+    size_t off = 0;
+    for (int k = 0; k < ctx->n_nodes; k++) {
+        struct quant_node *qn = &ctx->nodes[k];
+        if (quantNode(qn, &ctx->acts[k], per_channel, ctx->w_bits))
+            return -1;
+        qn->w_off = off;
+        off = quantAlign4(off + qn->n_out * quantRowSize(ctx, qn->n_in));
+        qn->b_off = off;
+        if (qn->b_q)
+            off += qn->n_out * sizeof(int32_t);
+    }
+    ctx->blob_size = off;
+    ctx->blob = calloc(1, AI_MAX(off, 1));
+    if (!ctx->blob)
+        return -1;
+    for (int k = 0; k < ctx->n_nodes; k++) {
+        const struct quant_node *qn = &ctx->nodes[k];
+        quantPackWeights(ctx, qn, ctx->blob + qn->w_off);
+        if (qn->b_q)
+            memcpy(ctx->blob + qn->b_off, qn->b_q, qn->n_out * sizeof(int32_t));
+    }
+
+    return quantPlan(ctx, sizeof(int8_t));
+}
+
+/* -----------------------------------------------------------------------------
+ * Weights compression
+ * -----------------------------------------------------------------------------
+ */
+
+static int quantCmpFloat(const void *a, const void *b)
+{
+    const float x = *(const float *)a, y = *(const float *)b;
+    return (x > y) - (x < y);
+}
+
+/* 1-D k-means of the n weights on k centroids, seeded on the quantiles: the
+ * weights are sorted, so each cluster is a range of them and each Lloyd
+ * iteration is a single pass */
+static void quantCluster(float *lut, int k, const float *w, size_t n)
+{
+    float *v = malloc(n * sizeof(float));
+    size_t *start = malloc((k + 1) * sizeof(size_t));
+
+    if (!v || !start) {
+        for (int c = 0; c < k; c++)
+            lut[c] = w[(size_t)c * n / k];
+        free(v);
+        free(start);
+        return;
+    }
+    memcpy(v, w, n * sizeof(float));
+    qsort(v, n, sizeof(float), quantCmpFloat);
+    for (int c = 0; c < k; c++)
+        lut[c] = v[(2 * (size_t)c + 1) * n / (2 * (size_t)k)];
+
+    for (int it = 0; it < _QUANT_LUT_ITERATIONS_; it++) {
+        size_t i = 0;
+        start[0] = 0;
+        for (int c = 1; c < k; c++) {
+            const float mid = 0.5f * (lut[c - 1] + lut[c]);
+            while ((i < n) && (v[i] < mid))
+                i++;
+            start[c] = i;
+        }
+        start[k] = n;
+        bool moved = false;
+        for (int c = 0; c < k; c++) {
+            if (start[c + 1] == start[c])
+                continue;       /* empty: kept, never the nearest */
+            double sum = 0.0;
+            for (size_t j = start[c]; j < start[c + 1]; j++)
+                sum += v[j];
+            const float m = (float)(sum / (double)(start[c + 1] - start[c]));
+            moved |= (m != lut[c]);
+            lut[c] = m;
+        }
+        if (!moved)
+            break;
+    }
+    free(v);
+    free(start);
+}
+
+static uint8_t quantNearest(const float *lut, int k, float x)
+{
+    int best = 0;
+    for (int c = 1; c < k; c++)
+        if (fabsf(x - lut[c]) < fabsf(x - lut[best]))
+            best = c;
+    return (uint8_t)best;
+}
+
+static int quantNodeLut(struct quant_node *qn, int bits)
+{
+    const ai_float *w = AI_ARRAY_OBJ_DATA(qn->w->data, ai_float);
+    const size_t n = (size_t)qn->n_out * qn->n_in;
+    const size_t row = (bits == 4) ? AI_DENSE_LUT4_ROW_SIZE(qn->n_in) : qn->n_in;
+    const int k = 1 << bits;
+
+    qn->lut = calloc(k, sizeof(float));
+    qn->w_idx_size = row * qn->n_out;
+    qn->w_idx = calloc(1, qn->w_idx_size);
+    if (!qn->lut || !qn->w_idx)
+        return -1;
+
+    quantCluster(qn->lut, k, w, n);
+    for (int o = 0; o < qn->n_out; o++) {
+        uint8_t *dst = qn->w_idx + o * row;
+        for (int i = 0; i < qn->n_in; i++) {
+            const uint8_t c = quantNearest(qn->lut, k, w[o * qn->n_in + i]);
+            if (bits == 8)
+                dst[i] = c;
+            else
+                dst[i >> 1] |= (i & 1) ? c : (uint8_t)(c << 4);
+        }
+    }
+    return 0;
+}
+
+/* weights blob: per layer, the codebook, the indices then the float bias;
+ * the activations are float (4 bytes per element) */
+static int quantGraphLut(struct quant_ctx *ctx)
+{
+    const int k = 1 << ctx->lut_bits;
+    size_t off = 0;
+
+    for (int n = 0; n < ctx->n_nodes; n++) {
+        struct quant_node *qn = &ctx->nodes[n];
+        if (quantNodeLut(qn, ctx->lut_bits))
+            return -1;
+        qn->lut_off = off;
+        qn->w_off = off + k * sizeof(float);
+        off = quantAlign4(qn->w_off + qn->w_idx_size);
+        qn->b_off = off;
+        if (qn->b)
+            off += qn->n_out * sizeof(float);
+    }
+    ctx->blob_size = off;
+    ctx->blob = calloc(1, AI_MAX(off, 1));
+    if (!ctx->blob)
+        return -1;
+    for (int n = 0; n < ctx->n_nodes; n++) {
+        const struct quant_node *qn = &ctx->nodes[n];
+        memcpy(ctx->blob + qn->lut_off, qn->lut, k * sizeof(float));
+        memcpy(ctx->blob + qn->w_off, qn->w_idx, qn->w_idx_size);
+        if (qn->b)
+            memcpy(ctx->blob + qn->b_off, AI_ARRAY_OBJ_DATA(qn->b->data, ai_float),
+                    qn->n_out * sizeof(float));
+    }
+    return quantPlan(ctx, sizeof(float));
+}
+
+/* -----------------------------------------------------------------------------
+ * Block sparse weights
+ * -----------------------------------------------------------------------------
+ */
+
+/* index (blocks row offsets then block columns) and non zero blocks of
+ * AI_DENSE_BSR_BLOCK outputs x 1 input, the last blocks row zero padded */
+static int quantNodeBsr(struct quant_node *qn)
+{
+    const ai_float *w = AI_ARRAY_OBJ_DATA(qn->w->data, ai_float);
+    const int n_groups = AI_DENSE_BSR_GROUPS(qn->n_out);
+    const size_t max_blocks = (size_t)n_groups * qn->n_in;
+
+    qn->bsr_index = malloc((n_groups + 1 + max_blocks) * sizeof(uint32_t));
+    qn->bsr_values = malloc(AI_MAX(max_blocks, 1) * AI_DENSE_BSR_BLOCK * sizeof(float));
+    if (!qn->bsr_index || !qn->bsr_values)
+        return -1;
+
+    uint32_t *columns = qn->bsr_index + n_groups + 1;
+    size_t n_blocks = 0;
+    for (int g = 0; g < n_groups; g++) {
+        qn->bsr_index[g] = (uint32_t)n_blocks;
+        for (int i = 0; i < qn->n_in; i++) {
+            bool zero = true;
+            for (int j = 0; j < AI_DENSE_BSR_BLOCK; j++) {
+                const int o = g * AI_DENSE_BSR_BLOCK + j;
+                if ((o < qn->n_out) && (w[o * qn->n_in + i] != 0.0f))
+                    zero = false;
+            }
+            if (zero)
+                continue;
+            for (int j = 0; j < AI_DENSE_BSR_BLOCK; j++) {
+                const int o = g * AI_DENSE_BSR_BLOCK + j;
+                qn->bsr_values[n_blocks * AI_DENSE_BSR_BLOCK + j] =
+                        (o < qn->n_out) ? w[o * qn->n_in + i] : 0.0f;
+            }
+            columns[n_blocks++] = (uint32_t)i;
+        }
+    }
+    qn->bsr_index[n_groups] = (uint32_t)n_blocks;
+    qn->n_blocks = n_blocks;
+    qn->density = (max_blocks) ? (float)n_blocks / (float)max_blocks : 1.0f;
+    return 0;
+}
+
+/* weights blob: per layer, the blocks index then the blocks (or the dense
+ * weights when the layer is not sparse enough), then the float bias */
+static int quantGraphSparse(struct quant_ctx *ctx)
+{
+    size_t off = 0;
+
+    for (int n = 0; n < ctx->n_nodes; n++) {
+        struct quant_node *qn = &ctx->nodes[n];
+        if (quantNodeBsr(qn))
+            return -1;
+        qn->bsr = (qn->density <= ctx->sparse);
+        qn->lut_off = off;
+        if (qn->bsr) {
+            qn->w_off = off + (AI_DENSE_BSR_GROUPS(qn->n_out) + 1 + qn->n_blocks) *
+                    sizeof(uint32_t);
+            off = qn->w_off + qn->n_blocks * AI_DENSE_BSR_BLOCK * sizeof(float);
+        } else {
+            qn->w_off = off;
+            off += (size_t)qn->n_out * qn->n_in * sizeof(float);
+        }
+        qn->b_off = off;
+        if (qn->b)
+            off += qn->n_out * sizeof(float);
+    }
+    ctx->blob_size = off;
+    ctx->blob = calloc(1, AI_MAX(off, 1));
+    if (!ctx->blob)
+        return -1;
+    for (int n = 0; n < ctx->n_nodes; n++) {
+        const struct quant_node *qn = &ctx->nodes[n];
+        if (qn->bsr) {
+            memcpy(ctx->blob + qn->lut_off, qn->bsr_index, qn->w_off - qn->lut_off);
+            memcpy(ctx->blob + qn->w_off, qn->bsr_values,
+                    qn->n_blocks * AI_DENSE_BSR_BLOCK * sizeof(float));
+        } else
+            memcpy(ctx->blob + qn->w_off, AI_ARRAY_OBJ_DATA(qn->w->data, ai_float),
+                    (size_t)qn->n_out * qn->n_in * sizeof(float));
+        if (qn->b)
+            memcpy(ctx->blob + qn->b_off, AI_ARRAY_OBJ_DATA(qn->b->data, ai_float),
+                    qn->n_out * sizeof(float));
+    }
+    return quantPlan(ctx, sizeof(float));
+}
+
+/* -----------------------------------------------------------------------------
+ * Code emission
+ * -----------------------------------------------------------------------------
+ */
+
+/* float model (codebook or block sparse weights) instead of an int8 one */
+static bool quantIsFloat(const struct quant_ctx *ctx)
+{
+    return (ctx->lut_bits != 0) || (ctx->sparse > 0.0f);
+}
+
+struct quant_names {
+    const char *name;       /* e.g. network_q */
+    char upper[64];         /* e.g. NETWORK_Q */
+    char date[32];
+    char signature[33];
+};
+
+/* writes tmpl, replacing @name@, @NAME@ and @date@ */
+static void quantTemplate(FILE *f, const struct quant_names *names,
+        const char *tmpl)
+{
+    static const char *keys[] = { "@name@", "@NAME@", "@date@" };
+    const char *values[] = { names->name, names->upper, names->date };
+
+    while (*tmpl) {
+        int k;
+        for (k = 0; k < 3; k++) {
+            const size_t len = strlen(keys[k]);
+            if (strncmp(tmpl, keys[k], len) == 0) {
+                fputs(values[k], f);
+                tmpl += len;
+                break;
+            }
+        }
+        if (k == 3)
+            fputc(*tmpl++, f);
+    }
+}
+
+static const char *quant_tmpl_banner =
+"/**\n"
+"  ******************************************************************************\n"
+"  * @file    @name@%s\n"
+"  * @author  AST Embedded Analytics Research Platform\n"
+"  * @date    @date@\n"
+"  * @brief   AI Tool Automatic Code Generator for Embedded NN computing\n"
+"  ******************************************************************************\n"
+"  * @attention\n"
+"  *\n"
+"  * Copyright (c) 2018 STMicroelectronics.\n"
+"  * All rights reserved.\n"
+"  *\n"
+"  * This software component is licensed by ST under Ultimate Liberty license\n"
+"  * SLA0044, the \"License\"; You may not use this file except in compliance with\n"
+"  * the License. You may obtain a copy of the License at:\n"
+"  *                             www.st.com/SLA0044\n"
+"  *\n"
+"  ******************************************************************************\n"
+"  */\n";
+
+static void quantBanner(FILE *f, const struct quant_names *names,
+        const char *suffix)
+{
+    char *banner = NULL;
+    if (asprintf(&banner, quant_tmpl_banner, suffix) < 0)
+        return;
+    quantTemplate(f, names, banner);
+    free(banner);
+}
+
+static const char *quant_tmpl_api =
+"#define AI_@NAME@_N_NODES (%d)\n"
+"\n"
+"AI_API_DECLARE_BEGIN\n"
+"\n"
+"/*!\n"
+" * @defgroup @name@\n"
+" * @brief Public neural network APIs\n"
+" * @details This is the header for the network public APIs declarations\n"
+" * for interfacing a generated network model.\n"
+" * @details The public neural network APIs hide the structure of the network\n"
+" * and offer a set of interfaces to create, initialize, query, configure, \n"
+" * run and destroy a network instance.\n"
+" * To handle this, an opaque handler to the network context is provided \n"
+" * on creation.\n"
+" * The APIs are meant as stadard interfaces for the calling code; depending on\n"
+" * the supported platforms and the models, different implementations could be\n"
+" * available.\n"
+" */\n"
+"\n"
+"/******************************************************************************/\n"
+"/*! Public API Functions Declarations */\n"
+"\n"
+"/*!\n"
+" * @brief Get network library info as a datastruct.\n"
+" * @ingroup @name@\n"
+" * @param[out] report a pointer to the report struct where to\n"
+" * store network info. See @ref ai_network_report struct for details\n"
+" * @return a boolean reporting the exit status of the API\n"
+" */\n"
+"AI_API_ENTRY\n"
+"ai_bool ai_@name@_get_info(\n"
+"  ai_handle network, ai_network_report* report);\n"
+"\n"
+"/*!\n"
+" * @brief Get first network error code.\n"
+" * @ingroup @name@\n"
+" * @details Get an error code related to the 1st error generated during\n"
+" * network processing. The error code is structure containing an \n"
+" * error type indicating the type of error with an associated error code\n"
+" * Note: after this call the error code is internally reset to AI_ERROR_NONE\n"
+" * @param network an opaque handle to the network context\n"
+" * @return an error type/code pair indicating both the error type and code\n"
+" * see @ref ai_error for struct definition\n"
+" */\n"
+"AI_API_ENTRY\n"
+"ai_error ai_@name@_get_error(ai_handle network);\n"
+"\n"
+"/*!\n"
+" * @brief Create a neural network.\n"
+" * @ingroup @name@\n"
+" * @details Instantiate a network and returns an object to handle it;\n"
+" * @param network an opaque handle to the network context\n"
+" * @param network_config a pointer to the network configuration info coded as a \n"
+" * buffer\n"
+" * @return an error code reporting the status of the API on exit\n"
+" */\n"
+"AI_API_ENTRY\n"
+"ai_error ai_@name@_create(\n"
+"  ai_handle* network, const ai_buffer* network_config);\n"
+"\n"
+"/*!\n"
+" * @brief Destroy a neural network and frees the allocated memory.\n"
+" * @ingroup @name@\n"
+" * @details Destroys the network and frees its memory. The network handle is returned;\n"
+" * if the handle is not NULL, the unloading has not been successful.\n"
+" * @param network an opaque handle to the network context\n"
+" * @return an object handle : AI_HANDLE_NULL if network was destroyed\n"
+" * correctly. The same input network handle if destroy failed.\n"
+" */\n"
+"AI_API_ENTRY\n"
+"ai_handle ai_@name@_destroy(ai_handle network);\n"
+"\n"
+"/*!\n"
+" * @brief Initialize the data structures of the network.\n"
+" * @ingroup @name@\n"
+" * @details This API initialized the network after a successfull\n"
+" * @ref ai_@name@_create. Both the activations memory buffer \n"
+" * and params (i.e. weights) need to be provided by caller application\n"
+" * \n"
+" * @param network an opaque handle to the network context\n"
+" * @param params the parameters of the network (required). \n"
+" * see @ref ai_network_params struct for details\n"
+" * @return true if the network was correctly initialized, false otherwise\n"
+" * in case of error the error type could be queried by \n"
+" * using @ref ai_@name@_get_error\n"
+" */\n"
+"AI_API_ENTRY\n"
+"ai_bool ai_@name@_init(\n"
+"  ai_handle network, const ai_network_params* params);\n"
+"\n"
+"\n"
+"/*!\n"
+" * @brief Run the network and return the output\n"
+" * @ingroup @name@\n"
+" *\n"
+" * @details Runs the network on the inputs and returns the corresponding output.\n"
+" * The size of the input and output buffers is stored in this\n"
+" * header generated by the code generation tool. See AI_@NAME@_*\n"
+" * defines into file @ref @name@.h for all network sizes defines\n"
+" *\n"
+" * @param network an opaque handle to the network context\n"
+" * @param[in] input buffer with the input data\n"
+" * @param[out] output buffer with the output data\n"
+" * @return the number of input batches processed (default 1) or <= 0 if it fails\n"
+" * in case of error the error type could be queried by \n"
+" * using @ref ai_@name@_get_error\n"
+" */\n"
+"AI_API_ENTRY\n"
+"ai_i32 ai_@name@_run(\n"
+"  ai_handle network, const ai_buffer* input, ai_buffer* output);\n"
+"\n"
+"/*!\n"
+" * @brief Runs the network on the inputs.\n"
+" * @ingroup @name@\n"
+" *\n"
+" * @details Differently from @ref ai_@name@_run, no output is returned, e.g. for\n"
+" * temporal models with a fixed step size.\n"
+" *\n"
+" * @param network the network to be run\n"
+" * @param[in] input buffer with the input data\n"
+" * @return the number of input batches processed (usually 1) or <= 0 if it fails\n"
+" * in case of error the error type could be queried by \n"
+" * using @ref ai_@name@_get_error\n"
+" */\n"
+"AI_API_ENTRY\n"
+"ai_i32 ai_@name@_forward(\n"
+"  ai_handle network, const ai_buffer* input);\n"
+"\n"
+"AI_API_DECLARE_END\n"
+"\n"
+"#endif /*__AI_@NAME@_H__*/\n";
+
+static void quantEmitIo(FILE *f, const struct quant_names *names,
+        const char *dir, const ai_tensor *t, bool f32)
+{
+    const int h = AI_SHAPE_H(&t->shape);
+    const int w = AI_SHAPE_W(&t->shape);
+    const int ch = AI_SHAPE_CH(&t->shape);
+    const char *fmt = (f32) ? "AI_BUFFER_FORMAT_FLOAT" : "AI_BUFFER_FORMAT_S8";
+
+    fprintf(f, "#define AI_%s_%s_NUM       (1)\n", names->upper, dir);
+    fprintf(f, "#define AI_%s_%s { \\\n", names->upper, dir);
+    fprintf(f, "  AI_BUFFER_OBJ_INIT(%s, %d, %d, %d, 1, NULL), \\\n",
+            fmt, h, w, ch);
+    fprintf(f, "}\n");
+    fprintf(f, "#define AI_%s_%s_SIZE { \\\n", names->upper, dir);
+    fprintf(f, "  (%d * %d * %d), \\\n", h, w, ch);
+    fprintf(f, "}\n");
+    fprintf(f, "#define AI_%s_%s_1_SIZE  (%d * %d * %d)\n", names->upper, dir,
+            h, w, ch);
+    fprintf(f, "#define AI_%s_%s_1_SIZE_BYTES  ((%d * %d * %d) * %d)\n",
+            names->upper, dir, h, w, ch, (f32) ? 4 : 1);
+}
+
+static int quantEmitHeader(FILE *f, const struct quant_ctx *ctx,
+        const struct quant_names *names)
+{
+    quantBanner(f, names, ".h");
+    quantTemplate(f, names,
+            "\n"
+            "#ifndef __AI_@NAME@_H__\n"
+            "#define __AI_@NAME@_H__\n"
+            "#pragma once\n"
+            "\n"
+            "#include \"ai_platform.h\"\n"
+            "#include \"ai_platform_interface.h\"\n"
+            "\n"
+            "#define AI_@NAME@_MODEL_NAME          \"@name@\"\n"
+            "\n");
+    quantEmitIo(f, names, "IN", ctx->tensors[0], quantIsFloat(ctx));
+    fprintf(f, "\n\n\n\n");
+    quantEmitIo(f, names, "OUT", ctx->tensors[ctx->n_nodes], quantIsFloat(ctx));
+    fprintf(f, "\n");
+
+    char *api = NULL;
+    if (asprintf(&api, quant_tmpl_api, ctx->n_nodes) < 0)
+        return -1;
+    quantTemplate(f, names, api);
+    free(api);
+    return 0;
+}
+
+static int quantEmitDataHeader(FILE *f, const struct quant_ctx *ctx,
+        const struct quant_names *names)
+{
+    quantBanner(f, names, "_data.h");
+    quantTemplate(f, names,
+            "\n"
+            "#ifndef __@NAME@_DATA_H_\n"
+            "#define __@NAME@_DATA_H_\n"
+            "#pragma once\n"
+            "\n"
+            "#include \"ai_platform.h\"\n"
+            "\n"
+            "#define AI_@NAME@_DATA_CONFIG           AI_HANDLE_NULL\n"
+            "\n"
+            "/* number of samples processed by each layer call: the activations plan is\n"
+            " * replicated for each of them (offsets and sizes scaled by the batch) */\n"
+            "#ifndef AI_@NAME@_N_BATCHES\n"
+            "#define AI_@NAME@_N_BATCHES                 (1)\n"
+            "#endif\n"
+            "\n");
+    fprintf(f, "#define AI_%s_DATA_ACTIVATIONS_BATCH_SIZE  (%u)\n",
+            names->upper, (unsigned)ctx->act_size);
+    quantTemplate(f, names,
+            "\n"
+            "#define AI_@NAME@_DATA_ACTIVATIONS_SIZE \\\n"
+            "  (AI_@NAME@_DATA_ACTIVATIONS_BATCH_SIZE * AI_@NAME@_N_BATCHES)\n"
+            "\n");
+    fprintf(f, "#define AI_%s_DATA_WEIGHTS_SIZE         (%u)\n",
+            names->upper, (unsigned)ctx->blob_size);
+    quantTemplate(f, names,
+            "\n"
+            "#define AI_@NAME@_DATA_ACTIVATIONS(ptr_)  \\\n"
+            "  AI_BUFFER_OBJ_INIT( \\\n"
+            "    AI_BUFFER_FORMAT_U8, \\\n"
+            "    1, 1, AI_@NAME@_DATA_ACTIVATIONS_SIZE, 1, \\\n"
+            "    AI_HANDLE_PTR(ptr_) )\n"
+            "\n"
+            "#define AI_@NAME@_DATA_WEIGHTS(ptr_)  \\\n"
+            "  AI_BUFFER_OBJ_INIT( \\\n"
+            "    AI_BUFFER_FORMAT_U8|AI_BUFFER_FMT_FLAG_CONST, \\\n"
+            "    1, 1, AI_@NAME@_DATA_WEIGHTS_SIZE, 1, \\\n"
+            "    AI_HANDLE_PTR(ptr_) )\n"
+            "\n"
+            "\n"
+            "AI_API_DECLARE_BEGIN\n"
+            "\n"
+            "/*!\n"
+            " * @brief Get network weights array pointer as a handle ptr.\n"
+            " * @ingroup @name@_data\n"
+            " * @return a ai_handle pointer to the weights array\n"
+            " */\n"
+            "AI_API_ENTRY\n"
+            "ai_handle ai_@name@_data_weights_get(void);\n"
+            "\n"
+            "\n"
+            "AI_API_DECLARE_END\n"
+            "\n"
+            "#endif /* __@NAME@_DATA_H_ */\n"
+            "\n");
+    return 0;
+}
+
+static int quantEmitData(FILE *f, const struct quant_ctx *ctx,
+        const struct quant_names *names)
+{
+    quantTemplate(f, names,
+            "#include \"@name@_data.h\"\n"
+            "\n"
+            "ai_handle ai_@name@_data_weights_get(void)\n"
+            "{\n"
+            "\n"
+            "  AI_ALIGNED(4)\n");
+    fprintf(f, "  static const ai_u8 s_%s_weights[ %u ] = {",
+            names->name, (unsigned)AI_MAX(ctx->blob_size, 1));
+    for (size_t i = 0; i < AI_MAX(ctx->blob_size, 1); i++) {
+        if ((i % 12) == 0)
+            fprintf(f, "\n    ");
+        fprintf(f, "0x%02x%s", (ctx->blob_size) ? ctx->blob[i] : 0,
+                (i + 1 < AI_MAX(ctx->blob_size, 1)) ? ", " : "");
+    }
+    fprintf(f, "\n  };\n\n");
+    fprintf(f, "  return AI_HANDLE_PTR(s_%s_weights);\n\n}\n\n", names->name);
+    return 0;
+}
+
+static void quantEmitFloats(FILE *f, const float *v, int n)
+{
+    for (int i = 0; i < n; i++)
+        fprintf(f, "%s%.9gf", i ? ", " : "", v[i]);
+}
+
+static void quantEmitIntq(FILE *f, const char *tname, const float *scales,
+        const int *zps, int n)
+{
+    fprintf(f, "AI_INTQ_INFO_LIST_OBJ_DECLARE(%s_intq, AI_STATIC_CONST,\n", tname);
+    fprintf(f, "  AI_BUFFER_META_FLAG_SCALE_FLOAT|AI_BUFFER_META_FLAG_ZEROPOINT_S8, %d,\n", n);
+    fprintf(f, "  AI_PACK_INTQ_INFO(\n    AI_PACK_INTQ_SCALE(");
+    quantEmitFloats(f, scales, n);
+    fprintf(f, "),\n    AI_PACK_INTQ_ZP(");
+    for (int i = 0; i < n; i++)
+        fprintf(f, "%s%d", i ? ", " : "", zps ? zps[i] : 0);
+    fprintf(f, ")))\n\n");
+}
+
+/* contiguous strides of a tensor of elem_size bytes elements */
+static void quantEmitTensor(FILE *f, const char *tname, const ai_tensor *t,
+        int elem_size, bool intq)
+{
+    int dims[4] = {
+        AI_SHAPE_IN_CH(&t->shape), AI_SHAPE_CH(&t->shape),
+        AI_SHAPE_W(&t->shape), AI_SHAPE_H(&t->shape) };
+    int strides[4];
+
+    strides[0] = elem_size;
+    for (int i = 1; i < 4; i++)
+        strides[i] = strides[i - 1] * dims[i - 1];
+
+    fprintf(f, "AI_TENSOR_OBJ_DECLARE(\n");
+    fprintf(f, "  %s, AI_STATIC,\n", tname);
+    fprintf(f, "  0x0, 0x0,\n");
+    fprintf(f, "  AI_SHAPE_INIT(4, %d, %d, %d, %d), AI_STRIDE_INIT(4, %d, %d, %d, %d),\n",
+            dims[0], dims[1], dims[2], dims[3],
+            strides[0], strides[1], strides[2], strides[3]);
+    if (intq)
+        fprintf(f, "  1, &%s_array, &%s_intq)\n\n", tname, tname);
+    else
+        fprintf(f, "  1, &%s_array, NULL)\n\n", tname);
+}
+
+/* name of the tensor acts[k]: the network input or the output of c-node k-1 */
+static void quantActName(char *buf, size_t len, int k)
+{
+    if (k == 0)
+        snprintf(buf, len, "input_0_output");
+    else
+        snprintf(buf, len, "dense_%d_output", k - 1);
+}
+
+static int quantEmitSource(FILE *f, const struct quant_ctx *ctx,
+        const struct quant_names *names, const struct quant_config *cfg)
+{
+    const int n = ctx->n_nodes;
+    const bool flt = quantIsFloat(ctx);
+    const char *act_fmt = (flt) ? "AI_ARRAY_FORMAT_FLOAT" : "AI_ARRAY_FORMAT_S8";
+    char tname[64];
+    int i_arr = 0, i_ten = 0;
+
+    quantBanner(f, names, ".c");
+    quantTemplate(f, names,
+            "\n"
+            "\n"
+            "#include \"@name@.h\"\n"
+            "#include \"@name@_data.h\"\n"
+            "\n"
+            "#include \"ai_platform_interface.h\"\n"
+            "#include \"ai_math_helpers.h\"\n"
+            "\n"
+            "#include \"core_common.h\"\n"
+            "#include \"layers.h\"\n"
+            "\n"
+            "#undef AI_TOOLS_VERSION_MAJOR\n"
+            "#undef AI_TOOLS_VERSION_MINOR\n"
+            "#undef AI_TOOLS_VERSION_MICRO\n"
+            "#define AI_TOOLS_VERSION_MAJOR 5\n"
+            "#define AI_TOOLS_VERSION_MINOR 1\n"
+            "#define AI_TOOLS_VERSION_MICRO 1\n"
+            "\n"
+            "\n"
+            "#undef AI_TOOLS_API_VERSION_MAJOR\n"
+            "#undef AI_TOOLS_API_VERSION_MINOR\n"
+            "#undef AI_TOOLS_API_VERSION_MICRO\n"
+            "#define AI_TOOLS_API_VERSION_MAJOR 1\n"
+            "#define AI_TOOLS_API_VERSION_MINOR 3\n"
+            "#define AI_TOOLS_API_VERSION_MICRO 0\n"
+            "\n"
+            "#undef AI_NET_OBJ_INSTANCE\n"
+            "#define AI_NET_OBJ_INSTANCE g_@name@\n"
+            " \n"
+            "#undef AI_@NAME@_MODEL_SIGNATURE\n");
+    fprintf(f, "#define AI_%s_MODEL_SIGNATURE     \"%s\"\n", names->upper,
+            names->signature);
+    quantTemplate(f, names,
+            "\n"
+            "#ifndef AI_TOOLS_REVISION_ID\n"
+            "#define AI_TOOLS_REVISION_ID     \"(rev-5.1.1)\"\n"
+            "#endif\n"
+            "\n"
+            "#undef AI_TOOLS_DATE_TIME\n"
+            "#define AI_TOOLS_DATE_TIME   \"@date@\"\n"
+            "\n"
+            "#undef AI_TOOLS_COMPILE_TIME\n"
+            "#define AI_TOOLS_COMPILE_TIME    __DATE__ \" \" __TIME__\n"
+            "\n"
+            "/**  Forward network declaration section  *************************************/\n"
+            "AI_STATIC ai_network AI_NET_OBJ_INSTANCE;\n"
+            "\n"
+            "\n"
+            "/**  Forward network array declarations  **************************************/\n");
+
+    for (int k = 0; k < n; k++) {
+        if (ctx->nodes[k].b)
+            fprintf(f, "AI_STATIC ai_array dense_%d_bias_array;   /* Array #%d */\n",
+                    k, i_arr++);
+        fprintf(f, "AI_STATIC ai_array dense_%d_weights_array;   /* Array #%d */\n",
+                k, i_arr++);
+    }
+    for (int k = 0; k <= n; k++) {
+        quantActName(tname, sizeof(tname), k);
+        fprintf(f, "AI_STATIC ai_array %s_array;   /* Array #%d */\n", tname, i_arr++);
+    }
+
+    fprintf(f, "\n\n/**  Forward network tensor declarations  *************************************/\n");
+    for (int k = 0; k < n; k++) {
+        if (ctx->nodes[k].b)
+            fprintf(f, "AI_STATIC ai_tensor dense_%d_bias;   /* Tensor #%d */\n",
+                    k, i_ten++);
+        fprintf(f, "AI_STATIC ai_tensor dense_%d_weights;   /* Tensor #%d */\n",
+                k, i_ten++);
+    }
+    for (int k = 0; k <= n; k++) {
+        quantActName(tname, sizeof(tname), k);
+        fprintf(f, "AI_STATIC ai_tensor %s;   /* Tensor #%d */\n", tname, i_ten++);
+    }
+
+    fprintf(f, "\n\n/**  Forward network tensor chain declarations  *******************************/\n");
+    for (int k = 0; k < n; k++)
+        fprintf(f, "AI_STATIC_CONST ai_tensor_chain dense_%d_chain;   /* Chain #%d */\n",
+                k, k);
+
+    fprintf(f, "\n\n/**  Forward network layer declarations  **************************************/\n");
+    for (int k = 0; k < n; k++)
+        fprintf(f, "AI_STATIC ai_layer_dense dense_%d_layer; /* Layer #%d */\n", k, k);
+
+    /* arrays */
+    fprintf(f, "\n\n/**  Array declarations section  **********************************************/\n");
+    i_arr = 0;
+    for (int k = 0; k < n; k++) {
+        const struct quant_node *qn = &ctx->nodes[k];
+        if (qn->b) {
+            fprintf(f, "/* Array#%d */\n", i_arr++);
+            fprintf(f, "AI_ARRAY_OBJ_DECLARE(\n  dense_%d_bias_array, %s,\n"
+                    "  NULL, NULL, %d, AI_STATIC)\n\n", k,
+                    (flt) ? "AI_ARRAY_FORMAT_FLOAT" : "AI_ARRAY_FORMAT_S32", qn->n_out);
+        }
+        /* the 4 bits rows are padded to a byte: the padding is counted */
+        fprintf(f, "/* Array#%d */\n", i_arr++);
+        if (ctx->sparse > 0.0f)
+            fprintf(f, "AI_ARRAY_OBJ_DECLARE(\n  dense_%d_weights_array, %s,\n"
+                    "  NULL, NULL, %u, AI_STATIC)\n\n", k,
+                    (qn->bsr) ? "AI_ARRAY_FORMAT_BSR_FLOAT" : "AI_ARRAY_FORMAT_FLOAT",
+                    (unsigned)((qn->bsr) ? qn->n_blocks * AI_DENSE_BSR_BLOCK
+                                         : (size_t)qn->n_out * qn->n_in));
+        else if (ctx->lut_bits)
+            fprintf(f, "AI_ARRAY_OBJ_DECLARE(\n  dense_%d_weights_array, %s,\n"
+                    "  NULL, NULL, %u, AI_STATIC)\n\n", k,
+                    (ctx->lut_bits == 8) ? "AI_ARRAY_FORMAT_LUT8_FLOAT"
+                                         : "AI_ARRAY_FORMAT_LUT4_FLOAT",
+                    (unsigned)(qn->w_idx_size * 8 / ctx->lut_bits));
+        else
+            fprintf(f, "AI_ARRAY_OBJ_DECLARE(\n  dense_%d_weights_array, %s,\n"
+                    "  NULL, NULL, %u, AI_STATIC)\n\n", k,
+                    (ctx->w_bits == 4) ? "AI_ARRAY_FORMAT_S4" : "AI_ARRAY_FORMAT_S8",
+                    (unsigned)(qn->n_out * quantRowSize(ctx, qn->n_in) * 8 / ctx->w_bits));
+    }
+    for (int k = 0; k <= n; k++) {
+        quantActName(tname, sizeof(tname), k);
+        fprintf(f, "/* Array#%d */\n", i_arr++);
+        fprintf(f, "AI_ARRAY_OBJ_DECLARE(\n  %s_array, %s%s,\n"
+                "  NULL, NULL, %u, AI_STATIC)\n\n", tname, act_fmt,
+                ((k == 0) || (k == n)) ? "|AI_FMT_FLAG_IS_IO" : "",
+                (unsigned)AI_TENSOR_SIZE(ctx->tensors[k]));
+    }
+
+    /* quantization parameters */
+    if (!flt) {
+        fprintf(f, "/**  Integer quantization info section  ***************************************/\n");
+        for (int k = 0; k < n; k++) {
+            const struct quant_node *qn = &ctx->nodes[k];
+            snprintf(tname, sizeof(tname), "dense_%d_weights", k);
+            quantEmitIntq(f, tname, qn->w_scale, NULL, qn->n_scales);
+        }
+        for (int k = 0; k <= n; k++) {
+            quantActName(tname, sizeof(tname), k);
+            quantEmitIntq(f, tname, &ctx->acts[k].scale, &ctx->acts[k].zp, 1);
+        }
+    }
+
+    /* tensors */
+    fprintf(f, "/**  Tensor declarations section  *********************************************/\n");
+    i_ten = 0;
+    for (int k = 0; k < n; k++) {
+        const struct quant_node *qn = &ctx->nodes[k];
+        if (qn->b) {
+            fprintf(f, "/* Tensor #%d */\n", i_ten++);
+            snprintf(tname, sizeof(tname), "dense_%d_bias", k);
+            quantEmitTensor(f, tname, qn->b, 4, false);
+        }
+        fprintf(f, "/* Tensor #%d */\n", i_ten++);
+        snprintf(tname, sizeof(tname), "dense_%d_weights", k);
+        quantEmitTensor(f, tname, qn->w, (ctx->sparse > 0.0f) ? 4 : 1, !flt);
+    }
+    for (int k = 0; k <= n; k++) {
+        fprintf(f, "/* Tensor #%d */\n", i_ten++);
+        quantActName(tname, sizeof(tname), k);
+        quantEmitTensor(f, tname, ctx->tensors[k], (flt) ? 4 : 1, !flt);
+    }
+
+    /* layers */
+    fprintf(f, "\n\n/**  Layer declarations section  **********************************************/\n\n");
+    for (int k = 0; k < n; k++) {
+        const struct quant_node *qn = &ctx->nodes[k];
+        char in_name[64], out_name[64];
+        quantActName(in_name, sizeof(in_name), k);
+        quantActName(out_name, sizeof(out_name), k + 1);
+        fprintf(f, "\nAI_TENSOR_CHAIN_OBJ_DECLARE(\n");
+        fprintf(f, "  dense_%d_chain, AI_STATIC_CONST, 4,\n", k);
+        fprintf(f, "  AI_TENSOR_LIST_OBJ_INIT(AI_FLAG_NONE, 1, &%s),\n", in_name);
+        fprintf(f, "  AI_TENSOR_LIST_OBJ_INIT(AI_FLAG_NONE, 1, &%s),\n", out_name);
+        if (qn->b)
+            fprintf(f, "  AI_TENSOR_LIST_OBJ_INIT(AI_FLAG_NONE, 2, &dense_%d_weights, &dense_%d_bias),\n",
+                    k, k);
+        else
+            fprintf(f, "  AI_TENSOR_LIST_OBJ_INIT(AI_FLAG_NONE, 1, &dense_%d_weights),\n", k);
+        fprintf(f, "  AI_TENSOR_LIST_OBJ_EMPTY\n)\n\n");
+        fprintf(f, "AI_LAYER_OBJ_DECLARE(\n");
+        fprintf(f, "  dense_%d_layer, %d,\n", k, qn->id);
+        fprintf(f, "  DENSE_TYPE,\n");
+        fprintf(f, "  dense, %s,\n", (flt) ? "forward_dense" : (cfg->per_channel)
+                ? "forward_dense_integer_SSSA_ch" : "forward_dense_integer_SSSA");
+        fprintf(f, "  &AI_NET_OBJ_INSTANCE, &dense_%d_layer, AI_STATIC,\n",
+                (k + 1 < n) ? k + 1 : k);
+        fprintf(f, "  .tensors = &dense_%d_chain, \n)\n", k);
+    }
+
+    char in_name[64], out_name[64];
+    quantActName(in_name, sizeof(in_name), 0);
+    quantActName(out_name, sizeof(out_name), n);
+    fprintf(f, "\n\nAI_NETWORK_OBJ_DECLARE(\n");
+    fprintf(f, "  AI_NET_OBJ_INSTANCE, AI_STATIC,\n");
+    fprintf(f, "  AI_BUFFER_OBJ_INIT(AI_BUFFER_FORMAT_U8,\n");
+    fprintf(f, "                     1, 1, %u, 1,\n", (unsigned)ctx->blob_size);
+    fprintf(f, "                     NULL),\n");
+    quantTemplate(f, names,
+            "  AI_BUFFER_OBJ_INIT(AI_BUFFER_FORMAT_U8,\n"
+            "                     1, 1, AI_@NAME@_DATA_ACTIVATIONS_BATCH_SIZE, AI_@NAME@_N_BATCHES,\n"
+            "                     NULL),\n");
+    fprintf(f, "  AI_TENSOR_LIST_IO_OBJ_INIT(AI_FLAG_NONE, AI_%s_IN_NUM, &%s),\n",
+            names->upper, in_name);
+    fprintf(f, "  AI_TENSOR_LIST_IO_OBJ_INIT(AI_FLAG_NONE, AI_%s_OUT_NUM, &%s),\n",
+            names->upper, out_name);
+    fprintf(f, "  &dense_0_layer, 0, NULL)\n\n\n\n");
+
+    /* activations */
+    quantTemplate(f, names,
+            "AI_DECLARE_STATIC\n"
+            "ai_bool @name@_configure_activations(\n"
+            "  ai_network* net_ctx, const ai_buffer* activation_buffer)\n"
+            "{\n"
+            "  AI_ASSERT(net_ctx &&  activation_buffer && activation_buffer->data)\n"
+            "\n"
+            "  ai_ptr activations = AI_PTR(AI_PTR_ALIGN(activation_buffer->data, 4));\n"
+            "  AI_ASSERT(activations)\n"
+            "  AI_UNUSED(net_ctx)\n"
+            "  AI_UNUSED(activations)\n"
+            "\n"
+            "  {\n"
+            "    /* Updating activations (byte) offsets */\n");
+    for (int k = 0; k <= n; k++) {
+        quantActName(tname, sizeof(tname), k);
+        if ((k == 0) || (k == n)) {
+            fprintf(f, "    AI_NETWORK_ARRAY(net_ctx, %s_array)->data = AI_PTR(NULL);\n", tname);
+            fprintf(f, "    AI_NETWORK_ARRAY(net_ctx, %s_array)->data_start = AI_PTR(NULL);\n", tname);
+        } else {
+            const unsigned off = (unsigned)ctx->nodes[k - 1].act_off;
+            fprintf(f, "    AI_NETWORK_ARRAY(net_ctx, %s_array)->data = "
+                    "AI_PTR(activations + %u*AI_%s_N_BATCHES);\n", tname, off, names->upper);
+            fprintf(f, "    AI_NETWORK_ARRAY(net_ctx, %s_array)->data_start = "
+                    "AI_PTR(activations + %u*AI_%s_N_BATCHES);\n", tname, off, names->upper);
+        }
+    }
+    fprintf(f, "    \n  }\n  return true;\n}\n\n\n\n");
+
+    /* weights */
+    quantTemplate(f, names,
+            "AI_DECLARE_STATIC\n"
+            "ai_bool @name@_configure_weights(\n"
+            "  ai_network* net_ctx, const ai_buffer* weights_buffer)\n"
+            "{\n"
+            "  AI_ASSERT(net_ctx &&  weights_buffer && weights_buffer->data)\n"
+            "\n"
+            "  ai_ptr weights = AI_PTR(weights_buffer->data);\n"
+            "  AI_ASSERT(weights)\n"
+            "  AI_UNUSED(net_ctx)\n"
+            "\n"
+            "  {\n"
+            "    /* Updating weights (byte) offsets */\n"
+            "    \n");
+    for (int k = 0; k < n; k++) {
+        const struct quant_node *qn = &ctx->nodes[k];
+        if (qn->b) {
+            snprintf(tname, sizeof(tname), "dense_%d_bias_array", k);
+            fprintf(f, "    AI_NETWORK_ARRAY(net_ctx, %s)->format |= AI_FMT_FLAG_CONST;\n", tname);
+            fprintf(f, "    AI_NETWORK_ARRAY(net_ctx, %s)->data = AI_PTR(weights + %u);\n",
+                    tname, (unsigned)qn->b_off);
+            fprintf(f, "    AI_NETWORK_ARRAY(net_ctx, %s)->data_start = AI_PTR(weights + %u);\n",
+                    tname, (unsigned)qn->b_off);
+        }
+        /* compressed weights: data_start is the table (the blocks index),
+         * data the indices (the blocks) */
+        snprintf(tname, sizeof(tname), "dense_%d_weights_array", k);
+        fprintf(f, "    AI_NETWORK_ARRAY(net_ctx, %s)->format |= AI_FMT_FLAG_CONST;\n", tname);
+        fprintf(f, "    AI_NETWORK_ARRAY(net_ctx, %s)->data = AI_PTR(weights + %u);\n",
+                tname, (unsigned)qn->w_off);
+        fprintf(f, "    AI_NETWORK_ARRAY(net_ctx, %s)->data_start = AI_PTR(weights + %u);\n",
+                tname, (unsigned)((flt) ? qn->lut_off : qn->w_off));
+    }
+    fprintf(f, "  }\n\n  return true;\n}\n\n\n");
+
+    /* public APIs */
+    quantTemplate(f, names,
+            "/**  PUBLIC APIs SECTION  *****************************************************/\n"
+            "\n"
+            "AI_API_ENTRY\n"
+            "ai_bool ai_@name@_get_info(\n"
+            "  ai_handle network, ai_network_report* report)\n"
+            "{\n"
+            "  ai_network* net_ctx = AI_NETWORK_ACQUIRE_CTX(network);\n"
+            "\n"
+            "  if ( report && net_ctx )\n"
+            "  {\n"
+            "    ai_network_report r = {\n"
+            "      .model_name        = AI_@NAME@_MODEL_NAME,\n"
+            "      .model_signature   = AI_@NAME@_MODEL_SIGNATURE,\n"
+            "      .model_datetime    = AI_TOOLS_DATE_TIME,\n"
+            "      \n"
+            "      .compile_datetime  = AI_TOOLS_COMPILE_TIME,\n"
+            "      \n"
+            "      .runtime_revision  = ai_platform_runtime_get_revision(),\n"
+            "      .runtime_version   = ai_platform_runtime_get_version(),\n"
+            "\n"
+            "      .tool_revision     = AI_TOOLS_REVISION_ID,\n"
+            "      .tool_version      = {AI_TOOLS_VERSION_MAJOR, AI_TOOLS_VERSION_MINOR,\n"
+            "                            AI_TOOLS_VERSION_MICRO, 0x0},\n"
+            "      .tool_api_version  = {AI_TOOLS_API_VERSION_MAJOR, AI_TOOLS_API_VERSION_MINOR,\n"
+            "                            AI_TOOLS_API_VERSION_MICRO, 0x0},\n"
+            "\n"
+            "      .api_version            = ai_platform_api_get_version(),\n"
+            "      .interface_api_version  = ai_platform_interface_api_get_version(),\n"
+            "      \n");
+    fprintf(f, "      .n_macc            = %u,\n", (unsigned)ctx->n_macc);
+    quantTemplate(f, names,
+            "      .n_inputs          = 0,\n"
+            "      .inputs            = NULL,\n"
+            "      .n_outputs         = 0,\n"
+            "      .outputs           = NULL,\n"
+            "      .activations       = AI_STRUCT_INIT,\n"
+            "      .params            = AI_STRUCT_INIT,\n"
+            "      .n_nodes           = 0,\n"
+            "      .signature         = 0x0,\n"
+            "    };\n"
+            "\n"
+            "    if ( !ai_platform_api_get_network_report(network, &r) ) return false;\n"
+            "\n"
+            "    *report = r;\n"
+            "    return true;\n"
+            "  }\n"
+            "\n"
+            "  return false;\n"
+            "}\n"
+            "\n"
+            "AI_API_ENTRY\n"
+            "ai_error ai_@name@_get_error(ai_handle network)\n"
+            "{\n"
+            "  return ai_platform_network_get_error(network);\n"
+            "}\n"
+            "\n"
+            "AI_API_ENTRY\n"
+            "ai_error ai_@name@_create(\n"
+            "  ai_handle* network, const ai_buffer* network_config)\n"
+            "{\n"
+            "  return ai_platform_network_create(\n"
+            "    network, network_config, \n"
+            "    &AI_NET_OBJ_INSTANCE,\n"
+            "    AI_TOOLS_API_VERSION_MAJOR, AI_TOOLS_API_VERSION_MINOR, AI_TOOLS_API_VERSION_MICRO);\n"
+            "}\n"
+            "\n"
+            "AI_API_ENTRY\n"
+            "ai_handle ai_@name@_destroy(ai_handle network)\n"
+            "{\n"
+            "  return ai_platform_network_destroy(network);\n"
+            "}\n"
+            "\n"
+            "AI_API_ENTRY\n"
+            "ai_bool ai_@name@_init(\n"
+            "  ai_handle network, const ai_network_params* params)\n"
+            "{\n"
+            "  ai_network* net_ctx = ai_platform_network_init(network, params);\n"
+            "  if ( !net_ctx ) return false;\n"
+            "\n"
+            "  ai_bool ok = true;\n"
+            "  ok &= @name@_configure_weights(net_ctx, &params->params);\n"
+            "  ok &= @name@_configure_activations(net_ctx, &params->activations);\n"
+            "\n"
+            "  ok &= ai_platform_network_post_init(network);\n"
+            "\n"
+            "  return ok;\n"
+            "}\n"
+            "\n"
+            "\n"
+            "AI_API_ENTRY\n"
+            "ai_i32 ai_@name@_run(\n"
+            "  ai_handle network, const ai_buffer* input, ai_buffer* output)\n"
+            "{\n"
+            "  return ai_platform_network_process(network, input, output);\n"
+            "}\n"
+            "\n"
+            "AI_API_ENTRY\n"
+            "ai_i32 ai_@name@_forward(ai_handle network, const ai_buffer* input)\n"
+            "{\n"
+            "  return ai_platform_network_process(network, input, NULL);\n"
+            "}\n"
+            "\n"
+            "\n"
+            "#undef AI_@NAME@_MODEL_SIGNATURE\n"
+            "#undef AI_NET_OBJ_INSTANCE\n"
+            "#undef AI_TOOLS_VERSION_MAJOR\n"
+            "#undef AI_TOOLS_VERSION_MINOR\n"
+            "#undef AI_TOOLS_VERSION_MICRO\n"
+            "#undef AI_TOOLS_API_VERSION_MAJOR\n"
+            "#undef AI_TOOLS_API_VERSION_MINOR\n"
+            "#undef AI_TOOLS_API_VERSION_MICRO\n"
+            "#undef AI_TOOLS_DATE_TIME\n"
+            "#undef AI_TOOLS_COMPILE_TIME\n"
+            "\n");
+    return 0;
+}
+
+/* two FNV-1a 64 bits hashes of the weights and of the quantization params */
+static void quantSignature(const struct quant_ctx *ctx, char *sig)
+{
+    uint64_t h[2] = { 0xcbf29ce484222325ULL, 0x84222325cbf29ce4ULL };
+
+    for (int j = 0; j < 2; j++) {
+        for (size_t i = 0; i < ctx->blob_size; i++)
+            h[j] = (h[j] ^ ctx->blob[i]) * 0x100000001b3ULL;
+        for (int k = 0; k <= ctx->n_nodes; k++) {
+            const uint8_t *p = (const uint8_t *)&ctx->acts[k].scale;
+            for (size_t i = 0; i < sizeof(float); i++)
+                h[j] = (h[j] ^ p[i]) * 0x100000001b3ULL;
+            h[j] = (h[j] ^ (uint8_t)ctx->acts[k].zp) * 0x100000001b3ULL;
+        }
+    }
+    snprintf(sig, 33, "%016llx%016llx", (unsigned long long)h[0],
+            (unsigned long long)h[1]);
+}
+
+typedef int (*quant_emit_fn)(FILE *f, const struct quant_ctx *ctx,
+        const struct quant_names *names);
+
+static int quantEmitFile(const char *dir, const char *suffix,
+        const struct quant_ctx *ctx, const struct quant_names *names,
+        quant_emit_fn emit)
+{
+    char path[512];
+    FILE *f;
+    int res;
+
+    snprintf(path, sizeof(path), "%s/%s%s", dir, names->name, suffix);
+    f = fopen(path, "w");
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+    res = emit(f, ctx, names);
+    if (fclose(f) || res) {
+        fprintf(stderr, "E: unable to write %s\n", path);
+        return -1;
+    }
+    printf("  %s\n", path);
+    return 0;
+}
+
+static int quantEmit(const struct quant_config *cfg, const struct quant_ctx *ctx)
+{
+    struct quant_names names = { .name = cfg->name };
+    const char *inc_dir = (cfg->inc_dir) ? cfg->inc_dir : cfg->dir;
+    const time_t now = time(NULL);
+    char path[512];
+    FILE *f;
+
+    for (size_t i = 0; cfg->name[i] && i < sizeof(names.upper) - 1; i++)
+        names.upper[i] = (char)toupper((unsigned char)cfg->name[i]);
+    strftime(names.date, sizeof(names.date), "%a %b %e %H:%M:%S %Y",
+            localtime(&now));
+    quantSignature(ctx, names.signature);
+
+    printf("Generating \"%s\"...\n", cfg->name);
+    if (quantEmitFile(inc_dir, ".h", ctx, &names, quantEmitHeader) ||
+            quantEmitFile(inc_dir, "_data.h", ctx, &names, quantEmitDataHeader) ||
+            quantEmitFile(cfg->dir, "_data.c", ctx, &names, quantEmitData))
+        return -1;
+
+    snprintf(path, sizeof(path), "%s/%s.c", cfg->dir, cfg->name);
+    f = fopen(path, "w");
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+    quantEmitSource(f, ctx, &names, cfg);
+    if (fclose(f)) {
+        fprintf(stderr, "E: unable to write %s\n", path);
+        return -1;
+    }
+    printf("  %s\n", path);
+    return 0;
+}
+
+/* -----------------------------------------------------------------------------
+ * Main
+ * -----------------------------------------------------------------------------
+ */
+
+/* weights decoded from the codebook, for the report */
+static float quantLutWeight(const struct quant_node *qn, int bits, int o, int i)
+{
+    if (bits == 8)
+        return qn->lut[qn->w_idx[o * qn->n_in + i]];
+    const uint8_t pair = qn->w_idx[o * AI_DENSE_LUT4_ROW_SIZE(qn->n_in) + (i >> 1)];
+    return qn->lut[(i & 1) ? (pair & 0xF) : (pair >> 4)];
+}
+
+static void quantPrintLut(const struct quant_ctx *ctx, const ai_network_report *report)
+{
+    size_t w_float = 0;
+
+    printf("Weights clustered on %d centroids (%d bits indices)\n",
+            1 << ctx->lut_bits, ctx->lut_bits);
+    for (int k = 0; k < ctx->n_nodes; k++) {
+        const struct quant_node *qn = &ctx->nodes[k];
+        const ai_float *w = AI_ARRAY_OBJ_DATA(qn->w->data, ai_float);
+        double err = 0.0, max_err = 0.0;
+        for (int o = 0; o < qn->n_out; o++) {
+            for (int i = 0; i < qn->n_in; i++) {
+                const double d = fabs(w[o * qn->n_in + i] -
+                        quantLutWeight(qn, ctx->lut_bits, o, i));
+                err += d * d;
+                max_err = AI_MAX(max_err, d);
+            }
+        }
+        printf(" dense_%d_weights      %dx%d, rms error %.5g, max error %.5g\n",
+                k, qn->n_out, qn->n_in,
+                sqrt(err / ((double)qn->n_out * qn->n_in)), max_err);
+        w_float += (size_t)qn->n_out * qn->n_in * sizeof(float) +
+                ((qn->b) ? qn->n_out * sizeof(float) : 0);
+    }
+    printf(" weights              %u bytes (float graph: %u bytes, model: %u bytes)\n",
+            (unsigned)ctx->blob_size, (unsigned)w_float,
+            (unsigned)AI_BUFFER_SIZE(&report->params));
+    printf(" activations          %u bytes per sample\n", (unsigned)ctx->act_size);
+}
+
+static void quantPrintSparse(const struct quant_ctx *ctx, const ai_network_report *report)
+{
+    size_t w_float = 0;
+
+    printf("Weights stored block sparse (%dx1 blocks) up to a density of %.3g\n",
+            AI_DENSE_BSR_BLOCK, ctx->sparse);
+    for (int k = 0; k < ctx->n_nodes; k++) {
+        const struct quant_node *qn = &ctx->nodes[k];
+        printf(" dense_%d_weights      %dx%d, block density %.3g, %s\n",
+                k, qn->n_out, qn->n_in, qn->density, (qn->bsr) ? "sparse" : "dense");
+        w_float += (size_t)qn->n_out * qn->n_in * sizeof(float) +
+                ((qn->b) ? qn->n_out * sizeof(float) : 0);
+    }
+    printf(" weights              %u bytes (float graph: %u bytes, model: %u bytes)\n",
+            (unsigned)ctx->blob_size, (unsigned)w_float,
+            (unsigned)AI_BUFFER_SIZE(&report->params));
+    printf(" activations          %u bytes per sample\n", (unsigned)ctx->act_size);
+}
+
+static void quantPrint(const struct quant_ctx *ctx, const ai_network_report *report)
+{
+    char tname[64];
+    size_t w_float = 0;
+
+    printf("Calibrated on %llu samples\n", (unsigned long long)ctx->n_samples);
+    printf(" %-20s %12s %12s %12s %5s\n", "tensor", "min", "max", "scale", "zero");
+    for (int k = 0; k <= ctx->n_nodes; k++) {
+        const struct quant_act *a = &ctx->acts[k];
+        quantActName(tname, sizeof(tname), k);
+        printf(" %-20s %12.5g %12.5g %12.5g %5d\n", tname, a->lo, a->hi,
+                a->scale, a->zp);
+    }
+    for (int k = 0; k < ctx->n_nodes; k++) {
+        const struct quant_node *qn = &ctx->nodes[k];
+        float s_min = qn->w_scale[0], s_max = qn->w_scale[0];
+        for (int i = 1; i < qn->n_scales; i++) {
+            s_min = AI_MIN(s_min, qn->w_scale[i]);
+            s_max = AI_MAX(s_max, qn->w_scale[i]);
+        }
+        printf(" dense_%d_weights      %dx%d int%d, %d scale(s) in [%.5g, %.5g]\n",
+                k, qn->n_out, qn->n_in, ctx->w_bits, qn->n_scales, s_min, s_max);
+        w_float += (size_t)qn->n_out * qn->n_in * sizeof(float) +
+                ((qn->b) ? qn->n_out * sizeof(float) : 0);
+    }
+    printf(" weights              %u bytes (float graph: %u bytes, model: %u bytes)\n",
+            (unsigned)ctx->blob_size, (unsigned)w_float,
+            (unsigned)AI_BUFFER_SIZE(&report->params));
+    printf(" activations          %u bytes per sample\n", (unsigned)ctx->act_size);
+}
+
+static void quantFree(struct quant_ctx *ctx)
+{
+    for (int k = 0; ctx->nodes && k < ctx->n_nodes; k++) {
+        free(ctx->nodes[k].w_scale);
+        free(ctx->nodes[k].w_q);
+        free(ctx->nodes[k].b_q);
+        free(ctx->nodes[k].lut);
+        free(ctx->nodes[k].w_idx);
+        free(ctx->nodes[k].bsr_index);
+        free(ctx->nodes[k].bsr_values);
+    }
+    free(ctx->nodes);
+    free(ctx->acts);
+    free(ctx->tensors);
+    free(ctx->blob);
+}
+
+static void quantUsage(const char *prog)
+{
+    printf("usage: %s -i calibration.txt [-m model] [-n name] [-o dir] [-H dir] [-t]\n"
+           "                [-w 8|4]\n", prog);
+    printf("       %s -l 8|4 [-m model] [-n name] [-o dir] [-H dir]\n", prog);
+    printf("       %s -s density [-m model] [-n name] [-o dir] [-H dir]\n", prog);
+    printf("  -i  representative float inputs (text, '-' for stdin)\n");
+    printf("  -m  embedded float model to quantize (default: the first one)\n");
+    printf("  -n  name of the generated model (default %s)\n", _QUANT_DEF_NAME_);
+    printf("  -o  output directory of the generated files (default .)\n");
+    printf("  -H  output directory of the generated headers (default: -o)\n");
+    printf("  -t  one weights scale per layer instead of per output channel\n");
+    printf("  -w  weights bits: 8 (default) or 4 (packed int4, default name %s)\n",
+            _QUANT_DEF_Q4_NAME_);
+    printf("  -l  float model with the weights compressed on 256 (8) or 16 (4)\n"
+           "      centroids instead of int8 (default name %s)\n", _QUANT_DEF_LUT_NAME_);
+    printf("  -s  float model with the weights of the layers of block density up to\n"
+           "      density (0..1] stored block sparse (default name %s)\n",
+           _QUANT_DEF_BSR_NAME_);
+}
+
+int main(int argc, char *argv[])
+{
+    struct quant_config cfg = {
+            .calib = NULL,
+            .model = NULL,
+            .name = NULL,
+            .dir = ".",
+            .inc_dir = NULL,
+            .per_channel = true,
+            .w_bits = 8,
+    };
+    struct quant_ctx ctx = { 0 };
+    ai_network_report report;
+    ai_handle handle = AI_HANDLE_NULL;
+    ai_handle net_hdl;
+    ai_network_params net_params;
+    ai_u8 *activations = NULL;
+    float *samples = NULL;
+    size_t n_values = 0;
+    const char *nn_name;
+    ai_error err;
+    int res = 1;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "i:m:n:o:H:tw:l:s:h")) != -1) {
+        switch (opt) {
+        case 'i': cfg.calib = optarg; break;
+        case 'm': cfg.model = optarg; break;
+        case 'n': cfg.name = optarg; break;
+        case 'o': cfg.dir = optarg; break;
+        case 'H': cfg.inc_dir = optarg; break;
+        case 't': cfg.per_channel = false; break;
+        case 'w': cfg.w_bits = atoi(optarg); break;
+        case 'l': cfg.lut_bits = atoi(optarg); break;
+        case 's': cfg.sparse = strtof(optarg, NULL); break;
+        default:
+            quantUsage(argv[0]);
+            return (opt == 'h') ? 0 : 1;
+        }
+    }
+    if ((!cfg.lut_bits && !cfg.sparse && !cfg.calib) ||
+            ((cfg.w_bits != 8) && (cfg.w_bits != 4)) ||
+            (cfg.lut_bits && (cfg.lut_bits != 8) && (cfg.lut_bits != 4)) ||
+            (cfg.sparse < 0.0f) || (cfg.sparse > 1.0f) ||
+            (cfg.sparse && cfg.lut_bits)) {
+        quantUsage(argv[0]);
+        return 1;
+    }
+    if (!cfg.name)
+        cfg.name = (cfg.lut_bits) ? _QUANT_DEF_LUT_NAME_ :
+                (cfg.sparse) ? _QUANT_DEF_BSR_NAME_ :
+                (cfg.w_bits == 4) ? _QUANT_DEF_Q4_NAME_ : _QUANT_DEF_NAME_;
+    ctx.w_bits = cfg.w_bits;
+    ctx.lut_bits = cfg.lut_bits;
+    ctx.sparse = cfg.sparse;
+
+    printf("# %s\n", _QUANT_NAME_);
+
+    /* ai_mnetwork_find() falls back on the first network if name is unknown */
+    nn_name = ai_mnetwork_find(cfg.model, 0);
+    if (!nn_name || (cfg.model && strcmp(nn_name, cfg.model))) {
+        fprintf(stderr, "E: no embedded network \"%s\"\n",
+                cfg.model ? cfg.model : "");
+        return 1;
+    }
+
+    err = ai_mnetwork_create(nn_name, &handle, NULL);
+    if (err.type) {
+        fprintf(stderr, "E: AI error (ai_mnetwork_create) - type=%d code=%d\n",
+                err.type, err.code);
+        return 1;
+    }
+
+    activations = malloc(AI_MNETWORK_DATA_ACTIVATIONS_INT_SIZE + 4);
+    ai_network_params params = {
+            AI_BUFFER_OBJ_INIT(AI_BUFFER_FORMAT_NONE|AI_BUFFER_FMT_FLAG_CONST,
+                    0, 0, 0, 0, NULL),
+            AI_BUFFER_OBJ_INIT(AI_BUFFER_FORMAT_NONE|AI_BUFFER_FMT_FLAG_CONST,
+                    0, 0, 0, 0, AI_HANDLE_PTR(activations)) };
+
+    if (!activations || !ai_mnetwork_init(handle, &params) ||
+            !ai_mnetwork_get_info(handle, &report)) {
+        err = ai_mnetwork_get_error(handle);
+        fprintf(stderr, "E: AI error (ai_mnetwork_init) - type=%d code=%d\n",
+                err.type, err.code);
+        goto done;
+    }
+    printf("%s \"%s\" (%u c-nodes, %u MACC)\n",
+            (cfg.lut_bits || cfg.sparse) ? "Compressing" : "Quantizing", nn_name,
+            (unsigned)report.n_nodes, (unsigned)report.n_macc);
+
+    if ((report.n_inputs != 1) || (report.n_outputs != 1) ||
+            (AI_BUFFER_FMT_GET_TYPE(report.inputs[0].format) != AI_BUFFER_FMT_TYPE_FLOAT)) {
+        fprintf(stderr, "E: a float model with a single input/output is expected\n");
+        goto done;
+    }
+
+    ai_mnetwork_get_private_handle(handle, &net_hdl, &net_params);
+    if (quantGraphInit(&ctx, AI_NETWORK_ACQUIRE_CTX(net_hdl)))
+        goto done;
+
+    /* codebook compression: the weights only, no calibration */
+    if (cfg.lut_bits) {
+        if (quantGraphLut(&ctx)) {
+            fprintf(stderr, "E: compression failed\n");
+            goto done;
+        }
+        quantPrintLut(&ctx, &report);
+        res = quantEmit(&cfg, &ctx) ? 1 : 0;
+        goto done;
+    }
+
+    /* block sparse storage: the weights only, no calibration */
+    if (cfg.sparse) {
+        if (quantGraphSparse(&ctx)) {
+            fprintf(stderr, "E: compression failed\n");
+            goto done;
+        }
+        quantPrintSparse(&ctx, &report);
+        res = quantEmit(&cfg, &ctx) ? 1 : 0;
+        goto done;
+    }
+
+    samples = quantReadSamples(cfg.calib, &n_values);
+    if (!samples || (n_values < AI_BUFFER_SIZE(&report.inputs[0])) ||
+            (n_values % AI_BUFFER_SIZE(&report.inputs[0]))) {
+        fprintf(stderr, "E: %s: %u values, a multiple of %u is expected\n",
+                cfg.calib, (unsigned)n_values,
+                (unsigned)AI_BUFFER_SIZE(&report.inputs[0]));
+        goto done;
+    }
+
+    if (!ai_platform_observer_register(net_hdl, quantObserverCb,
+            (ai_handle)&ctx, AI_OBSERVER_PRE_EVT | AI_OBSERVER_POST_EVT)) {
+        fprintf(stderr, "E: unable to register the observer\n");
+        goto done;
+    }
+    res = quantCalibrate(&ctx, handle, &report, samples, n_values);
+    ai_platform_observer_unregister(net_hdl, quantObserverCb, (ai_handle)&ctx);
+    if (res) {
+        res = 1;
+        goto done;
+    }
+
+    res = 1;
+    if (quantGraph(&ctx, cfg.per_channel)) {
+        fprintf(stderr, "E: quantization failed\n");
+        goto done;
+    }
+    quantPrint(&ctx, &report);
+
+    res = quantEmit(&cfg, &ctx) ? 1 : 0;
+
+done:
+    quantFree(&ctx);
+    free(samples);
+    ai_mnetwork_destroy(handle);
+    free(activations);
+    return res;
+}
@@ -0,0 +1,208 @@
+/**
+  ******************************************************************************
+  * @file    aiWeights.c
+  * @brief   Weights blob packer of an embedded network
+  ******************************************************************************
+  * @attention
+  *
+  * Packs the weights of an embedded network in a blob file which can be
+  * swapped at run time without rebuild (see ai_mnetwork_weights_publish): a
+  * header holding the model signature, the size and the checksum of the
+  * weights, followed by the raw weights (layout of the generated
+  * <model>_data.c array).
+  *
+  * usage: aiWeights -o blob.aiw [-m model] [-i weights.bin]
+  *        aiWeights -c blob.aiw [-m model]
+  *
+  * Without -i the compiled-in weights are packed. With -c a blob is checked
+  * against the network and published to an instance of it.
+  *
+  ******************************************************************************
+  */
+
+/* System headers */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+/* AI header files */
+#include "app_x-cube-ai.h"
+
+#define _WEIGHTS_NAME_          "AI weights blob packer (host)"
+
+struct weights_config {
+    const char *model;      /* NULL: first embedded network */
+    const char *input;      /* NULL: compiled-in weights */
+    const char *output;
+    const char *check;
+};
+
+static ai_u8 *weightsRead(const char *path, size_t size)
+{
+    ai_u8 *data = NULL;
+    FILE *f = fopen(path, "rb");
+    long len;
+
+    if (!f) {
+        fprintf(stderr, "E: unable to open %s\n", path);
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    if (len != (long)size) {
+        fprintf(stderr, "E: %s: %ld bytes, %u expected\n", path, len,
+                (unsigned)size);
+        fclose(f);
+        return NULL;
+    }
+    data = malloc(size);
+    if (data && (fread(data, 1, size, f) != size)) {
+        fprintf(stderr, "E: unable to read %s\n", path);
+        free(data);
+        data = NULL;
+    }
+    fclose(f);
+    return data;
+}
+
+static int weightsWrite(const char *path, const ai_network_report *report,
+        const ai_u8 *weights, size_t size)
+{
+    ai_u8 header[AI_MNETWORK_WEIGHTS_ALIGN] = { 0 };
+    FILE *f;
+    int res = 0;
+
+    if (!ai_mnetwork_weights_header_init((ai_mnetwork_weights_header *)header,
+            report->model_signature, AI_HANDLE_PTR(weights), (ai_u32)size)) {
+        fprintf(stderr, "E: invalid model signature\n");
+        return 1;
+    }
+
+    f = fopen(path, "wb");
+    if (!f) {
+        fprintf(stderr, "E: unable to create %s\n", path);
+        return 1;
+    }
+    if ((fwrite(header, 1, sizeof(header), f) != sizeof(header)) ||
+            (fwrite(weights, 1, size, f) != size))
+        res = 1;
+    if (fclose(f) || res) {
+        fprintf(stderr, "E: unable to write %s\n", path);
+        return 1;
+    }
+
+    printf("Written %s: signature %s, %u bytes of weights, checksum 0x%08x\n",
+            path, report->model_signature, (unsigned)size,
+            (unsigned)((ai_mnetwork_weights_header *)header)->checksum);
+    return 0;
+}
+
+static void weightsUsage(const char *prog)
+{
+    printf("usage: %s -o blob.aiw [-m model] [-i weights.bin]\n", prog);
+    printf("       %s -c blob.aiw [-m model]\n", prog);
+    printf("  -o  output blob file\n");
+    printf("  -m  embedded model (default: the first one)\n");
+    printf("  -i  raw weights to pack (default: the compiled-in weights)\n");
+    printf("  -c  blob file to check against the model\n");
+}
+
+int main(int argc, char *argv[])
+{
+    struct weights_config cfg = { 0 };
+    ai_network_report report;
+    ai_handle handle = AI_HANDLE_NULL;
+    ai_u8 *activations = NULL;
+    ai_u8 *weights = NULL;
+    const char *nn_name;
+    size_t size;
+    ai_error err;
+    int res = 1;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "o:m:i:c:h")) != -1) {
+        switch (opt) {
+        case 'o': cfg.output = optarg; break;
+        case 'm': cfg.model = optarg; break;
+        case 'i': cfg.input = optarg; break;
+        case 'c': cfg.check = optarg; break;
+        default:
+            weightsUsage(argv[0]);
+            return (opt == 'h') ? 0 : 1;
+        }
+    }
+    if (!cfg.output == !cfg.check) {
+        weightsUsage(argv[0]);
+        return 1;
+    }
+
+    printf("# %s\n", _WEIGHTS_NAME_);
+
+    /* by name (-1: no fallback on an index), else the first network */
+    nn_name = ai_mnetwork_find(cfg.model, cfg.model ? -1 : 0);
+    if (!nn_name) {
+        fprintf(stderr, "E: no embedded network \"%s\"\n",
+                cfg.model ? cfg.model : "");
+        return 1;
+    }
+
+    err = ai_mnetwork_create(nn_name, &handle, NULL);
+    if (err.type) {
+        fprintf(stderr, "E: AI error (ai_mnetwork_create) - type=%d code=%d\n",
+                err.type, err.code);
+        return 1;
+    }
+
+    activations = malloc(AI_MNETWORK_DATA_ACTIVATIONS_INT_SIZE + 4);
+    ai_network_params params = {
+            AI_BUFFER_OBJ_INIT(AI_BUFFER_FORMAT_NONE|AI_BUFFER_FMT_FLAG_CONST,
+                    0, 0, 0, 0, NULL),
+            AI_BUFFER_OBJ_INIT(AI_BUFFER_FORMAT_NONE|AI_BUFFER_FMT_FLAG_CONST,
+                    0, 0, 0, 0, AI_HANDLE_PTR(activations)) };
+
+    if (!activations || !ai_mnetwork_init(handle, &params) ||
+            !ai_mnetwork_get_info(handle, &report)) {
+        err = ai_mnetwork_get_error(handle);
+        fprintf(stderr, "E: AI error (ai_mnetwork_init) - type=%d code=%d\n",
+                err.type, err.code);
+        goto done;
+    }
+
+    size = AI_BUFFER_SIZE(&report.params);
+    if (!size) {
+        fprintf(stderr, "E: \"%s\" has no weights\n", nn_name);
+        goto done;
+    }
+
+    if (cfg.check) {
+        if (!ai_mnetwork_weights_load(handle, cfg.check)) {
+            fprintf(stderr, "E: %s is not a weights blob of \"%s\" (%s)\n",
+                    cfg.check, nn_name, report.model_signature);
+            goto done;
+        }
+        printf("%s: valid weights blob of \"%s\" (%s)\n", cfg.check, nn_name,
+                report.model_signature);
+        res = 0;
+        goto done;
+    }
+
+    if (cfg.input) {
+        weights = weightsRead(cfg.input, size);
+        if (!weights)
+            goto done;
+        res = weightsWrite(cfg.output, &report, weights, size);
+    }
+    else
+        res = weightsWrite(cfg.output, &report,
+                (const ai_u8 *)report.params.data, size);
+
+done:
+    free(weights);
+    ai_mnetwork_destroy(handle);
+    free(activations);
+    return res;
+}
@@ -0,0 +1,121 @@
+/**
+  ******************************************************************************
+  * @file    aiProfiler.h
+  * @brief   Per c-node profiler built on the runtime observer API
+  ******************************************************************************
+  * @attention
+  *
+  * The profiler registers a PRE/POST observer callback on a network instance
+  * and accumulates, for each c-node, the hardware counters read around its
+  * execution:
+  *  - host (Linux): perf_event group (cycles, instructions, cache misses,
+  *    branch misses), user space only
+  *  - Cortex-M7: DWT cycle counter and the CPI/EXC/SLEEP/LSU/FOLD event
+  *    counters (instructions are estimated, misses are not available)
+  * The read cost of the counters is calibrated once and removed from the
+  * per c-node values. Each execution can also be recorded as an event and
+  * exported as a Chrome trace (chrome://tracing, ui.perfetto.dev).
+  *
+  ******************************************************************************
+  */
+
+#ifndef __AI_PROFILER_H__
+#define __AI_PROFILER_H__
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "ai_platform.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define AI_PROF_HIST_BINS       (32)   /* log2(cycles) buckets */
+
+enum {
+    AI_PROF_CYCLES = 0,
+    AI_PROF_INSTRUCTIONS,
+    AI_PROF_CACHE_MISSES,
+    AI_PROF_BRANCH_MISSES,
+    AI_PROF_N_COUNTERS
+};
+
+/* counters of one c-node (or one execution of a c-node) */
+struct profiler_counters {
+    uint64_t v[AI_PROF_N_COUNTERS];
+};
+
+struct profiler_node {
+    uint16_t c_idx;
+    uint16_t type;
+    uint16_t id;
+    uint32_t n_runs;
+    uint64_t ns;                        /* cumulated duration */
+    struct profiler_counters sum;       /* cumulated counters */
+    uint64_t min_cycles;
+    uint64_t max_cycles;
+    uint32_t hist[AI_PROF_HIST_BINS];   /* hist[i]: cycles in [2^i, 2^(i+1)) */
+};
+
+/* one c-node execution, for the trace export */
+struct profiler_event {
+    uint16_t c_idx;
+    uint64_t ts;                        /* ns, relative to the profiler init */
+    uint64_t dur;                       /* ns */
+    struct profiler_counters counters;
+};
+
+struct profiler_ctx {
+    ai_handle network;                  /* runtime (private) handle */
+    uint32_t available;                 /* mask of the available counters */
+    int n_nodes;
+    struct profiler_node *nodes;
+    int max_events;
+    int n_events;
+    uint32_t n_dropped;                 /* executions not recorded as event */
+    struct profiler_event *events;
+    struct profiler_counters overhead;  /* read cost of the counters */
+    uint64_t t0;
+    uint64_t pre_ns;
+    struct profiler_counters pre;
+    int fds[AI_PROF_N_COUNTERS];        /* host: perf_event descriptors */
+};
+
+/*!
+ * @brief register the profiler on a network instance
+ * @param prof the profiler context
+ * @param network the runtime handle (see ai_mnetwork_get_private_handle)
+ * @param n_nodes number of c-nodes (report.n_nodes)
+ * @param max_events max number of recorded executions, 0 to disable the trace
+ * @return 0 on success
+ */
+int aiProfilerInit(struct profiler_ctx *prof, ai_handle network, int n_nodes,
+        int max_events);
+
+/*!
+ * @brief unregister the profiler and release its resources
+ */
+void aiProfilerDeInit(struct profiler_ctx *prof);
+
+/*!
+ * @brief clear the accumulated statistics and the recorded events
+ */
+void aiProfilerReset(struct profiler_ctx *prof);
+
+/*!
+ * @brief print the per c-node table (average counters, cycles histogram)
+ */
+void aiProfilerPrint(const struct profiler_ctx *prof, FILE *f);
+
+/*!
+ * @brief export the recorded events as a Chrome trace JSON document
+ * @return 0 on success
+ */
+int aiProfilerWriteTrace(const struct profiler_ctx *prof, const char *path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __AI_PROFILER_H__ */
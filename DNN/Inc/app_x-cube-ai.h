@@ -55,11 +55,23 @@
 #include "ai_platform.h"
 #include "network.h"
 #include "network_data.h"
+/* int8 version of the model generated by the host aiQuantize tool */
+#if defined(AI_MNETWORK_WITH_NETWORK_Q)
+#include "network_q.h"
+#include "network_q_data.h"
+#endif
+
+#define AI_MNETWORK_SIZE_MAX(a_, b_)  (((a_) > (b_)) ? (a_) : (b_))
 
 #define MIN_HEAP_SIZE 0x200
 #define MIN_STACK_SIZE 0x800
 
+#if defined(AI_MNETWORK_WITH_NETWORK_Q)
+#define AI_MNETWORK_IN_1_SIZE_BYTES \
+  AI_MNETWORK_SIZE_MAX(AI_NETWORK_IN_1_SIZE_BYTES, AI_NETWORK_Q_IN_1_SIZE_BYTES)
+#else
 #define AI_MNETWORK_IN_1_SIZE_BYTES AI_NETWORK_IN_1_SIZE_BYTES
+#endif
 #define AI_MNETWORK_IN_NUM 1
 #define DEF_DATA_IN \
   AI_ALIGNED(4) ai_i8 data_in_1[AI_MNETWORK_IN_1_SIZE_BYTES]; \
@@ -67,7 +79,12 @@
     data_in_1 \
   }; \
 
+#if defined(AI_MNETWORK_WITH_NETWORK_Q)
+#define AI_MNETWORK_OUT_1_SIZE_BYTES \
+  AI_MNETWORK_SIZE_MAX(AI_NETWORK_OUT_1_SIZE_BYTES, AI_NETWORK_Q_OUT_1_SIZE_BYTES)
+#else
 #define AI_MNETWORK_OUT_1_SIZE_BYTES AI_NETWORK_OUT_1_SIZE_BYTES
+#endif
 #define AI_MNETWORK_OUT_NUM 1
 #define DEF_DATA_OUT \
   AI_ALIGNED(4) ai_i8 data_out_1[AI_MNETWORK_OUT_1_SIZE_BYTES]; \
@@ -77,7 +94,15 @@
 
 #define AI_NETWORK_DATA_ACTIVATIONS_START_ADDR 0xFFFFFFFF
 
+#if defined(AI_MNETWORK_WITH_NETWORK_Q)
+#define AI_NETWORK_Q_DATA_ACTIVATIONS_START_ADDR 0xFFFFFFFF
+
+/* the networks are run one after the other on the same activations buffer */
+#define AI_MNETWORK_DATA_ACTIVATIONS_INT_SIZE \
+  AI_MNETWORK_SIZE_MAX(AI_NETWORK_DATA_ACTIVATIONS_SIZE, AI_NETWORK_Q_DATA_ACTIVATIONS_SIZE)
+#else
 #define AI_MNETWORK_DATA_ACTIVATIONS_INT_SIZE AI_NETWORK_DATA_ACTIVATIONS_SIZE
+#endif
 
 void MX_X_CUBE_AI_Init(void);
 void MX_X_CUBE_AI_Process(void);
@@ -101,7 +126,50 @@ typedef struct {
     ai_u32 actBufferSize;
 } ai_network_entry_t;
 
+#if defined(AI_MNETWORK_WITH_NETWORK_Q)
+#define AI_MNETWORK_NUMBER  (2)
+#else
 #define AI_MNETWORK_NUMBER  (1)
+#endif
+
+/* Max number of network instances (all models), each instance owns its
+ * activations buffer, the weights are shared */
+#ifndef AI_MNETWORK_INSTANCE_NUMBER
+#define AI_MNETWORK_INSTANCE_NUMBER  AI_MNETWORK_NUMBER
+#endif
+
+#if defined(AI_MNETWORK_WITH_TFLITE)
+/* Max number of models loaded at run time from a .tflite file, served next
+ * to the generated ones (see ai_mnetwork_load) */
+#ifndef AI_MNETWORK_LOADED_NUMBER
+#define AI_MNETWORK_LOADED_NUMBER  (2)
+#endif
+
+/* samples processed per layer call by the loaded models */
+#ifndef AI_MNETWORK_LOADED_N_BATCHES
+#define AI_MNETWORK_LOADED_N_BATCHES  AI_NETWORK_N_BATCHES
+#endif
+#endif
+
+/* Weights blob: the weights of a generated network stored out of the
+ * application image (file, flash region), used in place of the compiled-in
+ * ones without rebuild (see ai_mnetwork_weights_publish). A 64 bytes header
+ * is followed by the raw weights (AI_NETWORK_DATA_WEIGHTS_SIZE bytes) */
+#define AI_MNETWORK_WEIGHTS_MAGIC     (0x42574941U)   /* "AIWB" */
+#define AI_MNETWORK_WEIGHTS_VERSION   (1)
+/* alignment of the weights from the start of the blob */
+#define AI_MNETWORK_WEIGHTS_ALIGN     (64)
+#define AI_MNETWORK_SIGNATURE_SIZE    (40)
+
+typedef struct {
+    ai_u32 magic;           /* AI_MNETWORK_WEIGHTS_MAGIC */
+    ai_u16 version;         /* AI_MNETWORK_WEIGHTS_VERSION */
+    ai_u16 header_size;     /* offset of the weights, multiple of the alignment */
+    char signature[AI_MNETWORK_SIGNATURE_SIZE]; /* model_signature of the network */
+    ai_u32 size;            /* size of the weights (bytes) */
+    ai_u32 checksum;        /* FNV-1a of the weights */
+    ai_u32 reserved[2];
+} ai_mnetwork_weights_header;
 
 AI_API_DECLARE_BEGIN
 
@@ -143,7 +211,10 @@ ai_error ai_mnetwork_create(const char *name,
  * @brief Destroy a neural network and frees the allocated memory.
  * @ingroup network
  * @details Destroys the network and frees its memory. The network handle is returned;
- * if the handle is not NULL, the unloading has not been successful.
+ * if the handle is not NULL, the unloading has not been successful. An
+ * instance acquired by @ref ai_mnetwork_pool_acquire is not destroyed
+ * (atomically with the acquisitions), nor is one being destroyed by another
+ * thread.
  * @param network an opaque handle to the network context
  * @return an object handle : AI_HANDLE_NULL if network was destroyed
  * correctly. The same input network handle if destroy failed.
@@ -157,6 +228,9 @@ ai_handle ai_mnetwork_destroy(ai_handle network);
  * @details This API initialized the network after a successfull
  * @ref ai_network_create. Both the activations memory buffer
  * and params (i.e. weights) need to be provided by caller application
+ * Without weights buffer (params.n_batches = 0) the instance uses the last
+ * published blob (see @ref ai_mnetwork_weights_publish), else the compiled-in
+ * weights, and follows the next publications.
  *
  * @param network an opaque handle to the network context
  * @param params the parameters of the network (required).
@@ -206,6 +280,137 @@ AI_API_ENTRY
 ai_i32 ai_mnetwork_forward(
   ai_handle network, const ai_buffer* input);
 
+/*!
+ * @brief Register the I/O buffers used by the next runs of the network.
+ * @ingroup network
+ * @details "bind once, run many": the buffers are checked and the I/O
+ * tensors pointed on the caller memory once, @ref ai_mnetwork_run_bound then
+ * only executes the layers. A NULL data field selects the memory owned by
+ * the network (report.inputs[i].data / report.outputs[i].data, 1 batch).
+ * The binding is dropped by @ref ai_mnetwork_run and @ref ai_mnetwork_init.
+ * With the closed runtime (no AI_PLATFORM_IO_BIND) the buffers are kept and
+ * passed to the regular run, without the data field fallback.
+ * @param network an opaque handle to the network context
+ * @param[in] input buffers with the input data (AI_MNETWORK_IN_NUM)
+ * @param[out] output buffers for the output data (AI_MNETWORK_OUT_NUM)
+ * @return the number of batches of the bound buffers or <= 0 if it fails
+ */
+AI_API_ENTRY
+ai_i32 ai_mnetwork_bind_io(
+  ai_handle network, const ai_buffer* input, ai_buffer* output);
+
+/*!
+ * @brief Run the network on the buffers registered by
+ * @ref ai_mnetwork_bind_io
+ * @ingroup network
+ * @param network an opaque handle to the network context
+ * @return the number of batches processed or <= 0 if it fails
+ */
+AI_API_ENTRY
+ai_i32 ai_mnetwork_run_bound(ai_handle network);
+
+/*!
+ * @brief Acquire an initialized instance of a network from the pool.
+ * @ingroup network
+ * @details Lock-free: returns one of the instances created with
+ * @ref ai_mnetwork_create and initialized with @ref ai_mnetwork_init which is
+ * not already acquired, switched to the last published weights (see
+ * @ref ai_mnetwork_weights_publish). The instance is owned by the caller (and
+ * can not be destroyed) until @ref ai_mnetwork_pool_release. Instances
+ * acquired by different threads can be run concurrently.
+ * @param name the name of the network, NULL for any network
+ * @return the instance handle, AI_HANDLE_NULL if no instance is available
+ */
+AI_API_ENTRY
+ai_handle ai_mnetwork_pool_acquire(const char *name);
+
+/*!
+ * @brief Give back an instance acquired with @ref ai_mnetwork_pool_acquire.
+ * @ingroup network
+ * @param network the instance handle
+ * @return true if the instance was released, false if it was not acquired
+ */
+AI_API_ENTRY
+ai_bool ai_mnetwork_pool_release(ai_handle network);
+
+#if defined(AI_MNETWORK_WITH_TFLITE)
+/*!
+ * @brief Load a .tflite model and create an instance of it.
+ * @ingroup network
+ * @details The file is mapped and parsed in place (see core_tflite.h), the
+ * model is registered under the base name of the file: it is listed by
+ * @ref ai_mnetwork_find and more instances can be created with
+ * @ref ai_mnetwork_create. The returned instance is initialized with
+ * @ref ai_mnetwork_init (no weights buffer, activations buffer of the size
+ * returned by @ref ai_mnetwork_get_ext_data_activations). Not thread safe.
+ * @param path path of the .tflite file
+ * @param network the handle of the created instance
+ * @return an error code reporting the status of the API on exit
+ */
+AI_API_ENTRY
+ai_error ai_mnetwork_load(const char *path, ai_handle* network);
+
+/*!
+ * @brief Release a model loaded with @ref ai_mnetwork_load.
+ * @ingroup network
+ * @param name the name of the model
+ * @return true if the model was released, false if it is unknown or still
+ * has instances
+ */
+AI_API_ENTRY
+ai_bool ai_mnetwork_unload(const char *name);
+#endif
+
+/*!
+ * @brief Fill the header of a weights blob.
+ * @ingroup network
+ * @param header the header to fill
+ * @param signature the model signature (report.model_signature)
+ * @param weights the weights following the header
+ * @param size the size of the weights (bytes)
+ * @return false if the signature does not fit in the header
+ */
+AI_API_ENTRY
+ai_bool ai_mnetwork_weights_header_init(ai_mnetwork_weights_header* header,
+        const char *signature, const ai_handle weights, ai_u32 size);
+
+/*!
+ * @brief Switch all the instances of a network to the weights of a blob.
+ * @ingroup network
+ * @details The blob (header and weights) is used in place: e.g. an image in
+ * memory mapped flash executed in place. It is checked against the network
+ * (signature, size and checksum of the weights) then published: each
+ * instance initialized without user weights (see @ref ai_mnetwork_init)
+ * switches to it before its next run (an idle pooled instance when it is
+ * acquired), the running inferences complete with the previous weights. Two
+ * blobs are in use at most: the publication fails while an instance is still
+ * running with the blob published before the current one. Once a
+ * publication has succeeded, the blob published before the current one can
+ * be released by the caller.
+ * Only the generated networks can be updated. Concurrent publications are
+ * serialized.
+ * @param network an instance of the network
+ * @param blob the blob, aligned on 4 bytes at least
+ * @return true if the blob was published
+ */
+AI_API_ENTRY
+ai_bool ai_mnetwork_weights_publish(ai_handle network, const ai_handle blob);
+
+#if defined(AI_MNETWORK_WITH_WEIGHTS_FILE)
+/*!
+ * @brief Map a weights blob file and publish it.
+ * @ingroup network
+ * @details The file is mapped read-only (not copied), see
+ * @ref ai_mnetwork_weights_publish. It is unmapped when it is replaced by
+ * the publication after next.
+ * @param network an instance of the network
+ * @param path path of the blob file
+ * @return true if the blob was published
+ */
+AI_API_ENTRY
+ai_bool ai_mnetwork_weights_load(ai_handle network, const char *path);
+#endif
+
 AI_API_ENTRY
 int ai_mnetwork_get_private_handle(ai_handle network,
         ai_handle *phandle,
@@ -0,0 +1,64 @@
+/**
+  ******************************************************************************
+  * @file    network_aot.h
+  * @author  AST Embedded Analytics Research Platform
+  * @date    Fri Oct 16 16:47:32 2026
+  * @brief   AI ahead-of-time compiled network (model "network")
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2018 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software component is licensed by ST under Ultimate Liberty license
+  * SLA0044, the "License"; You may not use this file except in compliance with
+  * the License. You may obtain a copy of the License at:
+  *                             www.st.com/SLA0044
+  *
+  ******************************************************************************
+  */
+
+#ifndef __AI_NETWORK_AOT_H__
+#define __AI_NETWORK_AOT_H__
+#pragma once
+
+#include "ai_platform.h"
+
+#define AI_NETWORK_AOT_MODEL_NAME          "network_aot"
+#define AI_NETWORK_AOT_SOURCE_NAME         "network"
+#define AI_NETWORK_AOT_SOURCE_SIGNATURE    "dae97dc1773c31e8b7500d204c3e3d05"
+
+#define AI_NETWORK_AOT_IN_NUM       (1)
+#define AI_NETWORK_AOT_IN_1_SIZE    (1)
+#define AI_NETWORK_AOT_OUT_NUM      (1)
+#define AI_NETWORK_AOT_OUT_1_SIZE   (1)
+
+#define AI_NETWORK_AOT_N_NODES      (1)
+#define AI_NETWORK_AOT_MACC         (1)
+
+AI_API_DECLARE_BEGIN
+
+/*!
+ * @defgroup network_aot
+ * @brief Ahead-of-time compiled neural network
+ * @details The c-nodes of the model are compiled to straight-line code:
+ * the network has no context, no activations buffer and no weights buffer.
+ */
+
+/*!
+ * @brief Run the network on the samples of the input buffer.
+ * @ingroup network_aot
+ * @param network not used (stateless network), may be AI_HANDLE_NULL
+ * @param[in] input float input buffer, n_batches samples of
+ * AI_NETWORK_AOT_IN_1_SIZE elements
+ * @param[out] output float output buffer, n_batches samples (at least the
+ * ones of the input) of AI_NETWORK_AOT_OUT_1_SIZE elements
+ * @return the number of processed samples, 0 if the buffers are invalid
+ */
+AI_API_ENTRY
+ai_i32 ai_network_aot_run(
+  ai_handle network, const ai_buffer* input, ai_buffer* output);
+
+AI_API_DECLARE_END
+
+#endif /* __AI_NETWORK_AOT_H__ */
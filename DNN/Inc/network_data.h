@@ -26,7 +26,16 @@
 
 #define AI_NETWORK_DATA_CONFIG           AI_HANDLE_NULL
 
-#define AI_NETWORK_DATA_ACTIVATIONS_SIZE     (20)
+/* number of samples processed by each layer call: the activations plan is
+ * replicated for each of them (offsets and sizes scaled by the batch) */
+#ifndef AI_NETWORK_N_BATCHES
+#define AI_NETWORK_N_BATCHES                 (1)
+#endif
+
+#define AI_NETWORK_DATA_ACTIVATIONS_BATCH_SIZE  (20)
+
+#define AI_NETWORK_DATA_ACTIVATIONS_SIZE \
+  (AI_NETWORK_DATA_ACTIVATIONS_BATCH_SIZE * AI_NETWORK_N_BATCHES)
 
 #define AI_NETWORK_DATA_WEIGHTS_SIZE         (64)
 
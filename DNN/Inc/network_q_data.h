@@ -0,0 +1,69 @@
+/**
+  ******************************************************************************
+  * @file    network_q_data.h
+  * @author  AST Embedded Analytics Research Platform
+  * @date    Fri Oct 16 16:33:14 2026
+  * @brief   AI Tool Automatic Code Generator for Embedded NN computing
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2018 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software component is licensed by ST under Ultimate Liberty license
+  * SLA0044, the "License"; You may not use this file except in compliance with
+  * the License. You may obtain a copy of the License at:
+  *                             www.st.com/SLA0044
+  *
+  ******************************************************************************
+  */
+
+#ifndef __NETWORK_Q_DATA_H_
+#define __NETWORK_Q_DATA_H_
+#pragma once
+
+#include "ai_platform.h"
+
+#define AI_NETWORK_Q_DATA_CONFIG           AI_HANDLE_NULL
+
+/* number of samples processed by each layer call: the activations plan is
+ * replicated for each of them (offsets and sizes scaled by the batch) */
+#ifndef AI_NETWORK_Q_N_BATCHES
+#define AI_NETWORK_Q_N_BATCHES                 (1)
+#endif
+
+#define AI_NETWORK_Q_DATA_ACTIVATIONS_BATCH_SIZE  (0)
+
+#define AI_NETWORK_Q_DATA_ACTIVATIONS_SIZE \
+  (AI_NETWORK_Q_DATA_ACTIVATIONS_BATCH_SIZE * AI_NETWORK_Q_N_BATCHES)
+
+#define AI_NETWORK_Q_DATA_WEIGHTS_SIZE         (8)
+
+#define AI_NETWORK_Q_DATA_ACTIVATIONS(ptr_)  \
+  AI_BUFFER_OBJ_INIT( \
+    AI_BUFFER_FORMAT_U8, \
+    1, 1, AI_NETWORK_Q_DATA_ACTIVATIONS_SIZE, 1, \
+    AI_HANDLE_PTR(ptr_) )
+
+#define AI_NETWORK_Q_DATA_WEIGHTS(ptr_)  \
+  AI_BUFFER_OBJ_INIT( \
+    AI_BUFFER_FORMAT_U8|AI_BUFFER_FMT_FLAG_CONST, \
+    1, 1, AI_NETWORK_Q_DATA_WEIGHTS_SIZE, 1, \
+    AI_HANDLE_PTR(ptr_) )
+
+
+AI_API_DECLARE_BEGIN
+
+/*!
+ * @brief Get network weights array pointer as a handle ptr.
+ * @ingroup network_q_data
+ * @return a ai_handle pointer to the weights array
+ */
+AI_API_ENTRY
+ai_handle ai_network_q_data_weights_get(void);
+
+
+AI_API_DECLARE_END
+
+#endif /* __NETWORK_Q_DATA_H_ */
+
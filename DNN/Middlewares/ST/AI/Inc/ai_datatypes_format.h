@@ -66,9 +66,10 @@
  * - LDIV : 2 bits is a log2 value that is used to compute elements size
  *      with some special format such as the compressed ones. It is a shift
  *      factor usually set to zero
- * - TYPE : 4 bits mark the format "family" type. Actually 5 families are coded,
+ * - TYPE : 4 bits mark the format "family" type. Actually 6 families are coded,
  *      @ref AI_FMT_FLOAT (float types)
  *      @ref AI_FMT_Q (fixed-point types in Qm.n format)
+ *      @ref AI_FMT_BSR (block sparse formats)
  *      @ref AI_FMT_LUT4 (compressed lookup 16 formats)
  *      @ref AI_FMT_LUT8 (compressed lookup 256 formats)
  * - PBITS 3 bits padding bits used to set the number of padding bits
@@ -148,6 +149,7 @@
 #define AI_FMT_NONE                   (0x0)
 #define AI_FMT_FLOAT                  (0x1)
 #define AI_FMT_Q                      (0x2)
+#define AI_FMT_BSR                    (0x3)
 #define AI_FMT_LUT4                   (0x4)
 #define AI_FMT_LUT8                   (0x8)
 
@@ -53,6 +53,12 @@
 #define AI_FLOOR_MOD(x, y)      fmodf(x, y)
 #define AI_ROUND(x)             roundf(x)
 
+/* int32 accumulator -> int8: rescaled, rounded (half away from zero),
+ * shifted by the zero point and saturated */
+#define AI_MATH_REQUANTIZE_S8(acc_, mult_, zp_) \
+  ( (ai_i8)AI_CLAMP((ai_i32)AI_ROUND((ai_float)(acc_) * (mult_)) + (ai_i32)(zp_), \
+                    -128, 127) )
+
 #if defined(STM32_DOT_INLINE_OPTIM)
 
 AI_DECLARE_STATIC
@@ -194,6 +200,54 @@ void __ai_math_dot_array_opt(
 
 #endif
 
+/* IEEE 754 half precision (FLOAT16 format, stored as ai_u16) <-> float:
+ * exact widening, narrowing rounded to nearest even (as the F16C
+ * instructions), overflow to infinity */
+AI_DECLARE_STATIC
+ai_float __ai_math_f16_to_f32(const ai_u16 h)
+{
+  union { ai_u32 u; ai_float f; } v;
+  const union { ai_u32 u; ai_float f; } denorm = { .u = 113U << 23 };
+
+  v.u = (ai_u32)(h & 0x7FFFU) << 13;
+  const ai_u32 exp = v.u & 0x0F800000U;
+  v.u += (127U - 15U) << 23;
+  if ( exp==0x0F800000U ) {
+    v.u += (128U - 16U) << 23;        /* inf, nan (quieted) */
+    if ( h & 0x3FFU ) v.u |= 0x00400000U;
+  } else if ( exp==0 ) {
+    v.u += 1U << 23;                  /* zero, denormal: renormalized */
+    v.f -= denorm.f;
+  }
+  v.u |= (ai_u32)(h & 0x8000U) << 16;
+  return v.f;
+}
+
+AI_DECLARE_STATIC
+ai_u16 __ai_math_f32_to_f16(const ai_float x)
+{
+  union { ai_u32 u; ai_float f; } v = { .f = x };
+  const union { ai_u32 u; ai_float f; } denorm = { .u = ((127U - 15U) + (23U - 10U) + 1U) << 23 };
+  const ai_u32 sign = v.u & 0x80000000U;
+  ai_u32 h;
+
+  v.u ^= sign;
+  if ( v.u >= ((127U + 16U) << 23) ) {
+    h = (v.u > (255U << 23)) ? 0x7E00U : 0x7C00U;   /* nan, overflow to inf */
+  } else if ( v.u < (113U << 23) ) {
+    v.f += denorm.f;                  /* denormal: rounded by the fp add */
+    h = v.u - denorm.u;
+  } else {
+    const ai_u32 odd = (v.u >> 13) & 1U;
+    v.u += ((ai_u32)(15 - 127) << 23) + 0xFFFU + odd;
+    h = v.u >> 13;
+  }
+  return (ai_u16)(h | (sign >> 16));
+}
+
+#define AI_MATH_F16_TO_F32(h)   __ai_math_f16_to_f32(h)
+#define AI_MATH_F32_TO_F16(x)   __ai_math_f32_to_f16(x)
+
 #define AI_MATH_ACOS(x)         acosf(x)
 #define AI_MATH_ACOSH(x)        acoshf(x)
 #define AI_MATH_ASIN(x)         asinf(x)
@@ -424,6 +424,19 @@ AI_DEPRECATED
 #define AI_NETWORK_ACQUIRE_CTX(handle_) \
   AI_NETWORK_OBJ(ai_platform_context_acquire(handle_))
 
+/*!
+ * @brief array of the network context bound by the generated configure
+ * functions. With a re-entrant runtime (AI_PLATFORM_REENTRANT) each context
+ * owns a copy of the generated arrays, else the generated array is shared
+ */
+#if defined(AI_PLATFORM_REENTRANT)
+#define AI_NETWORK_ARRAY(net_ctx_, array_) \
+  ai_platform_network_get_array(net_ctx_, &(array_))
+#else
+#define AI_NETWORK_ARRAY(net_ctx_, array_) \
+  (&(array_))
+#endif
+
 /******************************************************************************/
 AI_API_DECLARE_BEGIN
 
@@ -870,6 +883,18 @@ ai_error ai_platform_network_create(
   ai_network* net_ctx,
   const ai_u8 tools_major, const ai_u8 tools_minor, const ai_u8 tools_micro);
 
+/*!
+ * @brief get the array of a network context matching a generated array
+ * @ingroup ai_platform_interface
+ * @param net_ctx a pointer to the network context
+ * @param array a pointer to the generated array
+ * @return the context copy of the array, the generated array itself if it is
+ * not referenced by the network graph
+ */
+AI_INTERFACE_TYPE
+ai_array* ai_platform_network_get_array(
+  ai_network* net_ctx, const ai_array* array);
+
 /*!
  * @brief destroy a network context
  * @ingroup ai_platform_interface
@@ -911,6 +936,36 @@ AI_INTERFACE_TYPE
 ai_i32 ai_platform_network_process(
   ai_handle network, const ai_buffer* input, ai_buffer* output);
 
+/*!
+ * @brief bind once the I/O buffers of the network for the next runs
+ * @ingroup ai_platform_interface
+ * @details The buffers are checked and the I/O tensors set up here only: the
+ * following @ref ai_platform_network_process_bound calls execute the layers
+ * directly on the caller memory. A NULL input/output (or a NULL data field)
+ * selects the memory owned by the network for this tensor, e.g. the I/O
+ * allocated in the activations buffer (report.inputs[i].data), 1 batch only.
+ * The binding is dropped by @ref ai_platform_network_process and by a new
+ * initialization of the network.
+ * @param network an opaque handler to the network context
+ * @param input a pointer to the input buffers (one per network input)
+ * @param output a pointer to the output buffers (one per network output)
+ * @return the number of batches of the bound buffers. A result <=0 in case
+ * of error
+ */
+AI_INTERFACE_TYPE
+ai_i32 ai_platform_network_bind_io(
+  ai_handle network, const ai_buffer* input, ai_buffer* output);
+
+/*!
+ * @brief run the network on the buffers bound by
+ * @ref ai_platform_network_bind_io
+ * @ingroup ai_platform_interface
+ * @param network an opaque handler to the network context
+ * @return the number of batches processed. A result <=0 in case of error
+ */
+AI_INTERFACE_TYPE
+ai_i32 ai_platform_network_process_bound(ai_handle network);
+
 /*!
  * @brief Return the info of a requested c-node (defined by the
  *        c_idx field). Should be called after the initialization phase.
@@ -85,5 +85,31 @@ void node_convert_integer(ai_node *pNode);
 AI_INTERNAL_API
 void core_shape_to_stride(ai_stride* out, const ai_shape* in);
 
+/*!
+ * @brief Convert half precision values (FLOAT16 format) to float
+ * @ingroup core_convert
+ * @details the F16C (or AVX-512F) conversions are used on the cpus
+ * supporting them, see core_cpu.h
+ * @param[out] out the float values
+ * @param[in] in the half precision values (IEEE 754 binary16)
+ * @param[in] size the number of values
+ */
+AI_INTERNAL_API
+void core_convert_f16_to_f32(ai_float* out, const ai_u16* in,
+                             const ai_size size);
+
+/*!
+ * @brief Convert float values to half precision (FLOAT16 format)
+ * @ingroup core_convert
+ * @details rounded to the nearest even, out of range values are converted
+ * to infinity (as the F16C instructions, used on the cpus supporting them)
+ * @param[out] out the half precision values (IEEE 754 binary16)
+ * @param[in] in the float values
+ * @param[in] size the number of values
+ */
+AI_INTERNAL_API
+void core_convert_f32_to_f16(ai_u16* out, const ai_float* in,
+                             const ai_size size);
+
 
 #endif    /*__CORE_CONVERT_H_*/
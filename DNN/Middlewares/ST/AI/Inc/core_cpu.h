@@ -0,0 +1,54 @@
+/**
+  ******************************************************************************
+  * @file    core_cpu.h
+  * @brief   header file of the core cpu features detection
+  ******************************************************************************
+  * @attention
+  *
+  * Used by the host build of the runtime to select the kernels matching the
+  * instruction set extensions of the running cpu.
+  *
+  ******************************************************************************
+  */
+
+#ifndef __CORE_CPU_H_
+#define __CORE_CPU_H_
+#pragma once
+
+#include "ai_platform.h"
+#include "ai_datatypes_defines.h"
+
+/*!
+ * @defgroup core_cpu Core cpu features
+ * @brief cpu features detection used by the kernels dispatch
+ * @details The features are read once (cpuid on x86) and cached. On targets
+ * without runtime detection (Cortex-M) no extension is ever reported, so the
+ * generic kernels are always selected.
+ * The environment variable AI_CPU_FEATURES can be used on the host to mask
+ * the detected features (e.g. AI_CPU_FEATURES=none or =avx2) to compare the
+ * kernels on the same machine.
+ */
+
+#define AI_CPU_FEATURE_NONE       (0x0U)
+#define AI_CPU_FEATURE_AVX2       (0x1U << 0)  /*!< AVX2 */
+#define AI_CPU_FEATURE_FMA        (0x1U << 1)  /*!< FMA3 */
+#define AI_CPU_FEATURE_AVX512F    (0x1U << 2)  /*!< AVX-512 foundation */
+#define AI_CPU_FEATURE_F16C       (0x1U << 3)  /*!< half-float conversions */
+#define AI_CPU_FEATURE_AVX512BW   (0x1U << 4)  /*!< AVX-512 byte/word */
+
+#define AI_CPU_HAS_FEATURE(features_, feature_) \
+  (((features_) & (feature_))==(feature_))
+
+AI_API_DECLARE_BEGIN
+
+/*!
+ * @brief get the instruction set extensions usable on the running cpu
+ * @ingroup core_cpu
+ * @return a bitmask of AI_CPU_FEATURE_XXX flags
+ */
+AI_INTERNAL_API
+ai_u32 core_cpu_get_features(void);
+
+AI_API_DECLARE_END
+
+#endif    /*__CORE_CPU_H_*/
@@ -0,0 +1,97 @@
+/**
+  ******************************************************************************
+  * @file    core_graph.h
+  * @brief   header file of the init time graph optimizations
+  ******************************************************************************
+  * @attention
+  *
+  * Folding of consecutive linear layers into a single one and fusion of
+  * layers pairs executed by a single forward function, applied on the float
+  * graph once the weights are bound (see ai_platform_network_post_init).
+  *
+  ******************************************************************************
+  */
+
+#ifndef __CORE_GRAPH_H_
+#define __CORE_GRAPH_H_
+#pragma once
+
+#include "ai_platform.h"
+#include "ai_platform_interface.h"
+#include "core_common.h"
+
+/*!
+ * @defgroup core_graph Core graph optimizations
+ * @brief init time folding of linear layers chains
+ * @details A node is folded into its predecessor when both are affine
+ * transforms with float weights and the tensor between them is only used by
+ * this pair (not a network output, no other consumer):
+ *  - Dense -> Dense: W = W1.W0, b = W1.b0 + b1 (only when it does not
+ *    increase the number of MACC)
+ *  - Dense -> BN and Conv2D -> BN (conv without fused nonlinearity):
+ *    W[o] = s[o].W[o], b[o] = s[o].b[o] + t[o]
+ * The folded weights are allocated on the heap; the generated weights and
+ * nodes are left untouched and are restored by @ref core_graph_unfold.
+ * The intermediate activations of a folded pair are no longer accessed.
+ *
+ * The folded graph is then scanned for pairs fused without changing their
+ * weights, under the same condition on the tensor between them:
+ *  - Conv2D depthwise -> Conv2D pointwise (float, see
+ *    @ref conv2d_dw_pw_is_fusable): executed by @ref forward_conv2d_dw_pw
+ *
+ * The layers keep the weights they prepare for their kernels (transposed,
+ * transformed) in the graph state of the instance, see
+ * @ref core_graph_get_prepared.
+ */
+
+AI_API_DECLARE_BEGIN
+
+/*!
+ * @brief fold the linear chains of the network graph
+ * @ingroup core_graph
+ * @param net the network (weights already bound)
+ * @return the number of nodes removed from the execution list
+ */
+AI_INTERNAL_API
+ai_u32 core_graph_fold(ai_network* net);
+
+/*!
+ * @brief get the node fused into a node of the folded graph
+ * @ingroup core_graph
+ * @param node a node of the execution list
+ * @return the fused node (unlinked from the execution list), NULL if none
+ */
+AI_INTERNAL_API
+ai_node* core_graph_get_fused(const ai_node* node);
+
+/*!
+ * @brief get the weights of a node prepared for a kernel, allocated on the
+ * first call and kept until the graph is unfolded (the weights are bound
+ * again). A node holds one prepared weights buffer per tag: it is reused
+ * when the node is called with other weights.
+ * @ingroup core_graph
+ * @param node the node
+ * @param key the weights the prepared ones are computed from
+ * @param tag the kind of preparation (e.g. the algorithm)
+ * @param size the bytes of the prepared weights
+ * @param is_new set when the prepared weights are not computed from key
+ * yet (allocated or reused by this call), the caller then computes them
+ * @return the prepared weights, NULL if they could not be allocated
+ */
+AI_INTERNAL_API
+ai_handle core_graph_get_prepared(ai_node* node, const ai_handle key,
+                                  const ai_u32 tag, const ai_size size,
+                                  ai_bool* is_new);
+
+/*!
+ * @brief restore the generated graph, releasing the folded and the prepared
+ * weights
+ * @ingroup core_graph
+ * @param net the network
+ */
+AI_INTERNAL_API
+void core_graph_unfold(ai_network* net);
+
+AI_API_DECLARE_END
+
+#endif    /*__CORE_GRAPH_H_*/
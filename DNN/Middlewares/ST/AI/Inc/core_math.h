@@ -0,0 +1,167 @@
+/**
+  ******************************************************************************
+  * @file    core_math.h
+  * @brief   header file of the core vectorized math routines
+  ******************************************************************************
+  * @attention
+  *
+  * Float transcendental functions applied on arrays, used by the pointwise
+  * nonlinearities (see layers_nl.h).
+  *
+  ******************************************************************************
+  */
+
+#ifndef __CORE_MATH_H_
+#define __CORE_MATH_H_
+#pragma once
+
+#include "ai_platform.h"
+#include "ai_datatypes_defines.h"
+
+/*!
+ * @defgroup core_math Core math routines
+ * @brief float exp, log, tanh, sigmoid and erf on arrays, softmax
+ * reductions
+ * @details The functions are either computed with the float C library
+ * (AI_MATH_ACCURACY_LIBM) or with polynomial approximations after a range
+ * reduction, vectorized with AVX2+FMA or AVX-512F when the cpu supports them
+ * (see core_cpu.h). The maximum errors of the approximations, measured
+ * against a long double reference on a sweep of the float range (one
+ * input out of 5):
+ *
+ *   | function | AI_MATH_ACCURACY_ULP2 | AI_MATH_ACCURACY_FAST    |
+ *   |----------|-----------------------|--------------------------|
+ *   | exp      | 1.01 ULP              | 5.6e-5 relative          |
+ *   | log      | 0.82 ULP              | 0.82 ULP (same kernel)   |
+ *   | tanh     | 1.33 ULP              | 1.5e-5 absolute          |
+ *   | sigmoid  | 1.48 ULP              | 1.4e-5 absolute          |
+ *   | erf      | 1.40 ULP              | 5.0e-6 absolute          |
+ *
+ * The bounded functions (tanh, sigmoid, erf) are within 1e-4 absolute in
+ * the FAST tier. exp is bounded relatively (so within 5.6e-5 absolute for
+ * x <= 0 only): no absolute bound holds for results up to 3.4e38, an ULP of
+ * exp(20) being already 32. log keeps the ULP2 kernel.
+ *
+ * exp flushes to zero below -103.9 (result under half the smallest
+ * subnormal) and overflows to +inf above 88.72; the special values (NaN,
+ * +/-inf, +/-0) follow the C library. The generic and the x86 variants of
+ * an approximation give the same results up to the FMA rounding.
+ *
+ * The accuracy is the AI_MATH_ACCURACY_DEFAULT build setting; the
+ * environment variable AI_MATH_ACCURACY (libm, ulp2 or fast) overrides it
+ * on the host.
+ */
+
+/*!
+ * @enum ai_math_accuracy
+ * @ingroup core_math
+ * @brief accuracy tiers of the core math functions
+ */
+typedef enum {
+  AI_MATH_ACCURACY_LIBM = 0,  /*!< float C library, scalar */
+  AI_MATH_ACCURACY_ULP2,      /*!< at most 2 ULP, vectorized */
+  AI_MATH_ACCURACY_FAST,      /*!< at most 1e-4 absolute (exp: relative,
+                                   log: ULP2), vectorized */
+} ai_math_accuracy;
+
+#ifndef AI_MATH_ACCURACY_DEFAULT
+#define AI_MATH_ACCURACY_DEFAULT    AI_MATH_ACCURACY_ULP2
+#endif
+
+AI_API_DECLARE_BEGIN
+
+/*!
+ * @brief get the accuracy tier of the core math functions
+ * @ingroup core_math
+ * @return AI_MATH_ACCURACY_DEFAULT or the tier set by the AI_MATH_ACCURACY
+ * environment variable (read once)
+ */
+AI_INTERNAL_API
+ai_math_accuracy core_math_get_accuracy(void);
+
+/*!
+ * @brief Computes exp(x) on a float array
+ * @ingroup core_math
+ * @param[out] out the results, may alias in
+ * @param[in] in the input values
+ * @param[in] size the number of values
+ */
+AI_INTERNAL_API
+void core_math_exp_array_f32(ai_float* out, const ai_float* in,
+                             const ai_size size);
+
+/*!
+ * @brief Computes the natural logarithm log(x) on a float array
+ * @ingroup core_math
+ * @param[out] out the results, may alias in
+ * @param[in] in the input values
+ * @param[in] size the number of values
+ */
+AI_INTERNAL_API
+void core_math_log_array_f32(ai_float* out, const ai_float* in,
+                             const ai_size size);
+
+/*!
+ * @brief Computes tanh(x) on a float array
+ * @ingroup core_math
+ * @param[out] out the results, may alias in
+ * @param[in] in the input values
+ * @param[in] size the number of values
+ */
+AI_INTERNAL_API
+void core_math_tanh_array_f32(ai_float* out, const ai_float* in,
+                              const ai_size size);
+
+/*!
+ * @brief Computes the logistic sigmoid 1/(1+exp(-x)) on a float array
+ * @ingroup core_math
+ * @param[out] out the results, may alias in
+ * @param[in] in the input values
+ * @param[in] size the number of values
+ */
+AI_INTERNAL_API
+void core_math_sigmoid_array_f32(ai_float* out, const ai_float* in,
+                                 const ai_size size);
+
+/*!
+ * @brief Computes the error function erf(x) on a float array
+ * @ingroup core_math
+ * @param[out] out the results, may alias in
+ * @param[in] in the input values
+ * @param[in] size the number of values
+ */
+AI_INTERNAL_API
+void core_math_erf_array_f32(ai_float* out, const ai_float* in,
+                             const ai_size size);
+
+/*!
+ * @brief Computes in a single pass the maximum m of a float array and the
+ * sum of the exp(x - m) (online softmax normalization): the sum is rescaled
+ * by exp(m_old - m) when the running maximum increases
+ * @ingroup core_math
+ * @param[in] in the input values
+ * @param[in] size the number of values, > 0
+ * @param[out] max the maximum of the values
+ * @return the sum of the exp(x - max), >= 1
+ */
+AI_INTERNAL_API
+ai_float core_math_max_exp_sum_f32(const ai_float* in, const ai_size size,
+                                   ai_float* max);
+
+/*!
+ * @brief Computes exp(x - offset) * scale on a float array
+ * @ingroup core_math
+ * @param[out] out the results, may alias in
+ * @param[in] in the input values
+ * @param[in] size the number of values
+ * @param[in] offset subtracted from the inputs before exp
+ * @param[in] scale applied to the exponentials
+ */
+AI_INTERNAL_API
+void core_math_exp_scale_array_f32(ai_float* out, const ai_float* in,
+                                   const ai_size size, const ai_float offset,
+                                   const ai_float scale);
+
+AI_API_DECLARE_END
+
+#endif    /*__CORE_MATH_H_*/
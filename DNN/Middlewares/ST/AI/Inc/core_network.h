@@ -0,0 +1,104 @@
+/**
+  ******************************************************************************
+  * @file    core_network.h
+  * @brief   header file of the network instances management
+  ******************************************************************************
+  * @attention
+  *
+  * The generated network object (and its nodes, tensors and arrays) is used
+  * as a read-only template: each created instance owns a deep copy of the
+  * graph and of its arrays, so several instances of the same model can be
+ * created, initialized and run concurrently.
+  *
+  ******************************************************************************
+  */
+
+#ifndef __CORE_NETWORK_H_
+#define __CORE_NETWORK_H_
+#pragma once
+
+#include "ai_platform.h"
+#include "ai_platform_interface.h"
+
+/*!
+ * @defgroup core_network Core network instances
+ * @brief per-instance copies of a generated network graph
+ * @details An instance is a single heap block holding the copy of the
+ * network context, of the nodes (layer structs), of the tensor chains and of
+ * all the tensors and arrays they reference. Shapes, strides, quantization
+ * infos and the layer specific parameters are shared with the template as
+ * they are never written by the runtime.
+ * The generated configure functions bind the weights and activations on the
+ * instance arrays (see AI_NETWORK_ARRAY and @ref core_network_get_array), the
+ * template is never written once created. The weights buffer is shared by all
+ * the instances, each one using its own activations buffer.
+ */
+
+AI_API_DECLARE_BEGIN
+
+/*!
+ * @brief create an instance of a generated network
+ * @ingroup core_network
+ * @param templ the generated network object
+ * @return the instance (to be released with @ref core_network_free), NULL
+ * if the allocation failed or the graph contains an unknown node type
+ */
+AI_INTERNAL_API
+ai_network* core_network_clone(const ai_network* templ);
+
+/*!
+ * @brief get the instance copy of a template array
+ * @ingroup core_network
+ * @param net the instance
+ * @param array the template (generated) array
+ * @return the instance array, NULL if the array is not part of the graph
+ */
+AI_INTERNAL_API
+ai_array* core_network_get_array(ai_network* net, const ai_array* array);
+
+/*!
+ * @brief get the slot holding the graph optimizations state of an instance
+ * (see @ref core_graph)
+ * @ingroup core_network
+ * @param net the instance
+ * @return the address of the per-instance state handle
+ */
+AI_INTERNAL_API
+ai_handle* core_network_get_graph(ai_network* net);
+
+/*!
+ * @brief get the slot holding the size of the planned activations of an
+ * instance (see @ref core_plan)
+ * @ingroup core_network
+ * @param net the instance
+ * @return the address of the planned size (bytes, all the batches),
+ * AI_PLAN_SIZE_NONE when the generated offsets are used
+ */
+AI_INTERNAL_API
+ai_size* core_network_get_arena_size(ai_network* net);
+
+/*!
+ * @brief get the scratch arena of an instance
+ * @ingroup core_network
+ * @details the arena is a temporary buffer shared by the layers of the
+ * instance (a layer only uses it during its forward, e.g. for the im2col
+ * columns of a convolution). It is grown on demand and kept for the next
+ * calls, then released with the instance.
+ * @param net the instance
+ * @param size the requested size (bytes)
+ * @return the arena, NULL if the allocation failed
+ */
+AI_INTERNAL_API
+ai_handle core_network_get_scratch(ai_network* net, const ai_size size);
+
+/*!
+ * @brief release an instance
+ * @ingroup core_network
+ * @param net the instance
+ */
+AI_INTERNAL_API
+void core_network_free(ai_network* net);
+
+AI_API_DECLARE_END
+
+#endif    /*__CORE_NETWORK_H_*/
@@ -0,0 +1,86 @@
+/**
+  ******************************************************************************
+  * @file    core_plan.h
+  * @brief   header file of the activations memory planner
+  ******************************************************************************
+  * @attention
+  *
+  * Static planning of the activations buffer from the tensor lifetimes of
+  * the executed graph, applied once the graph is final (see
+  * ai_platform_network_post_init).
+  *
+  ******************************************************************************
+  */
+
+#ifndef __CORE_PLAN_H_
+#define __CORE_PLAN_H_
+#pragma once
+
+#include "ai_platform.h"
+#include "ai_platform_interface.h"
+
+/*!
+ * @defgroup core_plan Core activations planner
+ * @brief liveness based packing of the activations in a single arena
+ * @details Each array of the activations buffer is alive from the first to
+ * the last c-node referencing it (network I/O kept in the activations are
+ * alive for the whole run). The buffers are placed by decreasing size, each
+ * one in the smallest gap left by the already placed buffers whose lifetime
+ * overlaps its own (greedy by size, best fit), else after the last of them.
+ * The output of an in-place safe c-node (pointwise nonlinearity, eltwise,
+ * add) shares the buffer of a same-size input whose last use is this node.
+ * The offsets replace the ones of the generated configure function when the
+ * planned arena is not larger than the generated one.
+ */
+
+/*!
+ * @brief alignment (bytes) of the planned offsets
+ * @ingroup core_plan
+ */
+#define AI_PLAN_ALIGN           (4)
+
+/*!
+ * @brief planned size of a network using the generated offsets
+ * @ingroup core_plan
+ */
+#define AI_PLAN_SIZE_NONE       ((ai_size)-1)
+
+/*!
+ * @struct ai_plan_buffer
+ * @ingroup core_plan
+ * @brief a buffer to place in the arena and its lifetime
+ */
+typedef struct ai_plan_buffer_ {
+  ai_size   size;     /*!< size in bytes */
+  ai_u16    first;    /*!< first c-node using the buffer */
+  ai_u16    last;     /*!< last c-node using the buffer */
+  ai_size   offset;   /*!< assigned offset (bytes), set by core_plan_pack */
+} ai_plan_buffer;
+
+AI_API_DECLARE_BEGIN
+
+/*!
+ * @brief assign the offsets of a set of buffers (greedy by size, best fit)
+ * @ingroup core_plan
+ * @param buffers the buffers, offsets updated on return
+ * @param n_buffers number of buffers
+ * @return the size of the arena (bytes), 0 if the allocation of the working
+ * memory failed (and n_buffers > 0)
+ */
+AI_INTERNAL_API
+ai_size core_plan_pack(ai_plan_buffer* buffers, const ai_size n_buffers);
+
+/*!
+ * @brief plan the activations buffer of an initialized network and rebind
+ * its arrays on the planned offsets
+ * @ingroup core_plan
+ * @param net the network (activations bound, graph optimizations applied)
+ * @return the size of the planned arena for all the batches (bytes),
+ * AI_PLAN_SIZE_NONE if the generated offsets are kept
+ */
+AI_INTERNAL_API
+ai_size core_plan_activations(ai_network* net);
+
+AI_API_DECLARE_END
+
+#endif    /*__CORE_PLAN_H_*/
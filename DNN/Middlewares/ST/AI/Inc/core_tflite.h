@@ -0,0 +1,142 @@
+/**
+  ******************************************************************************
+  * @file    core_tflite.h
+  * @brief   header file of the runtime .tflite model loader
+  ******************************************************************************
+  * @attention
+  *
+  * Builds a network from a TensorFlow Lite flatbuffer at run time, without
+  * code generation. The loaded model provides the same entry points as a
+  * generated network (see network.h) and is served by the ai_mnetwork API
+  * (see ai_mnetwork_load).
+  *
+  ******************************************************************************
+  */
+
+#ifndef __CORE_TFLITE_H_
+#define __CORE_TFLITE_H_
+#pragma once
+
+#include "ai_platform.h"
+#include "ai_platform_interface.h"
+
+/*!
+ * @defgroup core_tflite Core .tflite loader
+ * @brief in-place parsing of a .tflite flatbuffer into a network template
+ * @details The flatbuffer is read in place (a file is mapped, not copied).
+ * The first subgraph is mapped on the runtime layers:
+ *  - FULLY_CONNECTED (float32, optional bias): dense layer
+ *  - ADD (same shape or broadcast operands): add layer
+ *  - RELU, RELU6, LOGISTIC, TANH: nonlinearity layers
+ * A fused activation (RELU, RELU6, TANH) is executed by an extra
+ * nonlinearity layer.
+ * The weights arrays point to the buffers of the flatbuffer (zero-copy, a
+ * misaligned buffer is copied once). The half precision weights of a float16
+ * quantized model (FLOAT16 constant and DEQUANTIZE operator) are kept in the
+ * FLOAT16 format and converted on the fly by the dense kernels, a half
+ * precision bias is converted to float at load time. The activations are
+ * planned at load time (see core_plan_pack). Any other operator, tensor type or a quantized
+ * tensor fails the load (AI_ERROR_INVALID_PARAM, AI_ERROR_CODE_INVALID_FORMAT).
+ *
+ * The returned model is the template of the network instances: it must be
+ * kept open while an instance created from it exists.
+ */
+
+/*!
+ * @brief number of samples processed per call when not given to the loader
+ * @ingroup core_tflite
+ */
+#ifndef AI_TFLITE_N_BATCHES
+#define AI_TFLITE_N_BATCHES       (1)
+#endif
+
+/*!
+ * @brief max size of the name of a loaded model (including the terminator)
+ * @ingroup core_tflite
+ */
+#define AI_TFLITE_NAME_SIZE       (32)
+
+AI_API_DECLARE_BEGIN
+
+/*!
+ * @brief build a model from a .tflite flatbuffer in memory
+ * @ingroup core_tflite
+ * @param model returned model handle (AI_HANDLE_NULL on error)
+ * @param name name of the model (model_name of the reports)
+ * @param data the flatbuffer, must stay valid until @ref core_tflite_close
+ * @param size size of the flatbuffer (bytes)
+ * @param n_batches samples processed per call (0: AI_TFLITE_N_BATCHES)
+ * @return an error type/code pair, AI_ERROR_NONE on success
+ */
+AI_INTERNAL_API
+ai_error core_tflite_open(ai_handle* model, const char* name,
+                          const ai_handle data, const ai_size size,
+                          const ai_u16 n_batches);
+
+/*!
+ * @brief map a .tflite file and build a model from it
+ * @ingroup core_tflite
+ * @details the model is named after the file (base name without extension)
+ * @param model returned model handle (AI_HANDLE_NULL on error)
+ * @param path path of the .tflite file
+ * @param n_batches samples processed per call (0: AI_TFLITE_N_BATCHES)
+ * @return an error type/code pair, AI_ERROR_NONE on success
+ */
+AI_INTERNAL_API
+ai_error core_tflite_load(ai_handle* model, const char* path,
+                          const ai_u16 n_batches);
+
+/*!
+ * @brief release a model (and unmap its file)
+ * @ingroup core_tflite
+ * @param model the model handle
+ */
+AI_INTERNAL_API
+void core_tflite_close(ai_handle model);
+
+/*!
+ * @brief name of a model
+ * @ingroup core_tflite
+ */
+AI_INTERNAL_API
+const char* core_tflite_get_name(const ai_handle model);
+
+/*!
+ * @brief default parameters of a model: weights (none, the model owns
+ * them) and activations (size for all the batches, no data)
+ * @ingroup core_tflite
+ */
+AI_INTERNAL_API
+ai_bool core_tflite_get_params(const ai_handle model,
+                               ai_network_params* params);
+
+/*!
+ * @brief network API of the loaded models, see network.h. The model handle
+ * is passed as data of the network_config buffer of ai_tflite_create.
+ * @ingroup core_tflite
+ */
+AI_API_ENTRY
+ai_bool ai_tflite_get_info(ai_handle network, ai_network_report* report);
+
+AI_API_ENTRY
+ai_error ai_tflite_get_error(ai_handle network);
+
+AI_API_ENTRY
+ai_error ai_tflite_create(ai_handle* network, const ai_buffer* network_config);
+
+AI_API_ENTRY
+ai_handle ai_tflite_destroy(ai_handle network);
+
+AI_API_ENTRY
+ai_bool ai_tflite_init(ai_handle network, const ai_network_params* params);
+
+AI_API_ENTRY
+ai_i32 ai_tflite_run(ai_handle network, const ai_buffer* input,
+                     ai_buffer* output);
+
+AI_API_ENTRY
+ai_i32 ai_tflite_forward(ai_handle network, const ai_buffer* input);
+
+AI_API_DECLARE_END
+
+#endif    /*__CORE_TFLITE_H_*/
@@ -15,7 +15,8 @@
    - type_id_ (4bits) : it is used to define the "family" of the format: 
       see @ref AI_FMT_Q as an example. Currently supported types are: 
       AI_FMT_Q (fixed point types), AI_FMT_FLOAT (floating point values),
-      AI_FMT_LUT4 or AI_FMT_LUT8 (compressed formats)
+      AI_FMT_LUT4 or AI_FMT_LUT8 (compressed formats), AI_FMT_BSR (block
+      sparse formats)
    - pbits_ (3bits) : number of padding bits for the format
    - bits_ (7bits)  : size in bits of the format (NB: integer+fractional bits)
    - fbits_ (7bits) : number of fractional bits for the format (for AI_FMT_Q only)
@@ -32,7 +33,7 @@ FMT_ENTRY(1, NONE, AI_FMT_NONE, 0, 0, 0, 0, 0, 0)
 /* Floating point formats */
 FMT_ENTRY(1, FLOAT,   AI_FMT_FLOAT, 1, 1, 0, 32,  0, 0)
 FMT_ENTRY(0, FLOAT64, AI_FMT_FLOAT, 1, 1, 0, 64,  0, 0)
-FMT_ENTRY(0, FLOAT16, AI_FMT_FLOAT, 1, 1, 0, 16,  0, 0)
+FMT_ENTRY(1, FLOAT16, AI_FMT_FLOAT, 1, 1, 0, 16,  0, 0)
 
 /* Integer formats (i.e. fractional bits = 0!) */
 FMT_ENTRY(1, U8,  AI_FMT_Q, 0, 0, 0, 8,  0, 0)
@@ -66,4 +67,8 @@ FMT_ENTRY(0, LUT8_Q15,   AI_FMT_LUT8, 1, 0, 0, 16, 15, 1)
 FMT_ENTRY(0, LUT4_UQ15,  AI_FMT_LUT4, 0, 0, 0, 16, 15, 2)
 FMT_ENTRY(0, LUT8_UQ15,  AI_FMT_LUT8, 0, 0, 0, 16, 15, 1)
 
+/* Block sparse formats: the elements are the stored (non zero) blocks, the
+ * blocks index is held by the data_start of the array */
+FMT_ENTRY(0, BSR_FLOAT,  AI_FMT_BSR, 1, 1, 0, 32, 0, 0)
+
 #undef FMT_ENTRY
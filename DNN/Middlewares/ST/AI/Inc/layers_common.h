@@ -187,6 +187,20 @@ const char* ai_layer_type_name(const ai_layer_type type);
 AI_INTERNAL_API
 ai_bool ai_layer_type_is_valid(const ai_layer_type type);
 
+/*!
+ * @brief Helper API to get a temporary buffer for the forward of a layer
+ * The first scratch tensor of the layer is used when its array is tagged
+ * @ref AI_FMT_FLAG_SCRATCH_BUFFER and is big enough, the scratch arena of
+ * the network instance otherwise (see @ref core_network_get_scratch).
+ * The content is not kept between two forwards.
+ * @ingroup layers_common
+ * @param layer the layer
+ * @param size the requested size (bytes)
+ * @return the buffer, NULL if none is available
+ */
+AI_INTERNAL_API
+ai_handle ai_layer_get_scratch(ai_layer* layer, const ai_size size);
+
 AI_API_DECLARE_END
 
 #endif /* __LAYERS_COMMON_H_ */
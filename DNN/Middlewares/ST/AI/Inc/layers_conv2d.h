@@ -93,13 +93,111 @@ typedef AI_ALIGNED_TYPE(struct, 4) ai_layer_conv2d_nl_pool_ {
 } ai_layer_conv2d_nl_pool;
 
 
+/*!
+ * @enum ai_conv2d_algo
+ * @ingroup layers_conv2d
+ * @brief algorithms of the float 2D convolution (see @ref forward_conv2d)
+ */
+typedef enum {
+  AI_CONV2D_ALGO_DIRECT = 0,  /*!< direct accumulation over the filter window */
+  AI_CONV2D_ALGO_IM2COL,      /*!< im2col tiles multiplied by the dense kernels */
+  AI_CONV2D_ALGO_WINOGRAD,    /*!< Winograd F(2x2, 3x3), 3x3 stride 1 only */
+  AI_CONV2D_ALGO_DEPTHWISE,   /*!< one filter per channel, vectorized over the channels */
+  AI_CONV2D_ALGO_POINTWISE,   /*!< 1x1 stride 1 not padded: a single GEMM */
+} ai_conv2d_algo;
+
+/*!
+ * @brief max filter positions (kh x kw) of the depthwise algorithm (5x5)
+ * @ingroup layers_conv2d
+ */
+#define AI_CONV2D_DEPTHWISE_MAX_TAPS    (25)
+
+/*!
+ * @brief output channels up to which the direct convolution is used (the
+ * im2col copy is not amortized by the GEMM)
+ * @ingroup layers_conv2d
+ */
+#define AI_CONV2D_DIRECT_MAX_CH         (4)
+
+/*!
+ * @brief input and output channels from which the Winograd convolution is
+ * used (the transforms are amortized by the 16 GEMMs)
+ * @ingroup layers_conv2d
+ */
+#define AI_CONV2D_WINOGRAD_MIN_CH       (8)
+
+/*!
+ * @brief 2x2 output tiles from which the Winograd convolution is used: below,
+ * the transforms cost more than the saved multiplications (x86 measurements,
+ * 3x3 layers of 8 to 512 channels)
+ * @ingroup layers_conv2d
+ */
+#define AI_CONV2D_WINOGRAD_MIN_TILES    (128)
+
+/*!
+ * @brief target size (bytes) of the scratch tiles (im2col columns, Winograd
+ * transformed inputs and outputs): a tile is reused by all the outputs
+ * channels and is expected to stay in the cpu caches
+ * @ingroup layers_conv2d
+ */
+#ifndef AI_CONV2D_TILE_SIZE
+#define AI_CONV2D_TILE_SIZE             (64*1024)
+#endif
+
+/*!
+ * @brief min rows of a scratch tile (the weights are read once per tile)
+ * @ingroup layers_conv2d
+ */
+#ifndef AI_CONV2D_TILE_MIN_ROWS
+#define AI_CONV2D_TILE_MIN_ROWS         (16)
+#endif
+
+
+/*!
+ * @brief dot product of a float vector with a codebook compressed vector
+ * (LUT8_FLOAT format: 8 bits indices in a 256 entries float table)
+ * @ingroup layers_conv2d
+ * @param out float accumulator, the dot product is added to it
+ * @param data0 the indices of the compressed vector
+ * @param lut the float table
+ * @param data1 the float vector
+ * @param data_size the size of both vectors
+ */
 AI_INTERNAL_API
 void ai_dict8_dot_array_f32(ai_handle out, ai_ptr_const data0, ai_ptr_const lut,
                             const ai_float* data1, const ai_size data_size);
 
+/*!
+ * @brief dot product of a float vector with a codebook compressed vector
+ * (LUT4_FLOAT format: 4 bits indices, two per byte with the first one in the
+ * high nibble, in a 16 entries float table)
+ * @ingroup layers_conv2d
+ * @param out float accumulator, the dot product is added to it
+ * @param data0 the indices of the compressed vector
+ * @param lut the float table
+ * @param data1 the float vector
+ * @param data_size the size of both vectors
+ */
 AI_INTERNAL_API
 void ai_dict4_dot_array_f32(ai_handle out, ai_ptr_const data0, ai_ptr_const lut,
-                            const ai_float* data1, const ai_size data_size);/******************************************************************************/
+                            const ai_float* data1, const ai_size data_size);
+
+/*!
+ * @brief Select the algorithm of a float 2D convolutional layer.
+ * @ingroup layers_conv2d
+ * The depthwise convolutions (one filter of up to
+ * AI_CONV2D_DEPTHWISE_MAX_TAPS positions per channel) and the pointwise ones
+ * (1x1, stride 1, not padded) have dedicated kernels. The other grouped
+ * convolutions and the ones with few output channels are direct, the 3x3
+ * stride 1 (not dilated) ones with enough channels use Winograd
+ * F(2x2, 3x3), the other ones im2col + GEMM.
+ * @param layer the convolutional (conv) layer
+ * @return the selected algorithm
+ */
+AI_INTERNAL_API
+ai_conv2d_algo conv2d_algo_select(const ai_layer_conv2d* layer);
+
+/******************************************************************************/
 /*  Forward Functions Section                                                 */
 /******************************************************************************/
 
@@ -115,12 +213,47 @@ void forward_conv2d(ai_layer* layer);
  * @brief Computes the activations of a @ref ai_layer_conv2d_nl_pool layer
  * The @ref ai_layer_conv2d_nl_pool is a fused conv2D + optional nonlinear
  * layer + optional pooling / nonlinearity (average, max, softmax)
+ * @details float version: the convolution rows are computed by bands kept
+ * in the cpu caches and reduced into the pooled outputs as they are
+ * produced, the convolution outputs are never stored as a whole
+ * (pool_func_mp_array_f32 and pool_func_ap_array_f32, any other pooling
+ * function is called on the full convolution outputs). filter_pad holds
+ * the (x, y) padding of the first row/column followed by the (x, y) padding
+ * of the last ones (same as the first ones if absent), pool_pad the (x, y)
+ * padding of the first pooled row/column.
  * @ingroup layers_conv2d
  * @param layer see @ai_layer_conv2d_nl_pool
  */
 AI_INTERNAL_API
 void forward_conv2d_nl_pool(ai_layer* layer);
 
+/*!
+ * @brief check if a float depthwise convolution followed by a float
+ * pointwise convolution can be executed by @ref forward_conv2d_dw_pw
+ * @ingroup layers_conv2d
+ * @param dw the depthwise convolution (one filter per channel)
+ * @param pw the pointwise convolution (1x1, stride 1, not padded) reading
+ * the outputs of dw
+ * @return true if the pair can be fused
+ */
+AI_INTERNAL_API
+ai_bool conv2d_dw_pw_is_fusable(const ai_layer_conv2d* dw,
+                                const ai_layer_conv2d* pw);
+
+/*!
+ * @brief Computes the activations of a fused depthwise -> pointwise float
+ * convolutions pair
+ * @details layer is the depthwise layer, its tensor chain holding the
+ * output of the pointwise one; the pointwise layer is the node fused into it
+ * (see @ref core_graph_get_fused). The depthwise outputs (nonlinearity
+ * applied) are computed by bands of rows kept in the cpu caches and
+ * multiplied by the pointwise weights, they are never stored as a whole.
+ * @ingroup layers_conv2d
+ * @param layer the depthwise layer
+ */
+AI_INTERNAL_API
+void forward_conv2d_dw_pw(ai_layer* layer);
+
 /*!
  * @brief Computes the activations of a GEMM layer.
  * @ingroup layers
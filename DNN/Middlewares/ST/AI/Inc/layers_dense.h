@@ -49,8 +49,583 @@
  *
  */
 
+/*!
+ * @typedef (*func_dense_f32)
+ * @ingroup layers_dense
+ * @brief Function pointer for the float dense (GEMM) kernels
+ * computes out[r][o] = bias[o] + sum_i(in[r][i] * weights[o][i]) for the
+ * n_rows input rows. The weights are stored row-major as [n_out][n_in] and
+ * bias can be NULL.
+ */
+typedef void (*func_dense_f32)(ai_float* out, const ai_float* in,
+                               const ai_float* weights, const ai_float* bias,
+                               const ai_size n_rows, const ai_size n_in,
+                               const ai_size n_out);
+
+/*!
+ * @struct ai_dense_kernel_f32
+ * @ingroup layers_dense
+ * @brief entry of the float dense kernels dispatch table
+ */
+typedef struct ai_dense_kernel_f32_ {
+  const char*     name;      /*!< kernel name (for reports) */
+  ai_u32          features;  /*!< required cpu features (see core_cpu.h) */
+  func_dense_f32  func;      /*!< kernel implementation */
+} ai_dense_kernel_f32;
+
+/*!
+ * @typedef (*func_dense_f16)
+ * @ingroup layers_dense
+ * @brief Function pointer for the float dense kernels with half precision
+ * weights (FLOAT16 format): same computation as @ref func_dense_f32, the
+ * weights being converted to float on the fly
+ */
+typedef void (*func_dense_f16)(ai_float* out, const ai_float* in,
+                               const ai_u16* weights, const ai_float* bias,
+                               const ai_size n_rows, const ai_size n_in,
+                               const ai_size n_out);
+
+/*!
+ * @struct ai_dense_kernel_f16
+ * @ingroup layers_dense
+ * @brief entry of the half precision weights dense kernels dispatch table
+ */
+typedef struct ai_dense_kernel_f16_ {
+  const char*     name;      /*!< kernel name (for reports) */
+  ai_u32          features;  /*!< required cpu features (see core_cpu.h) */
+  func_dense_f16  func;      /*!< kernel implementation */
+} ai_dense_kernel_f16;
+
+/*!
+ * @brief size in bytes of a weights row of n_in 4 bits indices (LUT4
+ * formats): the rows are padded to a byte boundary, the first index of a
+ * pair being stored in the high nibble
+ * @ingroup layers_dense
+ */
+#define AI_DENSE_LUT4_ROW_SIZE(n_in_)   (((n_in_) + 1) >> 1)
+
+/*!
+ * @typedef (*func_dense_lut)
+ * @ingroup layers_dense
+ * @brief Function pointer for the float dense kernels with codebook
+ * compressed weights (LUT8_FLOAT / LUT4_FLOAT formats): same computation as
+ * @ref func_dense_f32, the weights [o][i] being lut[indices[o][i]]. The
+ * LUT8 rows are n_in bytes, the LUT4 rows @ref AI_DENSE_LUT4_ROW_SIZE bytes.
+ */
+typedef void (*func_dense_lut)(ai_float* out, const ai_float* in,
+                               const ai_u8* indices, const ai_float* lut,
+                               const ai_float* bias, const ai_size n_rows,
+                               const ai_size n_in, const ai_size n_out);
+
+/*!
+ * @struct ai_dense_kernel_lut
+ * @ingroup layers_dense
+ * @brief entry of the codebook compressed weights dense kernels dispatch
+ * table, one implementation per index size
+ */
+typedef struct ai_dense_kernel_lut_ {
+  const char*     name;      /*!< kernel name (for reports) */
+  ai_u32          features;  /*!< required cpu features (see core_cpu.h) */
+  func_dense_lut  lut8;      /*!< 256 entries LUT, 8 bits indices */
+  func_dense_lut  lut4;      /*!< 16 entries LUT, 4 bits indices */
+} ai_dense_kernel_lut;
+
+/*!
+ * @brief size in bytes of a weights row of n_in packed 4 bits integers (S4 /
+ * U4 formats), laid out as the LUT4 indices (two per byte, first one in the
+ * high nibble, rows padded to a byte boundary)
+ * @ingroup layers_dense
+ */
+#define AI_DENSE_Q4_ROW_SIZE(n_in_)     AI_DENSE_LUT4_ROW_SIZE(n_in_)
+
+/*!
+ * @typedef (*func_dense_dot_q4)
+ * @ingroup layers_dense
+ * @brief Function pointer for the int8 x int4 dot products of the integer
+ * dense layers with packed 4 bits weights: returns
+ * sum_i((in[i] - zp_in) * (w[i] - zp_w)) in int32, w[i] being the nibble i
+ * of a weights row of @ref AI_DENSE_Q4_ROW_SIZE bytes. The S4 nibbles are
+ * sign extended (zp_w is ignored), the U4 ones are in [0, 15]. The nibbles
+ * are unpacked in registers, no int8 copy of the weights is made.
+ */
+typedef ai_i32 (*func_dense_dot_q4)(const ai_i8* in, const ai_u8* weights,
+                                    const ai_i32 zp_in, const ai_i32 zp_w,
+                                    const ai_size n_in);
+
+/*!
+ * @struct ai_dense_kernel_q4
+ * @ingroup layers_dense
+ * @brief entry of the packed 4 bits weights dot kernels dispatch table, one
+ * implementation per signedness
+ */
+typedef struct ai_dense_kernel_q4_ {
+  const char*        name;      /*!< kernel name (for reports) */
+  ai_u32             features;  /*!< required cpu features (see core_cpu.h) */
+  func_dense_dot_q4  s4;        /*!< signed symmetric weights (S4) */
+  func_dense_dot_q4  u4;        /*!< unsigned weights with zero point (U4) */
+} ai_dense_kernel_q4;
+
+/*!
+ * @brief block size of the block sparse weights (BSR_FLOAT format): a block
+ * holds the weights of AI_DENSE_BSR_BLOCK consecutive outputs for one input
+ * @ingroup layers_dense
+ */
+#define AI_DENSE_BSR_BLOCK              (8)
+
+/*!
+ * @brief number of blocks rows (groups of AI_DENSE_BSR_BLOCK outputs) of the
+ * block sparse weights of n_out outputs, the last one zero padded
+ * @ingroup layers_dense
+ */
+#define AI_DENSE_BSR_GROUPS(n_out_) \
+  (((n_out_) + AI_DENSE_BSR_BLOCK - 1) / AI_DENSE_BSR_BLOCK)
+
+/*!
+ * @typedef (*func_dense_bsr)
+ * @ingroup layers_dense
+ * @brief Function pointer for the float dense kernels with block sparse
+ * weights (BSR_FLOAT format): same computation as @ref func_dense_f32, only
+ * the stored (non zero) blocks being multiplied. The index (ai_u32 words,
+ * data_start of the weights array) is the offsets of the first block of each
+ * blocks row (AI_DENSE_BSR_GROUPS(n_out) + 1 entries, the last one is the
+ * number of blocks) followed by the input column of each block. The values
+ * (data of the weights array) are AI_DENSE_BSR_BLOCK floats per block:
+ * values[k][j] is weights[g*AI_DENSE_BSR_BLOCK + j][column[k]] for a block k
+ * of the row g.
+ */
+typedef void (*func_dense_bsr)(ai_float* out, const ai_float* in,
+                               const ai_float* values, const ai_u32* index,
+                               const ai_float* bias, const ai_size n_rows,
+                               const ai_size n_in, const ai_size n_out);
+
+/*!
+ * @struct ai_dense_kernel_bsr
+ * @ingroup layers_dense
+ * @brief entry of the block sparse weights dense kernels dispatch table
+ */
+typedef struct ai_dense_kernel_bsr_ {
+  const char*     name;      /*!< kernel name (for reports) */
+  ai_u32          features;  /*!< required cpu features (see core_cpu.h) */
+  func_dense_bsr  func;      /*!< kernel implementation */
+} ai_dense_kernel_bsr;
+
+/*!
+ * @typedef (*func_dense_gemm)
+ * @ingroup layers_dense
+ * @brief Function pointer for the float GEMM kernels with transposed
+ * weights: computes out[r][o] = bias[o] + sum_i(in[r][i] * weights[i][o])
+ * for the n_rows input rows, the weights being stored as [n_in][n_out]
+ * (bias can be NULL). The outputs are accumulated by blocks of rows and
+ * columns held in registers (no horizontal reduction), which suits the
+ * short n_in of the convolutions GEMMs (see @ref forward_conv2d).
+ */
+typedef void (*func_dense_gemm)(ai_float* out, const ai_float* in,
+                                const ai_float* weights, const ai_float* bias,
+                                const ai_size n_rows, const ai_size n_in,
+                                const ai_size n_out);
+
+/*!
+ * @struct ai_dense_kernel_gemm
+ * @ingroup layers_dense
+ * @brief entry of the transposed weights GEMM kernels dispatch table
+ */
+typedef struct ai_dense_kernel_gemm_ {
+  const char*     name;      /*!< kernel name (for reports) */
+  ai_u32          features;  /*!< required cpu features (see core_cpu.h) */
+  func_dense_gemm func;      /*!< kernel implementation */
+} ai_dense_kernel_gemm;
+
+/*!
+ * @typedef (*func_dense_dot_s8)
+ * @ingroup layers_dense
+ * @brief Function pointer for the int8 x int8 dot products of the integer
+ * layers with int8 weights (dense, pointwise convolutions): returns
+ * sum_i((in[i] - zp_in) * w[i]) in int32 (exact).
+ */
+typedef ai_i32 (*func_dense_dot_s8)(const ai_i8* in, const ai_i8* weights,
+                                    const ai_i32 zp_in, const ai_size n_in);
+
+/*!
+ * @struct ai_dense_kernel_s8
+ * @ingroup layers_dense
+ * @brief entry of the int8 weights dot kernels dispatch table
+ */
+typedef struct ai_dense_kernel_s8_ {
+  const char*        name;      /*!< kernel name (for reports) */
+  ai_u32             features;  /*!< required cpu features (see core_cpu.h) */
+  func_dense_dot_s8  func;      /*!< kernel implementation */
+} ai_dense_kernel_s8;
+
 AI_API_DECLARE_BEGIN
 
+/*!
+ * @brief Select the float dense kernel matching the running cpu.
+ * @ingroup layers_dense
+ * The dispatch table is walked once, from the widest to the generic kernel,
+ * and the first kernel supported by the cpu is kept for the next calls.
+ * @return the selected kernel entry
+ */
+AI_INTERNAL_API
+const ai_dense_kernel_f32* dense_kernel_f32_init(void);
+
+/*!
+ * @brief Get the float dense kernel in use.
+ * @ingroup layers_dense
+ * @return the selected kernel entry (selecting it if not done yet)
+ */
+AI_INTERNAL_API
+const ai_dense_kernel_f32* dense_kernel_f32_get(void);
+
+/*!
+ * @brief Select the half precision weights dense kernel matching the running
+ * cpu (see @ref dense_kernel_f32_init).
+ * @ingroup layers_dense
+ * @return the selected kernel entry
+ */
+AI_INTERNAL_API
+const ai_dense_kernel_f16* dense_kernel_f16_init(void);
+
+/*!
+ * @brief Get the half precision weights dense kernel in use.
+ * @ingroup layers_dense
+ * @return the selected kernel entry (selecting it if not done yet)
+ */
+AI_INTERNAL_API
+const ai_dense_kernel_f16* dense_kernel_f16_get(void);
+
+/*!
+ * @brief Select the codebook compressed weights dense kernels matching the
+ * running cpu (see @ref dense_kernel_f32_init).
+ * @ingroup layers_dense
+ * @return the selected kernel entry
+ */
+AI_INTERNAL_API
+const ai_dense_kernel_lut* dense_kernel_lut_init(void);
+
+/*!
+ * @brief Get the codebook compressed weights dense kernels in use.
+ * @ingroup layers_dense
+ * @return the selected kernel entry (selecting it if not done yet)
+ */
+AI_INTERNAL_API
+const ai_dense_kernel_lut* dense_kernel_lut_get(void);
+
+/*!
+ * @brief Select the packed 4 bits weights dot kernels matching the running
+ * cpu (see @ref dense_kernel_f32_init).
+ * @ingroup layers_dense
+ * @return the selected kernel entry
+ */
+AI_INTERNAL_API
+const ai_dense_kernel_q4* dense_kernel_q4_init(void);
+
+/*!
+ * @brief Get the packed 4 bits weights dot kernels in use.
+ * @ingroup layers_dense
+ * @return the selected kernel entry (selecting it if not done yet)
+ */
+AI_INTERNAL_API
+const ai_dense_kernel_q4* dense_kernel_q4_get(void);
+
+/*!
+ * @brief Select the block sparse weights dense kernel matching the running
+ * cpu (see @ref dense_kernel_f32_init).
+ * @ingroup layers_dense
+ * @return the selected kernel entry
+ */
+AI_INTERNAL_API
+const ai_dense_kernel_bsr* dense_kernel_bsr_init(void);
+
+/*!
+ * @brief Get the block sparse weights dense kernel in use.
+ * @ingroup layers_dense
+ * @return the selected kernel entry (selecting it if not done yet)
+ */
+AI_INTERNAL_API
+const ai_dense_kernel_bsr* dense_kernel_bsr_get(void);
+
+/*!
+ * @brief Select the transposed weights GEMM kernel matching the running cpu
+ * (see @ref dense_kernel_f32_init).
+ * @ingroup layers_dense
+ * @return the selected kernel entry
+ */
+AI_INTERNAL_API
+const ai_dense_kernel_gemm* dense_kernel_gemm_init(void);
+
+/*!
+ * @brief Get the transposed weights GEMM kernel in use.
+ * @ingroup layers_dense
+ * @return the selected kernel entry (selecting it if not done yet)
+ */
+AI_INTERNAL_API
+const ai_dense_kernel_gemm* dense_kernel_gemm_get(void);
+
+/*!
+ * @brief Select the int8 weights dot kernel matching the running cpu
+ * (see @ref dense_kernel_f32_init).
+ * @ingroup layers_dense
+ * @return the selected kernel entry
+ */
+AI_INTERNAL_API
+const ai_dense_kernel_s8* dense_kernel_s8_init(void);
+
+/*!
+ * @brief Get the int8 weights dot kernel in use.
+ * @ingroup layers_dense
+ * @return the selected kernel entry (selecting it if not done yet)
+ */
+AI_INTERNAL_API
+const ai_dense_kernel_s8* dense_kernel_s8_get(void);
+
+/*!
+ * @brief Generic float dense kernel, based on @ref AI_MATH_DOT_ARRAY.
+ * @ingroup layers_dense
+ */
+AI_INTERNAL_API
+void func_dense_f32_generic(ai_float* out, const ai_float* in,
+                            const ai_float* weights, const ai_float* bias,
+                            const ai_size n_rows, const ai_size n_in,
+                            const ai_size n_out);
+
+/*!
+ * @brief Generic dense kernel with half precision weights.
+ * @ingroup layers_dense
+ */
+AI_INTERNAL_API
+void func_dense_f16_generic(ai_float* out, const ai_float* in,
+                            const ai_u16* weights, const ai_float* bias,
+                            const ai_size n_rows, const ai_size n_in,
+                            const ai_size n_out);
+
+/*!
+ * @brief Generic dense kernels with LUT8 / LUT4 weights, based on
+ * @ref ai_dict8_dot_array_f32 and @ref ai_dict4_dot_array_f32.
+ * @ingroup layers_dense
+ */
+AI_INTERNAL_API
+void func_dense_lut8_generic(ai_float* out, const ai_float* in,
+                             const ai_u8* indices, const ai_float* lut,
+                             const ai_float* bias, const ai_size n_rows,
+                             const ai_size n_in, const ai_size n_out);
+
+AI_INTERNAL_API
+void func_dense_lut4_generic(ai_float* out, const ai_float* in,
+                             const ai_u8* indices, const ai_float* lut,
+                             const ai_float* bias, const ai_size n_rows,
+                             const ai_size n_in, const ai_size n_out);
+
+/*!
+ * @brief Generic int8 x int4 dot products with S4 / U4 weights.
+ * @ingroup layers_dense
+ */
+AI_INTERNAL_API
+ai_i32 func_dense_dot_s4_generic(const ai_i8* in, const ai_u8* weights,
+                                 const ai_i32 zp_in, const ai_i32 zp_w,
+                                 const ai_size n_in);
+
+AI_INTERNAL_API
+ai_i32 func_dense_dot_u4_generic(const ai_i8* in, const ai_u8* weights,
+                                 const ai_i32 zp_in, const ai_i32 zp_w,
+                                 const ai_size n_in);
+
+/*!
+ * @brief Generic dense kernel with block sparse weights.
+ * @ingroup layers_dense
+ */
+AI_INTERNAL_API
+void func_dense_bsr_generic(ai_float* out, const ai_float* in,
+                            const ai_float* values, const ai_u32* index,
+                            const ai_float* bias, const ai_size n_rows,
+                            const ai_size n_in, const ai_size n_out);
+
+/*!
+ * @brief Generic GEMM kernel with transposed weights.
+ * @ingroup layers_dense
+ */
+AI_INTERNAL_API
+void func_dense_gemm_generic(ai_float* out, const ai_float* in,
+                             const ai_float* weights, const ai_float* bias,
+                             const ai_size n_rows, const ai_size n_in,
+                             const ai_size n_out);
+
+/*!
+ * @brief Generic int8 x int8 dot product.
+ * @ingroup layers_dense
+ */
+AI_INTERNAL_API
+ai_i32 func_dense_dot_s8_generic(const ai_i8* in, const ai_i8* weights,
+                                 const ai_i32 zp_in, const ai_size n_in);
+
+#if defined(__x86_64__) || defined(__i386__)
+/*!
+ * @brief AVX2 + FMA float dense kernel (8 lanes, 4 outputs per pass).
+ * @ingroup layers_dense
+ */
+AI_INTERNAL_API
+void func_dense_f32_avx2(ai_float* out, const ai_float* in,
+                         const ai_float* weights, const ai_float* bias,
+                         const ai_size n_rows, const ai_size n_in,
+                         const ai_size n_out);
+
+/*!
+ * @brief AVX-512F float dense kernel (16 lanes, masked tails).
+ * @ingroup layers_dense
+ */
+AI_INTERNAL_API
+void func_dense_f32_avx512(ai_float* out, const ai_float* in,
+                           const ai_float* weights, const ai_float* bias,
+                           const ai_size n_rows, const ai_size n_in,
+                           const ai_size n_out);
+
+/*!
+ * @brief AVX2 + FMA + F16C dense kernel with half precision weights.
+ * @ingroup layers_dense
+ */
+AI_INTERNAL_API
+void func_dense_f16_f16c(ai_float* out, const ai_float* in,
+                         const ai_u16* weights, const ai_float* bias,
+                         const ai_size n_rows, const ai_size n_in,
+                         const ai_size n_out);
+
+/*!
+ * @brief AVX-512F dense kernel with half precision weights.
+ * @ingroup layers_dense
+ */
+AI_INTERNAL_API
+void func_dense_f16_avx512(ai_float* out, const ai_float* in,
+                           const ai_u16* weights, const ai_float* bias,
+                           const ai_size n_rows, const ai_size n_in,
+                           const ai_size n_out);
+
+/*!
+ * @brief AVX2 + FMA dense kernels with LUT8 / LUT4 weights: 8 bits indices
+ * gathered from the table, 4 bits indices looked up with two in-register
+ * permutes of the 16 entries.
+ * @ingroup layers_dense
+ */
+AI_INTERNAL_API
+void func_dense_lut8_avx2(ai_float* out, const ai_float* in,
+                          const ai_u8* indices, const ai_float* lut,
+                          const ai_float* bias, const ai_size n_rows,
+                          const ai_size n_in, const ai_size n_out);
+
+AI_INTERNAL_API
+void func_dense_lut4_avx2(ai_float* out, const ai_float* in,
+                          const ai_u8* indices, const ai_float* lut,
+                          const ai_float* bias, const ai_size n_rows,
+                          const ai_size n_in, const ai_size n_out);
+
+/*!
+ * @brief AVX-512F dense kernels with LUT8 / LUT4 weights: 8 bits indices
+ * gathered from the table, the 16 entries of a LUT4 table held in a single
+ * register (one permute per 16 weights).
+ * @ingroup layers_dense
+ */
+AI_INTERNAL_API
+void func_dense_lut8_avx512(ai_float* out, const ai_float* in,
+                            const ai_u8* indices, const ai_float* lut,
+                            const ai_float* bias, const ai_size n_rows,
+                            const ai_size n_in, const ai_size n_out);
+
+AI_INTERNAL_API
+void func_dense_lut4_avx512(ai_float* out, const ai_float* in,
+                            const ai_u8* indices, const ai_float* lut,
+                            const ai_float* bias, const ai_size n_rows,
+                            const ai_size n_in, const ai_size n_out);
+
+/*!
+ * @brief AVX2 int8 x int4 dot products with S4 / U4 weights: 32 nibbles
+ * split with shifts and masks, widened to int16 and accumulated with vpmaddwd.
+ * @ingroup layers_dense
+ */
+AI_INTERNAL_API
+ai_i32 func_dense_dot_s4_avx2(const ai_i8* in, const ai_u8* weights,
+                              const ai_i32 zp_in, const ai_i32 zp_w,
+                              const ai_size n_in);
+
+AI_INTERNAL_API
+ai_i32 func_dense_dot_u4_avx2(const ai_i8* in, const ai_u8* weights,
+                              const ai_i32 zp_in, const ai_i32 zp_w,
+                              const ai_size n_in);
+
+/*!
+ * @brief AVX-512BW int8 x int4 dot products with S4 / U4 weights (32 int16
+ * lanes per vpmaddwd).
+ * @ingroup layers_dense
+ */
+AI_INTERNAL_API
+ai_i32 func_dense_dot_s4_avx512(const ai_i8* in, const ai_u8* weights,
+                                const ai_i32 zp_in, const ai_i32 zp_w,
+                                const ai_size n_in);
+
+AI_INTERNAL_API
+ai_i32 func_dense_dot_u4_avx512(const ai_i8* in, const ai_u8* weights,
+                                const ai_i32 zp_in, const ai_i32 zp_w,
+                                const ai_size n_in);
+
+/*!
+ * @brief AVX2 + FMA dense kernel with block sparse weights: a block row in
+ * a register, the input of each block broadcast.
+ * @ingroup layers_dense
+ */
+AI_INTERNAL_API
+void func_dense_bsr_avx2(ai_float* out, const ai_float* in,
+                         const ai_float* values, const ai_u32* index,
+                         const ai_float* bias, const ai_size n_rows,
+                         const ai_size n_in, const ai_size n_out);
+
+/*!
+ * @brief AVX-512F dense kernel with block sparse weights: two input rows per
+ * pass, sharing the blocks loads.
+ * @ingroup layers_dense
+ */
+AI_INTERNAL_API
+void func_dense_bsr_avx512(ai_float* out, const ai_float* in,
+                           const ai_float* values, const ai_u32* index,
+                           const ai_float* bias, const ai_size n_rows,
+                           const ai_size n_in, const ai_size n_out);
+
+/*!
+ * @brief AVX2 + FMA GEMM kernel with transposed weights: blocks of 4 rows x
+ * 16 outputs accumulated in registers.
+ * @ingroup layers_dense
+ */
+AI_INTERNAL_API
+void func_dense_gemm_avx2(ai_float* out, const ai_float* in,
+                          const ai_float* weights, const ai_float* bias,
+                          const ai_size n_rows, const ai_size n_in,
+                          const ai_size n_out);
+
+/*!
+ * @brief AVX-512F GEMM kernel with transposed weights: blocks of 4 rows x
+ * 32 outputs accumulated in registers.
+ * @ingroup layers_dense
+ */
+AI_INTERNAL_API
+void func_dense_gemm_avx512(ai_float* out, const ai_float* in,
+                            const ai_float* weights, const ai_float* bias,
+                            const ai_size n_rows, const ai_size n_in,
+                            const ai_size n_out);
+
+/*!
+ * @brief AVX2 int8 x int8 dot product: 32 int8 pairs widened to int16 and
+ * accumulated with vpmaddwd.
+ * @ingroup layers_dense
+ */
+AI_INTERNAL_API
+ai_i32 func_dense_dot_s8_avx2(const ai_i8* in, const ai_i8* weights,
+                              const ai_i32 zp_in, const ai_size n_in);
+
+/*!
+ * @brief AVX-512BW int8 x int8 dot product (32 int8 pairs per pass).
+ * @ingroup layers_dense
+ */
+AI_INTERNAL_API
+ai_i32 func_dense_dot_s8_avx512(const ai_i8* in, const ai_i8* weights,
+                                const ai_i32 zp_in, const ai_size n_in);
+#endif
+
 /*!
  * @brief Computes the activations of a fixed point dense (fully connected) layer.
  * @ingroup layers_dense
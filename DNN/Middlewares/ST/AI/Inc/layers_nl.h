@@ -29,6 +29,13 @@
  *
  */
 
+/*!
+ * @brief values of the exp(x) stack buffer of the float nonlinearities
+ * combining x and exp(x) (elu, selu, soft_plus)
+ * @ingroup layers_nl
+ */
+#define AI_NL_EXP_CHUNK               (64)
+
 AI_API_DECLARE_BEGIN
 
 /*!
@@ -47,6 +47,20 @@ typedef AI_ALIGNED_TYPE(struct, 4) ai_layer_pool_ {
   ai_u8       count_include_pad;    /*!< include pad flag */
 } ai_layer_pool;
 
+/*!
+ * @brief max window positions (kx x ky) reduced in registers in a single
+ * pass per block of channels (the 2x2 and 3x3 pools)
+ * @ingroup layers_pool
+ */
+#define AI_POOL_WINDOW_MAX_REG        (9)
+
+/*!
+ * @brief channels of the int32 accumulators of the 8-bits integer pooling
+ * of the larger windows (stack buffer)
+ * @ingroup layers_pool
+ */
+#define AI_POOL_ACC_CHUNK             (256)
+
 
 /*!
  * @typedef (*func_pool)
@@ -95,7 +109,7 @@ void pool_func_mp_array_f32(ai_handle in,
 /*!
  * @brief Max Pooling on a 8/16 bits fixed point data array
  * @ingroup layers_pool
- * @param in  opaque handler to input data to process
+ * @param in  the input array (ai_array*), its format selects the kernel
  * @param dim_im_in_x  input feature map width
  * @param dim_im_in_y  input feature map height
  * @param ch_im_in  number of input channels
@@ -107,7 +121,7 @@ void pool_func_mp_array_f32(ai_handle in,
  * @param stride_y  stride value on y dimension
  * @param dim_im_out_x  output feature map width
  * @param dim_im_out_y  output feature map height
- * @param out opaque handler to output data
+ * @param out the output array (ai_array*)
  */
 AI_INTERNAL_API
 void pool_func_mp_array_fixed(ai_handle in,
@@ -122,7 +136,7 @@ void pool_func_mp_array_fixed(ai_handle in,
 /*!
  * @brief Max Pooling on a 8-bits integer quantized data array
  * @ingroup layers_pool
- * @param in  opaque handler to input data to process
+ * @param in  the input array (ai_array*), its format selects the kernel
  * @param dim_im_in_x  input feature map width
  * @param dim_im_in_y  input feature map height
  * @param ch_im_in  number of input channels
@@ -134,7 +148,7 @@ void pool_func_mp_array_fixed(ai_handle in,
  * @param stride_y  stride value on y dimension
  * @param dim_im_out_x  output feature map width
  * @param dim_im_out_y  output feature map height
- * @param out opaque handler to output data
+ * @param out the output array (ai_array*)
  */
 AI_INTERNAL_API
 void pool_func_mp_array_integer(ai_handle in,
@@ -231,7 +245,7 @@ void pool_func_ap_array_f32(ai_handle in,
 /*!
  * @brief Average Pooling on a 8/16 bits fixed point data array
  * @ingroup layers_pool
- * @param in  opaque handler to input data to process
+ * @param in  the input array (ai_array*), its format selects the kernel
  * @param dim_im_in_x  input feature map width
  * @param dim_im_in_y  input feature map height
  * @param ch_im_in  number of input channels
@@ -243,7 +257,7 @@ void pool_func_ap_array_f32(ai_handle in,
  * @param stride_y  stride value on y dimension
  * @param dim_im_out_x  output feature map width
  * @param dim_im_out_y  output feature map height
- * @param out opaque handler to scratch memory
+ * @param out the output array (ai_array*)
  */
 AI_INTERNAL_API
 void pool_func_ap_array_fixed(ai_handle in,
@@ -258,7 +272,7 @@ void pool_func_ap_array_fixed(ai_handle in,
  /*!
  * @brief Average Pooling on a 8-bits integer quantized data array
  * @ingroup layers_pool
- * @param in  opaque handler to input data to process
+ * @param in  the input array (ai_array*), its format selects the kernel
  * @param dim_im_in_x  input feature map width
  * @param dim_im_in_y  input feature map height
  * @param ch_im_in  number of input channels
@@ -270,7 +284,7 @@ void pool_func_ap_array_fixed(ai_handle in,
  * @param stride_y  stride value on y dimension
  * @param dim_im_out_x  output feature map width
  * @param dim_im_out_y  output feature map height
- * @param out opaque handler to scratch memory
+ * @param out the output array (ai_array*)
  */
 AI_INTERNAL_API
 void pool_func_ap_array_integer(ai_handle in,
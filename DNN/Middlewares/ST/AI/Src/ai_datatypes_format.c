@@ -0,0 +1,193 @@
+/**
+  ******************************************************************************
+  * @file    ai_datatypes_format.c
+  * @brief   implementation of ai_array and ai_buffer format helpers
+  ******************************************************************************
+  * @attention
+  *
+  * Open implementation of the format APIs declared in ai_datatypes_format.h.
+  * The format tables are generated from formats_list.h, so adding a new
+  * FMT_ENTRY() there is enough to make it known to the helpers below.
+  *
+  ******************************************************************************
+  */
+
+#include "ai_datatypes_format.h"
+#include "core_common.h"
+
+/* flags shared by the ai_array and ai_buffer format representations */
+#define AI_FMT_FLAGS_EXPORTED \
+  (AI_FMT_FLAG_CONST | AI_FMT_FLAG_STATIC | AI_FMT_FLAG_IS_IO)
+
+/*!
+ * @brief number of elements of the lookup table of a compressed format
+ */
+#define AI_FMT_LUT_ENTRIES(fmt_) \
+  ( (AI_FMT_GET_TYPE(fmt_)==AI_FMT_LUT4) ? 16 : \
+    ((AI_FMT_GET_TYPE(fmt_)==AI_FMT_LUT8) ? 256 : 0) )
+
+/*!
+ * @brief number of bits used to store a single element of the data array
+ * (LUT index size for compressed formats)
+ */
+#define AI_FMT_GET_ELEM_BITS(fmt_) \
+  ( (ai_size)AI_FMT_GET_BITS_SIZE(fmt_) >> AI_FMT_GET_LDIV(fmt_) )
+
+/******************************************************************************/
+AI_STATIC_CONST ai_array_format g_array_formats[] = {
+#define FMT_ENTRY(exp_, name_, type_id_, sign_bit_, float_bit_, \
+  pbits_, bits_, fbits_, ldiv_bits_) \
+    AI_ARRAY_FMT_ENTRY(name_),
+#include "formats_list.h"
+};
+
+AI_STATIC_CONST ai_bool g_array_formats_exported[] = {
+#define FMT_ENTRY(exp_, name_, type_id_, sign_bit_, float_bit_, \
+  pbits_, bits_, fbits_, ldiv_bits_) \
+    (exp_),
+#include "formats_list.h"
+};
+
+AI_STATIC_CONST char* g_array_formats_names[] = {
+#define FMT_ENTRY(exp_, name_, type_id_, sign_bit_, float_bit_, \
+  pbits_, bits_, fbits_, ldiv_bits_) \
+    AI_STRINGIFY(name_),
+#include "formats_list.h"
+};
+
+AI_STATIC_CONST ai_buffer_format g_buffer_formats[] = {
+#define FMT_ENTRY(exp_, name_, type_id_, sign_bit_, float_bit_, \
+  pbits_, bits_, fbits_, ldiv_bits_) \
+    AI_CONCAT(_FMT_EXPORTED_, exp_)(name_)
+#define _FMT_EXPORTED_0(name_)    /* not exported */
+#define _FMT_EXPORTED_1(name_) \
+    (ai_buffer_format)(AI_ARRAY_FMT_ENTRY(name_)),
+#include "formats_list.h"
+#undef _FMT_EXPORTED_0
+#undef _FMT_EXPORTED_1
+};
+
+/*!
+ * @brief lookup the position of a format in the formats table
+ * @return the index of the format or -1 if the format is not listed
+ */
+AI_DECLARE_STATIC
+ai_i32 ai_array_fmt_lookup(const ai_array_format fmt)
+{
+  const ai_array_format f = AI_FMT_GET(fmt);
+  for ( ai_size i=0; i<AI_C_ARRAY_COUNT(g_array_formats); i++ ) {
+    if ( AI_FMT_GET(g_array_formats[i])==f ) return (ai_i32)i;
+  }
+  /* Qm.n formats are matched against their generic Q / UQ entries */
+  if ( AI_FMT_GET_TYPE(fmt)==AI_FMT_Q ) {
+    const ai_array_format q = AI_FMT_GET(AI_FMT_GET_Q(fmt));
+    for ( ai_size i=0; i<AI_C_ARRAY_COUNT(g_array_formats); i++ ) {
+      if ( AI_FMT_GET(g_array_formats[i])==q ) return (ai_i32)i;
+    }
+  }
+  return -1;
+}
+
+/******************************************************************************/
+AI_INTERNAL_API
+const char* ai_array_fmt_name(const ai_array_format type)
+{
+  const ai_i32 idx = ai_array_fmt_lookup(type);
+  return (idx>=0) ? g_array_formats_names[idx] : "UNDEFINED";
+}
+
+AI_INTERNAL_API
+ai_bool ai_array_fmt_exported(const ai_array_format type)
+{
+  const ai_i32 idx = ai_array_fmt_lookup(type);
+  return (idx>=0) ? g_array_formats_exported[idx] : false;
+}
+
+AI_INTERNAL_API
+ai_bool ai_array_fmt_valid(const ai_array_format type)
+{
+  return (ai_array_fmt_lookup(type)>=0);
+}
+
+AI_INTERNAL_API
+ai_size ai_array_fmt_get_formats(const ai_array_format** formats)
+{
+  if ( formats ) *formats = g_array_formats;
+  return AI_C_ARRAY_COUNT(g_array_formats);
+}
+
+/******************************************************************************/
+AI_INTERNAL_API
+const char* ai_buffer_fmt_name(const ai_buffer_format type)
+{
+  return ai_array_fmt_name(AI_BUFFER_TO_ARRAY_FMT(type));
+}
+
+AI_INTERNAL_API
+ai_bool ai_buffer_fmt_valid(const ai_buffer_format type)
+{
+  const ai_buffer_format f = AI_BUFFER_FMT_GET(type);
+  for ( ai_size i=0; i<AI_C_ARRAY_COUNT(g_buffer_formats); i++ ) {
+    if ( AI_BUFFER_FMT_GET(g_buffer_formats[i])==f ) return true;
+  }
+  return false;
+}
+
+AI_INTERNAL_API
+ai_size ai_buffer_fmt_get_formats(const ai_buffer_format** formats)
+{
+  if ( formats ) *formats = g_buffer_formats;
+  return AI_C_ARRAY_COUNT(g_buffer_formats);
+}
+
+/******************************************************************************/
+AI_INTERNAL_API
+ai_buffer_format ai_array_to_buffer_fmt(const ai_array_format fmt)
+{
+  /* both representations share the same bitfields layout: only the exported
+   * formats are visible through the public ai_buffer APIs */
+  if ( !ai_array_fmt_exported(fmt) ) {
+    return AI_BUFFER_FORMAT_NONE;
+  }
+  return AI_BUFFER_FMT_OBJ( (AI_FMT_GET(fmt) & 0x01FFFFFF) |
+                            (fmt & AI_FMT_FLAGS_EXPORTED) );
+}
+
+AI_INTERNAL_API
+ai_array_format ai_buffer_to_array_fmt(const ai_buffer_format fmt)
+{
+  const ai_array_format f = AI_FMT_OBJ(AI_BUFFER_FMT_GET(fmt));
+  if ( !ai_array_fmt_valid(f) ) {
+    return AI_ARRAY_FORMAT_NONE;
+  }
+  return AI_FMT_OBJ( f | (fmt & AI_FMT_FLAGS_EXPORTED) );
+}
+
+/******************************************************************************/
+AI_INTERNAL_API
+ai_size ai_array_get_data_byte_size(
+  const ai_array_format fmt, const ai_size count)
+{
+  const ai_size bits = AI_FMT_GET_ELEM_BITS(fmt);
+  return (ai_size)((((ai_u64)count * bits) + 7) >> 3);
+}
+
+AI_INTERNAL_API
+ai_size ai_array_get_byte_size(
+  const ai_array_format fmt, const ai_size count)
+{
+  const ai_size lut_size =
+    AI_FMT_LUT_ENTRIES(fmt) * (((ai_size)AI_FMT_GET_BITS_SIZE(fmt) + 7) >> 3);
+  return ai_array_get_data_byte_size(fmt, count) + lut_size;
+}
+
+AI_INTERNAL_API
+ai_size ai_array_get_elems_from_size(
+  const ai_array_format fmt, const ai_size byte_size)
+{
+  const ai_size bits = AI_FMT_GET_ELEM_BITS(fmt);
+  const ai_size lut_size =
+    AI_FMT_LUT_ENTRIES(fmt) * (((ai_size)AI_FMT_GET_BITS_SIZE(fmt) + 7) >> 3);
+  if ( bits==0 || byte_size<lut_size ) return 0;
+  return (ai_size)((((ai_u64)(byte_size - lut_size)) << 3) / bits);
+}
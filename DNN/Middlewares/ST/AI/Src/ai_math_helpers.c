@@ -0,0 +1,117 @@
+/**
+  ******************************************************************************
+  * @file    ai_math_helpers.c
+  * @brief   implementation of the math helpers
+  ******************************************************************************
+  * @attention
+  *
+  * Open implementation of the math helpers declared in ai_math_helpers.h.
+  * On the host the routines are mapped to the C99 float math library.
+  *
+  ******************************************************************************
+  */
+
+#include "ai_math_helpers.h"
+
+/******************************************************************************/
+#if !defined(STM32_DOT_INLINE_OPTIM)
+AI_INTERFACE_ENTRY
+void ai_math_dot_array(
+        ai_float* out,
+        const ai_float* data0,
+        const ai_float* data1,
+        const ai_size data_size)
+{
+  ai_float sum = 0.0f;
+  for ( ai_size i=0; i<data_size; i++ ) {
+    sum += data0[i] * data1[i];
+  }
+  *out += sum;
+}
+#endif /* !STM32_DOT_INLINE_OPTIM */
+
+AI_INTERFACE_ENTRY
+ai_float ai_math_sqrt(const ai_float x)
+{
+  return sqrtf(x);
+}
+
+AI_INTERFACE_ENTRY
+ai_float ai_math_exp(const ai_float x)
+{
+  return AI_MATH_EXP(x);
+}
+
+AI_INTERFACE_ENTRY
+ai_float ai_math_pow(const ai_float x, const ai_float e)
+{
+  return AI_MATH_POW(x, e);
+}
+
+AI_INTERFACE_ENTRY
+ai_float ai_math_tanh(const ai_float x)
+{
+  return AI_MATH_TANH(x);
+}
+
+AI_INTERFACE_ENTRY
+ai_float ai_math_relu(const ai_float x)
+{
+  return AI_MATH_RELU(x);
+}
+
+AI_INTERFACE_ENTRY
+ai_float ai_math_prelu(const ai_float x, const ai_float slope)
+{
+  return AI_MATH_PRELU(x, slope);
+}
+
+AI_INTERFACE_ENTRY
+ai_float ai_math_sigmoid(const ai_float x)
+{
+  return AI_MATH_SIGMOID(x);
+}
+
+AI_INTERFACE_ENTRY
+ai_float ai_math_hard_sigmoid(const ai_float x)
+{
+  /* keras default coefficients */
+  return AI_MATH_HARD_SIGMOID(x, 0.2f, 0.5f);
+}
+
+AI_INTERFACE_ENTRY
+ai_float ai_math_sign(const ai_float x)
+{
+  return (x>0.0f) ? 1.0f : ((x<0.0f) ? -1.0f : 0.0f);
+}
+
+AI_INTERFACE_ENTRY
+ai_float ai_fast_prelu(const ai_float x, const ai_float slope)
+{
+  return AI_MATH_PRELU(x, slope);
+}
+
+/******************************************************************************/
+AI_INTERFACE_ENTRY ai_float ai_div(const ai_float a, const ai_float b)
+{ return a / b; }
+
+AI_INTERFACE_ENTRY ai_float ai_floor_div(const ai_float a, const ai_float b)
+{ return AI_FLOOR_DIV(a, b); }
+
+AI_INTERFACE_ENTRY ai_float ai_floor_mod(const ai_float a, const ai_float b)
+{ return AI_FLOOR_MOD(a, b); }
+
+AI_INTERFACE_ENTRY ai_float ai_max(const ai_float a, const ai_float b)
+{ return AI_MAX(a, b); }
+
+AI_INTERFACE_ENTRY ai_float ai_min(const ai_float a, const ai_float b)
+{ return AI_MIN(a, b); }
+
+AI_INTERFACE_ENTRY ai_float ai_mul(const ai_float a, const ai_float b)
+{ return a * b; }
+
+AI_INTERFACE_ENTRY ai_float ai_sub(const ai_float a, const ai_float b)
+{ return a - b; }
+
+AI_INTERFACE_ENTRY ai_float ai_sum(const ai_float a, const ai_float b)
+{ return a + b; }
@@ -0,0 +1,836 @@
+/**
+  ******************************************************************************
+  * @file    ai_platform_interface.c
+  * @brief   implementation of the platform interface APIs
+  ******************************************************************************
+  * @attention
+  *
+  * Open implementation of the APIs declared in ai_platform_interface.h, used
+  * by the code generated in network.c. It binds the user ai_buffer I/O to the
+  * network I/O tensors, walks the layers graph (see layers.c) once per batch
+  * and implements the observer hooks used by the system performance app.
+  *
+  ******************************************************************************
+  */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "ai_platform_interface.h"
+#include "ai_datatypes_format.h"
+#include "ai_math_helpers.h"
+#include "core_common.h"
+#include "core_graph.h"
+#include "core_network.h"
+#include "core_plan.h"
+#include "layers.h"
+#include "layers_dense.h"
+
+/* runtime version implemented by this library */
+#define AI_PLATFORM_RUNTIME_MAJOR    5
+#define AI_PLATFORM_RUNTIME_MINOR    1
+#define AI_PLATFORM_RUNTIME_MICRO    0
+
+#define AI_PLATFORM_RUNTIME_REVISION \
+  "(rev-" AI_STRINGIFY(AI_PLATFORM_RUNTIME_MAJOR) "." \
+          AI_STRINGIFY(AI_PLATFORM_RUNTIME_MINOR) "." \
+          AI_STRINGIFY(AI_PLATFORM_RUNTIME_MICRO) ")"
+
+/* oldest/newest tools API (code generator) version supported */
+#define AI_TOOLS_API_SUPPORTED_MAJOR      1
+#define AI_TOOLS_API_SUPPORTED_MINOR_MAX  4
+
+/* private network flags (ai_network.flags) */
+#define AI_NETWORK_FLAG_INITIALIZED  (0x1U << 0)
+#define AI_NETWORK_FLAG_IO_BOUND     (0x1U << 1)  /* see ai_platform_network_bind_io */
+#define AI_NETWORK_FLAG_IO_STATIC    (0x1U << 2)  /* bound I/O set once in the tensors */
+
+#define AI_NETWORK_IO_LIST(net_, type_) \
+  GET_TENSOR_LIST(&(net_)->tensors, type_)
+
+/******************************************************************************/
+/*!
+ * @brief count the number of nodes of the network
+ */
+AI_DECLARE_STATIC
+ai_u16 network_get_n_nodes(const ai_network* net)
+{
+  ai_u16 n_nodes = 0;
+  AI_FOR_EACH_NODE_DO(node, net->input_node) {
+    n_nodes++;
+  }
+  return n_nodes;
+}
+
+/*!
+ * @brief get the node at a given position in the execution list
+ */
+AI_DECLARE_STATIC
+ai_node* network_get_node(const ai_network* net, const ai_u16 c_idx)
+{
+  ai_u16 idx = 0;
+  AI_FOR_EACH_NODE_DO(node, net->input_node) {
+    if ( idx==c_idx ) return node;
+    idx++;
+  }
+  return NULL;
+}
+
+/*!
+ * @brief fill the ai_buffer descriptors (and the integer meta info) of an I/O
+ * tensor list
+ */
+AI_DECLARE_STATIC
+void network_io_buffers_init(ai_tensor_list* list)
+{
+  if ( !list || !list->info ) return;
+
+  AI_FOR_EACH_TENSOR_LIST_DO(i, t, list) {
+    const ai_array_format fmt = AI_ARRAY_OBJ_FMT(t->data);
+    ai_buffer* buffer = GET_TENSOR_LIST_BUFFER(list, i);
+    *buffer = (ai_buffer)AI_BUFFER_OBJ_INIT(
+      AI_ARRAY_TO_BUFFER_FMT(fmt),
+      AI_SHAPE_H(&t->shape), AI_SHAPE_W(&t->shape), AI_SHAPE_CH(&t->shape), 1,
+      AI_ARRAY_OBJ_DATA(t->data, void));
+    /* integer I/O: expose the scale/zero point to quantize the user data */
+    if ( AI_HAS_INTQ_INFO_LIST(AI_KLASS_GET_INTQ_INFO_LIST(t)) ) {
+      ai_buffer_meta_info* meta = GET_TENSOR_LIST_META(list, i);
+      meta->flags = AI_BUFFER_META_HAS_INTQ_INFO;
+      meta->intq_info = AI_KLASS_GET_INTQ_INFO_LIST(t);
+      buffer->meta_info = meta;
+    }
+    memset(GET_TENSOR_LIST_STATE(list, i), 0, sizeof(ai_tensor_state));
+  }
+}
+
+/*!
+ * @brief check an user I/O buffer against its network tensor and set up the
+ * tensor state used to iterate on the batches
+ * @return the number of batches of the buffer, 0 if the buffer is invalid
+ */
+AI_DECLARE_STATIC
+ai_u16 network_io_buffer_bind(
+  ai_network* net, const ai_buffer* buffer, const ai_tensor* t,
+  ai_tensor_state* state, const ai_error_type err_type)
+{
+  const ai_buffer_format fmt =
+    AI_ARRAY_TO_BUFFER_FMT(AI_ARRAY_OBJ_FMT(t->data));
+
+  if ( !buffer->data ) {
+    ai_platform_network_set_error(net, err_type, AI_ERROR_CODE_INVALID_PTR);
+    return 0;
+  }
+  if ( AI_BUFFER_FMT_GET(buffer->format)!=AI_BUFFER_FMT_GET(fmt) ) {
+    ai_platform_network_set_error(net, err_type, AI_ERROR_CODE_INVALID_FORMAT);
+    return 0;
+  }
+  if ( (buffer->height!=AI_SHAPE_H(&t->shape)) ||
+       (buffer->width!=AI_SHAPE_W(&t->shape)) ||
+       (buffer->channels!=AI_SHAPE_CH(&t->shape)) ) {
+    ai_platform_network_set_error(net, err_type, AI_ERROR_CODE_INVALID_SIZE);
+    return 0;
+  }
+  if ( buffer->n_batches==0 ) {
+    ai_platform_network_set_error(net, err_type, AI_ERROR_CODE_INVALID_BATCH);
+    return 0;
+  }
+
+  state->stride   = (ai_ptr_offset)AI_ARRAY_GET_BYTE_SIZE(
+    AI_ARRAY_OBJ_FMT(t->data), AI_TENSOR_SIZE(t));
+  state->size     = (ai_size)state->stride * buffer->n_batches;
+  state->curr_ptr = AI_PTR(buffer->data);
+  state->end_ptr  = state->curr_ptr + state->size;
+
+  return buffer->n_batches;
+}
+
+/*!
+ * @brief set up the state of an I/O tensor using the memory owned by the
+ * network (e.g. allocated in the activations buffer, see report.inputs[].data)
+ * @return false if the tensor has no memory of its own
+ */
+AI_DECLARE_STATIC
+ai_bool network_io_state_owned(
+  ai_network* net, const ai_tensor* t, ai_tensor_state* state,
+  const ai_error_type err_type)
+{
+  if ( !AI_ARRAY_OBJ_DATA(t->data, void) ) {
+    ai_platform_network_set_error(net, err_type, AI_ERROR_CODE_INVALID_PTR);
+    return false;
+  }
+  state->stride = 0;
+  state->curr_ptr = AI_ARRAY_OBJ_DATA_START(t->data, ai_u8);
+  state->size = 0;
+  state->end_ptr = state->curr_ptr;
+  return true;
+}
+
+/*!
+ * @brief resize the arrays of the I/O and activations tensors of the graph
+ * to hold n_batches samples: each layer then processes the whole chunk in a
+ * single call. Constant (weights) arrays are left untouched.
+ */
+AI_DECLARE_STATIC
+void network_set_batch_size(ai_network* net, const ai_u16 n_batches)
+{
+  AI_FOR_EACH_NODE_DO(node, net->input_node) {
+    for ( ai_size l=0; l<2; l++ ) {
+      ai_tensor_list* list = (l==0) ? GET_TENSOR_LIST_IN(node->tensors)
+                                    : GET_TENSOR_LIST_OUT(node->tensors);
+      AI_FOR_EACH_TENSOR_LIST_DO(i, t, list) {
+        ai_array* array = AI_ARRAY_OBJ(t->data);
+        if ( !array || (array->format & AI_FMT_FLAG_CONST) ) continue;
+        array->size = AI_TENSOR_SIZE(t) * n_batches;
+      }
+    }
+  }
+}
+
+/*!
+ * @brief check the user I/O buffers and set up the states of the I/O tensors.
+ * A missing output buffer (and, when bound with allow_owned, a missing input
+ * buffer) is only allowed when the network owns the memory of the tensor, e.g.
+ * I/O allocated in the activations buffer (no batching in that case)
+ * @return the number of batches to process, 0 on error
+ */
+AI_DECLARE_STATIC
+ai_u16 network_io_bind(
+  ai_network* net, const ai_buffer* input, ai_buffer* output,
+  const ai_bool allow_owned)
+{
+  ai_tensor_list* in_list  = AI_NETWORK_IO_LIST(net, INPUT);
+  ai_tensor_list* out_list = AI_NETWORK_IO_LIST(net, OUTPUT);
+
+  if ( !input && !allow_owned ) {
+    AI_ERROR_TRAP(net, INVALID_INPUT, INVALID_PTR);
+    return 0;
+  }
+
+  /* bind the inputs: all of them should provide the same number of batches */
+  ai_u16 n_batches = 0;
+  AI_FOR_EACH_TENSOR_LIST_DO(i, t_in, in_list) {
+    ai_tensor_state* state = GET_TENSOR_LIST_STATE(in_list, i);
+    ai_u16 n = 1;
+    if ( allow_owned && (!input || !input[i].data) ) {
+      if ( !network_io_state_owned(net, t_in, state, AI_ERROR_INVALID_INPUT) )
+        return 0;
+    } else {
+      n = network_io_buffer_bind(
+        net, &input[i], t_in, state, AI_ERROR_INVALID_INPUT);
+      if ( n==0 ) return 0;
+    }
+    if ( (n_batches>0) && (n!=n_batches) ) {
+      AI_ERROR_TRAP(net, INVALID_INPUT, INVALID_BATCH);
+      return 0;
+    }
+    n_batches = n;
+  }
+
+  AI_FOR_EACH_TENSOR_LIST_DO(o, t_out, out_list) {
+    ai_tensor_state* state = GET_TENSOR_LIST_STATE(out_list, o);
+    if ( !output || !output[o].data ) {
+      if ( !network_io_state_owned(net, t_out, state, AI_ERROR_INVALID_OUTPUT) )
+        return 0;
+      continue;
+    }
+    const ai_u16 n = network_io_buffer_bind(
+      net, &output[o], t_out, state, AI_ERROR_INVALID_OUTPUT);
+    if ( n==0 ) return 0;
+    if ( n<n_batches ) {
+      AI_ERROR_TRAP(net, INVALID_OUTPUT, INVALID_BATCH);
+      return 0;
+    }
+  }
+
+  net->n_batches = n_batches;
+  return n_batches;
+}
+
+/*!
+ * @brief max number of samples processed by a single forward of the layers:
+ * the batch planned in the activations, a single sample when an I/O tensor
+ * uses the memory owned by the network
+ */
+AI_DECLARE_STATIC
+ai_u16 network_batch_max(const ai_network* net)
+{
+  ai_u16 batch_max = AI_MAX(net->activations.n_batches, 1);
+  for ( ai_size l=0; l<2; l++ ) {
+    const ai_tensor_list* list = (l==0) ? AI_NETWORK_IO_LIST(net, INPUT)
+                                        : AI_NETWORK_IO_LIST(net, OUTPUT);
+    for ( ai_size i=0; i<GET_TENSOR_LIST_SIZE(list); i++ ) {
+      if ( GET_TENSOR_LIST_STATE(list, i)->stride==0 ) batch_max = 1;
+    }
+  }
+  return batch_max;
+}
+
+/*!
+ * @brief process the bound I/O buffers by chunks of up to network_batch_max()
+ * samples
+ * @return the number of batches processed, 0 on error
+ */
+AI_DECLARE_STATIC
+ai_i32 network_forward_batches(ai_network* net, const ai_u16 n_batches)
+{
+  ai_tensor_list* in_list  = AI_NETWORK_IO_LIST(net, INPUT);
+  ai_tensor_list* out_list = AI_NETWORK_IO_LIST(net, OUTPUT);
+  const ai_u16 batch_max = network_batch_max(net);
+
+  /* 32 bits counter: batch_id+batch_max can exceed the ai_u16 range, the
+   * batch_id of the network is only a copy for the observers */
+  for ( ai_u32 b=0; b<n_batches; b+=batch_max ) {
+    const ai_u16 n_chunk = (ai_u16)AI_MIN(batch_max, n_batches-b);
+    net->batch_id = (ai_u16)b;
+    const ai_tensor* t_first = GET_TENSOR_LIST_ITEM(in_list, 0);
+    if ( AI_ARRAY_OBJ_SIZE(t_first->data)!=AI_TENSOR_SIZE(t_first)*n_chunk ) {
+      network_set_batch_size(net, n_chunk);
+    }
+
+    AI_FOR_EACH_TENSOR_LIST_DO(i, t_in, in_list) {
+      ai_tensor_state* state = GET_TENSOR_LIST_STATE(in_list, i);
+      AI_TENSOR_ARRAY_UPDATE_DATA_ADDR(t_in, state->curr_ptr)
+      state->curr_ptr += state->stride * n_chunk;
+    }
+    AI_FOR_EACH_TENSOR_LIST_DO(o, t_out, out_list) {
+      ai_tensor_state* state = GET_TENSOR_LIST_STATE(out_list, o);
+      AI_TENSOR_ARRAY_UPDATE_DATA_ADDR(t_out, state->curr_ptr)
+      state->curr_ptr += state->stride * n_chunk;
+    }
+
+    ai_layers_forward_all(net);
+
+    if ( net->error.type!=AI_ERROR_NONE ) return 0;
+  }
+
+  return (ai_i32)n_batches;
+}
+
+/*!
+ * @brief internal node execution callback forwarding the events to the
+ * registered user observer
+ */
+AI_DECLARE_STATIC
+ai_u32 network_observer_exec(
+  const ai_node_exec_state state, struct ai_node_s* cur, const ai_handle ctx)
+{
+  ai_observer_exec_ctx* obs = (ai_observer_exec_ctx*)ctx;
+  AI_ASSERT(obs)
+
+  ai_u32 flags = obs->flags & AI_OBSERVER_MASK_EVT;
+
+  switch ( state ) {
+    case AI_NODE_EXEC_START:
+      obs->c_idx = 0;
+      obs->cur = NULL;
+      return 0;
+    case AI_NODE_EXEC_PRE:
+      flags &= AI_OBSERVER_PRE_EVT;
+      break;
+    case AI_NODE_EXEC_POST:
+      flags &= AI_OBSERVER_POST_EVT;
+      break;
+    default:
+      return 0;
+  }
+
+  obs->cur = cur;
+
+  if ( flags && obs->on_node ) {
+    const ai_observer_node node = {
+      .c_idx = obs->c_idx,
+      .type = cur->type,
+      .id = (ai_u16)cur->id,
+      .unused = 0,
+      .inner_tensors = NULL,
+      .tensors = cur->tensors,
+    };
+    if ( obs->c_idx==0 ) flags |= AI_OBSERVER_FIRST_EVT;
+    if ( AI_NODE_IS_LAST(cur) ) flags |= AI_OBSERVER_LAST_EVT;
+    obs->on_node(obs->cookie, flags, &node);
+  }
+
+  if ( state==AI_NODE_EXEC_POST ) {
+    obs->c_idx++;
+  }
+  return 0;
+}
+
+/******************************************************************************/
+AI_INTERFACE_ENTRY
+const char* ai_platform_runtime_get_revision(void)
+{
+  return AI_PLATFORM_RUNTIME_REVISION;
+}
+
+AI_INTERFACE_ENTRY
+ai_platform_version ai_platform_runtime_get_version(void)
+{
+  const ai_platform_version version = {
+    .major = AI_PLATFORM_RUNTIME_MAJOR,
+    .minor = AI_PLATFORM_RUNTIME_MINOR,
+    .micro = AI_PLATFORM_RUNTIME_MICRO,
+    .reserved = 0x0,
+  };
+  return version;
+}
+
+AI_INTERFACE_ENTRY
+ai_platform_version ai_platform_api_get_version(void)
+{
+  const ai_platform_version version = {
+    .major = AI_PLATFORM_API_MAJOR,
+    .minor = AI_PLATFORM_API_MINOR,
+    .micro = AI_PLATFORM_API_MICRO,
+    .reserved = 0x0,
+  };
+  return version;
+}
+
+AI_INTERFACE_ENTRY
+ai_platform_version ai_platform_interface_api_get_version(void)
+{
+  const ai_platform_version version = {
+    .major = AI_PLATFORM_INTERFACE_API_MAJOR,
+    .minor = AI_PLATFORM_INTERFACE_API_MINOR,
+    .micro = AI_PLATFORM_INTERFACE_API_MICRO,
+    .reserved = 0x0,
+  };
+  return version;
+}
+
+/******************************************************************************/
+AI_INTERFACE_ENTRY
+ai_context* ai_platform_context_acquire(const ai_handle handle)
+{
+  ai_context* ctx = AI_CONTEXT_OBJ(handle);
+  if ( !ctx || (ctx->magic!=AI_MAGIC_CONTEXT_TOKEN) ) return NULL;
+  return ctx;
+}
+
+AI_INTERFACE_ENTRY
+ai_handle ai_platform_context_release(ai_context* ctx)
+{
+  return AI_HANDLE_PTR(ctx);
+}
+
+/******************************************************************************/
+AI_INTERFACE_ENTRY
+ai_error ai_platform_network_get_error(ai_handle network)
+{
+  ai_network* net = AI_NETWORK_ACQUIRE_CTX(network);
+  if ( !net ) {
+    const ai_error err = AI_ERROR_INIT(INVALID_HANDLE, NETWORK);
+    return err;
+  }
+  return core_get_error(&net->error);
+}
+
+AI_INTERFACE_ENTRY
+ai_bool ai_platform_network_set_error(
+  ai_network* net_ctx, const ai_error_type type, const ai_error_code code)
+{
+  if ( !net_ctx ) return false;
+  return core_set_error(&net_ctx->error, type, code);
+}
+
+AI_INTERFACE_ENTRY
+ai_bool ai_platform_api_get_network_report(
+  ai_handle network, ai_network_report* r)
+{
+  ai_network* net = AI_NETWORK_ACQUIRE_CTX(network);
+  if ( !net || !r ) return false;
+
+  ai_tensor_list* in_list  = AI_NETWORK_IO_LIST(net, INPUT);
+  ai_tensor_list* out_list = AI_NETWORK_IO_LIST(net, OUTPUT);
+
+  if ( !in_list || !out_list || !in_list->info || !out_list->info ) {
+    AI_ERROR_TRAP(net, INVALID_STATE, NETWORK);
+    return false;
+  }
+
+  r->n_inputs    = in_list->size;
+  r->inputs      = GET_TENSOR_LIST_BUFFER(in_list, 0);
+  r->n_outputs   = out_list->size;
+  r->outputs     = GET_TENSOR_LIST_BUFFER(out_list, 0);
+  r->activations = net->activations;
+  /* planned arena: the per-batch size is the one required by the plan */
+  const ai_size arena = *core_network_get_arena_size(net);
+  if ( arena!=AI_PLAN_SIZE_NONE ) {
+    const ai_u16 n_batches = AI_MAX(r->activations.n_batches, 1);
+    r->activations.height = 1;
+    r->activations.width = 1;
+    r->activations.channels = (arena + n_batches - 1) / n_batches;
+  }
+  r->params      = net->params;
+  r->n_nodes     = network_get_n_nodes(net);
+  r->signature   = net->signature;
+
+  return true;
+}
+
+/******************************************************************************/
+AI_INTERFACE_ENTRY
+ai_error ai_platform_network_create(
+  ai_handle* network, const ai_buffer* network_config,
+  ai_network* net_ctx,
+  const ai_u8 tools_major, const ai_u8 tools_minor, const ai_u8 tools_micro)
+{
+  ai_error err = AI_ERROR_INIT(NONE, NONE);
+  AI_UNUSED(network_config)
+  AI_UNUSED(tools_micro)
+
+  if ( !network || !net_ctx ) {
+    err.type = AI_ERROR_INVALID_HANDLE;
+    err.code = AI_ERROR_CODE_NETWORK;
+    return err;
+  }
+
+  *network = AI_HANDLE_NULL;
+
+  if ( (tools_major!=AI_TOOLS_API_SUPPORTED_MAJOR) ||
+       (tools_minor>AI_TOOLS_API_SUPPORTED_MINOR_MAX) ) {
+    err.type = AI_ERROR_TOOL_PLATFORM_MISMATCH;
+    err.code = AI_ERROR_CODE_NETWORK;
+    return err;
+  }
+
+  if ( !core_init() ) {
+    err.type = AI_ERROR_INIT_FAILED;
+    err.code = AI_ERROR_CODE_NETWORK;
+    return err;
+  }
+
+  /* the generated network object is the template of the instances */
+  ai_network* net = core_network_clone(net_ctx);
+  if ( !net ) {
+    err.type = AI_ERROR_ALLOCATION_FAILED;
+    err.code = AI_ERROR_CODE_NETWORK;
+    return err;
+  }
+  *network = AI_HANDLE_PTR(net);
+
+  net->magic = AI_MAGIC_CONTEXT_TOKEN;
+  net->flags = AI_FLAG_NONE;
+  net->error = err;
+  net->n_batches = 0;
+  net->batch_id = 0;
+  net->current_node = NULL;
+  net->on_node_exec = NULL;
+  net->data_exec = NULL;
+
+  network_io_buffers_init(AI_NETWORK_IO_LIST(net, INPUT));
+  network_io_buffers_init(AI_NETWORK_IO_LIST(net, OUTPUT));
+
+  return err;
+}
+
+AI_INTERFACE_ENTRY
+ai_array* ai_platform_network_get_array(
+  ai_network* net_ctx, const ai_array* array)
+{
+  ai_array* inst_array = core_network_get_array(net_ctx, array);
+  return (inst_array) ? inst_array : (ai_array*)array;
+}
+
+AI_INTERFACE_ENTRY
+ai_handle ai_platform_network_destroy(ai_handle network)
+{
+  ai_network* net = AI_NETWORK_ACQUIRE_CTX(network);
+  if ( !net ) return network;
+
+  core_graph_unfold(net);
+
+  if ( net->data_exec ) {
+    free(net->data_exec);
+    net->data_exec = NULL;
+    net->on_node_exec = NULL;
+  }
+
+  net->flags = AI_FLAG_NONE;
+  net->magic = 0x0;
+  core_network_free(net);
+  return AI_HANDLE_NULL;
+}
+
+AI_INTERFACE_ENTRY
+ai_network* ai_platform_network_init(
+  ai_handle network, const ai_network_params* params)
+{
+  ai_network* net = AI_NETWORK_ACQUIRE_CTX(network);
+  if ( !net ) return NULL;
+
+  if ( !params ) {
+    AI_ERROR_TRAP(net, INVALID_PARAM, NETWORK);
+    return NULL;
+  }
+
+  const ai_buffer* weights = &params->params;
+  const ai_buffer* activations = &params->activations;
+
+  if ( !weights->data && (AI_BUFFER_SIZE(&net->params)>0) ) {
+    AI_ERROR_TRAP(net, INVALID_PARAM, NETWORK_WEIGHTS);
+    return NULL;
+  }
+  if ( AI_BUFFER_SIZE(weights)<AI_BUFFER_SIZE(&net->params) ) {
+    AI_ERROR_TRAP(net, INVALID_PARAM, NETWORK_WEIGHTS);
+    return NULL;
+  }
+  if ( !activations->data && (AI_BUFFER_SIZE(&net->activations)>0) ) {
+    AI_ERROR_TRAP(net, INVALID_PARAM, NETWORK_ACTIVATIONS);
+    return NULL;
+  }
+  if ( AI_BUFFER_SIZE(activations)<
+       AI_BUFFER_SIZE(&net->activations)*AI_MAX(net->activations.n_batches, 1) ) {
+    AI_ERROR_TRAP(net, INVALID_PARAM, NETWORK_ACTIVATIONS);
+    return NULL;
+  }
+
+  /* the folded graph refers to the previous weights: rebuilt at post init */
+  core_graph_unfold(net);
+
+  net->params.data = weights->data;
+  net->activations.data = activations->data;
+
+  /* select the kernels matching the running cpu once, before any process */
+  dense_kernel_f32_init();
+  dense_kernel_f16_init();
+  dense_kernel_lut_init();
+  dense_kernel_q4_init();
+  dense_kernel_bsr_init();
+  dense_kernel_gemm_init();
+  dense_kernel_s8_init();
+
+  AI_FLAG_UNSET(net->flags, AI_NETWORK_FLAG_INITIALIZED|
+    AI_NETWORK_FLAG_IO_BOUND|AI_NETWORK_FLAG_IO_STATIC);
+  net->n_batches = 0;
+  net->batch_id = 0;
+  net->current_node = NULL;
+
+  return net;
+}
+
+AI_INTERFACE_ENTRY
+ai_bool ai_platform_network_post_init(ai_handle network)
+{
+  ai_network* net = AI_NETWORK_ACQUIRE_CTX(network);
+  if ( !net ) return false;
+
+  if ( !net->input_node ) {
+    AI_ERROR_TRAP(net, INIT_FAILED, NETWORK);
+    return false;
+  }
+
+  AI_FOR_EACH_NODE_DO(node, net->input_node) {
+    if ( !node->forward || !AI_LAYER_TYPE_IS_VALID(node->type) ) {
+      AI_ERROR_TRAP(net, INIT_FAILED, LAYER);
+      return false;
+    }
+  }
+
+  /* fold the linear chains once the weights are bound */
+  core_graph_fold(net);
+
+  /* pack the activations still used by the executed graph */
+  core_plan_activations(net);
+
+  /* the I/O buffers descriptors reflect the (possibly updated) tensors */
+  network_io_buffers_init(AI_NETWORK_IO_LIST(net, INPUT));
+  network_io_buffers_init(AI_NETWORK_IO_LIST(net, OUTPUT));
+
+  AI_FLAG_SET(net->flags, AI_NETWORK_FLAG_INITIALIZED);
+  return true;
+}
+
+AI_INTERFACE_ENTRY
+ai_i32 ai_platform_network_process(
+  ai_handle network, const ai_buffer* input, ai_buffer* output)
+{
+  ai_network* net = AI_NETWORK_ACQUIRE_CTX(network);
+  if ( !net ) return 0;
+
+  if ( !AI_FLAG_IS_SET(net->flags, AI_NETWORK_FLAG_INITIALIZED) ) {
+    AI_ERROR_TRAP(net, INVALID_STATE, NETWORK);
+    return 0;
+  }
+
+  /* the I/O tensors are re-pointed on the user buffers: drop the binding */
+  AI_FLAG_UNSET(net->flags,
+    AI_NETWORK_FLAG_IO_BOUND|AI_NETWORK_FLAG_IO_STATIC);
+
+  const ai_u16 n_batches = network_io_bind(net, input, output, false);
+  if ( n_batches==0 ) return 0;
+
+  return network_forward_batches(net, n_batches);
+}
+
+AI_INTERFACE_ENTRY
+ai_i32 ai_platform_network_bind_io(
+  ai_handle network, const ai_buffer* input, ai_buffer* output)
+{
+  ai_network* net = AI_NETWORK_ACQUIRE_CTX(network);
+  if ( !net ) return 0;
+
+  if ( !AI_FLAG_IS_SET(net->flags, AI_NETWORK_FLAG_INITIALIZED) ) {
+    AI_ERROR_TRAP(net, INVALID_STATE, NETWORK);
+    return 0;
+  }
+
+  AI_FLAG_UNSET(net->flags,
+    AI_NETWORK_FLAG_IO_BOUND|AI_NETWORK_FLAG_IO_STATIC);
+
+  const ai_u16 n_batches = network_io_bind(net, input, output, true);
+  if ( n_batches==0 ) return 0;
+
+  /* the whole buffers fit in a single chunk: point the tensors on them and
+   * size the arrays once, the runs only execute the layers */
+  if ( n_batches<=network_batch_max(net) ) {
+    ai_tensor_list* in_list  = AI_NETWORK_IO_LIST(net, INPUT);
+    ai_tensor_list* out_list = AI_NETWORK_IO_LIST(net, OUTPUT);
+    network_set_batch_size(net, n_batches);
+    AI_FOR_EACH_TENSOR_LIST_DO(i, t_in, in_list) {
+      AI_TENSOR_ARRAY_UPDATE_DATA_ADDR(t_in,
+        GET_TENSOR_LIST_STATE(in_list, i)->curr_ptr)
+    }
+    AI_FOR_EACH_TENSOR_LIST_DO(o, t_out, out_list) {
+      AI_TENSOR_ARRAY_UPDATE_DATA_ADDR(t_out,
+        GET_TENSOR_LIST_STATE(out_list, o)->curr_ptr)
+    }
+    AI_FLAG_SET(net->flags, AI_NETWORK_FLAG_IO_STATIC);
+  }
+
+  AI_FLAG_SET(net->flags, AI_NETWORK_FLAG_IO_BOUND);
+  return (ai_i32)n_batches;
+}
+
+AI_INTERFACE_ENTRY
+ai_i32 ai_platform_network_process_bound(ai_handle network)
+{
+  ai_network* net = AI_NETWORK_ACQUIRE_CTX(network);
+  if ( !net ) return 0;
+
+  if ( !AI_FLAG_IS_SET(net->flags, AI_NETWORK_FLAG_IO_BOUND) ) {
+    AI_ERROR_TRAP(net, INVALID_STATE, NETWORK);
+    return 0;
+  }
+
+  if ( AI_FLAG_IS_SET(net->flags, AI_NETWORK_FLAG_IO_STATIC) ) {
+    ai_layers_forward_all(net);
+    return (net->error.type==AI_ERROR_NONE) ? (ai_i32)net->n_batches : 0;
+  }
+
+  /* several chunks: restart the iteration on the bound buffers */
+  for ( ai_size l=0; l<2; l++ ) {
+    ai_tensor_list* list = (l==0) ? AI_NETWORK_IO_LIST(net, INPUT)
+                                  : AI_NETWORK_IO_LIST(net, OUTPUT);
+    for ( ai_size i=0; i<GET_TENSOR_LIST_SIZE(list); i++ ) {
+      ai_tensor_state* state = GET_TENSOR_LIST_STATE(list, i);
+      state->curr_ptr = state->end_ptr - state->size;
+    }
+  }
+  return network_forward_batches(net, net->n_batches);
+}
+
+/******************************************************************************/
+AI_INTERFACE_ENTRY
+ai_bool ai_platform_observer_node_info(
+    ai_handle network, ai_observer_node *node_info)
+{
+  ai_network* net = AI_NETWORK_ACQUIRE_CTX(network);
+  if ( !net ) return false;
+
+  if ( !node_info ) {
+    AI_ERROR_TRAP(net, INVALID_PARAM, INVALID_PTR);
+    return false;
+  }
+
+  const ai_node* node = network_get_node(net, node_info->c_idx);
+  if ( !node ) {
+    AI_ERROR_TRAP(net, INVALID_PARAM, OUT_OF_RANGE);
+    return false;
+  }
+
+  node_info->type = node->type;
+  node_info->id = (ai_u16)node->id;
+  node_info->unused = 0;
+  node_info->inner_tensors = NULL;
+  node_info->tensors = node->tensors;
+  return true;
+}
+
+AI_INTERFACE_ENTRY
+ai_bool ai_platform_observer_register(
+    ai_handle network,
+    ai_observer_node_cb cb,
+    ai_handle cookie,
+    ai_u32 flags)
+{
+  ai_network* net = AI_NETWORK_ACQUIRE_CTX(network);
+  if ( !net ) return false;
+
+  if ( !cb ) {
+    AI_ERROR_TRAP(net, INVALID_PARAM, INVALID_PTR);
+    return false;
+  }
+  if ( net->data_exec ) {
+    AI_ERROR_TRAP(net, INVALID_STATE, IN_USE);
+    return false;
+  }
+
+  ai_observer_exec_ctx* obs =
+    (ai_observer_exec_ctx*)malloc(sizeof(ai_observer_exec_ctx));
+  if ( !obs ) {
+    AI_ERROR_TRAP(net, ALLOCATION_FAILED, NETWORK);
+    return false;
+  }
+
+  obs->on_node = cb;
+  obs->cookie = cookie;
+  obs->flags = (flags & AI_OBSERVER_MASK_EVT) | AI_OBSERVER_REGISTERED;
+  obs->c_idx = 0;
+  obs->n_nodes = network_get_n_nodes(net);
+  obs->cur = NULL;
+
+  /* the network is already initialized: the init events are raised now */
+  if ( flags & AI_OBSERVER_INIT_EVT ) {
+    AI_FOR_EACH_NODE_DO(node, net->input_node) {
+      const ai_observer_node node_info = {
+        .c_idx = obs->c_idx,
+        .type = node->type,
+        .id = (ai_u16)node->id,
+        .unused = 0,
+        .inner_tensors = NULL,
+        .tensors = node->tensors,
+      };
+      ai_u32 evt = AI_OBSERVER_INIT_EVT;
+      if ( obs->c_idx==0 ) evt |= AI_OBSERVER_FIRST_EVT;
+      if ( AI_NODE_IS_LAST(node) ) evt |= AI_OBSERVER_LAST_EVT;
+      cb(cookie, evt, &node_info);
+      obs->c_idx++;
+    }
+    obs->c_idx = 0;
+  }
+
+  net->data_exec = AI_HANDLE_PTR(obs);
+  net->on_node_exec = network_observer_exec;
+  return true;
+}
+
+AI_INTERFACE_ENTRY
+ai_bool ai_platform_observer_unregister(ai_handle network,
+    ai_observer_node_cb cb, ai_handle cookie)
+{
+  ai_network* net = AI_NETWORK_ACQUIRE_CTX(network);
+  if ( !net ) return false;
+
+  ai_observer_exec_ctx* obs = (ai_observer_exec_ctx*)net->data_exec;
+  if ( !obs || (obs->on_node!=cb) || (obs->cookie!=cookie) ) {
+    AI_ERROR_TRAP(net, INVALID_PARAM, NETWORK);
+    return false;
+  }
+
+  net->on_node_exec = NULL;
+  net->data_exec = NULL;
+  free(obs);
+  return true;
+}
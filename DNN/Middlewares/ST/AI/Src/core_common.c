@@ -0,0 +1,49 @@
+/**
+  ******************************************************************************
+  * @file    core_common.c
+  * @brief   implementation of common core routines
+  ******************************************************************************
+  * @attention
+  *
+  * Open implementation of the core module APIs declared in core_common.h.
+  * It is used by the host (x86-64 Linux) build of the runtime in place of
+  * the closed NetworkRuntime library shipped for Cortex-M targets.
+  *
+  ******************************************************************************
+  */
+
+#include "core_common.h"
+
+/******************************************************************************/
+AI_INTERNAL_API
+ai_bool core_init(void)
+{
+  return true;
+}
+
+AI_INTERNAL_API
+ai_error core_get_error(ai_error* error)
+{
+  ai_error err = AI_ERROR_INIT(NONE, NONE);
+  if ( error ) {
+    err = *error;
+    /* the error is reset once it has been retrieved */
+    error->type = AI_ERROR_NONE;
+    error->code = AI_ERROR_CODE_NONE;
+  }
+  return err;
+}
+
+AI_INTERNAL_API
+ai_bool core_set_error(
+  ai_error* error, const ai_error_type type, const ai_error_code code)
+{
+  if ( !error ) return false;
+
+  /* only the 1st error raised is kept */
+  if ( error->type!=AI_ERROR_NONE ) return false;
+
+  error->type = type;
+  error->code = code;
+  return true;
+}
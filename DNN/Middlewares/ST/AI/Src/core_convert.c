@@ -0,0 +1,105 @@
+/**
+  ******************************************************************************
+  * @file    core_convert.c
+  * @brief   implementation of the half precision conversion routines
+  ******************************************************************************
+  * @attention
+  *
+  * Open implementation of the FLOAT16 <-> float array conversions declared in
+  * core_convert.h. The x86 variants are compiled with a function level target
+  * attribute and only called once the cpu support is checked (see
+  * core_cpu.h); the generic variants use the AI_MATH_F16_TO_F32 /
+  * AI_MATH_F32_TO_F16 helpers and give the same results.
+  *
+  ******************************************************************************
+  */
+
+#include "core_convert.h"
+#include "core_cpu.h"
+#include "ai_math_helpers.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+/******************************************************************************/
+AI_DECLARE_STATIC __attribute__((target("avx,f16c")))
+ai_size convert_f16_to_f32_f16c(ai_float* out, const ai_u16* in,
+                                const ai_size size)
+{
+  ai_size i = 0;
+  for ( ; i+8<=size; i+=8 ) {
+    _mm256_storeu_ps(out + i,
+      _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(in + i))));
+  }
+  return i;
+}
+
+AI_DECLARE_STATIC __attribute__((target("avx,f16c")))
+ai_size convert_f32_to_f16_f16c(ai_u16* out, const ai_float* in,
+                                const ai_size size)
+{
+  ai_size i = 0;
+  for ( ; i+8<=size; i+=8 ) {
+    _mm_storeu_si128((__m128i*)(out + i),
+      _mm256_cvtps_ph(_mm256_loadu_ps(in + i), _MM_FROUND_TO_NEAREST_INT));
+  }
+  return i;
+}
+
+AI_DECLARE_STATIC __attribute__((target("avx512f")))
+ai_size convert_f16_to_f32_avx512(ai_float* out, const ai_u16* in,
+                                  const ai_size size)
+{
+  ai_size i = 0;
+  for ( ; i+16<=size; i+=16 ) {
+    _mm512_storeu_ps(out + i,
+      _mm512_cvtph_ps(_mm256_loadu_si256((const __m256i*)(in + i))));
+  }
+  return i;
+}
+
+AI_DECLARE_STATIC __attribute__((target("avx512f")))
+ai_size convert_f32_to_f16_avx512(ai_u16* out, const ai_float* in,
+                                  const ai_size size)
+{
+  ai_size i = 0;
+  for ( ; i+16<=size; i+=16 ) {
+    _mm256_storeu_si256((__m256i*)(out + i),
+      _mm512_cvtps_ph(_mm512_loadu_ps(in + i), _MM_FROUND_TO_NEAREST_INT));
+  }
+  return i;
+}
+#endif    /* __x86_64__ || __i386__ */
+
+/******************************************************************************/
+AI_INTERNAL_API
+void core_convert_f16_to_f32(ai_float* out, const ai_u16* in,
+                             const ai_size size)
+{
+  ai_size i = 0;
+#if defined(__x86_64__) || defined(__i386__)
+  const ai_u32 features = core_cpu_get_features();
+  if ( AI_CPU_HAS_FEATURE(features, AI_CPU_FEATURE_AVX512F) ) {
+    i = convert_f16_to_f32_avx512(out, in, size);
+  } else if ( AI_CPU_HAS_FEATURE(features, AI_CPU_FEATURE_F16C) ) {
+    i = convert_f16_to_f32_f16c(out, in, size);
+  }
+#endif
+  for ( ; i<size; i++ ) out[i] = AI_MATH_F16_TO_F32(in[i]);
+}
+
+AI_INTERNAL_API
+void core_convert_f32_to_f16(ai_u16* out, const ai_float* in,
+                             const ai_size size)
+{
+  ai_size i = 0;
+#if defined(__x86_64__) || defined(__i386__)
+  const ai_u32 features = core_cpu_get_features();
+  if ( AI_CPU_HAS_FEATURE(features, AI_CPU_FEATURE_AVX512F) ) {
+    i = convert_f32_to_f16_avx512(out, in, size);
+  } else if ( AI_CPU_HAS_FEATURE(features, AI_CPU_FEATURE_F16C) ) {
+    i = convert_f32_to_f16_f16c(out, in, size);
+  }
+#endif
+  for ( ; i<size; i++ ) out[i] = AI_MATH_F32_TO_F16(in[i]);
+}
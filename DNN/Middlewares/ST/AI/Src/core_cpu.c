@@ -0,0 +1,107 @@
+/**
+  ******************************************************************************
+  * @file    core_cpu.c
+  * @brief   implementation of the core cpu features detection
+  ******************************************************************************
+  * @attention
+  *
+  * The x86 features are read through cpuid; AVX state support by the OS is
+  * checked with xgetbv before any AVX extension is reported.
+  *
+  ******************************************************************************
+  */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "core_cpu.h"
+#include "core_common.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#define AI_CPU_HAS_CPUID
+#endif
+
+#define AI_CPU_FEATURES_UNKNOWN   (0xFFFFFFFFU)
+
+AI_STATIC ai_u32 g_cpu_features = AI_CPU_FEATURES_UNKNOWN;
+
+/******************************************************************************/
+#if defined(AI_CPU_HAS_CPUID)
+AI_DECLARE_STATIC
+ai_u64 core_cpu_xgetbv(const ai_u32 idx)
+{
+  ai_u32 eax, edx;
+  __asm__ volatile ("xgetbv" : "=a"(eax), "=d"(edx) : "c"(idx));
+  return ((ai_u64)edx << 32) | eax;
+}
+
+AI_DECLARE_STATIC
+ai_u32 core_cpu_detect(void)
+{
+  ai_u32 eax, ebx, ecx, edx;
+  ai_u32 features = AI_CPU_FEATURE_NONE;
+
+  if ( !__get_cpuid(1, &eax, &ebx, &ecx, &edx) ) return features;
+
+  /* AVX usable: OSXSAVE set and XMM/YMM state enabled by the OS */
+  const ai_bool osxsave = (ecx & bit_OSXSAVE) ? true : false;
+  const ai_u64 xcr0 = (osxsave) ? core_cpu_xgetbv(0) : 0;
+  if ( !osxsave || ((xcr0 & 0x6)!=0x6) ) return features;
+
+  if ( ecx & bit_FMA )  features |= AI_CPU_FEATURE_FMA;
+  if ( ecx & bit_F16C ) features |= AI_CPU_FEATURE_F16C;
+
+  if ( __get_cpuid_max(0, NULL)<7 ) return features;
+  __cpuid_count(7, 0, eax, ebx, ecx, edx);
+
+  if ( ebx & bit_AVX2 ) features |= AI_CPU_FEATURE_AVX2;
+
+  /* AVX-512 usable: opmask, ZMM_Hi256 and Hi16_ZMM states enabled */
+  if ( (ebx & bit_AVX512F) && ((xcr0 & 0xE0)==0xE0) ) {
+    features |= AI_CPU_FEATURE_AVX512F;
+    if ( ebx & bit_AVX512BW ) features |= AI_CPU_FEATURE_AVX512BW;
+  }
+  return features;
+}
+#else
+AI_DECLARE_STATIC
+ai_u32 core_cpu_detect(void)
+{
+  return AI_CPU_FEATURE_NONE;
+}
+#endif
+
+/*!
+ * @brief restrict the detected features to the ones listed in the
+ * AI_CPU_FEATURES environment variable (comma separated list)
+ */
+AI_DECLARE_STATIC
+ai_u32 core_cpu_mask_features(const ai_u32 features)
+{
+  const char* env = getenv("AI_CPU_FEATURES");
+  if ( !env || !env[0] ) return features;
+
+  ai_u32 mask = AI_CPU_FEATURE_NONE;
+  if ( strstr(env, "avx2") )   mask |= AI_CPU_FEATURE_AVX2 | AI_CPU_FEATURE_FMA;
+  if ( strstr(env, "fma") )    mask |= AI_CPU_FEATURE_FMA;
+  if ( strstr(env, "avx512") ) mask |= AI_CPU_FEATURE_AVX512F |
+                                       AI_CPU_FEATURE_AVX512BW |
+                                       AI_CPU_FEATURE_AVX2 | AI_CPU_FEATURE_FMA;
+  if ( strstr(env, "f16c") )   mask |= AI_CPU_FEATURE_F16C;
+
+  return features & mask;
+}
+
+/******************************************************************************/
+AI_INTERNAL_API
+ai_u32 core_cpu_get_features(void)
+{
+  /* concurrent first calls store the same value */
+  ai_u32 features = __atomic_load_n(&g_cpu_features, __ATOMIC_RELAXED);
+  if ( features==AI_CPU_FEATURES_UNKNOWN ) {
+    features = core_cpu_mask_features(core_cpu_detect());
+    __atomic_store_n(&g_cpu_features, features, __ATOMIC_RELAXED);
+  }
+  return features;
+}
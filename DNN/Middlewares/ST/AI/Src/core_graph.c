@@ -0,0 +1,449 @@
+/**
+  ******************************************************************************
+  * @file    core_graph.c
+  * @brief   implementation of the init time graph optimizations
+  ******************************************************************************
+  * @attention
+  *
+  * A fold keeps the first node of the pair: its tensor chain is replaced by a
+  * heap allocated one (input of the first node, output of the second one and
+  * the folded weights) and the second node is unlinked from the execution
+  * list. The original chain and link are saved in the fold record so that the
+  * generated graph can be restored before the weights are bound again.
+  *
+  * A fusion is recorded the same way, without new weights: the first node
+  * keeps its weights, its forward function is replaced by the fused one
+  * which reaches the second node through core_graph_get_fused().
+  *
+  * The weights prepared by the layers for their kernels (see
+  * core_graph_get_prepared()) are records of the same list which do not
+  * change the graph: the node is left as it is when they are released.
+  *
+  ******************************************************************************
+  */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "core_graph.h"
+#include "core_network.h"
+#include "core_common.h"
+#include "layers.h"
+
+/*!
+ * @struct ai_graph_fold
+ * @brief record of a fold applied on a network node
+ */
+typedef struct ai_graph_fold_ {
+  struct ai_graph_fold_*  prev;           /*!< previously applied fold */
+  ai_network*             net;            /*!< owner network */
+  ai_node*                node;           /*!< node carrying the folded layer */
+  ai_node*                saved_next;     /*!< generated next node */
+  const ai_tensor_chain*  saved_tensors;  /*!< generated tensor chain */
+  node_forward_func       saved_forward;  /*!< generated forward function */
+  ai_node*                fused;          /*!< node fused into node (or NULL) */
+  ai_bool                 prepared;       /*!< prepared weights record */
+  ai_handle               key;            /*!< prepared from these weights */
+  ai_u32                  tag;            /*!< kind of preparation */
+  ai_size                 size;           /*!< bytes of the prepared weights */
+
+  ai_tensor_chain         chain;
+  ai_tensor_list          lists[AI_TENSOR_CHAIN_SIZE];
+  ai_tensor*              params[2];      /*!< weights, bias */
+  ai_tensor               tensors[2];
+  ai_array                arrays[2];
+  ai_shape_dimension      shapes[2][AI_SHAPE_MAX_DIMENSION];
+  ai_stride_dimension     strides[2][AI_SHAPE_MAX_DIMENSION];
+  ai_float                data[];         /*!< folded weights then bias, or
+                                               prepared weights */
+} ai_graph_fold;
+
+/******************************************************************************/
+AI_DECLARE_STATIC
+ai_bool graph_node_is(const ai_node* node, const ai_layer_type type)
+{
+  return (AI_LAYER_TYPE(node->type)==type);
+}
+
+AI_DECLARE_STATIC
+ai_bool graph_tensor_is_f32(const ai_tensor* t)
+{
+  if ( !t || !t->data || !AI_ARRAY_OBJ_DATA(t->data, void) ) return false;
+  const ai_array_format fmt = AI_ARRAY_OBJ_FMT(t->data);
+  return ((AI_FMT_GET_TYPE(fmt)==AI_FMT_FLOAT) && (AI_FMT_GET_BITS(fmt)==32));
+}
+
+/*!
+ * @brief check that a tensor only links two nodes: it is not a network I/O
+ * and it has a single consumer
+ */
+AI_DECLARE_STATIC
+ai_bool graph_tensor_is_inner(const ai_network* net, const ai_tensor* t)
+{
+  if ( AI_ARRAY_OBJ_FMT(t->data) & AI_FMT_FLAG_IS_IO ) return false;
+
+  ai_u32 n_consumers = 0;
+  AI_FOR_EACH_NODE_DO(node, net->input_node) {
+    AI_FOR_EACH_TENSOR_LIST_DO(i, t_in, GET_TENSOR_LIST_IN(node->tensors)) {
+      if ( t_in==t ) n_consumers++;
+    }
+  }
+  return (n_consumers==1);
+}
+
+/*!
+ * @brief allocate a fold record for node, holding n_weights + n_bias floats
+ */
+AI_DECLARE_STATIC
+ai_graph_fold* graph_fold_alloc(
+  ai_network* net, ai_node* node, const ai_size n_weights, const ai_size n_bias)
+{
+  ai_graph_fold* fold = malloc(sizeof(ai_graph_fold) +
+                               (n_weights + n_bias) * sizeof(ai_float));
+  if ( !fold ) return NULL;
+  memset(fold, 0, sizeof(ai_graph_fold));
+
+  fold->net = net;
+  fold->node = node;
+  fold->saved_next = node->next;
+  fold->saved_tensors = node->tensors;
+  fold->saved_forward = node->forward;
+  return fold;
+}
+
+/*!
+ * @brief set up a folded float tensor (contiguous strides) on the fold data
+ */
+AI_DECLARE_STATIC
+void graph_fold_tensor_init(
+  ai_graph_fold* fold, const ai_size idx, const ai_shape_dimension* dims,
+  ai_float* data)
+{
+  ai_tensor* t = &fold->tensors[idx];
+  ai_array* array = &fold->arrays[idx];
+  ai_shape_dimension* shape = fold->shapes[idx];
+  ai_stride_dimension* stride = fold->strides[idx];
+
+  ai_size size = 1;
+  for ( ai_size i=0; i<AI_SHAPE_MAX_DIMENSION; i++ ) {
+    shape[i] = dims[i];
+    stride[i] = (ai_stride_dimension)(size * sizeof(ai_float));
+    size *= dims[i];
+  }
+
+  array->format = AI_ARRAY_FORMAT_FLOAT | AI_FMT_FLAG_CONST;
+  array->size = size;
+  array->data = AI_PTR(data);
+  array->data_start = AI_PTR(data);
+
+  t->shape = (ai_shape)AI_STORAGE_KLASS_INIT(
+    AI_STORAGE_KLASS_SHAPE, AI_SHAPE_MAX_DIMENSION, shape);
+  t->stride = (ai_stride)AI_STORAGE_KLASS_INIT(
+    AI_STORAGE_KLASS_STRIDE, AI_SHAPE_MAX_DIMENSION, stride);
+  t->data = array;
+
+  fold->params[idx] = t;
+}
+
+/*!
+ * @brief link the folded node: input of node, output of folded, new weights
+ * (the weights of node when n_params is 0)
+ */
+AI_DECLARE_STATIC
+void graph_fold_apply(
+  ai_graph_fold* fold, ai_node* folded, const ai_u16 n_params)
+{
+  ai_node* node = fold->node;
+  const ai_tensor_chain* chain = node->tensors;
+
+  for ( ai_size i=0; i<chain->size && i<AI_TENSOR_CHAIN_SIZE; i++ ) {
+    fold->lists[i] = chain->chain[i];
+  }
+  fold->lists[AI_TENSOR_CHAIN_OUTPUT] = *GET_TENSOR_LIST_OUT(folded->tensors);
+  if ( n_params>0 ) {
+    fold->lists[AI_TENSOR_CHAIN_WEIGHTS].size = n_params;
+    fold->lists[AI_TENSOR_CHAIN_WEIGHTS].tensor = fold->params;
+    fold->lists[AI_TENSOR_CHAIN_WEIGHTS].info = NULL;
+  }
+
+  fold->chain.size = chain->size;
+  fold->chain.flags = chain->flags;
+  fold->chain.chain = fold->lists;
+
+  node->tensors = &fold->chain;
+  node->next = (AI_NODE_IS_LAST(folded)) ? node : folded->next;
+
+  /* applied folds of the instance, most recent first */
+  ai_handle* folds = core_network_get_graph(fold->net);
+  fold->prev = (ai_graph_fold*)(*folds);
+  *folds = AI_HANDLE_PTR(fold);
+}
+
+/*!
+ * @brief Dense -> Dense: W = W1.W0 ([n_out][n_in]), b = W1.b0 + b1
+ */
+AI_DECLARE_STATIC
+ai_bool graph_fold_dense_dense(ai_network* net, ai_node* node, ai_node* next)
+{
+  AI_LAYER_WEIGHTS_GET(node, w0, b0)
+  AI_LAYER_WEIGHTS_GET(next, w1, b1)
+
+  if ( !graph_tensor_is_f32(w0) || !graph_tensor_is_f32(w1) ) return false;
+  if ( (b0 && !graph_tensor_is_f32(b0)) || (b1 && !graph_tensor_is_f32(b1)) ) return false;
+
+  const ai_size n_in  = AI_SHAPE_IN_CH(&w0->shape);
+  const ai_size n_mid = AI_SHAPE_CH(&w0->shape);
+  const ai_size n_out = AI_SHAPE_CH(&w1->shape);
+  if ( AI_SHAPE_IN_CH(&w1->shape)!=n_mid ) return false;
+  if ( (b0 && AI_ARRAY_OBJ_SIZE(b0->data)!=n_mid) ||
+       (b1 && AI_ARRAY_OBJ_SIZE(b1->data)!=n_out) ) return false;
+
+  /* only fold when the folded layer is not more complex than the pair */
+  if ( n_out*n_in > n_mid*(n_in + n_out) ) return false;
+
+  const ai_size n_bias = (b0 || b1) ? n_out : 0;
+  ai_graph_fold* fold = graph_fold_alloc(net, node, n_out*n_in, n_bias);
+  if ( !fold ) return false;
+
+  const ai_float* w0_data = AI_ARRAY_OBJ_DATA(w0->data, ai_float);
+  const ai_float* w1_data = AI_ARRAY_OBJ_DATA(w1->data, ai_float);
+  ai_float* w = fold->data;
+  ai_float* b = fold->data + n_out*n_in;
+
+  for ( ai_size o=0; o<n_out; o++ ) {
+    const ai_float* w1_row = w1_data + o*n_mid;
+    for ( ai_size i=0; i<n_in; i++ ) {
+      ai_double acc = 0.0;
+      for ( ai_size k=0; k<n_mid; k++ ) {
+        acc += (ai_double)w1_row[k] * w0_data[k*n_in + i];
+      }
+      w[o*n_in + i] = (ai_float)acc;
+    }
+  }
+
+  const ai_shape_dimension w_dims[] = { n_in, n_out, 1, 1 };
+  graph_fold_tensor_init(fold, 0, w_dims, w);
+
+  if ( n_bias ) {
+    const ai_float* b0_data = (b0) ? AI_ARRAY_OBJ_DATA(b0->data, ai_float) : NULL;
+    const ai_float* b1_data = (b1) ? AI_ARRAY_OBJ_DATA(b1->data, ai_float) : NULL;
+    for ( ai_size o=0; o<n_out; o++ ) {
+      ai_double acc = (b1_data) ? b1_data[o] : 0.0;
+      if ( b0_data ) {
+        const ai_float* w1_row = w1_data + o*n_mid;
+        for ( ai_size k=0; k<n_mid; k++ ) acc += (ai_double)w1_row[k] * b0_data[k];
+      }
+      b[o] = (ai_float)acc;
+    }
+    const ai_shape_dimension b_dims[] = { 1, n_out, 1, 1 };
+    graph_fold_tensor_init(fold, 1, b_dims, b);
+  }
+
+  graph_fold_apply(fold, next, (n_bias) ? 2 : 1);
+  return true;
+}
+
+/*!
+ * @brief Dense/Conv2D -> BN: per output channel scaling of the weights rows
+ * (output channel is the outer dimension of both weights layouts)
+ */
+AI_DECLARE_STATIC
+ai_bool graph_fold_bn(ai_network* net, ai_node* node, ai_node* next)
+{
+  AI_LAYER_WEIGHTS_GET(node, w, b)
+  AI_LAYER_WEIGHTS_GET(next, scale, shift)
+
+  if ( !graph_tensor_is_f32(w) || (b && !graph_tensor_is_f32(b)) ) return false;
+  if ( !graph_tensor_is_f32(scale) || (shift && !graph_tensor_is_f32(shift)) ) return false;
+
+  const ai_size n_out = (graph_node_is(node, AI_LAYER_CONV2D_TYPE))
+    ? AI_CONV_SHAPE_CH(&w->shape) : AI_SHAPE_CH(&w->shape);
+  const ai_size n_weights = AI_ARRAY_OBJ_SIZE(w->data);
+  if ( (n_out==0) || (n_weights % n_out) ) return false;
+  if ( AI_ARRAY_OBJ_SIZE(scale->data)!=n_out ) return false;
+  if ( (shift && AI_ARRAY_OBJ_SIZE(shift->data)!=n_out) ||
+       (b && AI_ARRAY_OBJ_SIZE(b->data)!=n_out) ) return false;
+
+  ai_graph_fold* fold = graph_fold_alloc(net, node, n_weights, n_out);
+  if ( !fold ) return false;
+
+  const ai_size n_row = n_weights / n_out;
+  const ai_float* w_data = AI_ARRAY_OBJ_DATA(w->data, ai_float);
+  const ai_float* b_data = (b) ? AI_ARRAY_OBJ_DATA(b->data, ai_float) : NULL;
+  const ai_float* s_data = AI_ARRAY_OBJ_DATA(scale->data, ai_float);
+  const ai_float* t_data = (shift) ? AI_ARRAY_OBJ_DATA(shift->data, ai_float) : NULL;
+  ai_float* w_fold = fold->data;
+  ai_float* b_fold = fold->data + n_weights;
+
+  for ( ai_size o=0; o<n_out; o++ ) {
+    for ( ai_size i=0; i<n_row; i++ ) {
+      w_fold[o*n_row + i] = s_data[o] * w_data[o*n_row + i];
+    }
+    b_fold[o] = s_data[o] * ((b_data) ? b_data[o] : 0.0f) +
+                ((t_data) ? t_data[o] : 0.0f);
+  }
+
+  const ai_shape_dimension w_dims[] = {
+    AI_SHAPE_IN_CH(&w->shape), AI_SHAPE_CH(&w->shape),
+    AI_SHAPE_W(&w->shape), AI_SHAPE_H(&w->shape) };
+  const ai_shape_dimension b_dims[] = { 1, n_out, 1, 1 };
+  graph_fold_tensor_init(fold, 0, w_dims, w_fold);
+  graph_fold_tensor_init(fold, 1, b_dims, b_fold);
+
+  graph_fold_apply(fold, next, 2);
+  return true;
+}
+
+/*!
+ * @brief try to fold next into node
+ */
+AI_DECLARE_STATIC
+ai_bool graph_fold_pair(ai_network* net, ai_node* node, ai_node* next)
+{
+  if ( !node->tensors || !next->tensors ) return false;
+  if ( GET_TENSOR_LIST_SIZE(GET_TENSOR_LIST_OUT(node->tensors))!=1 ||
+       GET_TENSOR_LIST_SIZE(GET_TENSOR_LIST_IN(next->tensors))!=1 ||
+       GET_TENSOR_LIST_SIZE(GET_TENSOR_LIST_OUT(next->tensors))!=1 ) return false;
+
+  const ai_tensor* t_link = GET_TENSOR_OUT(node->tensors, 0);
+  if ( t_link!=GET_TENSOR_IN(next->tensors, 0) ) return false;
+  if ( !graph_tensor_is_inner(net, t_link) ) return false;
+
+  if ( graph_node_is(node, AI_LAYER_DENSE_TYPE) ) {
+    if ( graph_node_is(next, AI_LAYER_DENSE_TYPE) ) {
+      return graph_fold_dense_dense(net, node, next);
+    }
+    if ( graph_node_is(next, AI_LAYER_BN_TYPE) ) {
+      return graph_fold_bn(net, node, next);
+    }
+  }
+  if ( graph_node_is(node, AI_LAYER_CONV2D_TYPE) &&
+       graph_node_is(next, AI_LAYER_BN_TYPE) ) {
+    /* a conv with a fused nonlinearity is not affine */
+    if ( ((const ai_layer_conv2d*)node)->nl_func ) return false;
+    return graph_fold_bn(net, node, next);
+  }
+  return false;
+}
+
+/*!
+ * @brief try to fuse next into node: the pair is executed by a single
+ * forward function, the weights of both nodes are kept
+ */
+AI_DECLARE_STATIC
+ai_bool graph_fuse_pair(ai_network* net, ai_node* node, ai_node* next)
+{
+  if ( !node->tensors || !next->tensors ) return false;
+  if ( GET_TENSOR_LIST_SIZE(GET_TENSOR_LIST_IN(node->tensors))!=1 ||
+       GET_TENSOR_LIST_SIZE(GET_TENSOR_LIST_OUT(node->tensors))!=1 ||
+       GET_TENSOR_LIST_SIZE(GET_TENSOR_LIST_IN(next->tensors))!=1 ||
+       GET_TENSOR_LIST_SIZE(GET_TENSOR_LIST_OUT(next->tensors))!=1 ) return false;
+
+  const ai_tensor* t_link = GET_TENSOR_OUT(node->tensors, 0);
+  if ( t_link!=GET_TENSOR_IN(next->tensors, 0) ) return false;
+  if ( !graph_tensor_is_inner(net, t_link) ) return false;
+
+  /* depthwise -> pointwise: the depthwise outputs stay in the cpu caches */
+  if ( !graph_node_is(node, AI_LAYER_CONV2D_TYPE) ||
+       !graph_node_is(next, AI_LAYER_CONV2D_TYPE) ||
+       !conv2d_dw_pw_is_fusable((const ai_layer_conv2d*)node,
+                                (const ai_layer_conv2d*)next) ) return false;
+
+  ai_graph_fold* fold = graph_fold_alloc(net, node, 0, 0);
+  if ( !fold ) return false;
+  fold->fused = next;
+  graph_fold_apply(fold, next, 0);
+  node->forward = AI_NODE_FORWARD_FUNC(forward_conv2d_dw_pw);
+  return true;
+}
+
+/******************************************************************************/
+AI_INTERNAL_API
+ai_u32 core_graph_fold(ai_network* net)
+{
+  ai_u32 n_folded = 0;
+  if ( !net ) return n_folded;
+
+  ai_node* node = net->input_node;
+  while ( node && !AI_NODE_IS_LAST(node) ) {
+    /* on success the same node is tried again with its new successor */
+    if ( graph_fold_pair(net, node, node->next) ) {
+      n_folded++;
+      continue;
+    }
+    node = node->next;
+  }
+
+  /* fusions of the folded graph: a fused node is not fused again */
+  node = net->input_node;
+  while ( node && !AI_NODE_IS_LAST(node) ) {
+    if ( graph_fuse_pair(net, node, node->next) ) n_folded++;
+    node = node->next;
+  }
+  return n_folded;
+}
+
+AI_INTERNAL_API
+ai_node* core_graph_get_fused(const ai_node* node)
+{
+  if ( !node || !node->network ) return NULL;
+  const ai_graph_fold* fold =
+    (const ai_graph_fold*)(*core_network_get_graph(node->network));
+  for ( ; fold; fold = fold->prev ) {
+    if ( (fold->node==node) && fold->fused ) return fold->fused;
+  }
+  return NULL;
+}
+
+AI_INTERNAL_API
+ai_handle core_graph_get_prepared(ai_node* node, const ai_handle key,
+                                  const ai_u32 tag, const ai_size size,
+                                  ai_bool* is_new)
+{
+  *is_new = false;
+  if ( !node || !node->network ) return NULL;
+  ai_handle* folds = core_network_get_graph(node->network);
+  ai_graph_fold** link = (ai_graph_fold**)folds;
+  for ( ai_graph_fold* fold = *link; fold; link = &fold->prev, fold = *link ) {
+    if ( !fold->prepared || (fold->node!=node) || (fold->tag!=tag) ) continue;
+    if ( fold->size==size ) {
+      /* other weights bound to the node: prepared again in place */
+      *is_new = (fold->key!=key);
+      fold->key = key;
+      return fold->data;
+    }
+    *link = fold->prev;
+    free(fold);
+    break;
+  }
+
+  ai_graph_fold* fold = graph_fold_alloc(node->network, node, 0,
+    (size + sizeof(ai_float) - 1) / sizeof(ai_float));
+  if ( !fold ) return NULL;
+  fold->prepared = true;
+  fold->key = key;
+  fold->tag = tag;
+  fold->size = size;
+  fold->prev = (ai_graph_fold*)(*folds);
+  *folds = AI_HANDLE_PTR(fold);
+  *is_new = true;
+  return fold->data;
+}
+
+AI_INTERNAL_API
+void core_graph_unfold(ai_network* net)
+{
+  ai_handle* folds = core_network_get_graph(net);
+  ai_graph_fold* fold = (ai_graph_fold*)(*folds);
+  while ( fold ) {
+    ai_graph_fold* prev = fold->prev;
+    if ( !fold->prepared ) {
+      fold->node->tensors = fold->saved_tensors;
+      fold->node->next = fold->saved_next;
+      fold->node->forward = fold->saved_forward;
+    }
+    free(fold);
+    fold = prev;
+  }
+  *folds = AI_HANDLE_NULL;
+}
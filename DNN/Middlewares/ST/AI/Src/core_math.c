@@ -0,0 +1,809 @@
+/**
+  ******************************************************************************
+  * @file    core_math.c
+  * @brief   implementation of the core vectorized math routines
+  ******************************************************************************
+  * @attention
+  *
+  * Open implementation of the float array functions declared in core_math.h.
+  *
+  * Approximations (Cephes single precision coefficients for exp, log and
+  * tanh, Chebyshev fits for erf):
+  *  - exp: x = n*ln2 + r, |r| <= ln2/2 (two constants Cody-Waite reduction),
+  *    e^r by a degree 6 (FAST: 4) polynomial, scaled by 2^n
+  *  - log: x = 2^e * (1+f), sqrt(1/2) <= 1+f < sqrt(2), log(1+f) by a degree
+  *    9 polynomial in f
+  *  - tanh: odd polynomial below 0.625, 1 - 2/(exp(2|x|)+1) above
+  *  - sigmoid: 1/(1+exp(-x)) for x >= 0, exp(x)/(1+exp(x)) below, the
+  *    rounding of the division and of 1+exp corrected by one Newton step
+  *  - erf: x + x*P(x^2) below 1, 1 - exp(Q(|x|) - x^2) up to 4 (Q fitting
+  *    log(erfc(x)) + x^2), 1 above
+  * Every lane computes all the branches and the results are blended, so
+  * the x86 variants have no data dependent branch.
+  *
+  ******************************************************************************
+  */
+
+#include <float.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "core_math.h"
+#include "core_cpu.h"
+#include "ai_math_helpers.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#define MATH_ACCURACY_UNKNOWN   (-1)
+
+/* exp: input range (result under half the smallest subnormal below,
+ * +inf above), log2(e) and ln(2) split in a 9 bits exact part and the rest */
+#define MATH_EXP_LO             (-104.0f)
+#define MATH_EXP_HI             (88.8f)
+#define MATH_LOG2E              (1.44269504088896341f)
+#define MATH_LN2_HI             (0.693359375f)
+#define MATH_LN2_LO             (-2.12194440e-4f)
+#define MATH_ROUND_MAGIC        (12582912.0f)   /* 1.5 * 2^23 */
+
+#define MATH_EXP_P0             (5.0000001201e-1f)
+#define MATH_EXP_P1             (1.6666665459e-1f)
+#define MATH_EXP_P2             (4.1665795894e-2f)
+#define MATH_EXP_P3             (8.3334519073e-3f)
+#define MATH_EXP_P4             (1.3981999507e-3f)
+#define MATH_EXP_P5             (1.9875691500e-4f)
+#define MATH_EXP_FAST_P1        (1.6666666667e-1f)
+#define MATH_EXP_FAST_P2        (4.1666666667e-2f)
+
+#define MATH_LOG_SQRTHF         (0.707106781186547524f)
+#define MATH_LOG_P0             (3.3333331174e-1f)
+#define MATH_LOG_P1             (-2.4999993993e-1f)
+#define MATH_LOG_P2             (2.0000714765e-1f)
+#define MATH_LOG_P3             (-1.6668057665e-1f)
+#define MATH_LOG_P4             (1.4249322787e-1f)
+#define MATH_LOG_P5             (-1.2420140846e-1f)
+#define MATH_LOG_P6             (1.1676998740e-1f)
+#define MATH_LOG_P7             (-1.1514610310e-1f)
+#define MATH_LOG_P8             (7.0376836292e-2f)
+
+#define MATH_TANH_SMALL         (0.625f)
+#define MATH_TANH_P0            (-3.33332819422e-1f)
+#define MATH_TANH_P1            (1.33314422036e-1f)
+#define MATH_TANH_P2            (-5.37397155531e-2f)
+#define MATH_TANH_P3            (2.06390887954e-2f)
+#define MATH_TANH_P4            (-5.70498872745e-3f)
+
+/* erf(x) = x + x*P(x^2) on [0, 1], P(0) = 2/sqrt(pi) - 1 */
+#define MATH_ERF_SMALL          (1.0f)
+#define MATH_ERF_P0             (1.2837916710e-01f)
+#define MATH_ERF_P1             (-3.761263788e-01f)
+#define MATH_ERF_P2             (1.128375381e-01f)
+#define MATH_ERF_P3             (-2.686169930e-02f)
+#define MATH_ERF_P4             (5.204578862e-03f)
+#define MATH_ERF_P5             (-8.161986480e-04f)
+#define MATH_ERF_P6             (8.379755309e-05f)
+/* log(erfc(x)) + x^2 as a polynomial of x-2.5 on [1, 4], erf(x) rounds to 1
+ * above */
+#define MATH_ERF_LARGE          (4.0f)
+#define MATH_ERF_Q_CENTER       (2.5f)
+#define MATH_ERF_Q0             (-1.556815267e+00f)
+#define MATH_ERF_Q1             (-3.526806831e-01f)
+#define MATH_ERF_Q2             (5.610629544e-02f)
+#define MATH_ERF_Q3             (-1.085854135e-02f)
+#define MATH_ERF_Q4             (2.165303566e-03f)
+#define MATH_ERF_Q5             (-4.201225238e-04f)
+#define MATH_ERF_Q6             (7.729137724e-05f)
+#define MATH_ERF_Q7             (-1.331501426e-05f)
+#define MATH_ERF_Q8             (1.637151399e-06f)
+
+AI_STATIC ai_i32 g_math_accuracy = MATH_ACCURACY_UNKNOWN;
+
+/******************************************************************************/
+AI_DECLARE_STATIC
+ai_math_accuracy core_math_read_accuracy(void)
+{
+  const char* env = getenv("AI_MATH_ACCURACY");
+  if ( env ) {
+    if ( !strcmp(env, "libm") ) return AI_MATH_ACCURACY_LIBM;
+    if ( !strcmp(env, "ulp2") ) return AI_MATH_ACCURACY_ULP2;
+    if ( !strcmp(env, "fast") ) return AI_MATH_ACCURACY_FAST;
+  }
+  return AI_MATH_ACCURACY_DEFAULT;
+}
+
+AI_INTERNAL_API
+ai_math_accuracy core_math_get_accuracy(void)
+{
+  /* concurrent first calls store the same value */
+  ai_i32 accuracy = __atomic_load_n(&g_math_accuracy, __ATOMIC_RELAXED);
+  if ( accuracy==MATH_ACCURACY_UNKNOWN ) {
+    accuracy = (ai_i32)core_math_read_accuracy();
+    __atomic_store_n(&g_math_accuracy, accuracy, __ATOMIC_RELAXED);
+  }
+  return (ai_math_accuracy)accuracy;
+}
+
+/******************************************************************************/
+/* Generic variants, also used for the tails of the x86 ones */
+typedef union {
+  ai_u32   u;
+  ai_float f;
+} math_f32_bits;
+
+AI_DECLARE_STATIC
+ai_float math_pow2i(const ai_i32 n)
+{
+  math_f32_bits v;
+  v.u = (ai_u32)(n + 127) << 23;
+  return v.f;
+}
+
+AI_DECLARE_STATIC
+ai_float math_exp_f32(const ai_float x, const ai_bool fast)
+{
+  if ( x!=x ) return x + x;
+  const ai_float xc = AI_CLAMP(x, MATH_EXP_LO, MATH_EXP_HI);
+  /* round to nearest even with the 1.5*2^23 trick: |x*log2(e)| < 2^22 */
+  const ai_float nf = (xc * MATH_LOG2E + MATH_ROUND_MAGIC) - MATH_ROUND_MAGIC;
+  const ai_i32 n = (ai_i32)nf;
+  ai_float r = xc - nf * MATH_LN2_HI;
+  r = r - nf * MATH_LN2_LO;
+  const ai_float z = r * r;
+  ai_float p;
+  if ( fast ) {
+    p = (MATH_EXP_FAST_P2 * r + MATH_EXP_FAST_P1) * r + MATH_EXP_P0;
+  } else {
+    p = MATH_EXP_P5 * r + MATH_EXP_P4;
+    p = p * r + MATH_EXP_P3;
+    p = p * r + MATH_EXP_P2;
+    p = p * r + MATH_EXP_P1;
+    p = p * r + MATH_EXP_P0;
+  }
+  p = (p * z + r) + 1.0f;
+  /* 2^n in two factors: n is in [-150, 128] */
+  const ai_i32 n1 = n / 2;
+  return (p * math_pow2i(n1)) * math_pow2i(n - n1);
+}
+
+AI_DECLARE_STATIC
+ai_float math_log_f32(const ai_float x, const ai_bool fast)
+{
+  AI_UNUSED(fast)
+  if ( !(x>0.0f) || (x==INFINITY) ) return AI_MATH_LOG(x);
+  math_f32_bits v;
+  ai_float e = 0.0f;
+  v.f = x;
+  if ( x<FLT_MIN ) {
+    v.f = x * 8388608.0f;   /* 2^23 */
+    e = -23.0f;
+  }
+  e += (ai_float)((ai_i32)(v.u >> 23) - 126);
+  v.u = (v.u & 0x007FFFFFU) | 0x3F000000U;
+  ai_float m = v.f;
+  if ( m<MATH_LOG_SQRTHF ) {
+    e -= 1.0f;
+    m = (m + m) - 1.0f;
+  } else {
+    m = m - 1.0f;
+  }
+  const ai_float z = m * m;
+  ai_float y = MATH_LOG_P8 * m + MATH_LOG_P7;
+  y = y * m + MATH_LOG_P6;
+  y = y * m + MATH_LOG_P5;
+  y = y * m + MATH_LOG_P4;
+  y = y * m + MATH_LOG_P3;
+  y = y * m + MATH_LOG_P2;
+  y = y * m + MATH_LOG_P1;
+  y = y * m + MATH_LOG_P0;
+  y = y * m * z;
+  y += e * MATH_LN2_LO;
+  y -= 0.5f * z;
+  m += y;
+  return m + e * MATH_LN2_HI;
+}
+
+AI_DECLARE_STATIC
+ai_float math_tanh_f32(const ai_float x, const ai_bool fast)
+{
+  const ai_float a = fabsf(x);
+  if ( a<MATH_TANH_SMALL ) {
+    const ai_float z = x * x;
+    ai_float p = MATH_TANH_P4 * z + MATH_TANH_P3;
+    p = p * z + MATH_TANH_P2;
+    p = p * z + MATH_TANH_P1;
+    p = p * z + MATH_TANH_P0;
+    /* p * z <= 0: the sign of a zero x is lost by the product */
+    return copysignf((p * z) * x + x, x);
+  }
+  const ai_float t = 1.0f - 2.0f / (math_exp_f32(a + a, fast) + 1.0f);
+  return copysignf(t, x);
+}
+
+AI_DECLARE_STATIC
+ai_float math_sigmoid_f32(const ai_float x, const ai_bool fast)
+{
+  const ai_float e = math_exp_f32(-fabsf(x), fast);
+  const ai_float num = (x<0.0f) ? e : 1.0f;
+  /* d + d_lo = 1 + e exactly (e <= 1), one correction step on num/(1+e) */
+  const ai_float d = 1.0f + e;
+  const ai_float d_lo = (1.0f - d) + e;
+  const ai_float r = 1.0f / d;
+  const ai_float q = num * r;
+  return q + (fmaf(-q, d, num) - q * d_lo) * r;
+}
+
+AI_DECLARE_STATIC
+ai_float math_erf_f32(const ai_float x, const ai_bool fast)
+{
+  if ( x!=x ) return x + x;
+  const ai_float a = fabsf(x);
+  if ( a<MATH_ERF_SMALL ) {
+    const ai_float z = x * x;
+    ai_float p = MATH_ERF_P6 * z + MATH_ERF_P5;
+    p = p * z + MATH_ERF_P4;
+    p = p * z + MATH_ERF_P3;
+    p = p * z + MATH_ERF_P2;
+    p = p * z + MATH_ERF_P1;
+    p = p * z + MATH_ERF_P0;
+    return x * p + x;
+  }
+  if ( a>=MATH_ERF_LARGE ) return copysignf(1.0f, x);
+  const ai_float t = a - MATH_ERF_Q_CENTER;
+  ai_float q = MATH_ERF_Q8 * t + MATH_ERF_Q7;
+  q = q * t + MATH_ERF_Q6;
+  q = q * t + MATH_ERF_Q5;
+  q = q * t + MATH_ERF_Q4;
+  q = q * t + MATH_ERF_Q3;
+  q = q * t + MATH_ERF_Q2;
+  q = q * t + MATH_ERF_Q1;
+  q = q * t + MATH_ERF_Q0;
+  return copysignf(1.0f - math_exp_f32(q - a * a, fast), x);
+}
+
+/******************************************************************************/
+#if defined(__x86_64__) || defined(__i386__)
+
+#define MATH_SIGN_MASK          (0x80000000U)
+
+/* AVX2 + FMA: 8 lanes */
+AI_DECLARE_STATIC __attribute__((target("avx2,fma")))
+__m256 math_exp_avx2(const __m256 x, const ai_bool fast)
+{
+  const __m256 xc = _mm256_min_ps(
+    _mm256_max_ps(x, _mm256_set1_ps(MATH_EXP_LO)), _mm256_set1_ps(MATH_EXP_HI));
+  const __m256 nf = _mm256_round_ps(_mm256_mul_ps(xc, _mm256_set1_ps(MATH_LOG2E)),
+                                    _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+  __m256 r = _mm256_fnmadd_ps(nf, _mm256_set1_ps(MATH_LN2_HI), xc);
+  r = _mm256_fnmadd_ps(nf, _mm256_set1_ps(MATH_LN2_LO), r);
+  const __m256 z = _mm256_mul_ps(r, r);
+  __m256 p;
+  if ( fast ) {
+    p = _mm256_fmadd_ps(_mm256_set1_ps(MATH_EXP_FAST_P2), r,
+                        _mm256_set1_ps(MATH_EXP_FAST_P1));
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(MATH_EXP_P0));
+  } else {
+    p = _mm256_fmadd_ps(_mm256_set1_ps(MATH_EXP_P5), r, _mm256_set1_ps(MATH_EXP_P4));
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(MATH_EXP_P3));
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(MATH_EXP_P2));
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(MATH_EXP_P1));
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(MATH_EXP_P0));
+  }
+  p = _mm256_add_ps(_mm256_fmadd_ps(p, z, r), _mm256_set1_ps(1.0f));
+  /* 2^n in two factors: n is in [-150, 128] */
+  const __m256i n = _mm256_cvtps_epi32(nf);
+  const __m256i n1 = _mm256_srai_epi32(n, 1);
+  const __m256i n2 = _mm256_sub_epi32(n, n1);
+  const __m256i bias = _mm256_set1_epi32(127);
+  p = _mm256_mul_ps(p, _mm256_castsi256_ps(
+    _mm256_slli_epi32(_mm256_add_epi32(n1, bias), 23)));
+  p = _mm256_mul_ps(p, _mm256_castsi256_ps(
+    _mm256_slli_epi32(_mm256_add_epi32(n2, bias), 23)));
+  return _mm256_blendv_ps(p, x, _mm256_cmp_ps(x, x, _CMP_UNORD_Q));
+}
+
+AI_DECLARE_STATIC __attribute__((target("avx2,fma")))
+__m256 math_log_avx2(const __m256 x, const ai_bool fast)
+{
+  AI_UNUSED(fast)
+  const __m256 tiny = _mm256_cmp_ps(x, _mm256_set1_ps(FLT_MIN), _CMP_LT_OQ);
+  const __m256 xs = _mm256_blendv_ps(x, _mm256_mul_ps(x, _mm256_set1_ps(8388608.0f)),
+                                     tiny);
+  const __m256i u = _mm256_castps_si256(xs);
+  __m256 e = _mm256_cvtepi32_ps(
+    _mm256_sub_epi32(_mm256_srli_epi32(u, 23), _mm256_set1_epi32(126)));
+  e = _mm256_sub_ps(e, _mm256_and_ps(tiny, _mm256_set1_ps(23.0f)));
+  __m256 m = _mm256_castsi256_ps(_mm256_or_si256(
+    _mm256_and_si256(u, _mm256_set1_epi32(0x007FFFFF)),
+    _mm256_set1_epi32(0x3F000000)));
+  const __m256 lt = _mm256_cmp_ps(m, _mm256_set1_ps(MATH_LOG_SQRTHF), _CMP_LT_OQ);
+  e = _mm256_sub_ps(e, _mm256_and_ps(lt, _mm256_set1_ps(1.0f)));
+  m = _mm256_sub_ps(_mm256_add_ps(m, _mm256_and_ps(lt, m)), _mm256_set1_ps(1.0f));
+  const __m256 z = _mm256_mul_ps(m, m);
+  __m256 y = _mm256_fmadd_ps(_mm256_set1_ps(MATH_LOG_P8), m, _mm256_set1_ps(MATH_LOG_P7));
+  y = _mm256_fmadd_ps(y, m, _mm256_set1_ps(MATH_LOG_P6));
+  y = _mm256_fmadd_ps(y, m, _mm256_set1_ps(MATH_LOG_P5));
+  y = _mm256_fmadd_ps(y, m, _mm256_set1_ps(MATH_LOG_P4));
+  y = _mm256_fmadd_ps(y, m, _mm256_set1_ps(MATH_LOG_P3));
+  y = _mm256_fmadd_ps(y, m, _mm256_set1_ps(MATH_LOG_P2));
+  y = _mm256_fmadd_ps(y, m, _mm256_set1_ps(MATH_LOG_P1));
+  y = _mm256_fmadd_ps(y, m, _mm256_set1_ps(MATH_LOG_P0));
+  y = _mm256_mul_ps(_mm256_mul_ps(y, m), z);
+  y = _mm256_fmadd_ps(e, _mm256_set1_ps(MATH_LN2_LO), y);
+  y = _mm256_fnmadd_ps(_mm256_set1_ps(0.5f), z, y);
+  m = _mm256_add_ps(m, y);
+  m = _mm256_fmadd_ps(e, _mm256_set1_ps(MATH_LN2_HI), m);
+  /* log(+-0) = -inf, log(+inf) = +inf, log(x<0) = log(NaN) = NaN */
+  m = _mm256_blendv_ps(m, _mm256_set1_ps(-INFINITY),
+                       _mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_EQ_OQ));
+  m = _mm256_blendv_ps(m, x, _mm256_cmp_ps(x, _mm256_set1_ps(INFINITY), _CMP_EQ_OQ));
+  m = _mm256_blendv_ps(m, _mm256_set1_ps(NAN),
+                       _mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_NGE_UQ));
+  return m;
+}
+
+AI_DECLARE_STATIC __attribute__((target("avx2,fma")))
+__m256 math_tanh_avx2(const __m256 x, const ai_bool fast)
+{
+  const __m256 sign = _mm256_castsi256_ps(_mm256_set1_epi32(MATH_SIGN_MASK));
+  const __m256 a = _mm256_andnot_ps(sign, x);
+  const __m256 z = _mm256_mul_ps(x, x);
+  __m256 p = _mm256_fmadd_ps(_mm256_set1_ps(MATH_TANH_P4), z, _mm256_set1_ps(MATH_TANH_P3));
+  p = _mm256_fmadd_ps(p, z, _mm256_set1_ps(MATH_TANH_P2));
+  p = _mm256_fmadd_ps(p, z, _mm256_set1_ps(MATH_TANH_P1));
+  p = _mm256_fmadd_ps(p, z, _mm256_set1_ps(MATH_TANH_P0));
+  const __m256 small = _mm256_fmadd_ps(_mm256_mul_ps(p, z), x, x);
+  const __m256 e = math_exp_avx2(_mm256_add_ps(a, a), fast);
+  __m256 t = _mm256_sub_ps(_mm256_set1_ps(1.0f),
+    _mm256_div_ps(_mm256_set1_ps(2.0f), _mm256_add_ps(e, _mm256_set1_ps(1.0f))));
+  t = _mm256_blendv_ps(t, small,
+                       _mm256_cmp_ps(a, _mm256_set1_ps(MATH_TANH_SMALL), _CMP_LT_OQ));
+  /* sign of x on both branches, including the zeros */
+  return _mm256_or_ps(_mm256_andnot_ps(sign, t), _mm256_and_ps(x, sign));
+}
+
+AI_DECLARE_STATIC __attribute__((target("avx2,fma")))
+__m256 math_sigmoid_avx2(const __m256 x, const ai_bool fast)
+{
+  const __m256 sign = _mm256_castsi256_ps(_mm256_set1_epi32(MATH_SIGN_MASK));
+  const __m256 e = math_exp_avx2(_mm256_or_ps(x, sign), fast);
+  const __m256 one = _mm256_set1_ps(1.0f);
+  const __m256 num = _mm256_blendv_ps(one, e,
+                                      _mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_LT_OQ));
+  const __m256 d = _mm256_add_ps(one, e);
+  const __m256 d_lo = _mm256_add_ps(_mm256_sub_ps(one, d), e);
+  const __m256 r = _mm256_div_ps(one, d);
+  const __m256 q = _mm256_mul_ps(num, r);
+  const __m256 res = _mm256_fnmadd_ps(q, d_lo, _mm256_fnmadd_ps(q, d, num));
+  return _mm256_fmadd_ps(res, r, q);
+}
+
+AI_DECLARE_STATIC __attribute__((target("avx2,fma")))
+__m256 math_erf_avx2(const __m256 x, const ai_bool fast)
+{
+  const __m256 sign = _mm256_castsi256_ps(_mm256_set1_epi32(MATH_SIGN_MASK));
+  const __m256 a = _mm256_andnot_ps(sign, x);
+  const __m256 z = _mm256_mul_ps(x, x);
+  __m256 p = _mm256_fmadd_ps(_mm256_set1_ps(MATH_ERF_P6), z, _mm256_set1_ps(MATH_ERF_P5));
+  p = _mm256_fmadd_ps(p, z, _mm256_set1_ps(MATH_ERF_P4));
+  p = _mm256_fmadd_ps(p, z, _mm256_set1_ps(MATH_ERF_P3));
+  p = _mm256_fmadd_ps(p, z, _mm256_set1_ps(MATH_ERF_P2));
+  p = _mm256_fmadd_ps(p, z, _mm256_set1_ps(MATH_ERF_P1));
+  p = _mm256_fmadd_ps(p, z, _mm256_set1_ps(MATH_ERF_P0));
+  const __m256 small = _mm256_fmadd_ps(x, p, x);
+  /* |x| clamped: no subnormal exp in the lanes where erf rounds to 1 */
+  const __m256 al = _mm256_min_ps(a, _mm256_set1_ps(MATH_ERF_LARGE));
+  const __m256 t = _mm256_sub_ps(al, _mm256_set1_ps(MATH_ERF_Q_CENTER));
+  __m256 q = _mm256_fmadd_ps(_mm256_set1_ps(MATH_ERF_Q8), t, _mm256_set1_ps(MATH_ERF_Q7));
+  q = _mm256_fmadd_ps(q, t, _mm256_set1_ps(MATH_ERF_Q6));
+  q = _mm256_fmadd_ps(q, t, _mm256_set1_ps(MATH_ERF_Q5));
+  q = _mm256_fmadd_ps(q, t, _mm256_set1_ps(MATH_ERF_Q4));
+  q = _mm256_fmadd_ps(q, t, _mm256_set1_ps(MATH_ERF_Q3));
+  q = _mm256_fmadd_ps(q, t, _mm256_set1_ps(MATH_ERF_Q2));
+  q = _mm256_fmadd_ps(q, t, _mm256_set1_ps(MATH_ERF_Q1));
+  q = _mm256_fmadd_ps(q, t, _mm256_set1_ps(MATH_ERF_Q0));
+  __m256 large = _mm256_sub_ps(_mm256_set1_ps(1.0f),
+                               math_exp_avx2(_mm256_fnmadd_ps(al, al, q), fast));
+  large = _mm256_blendv_ps(_mm256_set1_ps(1.0f), large,
+    _mm256_cmp_ps(a, _mm256_set1_ps(MATH_ERF_LARGE), _CMP_LT_OQ));
+  large = _mm256_or_ps(large, _mm256_and_ps(x, sign));
+  const __m256 y = _mm256_blendv_ps(large, small,
+    _mm256_cmp_ps(a, _mm256_set1_ps(MATH_ERF_SMALL), _CMP_LT_OQ));
+  return _mm256_blendv_ps(y, x, _mm256_cmp_ps(x, x, _CMP_UNORD_Q));
+}
+
+/* AVX-512F: 16 lanes, the bitwise float operations done on the integer
+ * registers (_mm512_and_ps & co are AVX-512DQ) */
+#define MATH_PS512_AND(a_, b_) \
+  _mm512_castsi512_ps(_mm512_and_si512(_mm512_castps_si512(a_), _mm512_castps_si512(b_)))
+#define MATH_PS512_OR(a_, b_) \
+  _mm512_castsi512_ps(_mm512_or_si512(_mm512_castps_si512(a_), _mm512_castps_si512(b_)))
+
+AI_DECLARE_STATIC __attribute__((target("avx512f")))
+__m512 math_exp_avx512(const __m512 x, const ai_bool fast)
+{
+  const __m512 xc = _mm512_min_ps(
+    _mm512_max_ps(x, _mm512_set1_ps(MATH_EXP_LO)), _mm512_set1_ps(MATH_EXP_HI));
+  const __m512 nf = _mm512_roundscale_ps(_mm512_mul_ps(xc, _mm512_set1_ps(MATH_LOG2E)),
+                                         _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+  __m512 r = _mm512_fnmadd_ps(nf, _mm512_set1_ps(MATH_LN2_HI), xc);
+  r = _mm512_fnmadd_ps(nf, _mm512_set1_ps(MATH_LN2_LO), r);
+  const __m512 z = _mm512_mul_ps(r, r);
+  __m512 p;
+  if ( fast ) {
+    p = _mm512_fmadd_ps(_mm512_set1_ps(MATH_EXP_FAST_P2), r,
+                        _mm512_set1_ps(MATH_EXP_FAST_P1));
+    p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(MATH_EXP_P0));
+  } else {
+    p = _mm512_fmadd_ps(_mm512_set1_ps(MATH_EXP_P5), r, _mm512_set1_ps(MATH_EXP_P4));
+    p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(MATH_EXP_P3));
+    p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(MATH_EXP_P2));
+    p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(MATH_EXP_P1));
+    p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(MATH_EXP_P0));
+  }
+  p = _mm512_add_ps(_mm512_fmadd_ps(p, z, r), _mm512_set1_ps(1.0f));
+  /* p * 2^n, rounded once (subnormal results included) */
+  p = _mm512_scalef_ps(p, nf);
+  return _mm512_mask_blend_ps(_mm512_cmp_ps_mask(x, x, _CMP_UNORD_Q), p, x);
+}
+
+AI_DECLARE_STATIC __attribute__((target("avx512f")))
+__m512 math_log_avx512(const __m512 x, const ai_bool fast)
+{
+  AI_UNUSED(fast)
+  const __mmask16 tiny = _mm512_cmp_ps_mask(x, _mm512_set1_ps(FLT_MIN), _CMP_LT_OQ);
+  const __m512 xs = _mm512_mask_mul_ps(x, tiny, x, _mm512_set1_ps(8388608.0f));
+  const __m512i u = _mm512_castps_si512(xs);
+  __m512 e = _mm512_cvtepi32_ps(
+    _mm512_sub_epi32(_mm512_srli_epi32(u, 23), _mm512_set1_epi32(126)));
+  e = _mm512_mask_sub_ps(e, tiny, e, _mm512_set1_ps(23.0f));
+  __m512 m = _mm512_castsi512_ps(_mm512_or_si512(
+    _mm512_and_si512(u, _mm512_set1_epi32(0x007FFFFF)),
+    _mm512_set1_epi32(0x3F000000)));
+  const __mmask16 lt = _mm512_cmp_ps_mask(m, _mm512_set1_ps(MATH_LOG_SQRTHF), _CMP_LT_OQ);
+  e = _mm512_mask_sub_ps(e, lt, e, _mm512_set1_ps(1.0f));
+  m = _mm512_sub_ps(_mm512_mask_add_ps(m, lt, m, m), _mm512_set1_ps(1.0f));
+  const __m512 z = _mm512_mul_ps(m, m);
+  __m512 y = _mm512_fmadd_ps(_mm512_set1_ps(MATH_LOG_P8), m, _mm512_set1_ps(MATH_LOG_P7));
+  y = _mm512_fmadd_ps(y, m, _mm512_set1_ps(MATH_LOG_P6));
+  y = _mm512_fmadd_ps(y, m, _mm512_set1_ps(MATH_LOG_P5));
+  y = _mm512_fmadd_ps(y, m, _mm512_set1_ps(MATH_LOG_P4));
+  y = _mm512_fmadd_ps(y, m, _mm512_set1_ps(MATH_LOG_P3));
+  y = _mm512_fmadd_ps(y, m, _mm512_set1_ps(MATH_LOG_P2));
+  y = _mm512_fmadd_ps(y, m, _mm512_set1_ps(MATH_LOG_P1));
+  y = _mm512_fmadd_ps(y, m, _mm512_set1_ps(MATH_LOG_P0));
+  y = _mm512_mul_ps(_mm512_mul_ps(y, m), z);
+  y = _mm512_fmadd_ps(e, _mm512_set1_ps(MATH_LN2_LO), y);
+  y = _mm512_fnmadd_ps(_mm512_set1_ps(0.5f), z, y);
+  m = _mm512_add_ps(m, y);
+  m = _mm512_fmadd_ps(e, _mm512_set1_ps(MATH_LN2_HI), m);
+  /* log(+-0) = -inf, log(+inf) = +inf, log(x<0) = log(NaN) = NaN */
+  m = _mm512_mask_blend_ps(_mm512_cmp_ps_mask(x, _mm512_setzero_ps(), _CMP_EQ_OQ),
+                           m, _mm512_set1_ps(-INFINITY));
+  m = _mm512_mask_blend_ps(_mm512_cmp_ps_mask(x, _mm512_set1_ps(INFINITY), _CMP_EQ_OQ),
+                           m, x);
+  m = _mm512_mask_blend_ps(_mm512_cmp_ps_mask(x, _mm512_setzero_ps(), _CMP_NGE_UQ),
+                           m, _mm512_set1_ps(NAN));
+  return m;
+}
+
+AI_DECLARE_STATIC __attribute__((target("avx512f")))
+__m512 math_tanh_avx512(const __m512 x, const ai_bool fast)
+{
+  const __m512 sign = _mm512_castsi512_ps(_mm512_set1_epi32(MATH_SIGN_MASK));
+  const __m512 a = _mm512_abs_ps(x);
+  const __m512 z = _mm512_mul_ps(x, x);
+  __m512 p = _mm512_fmadd_ps(_mm512_set1_ps(MATH_TANH_P4), z, _mm512_set1_ps(MATH_TANH_P3));
+  p = _mm512_fmadd_ps(p, z, _mm512_set1_ps(MATH_TANH_P2));
+  p = _mm512_fmadd_ps(p, z, _mm512_set1_ps(MATH_TANH_P1));
+  p = _mm512_fmadd_ps(p, z, _mm512_set1_ps(MATH_TANH_P0));
+  const __m512 small = _mm512_fmadd_ps(_mm512_mul_ps(p, z), x, x);
+  const __m512 e = math_exp_avx512(_mm512_add_ps(a, a), fast);
+  __m512 t = _mm512_sub_ps(_mm512_set1_ps(1.0f),
+    _mm512_div_ps(_mm512_set1_ps(2.0f), _mm512_add_ps(e, _mm512_set1_ps(1.0f))));
+  t = _mm512_mask_blend_ps(
+    _mm512_cmp_ps_mask(a, _mm512_set1_ps(MATH_TANH_SMALL), _CMP_LT_OQ), t, small);
+  /* sign of x on both branches, including the zeros */
+  return MATH_PS512_OR(_mm512_abs_ps(t), MATH_PS512_AND(x, sign));
+}
+
+AI_DECLARE_STATIC __attribute__((target("avx512f")))
+__m512 math_sigmoid_avx512(const __m512 x, const ai_bool fast)
+{
+  const __m512 sign = _mm512_castsi512_ps(_mm512_set1_epi32(MATH_SIGN_MASK));
+  const __m512 e = math_exp_avx512(MATH_PS512_OR(x, sign), fast);
+  const __m512 one = _mm512_set1_ps(1.0f);
+  const __m512 num = _mm512_mask_blend_ps(
+    _mm512_cmp_ps_mask(x, _mm512_setzero_ps(), _CMP_LT_OQ), one, e);
+  const __m512 d = _mm512_add_ps(one, e);
+  const __m512 d_lo = _mm512_add_ps(_mm512_sub_ps(one, d), e);
+  const __m512 r = _mm512_div_ps(one, d);
+  const __m512 q = _mm512_mul_ps(num, r);
+  const __m512 res = _mm512_fnmadd_ps(q, d_lo, _mm512_fnmadd_ps(q, d, num));
+  return _mm512_fmadd_ps(res, r, q);
+}
+
+AI_DECLARE_STATIC __attribute__((target("avx512f")))
+__m512 math_erf_avx512(const __m512 x, const ai_bool fast)
+{
+  const __m512 sign = _mm512_castsi512_ps(_mm512_set1_epi32(MATH_SIGN_MASK));
+  const __m512 a = _mm512_abs_ps(x);
+  const __m512 z = _mm512_mul_ps(x, x);
+  __m512 p = _mm512_fmadd_ps(_mm512_set1_ps(MATH_ERF_P6), z, _mm512_set1_ps(MATH_ERF_P5));
+  p = _mm512_fmadd_ps(p, z, _mm512_set1_ps(MATH_ERF_P4));
+  p = _mm512_fmadd_ps(p, z, _mm512_set1_ps(MATH_ERF_P3));
+  p = _mm512_fmadd_ps(p, z, _mm512_set1_ps(MATH_ERF_P2));
+  p = _mm512_fmadd_ps(p, z, _mm512_set1_ps(MATH_ERF_P1));
+  p = _mm512_fmadd_ps(p, z, _mm512_set1_ps(MATH_ERF_P0));
+  const __m512 small = _mm512_fmadd_ps(x, p, x);
+  /* |x| clamped: no subnormal exp in the lanes where erf rounds to 1 */
+  const __m512 al = _mm512_min_ps(a, _mm512_set1_ps(MATH_ERF_LARGE));
+  const __m512 t = _mm512_sub_ps(al, _mm512_set1_ps(MATH_ERF_Q_CENTER));
+  __m512 q = _mm512_fmadd_ps(_mm512_set1_ps(MATH_ERF_Q8), t, _mm512_set1_ps(MATH_ERF_Q7));
+  q = _mm512_fmadd_ps(q, t, _mm512_set1_ps(MATH_ERF_Q6));
+  q = _mm512_fmadd_ps(q, t, _mm512_set1_ps(MATH_ERF_Q5));
+  q = _mm512_fmadd_ps(q, t, _mm512_set1_ps(MATH_ERF_Q4));
+  q = _mm512_fmadd_ps(q, t, _mm512_set1_ps(MATH_ERF_Q3));
+  q = _mm512_fmadd_ps(q, t, _mm512_set1_ps(MATH_ERF_Q2));
+  q = _mm512_fmadd_ps(q, t, _mm512_set1_ps(MATH_ERF_Q1));
+  q = _mm512_fmadd_ps(q, t, _mm512_set1_ps(MATH_ERF_Q0));
+  __m512 large = _mm512_sub_ps(_mm512_set1_ps(1.0f),
+                               math_exp_avx512(_mm512_fnmadd_ps(al, al, q), fast));
+  large = _mm512_mask_blend_ps(
+    _mm512_cmp_ps_mask(a, _mm512_set1_ps(MATH_ERF_LARGE), _CMP_LT_OQ),
+    _mm512_set1_ps(1.0f), large);
+  large = MATH_PS512_OR(large, MATH_PS512_AND(x, sign));
+  const __m512 y = _mm512_mask_blend_ps(
+    _mm512_cmp_ps_mask(a, _mm512_set1_ps(MATH_ERF_SMALL), _CMP_LT_OQ), large, small);
+  return _mm512_mask_blend_ps(_mm512_cmp_ps_mask(x, x, _CMP_UNORD_Q), y, x);
+}
+
+/*!
+ * @brief define the array loops math_<name_>_array_avx2 (returns the number
+ * of values done, multiple of 8) and math_<name_>_array_avx512 (masked tail)
+ */
+#define MATH_ARRAY_X86(name_) \
+AI_DECLARE_STATIC __attribute__((target("avx2,fma"))) \
+ai_size math_ ## name_ ## _array_avx2(ai_float* out, const ai_float* in, \
+                                      const ai_size size, const ai_bool fast) \
+{ \
+  ai_size i = 0; \
+  for ( ; i+8<=size; i+=8 ) { \
+    _mm256_storeu_ps(out + i, math_ ## name_ ## _avx2(_mm256_loadu_ps(in + i), fast)); \
+  } \
+  return i; \
+} \
+\
+AI_DECLARE_STATIC __attribute__((target("avx512f"))) \
+ai_size math_ ## name_ ## _array_avx512(ai_float* out, const ai_float* in, \
+                                        const ai_size size, const ai_bool fast) \
+{ \
+  ai_size i = 0; \
+  for ( ; i+16<=size; i+=16 ) { \
+    _mm512_storeu_ps(out + i, math_ ## name_ ## _avx512(_mm512_loadu_ps(in + i), fast)); \
+  } \
+  if ( i<size ) { \
+    const __mmask16 k = (__mmask16)((1U << (size - i)) - 1); \
+    _mm512_mask_storeu_ps(out + i, k, \
+      math_ ## name_ ## _avx512(_mm512_maskz_loadu_ps(k, in + i), fast)); \
+  } \
+  return size; \
+}
+
+MATH_ARRAY_X86(exp)
+MATH_ARRAY_X86(log)
+MATH_ARRAY_X86(tanh)
+MATH_ARRAY_X86(sigmoid)
+MATH_ARRAY_X86(erf)
+
+/* Softmax reductions: the differences are clamped to MATH_EXP_LO so that
+ * the -inf inputs (masked logits) give exp(-inf - -inf) = 0, not NaN. The
+ * online pass keeps a running maximum and sum per lane, updated once per
+ * block of 4 vectors, and merges the lanes at the end */
+AI_DECLARE_STATIC __attribute__((target("avx2,fma")))
+ai_size math_max_exp_sum_avx2(const ai_float* in, const ai_size size,
+                              const ai_bool fast, ai_float* max, ai_float* sum)
+{
+  const __m256 lo = _mm256_set1_ps(MATH_EXP_LO);
+  __m256 vm = _mm256_set1_ps(-INFINITY);
+  __m256 vs = _mm256_setzero_ps();
+  ai_size i = 0;
+  if ( size<32 ) return 0;
+  for ( ; i+32<=size; i+=32 ) {
+    const __m256 v0 = _mm256_loadu_ps(in + i);
+    const __m256 v1 = _mm256_loadu_ps(in + i + 8);
+    const __m256 v2 = _mm256_loadu_ps(in + i + 16);
+    const __m256 v3 = _mm256_loadu_ps(in + i + 24);
+    const __m256 mn = _mm256_max_ps(vm,
+      _mm256_max_ps(_mm256_max_ps(v0, v1), _mm256_max_ps(v2, v3)));
+    vs = _mm256_mul_ps(vs, math_exp_avx2(_mm256_max_ps(_mm256_sub_ps(vm, mn), lo), fast));
+    vs = _mm256_add_ps(vs, math_exp_avx2(_mm256_max_ps(_mm256_sub_ps(v0, mn), lo), fast));
+    vs = _mm256_add_ps(vs, math_exp_avx2(_mm256_max_ps(_mm256_sub_ps(v1, mn), lo), fast));
+    vs = _mm256_add_ps(vs, math_exp_avx2(_mm256_max_ps(_mm256_sub_ps(v2, mn), lo), fast));
+    vs = _mm256_add_ps(vs, math_exp_avx2(_mm256_max_ps(_mm256_sub_ps(v3, mn), lo), fast));
+    vm = mn;
+  }
+  ai_float lanes[8];
+  _mm256_storeu_ps(lanes, vm);
+  ai_float m = lanes[0];
+  for ( ai_size l=1; l<8; l++ ) m = AI_MAX(m, lanes[l]);
+  vs = _mm256_mul_ps(vs, math_exp_avx2(
+    _mm256_max_ps(_mm256_sub_ps(vm, _mm256_set1_ps(m)), lo), fast));
+  _mm256_storeu_ps(lanes, vs);
+  ai_float s = 0.0f;
+  for ( ai_size l=0; l<8; l++ ) s += lanes[l];
+  *max = m;
+  *sum = s;
+  return i;
+}
+
+AI_DECLARE_STATIC __attribute__((target("avx512f")))
+ai_size math_max_exp_sum_avx512(const ai_float* in, const ai_size size,
+                                const ai_bool fast, ai_float* max, ai_float* sum)
+{
+  const __m512 lo = _mm512_set1_ps(MATH_EXP_LO);
+  __m512 vm = _mm512_set1_ps(-INFINITY);
+  __m512 vs = _mm512_setzero_ps();
+  ai_size i = 0;
+  if ( size<64 ) return 0;
+  for ( ; i+64<=size; i+=64 ) {
+    const __m512 v0 = _mm512_loadu_ps(in + i);
+    const __m512 v1 = _mm512_loadu_ps(in + i + 16);
+    const __m512 v2 = _mm512_loadu_ps(in + i + 32);
+    const __m512 v3 = _mm512_loadu_ps(in + i + 48);
+    const __m512 mn = _mm512_max_ps(vm,
+      _mm512_max_ps(_mm512_max_ps(v0, v1), _mm512_max_ps(v2, v3)));
+    vs = _mm512_mul_ps(vs, math_exp_avx512(_mm512_max_ps(_mm512_sub_ps(vm, mn), lo), fast));
+    vs = _mm512_add_ps(vs, math_exp_avx512(_mm512_max_ps(_mm512_sub_ps(v0, mn), lo), fast));
+    vs = _mm512_add_ps(vs, math_exp_avx512(_mm512_max_ps(_mm512_sub_ps(v1, mn), lo), fast));
+    vs = _mm512_add_ps(vs, math_exp_avx512(_mm512_max_ps(_mm512_sub_ps(v2, mn), lo), fast));
+    vs = _mm512_add_ps(vs, math_exp_avx512(_mm512_max_ps(_mm512_sub_ps(v3, mn), lo), fast));
+    vm = mn;
+  }
+  const ai_float m = _mm512_reduce_max_ps(vm);
+  vs = _mm512_mul_ps(vs, math_exp_avx512(
+    _mm512_max_ps(_mm512_sub_ps(vm, _mm512_set1_ps(m)), lo), fast));
+  *max = m;
+  *sum = _mm512_reduce_add_ps(vs);
+  return i;
+}
+
+AI_DECLARE_STATIC __attribute__((target("avx2,fma")))
+ai_size math_exp_scale_array_avx2(ai_float* out, const ai_float* in,
+                                  const ai_size size, const ai_float offset,
+                                  const ai_float scale, const ai_bool fast)
+{
+  const __m256 vo = _mm256_set1_ps(offset);
+  const __m256 vsc = _mm256_set1_ps(scale);
+  ai_size i = 0;
+  for ( ; i+8<=size; i+=8 ) {
+    const __m256 e = math_exp_avx2(_mm256_sub_ps(_mm256_loadu_ps(in + i), vo), fast);
+    _mm256_storeu_ps(out + i, _mm256_mul_ps(e, vsc));
+  }
+  return i;
+}
+
+AI_DECLARE_STATIC __attribute__((target("avx512f")))
+ai_size math_exp_scale_array_avx512(ai_float* out, const ai_float* in,
+                                    const ai_size size, const ai_float offset,
+                                    const ai_float scale, const ai_bool fast)
+{
+  const __m512 vo = _mm512_set1_ps(offset);
+  const __m512 vsc = _mm512_set1_ps(scale);
+  ai_size i = 0;
+  for ( ; i+16<=size; i+=16 ) {
+    const __m512 e = math_exp_avx512(_mm512_sub_ps(_mm512_loadu_ps(in + i), vo), fast);
+    _mm512_storeu_ps(out + i, _mm512_mul_ps(e, vsc));
+  }
+  if ( i<size ) {
+    const __mmask16 k = (__mmask16)((1U << (size - i)) - 1);
+    const __m512 e = math_exp_avx512(
+      _mm512_sub_ps(_mm512_maskz_loadu_ps(k, in + i), vo), fast);
+    _mm512_mask_storeu_ps(out + i, k, _mm512_mul_ps(e, vsc));
+  }
+  return size;
+}
+
+#define MATH_ARRAY_X86_DISPATCH(name_) \
+  { \
+    const ai_u32 features = core_cpu_get_features(); \
+    if ( AI_CPU_HAS_FEATURE(features, AI_CPU_FEATURE_AVX512F) ) { \
+      i = math_ ## name_ ## _array_avx512(out, in, size, fast); \
+    } else if ( AI_CPU_HAS_FEATURE(features, AI_CPU_FEATURE_AVX2 | AI_CPU_FEATURE_FMA) ) { \
+      i = math_ ## name_ ## _array_avx2(out, in, size, fast); \
+    } \
+  }
+#else
+#define MATH_ARRAY_X86_DISPATCH(name_)
+#endif    /* __x86_64__ || __i386__ */
+
+/******************************************************************************/
+/*!
+ * @brief define core_math_<name_>_array_f32: libm_ (function of x) with the
+ * AI_MATH_ACCURACY_LIBM tier, the approximations otherwise
+ */
+#define CORE_MATH_ARRAY_F32(name_, libm_) \
+AI_INTERNAL_API \
+void core_math_ ## name_ ## _array_f32(ai_float* out, const ai_float* in, \
+                                       const ai_size size) \
+{ \
+  const ai_math_accuracy accuracy = core_math_get_accuracy(); \
+  const ai_bool fast = (accuracy==AI_MATH_ACCURACY_FAST); \
+  ai_size i = 0; \
+  if ( accuracy==AI_MATH_ACCURACY_LIBM ) { \
+    for ( ; i<size; i++ ) { \
+      const ai_float x = in[i]; \
+      out[i] = (libm_); \
+    } \
+    return; \
+  } \
+  MATH_ARRAY_X86_DISPATCH(name_) \
+  for ( ; i<size; i++ ) out[i] = math_ ## name_ ## _f32(in[i], fast); \
+}
+
+CORE_MATH_ARRAY_F32(exp, AI_MATH_EXP(x))
+CORE_MATH_ARRAY_F32(log, AI_MATH_LOG(x))
+CORE_MATH_ARRAY_F32(tanh, AI_MATH_TANH(x))
+CORE_MATH_ARRAY_F32(sigmoid, AI_MATH_SIGMOID(x))
+CORE_MATH_ARRAY_F32(erf, AI_MATH_ERF(x))
+
+/******************************************************************************/
+AI_DECLARE_STATIC
+ai_float math_exp_tier_f32(const ai_float x, const ai_math_accuracy accuracy)
+{
+  return (accuracy==AI_MATH_ACCURACY_LIBM)
+    ? AI_MATH_EXP(x) : math_exp_f32(x, (accuracy==AI_MATH_ACCURACY_FAST));
+}
+
+AI_INTERNAL_API
+ai_float core_math_max_exp_sum_f32(const ai_float* in, const ai_size size,
+                                   ai_float* max)
+{
+  const ai_math_accuracy accuracy = core_math_get_accuracy();
+  ai_float m = -INFINITY;
+  ai_float s = 0.0f;
+  ai_size i = 0;
+#if defined(__x86_64__) || defined(__i386__)
+  if ( accuracy!=AI_MATH_ACCURACY_LIBM ) {
+    const ai_bool fast = (accuracy==AI_MATH_ACCURACY_FAST);
+    const ai_u32 features = core_cpu_get_features();
+    if ( AI_CPU_HAS_FEATURE(features, AI_CPU_FEATURE_AVX512F) ) {
+      i = math_max_exp_sum_avx512(in, size, fast, &m, &s);
+    } else if ( AI_CPU_HAS_FEATURE(features, AI_CPU_FEATURE_AVX2 | AI_CPU_FEATURE_FMA) ) {
+      i = math_max_exp_sum_avx2(in, size, fast, &m, &s);
+    }
+  }
+#endif
+  for ( ; i<size; i++ ) {
+    const ai_float x = in[i];
+    if ( x>m ) {
+      s = s * math_exp_tier_f32(AI_MAX(m - x, MATH_EXP_LO), accuracy) + 1.0f;
+      m = x;
+    } else {
+      s += math_exp_tier_f32(AI_MAX(x - m, MATH_EXP_LO), accuracy);
+    }
+  }
+  *max = m;
+  return s;
+}
+
+AI_INTERNAL_API
+void core_math_exp_scale_array_f32(ai_float* out, const ai_float* in,
+                                   const ai_size size, const ai_float offset,
+                                   const ai_float scale)
+{
+  const ai_math_accuracy accuracy = core_math_get_accuracy();
+  ai_size i = 0;
+#if defined(__x86_64__) || defined(__i386__)
+  if ( accuracy!=AI_MATH_ACCURACY_LIBM ) {
+    const ai_bool fast = (accuracy==AI_MATH_ACCURACY_FAST);
+    const ai_u32 features = core_cpu_get_features();
+    if ( AI_CPU_HAS_FEATURE(features, AI_CPU_FEATURE_AVX512F) ) {
+      i = math_exp_scale_array_avx512(out, in, size, offset, scale, fast);
+    } else if ( AI_CPU_HAS_FEATURE(features, AI_CPU_FEATURE_AVX2 | AI_CPU_FEATURE_FMA) ) {
+      i = math_exp_scale_array_avx2(out, in, size, offset, scale, fast);
+    }
+  }
+#endif
+  for ( ; i<size; i++ ) out[i] = math_exp_tier_f32(in[i] - offset, accuracy) * scale;
+}
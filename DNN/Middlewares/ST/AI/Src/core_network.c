@@ -0,0 +1,370 @@
+/**
+  ******************************************************************************
+  * @file    core_network.c
+  * @brief   implementation of the network instances management
+  ******************************************************************************
+  * @attention
+  *
+  * The instance block is laid out as: instance header (network context),
+  * arrays (with the matching template arrays), tensors, nodes, tensor chains
+  * with their lists and tensor pointers, then the I/O lists infos.
+  * The graph is walked twice: once to size the block, once to fill it.
+  *
+  ******************************************************************************
+  */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "core_network.h"
+#include "core_common.h"
+#include "core_plan.h"
+#include "layers.h"
+
+#define AI_NETWORK_CLONE_ALIGN     (8)
+
+/*!
+ * @struct ai_network_clone
+ * @brief instance header, the network context is the instance handle
+ */
+typedef struct ai_network_clone_ {
+  ai_network            net;            /*!< instance context (first field) */
+  const ai_network*     templ;          /*!< generated network */
+  ai_size               n_arrays;
+  ai_array*             arrays;         /*!< instance arrays */
+  ai_array**            templ_arrays;   /*!< matching template arrays */
+  ai_handle             graph;          /*!< graph optimizations state */
+  ai_size               arena_size;     /*!< planned activations (bytes) */
+  ai_handle             scratch;        /*!< scratch arena of the layers */
+  ai_size               scratch_size;   /*!< scratch arena size (bytes) */
+} ai_network_clone;
+
+/*!
+ * @struct ai_network_clone_graph
+ * @brief unique objects of the template graph
+ */
+typedef struct {
+  ai_size         n_nodes;
+  ai_node**       nodes;
+  ai_size         n_tensors;
+  ai_tensor**     tensors;
+  ai_size         n_arrays;
+  ai_array**      arrays;
+  ai_size         n_lists;          /*!< lists of the node chains */
+  ai_size         n_refs;           /*!< tensor pointers of these lists */
+  ai_size         nodes_size;       /*!< bytes of the nodes structs */
+} ai_network_clone_graph;
+
+AI_STATIC_CONST ai_layer_type g_clone_layer_types[] = {
+#define LAYER_ENTRY(type_, id_, struct_, forward_func_) \
+  AI_LAYER_TYPE_ENTRY(type_),
+#include "layers_list.h"
+};
+
+AI_STATIC_CONST ai_size g_clone_layer_sizes[] = {
+#define LAYER_ENTRY(type_, id_, struct_, forward_func_) \
+  sizeof(struct_),
+#include "layers_list.h"
+};
+
+/******************************************************************************/
+AI_DECLARE_STATIC
+ai_size clone_align(const ai_size size)
+{
+  return (size + AI_NETWORK_CLONE_ALIGN - 1) & ~(ai_size)(AI_NETWORK_CLONE_ALIGN - 1);
+}
+
+AI_DECLARE_STATIC
+void* clone_bump(ai_u8** cursor, const ai_size size)
+{
+  void* ptr = *cursor;
+  *cursor += clone_align(size);
+  return ptr;
+}
+
+/*!
+ * @brief size of the layer struct of a node, 0 if the type is unknown
+ */
+AI_DECLARE_STATIC
+ai_size clone_node_size(const ai_node* node)
+{
+  for ( ai_size i=0; i<AI_C_ARRAY_COUNT(g_clone_layer_types); i++ ) {
+    if ( g_clone_layer_types[i]==AI_LAYER_TYPE(node->type) ) {
+      return g_clone_layer_sizes[i];
+    }
+  }
+  return 0;
+}
+
+AI_DECLARE_STATIC
+ai_size clone_find(void* const* items, const ai_size n_items, const void* item)
+{
+  for ( ai_size i=0; i<n_items; i++ ) {
+    if ( items[i]==item ) return i;
+  }
+  return n_items;
+}
+
+/*!
+ * @brief register the tensors of a list (and their arrays) once
+ */
+AI_DECLARE_STATIC
+void clone_graph_add_list(ai_network_clone_graph* g, const ai_tensor_list* list)
+{
+  AI_FOR_EACH_TENSOR_LIST_DO(i, t, list) {
+    if ( clone_find((void* const*)g->tensors, g->n_tensors, t)<g->n_tensors ) continue;
+    g->tensors[g->n_tensors++] = t;
+    if ( t->data &&
+         clone_find((void* const*)g->arrays, g->n_arrays, t->data)==g->n_arrays ) {
+      g->arrays[g->n_arrays++] = t->data;
+    }
+  }
+}
+
+/*!
+ * @brief collect the unique nodes, tensors and arrays of the template
+ * @return false on allocation failure or unknown node type
+ */
+AI_DECLARE_STATIC
+ai_bool clone_graph_collect(ai_network_clone_graph* g, const ai_network* templ)
+{
+  ai_size n_refs = 0;
+
+  AI_FOR_EACH_NODE_DO(node, templ->input_node) {
+    const ai_size size = clone_node_size(node);
+    if ( size==0 ) return false;
+    g->n_nodes++;
+    g->nodes_size += clone_align(size);
+    if ( node->tensors ) {
+      g->n_lists += node->tensors->size;
+      for ( ai_size l=0; l<node->tensors->size; l++ ) {
+        n_refs += node->tensors->chain[l].size;
+      }
+    }
+  }
+  for ( ai_size l=0; l<templ->tensors.size; l++ ) {
+    n_refs += templ->tensors.chain[l].size;
+  }
+
+  g->n_refs = n_refs;
+  g->nodes   = malloc((g->n_nodes + 1) * sizeof(ai_node*));
+  g->tensors = malloc((n_refs + 1) * sizeof(ai_tensor*));
+  g->arrays  = malloc((n_refs + 1) * sizeof(ai_array*));
+  if ( !g->nodes || !g->tensors || !g->arrays ) return false;
+
+  ai_size n = 0;
+  AI_FOR_EACH_NODE_DO(node, templ->input_node) {
+    g->nodes[n++] = node;
+    if ( !node->tensors ) continue;
+    for ( ai_size l=0; l<node->tensors->size; l++ ) {
+      clone_graph_add_list(g, &node->tensors->chain[l]);
+    }
+  }
+  for ( ai_size l=0; l<templ->tensors.size; l++ ) {
+    clone_graph_add_list(g, &templ->tensors.chain[l]);
+  }
+  return true;
+}
+
+AI_DECLARE_STATIC
+void clone_graph_release(ai_network_clone_graph* g)
+{
+  free(g->nodes);
+  free(g->tensors);
+  free(g->arrays);
+}
+
+/*!
+ * @brief copy a tensor list, pointing to the instance tensors
+ */
+AI_DECLARE_STATIC
+void clone_list(ai_tensor_list* dst, const ai_tensor_list* src,
+                const ai_network_clone_graph* g, ai_tensor* tensors,
+                ai_tensor** refs)
+{
+  *dst = *src;
+  dst->tensor = (src->size>0) ? refs : NULL;
+  for ( ai_size i=0; i<src->size; i++ ) {
+    const ai_size idx = clone_find((void* const*)g->tensors, g->n_tensors,
+                                   src->tensor[i]);
+    refs[i] = (idx<g->n_tensors) ? &tensors[idx] : NULL;
+  }
+}
+
+/******************************************************************************/
+AI_INTERNAL_API
+ai_network* core_network_clone(const ai_network* templ)
+{
+  ai_network_clone_graph g;
+  memset(&g, 0, sizeof(g));
+  if ( !templ || !clone_graph_collect(&g, templ) ) {
+    clone_graph_release(&g);
+    return NULL;
+  }
+
+  /* I/O lists infos: one info struct and buffer/state/meta per tensor */
+  ai_size io_size = 0;
+  for ( ai_size l=0; l<templ->tensors.size; l++ ) {
+    const ai_size n = templ->tensors.chain[l].size;
+    io_size += clone_align(sizeof(ai_tensor_list_info)) +
+               clone_align(n * sizeof(ai_buffer)) +
+               clone_align(n * sizeof(ai_tensor_state)) +
+               clone_align(n * sizeof(ai_buffer_meta_info));
+  }
+
+  const ai_size size =
+    clone_align(sizeof(ai_network_clone)) +
+    clone_align(g.n_arrays * sizeof(ai_array)) +
+    clone_align(g.n_arrays * sizeof(ai_array*)) +
+    clone_align(g.n_tensors * sizeof(ai_tensor)) +
+    g.nodes_size +
+    clone_align(g.n_nodes * sizeof(ai_tensor_chain)) +
+    clone_align((g.n_lists + templ->tensors.size) * sizeof(ai_tensor_list)) +
+    clone_align(g.n_refs * sizeof(ai_tensor*)) +
+    io_size;
+
+  ai_u8* block = calloc(1, size);
+  if ( !block ) {
+    clone_graph_release(&g);
+    return NULL;
+  }
+
+  ai_u8* cursor = block;
+  ai_network_clone* clone = clone_bump(&cursor, sizeof(ai_network_clone));
+  ai_array* arrays = clone_bump(&cursor, g.n_arrays * sizeof(ai_array));
+  ai_array** templ_arrays = clone_bump(&cursor, g.n_arrays * sizeof(ai_array*));
+  ai_tensor* tensors = clone_bump(&cursor, g.n_tensors * sizeof(ai_tensor));
+  ai_u8* nodes = clone_bump(&cursor, g.nodes_size);
+  ai_tensor_chain* chains = clone_bump(&cursor, g.n_nodes * sizeof(ai_tensor_chain));
+  ai_tensor_list* lists = clone_bump(&cursor,
+    (g.n_lists + templ->tensors.size) * sizeof(ai_tensor_list));
+  ai_tensor** refs = clone_bump(&cursor, g.n_refs * sizeof(ai_tensor*));
+
+  /* arrays and tensors */
+  for ( ai_size i=0; i<g.n_arrays; i++ ) {
+    arrays[i] = *g.arrays[i];
+    templ_arrays[i] = g.arrays[i];
+  }
+  for ( ai_size i=0; i<g.n_tensors; i++ ) {
+    tensors[i] = *g.tensors[i];
+    if ( g.tensors[i]->data ) {
+      tensors[i].data = &arrays[clone_find((void* const*)g.arrays, g.n_arrays,
+                                           g.tensors[i]->data)];
+    }
+  }
+
+  /* nodes: layer structs copied as is, then relinked */
+  ai_node** node_ptrs = malloc((g.n_nodes + 1) * sizeof(ai_node*));
+  if ( !node_ptrs ) {
+    free(block);
+    clone_graph_release(&g);
+    return NULL;
+  }
+  for ( ai_size n=0; n<g.n_nodes; n++ ) {
+    const ai_size node_size = clone_node_size(g.nodes[n]);
+    node_ptrs[n] = (ai_node*)nodes;
+    memcpy(nodes, g.nodes[n], node_size);
+    nodes += clone_align(node_size);
+  }
+  for ( ai_size n=0; n<g.n_nodes; n++ ) {
+    ai_node* node = node_ptrs[n];
+    const ai_node* src = g.nodes[n];
+    node->network = &clone->net;
+    node->next = (n+1<g.n_nodes) ? node_ptrs[n+1] : node;
+    if ( !src->tensors ) continue;
+
+    ai_tensor_chain* chain = &chains[n];
+    *chain = *src->tensors;
+    chain->chain = lists;
+    for ( ai_size l=0; l<src->tensors->size; l++ ) {
+      clone_list(lists++, &src->tensors->chain[l], &g, tensors, refs);
+      refs += src->tensors->chain[l].size;
+    }
+    node->tensors = chain;
+  }
+
+  /* network context and I/O lists */
+  clone->net = *templ;
+  clone->net.input_node = (g.n_nodes>0) ? node_ptrs[0] : NULL;
+  clone->net.current_node = NULL;
+  clone->net.klass = AI_KLASS_OBJ(templ);
+  clone->net.tensors.chain = lists;
+  for ( ai_size l=0; l<templ->tensors.size; l++ ) {
+    const ai_tensor_list* src = &templ->tensors.chain[l];
+    clone_list(lists, src, &g, tensors, refs);
+    refs += src->size;
+    if ( src->info ) {
+      ai_tensor_list_info* info = clone_bump(&cursor, sizeof(ai_tensor_list_info));
+      info->buffer = clone_bump(&cursor, src->size * sizeof(ai_buffer));
+      info->state = clone_bump(&cursor, src->size * sizeof(ai_tensor_state));
+      info->meta = clone_bump(&cursor, src->size * sizeof(ai_buffer_meta_info));
+      memcpy(info->buffer, src->info->buffer, src->size * sizeof(ai_buffer));
+      if ( src->info->meta ) {
+        memcpy(info->meta, src->info->meta, src->size * sizeof(ai_buffer_meta_info));
+      }
+      lists->info = info;
+    }
+    lists++;
+  }
+
+  clone->templ = templ;
+  clone->n_arrays = g.n_arrays;
+  clone->arrays = arrays;
+  clone->templ_arrays = templ_arrays;
+  clone->graph = NULL;
+  clone->arena_size = AI_PLAN_SIZE_NONE;
+  clone->scratch = NULL;
+  clone->scratch_size = 0;
+
+  free(node_ptrs);
+  clone_graph_release(&g);
+  return &clone->net;
+}
+
+AI_INTERNAL_API
+ai_array* core_network_get_array(ai_network* net, const ai_array* array)
+{
+  ai_network_clone* clone = (ai_network_clone*)net;
+  if ( !clone || !array ) return NULL;
+
+  const ai_size idx = clone_find((void* const*)clone->templ_arrays,
+                                 clone->n_arrays, array);
+  return (idx<clone->n_arrays) ? &clone->arrays[idx] : NULL;
+}
+
+AI_INTERNAL_API
+ai_handle* core_network_get_graph(ai_network* net)
+{
+  ai_network_clone* clone = (ai_network_clone*)net;
+  return &clone->graph;
+}
+
+AI_INTERNAL_API
+ai_size* core_network_get_arena_size(ai_network* net)
+{
+  ai_network_clone* clone = (ai_network_clone*)net;
+  return &clone->arena_size;
+}
+
+AI_INTERNAL_API
+ai_handle core_network_get_scratch(ai_network* net, const ai_size size)
+{
+  ai_network_clone* clone = (ai_network_clone*)net;
+  if ( !clone ) return NULL;
+
+  if ( size>clone->scratch_size ) {
+    /* the content is not preserved: no need to copy it */
+    free(clone->scratch);
+    clone->scratch = malloc(size);
+    clone->scratch_size = (clone->scratch) ? size : 0;
+  }
+  return clone->scratch;
+}
+
+AI_INTERNAL_API
+void core_network_free(ai_network* net)
+{
+  ai_network_clone* clone = (ai_network_clone*)net;
+  if ( clone ) free(clone->scratch);
+  free(net);
+}
@@ -0,0 +1,354 @@
+/**
+  ******************************************************************************
+  * @file    core_plan.c
+  * @brief   implementation of the activations memory planner
+  ******************************************************************************
+  * @attention
+  *
+  * The arrays of the activations buffer are found from the offsets set by
+  * the generated configure function (their data lies in the buffer), so the
+  * planner only needs the executed graph: the arrays no longer referenced
+  * (e.g. between two folded nodes) are left out of the plan.
+  *
+  * In-place: the output of a pointwise node (float nonlinearity, eltwise,
+  * add) is aliased on an input of the same size which is not used after this
+  * node. Both arrays then form a single buffer, alive from the first use of
+  * the input to the last use of the output; chains of pointwise nodes share
+  * one buffer.
+  *
+  ******************************************************************************
+  */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "core_plan.h"
+#include "core_network.h"
+#include "core_common.h"
+#include "layers_generic.h"
+#include "layers_nl.h"
+#include "ai_datatypes_format.h"
+#include "ai_math_helpers.h"
+
+#define AI_PLAN_ALIGN_SIZE(size_) \
+  ( ((size_) + (AI_PLAN_ALIGN-1)) & ~((ai_size)(AI_PLAN_ALIGN-1)) )
+
+/*!
+ * @struct ai_plan_ctx
+ * @brief arrays of the activations buffer collected from the graph
+ */
+typedef struct ai_plan_ctx_ {
+  ai_ptr            base;       /*!< activations buffer (aligned) */
+  ai_size           avail;      /*!< generated size, all the batches */
+  ai_u16            n_batches;  /*!< batch planned in the activations */
+  ai_size           n_arrays;
+  ai_size           max_arrays;
+  ai_array**        arrays;
+  ai_plan_buffer*   buffers;
+  ai_size*          roots;      /*!< buffer holding each array (in-place) */
+  ai_plan_buffer*   packed;     /*!< buffers passed to core_plan_pack */
+} ai_plan_ctx;
+
+/*!
+ * @brief kernels computing each output element from the input elements at
+ * the same position only, their output can alias an input
+ */
+AI_STATIC_CONST layer_forward_func g_plan_inplace_forwards[] = {
+  forward_relu, forward_relu_thresholded, forward_elu, forward_selu,
+  forward_clip, forward_sigmoid, forward_hard_sigmoid, forward_tanh,
+  forward_sign, forward_abs, forward_neg, forward_exp, forward_log, forward_erf,
+  forward_sqrt, forward_rsqrt, forward_reciprocal, forward_soft_plus,
+  forward_soft_sign, forward_floor, forward_ceil, forward_round,
+  forward_eltwise, forward_add,
+};
+
+/******************************************************************************/
+/*!
+ * @brief order of the buffers a and b: by offset, else by placement order
+ * (decreasing size, then earliest first use)
+ */
+AI_DECLARE_STATIC
+ai_bool plan_is_before(const ai_plan_buffer* buffers, const ai_size a,
+                       const ai_size b, const ai_bool by_offset)
+{
+  const ai_plan_buffer* ba = &buffers[a];
+  const ai_plan_buffer* bb = &buffers[b];
+  if ( by_offset ) return (ba->offset < bb->offset);
+  if ( ba->size!=bb->size ) return (ba->size > bb->size);
+  return (ba->first < bb->first);
+}
+
+/*!
+ * @brief insertion sort of an index array (the buffer sets are small)
+ */
+AI_DECLARE_STATIC
+void plan_sort(ai_size* idx, const ai_size n, const ai_plan_buffer* buffers,
+               const ai_bool by_offset)
+{
+  for ( ai_size i=1; i<n; i++ ) {
+    const ai_size v = idx[i];
+    ai_size j = i;
+    for ( ; (j>0) && plan_is_before(buffers, v, idx[j-1], by_offset); j-- ) {
+      idx[j] = idx[j-1];
+    }
+    idx[j] = v;
+  }
+}
+
+AI_DECLARE_STATIC
+ai_bool plan_overlap(const ai_plan_buffer* a, const ai_plan_buffer* b)
+{
+  return (a->first <= b->last) && (b->first <= a->last);
+}
+
+/******************************************************************************/
+AI_INTERNAL_API
+ai_size core_plan_pack(ai_plan_buffer* buffers, const ai_size n_buffers)
+{
+  if ( n_buffers==0 ) return 0;
+
+  /* placement order, then the placed buffers alive with the current one */
+  ai_size* order = malloc(2 * n_buffers * sizeof(ai_size));
+  if ( !order ) return 0;
+  ai_size* alive = order + n_buffers;
+
+  for ( ai_size i=0; i<n_buffers; i++ ) order[i] = i;
+  plan_sort(order, n_buffers, buffers, false);
+
+  ai_size arena = 0;
+  for ( ai_size i=0; i<n_buffers; i++ ) {
+    ai_plan_buffer* b = &buffers[order[i]];
+
+    ai_size n_alive = 0;
+    for ( ai_size j=0; j<i; j++ ) {
+      if ( plan_overlap(b, &buffers[order[j]]) ) alive[n_alive++] = order[j];
+    }
+    plan_sort(alive, n_alive, buffers, true);
+
+    /* smallest gap between the live buffers holding b, else after them */
+    ai_size best = (ai_size)-1;
+    ai_size best_gap = (ai_size)-1;
+    ai_size end = 0;
+    for ( ai_size j=0; j<n_alive; j++ ) {
+      const ai_plan_buffer* p = &buffers[alive[j]];
+      if ( p->offset >= end ) {
+        const ai_size gap = p->offset - end;
+        if ( (gap >= b->size) && (gap < best_gap) ) {
+          best = end;
+          best_gap = gap;
+        }
+      }
+      end = AI_MAX(end, AI_PLAN_ALIGN_SIZE(p->offset + p->size));
+    }
+    b->offset = (best!=(ai_size)-1) ? best : end;
+    arena = AI_MAX(arena, b->offset + b->size);
+  }
+
+  free(order);
+  return AI_PLAN_ALIGN_SIZE(arena);
+}
+
+/******************************************************************************/
+/*!
+ * @brief record a use of a tensor by the c-node c_idx if its data lies in the
+ * activations buffer
+ */
+AI_DECLARE_STATIC
+void plan_add_tensor(ai_plan_ctx* ctx, const ai_tensor* t,
+                        const ai_u16 c_idx)
+{
+  if ( !t || !t->data ) return;
+  ai_array* array = AI_ARRAY_OBJ(t->data);
+  if ( array->format & AI_FMT_FLAG_CONST ) return;
+
+  const ai_ptr start = AI_PTR(array->data_start);
+  if ( !start || (start < ctx->base) || (start >= ctx->base + ctx->avail) )
+    return;
+
+  /* size of the sample range of the tensor, from the array start */
+  const ai_size size = (ai_size)(AI_PTR(array->data) - start) +
+    (ai_size)AI_ARRAY_GET_BYTE_SIZE(AI_ARRAY_OBJ_FMT(array), AI_TENSOR_SIZE(t)) *
+    ctx->n_batches;
+
+  for ( ai_size i=0; i<ctx->n_arrays; i++ ) {
+    if ( ctx->arrays[i]==array ) {
+      ai_plan_buffer* b = &ctx->buffers[i];
+      b->size  = AI_MAX(b->size, size);
+      b->first = AI_MIN(b->first, c_idx);
+      b->last  = AI_MAX(b->last, c_idx);
+      return;
+    }
+  }
+  AI_ASSERT(ctx->n_arrays<ctx->max_arrays)
+
+  ctx->arrays[ctx->n_arrays] = array;
+  ctx->buffers[ctx->n_arrays] = (ai_plan_buffer) {
+    .size = size, .first = c_idx, .last = c_idx, .offset = 0 };
+  ctx->roots[ctx->n_arrays] = ctx->n_arrays;
+  ctx->n_arrays++;
+}
+
+AI_DECLARE_STATIC
+ai_size plan_find(const ai_plan_ctx* ctx, const ai_tensor* t)
+{
+  if ( t && t->data ) {
+    for ( ai_size i=0; i<ctx->n_arrays; i++ ) {
+      if ( ctx->arrays[i]==AI_ARRAY_OBJ(t->data) ) return i;
+    }
+  }
+  return ctx->n_arrays;
+}
+
+AI_DECLARE_STATIC
+ai_size plan_root(const ai_plan_ctx* ctx, ai_size i)
+{
+  while ( ctx->roots[i]!=i ) i = ctx->roots[i];
+  return i;
+}
+
+AI_DECLARE_STATIC
+ai_bool plan_is_io(const ai_network* net, const ai_array* array)
+{
+  for ( ai_size l=0; l<2; l++ ) {
+    const ai_tensor_list* list = (l==0) ? GET_TENSOR_LIST(&net->tensors, INPUT)
+                                        : GET_TENSOR_LIST(&net->tensors, OUTPUT);
+    if ( !list ) continue;
+    AI_FOR_EACH_TENSOR_LIST_DO(i, t, list) {
+      if ( t->data && (AI_ARRAY_OBJ(t->data)==array) ) return true;
+    }
+  }
+  return false;
+}
+
+/*!
+ * @brief alias the output of a pointwise node c_idx on an input dying there
+ */
+AI_DECLARE_STATIC
+void plan_alias_node(ai_plan_ctx* ctx, const ai_network* net,
+                     const ai_node* node, const ai_u16 c_idx)
+{
+  ai_bool inplace = false;
+  for ( ai_size k=0; k<AI_C_ARRAY_COUNT(g_plan_inplace_forwards); k++ ) {
+    if ( node->forward==g_plan_inplace_forwards[k] ) inplace = true;
+  }
+  if ( !inplace || !node->tensors ) return;
+
+  const ai_size o = plan_find(ctx, GET_TENSOR_OUT(node->tensors, 0));
+  if ( (o==ctx->n_arrays) || (ctx->buffers[o].first!=c_idx) ||
+       (ctx->arrays[o]->data!=ctx->arrays[o]->data_start) ) return;
+
+  AI_FOR_EACH_TENSOR_LIST_DO(i, t, GET_TENSOR_LIST_IN(node->tensors)) {
+    const ai_size in = plan_find(ctx, t);
+    if ( (in==ctx->n_arrays) || (in==o) ) continue;
+    ai_plan_buffer* r = &ctx->buffers[plan_root(ctx, in)];
+    /* the input memory is free after this node and holds the whole output */
+    if ( (r->last!=c_idx) || (ctx->buffers[in].size!=ctx->buffers[o].size) ||
+         (ctx->arrays[in]->data!=ctx->arrays[in]->data_start) ||
+         plan_is_io(net, ctx->arrays[in]) ) continue;
+    ctx->roots[o] = plan_root(ctx, in);
+    r->last = AI_MAX(r->last, ctx->buffers[o].last);
+    return;
+  }
+}
+
+/*!
+ * @brief the network I/O kept in the activations live for the whole run
+ */
+AI_DECLARE_STATIC
+void plan_extend_io(ai_plan_ctx* ctx, ai_tensor_list* list,
+                    const ai_u16 c_idx)
+{
+  if ( !list ) return;
+  AI_FOR_EACH_TENSOR_LIST_DO(i, t, list) {
+    if ( !t->data ) continue;
+    for ( ai_size k=0; k<ctx->n_arrays; k++ ) {
+      if ( ctx->arrays[k]!=AI_ARRAY_OBJ(t->data) ) continue;
+      ctx->buffers[k].first = AI_MIN(ctx->buffers[k].first, c_idx);
+      ctx->buffers[k].last  = AI_MAX(ctx->buffers[k].last, c_idx);
+    }
+  }
+}
+
+AI_INTERNAL_API
+ai_size core_plan_activations(ai_network* net)
+{
+  ai_size* arena_size = core_network_get_arena_size(net);
+  *arena_size = AI_PLAN_SIZE_NONE;
+
+  if ( !net->activations.data || !net->input_node ) return AI_PLAN_SIZE_NONE;
+
+  ai_plan_ctx ctx = {
+    .base = AI_PTR(AI_PTR_ALIGN(net->activations.data, AI_PLAN_ALIGN)),
+    .n_batches = AI_MAX(net->activations.n_batches, 1),
+  };
+  ctx.avail = AI_BUFFER_SIZE(&net->activations) * ctx.n_batches;
+  if ( ctx.avail==0 ) return AI_PLAN_SIZE_NONE;
+
+  /* upper bound of the number of arrays: the tensor references */
+  ai_u16 n_nodes = 0;
+  AI_FOR_EACH_NODE_DO(node, net->input_node) {
+    if ( node->tensors ) {
+      AI_FOR_EACH_TENSOR_CHAIN_DO(list, node->tensors) {
+        ctx.max_arrays += GET_TENSOR_LIST_SIZE(list);
+      }
+    }
+    n_nodes++;
+  }
+  ctx.arrays = malloc(AI_MAX(ctx.max_arrays, 1) *
+    (sizeof(ai_array*) + 2*sizeof(ai_plan_buffer) + sizeof(ai_size)));
+  if ( !ctx.arrays ) return AI_PLAN_SIZE_NONE;
+  ctx.buffers = (ai_plan_buffer*)(ctx.arrays + ctx.max_arrays);
+  ctx.packed = ctx.buffers + ctx.max_arrays;
+  ctx.roots = (ai_size*)(ctx.packed + ctx.max_arrays);
+
+  ai_u16 c_idx = 0;
+  AI_FOR_EACH_NODE_DO(node, net->input_node) {
+    if ( node->tensors ) {
+      AI_FOR_EACH_TENSOR_CHAIN_DO(list, node->tensors) {
+        AI_FOR_EACH_TENSOR_LIST_DO(i, t, list) {
+          plan_add_tensor(&ctx, t, c_idx);
+        }
+      }
+    }
+    c_idx++;
+  }
+  plan_extend_io(&ctx, GET_TENSOR_LIST(&net->tensors, INPUT), 0);
+  plan_extend_io(&ctx, GET_TENSOR_LIST(&net->tensors, OUTPUT), n_nodes-1);
+
+  c_idx = 0;
+  AI_FOR_EACH_NODE_DO(node, net->input_node) {
+    plan_alias_node(&ctx, net, node, c_idx);
+    c_idx++;
+  }
+
+  /* only the buffers holding a group of aliased arrays are placed */
+  ai_size n_packed = 0;
+  for ( ai_size i=0; i<ctx.n_arrays; i++ ) {
+    if ( ctx.roots[i]==i ) ctx.packed[n_packed++] = ctx.buffers[i];
+  }
+  const ai_size planned = core_plan_pack(ctx.packed, n_packed);
+  n_packed = 0;
+  for ( ai_size i=0; i<ctx.n_arrays; i++ ) {
+    if ( ctx.roots[i]==i ) ctx.buffers[i].offset = ctx.packed[n_packed++].offset;
+  }
+  for ( ai_size i=0; i<ctx.n_arrays; i++ ) {
+    ctx.buffers[i].offset = ctx.buffers[plan_root(&ctx, i)].offset;
+  }
+
+  /* the generated offsets are kept when the plan does not fit */
+  if ( ((planned==0) && (ctx.n_arrays>0)) || (planned > ctx.avail) ) {
+    free(ctx.arrays);
+    return AI_PLAN_SIZE_NONE;
+  }
+
+  for ( ai_size i=0; i<ctx.n_arrays; i++ ) {
+    ai_array* array = ctx.arrays[i];
+    const ai_ptr_offset delta = AI_PTR(array->data) - AI_PTR(array->data_start);
+    array->data_start = ctx.base + ctx.buffers[i].offset;
+    array->data = AI_PTR(array->data_start) + delta;
+  }
+
+  free(ctx.arrays);
+  *arena_size = planned;
+  return planned;
+}
@@ -0,0 +1,1038 @@
+/**
+  ******************************************************************************
+  * @file    core_tflite.c
+  * @brief   implementation of the runtime .tflite model loader
+  ******************************************************************************
+  * @attention
+  *
+  * The flatbuffer is walked through its vtables with bounds checked reads,
+  * nothing is unpacked: only the runtime objects of the first subgraph are
+  * allocated (arrays, tensors, tensor chains, layers), on the heap, in the
+  * layout of a generated network. This template network is cloned by
+  * ai_platform_network_create for each instance, the klass of an instance
+  * refers to it (first field of the model).
+  *
+  ******************************************************************************
+  */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define AI_TFLITE_WITH_MMAP
+#endif
+
+#include "core_tflite.h"
+#include "core_convert.h"
+#include "core_plan.h"
+#include "core_common.h"
+#include "layers.h"
+#include "ai_math_helpers.h"
+
+/* API version of the generated networks built by the loader */
+#define AI_TFLITE_API_VERSION_MAJOR     (1)
+#define AI_TFLITE_API_VERSION_MINOR     (3)
+#define AI_TFLITE_API_VERSION_MICRO     (0)
+
+#define AI_TFLITE_IDENTIFIER            "TFL3"
+
+/* schema: builtin operators (BuiltinOperator) */
+#define TFL_OP_ADD                      (0)
+#define TFL_OP_DEQUANTIZE               (6)
+#define TFL_OP_FULLY_CONNECTED          (9)
+#define TFL_OP_LOGISTIC                 (14)
+#define TFL_OP_RELU                     (19)
+#define TFL_OP_RELU6                    (21)
+#define TFL_OP_TANH                     (28)
+
+/* schema: fused activations (ActivationFunctionType) */
+#define TFL_ACT_NONE                    (0)
+#define TFL_ACT_RELU                    (1)
+#define TFL_ACT_RELU6                   (3)
+#define TFL_ACT_TANH                    (4)
+
+/* schema: tensor types (TensorType) */
+#define TFL_TYPE_FLOAT32                (0)
+#define TFL_TYPE_FLOAT16                (1)
+
+/* schema: table fields */
+#define TFL_MODEL_VERSION               (0)
+#define TFL_MODEL_OPERATOR_CODES        (1)
+#define TFL_MODEL_SUBGRAPHS             (2)
+#define TFL_MODEL_BUFFERS               (4)
+#define TFL_OPCODE_DEPRECATED_CODE      (0)
+#define TFL_OPCODE_BUILTIN_CODE         (3)
+#define TFL_SUBGRAPH_TENSORS            (0)
+#define TFL_SUBGRAPH_INPUTS             (1)
+#define TFL_SUBGRAPH_OUTPUTS            (2)
+#define TFL_SUBGRAPH_OPERATORS          (3)
+#define TFL_TENSOR_SHAPE                (0)
+#define TFL_TENSOR_TYPE                 (1)
+#define TFL_TENSOR_BUFFER               (2)
+#define TFL_OPERATOR_OPCODE_INDEX       (0)
+#define TFL_OPERATOR_INPUTS             (1)
+#define TFL_OPERATOR_OUTPUTS            (2)
+#define TFL_OPERATOR_OPTIONS            (4)
+#define TFL_OPTIONS_ACTIVATION          (0)   /* FullyConnected, Add options */
+#define TFL_OPTIONS_WEIGHTS_FORMAT      (1)   /* FullyConnected options */
+#define TFL_BUFFER_DATA                 (0)
+
+/* tensor pointers of a node chain: inputs (2), output, weights, bias */
+#define AI_TFLITE_NODE_REFS             (5)
+
+/* largest tensor (bytes, as float for an activation): the sizes of the
+ * untrusted shapes are computed on 64 bits and checked against this bound,
+ * which leaves room for the plan alignment in ai_size */
+#define AI_TFLITE_TENSOR_BYTES_MAX      (0x7FFFFFFFU)
+
+/* storage of the flatbuffer */
+#define AI_TFLITE_DATA_EXTERNAL         (0)
+#define AI_TFLITE_DATA_MAPPED           (1)
+#define AI_TFLITE_DATA_HEAP             (2)
+
+/*!
+ * @brief a layer of the loaded graph
+ */
+typedef union {
+  ai_layer_dense    dense;
+  ai_layer_nl       nl;
+  ai_layer_add      add;
+} ai_tflite_node;
+
+/*!
+ * @brief the tensor chain of a layer
+ */
+typedef struct {
+  ai_tensor_chain   chain;
+  ai_tensor_list    lists[AI_TENSOR_CHAIN_SIZE];
+  ai_tensor*        refs[AI_TFLITE_NODE_REFS];
+} ai_tflite_chain;
+
+/*!
+ * @struct ai_tflite_model
+ * @brief a loaded model: template network and the objects it refers to
+ */
+typedef struct ai_tflite_model_ {
+  ai_network            net;          /*!< template network (first field) */
+  char                  name[AI_TFLITE_NAME_SIZE];
+  char                  signature[33];
+  ai_u8                 version;      /*!< schema version */
+  ai_u32                n_macc;
+
+  const ai_u8*          data;         /*!< the flatbuffer */
+  ai_size               size;
+  ai_u8                 storage;      /*!< AI_TFLITE_DATA_xxx */
+
+  ai_size               n_tensors;    /*!< flatbuffer tensors + fused outputs */
+  ai_tensor*            tensors;
+  ai_array*             arrays;
+  ai_shape_dimension    (*shapes)[AI_SHAPE_MAX_DIMENSION];
+  ai_stride_dimension   (*strides)[AI_SHAPE_MAX_DIMENSION];
+  void**                copies;       /*!< realigned or widened constants */
+
+  ai_size               n_nodes;
+  ai_tflite_node*       nodes;
+  ai_tflite_chain*      chains;
+
+  ai_size               n_plan;       /*!< arrays in the activations buffer */
+  ai_array**            plan_arrays;
+  ai_plan_buffer*       plan;
+
+  ai_array              relu6_array;  /*!< clip parameters of RELU6 */
+  ai_float              relu6[2];
+
+  ai_tensor_list        io_lists[2];
+  ai_tensor*            io_refs[2];
+  ai_tensor_list_info   io_info[2];
+  ai_buffer             io_buffers[2];
+  ai_tensor_state       io_states[2];
+  ai_buffer_meta_info   io_metas[2];
+} ai_tflite_model;
+
+/*!
+ * @brief bounds checked reader of the flatbuffer, ok is cleared on the
+ * first out of bounds access (the following reads return 0)
+ */
+typedef struct {
+  const ai_u8*  data;
+  ai_size       size;
+  ai_bool       ok;
+} ai_tflite_reader;
+
+/*!
+ * @brief load time state
+ */
+typedef struct {
+  ai_tflite_reader  r;
+  ai_tflite_model*  model;
+  ai_size           subgraph;
+  ai_size           tensors;      /*!< tensors vector of the subgraph */
+  ai_size           n_fb_tensors;
+  ai_size           buffers;      /*!< buffers vector of the model */
+  ai_size           n_buffers;
+  ai_bool*          built;        /*!< tensor objects already set up */
+  ai_u16*           first;        /*!< first and last node using a tensor */
+  ai_u16*           last;
+  ai_i32*           alias;        /*!< constant standing for a DEQUANTIZE
+                                       output, -1 if none */
+  ai_size           n_extra;      /*!< fused outputs allocated */
+} ai_tflite_ctx;
+
+/******************************************************************************/
+AI_DECLARE_STATIC
+ai_error tflite_error(const ai_u32 type, const ai_u32 code)
+{
+  ai_error err;
+  err.type = type;
+  err.code = code;
+  return err;
+}
+
+AI_DECLARE_STATIC
+ai_u32 tflite_read(ai_tflite_reader* r, const ai_size pos, const ai_size n)
+{
+  if ( !r->ok || (pos > r->size) || (r->size - pos < n) ) {
+    r->ok = false;
+    return 0;
+  }
+  ai_u32 v = 0;
+  for ( ai_size i=0; i<n; i++ ) v |= (ai_u32)r->data[pos + i] << (8*i);
+  return v;
+}
+
+/*!
+ * @brief position of the field id of the table at pos, 0 if not set
+ */
+AI_DECLARE_STATIC
+ai_size tflite_field(ai_tflite_reader* r, const ai_size table, const ai_u16 id)
+{
+  if ( !table ) return 0;
+  const ai_i32 soffset = (ai_i32)tflite_read(r, table, 4);
+  const ai_i64 vtable = (ai_i64)table - soffset;
+  if ( (vtable < 0) || (vtable > (ai_i64)r->size) ) {
+    r->ok = false;
+    return 0;
+  }
+  const ai_size vt_size = tflite_read(r, (ai_size)vtable, 2);
+  if ( 4 + 2*(ai_size)id + 2 > vt_size ) return 0;
+  const ai_size offset = tflite_read(r, (ai_size)vtable + 4 + 2*id, 2);
+  return (offset) ? table + offset : 0;
+}
+
+/*!
+ * @brief target of the offset stored at pos (table, vector or string)
+ */
+AI_DECLARE_STATIC
+ai_size tflite_deref(ai_tflite_reader* r, const ai_size pos)
+{
+  if ( !pos ) return 0;
+  const ai_size target = pos + tflite_read(r, pos, 4);
+  if ( target >= r->size ) {
+    r->ok = false;
+    return 0;
+  }
+  return target;
+}
+
+AI_DECLARE_STATIC
+ai_u32 tflite_scalar(ai_tflite_reader* r, const ai_size table, const ai_u16 id,
+                     const ai_size bytes, const ai_u32 def)
+{
+  const ai_size pos = tflite_field(r, table, id);
+  return (pos) ? tflite_read(r, pos, bytes) : def;
+}
+
+AI_DECLARE_STATIC
+ai_size tflite_table(ai_tflite_reader* r, const ai_size table, const ai_u16 id)
+{
+  return tflite_deref(r, tflite_field(r, table, id));
+}
+
+/*!
+ * @brief first element of the vector field id (n set to its length), 0 if
+ * the field is not set
+ */
+AI_DECLARE_STATIC
+ai_size tflite_vector(ai_tflite_reader* r, const ai_size table,
+                      const ai_u16 id, const ai_size elem_size, ai_size* n)
+{
+  const ai_size vec = tflite_table(r, table, id);
+  *n = (vec) ? tflite_read(r, vec, 4) : 0;
+  if ( !r->ok || !vec ) {
+    *n = 0;
+    return 0;
+  }
+  if ( (r->size - vec - 4) / elem_size < *n ) {
+    r->ok = false;
+    *n = 0;
+  }
+  return vec + 4;
+}
+
+AI_DECLARE_STATIC
+ai_size tflite_vector_table(ai_tflite_reader* r, const ai_size vec,
+                            const ai_size idx)
+{
+  return tflite_deref(r, vec + 4*idx);
+}
+
+AI_DECLARE_STATIC
+void tflite_signature(const ai_u8* data, const ai_size size, char* sig)
+{
+  ai_u64 h[2] = { 0xcbf29ce484222325ULL, 0x84222325cbf29ce4ULL };
+
+  for ( ai_size j=0; j<2; j++ ) {
+    for ( ai_size i=0; i<size; i++ ) h[j] = (h[j] ^ data[i]) * 0x100000001b3ULL;
+  }
+  snprintf(sig, 33, "%016llx%016llx", (unsigned long long)h[0],
+           (unsigned long long)h[1]);
+}
+
+/******************************************************************************/
+/*!
+ * @brief set up the array and tensor objects of the flatbuffer tensor idx
+ * (once), as a constant when its buffer holds data, else as an activation.
+ * A half precision tensor is only supported as a constant (FLOAT16 format).
+ * @return the tensor, NULL if not supported
+ */
+AI_DECLARE_STATIC
+ai_tensor* tflite_tensor_get(ai_tflite_ctx* ctx, const ai_i32 fb_idx,
+                             const ai_u16 node_idx)
+{
+  ai_tflite_model* m = ctx->model;
+  ai_tflite_reader* r = &ctx->r;
+
+  if ( (fb_idx < 0) || ((ai_size)fb_idx >= ctx->n_fb_tensors) ) return NULL;
+  const ai_i32 idx = (ctx->alias[fb_idx] >= 0) ? ctx->alias[fb_idx] : fb_idx;
+  ctx->first[idx] = AI_MIN(ctx->first[idx], node_idx);
+  ctx->last[idx] = AI_MAX(ctx->last[idx], node_idx);
+  if ( ctx->built[idx] ) return &m->tensors[idx];
+
+  const ai_size t = tflite_vector_table(r, ctx->tensors, idx);
+  const ai_u32 type = tflite_scalar(r, t, TFL_TENSOR_TYPE, 1, TFL_TYPE_FLOAT32);
+  if ( (type!=TFL_TYPE_FLOAT32) && (type!=TFL_TYPE_FLOAT16) ) return NULL;
+  const ai_size elem = (type==TFL_TYPE_FLOAT16) ? sizeof(ai_u16) : sizeof(ai_float);
+
+  ai_size rank;
+  const ai_size dims = tflite_vector(r, t, TFL_TENSOR_SHAPE, 4, &rank);
+  if ( !r->ok || (rank > AI_SHAPE_MAX_DIMENSION) ) return NULL;
+
+  /* 64 bits: an element count bounded at each step can not wrap */
+  ai_u64 size = 1;
+  ai_i32 d[AI_SHAPE_MAX_DIMENSION];
+  for ( ai_size i=0; i<rank; i++ ) {
+    d[i] = (ai_i32)tflite_read(r, dims + 4*i, 4);
+    if ( d[i] <= 0 ) return NULL;
+    size *= (ai_u64)d[i];
+    if ( size*sizeof(ai_float) > AI_TFLITE_TENSOR_BYTES_MAX ) return NULL;
+  }
+
+  /* data of the buffer, if any: constant tensor */
+  const ai_size buffer = tflite_scalar(r, t, TFL_TENSOR_BUFFER, 4, 0);
+  ai_size n_bytes = 0;
+  ai_size data = 0;
+  if ( buffer && (buffer < ctx->n_buffers) ) {
+    data = tflite_vector(r, tflite_vector_table(r, ctx->buffers, buffer),
+                         TFL_BUFFER_DATA, 1, &n_bytes);
+  }
+  if ( !r->ok || (n_bytes && (n_bytes!=size*elem)) ) return NULL;
+  if ( n_bytes && ((ai_u64)data + n_bytes > r->size) ) return NULL;
+  if ( (type==TFL_TYPE_FLOAT16) && !n_bytes ) return NULL;
+
+  /* NHWC: [batch, h, w, c], the outer dimension of a constant is folded in h */
+  ai_shape_dimension* shape = m->shapes[idx];
+  shape[AI_SHAPE_IN_CHANNEL] = 1;
+  shape[AI_SHAPE_CHANNEL] = (rank > 0) ? d[rank-1] : 1;
+  shape[AI_SHAPE_WIDTH] = (rank > 2) ? d[rank-2] : 1;
+  shape[AI_SHAPE_HEIGHT] = (rank > 3) ? d[rank-3] : 1;
+  if ( (rank > 1) && (d[0]!=1) ) {
+    if ( !n_bytes ) return NULL;    /* batch of an activation */
+    shape[AI_SHAPE_HEIGHT] *= d[0];
+  }
+
+  ai_array* array = &m->arrays[idx];
+  array->format = (type==TFL_TYPE_FLOAT16) ? AI_ARRAY_FORMAT_FLOAT16
+                                            : AI_ARRAY_FORMAT_FLOAT;
+  array->size = (ai_size)size;
+  if ( n_bytes ) {
+    void* ptr = (void*)(r->data + data);
+    if ( (ai_uptr)ptr & (elem-1) ) {
+      /* misaligned in the flatbuffer: copied once */
+      m->copies[idx] = malloc(n_bytes);
+      if ( !m->copies[idx] ) return NULL;
+      memcpy(m->copies[idx], ptr, n_bytes);
+      ptr = m->copies[idx];
+    }
+    array->format |= AI_FMT_FLAG_CONST;
+    array->data = AI_PTR(ptr);
+    array->data_start = AI_PTR(ptr);
+  }
+
+  ai_tensor* tensor = &m->tensors[idx];
+  ai_stride_dimension* stride = m->strides[idx];
+  ai_size acc = elem;
+  for ( ai_size i=0; i<AI_SHAPE_MAX_DIMENSION; i++ ) {
+    stride[i] = (ai_stride_dimension)acc;
+    acc *= shape[i];
+  }
+  tensor->shape = (ai_shape)AI_STORAGE_KLASS_INIT(
+    AI_STORAGE_KLASS_SHAPE, AI_SHAPE_MAX_DIMENSION, shape);
+  tensor->stride = (ai_stride)AI_STORAGE_KLASS_INIT(
+    AI_STORAGE_KLASS_STRIDE, AI_SHAPE_MAX_DIMENSION, stride);
+  tensor->data = array;
+
+  ctx->built[idx] = true;
+  return tensor;
+}
+
+/*!
+ * @brief new activation tensor with the shape of t (output of a fused node)
+ */
+AI_DECLARE_STATIC
+ai_tensor* tflite_tensor_like(ai_tflite_ctx* ctx, const ai_tensor* t,
+                              const ai_u16 node_idx)
+{
+  ai_tflite_model* m = ctx->model;
+  const ai_size idx = ctx->n_fb_tensors + ctx->n_extra++;
+  const ai_size src = t - m->tensors;
+
+  memcpy(m->shapes[idx], m->shapes[src], sizeof(m->shapes[idx]));
+  memcpy(m->strides[idx], m->strides[src], sizeof(m->strides[idx]));
+  m->arrays[idx] = m->arrays[src];
+  m->tensors[idx] = *t;
+  m->tensors[idx].shape.data = AI_HANDLE_PTR(m->shapes[idx]);
+  m->tensors[idx].stride.data = AI_HANDLE_PTR(m->strides[idx]);
+  m->tensors[idx].data = &m->arrays[idx];
+
+  ctx->built[idx] = true;
+  ctx->first[idx] = node_idx;
+  ctx->last[idx] = node_idx + 1;
+  return &m->tensors[idx];
+}
+
+/*!
+ * @brief convert a half precision constant to float (copied once), for the
+ * operands the kernels only take as float (bias)
+ */
+AI_DECLARE_STATIC
+ai_bool tflite_tensor_widen(ai_tflite_ctx* ctx, ai_tensor* t)
+{
+  ai_tflite_model* m = ctx->model;
+  ai_array* array = t->data;
+  const ai_size idx = t - m->tensors;
+
+  if ( AI_FMT_GET_BITS(AI_ARRAY_OBJ_FMT(array))!=16 ) return true;
+  ai_float* data = malloc(array->size * sizeof(ai_float));
+  if ( !data ) return false;
+  core_convert_f16_to_f32(data, AI_ARRAY_OBJ_DATA(array, ai_u16), array->size);
+  free(m->copies[idx]);
+  m->copies[idx] = data;
+
+  array->format = AI_ARRAY_FORMAT_FLOAT | AI_FMT_FLAG_CONST;
+  array->data = AI_PTR(data);
+  array->data_start = AI_PTR(data);
+  for ( ai_size i=0; i<AI_SHAPE_MAX_DIMENSION; i++ ) m->strides[idx][i] *= 2;
+  return true;
+}
+
+/*!
+ * @brief DEQUANTIZE of a half precision constant (float16 quantized model):
+ * no node, the constant stands for the float output and is read in place by
+ * its consumers (dense weights)
+ */
+AI_DECLARE_STATIC
+ai_bool tflite_node_dequantize(ai_tflite_ctx* ctx, const ai_size inputs,
+                               const ai_size outputs, const ai_u16 node_idx)
+{
+  ai_tflite_reader* r = &ctx->r;
+  const ai_i32 dst = (ai_i32)tflite_read(r, outputs, 4);
+  if ( (dst < 0) || ((ai_size)dst >= ctx->n_fb_tensors) ||
+       ctx->built[dst] || (ctx->alias[dst] >= 0) ) return false;
+
+  const ai_tensor* t = tflite_tensor_get(ctx, (ai_i32)tflite_read(r, inputs, 4),
+                                         node_idx);
+  if ( !t || (AI_FMT_GET_BITS(AI_ARRAY_OBJ_FMT(t->data))!=16) ) return false;
+  ctx->alias[dst] = (ai_i32)(t - ctx->model->tensors);
+  return true;
+}
+
+/*!
+ * @brief set up the node node_idx and its chain: n_in inputs, one output
+ * then the weights/bias (n_params)
+ */
+AI_DECLARE_STATIC
+ai_node* tflite_node_init(ai_tflite_ctx* ctx, const ai_u16 node_idx,
+                          const ai_layer_type type, node_forward_func forward,
+                          ai_tensor** in, const ai_u16 n_in, ai_tensor* out,
+                          ai_tensor** params, const ai_u16 n_params)
+{
+  ai_tflite_model* m = ctx->model;
+  ai_node* node = (ai_node*)&m->nodes[node_idx];
+  ai_tflite_chain* c = &m->chains[node_idx];
+
+  ai_tensor** refs = c->refs;
+  for ( ai_u16 i=0; i<n_in; i++ ) refs[i] = in[i];
+  refs[n_in] = out;
+  for ( ai_u16 i=0; i<n_params; i++ ) refs[n_in + 1 + i] = params[i];
+
+  c->lists[AI_TENSOR_CHAIN_INPUT] = (ai_tensor_list) {
+    .size = n_in, .flags = AI_FLAG_NONE, .tensor = refs, .info = NULL };
+  c->lists[AI_TENSOR_CHAIN_OUTPUT] = (ai_tensor_list) {
+    .size = 1, .flags = AI_FLAG_NONE, .tensor = refs + n_in, .info = NULL };
+  c->lists[AI_TENSOR_CHAIN_WEIGHTS] = (ai_tensor_list) {
+    .size = n_params, .flags = AI_FLAG_NONE, .tensor = refs + n_in + 1,
+    .info = NULL };
+  c->lists[AI_TENSOR_CHAIN_SCRATCH] = (ai_tensor_list) {
+    .size = 0, .flags = AI_FLAG_NONE, .tensor = refs + n_in + 1 + n_params,
+    .info = NULL };
+  c->chain.size = AI_TENSOR_CHAIN_SIZE;
+  c->chain.flags = AI_FLAG_NONE;
+  c->chain.chain = c->lists;
+
+  node->type = AI_NODE_TYPE(type);
+  node->id = AI_ID_OBJ(node_idx);
+  node->klass = NULL;
+  node->network = &m->net;
+  node->next = node;
+  node->forward = forward;
+  node->tensors = &c->chain;
+  if ( node_idx > 0 ) ((ai_node*)&m->nodes[node_idx-1])->next = node;
+  return node;
+}
+
+/*!
+ * @brief nonlinearity node of a tflite activation (operator or fused one)
+ */
+AI_DECLARE_STATIC
+ai_bool tflite_node_nl(ai_tflite_ctx* ctx, const ai_u16 node_idx,
+                       const ai_u32 act, ai_tensor* in, ai_tensor* out)
+{
+  node_forward_func forward;
+  switch ( act ) {
+    case TFL_ACT_RELU:  forward = forward_relu; break;
+    case TFL_ACT_RELU6: forward = forward_clip; break;
+    case TFL_ACT_TANH:  forward = forward_tanh; break;
+    default:            return false;
+  }
+  if ( AI_ARRAY_OBJ_SIZE(in->data)!=AI_ARRAY_OBJ_SIZE(out->data) ) return false;
+
+  ai_node* node = tflite_node_init(ctx, node_idx, AI_LAYER_NL_TYPE, forward,
+                                   &in, 1, out, NULL, 0);
+  ((ai_layer_nl*)node)->nl_params =
+    (act==TFL_ACT_RELU6) ? &ctx->model->relu6_array : NULL;
+  return true;
+}
+
+/*!
+ * @brief map the operator op on one node, two with a fused activation
+ */
+AI_DECLARE_STATIC
+ai_bool tflite_node_op(ai_tflite_ctx* ctx, const ai_size op,
+                       const ai_u32 code, ai_u16* node_idx)
+{
+  ai_tflite_reader* r = &ctx->r;
+  ai_tensor* in[3] = { NULL, NULL, NULL };
+  ai_size n_in, n_out;
+  const ai_size inputs = tflite_vector(r, op, TFL_OPERATOR_INPUTS, 4, &n_in);
+  const ai_size outputs = tflite_vector(r, op, TFL_OPERATOR_OUTPUTS, 4, &n_out);
+  const ai_size options = tflite_table(r, op, TFL_OPERATOR_OPTIONS);
+  if ( !r->ok || (n_in < 1) || (n_in > 3) || (n_out!=1) ) return false;
+
+  if ( code==TFL_OP_DEQUANTIZE )
+    return (n_in==1) && tflite_node_dequantize(ctx, inputs, outputs, *node_idx);
+
+  const ai_u16 idx = *node_idx;
+  ai_tensor* out = tflite_tensor_get(ctx, (ai_i32)tflite_read(r, outputs, 4), idx);
+  for ( ai_size i=0; i<n_in; i++ ) {
+    const ai_i32 t = (ai_i32)tflite_read(r, inputs + 4*i, 4);
+    if ( t < 0 ) continue;   /* optional input not set */
+    in[i] = tflite_tensor_get(ctx, t, idx);
+    if ( !in[i] ) return false;
+  }
+  if ( !out || !in[0] ) return false;
+  /* half precision constants: dense weights only */
+  for ( ai_size i=0; i<n_in; i++ ) {
+    if ( in[i] && (AI_FMT_GET_BITS(AI_ARRAY_OBJ_FMT(in[i]->data))==16) &&
+         ((code!=TFL_OP_FULLY_CONNECTED) || (i==0)) ) return false;
+  }
+
+  const ai_u32 act = tflite_scalar(r, options, TFL_OPTIONS_ACTIVATION, 1,
+                                   TFL_ACT_NONE);
+  const ai_bool fused = (code==TFL_OP_FULLY_CONNECTED || code==TFL_OP_ADD) &&
+                        (act!=TFL_ACT_NONE);
+  ai_tensor* node_out = (fused) ? tflite_tensor_like(ctx, out, idx) : out;
+
+  switch ( code ) {
+    case TFL_OP_FULLY_CONNECTED: {
+      ai_tensor* w = in[1];
+      ai_tensor* b = (n_in > 2) ? in[2] : NULL;
+      if ( !w || (tflite_scalar(r, options, TFL_OPTIONS_WEIGHTS_FORMAT, 1, 0)!=0) ||
+           (b && !tflite_tensor_widen(ctx, b)) )
+        return false;
+      /* weights [n_out][n_in]: in_channels n_in, channels n_out */
+      const ai_size w_idx = w - ctx->model->tensors;
+      ai_shape_dimension* shape = ctx->model->shapes[w_idx];
+      ai_stride_dimension* stride = ctx->model->strides[w_idx];
+      const ai_size n_w_out = shape[AI_SHAPE_HEIGHT] * shape[AI_SHAPE_WIDTH];
+      const ai_size n_w_in = shape[AI_SHAPE_CHANNEL];
+      const ai_size w_elem = AI_FMT_GET_BITS(AI_ARRAY_OBJ_FMT(w->data)) >> 3;
+      shape[AI_SHAPE_IN_CHANNEL] = n_w_in;
+      shape[AI_SHAPE_CHANNEL] = n_w_out;
+      shape[AI_SHAPE_WIDTH] = shape[AI_SHAPE_HEIGHT] = 1;
+      stride[AI_SHAPE_CHANNEL] = n_w_in * w_elem;
+      stride[AI_SHAPE_WIDTH] = stride[AI_SHAPE_HEIGHT] =
+        n_w_in * n_w_out * w_elem;
+      if ( !(AI_ARRAY_OBJ_FMT(w->data) & AI_FMT_FLAG_CONST) ||
+           (AI_ARRAY_OBJ_SIZE(in[0]->data)!=n_w_in) ||
+           (AI_ARRAY_OBJ_SIZE(out->data)!=n_w_out) ||
+           (b && (AI_ARRAY_OBJ_SIZE(b->data)!=n_w_out)) ) return false;
+
+      ai_tensor* params[2] = { w, b };
+      tflite_node_init(ctx, idx, AI_LAYER_DENSE_TYPE, forward_dense,
+                       in, 1, node_out, params, (b) ? 2 : 1);
+      ctx->model->n_macc += n_w_in * n_w_out;
+    } break;
+    case TFL_OP_ADD: {
+      if ( (n_in!=2) || !in[1] ) return false;
+      tflite_node_init(ctx, idx, AI_LAYER_ADD_TYPE, forward_add,
+                       in, 2, node_out, NULL, 0);
+    } break;
+    case TFL_OP_RELU:
+      if ( !tflite_node_nl(ctx, idx, TFL_ACT_RELU, in[0], out) ) return false;
+      break;
+    case TFL_OP_RELU6:
+      if ( !tflite_node_nl(ctx, idx, TFL_ACT_RELU6, in[0], out) ) return false;
+      break;
+    case TFL_OP_TANH:
+      if ( !tflite_node_nl(ctx, idx, TFL_ACT_TANH, in[0], out) ) return false;
+      break;
+    case TFL_OP_LOGISTIC: {
+      if ( AI_ARRAY_OBJ_SIZE(in[0]->data)!=AI_ARRAY_OBJ_SIZE(out->data) )
+        return false;
+      tflite_node_init(ctx, idx, AI_LAYER_NL_TYPE, forward_sigmoid,
+                       in, 1, out, NULL, 0);
+    } break;
+    default:
+      return false;
+  }
+  *node_idx = idx + 1;
+
+  if ( fused ) {
+    ctx->last[out - ctx->model->tensors] = idx + 1;
+    if ( !tflite_node_nl(ctx, idx + 1, act, node_out, out) ) return false;
+    *node_idx = idx + 2;
+  }
+  return true;
+}
+
+/*!
+ * @brief network I/O list of the subgraph inputs (l=0) or outputs (l=1)
+ */
+AI_DECLARE_STATIC
+ai_bool tflite_io_init(ai_tflite_ctx* ctx, const ai_size l, const ai_u16 id)
+{
+  ai_tflite_model* m = ctx->model;
+  ai_size n;
+  const ai_size vec = tflite_vector(&ctx->r, ctx->subgraph, id, 4, &n);
+  if ( n!=1 ) return false;
+
+  const ai_i32 idx = (ai_i32)tflite_read(&ctx->r, vec, 4);
+  if ( (idx < 0) || ((ai_size)idx >= ctx->n_fb_tensors) || !ctx->built[idx] ||
+       (AI_ARRAY_OBJ_FMT(&m->arrays[idx]) & AI_FMT_FLAG_CONST) ) return false;
+
+  m->arrays[idx].format |= AI_FMT_FLAG_IS_IO;
+  m->io_refs[l] = &m->tensors[idx];
+  m->io_info[l] = (ai_tensor_list_info) {
+    .state = &m->io_states[l], .buffer = &m->io_buffers[l],
+    .meta = &m->io_metas[l] };
+  m->io_lists[l] = (ai_tensor_list) {
+    .size = 1, .flags = AI_FLAG_NONE, .tensor = &m->io_refs[l],
+    .info = &m->io_info[l] };
+  return true;
+}
+
+/*!
+ * @brief plan the offsets of the activations (one sample, see core_plan_pack)
+ * @return the planned size, 0 on error
+ */
+AI_DECLARE_STATIC
+ai_size tflite_plan(ai_tflite_ctx* ctx)
+{
+  ai_tflite_model* m = ctx->model;
+
+  m->plan = malloc(m->n_tensors * sizeof(ai_plan_buffer));
+  m->plan_arrays = malloc(m->n_tensors * sizeof(ai_array*));
+  if ( !m->plan || !m->plan_arrays ) return 0;
+
+  /* the arena is at most the sum of the buffers: bounded on 64 bits */
+  ai_u64 total = 0;
+  for ( ai_size i=0; i<m->n_tensors; i++ ) {
+    const ai_array* a = &m->arrays[i];
+    if ( !ctx->built[i] || (a->format & (AI_FMT_FLAG_CONST|AI_FMT_FLAG_IS_IO)) )
+      continue;
+    m->plan_arrays[m->n_plan] = &m->arrays[i];
+    m->plan[m->n_plan] = (ai_plan_buffer) {
+      .size = AI_PTR_ALIGN(a->size * sizeof(ai_float), AI_PLAN_ALIGN),
+      .first = ctx->first[i], .last = ctx->last[i], .offset = 0 };
+    total += m->plan[m->n_plan++].size;
+    if ( total > AI_TFLITE_TENSOR_BYTES_MAX ) return 0;
+  }
+  const ai_size size = core_plan_pack(m->plan, m->n_plan);
+  return (size || !m->n_plan) ? AI_MAX(size, AI_PLAN_ALIGN) : 0;
+}
+
+/*!
+ * @brief build the template network of the first subgraph
+ */
+AI_DECLARE_STATIC
+ai_error tflite_build(ai_tflite_ctx* ctx, const ai_u16 n_batches)
+{
+  ai_tflite_model* m = ctx->model;
+  ai_tflite_reader* r = &ctx->r;
+
+  const ai_size root = tflite_read(r, 0, 4);
+  m->version = (ai_u8)tflite_scalar(r, root, TFL_MODEL_VERSION, 4, 0);
+
+  ai_size n_codes, n_subgraphs, n_ops;
+  const ai_size codes = tflite_vector(r, root, TFL_MODEL_OPERATOR_CODES, 4, &n_codes);
+  const ai_size subgraphs = tflite_vector(r, root, TFL_MODEL_SUBGRAPHS, 4, &n_subgraphs);
+  ctx->buffers = tflite_vector(r, root, TFL_MODEL_BUFFERS, 4, &ctx->n_buffers);
+  if ( !r->ok || (n_subgraphs < 1) ) return tflite_error(AI_ERROR_INVALID_PARAM, AI_ERROR_CODE_INVALID_FORMAT);
+
+  ctx->subgraph = tflite_vector_table(r, subgraphs, 0);
+  ctx->tensors = tflite_vector(r, ctx->subgraph, TFL_SUBGRAPH_TENSORS, 4, &ctx->n_fb_tensors);
+  const ai_size ops = tflite_vector(r, ctx->subgraph, TFL_SUBGRAPH_OPERATORS, 4, &n_ops);
+  if ( !r->ok || !n_ops || (2*n_ops > 0xFFFF) ) return tflite_error(AI_ERROR_INVALID_PARAM, AI_ERROR_CODE_INVALID_FORMAT);
+
+  /* worst case: a fused activation (extra node and tensor) per operator */
+  m->n_tensors = ctx->n_fb_tensors + n_ops;
+  m->tensors = calloc(m->n_tensors, sizeof(ai_tensor));
+  m->arrays = calloc(m->n_tensors, sizeof(ai_array));
+  m->shapes = calloc(m->n_tensors, sizeof(*m->shapes));
+  m->strides = calloc(m->n_tensors, sizeof(*m->strides));
+  m->copies = calloc(m->n_tensors, sizeof(void*));
+  m->nodes = calloc(2*n_ops, sizeof(ai_tflite_node));
+  m->chains = calloc(2*n_ops, sizeof(ai_tflite_chain));
+  ctx->built = calloc(m->n_tensors, sizeof(ai_bool));
+  ctx->first = malloc(m->n_tensors * sizeof(ai_u16));
+  ctx->last = calloc(m->n_tensors, sizeof(ai_u16));
+  ctx->alias = malloc(m->n_tensors * sizeof(ai_i32));
+  if ( !m->tensors || !m->arrays || !m->shapes || !m->strides || !m->copies ||
+       !m->nodes || !m->chains || !ctx->built || !ctx->first || !ctx->last ||
+       !ctx->alias )
+    return tflite_error(AI_ERROR_ALLOCATION_FAILED, AI_ERROR_CODE_NETWORK);
+  for ( ai_size i=0; i<m->n_tensors; i++ ) {
+    ctx->first[i] = 0xFFFF;
+    ctx->alias[i] = -1;
+  }
+
+  m->relu6[0] = 0.0f;
+  m->relu6[1] = 6.0f;
+  m->relu6_array = (ai_array) {
+    .format = AI_ARRAY_FORMAT_FLOAT | AI_FMT_FLAG_CONST, .size = 2,
+    .data = AI_PTR(m->relu6), .data_start = AI_PTR(m->relu6) };
+
+  /* operators, in execution order */
+  ai_u16 n_nodes = 0;
+  for ( ai_size k=0; k<n_ops; k++ ) {
+    const ai_size op = tflite_vector_table(r, ops, k);
+    const ai_size opcode = tflite_scalar(r, op, TFL_OPERATOR_OPCODE_INDEX, 4, 0);
+    if ( !r->ok || (opcode >= n_codes) ) return tflite_error(AI_ERROR_INVALID_PARAM, AI_ERROR_CODE_INVALID_FORMAT);
+    const ai_size code_table = tflite_vector_table(r, codes, opcode);
+    /* the deprecated code is the only one set by the older converters */
+    const ai_u32 code = AI_MAX(
+      tflite_scalar(r, code_table, TFL_OPCODE_DEPRECATED_CODE, 1, 0),
+      tflite_scalar(r, code_table, TFL_OPCODE_BUILTIN_CODE, 4, 0));
+    if ( !tflite_node_op(ctx, op, code, &n_nodes) || !r->ok )
+      return tflite_error(AI_ERROR_INVALID_PARAM, AI_ERROR_CODE_INVALID_FORMAT);
+  }
+  m->n_nodes = n_nodes;
+
+  if ( !tflite_io_init(ctx, 0, TFL_SUBGRAPH_INPUTS) ||
+       !tflite_io_init(ctx, 1, TFL_SUBGRAPH_OUTPUTS) )
+    return tflite_error(AI_ERROR_INVALID_PARAM, AI_ERROR_CODE_INVALID_FORMAT);
+
+  const ai_size arena = tflite_plan(ctx);
+  if ( !arena ) return tflite_error(AI_ERROR_ALLOCATION_FAILED, AI_ERROR_CODE_NETWORK_ACTIVATIONS);
+
+  const ai_u16 batches = (n_batches) ? n_batches : AI_TFLITE_N_BATCHES;
+  /* the planned offsets are scaled by the batch (see ai_tflite_init) */
+  if ( (ai_u64)arena*batches > AI_TFLITE_TENSOR_BYTES_MAX )
+    return tflite_error(AI_ERROR_ALLOCATION_FAILED, AI_ERROR_CODE_NETWORK_ACTIVATIONS);
+  /* no weights buffer: the weights are the model ones */
+  m->net.params = (ai_buffer)AI_BUFFER_OBJ_INIT(
+    AI_BUFFER_FORMAT_U8, 1, 1, 0, 1, NULL);
+  m->net.activations = (ai_buffer)AI_BUFFER_OBJ_INIT(
+    AI_BUFFER_FORMAT_U8, 1, 1, arena, batches, NULL);
+  m->net.tensors.size = 2;
+  m->net.tensors.flags = AI_FLAG_NONE;
+  m->net.tensors.chain = m->io_lists;
+  m->net.input_node = (ai_node*)&m->nodes[0];
+  return tflite_error(AI_ERROR_NONE, AI_ERROR_CODE_NONE);
+}
+
+AI_DECLARE_STATIC
+void tflite_free(ai_tflite_model* m)
+{
+  if ( !m ) return;
+  for ( ai_size i=0; m->copies && i<m->n_tensors; i++ ) free(m->copies[i]);
+  free(m->copies);
+  free(m->tensors);
+  free(m->arrays);
+  free(m->shapes);
+  free(m->strides);
+  free(m->nodes);
+  free(m->chains);
+  free(m->plan);
+  free(m->plan_arrays);
+  free(m);
+}
+
+/******************************************************************************/
+AI_INTERNAL_API
+ai_error core_tflite_open(ai_handle* model, const char* name,
+                          const ai_handle data, const ai_size size,
+                          const ai_u16 n_batches)
+{
+  if ( !model ) return tflite_error(AI_ERROR_INVALID_HANDLE, AI_ERROR_CODE_NETWORK);
+  *model = AI_HANDLE_NULL;
+
+  if ( !data || (size < 8) ||
+       memcmp((const ai_u8*)data + 4, AI_TFLITE_IDENTIFIER, 4) )
+    return tflite_error(AI_ERROR_INVALID_PARAM, AI_ERROR_CODE_INVALID_FORMAT);
+
+  ai_tflite_model* m = calloc(1, sizeof(ai_tflite_model));
+  if ( !m ) return tflite_error(AI_ERROR_ALLOCATION_FAILED, AI_ERROR_CODE_NETWORK);
+
+  snprintf(m->name, sizeof(m->name), "%s", (name) ? name : "tflite");
+  tflite_signature((const ai_u8*)data, size, m->signature);
+  m->data = data;
+  m->size = size;
+  m->storage = AI_TFLITE_DATA_EXTERNAL;
+
+  ai_tflite_ctx ctx = {
+    .r = { .data = data, .size = size, .ok = true },
+    .model = m,
+  };
+  const ai_error err = tflite_build(&ctx, n_batches);
+  free(ctx.built);
+  free(ctx.first);
+  free(ctx.last);
+  free(ctx.alias);
+
+  if ( err.type!=AI_ERROR_NONE ) {
+    tflite_free(m);
+    return err;
+  }
+  *model = AI_HANDLE_PTR(m);
+  return err;
+}
+
+AI_INTERNAL_API
+ai_error core_tflite_load(ai_handle* model, const char* path,
+                          const ai_u16 n_batches)
+{
+  if ( !model || !path ) return tflite_error(AI_ERROR_INVALID_HANDLE, AI_ERROR_CODE_NETWORK);
+  *model = AI_HANDLE_NULL;
+
+  /* model named after the file */
+  char name[AI_TFLITE_NAME_SIZE];
+  const char* base = strrchr(path, '/');
+  snprintf(name, sizeof(name), "%s", (base) ? base + 1 : path);
+  char* ext = strrchr(name, '.');
+  if ( ext && (ext!=name) ) *ext = '\0';
+
+  ai_u8* data = NULL;
+  ai_size size = 0;
+  ai_u8 storage = AI_TFLITE_DATA_HEAP;
+
+#if defined(AI_TFLITE_WITH_MMAP)
+  const int fd = open(path, O_RDONLY);
+  struct stat st;
+  if ( fd < 0 ) return tflite_error(AI_ERROR_INVALID_PARAM, AI_ERROR_CODE_NETWORK);
+  if ( (fstat(fd, &st)==0) && (st.st_size > 0) ) {
+    void* map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if ( map!=MAP_FAILED ) {
+      data = map;
+      size = (ai_size)st.st_size;
+      storage = AI_TFLITE_DATA_MAPPED;
+    }
+  }
+  close(fd);
+#endif
+
+  if ( !data ) {
+    FILE* f = fopen(path, "rb");
+    if ( !f ) return tflite_error(AI_ERROR_INVALID_PARAM, AI_ERROR_CODE_NETWORK);
+    long n = (fseek(f, 0, SEEK_END)==0) ? ftell(f) : -1;
+    data = (n > 0 && fseek(f, 0, SEEK_SET)==0) ? malloc((size_t)n) : NULL;
+    if ( data && (fread(data, 1, (size_t)n, f)!=(size_t)n) ) {
+      free(data);
+      data = NULL;
+    }
+    fclose(f);
+    if ( !data ) return tflite_error(AI_ERROR_INIT_FAILED, AI_ERROR_CODE_NETWORK);
+    size = (ai_size)n;
+  }
+
+  const ai_error err = core_tflite_open(model, name, data, size, n_batches);
+  if ( err.type!=AI_ERROR_NONE ) {
+#if defined(AI_TFLITE_WITH_MMAP)
+    if ( storage==AI_TFLITE_DATA_MAPPED ) munmap(data, size);
+#endif
+    if ( storage==AI_TFLITE_DATA_HEAP ) free(data);
+    return err;
+  }
+  ((ai_tflite_model*)*model)->storage = storage;
+  return err;
+}
+
+AI_INTERNAL_API
+void core_tflite_close(ai_handle model)
+{
+  ai_tflite_model* m = (ai_tflite_model*)model;
+  if ( !m ) return;
+
+#if defined(AI_TFLITE_WITH_MMAP)
+  if ( m->storage==AI_TFLITE_DATA_MAPPED ) munmap((void*)m->data, m->size);
+#endif
+  if ( m->storage==AI_TFLITE_DATA_HEAP ) free((void*)m->data);
+  tflite_free(m);
+}
+
+AI_INTERNAL_API
+const char* core_tflite_get_name(const ai_handle model)
+{
+  const ai_tflite_model* m = (const ai_tflite_model*)model;
+  return (m) ? m->name : NULL;
+}
+
+AI_INTERNAL_API
+ai_bool core_tflite_get_params(const ai_handle model,
+                               ai_network_params* params)
+{
+  const ai_tflite_model* m = (const ai_tflite_model*)model;
+  if ( !m || !params ) return false;
+
+  params->params = m->net.params;
+  params->activations = m->net.activations;
+  /* one buffer holding all the batches */
+  params->activations.channels *= params->activations.n_batches;
+  params->activations.n_batches = 1;
+  return true;
+}
+
+/*!
+ * @brief model of an instance: its template network (see core_network_clone)
+ */
+AI_DECLARE_STATIC
+const ai_tflite_model* tflite_model(ai_handle network)
+{
+  ai_network* net = AI_NETWORK_ACQUIRE_CTX(network);
+  return (net) ? (const ai_tflite_model*)net->klass : NULL;
+}
+
+AI_API_ENTRY
+ai_bool ai_tflite_get_info(ai_handle network, ai_network_report* report)
+{
+  const ai_tflite_model* m = tflite_model(network);
+
+  if ( report && m )
+  {
+    ai_network_report r = {
+      .model_name        = m->name,
+      .model_signature   = m->signature,
+      .model_datetime    = "n.a.",
+
+      .compile_datetime  = __DATE__ " " __TIME__,
+
+      .runtime_revision  = ai_platform_runtime_get_revision(),
+      .runtime_version   = ai_platform_runtime_get_version(),
+
+      .tool_revision     = "(tflite)",
+      .tool_version      = {m->version, 0x0, 0x0, 0x0},
+      .tool_api_version  = {AI_TFLITE_API_VERSION_MAJOR, AI_TFLITE_API_VERSION_MINOR,
+                            AI_TFLITE_API_VERSION_MICRO, 0x0},
+
+      .api_version            = ai_platform_api_get_version(),
+      .interface_api_version  = ai_platform_interface_api_get_version(),
+
+      .n_macc            = m->n_macc,
+      .n_inputs          = 0,
+      .inputs            = NULL,
+      .n_outputs         = 0,
+      .outputs           = NULL,
+      .activations       = AI_STRUCT_INIT,
+      .params            = AI_STRUCT_INIT,
+      .n_nodes           = 0,
+      .signature         = 0x0,
+    };
+
+    if ( !ai_platform_api_get_network_report(network, &r) ) return false;
+
+    *report = r;
+    return true;
+  }
+
+  return false;
+}
+
+AI_API_ENTRY
+ai_error ai_tflite_get_error(ai_handle network)
+{
+  return ai_platform_network_get_error(network);
+}
+
+AI_API_ENTRY
+ai_error ai_tflite_create(ai_handle* network, const ai_buffer* network_config)
+{
+  ai_tflite_model* m = (network_config) ? (ai_tflite_model*)network_config->data : NULL;
+  return ai_platform_network_create(
+    network, network_config, (m) ? &m->net : NULL,
+    AI_TFLITE_API_VERSION_MAJOR, AI_TFLITE_API_VERSION_MINOR,
+    AI_TFLITE_API_VERSION_MICRO);
+}
+
+AI_API_ENTRY
+ai_handle ai_tflite_destroy(ai_handle network)
+{
+  return ai_platform_network_destroy(network);
+}
+
+AI_API_ENTRY
+ai_bool ai_tflite_init(ai_handle network, const ai_network_params* params)
+{
+  ai_network* net_ctx = ai_platform_network_init(network, params);
+  if ( !net_ctx ) return false;
+
+  const ai_tflite_model* m = (const ai_tflite_model*)net_ctx->klass;
+  const ai_size n_batches = AI_MAX(m->net.activations.n_batches, 1);
+  ai_ptr activations = AI_PTR(AI_PTR_ALIGN(params->activations.data, 4));
+
+  /* Updating activations (byte) offsets, the weights are the model ones */
+  for ( ai_size i=0; i<m->n_plan; i++ ) {
+    ai_array* array = ai_platform_network_get_array(net_ctx, m->plan_arrays[i]);
+    array->data = AI_PTR(activations + m->plan[i].offset*n_batches);
+    array->data_start = array->data;
+  }
+
+  return ai_platform_network_post_init(network);
+}
+
+AI_API_ENTRY
+ai_i32 ai_tflite_run(ai_handle network, const ai_buffer* input,
+                     ai_buffer* output)
+{
+  return ai_platform_network_process(network, input, output);
+}
+
+AI_API_ENTRY
+ai_i32 ai_tflite_forward(ai_handle network, const ai_buffer* input)
+{
+  return ai_platform_network_process(network, input, NULL);
+}
@@ -0,0 +1,49 @@
+/**
+  ******************************************************************************
+  * @file    layers.c
+  * @brief   implementation of the layers graph walker
+  ******************************************************************************
+  * @attention
+  *
+  * Open implementation of the forward routines declared in layers.h. The
+  * network is walked following the ai_node next pointers emitted by
+  * AI_LAYER_OBJ_DECLARE(); the last node is the one looping back on itself.
+  *
+  ******************************************************************************
+  */
+
+#include "layers.h"
+
+/******************************************************************************/
+AI_INTERNAL_API
+ai_layer* ai_layers_forward_layer(ai_layer* layer)
+{
+  AI_ASSERT(layer && layer->forward)
+  layer->forward(AI_NODE_OBJ(layer));
+  return (AI_NODE_IS_LAST(layer)) ? NULL : AI_LAYER_OBJ(layer->next);
+}
+
+AI_INTERNAL_API
+void ai_layers_forward_all(ai_network* net)
+{
+  AI_ASSERT(net)
+  const ai_node_exec_cb on_node_exec = net->on_node_exec;
+
+  if ( on_node_exec ) {
+    on_node_exec(AI_NODE_EXEC_START, NULL, net->data_exec);
+  }
+
+  ai_layer* layer = AI_LAYER_OBJ(net->input_node);
+  while ( layer ) {
+    net->current_node = AI_NODE_OBJ(layer);
+    if ( on_node_exec ) {
+      on_node_exec(AI_NODE_EXEC_PRE, AI_NODE_OBJ(layer), net->data_exec);
+    }
+    ai_layer* next = ai_layers_forward_layer(layer);
+    if ( on_node_exec ) {
+      on_node_exec(AI_NODE_EXEC_POST, AI_NODE_OBJ(layer), net->data_exec);
+    }
+    layer = next;
+  }
+  net->current_node = AI_NODE_OBJ(NULL);
+}
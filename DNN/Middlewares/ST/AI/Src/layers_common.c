@@ -0,0 +1,80 @@
+/**
+  ******************************************************************************
+  * @file    layers_common.c
+  * @brief   implementation of common layers helpers
+  ******************************************************************************
+  * @attention
+  *
+  * Open implementation of the layers helpers declared in layers_common.h.
+  * The layer types tables are generated from layers_list.h.
+  * The layers scratch buffers fall back on the arena of the network instance
+  * (see core_network.h).
+  *
+  ******************************************************************************
+  */
+
+#include "layers_common.h"
+#include "core_network.h"
+
+/******************************************************************************/
+AI_STATIC_CONST ai_layer_type g_layer_types[] = {
+#define LAYER_ENTRY(type_, id_, struct_, forward_func_) \
+  AI_LAYER_TYPE_ENTRY(type_),
+#include "layers_list.h"
+};
+
+AI_STATIC_CONST char* g_layer_types_names[] = {
+#define LAYER_ENTRY(type_, id_, struct_, forward_func_) \
+  AI_STRINGIFY(type_),
+#include "layers_list.h"
+};
+
+/******************************************************************************/
+AI_INTERNAL_API
+ai_bool ai_check_custom_types(const ai_custom_type_signature* signatures)
+{
+  AI_STATIC AI_CUSTOM_TYPES_SIGNATURE_DECLARE(ref_signatures)
+
+  if ( !signatures ) return false;
+  if ( signatures[0]!=ref_signatures[0] ) return false;
+
+  for ( ai_size i=1; i<=AI_CUSTOM_TYPES_COUNT; i++ ) {
+    if ( signatures[i]!=ref_signatures[i] ) return false;
+  }
+  return true;
+}
+
+AI_INTERNAL_API
+const char* ai_layer_type_name(const ai_layer_type type)
+{
+  for ( ai_size i=0; i<AI_C_ARRAY_COUNT(g_layer_types); i++ ) {
+    if ( g_layer_types[i]==type ) return g_layer_types_names[i];
+  }
+  return "UNDEFINED";
+}
+
+AI_INTERNAL_API
+ai_bool ai_layer_type_is_valid(const ai_layer_type type)
+{
+  for ( ai_size i=0; i<AI_C_ARRAY_COUNT(g_layer_types); i++ ) {
+    if ( g_layer_types[i]==type ) return true;
+  }
+  return false;
+}
+
+AI_INTERNAL_API
+ai_handle ai_layer_get_scratch(ai_layer* layer, const ai_size size)
+{
+  if ( !layer ) return NULL;
+
+  const ai_tensor* t =
+    (layer->tensors &&
+     GET_TENSOR_LIST_SIZE(GET_TENSOR_LIST_SCRATCH(layer->tensors))>0)
+    ? GET_TENSOR_SCRATCH(layer->tensors, 0) : NULL;
+  if ( t && t->data && AI_ARRAY_OBJ_DATA(t->data, void) &&
+       (AI_ARRAY_OBJ_FMT(t->data) & AI_FMT_FLAG_SCRATCH_BUFFER) &&
+       (AI_ARRAY_OBJ_BYTE_SIZE(t->data)>=size) ) {
+    return AI_ARRAY_OBJ_DATA(t->data, void);
+  }
+  return core_network_get_scratch(layer->network, size);
+}
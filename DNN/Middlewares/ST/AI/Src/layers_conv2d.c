@@ -0,0 +1,1499 @@
+/**
+  ******************************************************************************
+  * @file    layers_conv2d.c
+  * @brief   implementation of the 2D convolutional layers
+  ******************************************************************************
+  * @attention
+  *
+  * Open implementation of the integer SSSA convolutions declared in
+  * layers_conv2d.h (signed symmetric int8 weights, signed asymmetric int8
+  * activations, int32 bias). Activations are stored as [h][w][ch], weights as
+  * [out_ch][kh][kw][in_ch / groups]: each output value is accumulated in
+  * int32 over the filter window (the padded positions hold the input zero
+  * point, i.e. contribute 0) and requantized with the scales read from the
+  * intq info of the tensors: one weights scale for the layer (SSSA) or one
+  * per output channel (SSSA_ch). The pointwise convolutions are dense layers
+  * over the input pixels (int8 dot kernels of layers_dense.h, see
+  * dense_kernel_s8_init()); the depthwise ones gather the valid filter
+  * positions of an output pixel once and accumulate 8 channels at a time
+  * (AVX2) with the weights transposed as [kh * kw][ch] once per instance
+  * (see core_graph_get_prepared()).
+  *
+  * The float convolution (forward_conv2d) picks its algorithm per layer
+  * (see conv2d_algo_select()):
+  *  - depthwise (one filter of up to 5x5 per channel): the valid filter
+  *    positions of an output pixel are gathered once, the channels are
+  *    accumulated by 8 (AVX2 + FMA) or 16 (AVX-512) with the weights
+  *    transposed as [kh * kw][ch],
+  *  - pointwise (1x1, stride 1, not padded): the input pixels are the rows of
+  *    a single GEMM,
+  *  - direct: accumulation over the filter window, used for the other grouped
+  *    convolutions and the ones with few output channels,
+  *  - im2col: the filter windows of a tile of output pixels are copied as
+  *    rows of a scratch tile, multiplied by the weights with the register
+  *    blocked GEMM kernels of layers_dense.h (see dense_kernel_gemm_init())
+  *    with the weights transposed as [kh * kw * in_ch][out_ch],
+  *  - Winograd F(2x2, 3x3) for the 3x3 stride 1 convolutions with enough
+  *    output tiles (AI_CONV2D_WINOGRAD_MIN_TILES): each 4x4 input tile is
+  *    transformed, the 16 transformed positions are 16 GEMMs with the
+  *    transformed weights, the results are transformed back to 2x2 outputs
+  *    (2.25x less multiplications). The transforms of 8 channels at a time
+  *    use AVX2 when available.
+  * The transposed (transformed) weights are computed on the first call for
+  * the weights bound to the instance and kept with its graph state (see
+  * core_graph_get_prepared()); each call only selects the algorithm and the
+  * tiling. The scratch tiles are taken from the scratch tensor of the
+  * layer, or from the scratch arena of the network instance (see
+  * ai_layer_get_scratch()), and are sized to stay in the cpu caches
+  * (AI_CONV2D_TILE_SIZE). Without memory for the weights or the tiles the
+  * direct algorithm is used. The optional nonlinearity
+  * is applied on the whole output.
+  *
+  * The fused convolution + nonlinearity + pooling (forward_conv2d_nl_pool)
+  * computes bands of convolution rows (a band of rows being the convolution
+  * with a shifted top padding) in a scratch buffer of about
+  * AI_CONV2D_TILE_SIZE bytes, applies the nonlinearity on the band while it
+  * is in cache and folds each row into the pooled rows whose window holds
+  * it. A non-decreasing nonlinearity (relu, clip, sigmoid, hard sigmoid,
+  * tanh) followed by a max pooling is applied on the pooled outputs
+  * instead, with the same results.
+  *
+  * A float depthwise convolution followed by a pointwise one is fused by the
+  * graph optimizations (see core_graph.h, forward_conv2d_dw_pw()): bands of
+  * depthwise rows (nonlinearity applied) of about AI_CONV2D_TILE_SIZE bytes
+  * are multiplied by the pointwise weights while they are in cache, the
+  * intermediate activations are never stored.
+  *
+  * filter_pad holds the (x, y) padding of the first row/column, the
+  * right/bottom padding is implied by the output shape (padded positions
+  * contribute 0).
+  *
+  ******************************************************************************
+  */
+
+#include <string.h>
+
+#include "layers_conv2d.h"
+#include "layers_dense.h"
+#include "ai_math_helpers.h"
+#include "core_cpu.h"
+#include "core_graph.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+/* kinds of the weights prepared for the kernels (core_graph_get_prepared) */
+#define CONV2D_PREPARED_F32_T           (0)   /* [n_k][out_ch] floats */
+#define CONV2D_PREPARED_F32_WINOGRAD    (1)   /* [16][in_ch][out_ch] floats */
+#define CONV2D_PREPARED_S8_DEPTHWISE    (2)   /* [kh * kw][ch] int8 */
+
+/******************************************************************************/
+/*  Geometry and algorithm                                                    */
+/******************************************************************************/
+/*!
+ * @struct ai_conv2d_geometry
+ * @brief shapes, strides, dilations and pads of a convolution
+ */
+typedef struct {
+  ai_i32 in_h, in_w, in_ch;
+  ai_i32 out_h, out_w, out_ch;
+  ai_i32 k_h, k_w, k_ch;
+  ai_i32 groups;
+  ai_i32 stride_x, stride_y;
+  ai_i32 dil_x, dil_y;
+  ai_i32 pad_x, pad_y;
+} ai_conv2d_geometry;
+
+AI_DECLARE_STATIC
+void conv2d_geometry_get(const ai_layer_conv2d* l, ai_conv2d_geometry* g)
+{
+  const ai_tensor* input = GET_TENSOR_IN(l->tensors, 0);
+  const ai_tensor* output = GET_TENSOR_OUT(l->tensors, 0);
+  const ai_tensor* weights = GET_TENSOR_WEIGHTS(l->tensors, 0);
+
+  g->in_h  = AI_SHAPE_H(&input->shape);
+  g->in_w  = AI_SHAPE_W(&input->shape);
+  g->in_ch = AI_SHAPE_CH(&input->shape);
+  g->out_h  = AI_SHAPE_H(&output->shape);
+  g->out_w  = AI_SHAPE_W(&output->shape);
+  g->out_ch = AI_SHAPE_CH(&output->shape);
+  g->k_h  = AI_CONV_SHAPE_H(&weights->shape);
+  g->k_w  = AI_CONV_SHAPE_W(&weights->shape);
+  g->k_ch = AI_CONV_SHAPE_IN_CH(&weights->shape);
+  g->groups = (l->groups) ? (ai_i32)l->groups : 1;
+  g->stride_x = AI_MAX(AI_SHAPE_2D_W(&l->filter_stride), 1);
+  g->stride_y = AI_MAX(AI_SHAPE_2D_H(&l->filter_stride), 1);
+  g->dil_x = AI_MAX(AI_SHAPE_2D_W(&l->dilation), 1);
+  g->dil_y = AI_MAX(AI_SHAPE_2D_H(&l->dilation), 1);
+  g->pad_x = (AI_STORAGE_KLASS_SIZE(&l->filter_pad)>1)
+    ? AI_SHAPE_ELEM(&l->filter_pad, 0) : 0;
+  g->pad_y = (AI_STORAGE_KLASS_SIZE(&l->filter_pad)>1)
+    ? AI_SHAPE_ELEM(&l->filter_pad, 1) : 0;
+}
+
+AI_DECLARE_STATIC
+ai_conv2d_algo conv2d_algo_select_geometry(const ai_conv2d_geometry* g)
+{
+  if ( (g->groups>1) && (g->groups==g->in_ch) && (g->k_ch==1) &&
+       (g->out_ch==g->in_ch) &&
+       (g->k_h*g->k_w<=AI_CONV2D_DEPTHWISE_MAX_TAPS) ) {
+    return AI_CONV2D_ALGO_DEPTHWISE;
+  }
+  if ( g->groups>1 ) {
+    return AI_CONV2D_ALGO_DIRECT;
+  }
+  /* 1x1 stride 1 not padded: the input pixels are the im2col rows */
+  if ( (g->k_h==1) && (g->k_w==1) &&
+       (g->stride_x==1) && (g->stride_y==1) && (g->pad_x==0) && (g->pad_y==0) &&
+       (g->out_h==g->in_h) && (g->out_w==g->in_w) ) {
+    return AI_CONV2D_ALGO_POINTWISE;
+  }
+  if ( g->out_ch<=AI_CONV2D_DIRECT_MAX_CH ) {
+    return AI_CONV2D_ALGO_DIRECT;
+  }
+  if ( (g->k_h==3) && (g->k_w==3) &&
+       (g->stride_x==1) && (g->stride_y==1) &&
+       (g->dil_x==1) && (g->dil_y==1) &&
+       (g->k_ch>=AI_CONV2D_WINOGRAD_MIN_CH) &&
+       (g->out_ch>=AI_CONV2D_WINOGRAD_MIN_CH) &&
+       (((g->out_h + 1)/2) * ((g->out_w + 1)/2)>=AI_CONV2D_WINOGRAD_MIN_TILES) ) {
+    return AI_CONV2D_ALGO_WINOGRAD;
+  }
+  return AI_CONV2D_ALGO_IM2COL;
+}
+
+/******************************************************************************/
+/*  Integer convolution                                                       */
+/******************************************************************************/
+/*!
+ * @brief check that a tensor is int8 and carries its quantization parameters
+ */
+AI_DECLARE_STATIC
+ai_bool conv2d_tensor_is_s8(const ai_tensor* t)
+{
+  return AI_FMT_SAME(AI_ARRAY_OBJ_FMT(t->data), AI_ARRAY_FORMAT_S8) &&
+         AI_HAS_INTQ_INFO_LIST(AI_KLASS_GET_INTQ_INFO_LIST(t));
+}
+
+/*!
+ * @brief int8 depthwise accumulators of one pixel for the channels
+ * [c, n_ch): bias plus the n_taps valid filter positions (input pixel pix[t],
+ * weights wt[t], both [ch])
+ */
+AI_DECLARE_STATIC
+void conv2d_s8_depthwise_pixel(ai_i32* acc, const ai_i8* const* pix,
+                               const ai_i8* const* wt, const ai_i32 n_taps,
+                               const ai_i32* bias, const ai_i32 zp_in,
+                               ai_size c, const ai_size n_ch)
+{
+  for ( ; c<n_ch; c++ ) {
+    ai_i32 a = (bias) ? bias[c] : 0;
+    for ( ai_i32 t=0; t<n_taps; t++ ) {
+      a += ((ai_i32)pix[t][c] - zp_in) * (ai_i32)wt[t][c];
+    }
+    acc[c] = a;
+  }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+/*!
+ * @brief AVX2 variant of conv2d_s8_depthwise_pixel(), 8 channels per pass
+ * @return the number of computed channels (multiple of 8)
+ */
+AI_DECLARE_STATIC __attribute__((target("avx2")))
+ai_size conv2d_s8_depthwise_pixel_avx2(ai_i32* acc, const ai_i8* const* pix,
+                                       const ai_i8* const* wt,
+                                       const ai_i32 n_taps, const ai_i32* bias,
+                                       const ai_i32 zp_in, const ai_size n_ch)
+{
+  const __m256i zp = _mm256_set1_epi32(zp_in);
+  ai_size c = 0;
+  for ( ; c+8<=n_ch; c+=8 ) {
+    __m256i a = (bias)
+      ? _mm256_loadu_si256((const __m256i*)(bias + c)) : _mm256_setzero_si256();
+    for ( ai_i32 t=0; t<n_taps; t++ ) {
+      const __m256i x = _mm256_sub_epi32(
+        _mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i*)(pix[t] + c))), zp);
+      const __m256i w =
+        _mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i*)(wt[t] + c)));
+      a = _mm256_add_epi32(a, _mm256_mullo_epi32(x, w));
+    }
+    _mm256_storeu_si256((__m256i*)(acc + c), a);
+  }
+  return c;
+}
+#endif    /* __x86_64__ || __i386__ */
+
+/*!
+ * @brief int8 depthwise convolution of one sample, weights_t holding the
+ * weights as [kh * kw][ch], acc a row of ch accumulators (requantized with
+ * the multipliers in_out * s_w)
+ */
+AI_DECLARE_STATIC
+void conv2d_s8_depthwise(ai_i8* out, const ai_i8* in, const ai_i8* weights_t,
+                         const ai_i32* bias, const ai_conv2d_geometry* g,
+                         const ai_i32 zp_in, const ai_float in_out,
+                         const ai_float* s_w,
+                         const ai_bool per_channel, const ai_i32 zp_out,
+                         ai_i32* acc)
+{
+#if defined(__x86_64__) || defined(__i386__)
+  const ai_bool simd =
+    AI_CPU_HAS_FEATURE(core_cpu_get_features(), AI_CPU_FEATURE_AVX2);
+#endif
+  const ai_size ch = g->in_ch;
+  const ai_i8* pix[AI_CONV2D_DEPTHWISE_MAX_TAPS];
+  const ai_i8* wt[AI_CONV2D_DEPTHWISE_MAX_TAPS];
+
+  for ( ai_i32 oy=0; oy<g->out_h; oy++ ) {
+    const ai_i32 y0 = oy*g->stride_y - g->pad_y;
+    for ( ai_i32 ox=0; ox<g->out_w; ox++, out += ch ) {
+      const ai_i32 x0 = ox*g->stride_x - g->pad_x;
+      ai_i32 n_taps = 0;
+      for ( ai_i32 ky=0; ky<g->k_h; ky++ ) {
+        const ai_i32 y = y0 + ky*g->dil_y;
+        if ( (y<0) || (y>=g->in_h) ) continue;
+        for ( ai_i32 kx=0; kx<g->k_w; kx++ ) {
+          const ai_i32 x = x0 + kx*g->dil_x;
+          if ( (x<0) || (x>=g->in_w) ) continue;
+          pix[n_taps] = in + ((ai_size)y*g->in_w + x)*ch;
+          wt[n_taps] = weights_t + ((ai_size)ky*g->k_w + kx)*ch;
+          n_taps++;
+        }
+      }
+      ai_size c = 0;
+#if defined(__x86_64__) || defined(__i386__)
+      if ( simd ) {
+        c = conv2d_s8_depthwise_pixel_avx2(acc, pix, wt, n_taps, bias, zp_in, ch);
+      }
+#endif
+      conv2d_s8_depthwise_pixel(acc, pix, wt, n_taps, bias, zp_in, c, ch);
+      for ( c=0; c<ch; c++ ) {
+        out[c] = AI_MATH_REQUANTIZE_S8(acc[c], in_out * s_w[(per_channel) ? c : 0], zp_out);
+      }
+    }
+  }
+}
+
+/*!
+ * @brief int8 pointwise convolution of n_pix pixels: one dense layer per
+ * pixel (weights as [out_ch][in_ch]) computed by the int8 dot kernels
+ */
+AI_DECLARE_STATIC
+void conv2d_s8_pointwise(ai_i8* out, const ai_i8* in, const ai_i8* weights,
+                         const ai_i32* bias, const ai_size n_pix,
+                         const ai_size in_ch, const ai_size out_ch,
+                         const ai_i32 zp_in, const ai_float in_out,
+                         const ai_float* s_w,
+                         const ai_bool per_channel, const ai_i32 zp_out)
+{
+  const func_dense_dot_s8 dot = dense_kernel_s8_get()->func;
+  for ( ai_size i=0; i<n_pix; i++, in += in_ch ) {
+    const ai_i8* w = weights;
+    for ( ai_size o=0; o<out_ch; o++, w += in_ch ) {
+      const ai_i32 acc = ((bias) ? bias[o] : 0) + dot(in, w, zp_in, in_ch);
+      *out++ = AI_MATH_REQUANTIZE_S8(acc, in_out * s_w[(per_channel) ? o : 0], zp_out);
+    }
+  }
+}
+
+/*!
+ * @brief int8 conv2d for the SSSA schemes (groups, strides, dilations, pads):
+ * the pointwise and depthwise convolutions use their dedicated kernels, the
+ * other ones (or a depthwise one without scratch memory) the generic loops
+ */
+AI_DECLARE_STATIC
+void conv2d_integer_SSSA(ai_layer* layer, const ai_bool per_channel)
+{
+  const ai_layer_conv2d* l = (const ai_layer_conv2d*)layer;
+  const ai_tensor* input = GET_TENSOR_IN(l->tensors, 0);
+  ai_tensor* output = GET_TENSOR_OUT(l->tensors, 0);
+  AI_LAYER_WEIGHTS_GET(l, weights, bias)
+
+  if ( !conv2d_tensor_is_s8(input) || !conv2d_tensor_is_s8(output) ||
+       !conv2d_tensor_is_s8(weights) ||
+       (bias && !AI_FMT_SAME(AI_ARRAY_OBJ_FMT(bias->data), AI_ARRAY_FORMAT_S32)) ) {
+    AI_ERROR_TRAP(l->network, INVALID_PARAM, INVALID_FORMAT);
+    return;
+  }
+  /* the float nonlinearity can not be applied on the integer outputs: it is
+   * expected to be folded in the output quantization range */
+  if ( l->nl_func ) {
+    AI_ERROR_TRAP(l->network, INVALID_PARAM, LAYER);
+    return;
+  }
+
+  const ai_i32 in_h  = AI_SHAPE_H(&input->shape);
+  const ai_i32 in_w  = AI_SHAPE_W(&input->shape);
+  const ai_i32 in_ch = AI_SHAPE_CH(&input->shape);
+  const ai_i32 out_h  = AI_SHAPE_H(&output->shape);
+  const ai_i32 out_w  = AI_SHAPE_W(&output->shape);
+  const ai_i32 out_ch = AI_SHAPE_CH(&output->shape);
+
+  const ai_i32 k_h = AI_CONV_SHAPE_H(&weights->shape);
+  const ai_i32 k_w = AI_CONV_SHAPE_W(&weights->shape);
+  const ai_i32 k_ch = AI_CONV_SHAPE_IN_CH(&weights->shape);
+  const ai_i32 groups = (l->groups) ? (ai_i32)l->groups : 1;
+
+  const ai_i32 stride_x = AI_MAX(AI_SHAPE_2D_W(&l->filter_stride), 1);
+  const ai_i32 stride_y = AI_MAX(AI_SHAPE_2D_H(&l->filter_stride), 1);
+  const ai_i32 dil_x = AI_MAX(AI_SHAPE_2D_W(&l->dilation), 1);
+  const ai_i32 dil_y = AI_MAX(AI_SHAPE_2D_H(&l->dilation), 1);
+  const ai_i32 pad_x = (AI_STORAGE_KLASS_SIZE(&l->filter_pad)>1)
+    ? AI_SHAPE_ELEM(&l->filter_pad, 0) : 0;
+  const ai_i32 pad_y = (AI_STORAGE_KLASS_SIZE(&l->filter_pad)>1)
+    ? AI_SHAPE_ELEM(&l->filter_pad, 1) : 0;
+
+  if ( (k_ch*groups!=in_ch) || (out_ch % groups) ||
+       (AI_CONV_SHAPE_CH(&weights->shape)!=out_ch) ||
+       (per_channel && (AI_TENSOR_INTEGER_GET_SIZE(weights)!=out_ch)) ) {
+    AI_ERROR_TRAP(l->network, INVALID_PARAM, INVALID_SIZE);
+    return;
+  }
+
+  const ai_i32 out_per_group = out_ch / groups;
+  const ai_size in_size = (ai_size)in_h * in_w * in_ch;
+  const ai_size n_batches = AI_ARRAY_OBJ_SIZE(input->data) / in_size;
+
+  const ai_float s_in  = AI_TENSOR_INTEGER_GET_SCALE(input, 0);
+  const ai_float s_out = AI_TENSOR_INTEGER_GET_SCALE(output, 0);
+  const ai_i32 zp_in   = AI_TENSOR_INTEGER_GET_ZEROPOINT_I8(input, 0);
+  const ai_i32 zp_out  = AI_TENSOR_INTEGER_GET_ZEROPOINT_I8(output, 0);
+  const ai_float* s_w  =
+    AI_INTQ_INFO_LIST_SCALE_ARRAY(AI_KLASS_GET_INTQ_INFO_LIST(weights), ai_float);
+  const ai_float in_out = s_in / s_out;
+
+  const ai_i8* w_data  = AI_ARRAY_OBJ_DATA(weights->data, ai_i8);
+  const ai_i32* b_data = (bias) ? AI_ARRAY_OBJ_DATA(bias->data, ai_i32) : NULL;
+  const ai_i8* in_data = AI_ARRAY_OBJ_DATA(input->data, ai_i8);
+  ai_i8* out_data = AI_ARRAY_OBJ_DATA(output->data, ai_i8);
+
+  ai_conv2d_geometry g;
+  conv2d_geometry_get(l, &g);
+  const ai_conv2d_algo algo = conv2d_algo_select_geometry(&g);
+  const ai_size out_size = (ai_size)out_h * out_w * out_ch;
+
+  if ( algo==AI_CONV2D_ALGO_POINTWISE ) {
+    for ( ai_size b=0; b<n_batches; b++ ) {
+      conv2d_s8_pointwise(out_data, in_data, w_data, b_data,
+                          (ai_size)out_h * out_w, in_ch, out_ch,
+                          zp_in, in_out, s_w, per_channel, zp_out);
+      in_data += in_size;
+      out_data += out_size;
+    }
+    return;
+  }
+  if ( algo==AI_CONV2D_ALGO_DEPTHWISE ) {
+    /* weights as [kh * kw][ch] prepared once, scratch: a row of accumulators */
+    const ai_size n_w = (ai_size)k_h * k_w * in_ch;
+    ai_bool is_new;
+    ai_i8* w_t = core_graph_get_prepared((ai_node*)layer, (ai_handle)w_data,
+                                         CONV2D_PREPARED_S8_DEPTHWISE, n_w,
+                                         &is_new);
+    ai_i32* acc = ai_layer_get_scratch(layer, in_ch * sizeof(ai_i32));
+    if ( w_t && is_new ) {
+      for ( ai_i32 c=0; c<in_ch; c++ ) {
+        for ( ai_i32 k=0; k<k_h*k_w; k++ ) {
+          w_t[(ai_size)k*in_ch + c] = w_data[(ai_size)c*k_h*k_w + k];
+        }
+      }
+    }
+    if ( w_t && acc ) {
+      for ( ai_size b=0; b<n_batches; b++ ) {
+        conv2d_s8_depthwise(out_data, in_data, w_t, b_data, &g,
+                            zp_in, in_out, s_w, per_channel, zp_out, acc);
+        in_data += in_size;
+        out_data += out_size;
+      }
+      return;
+    }
+  }
+
+  for ( ai_size b=0; b<n_batches; b++ ) {
+    for ( ai_i32 oy=0; oy<out_h; oy++ ) {
+      const ai_i32 y0 = oy*stride_y - pad_y;
+      for ( ai_i32 ox=0; ox<out_w; ox++ ) {
+        const ai_i32 x0 = ox*stride_x - pad_x;
+        for ( ai_i32 o=0; o<out_ch; o++ ) {
+          const ai_i32 c0 = (o / out_per_group) * k_ch;
+          const ai_i8* w_filter = w_data + (ai_size)o*k_h*k_w*k_ch;
+          ai_i32 acc = (b_data) ? b_data[o] : 0;
+          for ( ai_i32 ky=0; ky<k_h; ky++ ) {
+            const ai_i32 y = y0 + ky*dil_y;
+            if ( (y<0) || (y>=in_h) ) continue;
+            for ( ai_i32 kx=0; kx<k_w; kx++ ) {
+              const ai_i32 x = x0 + kx*dil_x;
+              if ( (x<0) || (x>=in_w) ) continue;
+              const ai_i8* in_pix = in_data + ((ai_size)y*in_w + x)*in_ch + c0;
+              const ai_i8* w_pix  = w_filter + ((ai_size)ky*k_w + kx)*k_ch;
+              for ( ai_i32 c=0; c<k_ch; c++ ) {
+                acc += ((ai_i32)in_pix[c] - zp_in) * (ai_i32)w_pix[c];
+              }
+            }
+          }
+          const ai_float mult = in_out * s_w[(per_channel) ? o : 0];
+          *out_data++ = AI_MATH_REQUANTIZE_S8(acc, mult, zp_out);
+        }
+      }
+    }
+    in_data += in_size;
+  }
+}
+
+/******************************************************************************/
+AI_INTERNAL_API
+void forward_conv2d_integer_SSSA(ai_layer* layer)
+{
+  conv2d_integer_SSSA(layer, false);
+}
+
+AI_INTERNAL_API
+void forward_conv2d_integer_SSSA_ch(ai_layer* layer)
+{
+  conv2d_integer_SSSA(layer, true);
+}
+
+/******************************************************************************/
+/*  Float convolution                                                         */
+/******************************************************************************/
+/*!
+ * @brief number of rows of a scratch tile of row_size floats: the rows
+ * fitting in AI_CONV2D_TILE_SIZE, at least AI_CONV2D_TILE_MIN_ROWS (the
+ * weights are read once per tile), at most n_rows
+ */
+AI_DECLARE_STATIC
+ai_size conv2d_tile_rows(const ai_size row_size, const ai_size n_rows)
+{
+  const ai_size rows = AI_CONV2D_TILE_SIZE / (row_size * sizeof(ai_float));
+  return AI_MIN(AI_MAX(rows, AI_CONV2D_TILE_MIN_ROWS), n_rows);
+}
+
+/*!
+ * @brief direct convolution of one sample
+ */
+AI_DECLARE_STATIC
+void conv2d_f32_direct(ai_float* out, const ai_float* in,
+                       const ai_float* weights, const ai_float* bias,
+                       const ai_conv2d_geometry* g)
+{
+  const ai_i32 out_per_group = g->out_ch / g->groups;
+  const ai_i32 k_ch = g->k_ch;
+
+  for ( ai_i32 oy=0; oy<g->out_h; oy++ ) {
+    const ai_i32 y0 = oy*g->stride_y - g->pad_y;
+    for ( ai_i32 ox=0; ox<g->out_w; ox++ ) {
+      const ai_i32 x0 = ox*g->stride_x - g->pad_x;
+      for ( ai_i32 o=0; o<g->out_ch; o++ ) {
+        const ai_i32 c0 = (o / out_per_group) * k_ch;
+        const ai_float* w_filter = weights + (ai_size)o*g->k_h*g->k_w*k_ch;
+        ai_float acc = (bias) ? bias[o] : 0.0f;
+        for ( ai_i32 ky=0; ky<g->k_h; ky++ ) {
+          const ai_i32 y = y0 + ky*g->dil_y;
+          if ( (y<0) || (y>=g->in_h) ) continue;
+          for ( ai_i32 kx=0; kx<g->k_w; kx++ ) {
+            const ai_i32 x = x0 + kx*g->dil_x;
+            if ( (x<0) || (x>=g->in_w) ) continue;
+            const ai_float* in_pix = in + ((ai_size)y*g->in_w + x)*g->in_ch + c0;
+            const ai_float* w_pix  = w_filter + ((ai_size)ky*g->k_w + kx)*k_ch;
+            for ( ai_i32 c=0; c<k_ch; c++ ) acc += in_pix[c] * w_pix[c];
+          }
+        }
+        *out++ = acc;
+      }
+    }
+  }
+}
+
+/*!
+ * @brief copy the filter windows of n_rows output pixels (from pixel p0) as
+ * rows of kh * kw * in_ch floats, the padded positions are zeroed
+ */
+AI_DECLARE_STATIC
+void conv2d_f32_im2col(ai_float* cols, const ai_float* in,
+                       const ai_conv2d_geometry* g,
+                       const ai_size p0, const ai_size n_rows)
+{
+  const ai_size pix_size = (ai_size)g->in_ch * sizeof(ai_float);
+
+  for ( ai_size p=p0; p<p0+n_rows; p++ ) {
+    const ai_i32 y0 = (ai_i32)(p / g->out_w)*g->stride_y - g->pad_y;
+    const ai_i32 x0 = (ai_i32)(p % g->out_w)*g->stride_x - g->pad_x;
+    for ( ai_i32 ky=0; ky<g->k_h; ky++ ) {
+      const ai_i32 y = y0 + ky*g->dil_y;
+      for ( ai_i32 kx=0; kx<g->k_w; kx++ ) {
+        const ai_i32 x = x0 + kx*g->dil_x;
+        if ( (y<0) || (y>=g->in_h) || (x<0) || (x>=g->in_w) ) {
+          memset(cols, 0, pix_size);
+        } else {
+          memcpy(cols, in + ((ai_size)y*g->in_w + x)*g->in_ch, pix_size);
+        }
+        cols += g->in_ch;
+      }
+    }
+  }
+}
+
+/*!
+ * @brief transpose the weights [out_ch][n_k] as [n_k][out_ch] for the GEMM
+ * kernels (see func_dense_gemm)
+ */
+AI_DECLARE_STATIC
+void conv2d_f32_weights_t(ai_float* weights_t, const ai_float* weights,
+                          const ai_size n_k, const ai_size n_out)
+{
+  /* by blocks of 16 x 16, the reads and the writes staying in cache */
+  for ( ai_size o0=0; o0<n_out; o0+=16 ) {
+    const ai_size o1 = AI_MIN(o0 + 16, n_out);
+    for ( ai_size k0=0; k0<n_k; k0+=16 ) {
+      const ai_size k1 = AI_MIN(k0 + 16, n_k);
+      for ( ai_size k=k0; k<k1; k++ ) {
+        for ( ai_size o=o0; o<o1; o++ ) weights_t[k*n_out + o] = weights[o*n_k + k];
+      }
+    }
+  }
+}
+
+/*!
+ * @brief im2col + GEMM convolution of one sample with the transposed
+ * weights, cols holds tile_rows rows
+ */
+AI_DECLARE_STATIC
+void conv2d_f32_im2col_gemm(ai_float* out, const ai_float* in,
+                            const ai_float* weights_t, const ai_float* bias,
+                            const ai_conv2d_geometry* g,
+                            ai_float* cols, const ai_size tile_rows)
+{
+  const func_dense_gemm gemm = dense_kernel_gemm_get()->func;
+  const ai_size n_pix = (ai_size)g->out_h * g->out_w;
+  const ai_size n_k = (ai_size)g->k_h * g->k_w * g->in_ch;
+
+  for ( ai_size p=0; p<n_pix; p+=tile_rows ) {
+    const ai_size n_rows = AI_MIN(tile_rows, n_pix - p);
+    conv2d_f32_im2col(cols, in, g, p, n_rows);
+    gemm(out + p*g->out_ch, cols, weights_t, bias, n_rows, n_k, g->out_ch);
+  }
+}
+
+/*!
+ * @brief Winograd F(2x2, 3x3) weights transform G.g.G^T, stored as 16
+ * transposed weights matrices [in_ch][out_ch] (one per transformed position)
+ */
+AI_DECLARE_STATIC
+void conv2d_f32_winograd_weights(ai_float* u, const ai_float* weights,
+                                 const ai_conv2d_geometry* g)
+{
+  const ai_size n_u = (ai_size)g->out_ch * g->in_ch;
+
+  for ( ai_i32 o=0; o<g->out_ch; o++ ) {
+    for ( ai_i32 c=0; c<g->in_ch; c++ ) {
+      const ai_float* w = weights + (ai_size)o*9*g->in_ch + c;
+      ai_float gg[4][3];
+      for ( ai_i32 kx=0; kx<3; kx++ ) {
+        const ai_float w0 = w[(0*3+kx)*g->in_ch];
+        const ai_float w1 = w[(1*3+kx)*g->in_ch];
+        const ai_float w2 = w[(2*3+kx)*g->in_ch];
+        gg[0][kx] = w0;
+        gg[1][kx] = 0.5f*(w0 + w1 + w2);
+        gg[2][kx] = 0.5f*(w0 - w1 + w2);
+        gg[3][kx] = w2;
+      }
+      ai_float* u_oc = u + (ai_size)c*g->out_ch + o;
+      for ( ai_i32 i=0; i<4; i++ ) {
+        u_oc[(i*4+0)*n_u] = gg[i][0];
+        u_oc[(i*4+1)*n_u] = 0.5f*(gg[i][0] + gg[i][1] + gg[i][2]);
+        u_oc[(i*4+2)*n_u] = 0.5f*(gg[i][0] - gg[i][1] + gg[i][2]);
+        u_oc[(i*4+3)*n_u] = gg[i][2];
+      }
+    }
+  }
+}
+
+/*!
+ * @brief Winograd inputs transform B^T.d.B of a 4x4 tile for the channels
+ * [c, n_ch): pix are the 16 input pixels, v the first transformed position
+ * (the next ones every v_step floats)
+ */
+AI_DECLARE_STATIC
+void conv2d_f32_winograd_in(ai_float* v, const ai_size v_step,
+                            const ai_float* const* pix,
+                            const ai_size c0, const ai_size n_ch)
+{
+  for ( ai_size c=c0; c<n_ch; c++ ) {
+    ai_float d[16], bd[16];
+    for ( ai_i32 i=0; i<16; i++ ) d[i] = pix[i][c];
+    for ( ai_i32 j=0; j<4; j++ ) {
+      bd[0*4+j] = d[0*4+j] - d[2*4+j];
+      bd[1*4+j] = d[1*4+j] + d[2*4+j];
+      bd[2*4+j] = d[2*4+j] - d[1*4+j];
+      bd[3*4+j] = d[1*4+j] - d[3*4+j];
+    }
+    for ( ai_i32 i=0; i<4; i++ ) {
+      const ai_float* r = &bd[i*4];
+      v[(i*4+0)*v_step + c] = r[0] - r[2];
+      v[(i*4+1)*v_step + c] = r[1] + r[2];
+      v[(i*4+2)*v_step + c] = r[2] - r[1];
+      v[(i*4+3)*v_step + c] = r[1] - r[3];
+    }
+  }
+}
+
+/*!
+ * @brief Winograd outputs transform A^T.m.A of a tile for the channels
+ * [o0, n_out): m is the first transformed position (the next ones every
+ * m_step floats), out_0 / out_1 the first pixel of the two outputs rows
+ * (out_1 NULL for a single row), has_x1 false for a single column
+ */
+AI_DECLARE_STATIC
+void conv2d_f32_winograd_out(ai_float* out_0, ai_float* out_1,
+                             const ai_bool has_x1, const ai_float* m,
+                             const ai_size m_step, const ai_float* bias,
+                             const ai_size o0, const ai_size n_out)
+{
+  for ( ai_size o=o0; o<n_out; o++ ) {
+    ai_float a[2][4];
+    for ( ai_i32 j=0; j<4; j++ ) {
+      const ai_float m0 = m[(0*4+j)*m_step + o];
+      const ai_float m1 = m[(1*4+j)*m_step + o];
+      const ai_float m2 = m[(2*4+j)*m_step + o];
+      const ai_float m3 = m[(3*4+j)*m_step + o];
+      a[0][j] = m0 + m1 + m2;
+      a[1][j] = m1 - m2 - m3;
+    }
+    const ai_float b = (bias) ? bias[o] : 0.0f;
+    out_0[o] = b + a[0][0] + a[0][1] + a[0][2];
+    if ( has_x1 ) out_0[n_out + o] = b + a[0][1] - a[0][2] - a[0][3];
+    if ( out_1 ) {
+      out_1[o] = b + a[1][0] + a[1][1] + a[1][2];
+      if ( has_x1 ) out_1[n_out + o] = b + a[1][1] - a[1][2] - a[1][3];
+    }
+  }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+/*!
+ * @brief AVX2 variant of conv2d_f32_winograd_in(), 8 channels per pass
+ * @return the number of transformed channels (multiple of 8)
+ */
+AI_DECLARE_STATIC __attribute__((target("avx2")))
+ai_size conv2d_f32_winograd_in_avx2(ai_float* v, const ai_size v_step,
+                                    const ai_float* const* pix,
+                                    const ai_size n_ch)
+{
+  ai_size c = 0;
+  for ( ; c+8<=n_ch; c+=8 ) {
+    __m256 d[16], bd[16];
+    for ( ai_i32 i=0; i<16; i++ ) d[i] = _mm256_loadu_ps(pix[i] + c);
+    for ( ai_i32 j=0; j<4; j++ ) {
+      bd[0*4+j] = _mm256_sub_ps(d[0*4+j], d[2*4+j]);
+      bd[1*4+j] = _mm256_add_ps(d[1*4+j], d[2*4+j]);
+      bd[2*4+j] = _mm256_sub_ps(d[2*4+j], d[1*4+j]);
+      bd[3*4+j] = _mm256_sub_ps(d[1*4+j], d[3*4+j]);
+    }
+    for ( ai_i32 i=0; i<4; i++ ) {
+      const __m256* r = &bd[i*4];
+      _mm256_storeu_ps(v + (i*4+0)*v_step + c, _mm256_sub_ps(r[0], r[2]));
+      _mm256_storeu_ps(v + (i*4+1)*v_step + c, _mm256_add_ps(r[1], r[2]));
+      _mm256_storeu_ps(v + (i*4+2)*v_step + c, _mm256_sub_ps(r[2], r[1]));
+      _mm256_storeu_ps(v + (i*4+3)*v_step + c, _mm256_sub_ps(r[1], r[3]));
+    }
+  }
+  return c;
+}
+
+/*!
+ * @brief AVX2 variant of conv2d_f32_winograd_out(), 8 channels per pass
+ * @return the number of transformed channels (multiple of 8)
+ */
+AI_DECLARE_STATIC __attribute__((target("avx2")))
+ai_size conv2d_f32_winograd_out_avx2(ai_float* out_0, ai_float* out_1,
+                                     const ai_bool has_x1, const ai_float* m,
+                                     const ai_size m_step, const ai_float* bias,
+                                     const ai_size n_out)
+{
+  ai_size o = 0;
+  for ( ; o+8<=n_out; o+=8 ) {
+    __m256 a[2][4];
+    for ( ai_i32 j=0; j<4; j++ ) {
+      const __m256 m0 = _mm256_loadu_ps(m + (0*4+j)*m_step + o);
+      const __m256 m1 = _mm256_loadu_ps(m + (1*4+j)*m_step + o);
+      const __m256 m2 = _mm256_loadu_ps(m + (2*4+j)*m_step + o);
+      const __m256 m3 = _mm256_loadu_ps(m + (3*4+j)*m_step + o);
+      a[0][j] = _mm256_add_ps(_mm256_add_ps(m0, m1), m2);
+      a[1][j] = _mm256_sub_ps(_mm256_sub_ps(m1, m2), m3);
+    }
+    const __m256 b = (bias) ? _mm256_loadu_ps(bias + o) : _mm256_setzero_ps();
+    for ( ai_i32 r=0; r<2; r++ ) {
+      ai_float* dst = (r==0) ? out_0 : out_1;
+      if ( !dst ) break;
+      _mm256_storeu_ps(dst + o, _mm256_add_ps(b,
+        _mm256_add_ps(_mm256_add_ps(a[r][0], a[r][1]), a[r][2])));
+      if ( has_x1 ) {
+        _mm256_storeu_ps(dst + n_out + o, _mm256_add_ps(b,
+          _mm256_sub_ps(_mm256_sub_ps(a[r][1], a[r][2]), a[r][3])));
+      }
+    }
+  }
+  return o;
+}
+#endif    /* __x86_64__ || __i386__ */
+
+/*!
+ * @brief Winograd F(2x2, 3x3) convolution of one sample: tiles of 2x2
+ * outputs processed by blocks of tile_rows tiles, u holds the transformed
+ * weights, v and m the transformed inputs and outputs of a block, zero a
+ * zeroed pixel (in_ch floats) read for the padded positions
+ */
+AI_DECLARE_STATIC
+void conv2d_f32_winograd(ai_float* out, const ai_float* in,
+                         const ai_float* u, const ai_float* bias,
+                         const ai_conv2d_geometry* g,
+                         ai_float* v, ai_float* m, const ai_float* zero,
+                         const ai_size tile_rows)
+{
+  const func_dense_gemm gemm = dense_kernel_gemm_get()->func;
+#if defined(__x86_64__) || defined(__i386__)
+  const ai_bool simd =
+    AI_CPU_HAS_FEATURE(core_cpu_get_features(), AI_CPU_FEATURE_AVX2);
+#endif
+  const ai_i32 in_ch = g->in_ch;
+  const ai_i32 out_ch = g->out_ch;
+  const ai_size n_u = (ai_size)out_ch * in_ch;
+  const ai_i32 tiles_x = (g->out_w + 1) / 2;
+  const ai_size n_tiles = (ai_size)tiles_x * ((g->out_h + 1) / 2);
+
+  for ( ai_size t0=0; t0<n_tiles; t0+=tile_rows ) {
+    const ai_size n_rows = AI_MIN(tile_rows, n_tiles - t0);
+    const ai_size v_step = n_rows * in_ch;
+    const ai_size m_step = n_rows * out_ch;
+
+    /* inputs transform B^T.d.B */
+    for ( ai_size t=0; t<n_rows; t++ ) {
+      const ai_i32 y0 = (ai_i32)((t0 + t) / tiles_x)*2 - g->pad_y;
+      const ai_i32 x0 = (ai_i32)((t0 + t) % tiles_x)*2 - g->pad_x;
+      const ai_float* pix[16];
+      for ( ai_i32 i=0; i<16; i++ ) {
+        const ai_i32 y = y0 + i/4;
+        const ai_i32 x = x0 + i%4;
+        pix[i] = ((y<0) || (y>=g->in_h) || (x<0) || (x>=g->in_w))
+          ? zero : in + ((ai_size)y*g->in_w + x)*in_ch;
+      }
+      ai_size c = 0;
+#if defined(__x86_64__) || defined(__i386__)
+      if ( simd ) c = conv2d_f32_winograd_in_avx2(v + t*in_ch, v_step, pix, in_ch);
+#endif
+      conv2d_f32_winograd_in(v + t*in_ch, v_step, pix, c, in_ch);
+    }
+
+    /* one GEMM per transformed position */
+    for ( ai_i32 i=0; i<16; i++ ) {
+      gemm(m + i*m_step, v + i*v_step, u + i*n_u, NULL,
+           n_rows, in_ch, out_ch);
+    }
+
+    /* outputs transform A^T.m.A */
+    for ( ai_size t=0; t<n_rows; t++ ) {
+      const ai_i32 oy = (ai_i32)((t0 + t) / tiles_x)*2;
+      const ai_i32 ox = (ai_i32)((t0 + t) % tiles_x)*2;
+      const ai_bool has_x1 = (ox + 1<g->out_w);
+      ai_float* out_0 = out + ((ai_size)oy*g->out_w + ox)*out_ch;
+      ai_float* out_1 = (oy + 1<g->out_h) ? out_0 + (ai_size)g->out_w*out_ch : NULL;
+      ai_size o = 0;
+#if defined(__x86_64__) || defined(__i386__)
+      if ( simd ) {
+        o = conv2d_f32_winograd_out_avx2(out_0, out_1, has_x1, m + t*out_ch,
+                                         m_step, bias, out_ch);
+      }
+#endif
+      conv2d_f32_winograd_out(out_0, out_1, has_x1, m + t*out_ch, m_step,
+                              bias, o, out_ch);
+    }
+  }
+}
+
+/******************************************************************************/
+/*  Depthwise convolution                                                     */
+/******************************************************************************/
+/*!
+ * @brief depthwise outputs of one pixel for the channels [c, n_ch): bias
+ * plus the n_taps valid filter positions (input pixel pix[t], weights wt[t],
+ * both [ch])
+ */
+AI_DECLARE_STATIC
+void conv2d_f32_depthwise_pixel(ai_float* out, const ai_float* const* pix,
+                                const ai_float* const* wt, const ai_i32 n_taps,
+                                const ai_float* bias, ai_size c,
+                                const ai_size n_ch)
+{
+  for ( ; c<n_ch; c++ ) {
+    ai_float acc = (bias) ? bias[c] : 0.0f;
+    for ( ai_i32 t=0; t<n_taps; t++ ) acc += pix[t][c] * wt[t][c];
+    out[c] = acc;
+  }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+/*!
+ * @brief AVX2 + FMA variant of conv2d_f32_depthwise_pixel(), 8 channels per
+ * pass (two independent accumulators when possible)
+ * @return the number of computed channels (multiple of 8)
+ */
+AI_DECLARE_STATIC __attribute__((target("avx2,fma")))
+ai_size conv2d_f32_depthwise_pixel_avx2(ai_float* out,
+                                        const ai_float* const* pix,
+                                        const ai_float* const* wt,
+                                        const ai_i32 n_taps,
+                                        const ai_float* bias,
+                                        const ai_size n_ch)
+{
+  ai_size c = 0;
+  for ( ; c+16<=n_ch; c+=16 ) {
+    __m256 acc0 = (bias) ? _mm256_loadu_ps(bias + c) : _mm256_setzero_ps();
+    __m256 acc1 = (bias) ? _mm256_loadu_ps(bias + c + 8) : _mm256_setzero_ps();
+    for ( ai_i32 t=0; t<n_taps; t++ ) {
+      acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(pix[t] + c),
+                             _mm256_loadu_ps(wt[t] + c), acc0);
+      acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(pix[t] + c + 8),
+                             _mm256_loadu_ps(wt[t] + c + 8), acc1);
+    }
+    _mm256_storeu_ps(out + c, acc0);
+    _mm256_storeu_ps(out + c + 8, acc1);
+  }
+  for ( ; c+8<=n_ch; c+=8 ) {
+    __m256 acc = (bias) ? _mm256_loadu_ps(bias + c) : _mm256_setzero_ps();
+    for ( ai_i32 t=0; t<n_taps; t++ ) {
+      acc = _mm256_fmadd_ps(_mm256_loadu_ps(pix[t] + c),
+                            _mm256_loadu_ps(wt[t] + c), acc);
+    }
+    _mm256_storeu_ps(out + c, acc);
+  }
+  return c;
+}
+
+/*!
+ * @brief AVX-512 variant of conv2d_f32_depthwise_pixel(), 16 channels per
+ * pass, the last ones masked
+ * @return the number of computed channels (all of them)
+ */
+AI_DECLARE_STATIC __attribute__((target("avx512f")))
+ai_size conv2d_f32_depthwise_pixel_avx512(ai_float* out,
+                                          const ai_float* const* pix,
+                                          const ai_float* const* wt,
+                                          const ai_i32 n_taps,
+                                          const ai_float* bias,
+                                          const ai_size n_ch)
+{
+  for ( ai_size c=0; c<n_ch; c+=16 ) {
+    const __mmask16 m = (n_ch - c>=16)
+      ? (__mmask16)0xFFFF : (__mmask16)((1U << (n_ch - c)) - 1);
+    __m512 acc = (bias) ? _mm512_maskz_loadu_ps(m, bias + c) : _mm512_setzero_ps();
+    for ( ai_i32 t=0; t<n_taps; t++ ) {
+      acc = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(m, pix[t] + c),
+                            _mm512_maskz_loadu_ps(m, wt[t] + c), acc);
+    }
+    _mm512_mask_storeu_ps(out + c, m, acc);
+  }
+  return n_ch;
+}
+#endif    /* __x86_64__ || __i386__ */
+
+/*!
+ * @brief depthwise convolution of one sample (in_ch == out_ch == groups),
+ * weights_t holding the weights as [kh * kw][ch]: the valid filter positions
+ * of each output pixel are gathered once, the channels are vectorized
+ */
+AI_DECLARE_STATIC
+void conv2d_f32_depthwise(ai_float* out, const ai_float* in,
+                          const ai_float* weights_t, const ai_float* bias,
+                          const ai_conv2d_geometry* g)
+{
+#if defined(__x86_64__) || defined(__i386__)
+  const ai_u32 features = core_cpu_get_features();
+  const ai_bool simd_512 = AI_CPU_HAS_FEATURE(features, AI_CPU_FEATURE_AVX512F);
+  const ai_bool simd = AI_CPU_HAS_FEATURE(features, AI_CPU_FEATURE_AVX2) &&
+                       AI_CPU_HAS_FEATURE(features, AI_CPU_FEATURE_FMA);
+#endif
+  const ai_size ch = g->in_ch;
+  const ai_float* pix[AI_CONV2D_DEPTHWISE_MAX_TAPS];
+  const ai_float* wt[AI_CONV2D_DEPTHWISE_MAX_TAPS];
+
+  for ( ai_i32 oy=0; oy<g->out_h; oy++ ) {
+    const ai_i32 y0 = oy*g->stride_y - g->pad_y;
+    for ( ai_i32 ox=0; ox<g->out_w; ox++, out += ch ) {
+      const ai_i32 x0 = ox*g->stride_x - g->pad_x;
+      ai_i32 n_taps = 0;
+      for ( ai_i32 ky=0; ky<g->k_h; ky++ ) {
+        const ai_i32 y = y0 + ky*g->dil_y;
+        if ( (y<0) || (y>=g->in_h) ) continue;
+        for ( ai_i32 kx=0; kx<g->k_w; kx++ ) {
+          const ai_i32 x = x0 + kx*g->dil_x;
+          if ( (x<0) || (x>=g->in_w) ) continue;
+          pix[n_taps] = in + ((ai_size)y*g->in_w + x)*ch;
+          wt[n_taps] = weights_t + ((ai_size)ky*g->k_w + kx)*ch;
+          n_taps++;
+        }
+      }
+      ai_size c = 0;
+#if defined(__x86_64__) || defined(__i386__)
+      if ( simd_512 ) {
+        c = conv2d_f32_depthwise_pixel_avx512(out, pix, wt, n_taps, bias, ch);
+      } else if ( simd ) {
+        c = conv2d_f32_depthwise_pixel_avx2(out, pix, wt, n_taps, bias, ch);
+      }
+#endif
+      conv2d_f32_depthwise_pixel(out, pix, wt, n_taps, bias, c, ch);
+    }
+  }
+}
+
+/*!
+ * @struct ai_conv2d_f32_plan
+ * @brief algorithm and memory of a float convolution call
+ */
+typedef struct {
+  ai_conv2d_geometry g;
+  ai_conv2d_algo algo;
+  const ai_float* weights;    /*!< weights as stored */
+  const ai_float* bias;
+  const ai_float* weights_t;  /*!< transposed (transformed) weights */
+  ai_size weights_t_size;     /*!< floats */
+  ai_float* scratch;          /*!< tiles */
+  ai_size scratch_size;       /*!< floats */
+  ai_size tile_rows;
+} ai_conv2d_f32_plan;
+
+/*!
+ * @brief select the algorithm of a convolution computing n_rows outputs rows
+ * per call of conv2d_f32_rows()
+ * @return the floats of scratch memory of the algorithm (0 if none)
+ */
+AI_DECLARE_STATIC
+ai_size conv2d_f32_plan_size(ai_conv2d_f32_plan* p, const ai_layer_conv2d* l,
+                             const ai_size n_rows)
+{
+  const ai_conv2d_geometry* g = &p->g;
+  AI_LAYER_WEIGHTS_GET(l, weights, bias)
+
+  p->weights = AI_ARRAY_OBJ_DATA(weights->data, ai_float);
+  p->bias = (bias) ? AI_ARRAY_OBJ_DATA(bias->data, ai_float) : NULL;
+  p->algo = conv2d_algo_select_geometry(g);
+  p->weights_t = NULL;
+  p->weights_t_size = 0;
+  p->scratch = NULL;
+  p->scratch_size = 0;
+  p->tile_rows = 0;
+
+  const ai_size n_k = (ai_size)g->k_h * g->k_w * g->k_ch;
+
+  /* the transposed (transformed) weights, the tile(s) in scratch */
+  switch ( p->algo ) {
+    case AI_CONV2D_ALGO_DEPTHWISE:
+    case AI_CONV2D_ALGO_POINTWISE:
+      p->weights_t_size = n_k * g->out_ch;
+      break;
+    case AI_CONV2D_ALGO_IM2COL:
+      p->weights_t_size = n_k * g->out_ch;
+      p->tile_rows = conv2d_tile_rows(n_k, n_rows * g->out_w);
+      p->scratch_size = p->tile_rows * n_k;
+      break;
+    case AI_CONV2D_ALGO_WINOGRAD:
+    {
+      const ai_size n_tiles = ((n_rows + 1) / 2) * ((g->out_w + 1) / 2);
+      p->weights_t_size = 16 * (ai_size)g->in_ch * g->out_ch;
+      p->tile_rows = conv2d_tile_rows(16 * (ai_size)(g->in_ch + g->out_ch), n_tiles);
+      p->scratch_size = 16 * p->tile_rows * (g->in_ch + g->out_ch) + g->in_ch;
+      break;
+    }
+    default:
+      break;
+  }
+  return p->scratch_size;
+}
+
+/*!
+ * @brief get the transposed (transformed) weights of a plan, computed on
+ * the first call for the weights bound to the layer (see
+ * core_graph_get_prepared())
+ */
+AI_DECLARE_STATIC
+const ai_float* conv2d_f32_plan_weights(ai_layer* layer,
+                                        const ai_conv2d_f32_plan* p)
+{
+  const ai_conv2d_geometry* g = &p->g;
+  const ai_bool winograd = (p->algo==AI_CONV2D_ALGO_WINOGRAD);
+  ai_bool is_new;
+  ai_float* weights_t = core_graph_get_prepared(
+    (ai_node*)layer, (ai_handle)p->weights,
+    (winograd) ? CONV2D_PREPARED_F32_WINOGRAD : CONV2D_PREPARED_F32_T,
+    p->weights_t_size * sizeof(ai_float), &is_new);
+
+  if ( weights_t && is_new ) {
+    if ( winograd ) {
+      conv2d_f32_winograd_weights(weights_t, p->weights, g);
+    } else {
+      /* [out_ch][n_k] -> [n_k][out_ch] (the depthwise filters: [kh * kw][ch]) */
+      conv2d_f32_weights_t(weights_t, p->weights,
+                           (ai_size)g->k_h * g->k_w * g->k_ch, g->out_ch);
+    }
+  }
+  return weights_t;
+}
+
+/*!
+ * @brief bind the prepared weights and the scratch memory of a plan (NULL if
+ * it could not be allocated): without them the direct algorithm is used
+ * instead, the pointwise convolution reads the weights as they are stored
+ */
+AI_DECLARE_STATIC
+void conv2d_f32_plan_bind(ai_layer* layer, ai_conv2d_f32_plan* p,
+                          ai_float* scratch)
+{
+  const ai_conv2d_geometry* g = &p->g;
+
+  p->scratch = (p->scratch_size>0) ? scratch : NULL;
+  if ( p->weights_t_size>0 ) p->weights_t = conv2d_f32_plan_weights(layer, p);
+  if ( !p->weights_t || ((p->scratch_size>0) && !p->scratch) ) {
+    if ( p->algo!=AI_CONV2D_ALGO_POINTWISE ) p->algo = AI_CONV2D_ALGO_DIRECT;
+    p->weights_t = NULL;
+    p->tile_rows = 0;
+    return;
+  }
+
+  if ( p->algo==AI_CONV2D_ALGO_WINOGRAD ) {
+    /* zero input tile of the padded positions */
+    memset(p->scratch + p->scratch_size - g->in_ch, 0, g->in_ch * sizeof(ai_float));
+  }
+}
+
+/*!
+ * @brief select the algorithm of a convolution computing n_rows outputs rows
+ * per call of conv2d_f32_rows() and prepare its memory, the scratch one
+ * being followed by extra floats for the caller
+ * @return the extra floats, NULL if they can not be allocated (or none)
+ */
+AI_DECLARE_STATIC
+ai_float* conv2d_f32_plan_init(ai_layer* layer, ai_conv2d_f32_plan* p,
+                               const ai_size n_rows, const ai_size extra)
+{
+  const ai_size size =
+    conv2d_f32_plan_size(p, (const ai_layer_conv2d*)layer, n_rows);
+  ai_float* scratch = (size + extra>0)
+    ? ai_layer_get_scratch(layer, (size + extra) * sizeof(ai_float)) : NULL;
+
+  conv2d_f32_plan_bind(layer, p, scratch);
+  if ( !scratch && (size>0) && (extra>0) ) {
+    /* direct algorithm: the extra floats alone */
+    return ai_layer_get_scratch(layer, extra * sizeof(ai_float));
+  }
+  return (scratch && (extra>0)) ? scratch + size : NULL;
+}
+
+/*!
+ * @brief compute the outputs rows [y0, y0 + n_rows) of one sample (the rows
+ * of a convolution are the ones of a convolution with less output rows and
+ * a shifted top padding)
+ */
+AI_DECLARE_STATIC
+void conv2d_f32_rows(const ai_conv2d_f32_plan* p, ai_float* out,
+                     const ai_float* in, const ai_i32 y0, const ai_i32 n_rows)
+{
+  ai_conv2d_geometry g = p->g;
+  g.out_h = n_rows;
+  g.pad_y -= y0 * g.stride_y;
+
+  switch ( p->algo ) {
+    case AI_CONV2D_ALGO_DEPTHWISE:
+      conv2d_f32_depthwise(out, in, p->weights_t, p->bias, &g);
+      break;
+    case AI_CONV2D_ALGO_POINTWISE:
+    {
+      /* the input pixels are the im2col rows */
+      const ai_size n_pix = (ai_size)n_rows * g.out_w;
+      in += (ai_size)y0 * g.in_w * g.in_ch;
+      if ( p->weights_t ) {
+        dense_kernel_gemm_get()->func(out, in, p->weights_t, p->bias,
+                                      n_pix, g.in_ch, g.out_ch);
+      } else {
+        dense_kernel_f32_get()->func(out, in, p->weights, p->bias,
+                                     n_pix, g.in_ch, g.out_ch);
+      }
+      break;
+    }
+    case AI_CONV2D_ALGO_IM2COL:
+      conv2d_f32_im2col_gemm(out, in, p->weights_t, p->bias, &g,
+                             p->scratch, p->tile_rows);
+      break;
+    case AI_CONV2D_ALGO_WINOGRAD:
+    {
+      ai_float* v = p->scratch;
+      ai_float* m = v + 16 * p->tile_rows * g.in_ch;
+      const ai_float* zero = m + 16 * p->tile_rows * g.out_ch;
+      conv2d_f32_winograd(out, in, p->weights_t, p->bias, &g,
+                          v, m, zero, p->tile_rows);
+      break;
+    }
+    default:
+      conv2d_f32_direct(out, in, p->weights, p->bias, &g);
+      break;
+  }
+}
+
+/*!
+ * @brief check the formats and the sizes of a float convolution
+ */
+AI_DECLARE_STATIC
+ai_bool conv2d_f32_check(const ai_layer_conv2d* l, const ai_conv2d_geometry* g)
+{
+  const ai_tensor* input = GET_TENSOR_IN(l->tensors, 0);
+  const ai_tensor* output = GET_TENSOR_OUT(l->tensors, 0);
+  AI_LAYER_WEIGHTS_GET(l, weights, bias)
+
+  if ( !AI_FMT_SAME(AI_ARRAY_OBJ_FMT(input->data), AI_ARRAY_FORMAT_FLOAT) ||
+       !AI_FMT_SAME(AI_ARRAY_OBJ_FMT(output->data), AI_ARRAY_FORMAT_FLOAT) ||
+       !AI_FMT_SAME(AI_ARRAY_OBJ_FMT(weights->data), AI_ARRAY_FORMAT_FLOAT) ||
+       (bias && !AI_FMT_SAME(AI_ARRAY_OBJ_FMT(bias->data), AI_ARRAY_FORMAT_FLOAT)) ) {
+    AI_ERROR_TRAP(l->network, INVALID_PARAM, INVALID_FORMAT);
+    return false;
+  }
+  if ( (g->k_ch*g->groups!=g->in_ch) || (g->out_ch % g->groups) ||
+       (AI_CONV_SHAPE_CH(&weights->shape)!=g->out_ch) ||
+       (g->out_h<=0) || (g->out_w<=0) ) {
+    AI_ERROR_TRAP(l->network, INVALID_PARAM, INVALID_SIZE);
+    return false;
+  }
+  return true;
+}
+
+/*!
+ * @brief apply the nonlinearity of a layer on size floats
+ */
+AI_DECLARE_STATIC
+void conv2d_f32_nl(const ai_layer_conv2d* l, ai_float* data, const ai_size size)
+{
+  const ai_handle params =
+    (l->nl_params) ? AI_ARRAY_OBJ_DATA(l->nl_params, void) : NULL;
+  ai_array array = AI_ARRAY_OBJ_INIT(AI_ARRAY_FORMAT_FLOAT, data, data, size);
+  l->nl_func(&array, &array, size, params);
+}
+
+/******************************************************************************/
+/*  Fused float convolution + nonlinearity + pooling                          */
+/******************************************************************************/
+/*!
+ * @struct ai_conv2d_pool_geometry
+ * @brief pooling window of a fused layer, over the convolution outputs
+ */
+typedef struct {
+  ai_i32 in_h, in_w;          /*!< convolution outputs */
+  ai_i32 out_h, out_w, ch;    /*!< pooled outputs */
+  ai_i32 size_x, size_y;
+  ai_i32 stride_x, stride_y;
+  ai_i32 pad_x, pad_y;
+} ai_conv2d_pool_geometry;
+
+/*!
+ * @brief fold the convolution row y (nonlinearity applied) into the pooled
+ * row py: the first row of the window is copied, the next ones reduced
+ * (max or sum), the sum is scaled by the window size after its last row
+ */
+AI_DECLARE_STATIC
+void conv2d_f32_pool_row(ai_float* pooled, const ai_float* row,
+                         const ai_conv2d_pool_geometry* pg,
+                         const ai_i32 py, const ai_i32 y, const ai_bool is_max)
+{
+  const ai_i32 ch = pg->ch;
+  const ai_i32 wy0 = py*pg->stride_y - pg->pad_y;
+  const ai_i32 wy1 = AI_MIN(wy0 + pg->size_y, pg->in_h);
+  const ai_bool first = (y==AI_MAX(wy0, 0));
+  const ai_bool last = (y==wy1 - 1);
+  const ai_i32 n_y = wy1 - AI_MAX(wy0, 0);
+
+  for ( ai_i32 px=0; px<pg->out_w; px++, pooled += ch ) {
+    const ai_i32 wx0 = px*pg->stride_x - pg->pad_x;
+    const ai_i32 wx1 = AI_MIN(wx0 + pg->size_x, pg->in_w);
+    ai_i32 x = AI_MAX(wx0, 0);
+    if ( x>=wx1 ) {
+      if ( first ) memset(pooled, 0, ch * sizeof(ai_float));
+      continue;
+    }
+    if ( first ) {
+      memcpy(pooled, row + (ai_size)x*ch, ch * sizeof(ai_float));
+      x++;
+    }
+    for ( ; x<wx1; x++ ) {
+      const ai_float* src = row + (ai_size)x*ch;
+      if ( is_max ) {
+        for ( ai_i32 c=0; c<ch; c++ ) pooled[c] = AI_MAX(pooled[c], src[c]);
+      } else {
+        for ( ai_i32 c=0; c<ch; c++ ) pooled[c] += src[c];
+      }
+    }
+    if ( last && !is_max ) {
+      /* the padded positions are not counted */
+      const ai_float scale = 1.0f / (ai_float)(n_y * (wx1 - AI_MAX(wx0, 0)));
+      for ( ai_i32 c=0; c<ch; c++ ) pooled[c] *= scale;
+    }
+  }
+}
+
+/*!
+ * @brief check if a nonlinearity is non-decreasing (commutes with the max
+ * pooling)
+ */
+AI_DECLARE_STATIC
+ai_bool conv2d_nl_is_monotonic(const func_nl nl)
+{
+  return (nl==nl_func_relu_array_f32) || (nl==nl_func_clip_array_f32) ||
+         (nl==nl_func_sigmoid_array_f32) || (nl==nl_func_tanh_array_f32) ||
+         (nl==nl_func_hard_sigmoid_array_f32);
+}
+
+/******************************************************************************/
+AI_INTERNAL_API
+ai_conv2d_algo conv2d_algo_select(const ai_layer_conv2d* layer)
+{
+  ai_conv2d_geometry g;
+  conv2d_geometry_get(layer, &g);
+  return conv2d_algo_select_geometry(&g);
+}
+
+AI_INTERNAL_API
+void forward_conv2d(ai_layer* layer)
+{
+  const ai_layer_conv2d* l = (const ai_layer_conv2d*)layer;
+  const ai_tensor* input = GET_TENSOR_IN(l->tensors, 0);
+  ai_tensor* output = GET_TENSOR_OUT(l->tensors, 0);
+
+  ai_conv2d_f32_plan p;
+  conv2d_geometry_get(l, &p.g);
+  if ( !conv2d_f32_check(l, &p.g) ) return;
+
+  const ai_conv2d_geometry* g = &p.g;
+  const ai_size in_size = (ai_size)g->in_h * g->in_w * g->in_ch;
+  const ai_size out_size = (ai_size)g->out_h * g->out_w * g->out_ch;
+  const ai_size n_batches = AI_ARRAY_OBJ_SIZE(input->data) / in_size;
+  const ai_float* in_data = AI_ARRAY_OBJ_DATA(input->data, ai_float);
+  ai_float* out_data = AI_ARRAY_OBJ_DATA(output->data, ai_float);
+
+  conv2d_f32_plan_init(layer, &p, g->out_h, 0);
+
+  for ( ai_size b=0; b<n_batches; b++ ) {
+    conv2d_f32_rows(&p, out_data, in_data, 0, g->out_h);
+    in_data += in_size;
+    out_data += out_size;
+  }
+
+  if ( l->nl_func ) {
+    conv2d_f32_nl(l, AI_ARRAY_OBJ_DATA(output->data, ai_float),
+                  AI_ARRAY_OBJ_SIZE(output->data));
+  }
+}
+
+AI_INTERNAL_API
+void forward_conv2d_nl_pool(ai_layer* layer)
+{
+  const ai_layer_conv2d_nl_pool* l = (const ai_layer_conv2d_nl_pool*)layer;
+  const ai_layer_conv2d* lc = (const ai_layer_conv2d*)layer;
+  const ai_tensor* input = GET_TENSOR_IN(l->tensors, 0);
+  ai_tensor* output = GET_TENSOR_OUT(l->tensors, 0);
+
+  if ( !l->pool_func ) {
+    forward_conv2d(layer);
+    return;
+  }
+
+  /* the outputs are pooled: the convolution ones follow from the input, the
+   * filter and the (start, end) padding */
+  ai_conv2d_f32_plan p;
+  ai_conv2d_geometry* g = &p.g;
+  conv2d_geometry_get(lc, g);
+  const ai_i32 pad_x1 = (AI_STORAGE_KLASS_SIZE(&l->filter_pad)>3)
+    ? AI_SHAPE_ELEM(&l->filter_pad, 2) : g->pad_x;
+  const ai_i32 pad_y1 = (AI_STORAGE_KLASS_SIZE(&l->filter_pad)>3)
+    ? AI_SHAPE_ELEM(&l->filter_pad, 3) : g->pad_y;
+  g->out_h = (g->in_h + g->pad_y + pad_y1 - g->dil_y*(g->k_h - 1) - 1) / g->stride_y + 1;
+  g->out_w = (g->in_w + g->pad_x + pad_x1 - g->dil_x*(g->k_w - 1) - 1) / g->stride_x + 1;
+  if ( !conv2d_f32_check(lc, g) ) return;
+
+  ai_conv2d_pool_geometry pg;
+  pg.in_h = g->out_h;
+  pg.in_w = g->out_w;
+  pg.out_h = AI_SHAPE_H(&output->shape);
+  pg.out_w = AI_SHAPE_W(&output->shape);
+  pg.ch = g->out_ch;
+  pg.size_x = AI_MAX(AI_SHAPE_2D_W(&l->pool_size), 1);
+  pg.size_y = AI_MAX(AI_SHAPE_2D_H(&l->pool_size), 1);
+  pg.stride_x = AI_MAX(AI_SHAPE_2D_W(&l->pool_stride), 1);
+  pg.stride_y = AI_MAX(AI_SHAPE_2D_H(&l->pool_stride), 1);
+  pg.pad_x = (AI_STORAGE_KLASS_SIZE(&l->pool_pad)>1)
+    ? AI_SHAPE_ELEM(&l->pool_pad, 0) : 0;
+  pg.pad_y = (AI_STORAGE_KLASS_SIZE(&l->pool_pad)>1)
+    ? AI_SHAPE_ELEM(&l->pool_pad, 1) : 0;
+  if ( (AI_SHAPE_CH(&output->shape)!=g->out_ch) ||
+       (pg.out_h<=0) || (pg.out_w<=0) ) {
+    AI_ERROR_TRAP(l->network, INVALID_PARAM, INVALID_SIZE);
+    return;
+  }
+
+  const ai_bool is_max = (l->pool_func==pool_func_mp_array_f32);
+  const ai_bool fused = is_max || (l->pool_func==pool_func_ap_array_f32);
+  /* max(nl(x)) = nl(max(x)): the nonlinearity is applied on the pooled
+   * outputs */
+  const ai_bool nl_after = is_max && l->nl_func &&
+    conv2d_nl_is_monotonic(l->nl_func);
+
+  const ai_size row_size = (ai_size)g->out_w * g->out_ch;
+  const ai_size in_size = (ai_size)g->in_h * g->in_w * g->in_ch;
+  const ai_size out_size = (ai_size)pg.out_h * pg.out_w * pg.ch;
+  const ai_size n_batches = AI_ARRAY_OBJ_SIZE(input->data) / in_size;
+  const ai_float* in_data = AI_ARRAY_OBJ_DATA(input->data, ai_float);
+  ai_float* out_data = AI_ARRAY_OBJ_DATA(output->data, ai_float);
+
+  /* convolution rows read by the pooling windows */
+  const ai_i32 conv_h = (fused) ? AI_MIN(g->out_h,
+    (pg.out_h - 1)*pg.stride_y - pg.pad_y + pg.size_y) : g->out_h;
+  /* rolling band of convolution rows staying in the cpu caches (even for
+   * the 2x2 Winograd tiles), the whole outputs for a foreign pooling */
+  ai_i32 band = conv_h;
+  if ( fused ) {
+    band = AI_CONV2D_TILE_SIZE / (ai_i32)(row_size * sizeof(ai_float));
+    band = AI_MIN(AI_MAX(band + (band & 1), 2), conv_h);
+  }
+
+  ai_float* rows = conv2d_f32_plan_init(layer, &p, band, (ai_size)band * row_size);
+  if ( !rows ) {
+    AI_ERROR_TRAP(l->network, ALLOCATION_FAILED, LAYER);
+    return;
+  }
+
+  for ( ai_size b=0; b<n_batches; b++ ) {
+    for ( ai_i32 y0=0; y0<conv_h; y0+=band ) {
+      const ai_i32 n_rows = AI_MIN(band, conv_h - y0);
+      conv2d_f32_rows(&p, rows, in_data, y0, n_rows);
+      if ( l->nl_func && !nl_after ) {
+        conv2d_f32_nl(lc, rows, (ai_size)n_rows * row_size);
+      }
+      if ( !fused ) break;
+      for ( ai_i32 y=y0; y<y0 + n_rows; y++ ) {
+        const ai_float* row = rows + (ai_size)(y - y0) * row_size;
+        /* pooled rows whose window holds the row y */
+        const ai_i32 py0 = AI_MAX(y + pg.pad_y - pg.size_y + pg.stride_y, 0) / pg.stride_y;
+        const ai_i32 py1 = AI_MIN((y + pg.pad_y) / pg.stride_y, pg.out_h - 1);
+        for ( ai_i32 py=py0; py<=py1; py++ ) {
+          conv2d_f32_pool_row(out_data + (ai_size)py * pg.out_w * pg.ch, row,
+                              &pg, py, y, is_max);
+        }
+      }
+    }
+    if ( !fused ) {
+      l->pool_func(rows, pg.in_w, pg.in_h, pg.ch, pg.size_x, pg.size_y,
+                   pg.pad_x, pg.pad_y, pg.stride_x, pg.stride_y,
+                   pg.out_w, pg.out_h, out_data);
+    }
+    in_data += in_size;
+    out_data += out_size;
+  }
+
+  if ( nl_after ) {
+    conv2d_f32_nl(lc, AI_ARRAY_OBJ_DATA(output->data, ai_float),
+                  AI_ARRAY_OBJ_SIZE(output->data));
+  }
+}
+
+/******************************************************************************/
+/*  Fused float depthwise -> pointwise convolutions                           */
+/******************************************************************************/
+AI_INTERNAL_API
+ai_bool conv2d_dw_pw_is_fusable(const ai_layer_conv2d* dw,
+                                const ai_layer_conv2d* pw)
+{
+  if ( (dw->forward!=AI_LAYER_FORWARD_FUNC(forward_conv2d)) ||
+       (pw->forward!=AI_LAYER_FORWARD_FUNC(forward_conv2d)) ) return false;
+
+  const ai_layer_conv2d* layers[2] = { dw, pw };
+  for ( ai_i32 i=0; i<2; i++ ) {
+    const ai_tensor* input = GET_TENSOR_IN(layers[i]->tensors, 0);
+    const ai_tensor* weights = GET_TENSOR_WEIGHTS(layers[i]->tensors, 0);
+    if ( !AI_FMT_SAME(AI_ARRAY_OBJ_FMT(input->data), AI_ARRAY_FORMAT_FLOAT) ||
+         !AI_FMT_SAME(AI_ARRAY_OBJ_FMT(weights->data), AI_ARRAY_FORMAT_FLOAT) ) {
+      return false;
+    }
+  }
+
+  ai_conv2d_geometry g_dw, g_pw;
+  conv2d_geometry_get(dw, &g_dw);
+  conv2d_geometry_get(pw, &g_pw);
+  return (conv2d_algo_select_geometry(&g_dw)==AI_CONV2D_ALGO_DEPTHWISE) &&
+         (conv2d_algo_select_geometry(&g_pw)==AI_CONV2D_ALGO_POINTWISE);
+}
+
+AI_INTERNAL_API
+void forward_conv2d_dw_pw(ai_layer* layer)
+{
+  const ai_layer_conv2d* l = (const ai_layer_conv2d*)layer;
+  const ai_layer_conv2d* pw =
+    (const ai_layer_conv2d*)core_graph_get_fused((const ai_node*)layer);
+  if ( !pw ) {
+    forward_conv2d(layer);
+    return;
+  }
+
+  /* the outputs of the depthwise layer are the inputs of the pointwise one */
+  const ai_tensor* input = GET_TENSOR_IN(l->tensors, 0);
+  const ai_tensor* inner = GET_TENSOR_IN(pw->tensors, 0);
+  ai_tensor* output = GET_TENSOR_OUT(l->tensors, 0);
+
+  ai_conv2d_f32_plan p_dw, p_pw;
+  ai_conv2d_geometry* g_dw = &p_dw.g;
+  const ai_conv2d_geometry* g_pw = &p_pw.g;
+  conv2d_geometry_get(l, g_dw);
+  g_dw->out_h  = AI_SHAPE_H(&inner->shape);
+  g_dw->out_w  = AI_SHAPE_W(&inner->shape);
+  g_dw->out_ch = AI_SHAPE_CH(&inner->shape);
+  conv2d_geometry_get(pw, &p_pw.g);
+  if ( !conv2d_f32_check(l, g_dw) || !conv2d_f32_check(pw, g_pw) ) return;
+
+  /* band of depthwise rows staying in the cpu caches */
+  const ai_size row_size = (ai_size)g_dw->out_w * g_dw->out_ch;
+  ai_i32 band = AI_CONV2D_TILE_SIZE / (ai_i32)(row_size * sizeof(ai_float));
+  band = AI_MIN(AI_MAX(band, 1), g_dw->out_h);
+
+  /* one scratch buffer: the depthwise, the pointwise plans, the band */
+  const ai_size n_dw = conv2d_f32_plan_size(&p_dw, l, band);
+  const ai_size n_pw = conv2d_f32_plan_size(&p_pw, pw, band);
+  const ai_size n_band = (ai_size)band * row_size;
+  ai_float* scratch =
+    ai_layer_get_scratch(layer, (n_dw + n_pw + n_band) * sizeof(ai_float));
+  ai_float* rows = (scratch) ? scratch + n_dw + n_pw : NULL;
+  conv2d_f32_plan_bind(layer, &p_dw, scratch);
+  conv2d_f32_plan_bind((ai_layer*)pw, &p_pw, (scratch) ? scratch + n_dw : NULL);
+  if ( !rows ) {
+    rows = ai_layer_get_scratch(layer, n_band * sizeof(ai_float));
+  }
+  if ( !rows ) {
+    AI_ERROR_TRAP(l->network, ALLOCATION_FAILED, LAYER);
+    return;
+  }
+
+  const ai_size in_size = (ai_size)g_dw->in_h * g_dw->in_w * g_dw->in_ch;
+  const ai_size out_row_size = (ai_size)g_pw->out_w * g_pw->out_ch;
+  const ai_size out_size = (ai_size)g_pw->out_h * out_row_size;
+  const ai_size n_batches = AI_ARRAY_OBJ_SIZE(input->data) / in_size;
+  const ai_float* in_data = AI_ARRAY_OBJ_DATA(input->data, ai_float);
+  ai_float* out_data = AI_ARRAY_OBJ_DATA(output->data, ai_float);
+
+  for ( ai_size b=0; b<n_batches; b++ ) {
+    for ( ai_i32 y0=0; y0<g_dw->out_h; y0+=band ) {
+      const ai_i32 n_rows = AI_MIN(band, g_dw->out_h - y0);
+      ai_float* out_rows = out_data + (ai_size)y0 * out_row_size;
+      conv2d_f32_rows(&p_dw, rows, in_data, y0, n_rows);
+      if ( l->nl_func ) conv2d_f32_nl(l, rows, (ai_size)n_rows * row_size);
+      conv2d_f32_rows(&p_pw, out_rows, rows, 0, n_rows);
+      if ( pw->nl_func ) {
+        conv2d_f32_nl(pw, out_rows, (ai_size)n_rows * out_row_size);
+      }
+    }
+    in_data += in_size;
+    out_data += out_size;
+  }
+}
@@ -0,0 +1,632 @@
+/**
+  ******************************************************************************
+  * @file    layers_dense.c
+  * @brief   implementation of the dense (fully connected) layers
+  ******************************************************************************
+  * @attention
+  *
+  * Open implementation of the float dense layer declared in layers_conv2d.h.
+  * Weights are stored row-major as [out][in] (shape in_channels x channels):
+  * each output channel is the dot product of the input row with one weights
+  * row, plus the optional bias.
+  *
+  * The inner GEMM is dispatched at runtime through a small kernels table
+  * (see dense_kernel_f32_init()): the SIMD kernels of layers_dense_x86.c are
+  * selected on host cpus supporting them, the generic kernel otherwise.
+  * Half precision weights (FLOAT16 format) have their own kernels table
+  * (see dense_kernel_f16_init()), converting the weights on the fly: the
+  * memory traffic of the weights is halved, the accumulation is in float.
+  * Half precision input/output tensors (FLOAT16 activations) are converted
+  * element by element by the generic path.
+  *
+  * Codebook compressed weights (LUT8_FLOAT / LUT4_FLOAT formats: the array
+  * data holds the indices, the array data_start the float table) are
+  * decoded on the fly by a third kernels table (see dense_kernel_lut_init()),
+  * the SIMD variants looking up the table in registers or with gathers.
+  * Block sparse weights (BSR_FLOAT format, pruned models) only store the non
+  * zero blocks of AI_DENSE_BSR_BLOCK outputs x 1 input: their kernels (see
+  * dense_kernel_bsr_init()) skip the zero blocks, the cost being
+  * proportional to the number of stored blocks.
+  * A fifth table (see dense_kernel_gemm_init()) holds the GEMM kernels with
+  * transposed weights ([in][out]) used by the convolutions (layers_conv2d.c):
+  * the outputs are accumulated by register blocks of rows x outputs.
+  *
+  * The integer SSSA variants (signed symmetric int8 weights, signed
+  * asymmetric int8 activations, int32 bias) accumulate in int32 and
+  * requantize each output with the scales read from the intq info of the
+  * tensors: one weights scale for the layer (SSSA) or one per output
+  * channel (SSSA_ch). Their weights can also be packed two per byte: S4
+  * (symmetric) or U4 (zero point(s) read from the intq info as ai_u8), the
+  * int8 x int4 dot products being dispatched through a fourth kernels table
+  * (see dense_kernel_q4_init()) unpacking the nibbles in registers. The
+  * int8 weights dot products have their own table (see
+  * dense_kernel_s8_init()), shared with the pointwise integer convolutions.
+  *
+  ******************************************************************************
+  */
+
+#include "layers_conv2d.h"
+#include "layers_dense.h"
+#include "ai_math_helpers.h"
+#include "core_cpu.h"
+
+/*!
+ * @brief define the cpu dispatch of a kernel table: dense_kernel_<name_>_init
+ * selects the first entry of table_ (sorted from the widest to the generic
+ * kernel) supported by the cpu, dense_kernel_<name_>_get returns it
+ */
+#define DENSE_KERNEL_TABLE(name_, type_, table_) \
+AI_STATIC const type_* g_dense_kernel_ ## name_ = NULL; \
+\
+AI_INTERNAL_API \
+const type_* dense_kernel_ ## name_ ## _init(void) \
+{ \
+  const ai_u32 features = core_cpu_get_features(); \
+  const ai_size n_kernels = AI_C_ARRAY_COUNT(table_); \
+  const type_* kernel = &table_[n_kernels-1]; \
+  for ( ai_size i=0; i<n_kernels; i++ ) { \
+    if ( AI_CPU_HAS_FEATURE(features, table_[i].features) ) { \
+      kernel = &table_[i]; \
+      break; \
+    } \
+  } \
+  /* single store: instances initialized concurrently select the same one */ \
+  __atomic_store_n(&g_dense_kernel_ ## name_, kernel, __ATOMIC_RELEASE); \
+  return kernel; \
+} \
+\
+AI_INTERNAL_API \
+const type_* dense_kernel_ ## name_ ## _get(void) \
+{ \
+  const type_* kernel = \
+    __atomic_load_n(&g_dense_kernel_ ## name_, __ATOMIC_ACQUIRE); \
+  return (kernel) ? kernel : dense_kernel_ ## name_ ## _init(); \
+}
+
+/*!
+ * @brief float dense kernels, sorted from the widest to the generic one
+ */
+AI_STATIC const ai_dense_kernel_f32 g_dense_kernels_f32[] = {
+#if defined(__x86_64__) || defined(__i386__)
+  { "avx512", AI_CPU_FEATURE_AVX512F, func_dense_f32_avx512 },
+  { "avx2",   AI_CPU_FEATURE_AVX2 | AI_CPU_FEATURE_FMA, func_dense_f32_avx2 },
+#endif
+  { "generic", AI_CPU_FEATURE_NONE, func_dense_f32_generic },
+};
+
+/*!
+ * @brief half precision weights dense kernels, sorted as the float ones
+ */
+AI_STATIC const ai_dense_kernel_f16 g_dense_kernels_f16[] = {
+#if defined(__x86_64__) || defined(__i386__)
+  { "avx512", AI_CPU_FEATURE_AVX512F, func_dense_f16_avx512 },
+  { "f16c",   AI_CPU_FEATURE_AVX2 | AI_CPU_FEATURE_FMA | AI_CPU_FEATURE_F16C,
+    func_dense_f16_f16c },
+#endif
+  { "generic", AI_CPU_FEATURE_NONE, func_dense_f16_generic },
+};
+
+/*!
+ * @brief codebook compressed weights dense kernels, sorted as the float ones
+ */
+AI_STATIC const ai_dense_kernel_lut g_dense_kernels_lut[] = {
+#if defined(__x86_64__) || defined(__i386__)
+  { "avx512", AI_CPU_FEATURE_AVX512F,
+    func_dense_lut8_avx512, func_dense_lut4_avx512 },
+  { "avx2",   AI_CPU_FEATURE_AVX2 | AI_CPU_FEATURE_FMA,
+    func_dense_lut8_avx2, func_dense_lut4_avx2 },
+#endif
+  { "generic", AI_CPU_FEATURE_NONE,
+    func_dense_lut8_generic, func_dense_lut4_generic },
+};
+
+/*!
+ * @brief packed 4 bits weights dot kernels, sorted as the float ones
+ */
+AI_STATIC const ai_dense_kernel_q4 g_dense_kernels_q4[] = {
+#if defined(__x86_64__) || defined(__i386__)
+  { "avx512", AI_CPU_FEATURE_AVX512F | AI_CPU_FEATURE_AVX512BW,
+    func_dense_dot_s4_avx512, func_dense_dot_u4_avx512 },
+  { "avx2",   AI_CPU_FEATURE_AVX2,
+    func_dense_dot_s4_avx2, func_dense_dot_u4_avx2 },
+#endif
+  { "generic", AI_CPU_FEATURE_NONE,
+    func_dense_dot_s4_generic, func_dense_dot_u4_generic },
+};
+
+/*!
+ * @brief block sparse weights dense kernels, sorted as the float ones
+ */
+AI_STATIC const ai_dense_kernel_bsr g_dense_kernels_bsr[] = {
+#if defined(__x86_64__) || defined(__i386__)
+  { "avx512", AI_CPU_FEATURE_AVX512F, func_dense_bsr_avx512 },
+  { "avx2",   AI_CPU_FEATURE_AVX2 | AI_CPU_FEATURE_FMA, func_dense_bsr_avx2 },
+#endif
+  { "generic", AI_CPU_FEATURE_NONE, func_dense_bsr_generic },
+};
+
+/*!
+ * @brief transposed weights GEMM kernels (convolutions), sorted as the float
+ * ones
+ */
+AI_STATIC const ai_dense_kernel_gemm g_dense_kernels_gemm[] = {
+#if defined(__x86_64__) || defined(__i386__)
+  { "avx512", AI_CPU_FEATURE_AVX512F, func_dense_gemm_avx512 },
+  { "avx2",   AI_CPU_FEATURE_AVX2 | AI_CPU_FEATURE_FMA, func_dense_gemm_avx2 },
+#endif
+  { "generic", AI_CPU_FEATURE_NONE, func_dense_gemm_generic },
+};
+
+/*!
+ * @brief int8 weights dot kernels, sorted as the float ones
+ */
+AI_STATIC const ai_dense_kernel_s8 g_dense_kernels_s8[] = {
+#if defined(__x86_64__) || defined(__i386__)
+  { "avx512", AI_CPU_FEATURE_AVX512F | AI_CPU_FEATURE_AVX512BW,
+    func_dense_dot_s8_avx512 },
+  { "avx2",   AI_CPU_FEATURE_AVX2, func_dense_dot_s8_avx2 },
+#endif
+  { "generic", AI_CPU_FEATURE_NONE, func_dense_dot_s8_generic },
+};
+
+/******************************************************************************/
+AI_INTERNAL_API
+void func_dense_f32_generic(ai_float* out, const ai_float* in,
+                            const ai_float* weights, const ai_float* bias,
+                            const ai_size n_rows, const ai_size n_in,
+                            const ai_size n_out)
+{
+  for ( ai_size r=0; r<n_rows; r++ ) {
+    const ai_float* in_row = in + r*n_in;
+    const ai_float* w_row  = weights;
+    for ( ai_size o=0; o<n_out; o++ ) {
+      ai_float acc = (bias) ? bias[o] : 0.0f;
+      AI_MATH_DOT_ARRAY(&acc, w_row, in_row, n_in);
+      *out++ = acc;
+      w_row += n_in;
+    }
+  }
+}
+
+AI_INTERNAL_API
+void func_dense_f16_generic(ai_float* out, const ai_float* in,
+                            const ai_u16* weights, const ai_float* bias,
+                            const ai_size n_rows, const ai_size n_in,
+                            const ai_size n_out)
+{
+  for ( ai_size r=0; r<n_rows; r++ ) {
+    const ai_float* in_row = in + r*n_in;
+    const ai_u16* w_row = weights;
+    for ( ai_size o=0; o<n_out; o++ ) {
+      ai_float acc = 0.0f;
+      for ( ai_size i=0; i<n_in; i++ ) {
+        acc += AI_MATH_F16_TO_F32(w_row[i]) * in_row[i];
+      }
+      *out++ = ((bias) ? bias[o] : 0.0f) + acc;
+      w_row += n_in;
+    }
+  }
+}
+
+AI_INTERNAL_API
+void ai_dict8_dot_array_f32(ai_handle out, ai_ptr_const data0, ai_ptr_const lut,
+                            const ai_float* data1, const ai_size data_size)
+{
+  const ai_u8* idx = (const ai_u8*)data0;
+  const ai_float* lut_f = (const ai_float*)lut;
+  ai_float sum = 0.0f;
+  ai_size i = 0;
+
+  for ( ; i+4<=data_size; i+=4 ) {
+    sum += lut_f[idx[i+0]] * data1[i+0];
+    sum += lut_f[idx[i+1]] * data1[i+1];
+    sum += lut_f[idx[i+2]] * data1[i+2];
+    sum += lut_f[idx[i+3]] * data1[i+3];
+  }
+  for ( ; i<data_size; i++ ) sum += lut_f[idx[i]] * data1[i];
+
+  *((ai_float*)out) += sum;
+}
+
+AI_INTERNAL_API
+void ai_dict4_dot_array_f32(ai_handle out, ai_ptr_const data0, ai_ptr_const lut,
+                            const ai_float* data1, const ai_size data_size)
+{
+  const ai_u8* idx = (const ai_u8*)data0;
+  const ai_float* lut_f = (const ai_float*)lut;
+  ai_float sum = 0.0f;
+  ai_size i = 0;
+
+  for ( ; i+2<=data_size; i+=2 ) {
+    const ai_u8 pair = *idx++;
+    sum += lut_f[pair >> 4] * data1[i+0];
+    sum += lut_f[pair & 0xF] * data1[i+1];
+  }
+  if ( i<data_size ) sum += lut_f[(*idx) >> 4] * data1[i];
+
+  *((ai_float*)out) += sum;
+}
+
+AI_INTERNAL_API
+void func_dense_lut8_generic(ai_float* out, const ai_float* in,
+                             const ai_u8* indices, const ai_float* lut,
+                             const ai_float* bias, const ai_size n_rows,
+                             const ai_size n_in, const ai_size n_out)
+{
+  for ( ai_size r=0; r<n_rows; r++ ) {
+    const ai_float* in_row = in + r*n_in;
+    const ai_u8* w_row = indices;
+    for ( ai_size o=0; o<n_out; o++ ) {
+      ai_float acc = (bias) ? bias[o] : 0.0f;
+      ai_dict8_dot_array_f32(&acc, w_row, AI_PTR_CONST(lut), in_row, n_in);
+      *out++ = acc;
+      w_row += n_in;
+    }
+  }
+}
+
+AI_INTERNAL_API
+void func_dense_lut4_generic(ai_float* out, const ai_float* in,
+                             const ai_u8* indices, const ai_float* lut,
+                             const ai_float* bias, const ai_size n_rows,
+                             const ai_size n_in, const ai_size n_out)
+{
+  for ( ai_size r=0; r<n_rows; r++ ) {
+    const ai_float* in_row = in + r*n_in;
+    const ai_u8* w_row = indices;
+    for ( ai_size o=0; o<n_out; o++ ) {
+      ai_float acc = (bias) ? bias[o] : 0.0f;
+      ai_dict4_dot_array_f32(&acc, w_row, AI_PTR_CONST(lut), in_row, n_in);
+      *out++ = acc;
+      w_row += AI_DENSE_LUT4_ROW_SIZE(n_in);
+    }
+  }
+}
+
+/*!
+ * @brief int8 x int4 dot product, the nibbles being sign extended (S4) or not
+ */
+AI_DECLARE_STATIC
+ai_i32 dense_dot_q4(const ai_i8* in, const ai_u8* weights, const ai_i32 zp_in,
+                    const ai_i32 zp_w, const ai_size n_in, const ai_bool s4)
+{
+  /* a signed nibble n is ((n ^ 8) - 8) */
+  const ai_u8 flip = (s4) ? 0x88 : 0x00;
+  const ai_i32 zp = (s4) ? 8 : zp_w;
+  ai_i32 acc = 0;
+  ai_size i = 0;
+
+  for ( ; i+2<=n_in; i+=2 ) {
+    const ai_u8 pair = (*weights++) ^ flip;
+    acc += ((ai_i32)in[i+0] - zp_in) * ((ai_i32)(pair >> 4) - zp);
+    acc += ((ai_i32)in[i+1] - zp_in) * ((ai_i32)(pair & 0xF) - zp);
+  }
+  if ( i<n_in ) {
+    acc += ((ai_i32)in[i] - zp_in) * ((ai_i32)(((*weights) ^ flip) >> 4) - zp);
+  }
+  return acc;
+}
+
+AI_INTERNAL_API
+ai_i32 func_dense_dot_s4_generic(const ai_i8* in, const ai_u8* weights,
+                                 const ai_i32 zp_in, const ai_i32 zp_w,
+                                 const ai_size n_in)
+{
+  return dense_dot_q4(in, weights, zp_in, zp_w, n_in, true);
+}
+
+AI_INTERNAL_API
+ai_i32 func_dense_dot_u4_generic(const ai_i8* in, const ai_u8* weights,
+                                 const ai_i32 zp_in, const ai_i32 zp_w,
+                                 const ai_size n_in)
+{
+  return dense_dot_q4(in, weights, zp_in, zp_w, n_in, false);
+}
+
+AI_INTERNAL_API
+void func_dense_bsr_generic(ai_float* out, const ai_float* in,
+                            const ai_float* values, const ai_u32* index,
+                            const ai_float* bias, const ai_size n_rows,
+                            const ai_size n_in, const ai_size n_out)
+{
+  const ai_size n_groups = AI_DENSE_BSR_GROUPS(n_out);
+  const ai_u32* columns = index + n_groups + 1;
+
+  for ( ai_size r=0; r<n_rows; r++ ) {
+    const ai_float* in_row = in + r*n_in;
+    for ( ai_size g=0; g<n_groups; g++ ) {
+      const ai_size o = g*AI_DENSE_BSR_BLOCK;
+      const ai_size n_b = AI_MIN(AI_DENSE_BSR_BLOCK, n_out - o);
+      ai_float acc[AI_DENSE_BSR_BLOCK];
+      for ( ai_size j=0; j<AI_DENSE_BSR_BLOCK; j++ ) {
+        acc[j] = (bias && (j<n_b)) ? bias[o + j] : 0.0f;
+      }
+      for ( ai_u32 k=index[g]; k<index[g+1]; k++ ) {
+        const ai_float x = in_row[columns[k]];
+        const ai_float* v = values + k*AI_DENSE_BSR_BLOCK;
+        for ( ai_size j=0; j<AI_DENSE_BSR_BLOCK; j++ ) acc[j] += x * v[j];
+      }
+      for ( ai_size j=0; j<n_b; j++ ) out[o + j] = acc[j];
+    }
+    out += n_out;
+  }
+}
+
+AI_INTERNAL_API
+void func_dense_gemm_generic(ai_float* out, const ai_float* in,
+                             const ai_float* weights, const ai_float* bias,
+                             const ai_size n_rows, const ai_size n_in,
+                             const ai_size n_out)
+{
+  for ( ai_size r=0; r<n_rows; r++ ) {
+    const ai_float* in_row = in + r*n_in;
+    for ( ai_size o=0; o<n_out; o++ ) out[o] = (bias) ? bias[o] : 0.0f;
+    for ( ai_size i=0; i<n_in; i++ ) {
+      const ai_float x = in_row[i];
+      const ai_float* w_row = weights + i*n_out;
+      for ( ai_size o=0; o<n_out; o++ ) out[o] += x * w_row[o];
+    }
+    out += n_out;
+  }
+}
+
+AI_INTERNAL_API
+ai_i32 func_dense_dot_s8_generic(const ai_i8* in, const ai_i8* weights,
+                                 const ai_i32 zp_in, const ai_size n_in)
+{
+  ai_i32 acc = 0;
+  for ( ai_size i=0; i<n_in; i++ ) {
+    acc += ((ai_i32)in[i] - zp_in) * (ai_i32)weights[i];
+  }
+  return acc;
+}
+
+DENSE_KERNEL_TABLE(f32, ai_dense_kernel_f32, g_dense_kernels_f32)
+DENSE_KERNEL_TABLE(f16, ai_dense_kernel_f16, g_dense_kernels_f16)
+DENSE_KERNEL_TABLE(lut, ai_dense_kernel_lut, g_dense_kernels_lut)
+DENSE_KERNEL_TABLE(q4, ai_dense_kernel_q4, g_dense_kernels_q4)
+DENSE_KERNEL_TABLE(bsr, ai_dense_kernel_bsr, g_dense_kernels_bsr)
+DENSE_KERNEL_TABLE(gemm, ai_dense_kernel_gemm, g_dense_kernels_gemm)
+DENSE_KERNEL_TABLE(s8, ai_dense_kernel_s8, g_dense_kernels_s8)
+
+/******************************************************************************/
+/*!
+ * @brief float formats handled by the float dense layer: FLOAT, FLOAT16,
+ * the LUT8_FLOAT / LUT4_FLOAT compressed weights and the BSR_FLOAT block
+ * sparse weights
+ */
+#define DENSE_FMT_IS_F32(fmt_) \
+  ((AI_FMT_GET_TYPE(fmt_)==AI_FMT_FLOAT) && (AI_FMT_GET_BITS(fmt_)==32))
+
+#define DENSE_FMT_IS_F16(fmt_) \
+  ((AI_FMT_GET_TYPE(fmt_)==AI_FMT_FLOAT) && (AI_FMT_GET_BITS(fmt_)==16))
+
+#define DENSE_FMT_IS_LUT(fmt_) \
+  (AI_FMT_SAME(fmt_, AI_ARRAY_FORMAT_LUT8_FLOAT) || \
+   AI_FMT_SAME(fmt_, AI_ARRAY_FORMAT_LUT4_FLOAT))
+
+#define DENSE_FMT_IS_BSR(fmt_) \
+  AI_FMT_SAME(fmt_, AI_ARRAY_FORMAT_BSR_FLOAT)
+
+/*!
+ * @brief element i of a FLOAT or FLOAT16 array
+ */
+AI_DECLARE_STATIC
+ai_float dense_value_get(const ai_handle data, const ai_bool f16,
+                         const ai_size i)
+{
+  return (f16) ? AI_MATH_F16_TO_F32(((const ai_u16*)data)[i])
+               : ((const ai_float*)data)[i];
+}
+
+/*!
+ * @brief float dense with half precision input and/or output tensors
+ * (weights FLOAT or FLOAT16), converted element by element
+ */
+AI_DECLARE_STATIC
+void dense_f16_activations(ai_handle out, const ai_bool out_f16,
+                           const ai_handle in, const ai_bool in_f16,
+                           const ai_handle weights, const ai_bool w_f16,
+                           const ai_float* bias, const ai_size n_rows,
+                           const ai_size n_in, const ai_size n_out)
+{
+  for ( ai_size r=0; r<n_rows; r++ ) {
+    for ( ai_size o=0; o<n_out; o++ ) {
+      ai_float acc = 0.0f;
+      for ( ai_size i=0; i<n_in; i++ ) {
+        acc += dense_value_get(weights, w_f16, o*n_in + i) *
+               dense_value_get(in, in_f16, r*n_in + i);
+      }
+      acc += (bias) ? bias[o] : 0.0f;
+      if ( out_f16 ) {
+        ((ai_u16*)out)[r*n_out + o] = AI_MATH_F32_TO_F16(acc);
+      } else {
+        ((ai_float*)out)[r*n_out + o] = acc;
+      }
+    }
+  }
+}
+
+/******************************************************************************/
+AI_INTERNAL_API
+void forward_dense(ai_layer* layer)
+{
+  const ai_tensor* input = GET_TENSOR_IN(layer->tensors, 0);
+  ai_tensor* output = GET_TENSOR_OUT(layer->tensors, 0);
+  AI_LAYER_WEIGHTS_GET(layer, weights, bias)
+
+  const ai_array_format in_fmt  = AI_ARRAY_OBJ_FMT(input->data);
+  const ai_array_format out_fmt = AI_ARRAY_OBJ_FMT(output->data);
+  const ai_array_format w_fmt   = AI_ARRAY_OBJ_FMT(weights->data);
+
+  if ( !(DENSE_FMT_IS_F32(w_fmt) || DENSE_FMT_IS_F16(w_fmt) ||
+         DENSE_FMT_IS_LUT(w_fmt) || DENSE_FMT_IS_BSR(w_fmt)) ||
+       !(DENSE_FMT_IS_F32(in_fmt) || DENSE_FMT_IS_F16(in_fmt)) ||
+       !(DENSE_FMT_IS_F32(out_fmt) || DENSE_FMT_IS_F16(out_fmt)) ||
+       (bias && !DENSE_FMT_IS_F32(AI_ARRAY_OBJ_FMT(bias->data))) ||
+       ((DENSE_FMT_IS_LUT(w_fmt) || DENSE_FMT_IS_BSR(w_fmt)) &&
+        !(DENSE_FMT_IS_F32(in_fmt) && DENSE_FMT_IS_F32(out_fmt))) ) {
+    AI_ERROR_TRAP(layer->network, INVALID_PARAM, INVALID_FORMAT);
+    return;
+  }
+
+  const ai_size n_in  = AI_SHAPE_IN_CH(&weights->shape);
+  const ai_size n_out = AI_SHAPE_CH(&weights->shape);
+  const ai_size n_rows = AI_ARRAY_OBJ_SIZE(input->data) / n_in;
+
+  const ai_float* b_data  = (bias) ? AI_ARRAY_OBJ_DATA(bias->data, ai_float) : NULL;
+
+  if ( DENSE_FMT_IS_F16(in_fmt) || DENSE_FMT_IS_F16(out_fmt) ) {
+    dense_f16_activations(
+      AI_ARRAY_OBJ_DATA(output->data, void), DENSE_FMT_IS_F16(out_fmt),
+      AI_ARRAY_OBJ_DATA(input->data, void), DENSE_FMT_IS_F16(in_fmt),
+      AI_ARRAY_OBJ_DATA(weights->data, void), DENSE_FMT_IS_F16(w_fmt),
+      b_data, n_rows, n_in, n_out);
+    return;
+  }
+
+  const ai_float* in_data = AI_ARRAY_OBJ_DATA(input->data, ai_float);
+  ai_float* out_data = AI_ARRAY_OBJ_DATA(output->data, ai_float);
+
+  if ( DENSE_FMT_IS_LUT(w_fmt) ) {
+    const ai_dense_kernel_lut* kernel = dense_kernel_lut_get();
+    const func_dense_lut func =
+      (AI_FMT_GET_TYPE(w_fmt)==AI_FMT_LUT8) ? kernel->lut8 : kernel->lut4;
+    func(out_data, in_data, AI_ARRAY_OBJ_DATA(weights->data, ai_u8),
+         AI_ARRAY_OBJ_DATA_START(weights->data, ai_float),
+         b_data, n_rows, n_in, n_out);
+    return;
+  }
+
+  if ( DENSE_FMT_IS_BSR(w_fmt) ) {
+    const ai_u32* index = AI_ARRAY_OBJ_DATA_START(weights->data, ai_u32);
+    /* the last offset of the index is the number of stored blocks */
+    if ( AI_ARRAY_OBJ_SIZE(weights->data) !=
+         index[AI_DENSE_BSR_GROUPS(n_out)]*AI_DENSE_BSR_BLOCK ) {
+      AI_ERROR_TRAP(layer->network, INVALID_PARAM, INVALID_SIZE);
+      return;
+    }
+    dense_kernel_bsr_get()->func(out_data, in_data,
+                                 AI_ARRAY_OBJ_DATA(weights->data, ai_float),
+                                 index, b_data, n_rows, n_in, n_out);
+    return;
+  }
+
+  if ( DENSE_FMT_IS_F16(w_fmt) ) {
+    dense_kernel_f16_get()->func(out_data, in_data,
+                                 AI_ARRAY_OBJ_DATA(weights->data, ai_u16),
+                                 b_data, n_rows, n_in, n_out);
+    return;
+  }
+
+  dense_kernel_f32_get()->func(out_data, in_data,
+                               AI_ARRAY_OBJ_DATA(weights->data, ai_float),
+                               b_data, n_rows, n_in, n_out);
+}
+
+/******************************************************************************/
+/*!
+ * @brief check that a tensor has the given integer format and carries its
+ * quantization parameters
+ */
+AI_DECLARE_STATIC
+ai_bool dense_tensor_is_int(const ai_tensor* t, const ai_array_format fmt)
+{
+  return AI_FMT_SAME(AI_ARRAY_OBJ_FMT(t->data), fmt) &&
+         AI_HAS_INTQ_INFO_LIST(AI_KLASS_GET_INTQ_INFO_LIST(t));
+}
+
+/*!
+ * @brief int8 dense for the SSSA schemes:
+ * out = zp_out + (s_in * s_w[o] / s_out) * (bias[o] + sum_i((in[i] - zp_in) * (w[o][i] - zp_w[o])))
+ * the bias is stored in the s_in * s_w[o] scale. The weights are int8 or
+ * packed S4 (zero point 0) or U4 (zero point(s) of the intq info)
+ */
+AI_DECLARE_STATIC
+void dense_integer_SSSA(ai_layer* layer, const ai_bool per_channel)
+{
+  const ai_tensor* input = GET_TENSOR_IN(layer->tensors, 0);
+  ai_tensor* output = GET_TENSOR_OUT(layer->tensors, 0);
+  AI_LAYER_WEIGHTS_GET(layer, weights, bias)
+
+  const ai_bool w_s4 = dense_tensor_is_int(weights, AI_ARRAY_FORMAT_S4);
+  const ai_bool w_u4 = dense_tensor_is_int(weights, AI_ARRAY_FORMAT_U4);
+
+  if ( !dense_tensor_is_int(input, AI_ARRAY_FORMAT_S8) ||
+       !dense_tensor_is_int(output, AI_ARRAY_FORMAT_S8) ||
+       !(w_s4 || w_u4 || dense_tensor_is_int(weights, AI_ARRAY_FORMAT_S8)) ||
+       (bias && !AI_FMT_SAME(AI_ARRAY_OBJ_FMT(bias->data), AI_ARRAY_FORMAT_S32)) ) {
+    AI_ERROR_TRAP(layer->network, INVALID_PARAM, INVALID_FORMAT);
+    return;
+  }
+
+  const ai_size n_in  = AI_SHAPE_IN_CH(&weights->shape);
+  const ai_size n_out = AI_SHAPE_CH(&weights->shape);
+  const ai_size n_rows = AI_ARRAY_OBJ_SIZE(input->data) / n_in;
+
+  if ( per_channel && (AI_TENSOR_INTEGER_GET_SIZE(weights)!=n_out) ) {
+    AI_ERROR_TRAP(layer->network, INVALID_PARAM, INVALID_SIZE);
+    return;
+  }
+
+  const ai_float s_in  = AI_TENSOR_INTEGER_GET_SCALE(input, 0);
+  const ai_float s_out = AI_TENSOR_INTEGER_GET_SCALE(output, 0);
+  const ai_i32 zp_in   = AI_TENSOR_INTEGER_GET_ZEROPOINT_I8(input, 0);
+  const ai_i32 zp_out  = AI_TENSOR_INTEGER_GET_ZEROPOINT_I8(output, 0);
+  const ai_float* s_w  =
+    AI_INTQ_INFO_LIST_SCALE_ARRAY(AI_KLASS_GET_INTQ_INFO_LIST(weights), ai_float);
+  const ai_u8* zp_w    = (w_u4) ?
+    AI_INTQ_INFO_LIST_ZEROPOINT_ARRAY(AI_KLASS_GET_INTQ_INFO_LIST(weights), ai_u8)
+    : NULL;
+  const ai_float in_out = s_in / s_out;
+
+  const ai_i8* in_data  = AI_ARRAY_OBJ_DATA(input->data, ai_i8);
+  const ai_i32* b_data  = (bias) ? AI_ARRAY_OBJ_DATA(bias->data, ai_i32) : NULL;
+  ai_i8* out_data = AI_ARRAY_OBJ_DATA(output->data, ai_i8);
+
+  if ( w_s4 || w_u4 ) {
+    const ai_dense_kernel_q4* kernel = dense_kernel_q4_get();
+    const func_dense_dot_q4 dot = (w_s4) ? kernel->s4 : kernel->u4;
+    const ai_u8* w_data = AI_ARRAY_OBJ_DATA(weights->data, ai_u8);
+
+    for ( ai_size r=0; r<n_rows; r++ ) {
+      const ai_i8* in_row = in_data + r*n_in;
+      const ai_u8* w_row  = w_data;
+      for ( ai_size o=0; o<n_out; o++ ) {
+        const ai_size c = (per_channel) ? o : 0;
+        const ai_i32 acc = ((b_data) ? b_data[o] : 0) +
+          dot(in_row, w_row, zp_in, (zp_w) ? zp_w[c] : 0, n_in);
+        *out_data++ = AI_MATH_REQUANTIZE_S8(acc, in_out * s_w[c], zp_out);
+        w_row += AI_DENSE_Q4_ROW_SIZE(n_in);
+      }
+    }
+    return;
+  }
+
+  const ai_i8* w_data   = AI_ARRAY_OBJ_DATA(weights->data, ai_i8);
+  const func_dense_dot_s8 dot = dense_kernel_s8_get()->func;
+
+  for ( ai_size r=0; r<n_rows; r++ ) {
+    const ai_i8* in_row = in_data + r*n_in;
+    const ai_i8* w_row  = w_data;
+    for ( ai_size o=0; o<n_out; o++ ) {
+      const ai_i32 acc = ((b_data) ? b_data[o] : 0) +
+        dot(in_row, w_row, zp_in, n_in);
+      const ai_float mult = in_out * s_w[(per_channel) ? o : 0];
+      *out_data++ = AI_MATH_REQUANTIZE_S8(acc, mult, zp_out);
+      w_row += n_in;
+    }
+  }
+}
+
+AI_INTERNAL_API
+void forward_dense_integer_SSSA(ai_layer* layer)
+{
+  dense_integer_SSSA(layer, false);
+}
+
+AI_INTERNAL_API
+void forward_dense_integer_SSSA_ch(ai_layer* layer)
+{
+  dense_integer_SSSA(layer, true);
+}
@@ -0,0 +1,953 @@
+/**
+  ******************************************************************************
+  * @file    layers_dense_x86.c
+  * @brief   x86 SIMD (AVX2 / AVX-512) kernels of the dense layers
+  ******************************************************************************
+  * @attention
+  *
+  * Each kernel is compiled with a function level target attribute, so the
+  * translation unit builds with the baseline compiler flags and the kernels
+  * are only called once the cpu support is checked (see core_cpu.h).
+  *
+  * The weights rows are processed by blocks of 4 outputs sharing the input
+  * vector loads; the accumulation order differs from the generic kernel, so
+  * the results match it within AI_FLOAT_TOLERANCE, not bit exactly.
+  *
+  * The half precision weights variants widen the weights with the F16C
+  * (vcvtph2ps) conversions in the inner loop, the input and the accumulation
+  * staying in float.
+  *
+  * The codebook compressed weights variants decode the indices in the inner
+  * loop: the 8 bits indices are gathered from the 256 entries table, the 4
+  * bits ones are looked up in the 16 entries table held in registers (one
+  * vpermps on AVX-512, two vpermps and a blend on AVX2).
+  *
+  * The packed 4 bits integer weights variants (S4 / U4) split the nibbles
+  * with a shift and a mask, re-interleave them in order and widen them to
+  * int16 next to the int8 input: vpmaddwd accumulates the pairs in int32
+  * (exact, as the generic kernel). The S4 nibbles are flipped (n ^ 8) and
+  * offset by 8, so both variants share the unsigned unpacking. The int8
+  * weights variants widen both operands to int16 for vpmaddwd the same way.
+  *
+  * The block sparse weights variants keep a row of 8 outputs in a register
+  * and accumulate each stored block times its broadcast input; the AVX-512
+  * variant processes two input rows per pass (one per 256 bits half), the
+  * blocks being loaded once. The partial last row uses masked loads/stores.
+  *
+  * The transposed weights GEMM variants (convolutions) keep a block of 4
+  * rows x 2 vectors of outputs in registers: each weights row of the block
+  * is loaded once and multiplied by the broadcast input of the 4 rows. The
+  * inputs are processed by passes of AI_DENSE_X86_GEMM_DEPTH, a pass
+  * walking all the rows for a strip of outputs (the strip of weights stays
+  * in the L1 cache). The last outputs of a row use masked loads/stores.
+  *
+  ******************************************************************************
+  */
+
+#include "layers_dense.h"
+#include "layers_conv2d.h"
+#include "ai_math_helpers.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <immintrin.h>
+
+#define AI_DENSE_X86_BLOCK      (4)
+
+/******************************************************************************/
+/* AVX2 + FMA                                                                 */
+/******************************************************************************/
+AI_DECLARE_STATIC __attribute__((target("avx2,fma")))
+ai_float dense_x86_hsum_256(const __m256 v)
+{
+  __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+  s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+  s = _mm_add_ss(s, _mm_movehdup_ps(s));
+  return _mm_cvtss_f32(s);
+}
+
+AI_INTERNAL_API __attribute__((target("avx2,fma")))
+void func_dense_f32_avx2(ai_float* out, const ai_float* in,
+                         const ai_float* weights, const ai_float* bias,
+                         const ai_size n_rows, const ai_size n_in,
+                         const ai_size n_out)
+{
+  const ai_size n_in_8 = n_in & ~(ai_size)7;
+
+  for ( ai_size r=0; r<n_rows; r++ ) {
+    const ai_float* in_row = in + r*n_in;
+    ai_size o = 0;
+
+    for ( ; o+AI_DENSE_X86_BLOCK<=n_out; o+=AI_DENSE_X86_BLOCK ) {
+      const ai_float* w0 = weights + (o+0)*n_in;
+      const ai_float* w1 = w0 + n_in;
+      const ai_float* w2 = w1 + n_in;
+      const ai_float* w3 = w2 + n_in;
+      __m256 acc0 = _mm256_setzero_ps();
+      __m256 acc1 = _mm256_setzero_ps();
+      __m256 acc2 = _mm256_setzero_ps();
+      __m256 acc3 = _mm256_setzero_ps();
+      ai_size i = 0;
+      for ( ; i<n_in_8; i+=8 ) {
+        const __m256 x = _mm256_loadu_ps(in_row + i);
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(w0 + i), x, acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(w1 + i), x, acc1);
+        acc2 = _mm256_fmadd_ps(_mm256_loadu_ps(w2 + i), x, acc2);
+        acc3 = _mm256_fmadd_ps(_mm256_loadu_ps(w3 + i), x, acc3);
+      }
+      ai_float s0 = dense_x86_hsum_256(acc0);
+      ai_float s1 = dense_x86_hsum_256(acc1);
+      ai_float s2 = dense_x86_hsum_256(acc2);
+      ai_float s3 = dense_x86_hsum_256(acc3);
+      for ( ; i<n_in; i++ ) {
+        const ai_float x = in_row[i];
+        s0 += w0[i] * x;
+        s1 += w1[i] * x;
+        s2 += w2[i] * x;
+        s3 += w3[i] * x;
+      }
+      out[o+0] = ((bias) ? bias[o+0] : 0.0f) + s0;
+      out[o+1] = ((bias) ? bias[o+1] : 0.0f) + s1;
+      out[o+2] = ((bias) ? bias[o+2] : 0.0f) + s2;
+      out[o+3] = ((bias) ? bias[o+3] : 0.0f) + s3;
+    }
+
+    for ( ; o<n_out; o++ ) {
+      const ai_float* w_row = weights + o*n_in;
+      __m256 acc = _mm256_setzero_ps();
+      ai_size i = 0;
+      for ( ; i<n_in_8; i+=8 ) {
+        acc = _mm256_fmadd_ps(_mm256_loadu_ps(w_row + i),
+                              _mm256_loadu_ps(in_row + i), acc);
+      }
+      ai_float s = dense_x86_hsum_256(acc);
+      for ( ; i<n_in; i++ ) s += w_row[i] * in_row[i];
+      out[o] = ((bias) ? bias[o] : 0.0f) + s;
+    }
+    out += n_out;
+  }
+}
+
+/******************************************************************************/
+/* AVX-512F                                                                   */
+/******************************************************************************/
+AI_INTERNAL_API __attribute__((target("avx512f")))
+void func_dense_f32_avx512(ai_float* out, const ai_float* in,
+                           const ai_float* weights, const ai_float* bias,
+                           const ai_size n_rows, const ai_size n_in,
+                           const ai_size n_out)
+{
+  const ai_size n_in_16 = n_in & ~(ai_size)15;
+  const __mmask16 tail = (__mmask16)((1U << (n_in - n_in_16)) - 1U);
+
+  for ( ai_size r=0; r<n_rows; r++ ) {
+    const ai_float* in_row = in + r*n_in;
+    const __m512 x_tail = _mm512_maskz_loadu_ps(tail, in_row + n_in_16);
+    ai_size o = 0;
+
+    for ( ; o+AI_DENSE_X86_BLOCK<=n_out; o+=AI_DENSE_X86_BLOCK ) {
+      const ai_float* w0 = weights + (o+0)*n_in;
+      const ai_float* w1 = w0 + n_in;
+      const ai_float* w2 = w1 + n_in;
+      const ai_float* w3 = w2 + n_in;
+      __m512 acc0 = _mm512_setzero_ps();
+      __m512 acc1 = _mm512_setzero_ps();
+      __m512 acc2 = _mm512_setzero_ps();
+      __m512 acc3 = _mm512_setzero_ps();
+      for ( ai_size i=0; i<n_in_16; i+=16 ) {
+        const __m512 x = _mm512_loadu_ps(in_row + i);
+        acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(w0 + i), x, acc0);
+        acc1 = _mm512_fmadd_ps(_mm512_loadu_ps(w1 + i), x, acc1);
+        acc2 = _mm512_fmadd_ps(_mm512_loadu_ps(w2 + i), x, acc2);
+        acc3 = _mm512_fmadd_ps(_mm512_loadu_ps(w3 + i), x, acc3);
+      }
+      if ( tail ) {
+        acc0 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(tail, w0 + n_in_16), x_tail, acc0);
+        acc1 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(tail, w1 + n_in_16), x_tail, acc1);
+        acc2 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(tail, w2 + n_in_16), x_tail, acc2);
+        acc3 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(tail, w3 + n_in_16), x_tail, acc3);
+      }
+      out[o+0] = ((bias) ? bias[o+0] : 0.0f) + _mm512_reduce_add_ps(acc0);
+      out[o+1] = ((bias) ? bias[o+1] : 0.0f) + _mm512_reduce_add_ps(acc1);
+      out[o+2] = ((bias) ? bias[o+2] : 0.0f) + _mm512_reduce_add_ps(acc2);
+      out[o+3] = ((bias) ? bias[o+3] : 0.0f) + _mm512_reduce_add_ps(acc3);
+    }
+
+    for ( ; o<n_out; o++ ) {
+      const ai_float* w_row = weights + o*n_in;
+      __m512 acc = _mm512_setzero_ps();
+      for ( ai_size i=0; i<n_in_16; i+=16 ) {
+        acc = _mm512_fmadd_ps(_mm512_loadu_ps(w_row + i),
+                              _mm512_loadu_ps(in_row + i), acc);
+      }
+      if ( tail ) {
+        acc = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(tail, w_row + n_in_16), x_tail, acc);
+      }
+      out[o] = ((bias) ? bias[o] : 0.0f) + _mm512_reduce_add_ps(acc);
+    }
+    out += n_out;
+  }
+}
+
+/******************************************************************************/
+/* AVX2 + FMA + F16C, half precision weights                                  */
+/******************************************************************************/
+#define AI_DENSE_X86_LOAD_PH_256(ptr_) \
+  _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(ptr_)))
+
+AI_INTERNAL_API __attribute__((target("avx2,fma,f16c")))
+void func_dense_f16_f16c(ai_float* out, const ai_float* in,
+                         const ai_u16* weights, const ai_float* bias,
+                         const ai_size n_rows, const ai_size n_in,
+                         const ai_size n_out)
+{
+  const ai_size n_in_8 = n_in & ~(ai_size)7;
+
+  for ( ai_size r=0; r<n_rows; r++ ) {
+    const ai_float* in_row = in + r*n_in;
+    ai_size o = 0;
+
+    for ( ; o+AI_DENSE_X86_BLOCK<=n_out; o+=AI_DENSE_X86_BLOCK ) {
+      const ai_u16* w0 = weights + (o+0)*n_in;
+      const ai_u16* w1 = w0 + n_in;
+      const ai_u16* w2 = w1 + n_in;
+      const ai_u16* w3 = w2 + n_in;
+      __m256 acc0 = _mm256_setzero_ps();
+      __m256 acc1 = _mm256_setzero_ps();
+      __m256 acc2 = _mm256_setzero_ps();
+      __m256 acc3 = _mm256_setzero_ps();
+      ai_size i = 0;
+      for ( ; i<n_in_8; i+=8 ) {
+        const __m256 x = _mm256_loadu_ps(in_row + i);
+        acc0 = _mm256_fmadd_ps(AI_DENSE_X86_LOAD_PH_256(w0 + i), x, acc0);
+        acc1 = _mm256_fmadd_ps(AI_DENSE_X86_LOAD_PH_256(w1 + i), x, acc1);
+        acc2 = _mm256_fmadd_ps(AI_DENSE_X86_LOAD_PH_256(w2 + i), x, acc2);
+        acc3 = _mm256_fmadd_ps(AI_DENSE_X86_LOAD_PH_256(w3 + i), x, acc3);
+      }
+      ai_float s0 = dense_x86_hsum_256(acc0);
+      ai_float s1 = dense_x86_hsum_256(acc1);
+      ai_float s2 = dense_x86_hsum_256(acc2);
+      ai_float s3 = dense_x86_hsum_256(acc3);
+      for ( ; i<n_in; i++ ) {
+        const ai_float x = in_row[i];
+        s0 += _cvtsh_ss(w0[i]) * x;
+        s1 += _cvtsh_ss(w1[i]) * x;
+        s2 += _cvtsh_ss(w2[i]) * x;
+        s3 += _cvtsh_ss(w3[i]) * x;
+      }
+      out[o+0] = ((bias) ? bias[o+0] : 0.0f) + s0;
+      out[o+1] = ((bias) ? bias[o+1] : 0.0f) + s1;
+      out[o+2] = ((bias) ? bias[o+2] : 0.0f) + s2;
+      out[o+3] = ((bias) ? bias[o+3] : 0.0f) + s3;
+    }
+
+    for ( ; o<n_out; o++ ) {
+      const ai_u16* w_row = weights + o*n_in;
+      __m256 acc = _mm256_setzero_ps();
+      ai_size i = 0;
+      for ( ; i<n_in_8; i+=8 ) {
+        acc = _mm256_fmadd_ps(AI_DENSE_X86_LOAD_PH_256(w_row + i),
+                              _mm256_loadu_ps(in_row + i), acc);
+      }
+      ai_float s = dense_x86_hsum_256(acc);
+      for ( ; i<n_in; i++ ) s += _cvtsh_ss(w_row[i]) * in_row[i];
+      out[o] = ((bias) ? bias[o] : 0.0f) + s;
+    }
+    out += n_out;
+  }
+}
+
+/******************************************************************************/
+/* AVX-512F, half precision weights                                           */
+/******************************************************************************/
+#define AI_DENSE_X86_LOAD_PH_512(ptr_) \
+  _mm512_cvtph_ps(_mm256_loadu_si256((const __m256i*)(ptr_)))
+
+/* the 16 bits masked loads need AVX-512BW: the weights tail of a row is
+ * copied in a zero padded vector instead */
+AI_DECLARE_STATIC __attribute__((target("avx512f")))
+__m512 dense_x86_load_ph_tail_512(const ai_u16* w, const ai_size n)
+{
+  ai_u16 tmp[16] = { 0 };
+  for ( ai_size i=0; i<n; i++ ) tmp[i] = w[i];
+  return AI_DENSE_X86_LOAD_PH_512(tmp);
+}
+
+AI_INTERNAL_API __attribute__((target("avx512f")))
+void func_dense_f16_avx512(ai_float* out, const ai_float* in,
+                           const ai_u16* weights, const ai_float* bias,
+                           const ai_size n_rows, const ai_size n_in,
+                           const ai_size n_out)
+{
+  const ai_size n_in_16 = n_in & ~(ai_size)15;
+  const ai_size n_tail = n_in - n_in_16;
+  const __mmask16 tail = (__mmask16)((1U << n_tail) - 1U);
+
+  for ( ai_size r=0; r<n_rows; r++ ) {
+    const ai_float* in_row = in + r*n_in;
+    const __m512 x_tail = _mm512_maskz_loadu_ps(tail, in_row + n_in_16);
+    ai_size o = 0;
+
+    for ( ; o+AI_DENSE_X86_BLOCK<=n_out; o+=AI_DENSE_X86_BLOCK ) {
+      const ai_u16* w0 = weights + (o+0)*n_in;
+      const ai_u16* w1 = w0 + n_in;
+      const ai_u16* w2 = w1 + n_in;
+      const ai_u16* w3 = w2 + n_in;
+      __m512 acc0 = _mm512_setzero_ps();
+      __m512 acc1 = _mm512_setzero_ps();
+      __m512 acc2 = _mm512_setzero_ps();
+      __m512 acc3 = _mm512_setzero_ps();
+      for ( ai_size i=0; i<n_in_16; i+=16 ) {
+        const __m512 x = _mm512_loadu_ps(in_row + i);
+        acc0 = _mm512_fmadd_ps(AI_DENSE_X86_LOAD_PH_512(w0 + i), x, acc0);
+        acc1 = _mm512_fmadd_ps(AI_DENSE_X86_LOAD_PH_512(w1 + i), x, acc1);
+        acc2 = _mm512_fmadd_ps(AI_DENSE_X86_LOAD_PH_512(w2 + i), x, acc2);
+        acc3 = _mm512_fmadd_ps(AI_DENSE_X86_LOAD_PH_512(w3 + i), x, acc3);
+      }
+      if ( tail ) {
+        acc0 = _mm512_fmadd_ps(dense_x86_load_ph_tail_512(w0 + n_in_16, n_tail), x_tail, acc0);
+        acc1 = _mm512_fmadd_ps(dense_x86_load_ph_tail_512(w1 + n_in_16, n_tail), x_tail, acc1);
+        acc2 = _mm512_fmadd_ps(dense_x86_load_ph_tail_512(w2 + n_in_16, n_tail), x_tail, acc2);
+        acc3 = _mm512_fmadd_ps(dense_x86_load_ph_tail_512(w3 + n_in_16, n_tail), x_tail, acc3);
+      }
+      out[o+0] = ((bias) ? bias[o+0] : 0.0f) + _mm512_reduce_add_ps(acc0);
+      out[o+1] = ((bias) ? bias[o+1] : 0.0f) + _mm512_reduce_add_ps(acc1);
+      out[o+2] = ((bias) ? bias[o+2] : 0.0f) + _mm512_reduce_add_ps(acc2);
+      out[o+3] = ((bias) ? bias[o+3] : 0.0f) + _mm512_reduce_add_ps(acc3);
+    }
+
+    for ( ; o<n_out; o++ ) {
+      const ai_u16* w_row = weights + o*n_in;
+      __m512 acc = _mm512_setzero_ps();
+      for ( ai_size i=0; i<n_in_16; i+=16 ) {
+        acc = _mm512_fmadd_ps(AI_DENSE_X86_LOAD_PH_512(w_row + i),
+                              _mm512_loadu_ps(in_row + i), acc);
+      }
+      if ( tail ) {
+        acc = _mm512_fmadd_ps(dense_x86_load_ph_tail_512(w_row + n_in_16, n_tail),
+                              x_tail, acc);
+      }
+      out[o] = ((bias) ? bias[o] : 0.0f) + _mm512_reduce_add_ps(acc);
+    }
+    out += n_out;
+  }
+}
+
+/******************************************************************************/
+/* AVX2 + FMA, codebook compressed weights                                    */
+/******************************************************************************/
+/* 8 nibbles of 4 bytes (the first one in the high nibble), one per lane,
+ * upper bits left set: the permutes only use the low bits of the index */
+AI_DECLARE_STATIC __attribute__((target("avx2,fma")))
+__m256i dense_x86_nibbles_256(const ai_u8* p)
+{
+  ai_i32 b;
+  __builtin_memcpy(&b, p, sizeof(b));
+  const __m128i v = _mm_cvtsi32_si128(b);
+  return _mm256_srlv_epi32(_mm256_cvtepu8_epi32(_mm_unpacklo_epi8(v, v)),
+                           _mm256_setr_epi32(4, 0, 4, 0, 4, 0, 4, 0));
+}
+
+AI_INTERNAL_API __attribute__((target("avx2,fma")))
+void func_dense_lut8_avx2(ai_float* out, const ai_float* in,
+                          const ai_u8* indices, const ai_float* lut,
+                          const ai_float* bias, const ai_size n_rows,
+                          const ai_size n_in, const ai_size n_out)
+{
+  const ai_size n_in_8 = n_in & ~(ai_size)7;
+
+  for ( ai_size r=0; r<n_rows; r++ ) {
+    const ai_float* in_row = in + r*n_in;
+    const ai_u8* w_row = indices;
+    for ( ai_size o=0; o<n_out; o++ ) {
+      __m256 acc = _mm256_setzero_ps();
+      for ( ai_size i=0; i<n_in_8; i+=8 ) {
+        const __m256i idx =
+          _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(w_row + i)));
+        acc = _mm256_fmadd_ps(_mm256_i32gather_ps(lut, idx, sizeof(ai_float)),
+                              _mm256_loadu_ps(in_row + i), acc);
+      }
+      ai_float s = dense_x86_hsum_256(acc);
+      ai_dict8_dot_array_f32(&s, w_row + n_in_8, AI_PTR_CONST(lut),
+                             in_row + n_in_8, n_in - n_in_8);
+      out[o] = ((bias) ? bias[o] : 0.0f) + s;
+      w_row += n_in;
+    }
+    out += n_out;
+  }
+}
+
+AI_INTERNAL_API __attribute__((target("avx2,fma")))
+void func_dense_lut4_avx2(ai_float* out, const ai_float* in,
+                          const ai_u8* indices, const ai_float* lut,
+                          const ai_float* bias, const ai_size n_rows,
+                          const ai_size n_in, const ai_size n_out)
+{
+  const ai_size n_in_8 = n_in & ~(ai_size)7;
+  const __m256 lut_lo = _mm256_loadu_ps(lut);
+  const __m256 lut_hi = _mm256_loadu_ps(lut + 8);
+
+  for ( ai_size r=0; r<n_rows; r++ ) {
+    const ai_float* in_row = in + r*n_in;
+    const ai_u8* w_row = indices;
+    for ( ai_size o=0; o<n_out; o++ ) {
+      __m256 acc = _mm256_setzero_ps();
+      for ( ai_size i=0; i<n_in_8; i+=8 ) {
+        const __m256i idx = dense_x86_nibbles_256(w_row + (i >> 1));
+        /* bit 3 of the index moved to the sign bit selects the table half */
+        const __m256 w = _mm256_blendv_ps(
+          _mm256_permutevar8x32_ps(lut_lo, idx),
+          _mm256_permutevar8x32_ps(lut_hi, idx),
+          _mm256_castsi256_ps(_mm256_slli_epi32(idx, 28)));
+        acc = _mm256_fmadd_ps(w, _mm256_loadu_ps(in_row + i), acc);
+      }
+      ai_float s = dense_x86_hsum_256(acc);
+      ai_dict4_dot_array_f32(&s, w_row + (n_in_8 >> 1), AI_PTR_CONST(lut),
+                             in_row + n_in_8, n_in - n_in_8);
+      out[o] = ((bias) ? bias[o] : 0.0f) + s;
+      w_row += AI_DENSE_LUT4_ROW_SIZE(n_in);
+    }
+    out += n_out;
+  }
+}
+
+/******************************************************************************/
+/* AVX-512F, codebook compressed weights                                      */
+/******************************************************************************/
+/* 16 nibbles of 8 bytes, see dense_x86_nibbles_256 */
+AI_DECLARE_STATIC __attribute__((target("avx512f")))
+__m512i dense_x86_nibbles_512(const ai_u8* p)
+{
+  const __m128i v = _mm_loadl_epi64((const __m128i*)p);
+  return _mm512_srlv_epi32(_mm512_cvtepu8_epi32(_mm_unpacklo_epi8(v, v)),
+                           _mm512_set1_epi64(4));
+}
+
+AI_INTERNAL_API __attribute__((target("avx512f")))
+void func_dense_lut8_avx512(ai_float* out, const ai_float* in,
+                            const ai_u8* indices, const ai_float* lut,
+                            const ai_float* bias, const ai_size n_rows,
+                            const ai_size n_in, const ai_size n_out)
+{
+  const ai_size n_in_16 = n_in & ~(ai_size)15;
+
+  for ( ai_size r=0; r<n_rows; r++ ) {
+    const ai_float* in_row = in + r*n_in;
+    const ai_u8* w_row = indices;
+    for ( ai_size o=0; o<n_out; o++ ) {
+      __m512 acc = _mm512_setzero_ps();
+      for ( ai_size i=0; i<n_in_16; i+=16 ) {
+        const __m512i idx =
+          _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i*)(w_row + i)));
+        acc = _mm512_fmadd_ps(_mm512_i32gather_ps(idx, lut, sizeof(ai_float)),
+                              _mm512_loadu_ps(in_row + i), acc);
+      }
+      ai_float s = _mm512_reduce_add_ps(acc);
+      ai_dict8_dot_array_f32(&s, w_row + n_in_16, AI_PTR_CONST(lut),
+                             in_row + n_in_16, n_in - n_in_16);
+      out[o] = ((bias) ? bias[o] : 0.0f) + s;
+      w_row += n_in;
+    }
+    out += n_out;
+  }
+}
+
+AI_INTERNAL_API __attribute__((target("avx512f")))
+void func_dense_lut4_avx512(ai_float* out, const ai_float* in,
+                            const ai_u8* indices, const ai_float* lut,
+                            const ai_float* bias, const ai_size n_rows,
+                            const ai_size n_in, const ai_size n_out)
+{
+  const ai_size n_in_16 = n_in & ~(ai_size)15;
+  const __m512 lut_v = _mm512_loadu_ps(lut);
+
+  for ( ai_size r=0; r<n_rows; r++ ) {
+    const ai_float* in_row = in + r*n_in;
+    const ai_u8* w_row = indices;
+    for ( ai_size o=0; o<n_out; o++ ) {
+      __m512 acc = _mm512_setzero_ps();
+      for ( ai_size i=0; i<n_in_16; i+=16 ) {
+        const __m512 w =
+          _mm512_permutexvar_ps(dense_x86_nibbles_512(w_row + (i >> 1)), lut_v);
+        acc = _mm512_fmadd_ps(w, _mm512_loadu_ps(in_row + i), acc);
+      }
+      ai_float s = _mm512_reduce_add_ps(acc);
+      ai_dict4_dot_array_f32(&s, w_row + (n_in_16 >> 1), AI_PTR_CONST(lut),
+                             in_row + n_in_16, n_in - n_in_16);
+      out[o] = ((bias) ? bias[o] : 0.0f) + s;
+      w_row += AI_DENSE_LUT4_ROW_SIZE(n_in);
+    }
+    out += n_out;
+  }
+}
+
+/******************************************************************************/
+/* AVX2, packed 4 bits integer weights                                        */
+/******************************************************************************/
+/* the 32 nibbles of 16 bytes in order (first one in the high nibble), as
+ * unsigned bytes: lo holds the nibbles 0..15, hi the nibbles 16..31 */
+AI_DECLARE_STATIC __attribute__((target("avx2")))
+void dense_x86_q4_split_128(__m128i* lo, __m128i* hi, const ai_u8* p,
+                            const __m128i flip)
+{
+  const __m128i mask = _mm_set1_epi8(0x0F);
+  const __m128i b = _mm_xor_si128(_mm_loadu_si128((const __m128i*)p), flip);
+  const __m128i n_hi = _mm_and_si128(_mm_srli_epi16(b, 4), mask);
+  const __m128i n_lo = _mm_and_si128(b, mask);
+  *lo = _mm_unpacklo_epi8(n_hi, n_lo);
+  *hi = _mm_unpackhi_epi8(n_hi, n_lo);
+}
+
+AI_DECLARE_STATIC __attribute__((target("avx2")))
+ai_i32 dense_x86_dot_q4_avx2(const ai_i8* in, const ai_u8* weights,
+                             const ai_i32 zp_in, const ai_i32 zp_w,
+                             const ai_size n_in, const ai_bool s4)
+{
+  const ai_size n_in_32 = n_in & ~(ai_size)31;
+  const __m128i flip = _mm_set1_epi8((s4) ? (char)0x88 : 0);
+  const __m256i zp_in_v = _mm256_set1_epi16((ai_i16)zp_in);
+  const __m256i zp_w_v = _mm256_set1_epi16((ai_i16)((s4) ? 8 : zp_w));
+  __m256i acc = _mm256_setzero_si256();
+
+  for ( ai_size i=0; i<n_in_32; i+=32 ) {
+    __m128i w_lo, w_hi;
+    dense_x86_q4_split_128(&w_lo, &w_hi, weights + (i >> 1), flip);
+    const __m256i x0 = _mm256_sub_epi16(
+      _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*)(in + i))), zp_in_v);
+    const __m256i x1 = _mm256_sub_epi16(
+      _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*)(in + i + 16))),
+      zp_in_v);
+    acc = _mm256_add_epi32(acc, _mm256_madd_epi16(x0,
+            _mm256_sub_epi16(_mm256_cvtepu8_epi16(w_lo), zp_w_v)));
+    acc = _mm256_add_epi32(acc, _mm256_madd_epi16(x1,
+            _mm256_sub_epi16(_mm256_cvtepu8_epi16(w_hi), zp_w_v)));
+  }
+
+  __m128i s = _mm_add_epi32(_mm256_castsi256_si128(acc),
+                            _mm256_extracti128_si256(acc, 1));
+  s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(1, 0, 3, 2)));
+  s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2, 3, 0, 1)));
+
+  const func_dense_dot_q4 tail =
+    (s4) ? func_dense_dot_s4_generic : func_dense_dot_u4_generic;
+  return _mm_cvtsi128_si32(s) +
+         tail(in + n_in_32, weights + (n_in_32 >> 1), zp_in, zp_w,
+              n_in - n_in_32);
+}
+
+AI_INTERNAL_API __attribute__((target("avx2")))
+ai_i32 func_dense_dot_s4_avx2(const ai_i8* in, const ai_u8* weights,
+                              const ai_i32 zp_in, const ai_i32 zp_w,
+                              const ai_size n_in)
+{
+  return dense_x86_dot_q4_avx2(in, weights, zp_in, zp_w, n_in, true);
+}
+
+AI_INTERNAL_API __attribute__((target("avx2")))
+ai_i32 func_dense_dot_u4_avx2(const ai_i8* in, const ai_u8* weights,
+                              const ai_i32 zp_in, const ai_i32 zp_w,
+                              const ai_size n_in)
+{
+  return dense_x86_dot_q4_avx2(in, weights, zp_in, zp_w, n_in, false);
+}
+
+/******************************************************************************/
+/* AVX-512BW, packed 4 bits integer weights                                   */
+/******************************************************************************/
+AI_DECLARE_STATIC __attribute__((target("avx512f,avx512bw")))
+ai_i32 dense_x86_dot_q4_avx512(const ai_i8* in, const ai_u8* weights,
+                               const ai_i32 zp_in, const ai_i32 zp_w,
+                               const ai_size n_in, const ai_bool s4)
+{
+  const ai_size n_in_32 = n_in & ~(ai_size)31;
+  const __m128i flip = _mm_set1_epi8((s4) ? (char)0x88 : 0);
+  const __m512i zp_in_v = _mm512_set1_epi16((ai_i16)zp_in);
+  const __m512i zp_w_v = _mm512_set1_epi16((ai_i16)((s4) ? 8 : zp_w));
+  __m512i acc = _mm512_setzero_si512();
+
+  for ( ai_size i=0; i<n_in_32; i+=32 ) {
+    __m128i w_lo, w_hi;
+    dense_x86_q4_split_128(&w_lo, &w_hi, weights + (i >> 1), flip);
+    const __m512i w = _mm512_sub_epi16(
+      _mm512_cvtepu8_epi16(_mm256_set_m128i(w_hi, w_lo)), zp_w_v);
+    const __m512i x = _mm512_sub_epi16(
+      _mm512_cvtepi8_epi16(_mm256_loadu_si256((const __m256i*)(in + i))),
+      zp_in_v);
+    acc = _mm512_add_epi32(acc, _mm512_madd_epi16(x, w));
+  }
+
+  const func_dense_dot_q4 tail =
+    (s4) ? func_dense_dot_s4_generic : func_dense_dot_u4_generic;
+  return _mm512_reduce_add_epi32(acc) +
+         tail(in + n_in_32, weights + (n_in_32 >> 1), zp_in, zp_w,
+              n_in - n_in_32);
+}
+
+AI_INTERNAL_API __attribute__((target("avx512f,avx512bw")))
+ai_i32 func_dense_dot_s4_avx512(const ai_i8* in, const ai_u8* weights,
+                                const ai_i32 zp_in, const ai_i32 zp_w,
+                                const ai_size n_in)
+{
+  return dense_x86_dot_q4_avx512(in, weights, zp_in, zp_w, n_in, true);
+}
+
+AI_INTERNAL_API __attribute__((target("avx512f,avx512bw")))
+ai_i32 func_dense_dot_u4_avx512(const ai_i8* in, const ai_u8* weights,
+                                const ai_i32 zp_in, const ai_i32 zp_w,
+                                const ai_size n_in)
+{
+  return dense_x86_dot_q4_avx512(in, weights, zp_in, zp_w, n_in, false);
+}
+
+/******************************************************************************/
+/* AVX2 / AVX-512BW, int8 weights                                             */
+/******************************************************************************/
+AI_INTERNAL_API __attribute__((target("avx2")))
+ai_i32 func_dense_dot_s8_avx2(const ai_i8* in, const ai_i8* weights,
+                              const ai_i32 zp_in, const ai_size n_in)
+{
+  const ai_size n_in_16 = n_in & ~(ai_size)15;
+  const __m256i zp_in_v = _mm256_set1_epi16((ai_i16)zp_in);
+  __m256i acc = _mm256_setzero_si256();
+
+  for ( ai_size i=0; i<n_in_16; i+=16 ) {
+    const __m256i x = _mm256_sub_epi16(
+      _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*)(in + i))), zp_in_v);
+    const __m256i w =
+      _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*)(weights + i)));
+    acc = _mm256_add_epi32(acc, _mm256_madd_epi16(x, w));
+  }
+
+  __m128i s = _mm_add_epi32(_mm256_castsi256_si128(acc),
+                            _mm256_extracti128_si256(acc, 1));
+  s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(1, 0, 3, 2)));
+  s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2, 3, 0, 1)));
+
+  return _mm_cvtsi128_si32(s) +
+         func_dense_dot_s8_generic(in + n_in_16, weights + n_in_16, zp_in,
+                                   n_in - n_in_16);
+}
+
+AI_INTERNAL_API __attribute__((target("avx512f,avx512bw")))
+ai_i32 func_dense_dot_s8_avx512(const ai_i8* in, const ai_i8* weights,
+                                const ai_i32 zp_in, const ai_size n_in)
+{
+  const ai_size n_in_32 = n_in & ~(ai_size)31;
+  const __m512i zp_in_v = _mm512_set1_epi16((ai_i16)zp_in);
+  __m512i acc = _mm512_setzero_si512();
+
+  for ( ai_size i=0; i<n_in_32; i+=32 ) {
+    const __m512i x = _mm512_sub_epi16(
+      _mm512_cvtepi8_epi16(_mm256_loadu_si256((const __m256i*)(in + i))),
+      zp_in_v);
+    const __m512i w =
+      _mm512_cvtepi8_epi16(_mm256_loadu_si256((const __m256i*)(weights + i)));
+    acc = _mm512_add_epi32(acc, _mm512_madd_epi16(x, w));
+  }
+
+  return _mm512_reduce_add_epi32(acc) +
+         func_dense_dot_s8_generic(in + n_in_32, weights + n_in_32, zp_in,
+                                   n_in - n_in_32);
+}
+
+/******************************************************************************/
+/* AVX2 + FMA, block sparse weights                                           */
+/******************************************************************************/
+/* lanes below n set (n in [0, 8]) for the masked loads / stores */
+AI_DECLARE_STATIC __attribute__((target("avx2,fma")))
+__m256i dense_x86_mask_256(const ai_size n)
+{
+  return _mm256_cmpgt_epi32(_mm256_set1_epi32((ai_i32)n),
+                            _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+}
+
+AI_INTERNAL_API __attribute__((target("avx2,fma")))
+void func_dense_bsr_avx2(ai_float* out, const ai_float* in,
+                         const ai_float* values, const ai_u32* index,
+                         const ai_float* bias, const ai_size n_rows,
+                         const ai_size n_in, const ai_size n_out)
+{
+  const ai_size n_groups = AI_DENSE_BSR_GROUPS(n_out);
+  const ai_u32* columns = index + n_groups + 1;
+
+  for ( ai_size r=0; r<n_rows; r++ ) {
+    const ai_float* in_row = in + r*n_in;
+    for ( ai_size g=0; g<n_groups; g++ ) {
+      const ai_size o = g*AI_DENSE_BSR_BLOCK;
+      const __m256i mask = dense_x86_mask_256(n_out - o);
+      __m256 acc0 = (bias) ? _mm256_maskload_ps(bias + o, mask)
+                           : _mm256_setzero_ps();
+      __m256 acc1 = _mm256_setzero_ps();
+      ai_u32 k = index[g];
+      for ( ; k+2<=index[g+1]; k+=2 ) {
+        acc0 = _mm256_fmadd_ps(_mm256_set1_ps(in_row[columns[k]]),
+                               _mm256_loadu_ps(values + k*AI_DENSE_BSR_BLOCK),
+                               acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_set1_ps(in_row[columns[k+1]]),
+                               _mm256_loadu_ps(values + (k+1)*AI_DENSE_BSR_BLOCK),
+                               acc1);
+      }
+      if ( k<index[g+1] ) {
+        acc0 = _mm256_fmadd_ps(_mm256_set1_ps(in_row[columns[k]]),
+                               _mm256_loadu_ps(values + k*AI_DENSE_BSR_BLOCK),
+                               acc0);
+      }
+      _mm256_maskstore_ps(out + o, mask, _mm256_add_ps(acc0, acc1));
+    }
+    out += n_out;
+  }
+}
+
+/******************************************************************************/
+/* AVX-512F, block sparse weights                                             */
+/******************************************************************************/
+/* a 256 bits vector in both halves */
+AI_DECLARE_STATIC __attribute__((target("avx512f")))
+__m512 dense_x86_dup_512(const __m256 v)
+{
+  const __m256d d = _mm256_castps_pd(v);
+  return _mm512_castpd_ps(_mm512_insertf64x4(_mm512_castpd256_pd512(d), d, 1));
+}
+
+AI_INTERNAL_API __attribute__((target("avx512f")))
+void func_dense_bsr_avx512(ai_float* out, const ai_float* in,
+                           const ai_float* values, const ai_u32* index,
+                           const ai_float* bias, const ai_size n_rows,
+                           const ai_size n_in, const ai_size n_out)
+{
+  const ai_size n_groups = AI_DENSE_BSR_GROUPS(n_out);
+  const ai_u32* columns = index + n_groups + 1;
+
+  for ( ai_size r=0; r<n_rows; r+=2 ) {
+    /* an odd last row is computed twice, stored once */
+    const ai_bool pair = (r+1<n_rows);
+    const ai_float* in_0 = in + r*n_in;
+    const ai_float* in_1 = (pair) ? in_0 + n_in : in_0;
+    ai_float* out_0 = out + r*n_out;
+    for ( ai_size g=0; g<n_groups; g++ ) {
+      const ai_size o = g*AI_DENSE_BSR_BLOCK;
+      const __m256i mask = dense_x86_mask_256(n_out - o);
+      __m512 acc = (bias) ? dense_x86_dup_512(_mm256_maskload_ps(bias + o, mask))
+                          : _mm512_setzero_ps();
+      for ( ai_u32 k=index[g]; k<index[g+1]; k++ ) {
+        const ai_u32 c = columns[k];
+        const __m512 x = _mm512_mask_broadcastss_ps(_mm512_set1_ps(in_0[c]),
+                                                    0xFF00, _mm_set_ss(in_1[c]));
+        acc = _mm512_fmadd_ps(x, dense_x86_dup_512(
+                _mm256_loadu_ps(values + k*AI_DENSE_BSR_BLOCK)), acc);
+      }
+      _mm256_maskstore_ps(out_0 + o, mask, _mm512_castps512_ps256(acc));
+      if ( pair ) {
+        _mm256_maskstore_ps(out_0 + n_out + o, mask, _mm256_castpd_ps(
+          _mm512_extractf64x4_pd(_mm512_castps_pd(acc), 1)));
+      }
+    }
+  }
+}
+
+/******************************************************************************/
+/* AVX2 + FMA, transposed weights GEMM                                        */
+/******************************************************************************/
+#define AI_DENSE_X86_GEMM_ROWS      (4)
+
+/* inputs of a pass: the weights strip of a pass stays in the L1 cache while
+ * all the rows are processed */
+#define AI_DENSE_X86_GEMM_DEPTH     (128)
+
+/* n_r rows (1 or AI_DENSE_X86_GEMM_ROWS) x outputs [o, o + 16) of the GEMM
+ * for the inputs [i0, i0 + n_i): the first pass starts from the bias, the
+ * next ones from the outputs. The outputs from n_out are masked unless full */
+AI_DECLARE_STATIC __attribute__((target("avx2,fma"), always_inline))
+void dense_x86_gemm_block_avx2(ai_float* out, const ai_float* in,
+                               const ai_float* weights, const ai_float* bias,
+                               const ai_size n_r, const ai_size n_in,
+                               const ai_size n_out, const ai_size o,
+                               const ai_size i0, const ai_size n_i,
+                               const ai_bool full)
+{
+  const __m256i mask0 = dense_x86_mask_256(AI_MIN(n_out - o, 8));
+  const __m256i mask1 = dense_x86_mask_256((n_out - o>8) ? AI_MIN(n_out - o - 8, 8) : 0);
+  __m256 acc[AI_DENSE_X86_GEMM_ROWS][2];
+  for ( ai_size r=0; r<n_r; r++ ) {
+    const ai_float* src = (i0>0) ? out + r*n_out + o : bias + o;
+    if ( (i0==0) && !bias ) {
+      acc[r][0] = _mm256_setzero_ps();
+      acc[r][1] = _mm256_setzero_ps();
+    } else if ( full ) {
+      acc[r][0] = _mm256_loadu_ps(src);
+      acc[r][1] = _mm256_loadu_ps(src + 8);
+    } else {
+      acc[r][0] = _mm256_maskload_ps(src, mask0);
+      acc[r][1] = _mm256_maskload_ps(src + 8, mask1);
+    }
+  }
+
+  const ai_float* w = weights + i0*n_out + o;
+  for ( ai_size i=i0; i<i0+n_i; i++, w+=n_out ) {
+    const __m256 w0 = (full) ? _mm256_loadu_ps(w) : _mm256_maskload_ps(w, mask0);
+    const __m256 w1 = (full) ? _mm256_loadu_ps(w + 8) : _mm256_maskload_ps(w + 8, mask1);
+    for ( ai_size r=0; r<n_r; r++ ) {
+      const __m256 x = _mm256_broadcast_ss(in + r*n_in + i);
+      acc[r][0] = _mm256_fmadd_ps(x, w0, acc[r][0]);
+      acc[r][1] = _mm256_fmadd_ps(x, w1, acc[r][1]);
+    }
+  }
+
+  for ( ai_size r=0; r<n_r; r++ ) {
+    if ( full ) {
+      _mm256_storeu_ps(out + r*n_out + o, acc[r][0]);
+      _mm256_storeu_ps(out + r*n_out + o + 8, acc[r][1]);
+    } else {
+      _mm256_maskstore_ps(out + r*n_out + o, mask0, acc[r][0]);
+      _mm256_maskstore_ps(out + r*n_out + o + 8, mask1, acc[r][1]);
+    }
+  }
+}
+
+/* all the rows x outputs [o, o + 16) for the inputs [i0, i0 + n_i) */
+AI_DECLARE_STATIC __attribute__((target("avx2,fma"), always_inline))
+void dense_x86_gemm_strip_avx2(ai_float* out, const ai_float* in,
+                               const ai_float* weights, const ai_float* bias,
+                               const ai_size n_rows, const ai_size n_in,
+                               const ai_size n_out, const ai_size o,
+                               const ai_size i0, const ai_size n_i,
+                               const ai_bool full)
+{
+  ai_size r = 0;
+  for ( ; r+AI_DENSE_X86_GEMM_ROWS<=n_rows; r+=AI_DENSE_X86_GEMM_ROWS ) {
+    dense_x86_gemm_block_avx2(out + r*n_out, in + r*n_in, weights, bias,
+                              AI_DENSE_X86_GEMM_ROWS, n_in, n_out, o, i0, n_i,
+                              full);
+  }
+  for ( ; r<n_rows; r++ ) {
+    dense_x86_gemm_block_avx2(out + r*n_out, in + r*n_in, weights, bias,
+                              1, n_in, n_out, o, i0, n_i, full);
+  }
+}
+
+AI_INTERNAL_API __attribute__((target("avx2,fma")))
+void func_dense_gemm_avx2(ai_float* out, const ai_float* in,
+                          const ai_float* weights, const ai_float* bias,
+                          const ai_size n_rows, const ai_size n_in,
+                          const ai_size n_out)
+{
+  /* at least one pass: with n_in==0 the outputs are the bias (or 0), as
+   * with the generic kernel */
+  ai_size i0 = 0;
+  do {
+    const ai_size n_i = AI_MIN(AI_DENSE_X86_GEMM_DEPTH, n_in - i0);
+    ai_size o = 0;
+    for ( ; o+16<=n_out; o+=16 ) {
+      dense_x86_gemm_strip_avx2(out, in, weights, bias, n_rows, n_in, n_out,
+                                o, i0, n_i, true);
+    }
+    if ( o<n_out ) {
+      dense_x86_gemm_strip_avx2(out, in, weights, bias, n_rows, n_in, n_out,
+                                o, i0, n_i, false);
+    }
+    i0 += AI_DENSE_X86_GEMM_DEPTH;
+  } while ( i0<n_in );
+}
+
+/******************************************************************************/
+/* AVX-512F, transposed weights GEMM                                          */
+/******************************************************************************/
+/* lanes below n set (n in [0, 16]) */
+#define AI_DENSE_X86_MASK_512(n_) \
+  ((__mmask16)((1U << (n_)) - 1U))
+
+/* n_r rows x outputs [o, o + 32) of the GEMM for the inputs [i0, i0 + n_i),
+ * see dense_x86_gemm_block_avx2 */
+AI_DECLARE_STATIC __attribute__((target("avx512f"), always_inline))
+void dense_x86_gemm_block_avx512(ai_float* out, const ai_float* in,
+                                 const ai_float* weights, const ai_float* bias,
+                                 const ai_size n_r, const ai_size n_in,
+                                 const ai_size n_out, const ai_size o,
+                                 const ai_size i0, const ai_size n_i,
+                                 const ai_bool full)
+{
+  const __mmask16 mask0 = AI_DENSE_X86_MASK_512(AI_MIN(n_out - o, 16));
+  const __mmask16 mask1 =
+    AI_DENSE_X86_MASK_512((n_out - o>16) ? AI_MIN(n_out - o - 16, 16) : 0);
+  __m512 acc[AI_DENSE_X86_GEMM_ROWS][2];
+  for ( ai_size r=0; r<n_r; r++ ) {
+    const ai_float* src = (i0>0) ? out + r*n_out + o : bias + o;
+    if ( (i0==0) && !bias ) {
+      acc[r][0] = _mm512_setzero_ps();
+      acc[r][1] = _mm512_setzero_ps();
+    } else if ( full ) {
+      acc[r][0] = _mm512_loadu_ps(src);
+      acc[r][1] = _mm512_loadu_ps(src + 16);
+    } else {
+      acc[r][0] = _mm512_maskz_loadu_ps(mask0, src);
+      acc[r][1] = _mm512_maskz_loadu_ps(mask1, src + 16);
+    }
+  }
+
+  const ai_float* w = weights + i0*n_out + o;
+  for ( ai_size i=i0; i<i0+n_i; i++, w+=n_out ) {
+    const __m512 w0 = (full) ? _mm512_loadu_ps(w) : _mm512_maskz_loadu_ps(mask0, w);
+    const __m512 w1 = (full) ? _mm512_loadu_ps(w + 16) : _mm512_maskz_loadu_ps(mask1, w + 16);
+    for ( ai_size r=0; r<n_r; r++ ) {
+      const __m512 x = _mm512_set1_ps(in[r*n_in + i]);
+      acc[r][0] = _mm512_fmadd_ps(x, w0, acc[r][0]);
+      acc[r][1] = _mm512_fmadd_ps(x, w1, acc[r][1]);
+    }
+  }
+
+  for ( ai_size r=0; r<n_r; r++ ) {
+    if ( full ) {
+      _mm512_storeu_ps(out + r*n_out + o, acc[r][0]);
+      _mm512_storeu_ps(out + r*n_out + o + 16, acc[r][1]);
+    } else {
+      _mm512_mask_storeu_ps(out + r*n_out + o, mask0, acc[r][0]);
+      _mm512_mask_storeu_ps(out + r*n_out + o + 16, mask1, acc[r][1]);
+    }
+  }
+}
+
+AI_DECLARE_STATIC __attribute__((target("avx512f"), always_inline))
+void dense_x86_gemm_strip_avx512(ai_float* out, const ai_float* in,
+                                 const ai_float* weights, const ai_float* bias,
+                                 const ai_size n_rows, const ai_size n_in,
+                                 const ai_size n_out, const ai_size o,
+                                 const ai_size i0, const ai_size n_i,
+                                 const ai_bool full)
+{
+  ai_size r = 0;
+  for ( ; r+AI_DENSE_X86_GEMM_ROWS<=n_rows; r+=AI_DENSE_X86_GEMM_ROWS ) {
+    dense_x86_gemm_block_avx512(out + r*n_out, in + r*n_in, weights, bias,
+                                AI_DENSE_X86_GEMM_ROWS, n_in, n_out, o, i0, n_i,
+                                full);
+  }
+  for ( ; r<n_rows; r++ ) {
+    dense_x86_gemm_block_avx512(out + r*n_out, in + r*n_in, weights, bias,
+                                1, n_in, n_out, o, i0, n_i, full);
+  }
+}
+
+AI_INTERNAL_API __attribute__((target("avx512f")))
+void func_dense_gemm_avx512(ai_float* out, const ai_float* in,
+                            const ai_float* weights, const ai_float* bias,
+                            const ai_size n_rows, const ai_size n_in,
+                            const ai_size n_out)
+{
+  /* at least one pass: with n_in==0 the outputs are the bias (or 0), as
+   * with the generic kernel */
+  ai_size i0 = 0;
+  do {
+    const ai_size n_i = AI_MIN(AI_DENSE_X86_GEMM_DEPTH, n_in - i0);
+    ai_size o = 0;
+    for ( ; o+32<=n_out; o+=32 ) {
+      dense_x86_gemm_strip_avx512(out, in, weights, bias, n_rows, n_in, n_out,
+                                  o, i0, n_i, true);
+    }
+    if ( o<n_out ) {
+      dense_x86_gemm_strip_avx512(out, in, weights, bias, n_rows, n_in, n_out,
+                                  o, i0, n_i, false);
+    }
+    i0 += AI_DENSE_X86_GEMM_DEPTH;
+  } while ( i0<n_in );
+}
+
+#endif    /* __x86_64__ || __i386__ */
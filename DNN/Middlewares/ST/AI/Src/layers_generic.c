@@ -0,0 +1,87 @@
+/**
+  ******************************************************************************
+  * @file    layers_generic.c
+  * @brief   implementation of the generic (elementwise) layers
+  ******************************************************************************
+  * @attention
+  *
+  * Open implementation of the float elementwise layers declared in
+  * layers_generic.h. The operands are broadcast by repetition: an input
+  * smaller than the output (scalar, per-channel vector or one sample of a
+  * batch) is read modulo its size. Each output element is written after the
+  * operands at its position are read, so the output may alias any input of
+  * the same size (in-place execution, see core_plan).
+  *
+  ******************************************************************************
+  */
+
+#include "layers_generic.h"
+#include "ai_math_helpers.h"
+
+/*!
+ * @brief check that the operand sizes divide the output size (broadcast)
+ */
+AI_DECLARE_STATIC
+ai_bool generic_check_broadcast(ai_layer* layer, const ai_size out_size)
+{
+  const ai_tensor_list* list = GET_TENSOR_LIST_IN(layer->tensors);
+  AI_FOR_EACH_TENSOR_LIST_DO(i, t, list) {
+    const ai_size size = AI_ARRAY_OBJ_SIZE(t->data);
+    if ( (size==0) || (out_size % size) ) {
+      AI_ERROR_TRAP(layer->network, INVALID_PARAM, INVALID_SIZE);
+      return false;
+    }
+  }
+  return true;
+}
+
+/******************************************************************************/
+AI_INTERNAL_API
+void forward_eltwise(ai_layer* layer)
+{
+  const ai_layer_eltwise* l = (const ai_layer_eltwise*)layer;
+  const ai_tensor* in0 = GET_TENSOR_IN(l->tensors, 0);
+  const ai_tensor* in1 = GET_TENSOR_IN(l->tensors, 1);
+  ai_tensor* output = GET_TENSOR_OUT(l->tensors, 0);
+
+  const ai_size size = AI_ARRAY_OBJ_SIZE(output->data);
+  if ( !l->operation || !generic_check_broadcast(layer, size) ) return;
+
+  const ai_size n0 = AI_ARRAY_OBJ_SIZE(in0->data);
+  const ai_size n1 = AI_ARRAY_OBJ_SIZE(in1->data);
+  const ai_float* a = AI_ARRAY_OBJ_DATA(in0->data, ai_float);
+  const ai_float* b = AI_ARRAY_OBJ_DATA(in1->data, ai_float);
+  ai_float* out = AI_ARRAY_OBJ_DATA(output->data, ai_float);
+
+  if ( (n0==size) && (n1==size) ) {
+    for ( ai_size i=0; i<size; i++ ) out[i] = l->operation(a[i], b[i]);
+    return;
+  }
+  for ( ai_size i=0, i0=0, i1=0; i<size; i++ ) {
+    out[i] = l->operation(a[i0], b[i1]);
+    if ( ++i0==n0 ) i0 = 0;
+    if ( ++i1==n1 ) i1 = 0;
+  }
+}
+
+AI_INTERNAL_API
+void forward_add(ai_layer* layer)
+{
+  const ai_tensor_list* list = GET_TENSOR_LIST_IN(layer->tensors);
+  ai_tensor* output = GET_TENSOR_OUT(layer->tensors, 0);
+
+  const ai_size size = AI_ARRAY_OBJ_SIZE(output->data);
+  if ( !generic_check_broadcast(layer, size) ) return;
+
+  ai_float* out = AI_ARRAY_OBJ_DATA(output->data, ai_float);
+
+  /* out = in0 + in1 + ... : all the operands are read before out[i] is
+   * written, whichever input out aliases */
+  for ( ai_size i=0; i<size; i++ ) {
+    ai_float acc = 0.0f;
+    AI_FOR_EACH_TENSOR_LIST_DO(k, t, list) {
+      acc += AI_ARRAY_OBJ_DATA(t->data, ai_float)[i % AI_ARRAY_OBJ_SIZE(t->data)];
+    }
+    out[i] = acc;
+  }
+}
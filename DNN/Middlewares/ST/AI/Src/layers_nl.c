@@ -0,0 +1,235 @@
+/**
+  ******************************************************************************
+  * @file    layers_nl.c
+  * @brief   implementation of the float nonlinearity layers
+  ******************************************************************************
+  * @attention
+  *
+  * Open implementation of the pointwise float nonlinearities declared in
+  * layers_nl.h. Each output element only depends on the input element at
+  * the same position and is written after it is read: the kernels are safe
+  * when the output array aliases the input one (in-place execution, see
+  * core_plan). The channel-wise functions (softmax, hardmax) are not part
+  * of this set.
+  *
+  * The float softmax reads each channel twice: a single pass computes the
+  * maximum and the sum of the exp(x - max) together (the sum is rescaled
+  * when the maximum increases), the second one writes exp(x - max) / sum.
+  * It is in-place safe as well.
+  *
+  * exp, log, tanh, sigmoid and erf are the core_math array functions: the
+  * accuracy tier (libm, 2 ULP, or 1e-4 absolute / relative for exp) is
+  * selected there, see core_math.h.
+  * elu, selu and soft_plus compute exp(x) by chunks of AI_NL_EXP_CHUNK
+  * values in a stack buffer.
+  *
+  * The optional parameters are read from the nl_params array of the layer:
+  *  - elu: alpha (default 1)
+  *  - selu: alpha, gamma (default 1.67326, 1.0507)
+  *  - relu_thresholded: threshold (default 1)
+  *  - clip: min, max
+  *
+  ******************************************************************************
+  */
+
+#include "layers_nl.h"
+#include "core_math.h"
+#include "ai_math_helpers.h"
+
+/*!
+ * @brief define the float array function nl_func_<name_>_array_f32 computing
+ * expr_ on each element x (p_ is the float parameters array, may be NULL)
+ */
+#define AI_NL_FUNC_ARRAY_F32(name_, p_, expr_) \
+AI_INTERNAL_API \
+void nl_func_ ## name_ ## _array_f32(ai_array *out, const ai_array *in, \
+                                     const ai_size size, const ai_handle params) \
+{ \
+  const ai_float* p_ = (const ai_float*)params; \
+  const ai_float* in_ptr = AI_ARRAY_OBJ_DATA(in, ai_float); \
+  ai_float* out_ptr = AI_ARRAY_OBJ_DATA(out, ai_float); \
+  AI_UNUSED(p_) \
+  for ( ai_size i=0; i<size; i++ ) { \
+    const ai_float x = in_ptr[i]; \
+    out_ptr[i] = (expr_); \
+  } \
+}
+
+/*!
+ * @brief define the float array function nl_func_<name_>_array_f32 as the
+ * core_math array function core_
+ */
+#define AI_NL_FUNC_ARRAY_F32_MATH(name_, core_) \
+AI_INTERNAL_API \
+void nl_func_ ## name_ ## _array_f32(ai_array *out, const ai_array *in, \
+                                     const ai_size size, const ai_handle params) \
+{ \
+  AI_UNUSED(params) \
+  core_(AI_ARRAY_OBJ_DATA(out, ai_float), AI_ARRAY_OBJ_DATA(in, ai_float), size); \
+}
+
+/*!
+ * @brief define the float array function nl_func_<name_>_array_f32 computing
+ * expr_ on each element x, ex being exp(x)
+ */
+#define AI_NL_FUNC_ARRAY_F32_EXP(name_, p_, expr_) \
+AI_INTERNAL_API \
+void nl_func_ ## name_ ## _array_f32(ai_array *out, const ai_array *in, \
+                                     const ai_size size, const ai_handle params) \
+{ \
+  const ai_float* p_ = (const ai_float*)params; \
+  const ai_float* in_ptr = AI_ARRAY_OBJ_DATA(in, ai_float); \
+  ai_float* out_ptr = AI_ARRAY_OBJ_DATA(out, ai_float); \
+  ai_float ex_chunk[AI_NL_EXP_CHUNK]; \
+  AI_UNUSED(p_) \
+  for ( ai_size c=0; c<size; c+=AI_NL_EXP_CHUNK ) { \
+    const ai_size n = AI_MIN(size - c, AI_NL_EXP_CHUNK); \
+    core_math_exp_array_f32(ex_chunk, in_ptr + c, n); \
+    for ( ai_size i=0; i<n; i++ ) { \
+      const ai_float x = in_ptr[c + i]; \
+      const ai_float ex = ex_chunk[i]; \
+      out_ptr[c + i] = (expr_); \
+    } \
+  } \
+}
+
+#define AI_NL_PARAM(p_, idx_, default_) \
+  ( (p_) ? (p_)[idx_] : (default_) )
+
+/******************************************************************************/
+AI_NL_FUNC_ARRAY_F32(relu, p, AI_MATH_RELU(x))
+AI_NL_FUNC_ARRAY_F32(relu_thresholded, p,
+  (x > AI_NL_PARAM(p, 0, 1.0f)) ? x : 0.0f)
+AI_NL_FUNC_ARRAY_F32_EXP(elu, p,
+  (x > 0.0f) ? x : AI_NL_PARAM(p, 0, 1.0f) * (ex - 1.0f))
+AI_NL_FUNC_ARRAY_F32_EXP(selu, p,
+  AI_NL_PARAM(p, 1, 1.0507009873554805f) *
+  ((x > 0.0f) ? x : AI_NL_PARAM(p, 0, 1.6732632423543772f) * (ex - 1.0f)))
+AI_NL_FUNC_ARRAY_F32(clip, p, AI_CLAMP(x, p[0], p[1]))
+AI_NL_FUNC_ARRAY_F32_MATH(sigmoid, core_math_sigmoid_array_f32)
+AI_NL_FUNC_ARRAY_F32(hard_sigmoid, p, ai_math_hard_sigmoid(x))
+AI_NL_FUNC_ARRAY_F32_MATH(tanh, core_math_tanh_array_f32)
+AI_NL_FUNC_ARRAY_F32(sign, p, ai_math_sign(x))
+AI_NL_FUNC_ARRAY_F32(abs, p, fabsf(x))
+AI_NL_FUNC_ARRAY_F32(neg, p, -x)
+AI_NL_FUNC_ARRAY_F32_MATH(exp, core_math_exp_array_f32)
+AI_NL_FUNC_ARRAY_F32_MATH(log, core_math_log_array_f32)
+AI_NL_FUNC_ARRAY_F32_MATH(erf, core_math_erf_array_f32)
+AI_NL_FUNC_ARRAY_F32(sqrt, p, AI_MATH_SQRT(x))
+AI_NL_FUNC_ARRAY_F32(rsqrt, p, 1.0f / AI_MATH_SQRT(x))
+AI_NL_FUNC_ARRAY_F32(reciprocal, p, 1.0f / x)
+AI_NL_FUNC_ARRAY_F32(soft_sign, p, x / (1.0f + fabsf(x)))
+AI_NL_FUNC_ARRAY_F32(floor, p, floorf(x))
+AI_NL_FUNC_ARRAY_F32(ceil, p, ceilf(x))
+AI_NL_FUNC_ARRAY_F32(round, p, roundf(x))
+
+AI_INTERNAL_API
+void nl_func_soft_plus_array_f32(ai_array *out, const ai_array *in,
+                                 const ai_size size, const ai_handle params)
+{
+  const ai_float* in_ptr = AI_ARRAY_OBJ_DATA(in, ai_float);
+  ai_float* out_ptr = AI_ARRAY_OBJ_DATA(out, ai_float);
+  ai_float ex_chunk[AI_NL_EXP_CHUNK];
+  AI_UNUSED(params)
+  /* log(1 + exp(x)) */
+  for ( ai_size c=0; c<size; c+=AI_NL_EXP_CHUNK ) {
+    const ai_size n = AI_MIN(size - c, AI_NL_EXP_CHUNK);
+    core_math_exp_array_f32(ex_chunk, in_ptr + c, n);
+    for ( ai_size i=0; i<n; i++ ) ex_chunk[i] += 1.0f;
+    core_math_log_array_f32(out_ptr + c, ex_chunk, n);
+  }
+}
+
+/******************************************************************************/
+/*!
+ * @brief apply a pointwise function on the whole (batched) input of a layer
+ */
+AI_DECLARE_STATIC
+void nl_forward_f32(ai_layer* layer, func_nl func)
+{
+  const ai_layer_nl* l = (const ai_layer_nl*)layer;
+  const ai_tensor* input = GET_TENSOR_IN(l->tensors, 0);
+  ai_tensor* output = GET_TENSOR_OUT(l->tensors, 0);
+  const ai_handle params =
+    (l->nl_params) ? AI_ARRAY_OBJ_DATA(l->nl_params, void) : NULL;
+
+  func(output->data, input->data, AI_ARRAY_OBJ_SIZE(output->data), params);
+}
+
+#define AI_NL_FORWARD_F32(name_) \
+AI_INTERNAL_API \
+void forward_ ## name_(ai_layer* layer) \
+{ \
+  nl_forward_f32(layer, nl_func_ ## name_ ## _array_f32); \
+}
+
+AI_NL_FORWARD_F32(relu)
+AI_NL_FORWARD_F32(relu_thresholded)
+AI_NL_FORWARD_F32(elu)
+AI_NL_FORWARD_F32(selu)
+AI_NL_FORWARD_F32(clip)
+AI_NL_FORWARD_F32(sigmoid)
+AI_NL_FORWARD_F32(hard_sigmoid)
+AI_NL_FORWARD_F32(tanh)
+AI_NL_FORWARD_F32(sign)
+AI_NL_FORWARD_F32(abs)
+AI_NL_FORWARD_F32(neg)
+AI_NL_FORWARD_F32(exp)
+AI_NL_FORWARD_F32(log)
+AI_NL_FORWARD_F32(erf)
+AI_NL_FORWARD_F32(sqrt)
+AI_NL_FORWARD_F32(rsqrt)
+AI_NL_FORWARD_F32(reciprocal)
+AI_NL_FORWARD_F32(soft_plus)
+AI_NL_FORWARD_F32(soft_sign)
+AI_NL_FORWARD_F32(floor)
+AI_NL_FORWARD_F32(ceil)
+AI_NL_FORWARD_F32(round)
+
+/******************************************************************************/
+AI_INTERNAL_API
+void nl_func_sm_channel_f32(ai_array *out, const ai_array *in,
+                            const ai_size channel_size, const ai_handle params)
+{
+  const ai_float* in_ptr = AI_ARRAY_OBJ_DATA(in, ai_float);
+  ai_float* out_ptr = AI_ARRAY_OBJ_DATA(out, ai_float);
+  ai_float max;
+  AI_UNUSED(params)
+  if ( channel_size==0 ) return;
+
+  const ai_float sum = core_math_max_exp_sum_f32(in_ptr, channel_size, &max);
+  core_math_exp_scale_array_f32(out_ptr, in_ptr, channel_size,
+                                max, 1.0f / sum);
+}
+
+AI_INTERNAL_API
+void nl_func_sm_array_f32(ai_array *out, ai_array *in,
+                          const ai_size in_size,
+                          const ai_size channel_size,
+                          const ai_size in_channel_step,
+                          const ai_size out_channel_step)
+{
+  /* channel views on the in/out arrays */
+  ai_array in_ch = *in;
+  ai_array out_ch = *out;
+  if ( channel_size==0 ) return;
+
+  for ( ai_size i=0; i<in_size; i+=channel_size ) {
+    nl_func_sm_channel_f32(&out_ch, &in_ch, channel_size, NULL);
+    in_ch.data += in_channel_step * sizeof(ai_float);
+    out_ch.data += out_channel_step * sizeof(ai_float);
+  }
+}
+
+AI_INTERNAL_API
+void forward_sm(ai_layer* layer)
+{
+  const ai_layer_nl* l = (const ai_layer_nl*)layer;
+  ai_tensor* input = GET_TENSOR_IN(l->tensors, 0);
+  ai_tensor* output = GET_TENSOR_OUT(l->tensors, 0);
+  const ai_size channel_size = AI_SHAPE_CH(AI_TENSOR_SHAPE(input));
+
+  nl_func_sm_array_f32(output->data, input->data,
+                       AI_ARRAY_OBJ_SIZE(input->data),
+                       channel_size, channel_size, channel_size);
+}
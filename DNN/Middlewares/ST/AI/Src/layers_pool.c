@@ -0,0 +1,913 @@
+/**
+  ******************************************************************************
+  * @file    layers_pool.c
+  * @brief   implementation of the pooling layers
+  ******************************************************************************
+  * @attention
+  *
+  * Open implementation of the float and 8-bits integer (INT8 / UINT8)
+  * pooling functions and layers declared in layers_pool.h. Activations are
+  * stored as [h][w][ch]; padding_x and padding_y are the padding of the
+  * first column/row, the last ones are implied by the output size. The
+  * padded positions are skipped: they do not contribute to the max, and are
+  * not counted by the average (unless count_include_pad is set on an average
+  * pooling layer, the divisor being then the window size).
+  *
+  * The channels of a pixel being contiguous, they are processed in the SIMD
+  * lanes (AVX2, AVX-512 when available, see core_cpu.h):
+  *  - the windows of up to AI_POOL_WINDOW_MAX_REG positions (2x2 and 3x3
+  *    pools, and their clipped borders) are reduced in registers, each block
+  *    of channels being read once per window position and written once,
+  *  - the larger windows (global pooling) are reduced in a single pass over
+  *    their rows, the window rows of a global pooling being contiguous: the
+  *    float outputs are the accumulators, the integer ones are accumulated
+  *    in int32 by chunks of AI_POOL_ACC_CHUNK channels.
+  * The integer average is computed from int32 sums, requantized to the
+  * output and rounded half away from zero (as AI_ROUND) once.
+  *
+  * The 8/16-bits fixed point pooling (forward_mp_fixed, forward_ap_fixed)
+  * and the integer one of forward_mp_integer / forward_ap_integer read the
+  * element types from the tensors; the pool_func_*_array_fixed and
+  * pool_func_*_array_integer functions get the arrays (ai_array*) for the
+  * same reason.
+  *
+  ******************************************************************************
+  */
+
+#include <string.h>
+
+#include "layers_pool.h"
+#include "ai_math_helpers.h"
+#include "core_cpu.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+/*!
+ * @struct ai_pool_geometry
+ * @brief shapes, window, strides and pads of a pooling
+ */
+typedef struct {
+  ai_i32 in_x, in_y, ch;
+  ai_i32 k_x, k_y;
+  ai_i32 pad_x, pad_y;
+  ai_i32 stride_x, stride_y;
+  ai_i32 out_x, out_y;
+} ai_pool_geometry;
+
+/*!
+ * @struct ai_pool_i8_quant
+ * @brief quantization of an 8-bits average pooling: the sums of the window
+ * (int32) are requantized once to the output
+ */
+typedef struct {
+  ai_i32 zp_in;       /*!< value of the padded positions */
+  ai_i32 zp_out;
+  ai_float in_out;    /*!< input scale / output scale */
+  ai_bool requantize; /*!< else the output is in the input quantization */
+} ai_pool_i8_quant;
+
+/*!
+ * @brief integer value of an 8-bits element (signed or unsigned)
+ */
+#define POOL_I8_GET(p_, i_, signed_) \
+  ( (signed_) ? (ai_i32)((const ai_i8*)(p_))[i_] : (ai_i32)((const ai_u8*)(p_))[i_] )
+
+/*!
+ * @brief saturate to the range of an 8-bits element (signed or unsigned)
+ */
+#define POOL_I8_SAT(v_, signed_) \
+  ( (signed_) ? AI_CLAMP(v_, -128, 127) : AI_CLAMP(v_, 0, 255) )
+
+/******************************************************************************/
+/*  Float pooling                                                             */
+/******************************************************************************/
+/*!
+ * @brief max / average of the channels [c, ch) of a window of n_y x n_x
+ * positions (first one at in, rows row_step floats apart)
+ */
+AI_DECLARE_STATIC
+void pool_f32_window(ai_float* out, const ai_float* in,
+                     const ai_i32 n_y, const ai_i32 n_x, const ai_size row_step,
+                     const ai_size ch, ai_size c,
+                     const ai_bool is_max, const ai_float scale)
+{
+  for ( ; c<ch; c++ ) {
+    ai_float acc = in[c];
+    for ( ai_i32 y=0; y<n_y; y++ ) {
+      const ai_float* row = in + (ai_size)y*row_step + c;
+      for ( ai_i32 x=(y==0) ? 1 : 0; x<n_x; x++ ) {
+        const ai_float v = row[(ai_size)x*ch];
+        acc = (is_max) ? AI_MAX(acc, v) : acc + v;
+      }
+    }
+    out[c] = (is_max) ? acc : acc * scale;
+  }
+}
+
+/*!
+ * @brief reduce n floats of a window position into the accumulators acc,
+ * from the element c
+ */
+AI_DECLARE_STATIC
+void pool_f32_accumulate(ai_float* acc, const ai_float* in,
+                         ai_size c, const ai_size n, const ai_bool is_max)
+{
+  if ( is_max ) {
+    for ( ; c<n; c++ ) acc[c] = AI_MAX(acc[c], in[c]);
+  } else {
+    for ( ; c<n; c++ ) acc[c] += in[c];
+  }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+/*!
+ * @brief AVX2 variant of pool_f32_window(), 8 channels per pass
+ * @return the number of computed channels (multiple of 8)
+ */
+AI_DECLARE_STATIC __attribute__((target("avx2")))
+ai_size pool_f32_window_avx2(ai_float* out, const ai_float* in,
+                             const ai_i32 n_y, const ai_i32 n_x,
+                             const ai_size row_step, const ai_size ch,
+                             const ai_bool is_max, const ai_float scale)
+{
+  const __m256 s = _mm256_set1_ps(scale);
+  ai_size c = 0;
+  for ( ; c+8<=ch; c+=8 ) {
+    __m256 acc = _mm256_loadu_ps(in + c);
+    for ( ai_i32 y=0; y<n_y; y++ ) {
+      const ai_float* row = in + (ai_size)y*row_step + c;
+      for ( ai_i32 x=(y==0) ? 1 : 0; x<n_x; x++ ) {
+        const __m256 v = _mm256_loadu_ps(row + (ai_size)x*ch);
+        acc = (is_max) ? _mm256_max_ps(acc, v) : _mm256_add_ps(acc, v);
+      }
+    }
+    _mm256_storeu_ps(out + c, (is_max) ? acc : _mm256_mul_ps(acc, s));
+  }
+  return c;
+}
+
+/*!
+ * @brief AVX2 variant of pool_f32_accumulate(), 8 floats per pass
+ * @return the number of reduced floats (multiple of 8)
+ */
+AI_DECLARE_STATIC __attribute__((target("avx2")))
+ai_size pool_f32_accumulate_avx2(ai_float* acc, const ai_float* in,
+                                 const ai_size n, const ai_bool is_max)
+{
+  ai_size c = 0;
+  for ( ; c+8<=n; c+=8 ) {
+    const __m256 a = _mm256_loadu_ps(acc + c);
+    const __m256 v = _mm256_loadu_ps(in + c);
+    _mm256_storeu_ps(acc + c, (is_max) ? _mm256_max_ps(a, v) : _mm256_add_ps(a, v));
+  }
+  return c;
+}
+
+/*!
+ * @brief AVX-512 variant of pool_f32_window(), 16 channels per pass, the
+ * last ones masked
+ * @return the number of computed channels (all of them)
+ */
+AI_DECLARE_STATIC __attribute__((target("avx512f")))
+ai_size pool_f32_window_avx512(ai_float* out, const ai_float* in,
+                               const ai_i32 n_y, const ai_i32 n_x,
+                               const ai_size row_step, const ai_size ch,
+                               const ai_bool is_max, const ai_float scale)
+{
+  const __m512 s = _mm512_set1_ps(scale);
+  for ( ai_size c=0; c<ch; c+=16 ) {
+    const __mmask16 m = (ch - c>=16)
+      ? (__mmask16)0xFFFF : (__mmask16)((1U << (ch - c)) - 1);
+    __m512 acc = _mm512_maskz_loadu_ps(m, in + c);
+    for ( ai_i32 y=0; y<n_y; y++ ) {
+      const ai_float* row = in + (ai_size)y*row_step + c;
+      for ( ai_i32 x=(y==0) ? 1 : 0; x<n_x; x++ ) {
+        const __m512 v = _mm512_maskz_loadu_ps(m, row + (ai_size)x*ch);
+        acc = (is_max) ? _mm512_max_ps(acc, v) : _mm512_add_ps(acc, v);
+      }
+    }
+    _mm512_mask_storeu_ps(out + c, m, (is_max) ? acc : _mm512_mul_ps(acc, s));
+  }
+  return ch;
+}
+#endif    /* __x86_64__ || __i386__ */
+
+/*!
+ * @brief float max / average pooling of one sample
+ */
+AI_DECLARE_STATIC
+void pool_array_f32(const ai_float* in, const ai_pool_geometry* g,
+                    ai_float* out, const ai_bool is_max, const ai_bool count_pad)
+{
+#if defined(__x86_64__) || defined(__i386__)
+  const ai_u32 features = core_cpu_get_features();
+  const ai_bool simd_512 = AI_CPU_HAS_FEATURE(features, AI_CPU_FEATURE_AVX512F);
+  const ai_bool simd = AI_CPU_HAS_FEATURE(features, AI_CPU_FEATURE_AVX2);
+#endif
+  const ai_size ch = g->ch;
+  const ai_size row_step = (ai_size)g->in_x * ch;
+
+  for ( ai_i32 oy=0; oy<g->out_y; oy++ ) {
+    const ai_i32 y0 = AI_MAX(oy*g->stride_y - g->pad_y, 0);
+    const ai_i32 y1 = AI_MIN(oy*g->stride_y - g->pad_y + g->k_y, g->in_y);
+    for ( ai_i32 ox=0; ox<g->out_x; ox++, out += ch ) {
+      const ai_i32 x0 = AI_MAX(ox*g->stride_x - g->pad_x, 0);
+      const ai_i32 x1 = AI_MIN(ox*g->stride_x - g->pad_x + g->k_x, g->in_x);
+      if ( (y0>=y1) || (x0>=x1) ) {
+        memset(out, 0, ch * sizeof(ai_float));
+        continue;
+      }
+      const ai_i32 n_y = y1 - y0;
+      const ai_i32 n_x = x1 - x0;
+      const ai_float scale = 1.0f /
+        (ai_float)((count_pad) ? g->k_x * g->k_y : n_y * n_x);
+      const ai_float* src = in + (ai_size)y0*row_step + (ai_size)x0*ch;
+
+      if ( n_y*n_x<=AI_POOL_WINDOW_MAX_REG ) {
+        ai_size c = 0;
+#if defined(__x86_64__) || defined(__i386__)
+        if ( simd_512 ) {
+          c = pool_f32_window_avx512(out, src, n_y, n_x, row_step, ch, is_max, scale);
+        } else if ( simd ) {
+          c = pool_f32_window_avx2(out, src, n_y, n_x, row_step, ch, is_max, scale);
+        }
+#endif
+        pool_f32_window(out, src, n_y, n_x, row_step, ch, c, is_max, scale);
+        continue;
+      }
+
+      /* single pass over the window rows, the outputs are the accumulators */
+      memcpy(out, src, ch * sizeof(ai_float));
+      for ( ai_i32 y=0; y<n_y; y++ ) {
+        const ai_float* row = src + (ai_size)y*row_step;
+        for ( ai_i32 x=(y==0) ? 1 : 0; x<n_x; x++ ) {
+          const ai_float* pix = row + (ai_size)x*ch;
+          ai_size c = 0;
+#if defined(__x86_64__) || defined(__i386__)
+          if ( simd ) c = pool_f32_accumulate_avx2(out, pix, ch, is_max);
+#endif
+          pool_f32_accumulate(out, pix, c, ch, is_max);
+        }
+      }
+      if ( !is_max ) {
+        for ( ai_size c=0; c<ch; c++ ) out[c] *= scale;
+      }
+    }
+  }
+}
+
+/******************************************************************************/
+/*  8-bits integer pooling                                                    */
+/******************************************************************************/
+/*!
+ * @brief max / average of the channels [c, ch) of a window of n_y x n_x
+ * 8-bits positions (first one at in, rows row_step bytes apart); the
+ * average is round((sum + offset) * scale) + zp_out, offset adding the
+ * padded positions counted by the average and removing the input zero
+ * point of a requantized one
+ */
+AI_DECLARE_STATIC
+void pool_i8_window(ai_u8* out, const ai_u8* in,
+                    const ai_i32 n_y, const ai_i32 n_x, const ai_size row_step,
+                    const ai_size ch, ai_size c, const ai_bool is_max,
+                    const ai_bool is_signed, const ai_float scale,
+                    const ai_i32 offset, const ai_i32 zp_out)
+{
+  for ( ; c<ch; c++ ) {
+    ai_i32 acc = POOL_I8_GET(in, c, is_signed);
+    for ( ai_i32 y=0; y<n_y; y++ ) {
+      const ai_u8* row = in + (ai_size)y*row_step + c;
+      for ( ai_i32 x=(y==0) ? 1 : 0; x<n_x; x++ ) {
+        const ai_i32 v = POOL_I8_GET(row, (ai_size)x*ch, is_signed);
+        acc = (is_max) ? AI_MAX(acc, v) : acc + v;
+      }
+    }
+    if ( !is_max ) {
+      acc = (ai_i32)AI_ROUND((ai_float)(acc + offset) * scale) + zp_out;
+      acc = POOL_I8_SAT(acc, is_signed);
+    }
+    out[c] = (ai_u8)acc;
+  }
+}
+
+/*!
+ * @brief reduce n 8-bits values of a window position into the int32
+ * accumulators acc, from the element c
+ */
+AI_DECLARE_STATIC
+void pool_i8_accumulate(ai_i32* acc, const ai_u8* in, ai_size c,
+                        const ai_size n, const ai_bool is_max,
+                        const ai_bool is_signed)
+{
+  for ( ; c<n; c++ ) {
+    const ai_i32 v = POOL_I8_GET(in, c, is_signed);
+    acc[c] = (is_max) ? AI_MAX(acc[c], v) : acc[c] + v;
+  }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+/*!
+ * @brief widen 8 8-bits values to int32
+ */
+AI_DECLARE_STATIC __attribute__((target("avx2")))
+__m256i pool_i8_load8_avx2(const ai_u8* in, const ai_bool is_signed)
+{
+  const __m128i v = _mm_loadl_epi64((const __m128i*)in);
+  return (is_signed) ? _mm256_cvtepi8_epi32(v) : _mm256_cvtepu8_epi32(v);
+}
+
+/*!
+ * @brief AVX2 variant of pool_i8_window(): 32 channels per pass for the max,
+ * 8 channels (int32 sums) per pass for the average
+ * @return the number of computed channels
+ */
+AI_DECLARE_STATIC __attribute__((target("avx2")))
+ai_size pool_i8_window_avx2(ai_u8* out, const ai_u8* in,
+                            const ai_i32 n_y, const ai_i32 n_x,
+                            const ai_size row_step, const ai_size ch,
+                            const ai_bool is_max, const ai_bool is_signed,
+                            const ai_float scale, const ai_i32 offset,
+                            const ai_i32 zp_out)
+{
+  ai_size c = 0;
+  if ( is_max ) {
+    for ( ; c+32<=ch; c+=32 ) {
+      __m256i acc = _mm256_loadu_si256((const __m256i*)(in + c));
+      for ( ai_i32 y=0; y<n_y; y++ ) {
+        const ai_u8* row = in + (ai_size)y*row_step + c;
+        for ( ai_i32 x=(y==0) ? 1 : 0; x<n_x; x++ ) {
+          const __m256i v = _mm256_loadu_si256((const __m256i*)(row + (ai_size)x*ch));
+          acc = (is_signed) ? _mm256_max_epi8(acc, v) : _mm256_max_epu8(acc, v);
+        }
+      }
+      _mm256_storeu_si256((__m256i*)(out + c), acc);
+    }
+    return c;
+  }
+
+  const __m256 s = _mm256_set1_ps(scale);
+  const __m256 half = _mm256_set1_ps(0.5f);
+  const __m256 one = _mm256_set1_ps(1.0f);
+  const __m256 sign = _mm256_set1_ps(-0.0f);
+  const __m256i off = _mm256_set1_epi32(offset);
+  const __m256i zp = _mm256_set1_epi32(zp_out);
+  for ( ; c+8<=ch; c+=8 ) {
+    __m256i acc = _mm256_add_epi32(pool_i8_load8_avx2(in + c, is_signed), off);
+    for ( ai_i32 y=0; y<n_y; y++ ) {
+      const ai_u8* row = in + (ai_size)y*row_step + c;
+      for ( ai_i32 x=(y==0) ? 1 : 0; x<n_x; x++ ) {
+        acc = _mm256_add_epi32(acc,
+          pool_i8_load8_avx2(row + (ai_size)x*ch, is_signed));
+      }
+    }
+    /* roundf(): truncation, plus 1 away from zero if the fraction is >= 0.5 */
+    const __m256 f = _mm256_mul_ps(_mm256_cvtepi32_ps(acc), s);
+    const __m256 t = _mm256_round_ps(f, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+    const __m256 up = _mm256_cmp_ps(
+      _mm256_andnot_ps(sign, _mm256_sub_ps(f, t)), half, _CMP_GE_OQ);
+    const __m256 r = _mm256_add_ps(t,
+      _mm256_and_ps(up, _mm256_or_ps(one, _mm256_and_ps(sign, f))));
+    /* saturated to the 8-bits range by the packs */
+    const __m256i q = _mm256_add_epi32(_mm256_cvttps_epi32(r), zp);
+    const __m128i q16 = _mm_packs_epi32(_mm256_castsi256_si128(q),
+                                        _mm256_extracti128_si256(q, 1));
+    const __m128i q8 = (is_signed)
+      ? _mm_packs_epi16(q16, q16) : _mm_packus_epi16(q16, q16);
+    _mm_storel_epi64((__m128i*)(out + c), q8);
+  }
+  return c;
+}
+
+/*!
+ * @brief AVX2 variant of pool_i8_accumulate(), 8 values per pass
+ * @return the number of reduced values (multiple of 8)
+ */
+AI_DECLARE_STATIC __attribute__((target("avx2")))
+ai_size pool_i8_accumulate_avx2(ai_i32* acc, const ai_u8* in, const ai_size n,
+                                const ai_bool is_max, const ai_bool is_signed)
+{
+  ai_size c = 0;
+  for ( ; c+8<=n; c+=8 ) {
+    const __m256i a = _mm256_loadu_si256((const __m256i*)(acc + c));
+    const __m256i v = pool_i8_load8_avx2(in + c, is_signed);
+    _mm256_storeu_si256((__m256i*)(acc + c),
+      (is_max) ? _mm256_max_epi32(a, v) : _mm256_add_epi32(a, v));
+  }
+  return c;
+}
+#endif    /* __x86_64__ || __i386__ */
+
+/*!
+ * @brief 8-bits max / average pooling of one sample: the max in the input
+ * quantization, the average requantized from its int32 sums if q asks so;
+ * the padded positions (value q->zp_in) are counted by the average when
+ * count_pad is set
+ */
+AI_DECLARE_STATIC
+void pool_array_i8(const ai_u8* in, const ai_pool_geometry* g, ai_u8* out,
+                   const ai_bool is_max, const ai_bool is_signed,
+                   const ai_bool count_pad, const ai_pool_i8_quant* q)
+{
+#if defined(__x86_64__) || defined(__i386__)
+  const ai_bool simd =
+    AI_CPU_HAS_FEATURE(core_cpu_get_features(), AI_CPU_FEATURE_AVX2);
+#endif
+  const ai_size ch = g->ch;
+  const ai_size row_step = (ai_size)g->in_x * ch;
+  const ai_bool requantize = !is_max && q->requantize;
+  const ai_i32 zp_out = (requantize) ? q->zp_out : 0;
+
+  for ( ai_i32 oy=0; oy<g->out_y; oy++ ) {
+    const ai_i32 y0 = AI_MAX(oy*g->stride_y - g->pad_y, 0);
+    const ai_i32 y1 = AI_MIN(oy*g->stride_y - g->pad_y + g->k_y, g->in_y);
+    for ( ai_i32 ox=0; ox<g->out_x; ox++, out += ch ) {
+      const ai_i32 x0 = AI_MAX(ox*g->stride_x - g->pad_x, 0);
+      const ai_i32 x1 = AI_MIN(ox*g->stride_x - g->pad_x + g->k_x, g->in_x);
+      if ( (y0>=y1) || (x0>=x1) ) {
+        memset(out, (ai_u8)((requantize) ? q->zp_out : q->zp_in), ch);
+        continue;
+      }
+      const ai_i32 n_y = y1 - y0;
+      const ai_i32 n_x = x1 - x0;
+      const ai_i32 n_window = (count_pad) ? g->k_x * g->k_y : n_y * n_x;
+      /* padded positions counted, input zero point removed if requantized */
+      const ai_i32 offset = (n_window - n_y * n_x) * q->zp_in -
+        ((requantize) ? n_window * q->zp_in : 0);
+      const ai_float scale = ((requantize) ? q->in_out : 1.0f) /
+        (ai_float)n_window;
+      const ai_u8* src = in + (ai_size)y0*row_step + (ai_size)x0*ch;
+
+      if ( n_y*n_x<=AI_POOL_WINDOW_MAX_REG ) {
+        ai_size c = 0;
+#if defined(__x86_64__) || defined(__i386__)
+        if ( simd ) {
+          c = pool_i8_window_avx2(out, src, n_y, n_x, row_step, ch,
+                                  is_max, is_signed, scale, offset, zp_out);
+        }
+#endif
+        pool_i8_window(out, src, n_y, n_x, row_step, ch, c,
+                       is_max, is_signed, scale, offset, zp_out);
+        continue;
+      }
+
+      /* single pass over the window rows by chunks of channels */
+      ai_i32 acc[AI_POOL_ACC_CHUNK];
+      for ( ai_size c0=0; c0<ch; c0+=AI_POOL_ACC_CHUNK ) {
+        const ai_size n = AI_MIN(ch - c0, (ai_size)AI_POOL_ACC_CHUNK);
+        for ( ai_size c=0; c<n; c++ ) acc[c] = POOL_I8_GET(src + c0, c, is_signed);
+        for ( ai_i32 y=0; y<n_y; y++ ) {
+          const ai_u8* row = src + (ai_size)y*row_step + c0;
+          for ( ai_i32 x=(y==0) ? 1 : 0; x<n_x; x++ ) {
+            const ai_u8* pix = row + (ai_size)x*ch;
+            ai_size c = 0;
+#if defined(__x86_64__) || defined(__i386__)
+            if ( simd ) c = pool_i8_accumulate_avx2(acc, pix, n, is_max, is_signed);
+#endif
+            pool_i8_accumulate(acc, pix, c, n, is_max, is_signed);
+          }
+        }
+        for ( ai_size c=0; c<n; c++ ) {
+          ai_i32 v = acc[c];
+          if ( !is_max ) {
+            v = (ai_i32)AI_ROUND((ai_float)(v + offset) * scale) + zp_out;
+            v = POOL_I8_SAT(v, is_signed);
+          }
+          out[c0 + c] = (ai_u8)v;
+        }
+      }
+    }
+  }
+}
+
+/******************************************************************************/
+/*  8/16-bits fixed point pooling                                             */
+/******************************************************************************/
+/*!
+ * @brief value of an 8/16-bits fixed point element (signed or unsigned)
+ */
+AI_DECLARE_STATIC
+ai_i32 pool_fixed_get(const ai_ptr p, const ai_size i, const ai_bool is_16,
+                      const ai_bool is_signed)
+{
+  if ( is_16 ) {
+    return (is_signed) ? (ai_i32)((const ai_i16*)p)[i] : (ai_i32)((const ai_u16*)p)[i];
+  }
+  return POOL_I8_GET(p, i, is_signed);
+}
+
+/*!
+ * @brief max / average pooling of the 8/16-bits fixed point arrays in and
+ * out (all their samples), each with its own format: the window is reduced
+ * in the input format (int64 sums), shifted to the output one, rounded and
+ * saturated once
+ * @return false if the formats are not 8/16-bits fixed point ones
+ */
+AI_DECLARE_STATIC
+ai_bool pool_array_fixed(const ai_array* in, const ai_pool_geometry* g,
+                         ai_array* out, const ai_bool is_max,
+                         const ai_bool count_pad)
+{
+  const ai_array_format fmt_in = AI_ARRAY_OBJ_FMT(in);
+  const ai_array_format fmt_out = AI_ARRAY_OBJ_FMT(out);
+  const ai_i32 in_bits = AI_FMT_GET_BITS(fmt_in);
+  const ai_i32 out_bits = AI_FMT_GET_BITS(fmt_out);
+
+  if ( (AI_FMT_GET_TYPE(fmt_in)!=AI_FMT_Q) || (AI_FMT_GET_TYPE(fmt_out)!=AI_FMT_Q) ||
+       ((in_bits!=8) && (in_bits!=16)) || ((out_bits!=8) && (out_bits!=16)) ) {
+    return false;
+  }
+
+  const ai_bool in_16 = (in_bits==16);
+  const ai_bool out_16 = (out_bits==16);
+  const ai_bool in_signed = AI_FMT_GET_SIGN(fmt_in);
+  const ai_bool out_signed = AI_FMT_GET_SIGN(fmt_out);
+  const ai_i32 q_min = (out_signed) ? -(1 << (out_bits - 1)) : 0;
+  const ai_i32 q_max = (out_signed) ? (1 << (out_bits - 1)) - 1 : (1 << out_bits) - 1;
+  /* 2^(out_fbits - in_fbits), the fractional bits being at most 16 */
+  const ai_i32 shift = AI_FMT_GET_FBITS(fmt_out) - AI_FMT_GET_FBITS(fmt_in);
+  const ai_float to_out = (shift>=0)
+    ? (ai_float)(1 << AI_MIN(shift, 30)) : 1.0f / (ai_float)(1 << AI_MIN(-shift, 30));
+
+  const ai_size ch = g->ch;
+  const ai_size row_step = (ai_size)g->in_x * ch;
+  const ai_size in_size = (ai_size)g->in_y * row_step;
+  const ai_size out_size = (ai_size)g->out_y * g->out_x * ch;
+  const ai_size n_batches = AI_ARRAY_OBJ_SIZE(in) / in_size;
+
+  for ( ai_size b=0; b<n_batches; b++ ) {
+    const ai_size in_base = b * in_size;
+    ai_size o = b * out_size;
+    for ( ai_i32 oy=0; oy<g->out_y; oy++ ) {
+      const ai_i32 y0 = AI_MAX(oy*g->stride_y - g->pad_y, 0);
+      const ai_i32 y1 = AI_MIN(oy*g->stride_y - g->pad_y + g->k_y, g->in_y);
+      for ( ai_i32 ox=0; ox<g->out_x; ox++ ) {
+        const ai_i32 x0 = AI_MAX(ox*g->stride_x - g->pad_x, 0);
+        const ai_i32 x1 = AI_MIN(ox*g->stride_x - g->pad_x + g->k_x, g->in_x);
+        const ai_i32 n_window = (count_pad) ? g->k_x * g->k_y : (y1 - y0) * (x1 - x0);
+        const ai_float scale = (is_max) ? to_out : to_out / (ai_float)n_window;
+        for ( ai_size c=0; c<ch; c++, o++ ) {
+          ai_i64 acc = 0;
+          for ( ai_i32 y=y0; y<y1; y++ ) {
+            for ( ai_i32 x=x0; x<x1; x++ ) {
+              const ai_i32 v = pool_fixed_get(in->data,
+                in_base + (ai_size)y*row_step + (ai_size)x*ch + c, in_16, in_signed);
+              acc = ( !is_max ) ? acc + v
+                : ((y==y0) && (x==x0)) ? v : AI_MAX(acc, (ai_i64)v);
+            }
+          }
+          /* empty window: 0 */
+          ai_i32 q = (ai_i32)AI_ROUND((ai_float)acc * scale);
+          q = AI_CLAMP(q, q_min, q_max);
+          if ( out_16 ) {
+            ((ai_u16*)out->data)[o] = (ai_u16)q;
+          } else {
+            ((ai_u8*)out->data)[o] = (ai_u8)q;
+          }
+        }
+      }
+    }
+  }
+  return true;
+}
+
+/******************************************************************************/
+AI_DECLARE_STATIC
+void pool_geometry_init(ai_pool_geometry* g,
+                        const ai_u16 dim_im_in_x, const ai_u16 dim_im_in_y,
+                        const ai_u16 ch_im_in,
+                        const ai_u16 dim_kernel_x, const ai_u16 dim_kernel_y,
+                        const ai_u16 padding_x, const ai_u16 padding_y,
+                        const ai_u16 stride_x, const ai_u16 stride_y,
+                        const ai_u16 dim_im_out_x, const ai_u16 dim_im_out_y)
+{
+  g->in_x = dim_im_in_x;
+  g->in_y = dim_im_in_y;
+  g->ch = ch_im_in;
+  g->k_x = dim_kernel_x;
+  g->k_y = dim_kernel_y;
+  g->pad_x = padding_x;
+  g->pad_y = padding_y;
+  g->stride_x = AI_MAX(stride_x, 1);
+  g->stride_y = AI_MAX(stride_y, 1);
+  g->out_x = dim_im_out_x;
+  g->out_y = dim_im_out_y;
+}
+
+#define AI_POOL_FUNC_F32(name_, is_max_) \
+AI_INTERNAL_API \
+void pool_func_ ## name_ ## _array_f32(ai_handle in, \
+                      const ai_u16 dim_im_in_x, const ai_u16 dim_im_in_y, \
+                      const ai_u16 ch_im_in, \
+                      const ai_u16 dim_kernel_x, const ai_u16 dim_kernel_y, \
+                      const ai_u16 padding_x, const ai_u16 padding_y, \
+                      const ai_u16 stride_x, const ai_u16 stride_y, \
+                      const ai_u16 dim_im_out_x, const ai_u16 dim_im_out_y, \
+                      ai_handle out) \
+{ \
+  ai_pool_geometry g; \
+  pool_geometry_init(&g, dim_im_in_x, dim_im_in_y, ch_im_in, \
+                     dim_kernel_x, dim_kernel_y, padding_x, padding_y, \
+                     stride_x, stride_y, dim_im_out_x, dim_im_out_y); \
+  pool_array_f32((const ai_float*)in, &g, (ai_float*)out, is_max_, false); \
+}
+
+#define AI_POOL_FUNC_I8(name_, type_, is_max_, is_signed_) \
+AI_INTERNAL_API \
+void pool_func_ ## name_ ## _array_integer_ ## type_(ai_handle in, \
+                      const ai_u16 dim_im_in_x, const ai_u16 dim_im_in_y, \
+                      const ai_u16 ch_im_in, \
+                      const ai_u16 dim_kernel_x, const ai_u16 dim_kernel_y, \
+                      const ai_u16 padding_x, const ai_u16 padding_y, \
+                      const ai_u16 stride_x, const ai_u16 stride_y, \
+                      const ai_u16 dim_im_out_x, const ai_u16 dim_im_out_y, \
+                      ai_handle out) \
+{ \
+  const ai_pool_i8_quant q = { 0, 0, 1.0f, false }; \
+  ai_pool_geometry g; \
+  pool_geometry_init(&g, dim_im_in_x, dim_im_in_y, ch_im_in, \
+                     dim_kernel_x, dim_kernel_y, padding_x, padding_y, \
+                     stride_x, stride_y, dim_im_out_x, dim_im_out_y); \
+  pool_array_i8((const ai_u8*)in, &g, (ai_u8*)out, is_max_, is_signed_, \
+                false, &q); \
+}
+
+/* the fixed point and integer functions get the arrays (ai_array*), the
+ * kernel is selected by their format */
+#define AI_POOL_FUNC_FIXED(name_, is_max_) \
+AI_INTERNAL_API \
+void pool_func_ ## name_ ## _array_fixed(ai_handle in, \
+                      const ai_u16 dim_im_in_x, const ai_u16 dim_im_in_y, \
+                      const ai_u16 ch_im_in, \
+                      const ai_u16 dim_kernel_x, const ai_u16 dim_kernel_y, \
+                      const ai_u16 padding_x, const ai_u16 padding_y, \
+                      const ai_u16 stride_x, const ai_u16 stride_y, \
+                      const ai_u16 dim_im_out_x, const ai_u16 dim_im_out_y, \
+                      ai_handle out) \
+{ \
+  ai_pool_geometry g; \
+  pool_geometry_init(&g, dim_im_in_x, dim_im_in_y, ch_im_in, \
+                     dim_kernel_x, dim_kernel_y, padding_x, padding_y, \
+                     stride_x, stride_y, dim_im_out_x, dim_im_out_y); \
+  pool_array_fixed((const ai_array*)in, &g, (ai_array*)out, is_max_, false); \
+}
+
+#define AI_POOL_FUNC_INTEGER(name_, is_max_) \
+AI_INTERNAL_API \
+void pool_func_ ## name_ ## _array_integer(ai_handle in, \
+                      const ai_u16 dim_im_in_x, const ai_u16 dim_im_in_y, \
+                      const ai_u16 ch_im_in, \
+                      const ai_u16 dim_kernel_x, const ai_u16 dim_kernel_y, \
+                      const ai_u16 padding_x, const ai_u16 padding_y, \
+                      const ai_u16 stride_x, const ai_u16 stride_y, \
+                      const ai_u16 dim_im_out_x, const ai_u16 dim_im_out_y, \
+                      ai_handle out) \
+{ \
+  const ai_array* in_array = (const ai_array*)in; \
+  ai_array* out_array = (ai_array*)out; \
+  const ai_array_format fmt = AI_ARRAY_OBJ_FMT(in_array); \
+  const ai_pool_i8_quant q = { 0, 0, 1.0f, false }; \
+  ai_pool_geometry g; \
+  if ( (!AI_FMT_SAME(fmt, AI_ARRAY_FORMAT_S8) && \
+        !AI_FMT_SAME(fmt, AI_ARRAY_FORMAT_U8)) || \
+       !AI_FMT_SAME(AI_ARRAY_OBJ_FMT(out_array), fmt) ) return; \
+  pool_geometry_init(&g, dim_im_in_x, dim_im_in_y, ch_im_in, \
+                     dim_kernel_x, dim_kernel_y, padding_x, padding_y, \
+                     stride_x, stride_y, dim_im_out_x, dim_im_out_y); \
+  const ai_size in_size = (ai_size)g.in_y * g.in_x * g.ch; \
+  const ai_size out_size = (ai_size)g.out_y * g.out_x * g.ch; \
+  const ai_size n_batches = AI_ARRAY_OBJ_SIZE(in_array) / in_size; \
+  for ( ai_size b=0; b<n_batches; b++ ) { \
+    pool_array_i8(AI_ARRAY_OBJ_DATA(in_array, ai_u8) + b*in_size, &g, \
+                  AI_ARRAY_OBJ_DATA(out_array, ai_u8) + b*out_size, is_max_, \
+                  AI_FMT_SAME(fmt, AI_ARRAY_FORMAT_S8), false, &q); \
+  } \
+}
+
+AI_POOL_FUNC_F32(mp, true)
+AI_POOL_FUNC_F32(ap, false)
+AI_POOL_FUNC_FIXED(mp, true)
+AI_POOL_FUNC_FIXED(ap, false)
+AI_POOL_FUNC_INTEGER(mp, true)
+AI_POOL_FUNC_INTEGER(ap, false)
+AI_POOL_FUNC_I8(mp, INT8, true, true)
+AI_POOL_FUNC_I8(mp, UINT8, true, false)
+AI_POOL_FUNC_I8(ap, INT8, false, true)
+AI_POOL_FUNC_I8(ap, UINT8, false, false)
+
+/******************************************************************************/
+/*  Forward functions                                                         */
+/******************************************************************************/
+/*!
+ * @brief read the geometry of a pooling layer, check its output shape
+ */
+AI_DECLARE_STATIC
+ai_bool pool_geometry_get(const ai_layer_pool* l, ai_pool_geometry* g)
+{
+  const ai_tensor* input = GET_TENSOR_IN(l->tensors, 0);
+  const ai_tensor* output = GET_TENSOR_OUT(l->tensors, 0);
+
+  g->in_x = AI_SHAPE_W(&input->shape);
+  g->in_y = AI_SHAPE_H(&input->shape);
+  g->ch = AI_SHAPE_CH(&input->shape);
+  g->k_x = AI_MAX(AI_SHAPE_2D_W(&l->pool_size), 1);
+  g->k_y = AI_MAX(AI_SHAPE_2D_H(&l->pool_size), 1);
+  g->stride_x = AI_MAX(AI_SHAPE_2D_W(&l->pool_stride), 1);
+  g->stride_y = AI_MAX(AI_SHAPE_2D_H(&l->pool_stride), 1);
+  g->pad_x = (AI_STORAGE_KLASS_SIZE(&l->pool_pad)>1)
+    ? AI_SHAPE_ELEM(&l->pool_pad, 0) : 0;
+  g->pad_y = (AI_STORAGE_KLASS_SIZE(&l->pool_pad)>1)
+    ? AI_SHAPE_ELEM(&l->pool_pad, 1) : 0;
+  g->out_x = AI_SHAPE_W(&output->shape);
+  g->out_y = AI_SHAPE_H(&output->shape);
+
+  if ( (AI_SHAPE_CH(&output->shape)!=g->ch) || (g->in_x<=0) || (g->in_y<=0) ||
+       (g->out_x<=0) || (g->out_y<=0) ) {
+    AI_ERROR_TRAP(l->network, INVALID_PARAM, INVALID_SIZE);
+    return false;
+  }
+  return true;
+}
+
+/*!
+ * @brief float pooling layer
+ */
+AI_DECLARE_STATIC
+void pool_forward_f32(ai_layer* layer, const ai_bool is_max)
+{
+  const ai_layer_pool* l = (const ai_layer_pool*)layer;
+  const ai_tensor* input = GET_TENSOR_IN(l->tensors, 0);
+  ai_tensor* output = GET_TENSOR_OUT(l->tensors, 0);
+
+  if ( !AI_FMT_SAME(AI_ARRAY_OBJ_FMT(input->data), AI_ARRAY_FORMAT_FLOAT) ||
+       !AI_FMT_SAME(AI_ARRAY_OBJ_FMT(output->data), AI_ARRAY_FORMAT_FLOAT) ) {
+    AI_ERROR_TRAP(l->network, INVALID_PARAM, INVALID_FORMAT);
+    return;
+  }
+  ai_pool_geometry g;
+  if ( !pool_geometry_get(l, &g) ) return;
+
+  const ai_size in_size = (ai_size)g.in_y * g.in_x * g.ch;
+  const ai_size out_size = (ai_size)g.out_y * g.out_x * g.ch;
+  const ai_size n_batches = AI_ARRAY_OBJ_SIZE(input->data) / in_size;
+  const ai_float* in_data = AI_ARRAY_OBJ_DATA(input->data, ai_float);
+  ai_float* out_data = AI_ARRAY_OBJ_DATA(output->data, ai_float);
+
+  for ( ai_size b=0; b<n_batches; b++ ) {
+    pool_array_f32(in_data, &g, out_data, is_max,
+                   !is_max && l->count_include_pad);
+    in_data += in_size;
+    out_data += out_size;
+  }
+}
+
+/*!
+ * @brief 8-bits integer pooling layer: the max pooled in the input
+ * quantization then requantized if the output one differs, the average
+ * requantized once from its int32 sums
+ */
+AI_DECLARE_STATIC
+void pool_forward_i8(ai_layer* layer, const ai_bool is_max,
+                     const ai_bool is_signed)
+{
+  const ai_layer_pool* l = (const ai_layer_pool*)layer;
+  const ai_tensor* input = GET_TENSOR_IN(l->tensors, 0);
+  ai_tensor* output = GET_TENSOR_OUT(l->tensors, 0);
+  const ai_array_format fmt =
+    (is_signed) ? AI_ARRAY_FORMAT_S8 : AI_ARRAY_FORMAT_U8;
+
+  if ( !AI_FMT_SAME(AI_ARRAY_OBJ_FMT(input->data), fmt) ||
+       !AI_FMT_SAME(AI_ARRAY_OBJ_FMT(output->data), fmt) ||
+       !AI_HAS_INTQ_INFO_LIST(AI_KLASS_GET_INTQ_INFO_LIST(input)) ||
+       !AI_HAS_INTQ_INFO_LIST(AI_KLASS_GET_INTQ_INFO_LIST(output)) ) {
+    AI_ERROR_TRAP(l->network, INVALID_PARAM, INVALID_FORMAT);
+    return;
+  }
+  ai_pool_geometry g;
+  if ( !pool_geometry_get(l, &g) ) return;
+
+  const ai_float s_in  = AI_TENSOR_INTEGER_GET_SCALE(input, 0);
+  const ai_float s_out = AI_TENSOR_INTEGER_GET_SCALE(output, 0);
+  const ai_i32 zp_in = (is_signed)
+    ? AI_TENSOR_INTEGER_GET_ZEROPOINT_I8(input, 0)
+    : AI_TENSOR_INTEGER_GET_ZEROPOINT_U8(input, 0);
+  const ai_i32 zp_out = (is_signed)
+    ? AI_TENSOR_INTEGER_GET_ZEROPOINT_I8(output, 0)
+    : AI_TENSOR_INTEGER_GET_ZEROPOINT_U8(output, 0);
+  const ai_pool_i8_quant q = { zp_in, zp_out, s_in / s_out,
+    (s_in!=s_out) || (zp_in!=zp_out) };
+
+  const ai_size in_size = (ai_size)g.in_y * g.in_x * g.ch;
+  const ai_size out_size = (ai_size)g.out_y * g.out_x * g.ch;
+  const ai_size n_batches = AI_ARRAY_OBJ_SIZE(input->data) / in_size;
+  const ai_u8* in_data = AI_ARRAY_OBJ_DATA(input->data, ai_u8);
+  ai_u8* out_data = AI_ARRAY_OBJ_DATA(output->data, ai_u8);
+
+  for ( ai_size b=0; b<n_batches; b++ ) {
+    pool_array_i8(in_data, &g, out_data, is_max, is_signed,
+                  !is_max && l->count_include_pad, &q);
+    if ( is_max && q.requantize ) {
+      for ( ai_size i=0; i<out_size; i++ ) {
+        ai_i32 v = POOL_I8_GET(out_data, i, is_signed) - zp_in;
+        v = (ai_i32)AI_ROUND((ai_float)v * q.in_out) + zp_out;
+        out_data[i] = (ai_u8)POOL_I8_SAT(v, is_signed);
+      }
+    }
+    in_data += in_size;
+    out_data += out_size;
+  }
+}
+
+/*!
+ * @brief 8/16-bits fixed point pooling layer
+ */
+AI_DECLARE_STATIC
+void pool_forward_fixed(ai_layer* layer, const ai_bool is_max)
+{
+  const ai_layer_pool* l = (const ai_layer_pool*)layer;
+  const ai_tensor* input = GET_TENSOR_IN(l->tensors, 0);
+  ai_tensor* output = GET_TENSOR_OUT(l->tensors, 0);
+  ai_pool_geometry g;
+
+  if ( !pool_geometry_get(l, &g) ) return;
+  if ( !pool_array_fixed(input->data, &g, output->data, is_max,
+                         !is_max && l->count_include_pad) ) {
+    AI_ERROR_TRAP(l->network, INVALID_PARAM, INVALID_FORMAT);
+  }
+}
+
+/*!
+ * @brief 8-bits integer pooling layer, signed or unsigned as its input
+ */
+AI_DECLARE_STATIC
+void pool_forward_integer(ai_layer* layer, const ai_bool is_max)
+{
+  const ai_layer_pool* l = (const ai_layer_pool*)layer;
+  const ai_tensor* input = GET_TENSOR_IN(l->tensors, 0);
+
+  /* the format is checked against the output one by pool_forward_i8 */
+  pool_forward_i8(layer, is_max,
+    !AI_FMT_SAME(AI_ARRAY_OBJ_FMT(input->data), AI_ARRAY_FORMAT_U8));
+}
+
+/******************************************************************************/
+AI_INTERNAL_API
+void forward_mp(ai_layer* layer)
+{
+  pool_forward_f32(layer, true);
+}
+
+AI_INTERNAL_API
+void forward_ap(ai_layer* layer)
+{
+  pool_forward_f32(layer, false);
+}
+
+AI_INTERNAL_API
+void forward_mp_fixed(ai_layer* pLayer)
+{
+  pool_forward_fixed(pLayer, true);
+}
+
+AI_INTERNAL_API
+void forward_ap_fixed(ai_layer* pLayer)
+{
+  pool_forward_fixed(pLayer, false);
+}
+
+AI_INTERNAL_API
+void forward_mp_integer(ai_layer* pLayer)
+{
+  pool_forward_integer(pLayer, true);
+}
+
+AI_INTERNAL_API
+void forward_ap_integer(ai_layer* pLayer)
+{
+  pool_forward_integer(pLayer, false);
+}
+
+AI_INTERNAL_API
+void forward_mp_integer_INT8(ai_layer* pLayer)
+{
+  pool_forward_i8(pLayer, true, true);
+}
+
+AI_INTERNAL_API
+void forward_mp_integer_UINT8(ai_layer* pLayer)
+{
+  pool_forward_i8(pLayer, true, false);
+}
+
+AI_INTERNAL_API
+void forward_ap_integer_INT8(ai_layer* pLayer)
+{
+  pool_forward_i8(pLayer, false, true);
+}
+
+AI_INTERNAL_API
+void forward_ap_integer_UINT8(ai_layer* pLayer)
+{
+  pool_forward_i8(pLayer, false, false);
+}
@@ -0,0 +1,262 @@
+/**
+  ******************************************************************************
+  * @file    layers_sm.c
+  * @brief   implementation of the fixed point softmax layer
+  ******************************************************************************
+  * @attention
+  *
+  * Open implementation of the fixed point (Q / UQ formats, 8 or 16 bits)
+  * softmax declared in layers_sm.h, computed with integer arithmetic only.
+  *
+  * Each channel is read twice. The first pass computes the maximum m and
+  * the sum S of the exp(x - m) together, the sum being rescaled by
+  * exp(m_old - m) when the maximum increases. The second one writes
+  * exp(x - m) / S with the fraction bits of the output format, rounded to
+  * nearest and saturated.
+  *
+  * exp(-t), t >= 0, is the product of three UQ31 tables (88, 128 and 128
+  * entries) indexed by the bits of t in units of 2^-16, t < 22 (exp(-22)
+  * is below the UQ31 resolution):
+  *   exp(-t) = hi[t >> 14] * mid[(t >> 7) & 127] * lo[t & 127]
+  * The differences of two inputs are exact as long as the input format has
+  * at most 16 fraction bits.
+  *
+  ******************************************************************************
+  */
+
+#include "layers_sm.h"
+#include "layers_nl.h"
+#include "ai_math_helpers.h"
+
+/*! exp argument t in units of 2^-16: exp(-t) is 0 above (88 << 14) */
+#define SM_EXP_T_FBITS      (16)
+#define SM_EXP_T_MAX        (88u << 14)
+#define SM_ONE_UQ31         (0x80000000u)
+
+/*! exp(-i/4) in UQ31 */
+AI_STATIC_CONST ai_u32 g_sm_exp_hi[88] = {
+  0x80000000, 0x63afbe7b, 0x4da2cbf2, 0x3c7681d8, 0x2f16ac6c, 0x24ac306e,
+  0x1c8f8772, 0x163e397e, 0x1152aaa4, 0x0d7db8c7, 0x0a81c2e0, 0x082ec9c5,
+  0x065f6c33, 0x04f68da1, 0x03dd8203, 0x0302a127, 0x02582ab7, 0x01d36911,
+  0x016c0504, 0x011b7fae, 0x00dcc9ff, 0x00abf360, 0x0085ea53, 0x00684b1a,
+  0x00513948, 0x003f41d3, 0x003143c3, 0x00265e0d, 0x001de16c, 0x00174560,
+  0x00121f9c, 0x000e1d55, 0x000afe11, 0x00088f98, 0x0006aad1, 0x00053145,
+  0x00040b3d, 0x0003263e, 0x000273e7, 0x0001e903, 0x00017cd8, 0x0001289a,
+  0x0000e6fe, 0x0000b3e6, 0x00008c1b, 0x00006d1d, 0x000054fa, 0x0000422e,
+  0x0000338b, 0x00002824, 0x00001f43, 0x00001859, 0x000012f6, 0x00000ec4,
+  0x00000b80, 0x000008f5, 0x000006fa, 0x0000056f, 0x0000043b, 0x0000034c,
+  0x00000291, 0x00000200, 0x0000018e, 0x00000136, 0x000000f2, 0x000000bc,
+  0x00000093, 0x00000072, 0x00000059, 0x00000045, 0x00000036, 0x0000002a,
+  0x00000021, 0x00000019, 0x00000014, 0x0000000f, 0x0000000c, 0x00000009,
+  0x00000007, 0x00000006, 0x00000004, 0x00000003, 0x00000003, 0x00000002,
+  0x00000002, 0x00000001, 0x00000001, 0x00000001
+};
+
+/*! exp(-i/512) in UQ31 */
+AI_STATIC_CONST ai_u32 g_sm_exp_mid[128] = {
+  0x80000000, 0x7fc00ffd, 0x7f803feb, 0x7f408fb8, 0x7f00ff56, 0x7ec18eb3,
+  0x7e823dc2, 0x7e430c70, 0x7e03fab0, 0x7dc50871, 0x7d8635a2, 0x7d478236,
+  0x7d08ee1b, 0x7cca7942, 0x7c8c239c, 0x7c4ded1a, 0x7c0fd5aa, 0x7bd1dd3f,
+  0x7b9403c8, 0x7b564936, 0x7b18ad79, 0x7adb3083, 0x7a9dd244, 0x7a6092ac,
+  0x7a2371ac, 0x79e66f35, 0x79a98b38, 0x796cc5a5, 0x79301e6d, 0x78f39581,
+  0x78b72ad2, 0x787ade51, 0x783eafef, 0x78029f9c, 0x77c6ad4a, 0x778ad8ea,
+  0x774f226d, 0x771389c3, 0x76d80ede, 0x769cb1af, 0x76617227, 0x76265038,
+  0x75eb4bd2, 0x75b064e7, 0x75759b68, 0x753aef47, 0x75006074, 0x74c5eee2,
+  0x748b9a80, 0x74516342, 0x74174918, 0x73dd4bf4, 0x73a36bc8, 0x7369a884,
+  0x7330021a, 0x72f6787d, 0x72bd0b9d, 0x7283bb6c, 0x724a87dd, 0x721170e0,
+  0x71d87667, 0x719f9865, 0x7166d6ca, 0x712e3189, 0x70f5a894, 0x70bd3bdc,
+  0x7084eb53, 0x704cb6ec, 0x70149e98, 0x6fdca249, 0x6fa4c1f1, 0x6f6cfd82,
+  0x6f3554ee, 0x6efdc828, 0x6ec65722, 0x6e8f01cd, 0x6e57c81b, 0x6e20aa00,
+  0x6de9a76d, 0x6db2c054, 0x6d7bf4a8, 0x6d45445b, 0x6d0eaf5f, 0x6cd835a7,
+  0x6ca1d725, 0x6c6b93cb, 0x6c356b8c, 0x6bff5e5b, 0x6bc96c2a, 0x6b9394ea,
+  0x6b5dd890, 0x6b28370d, 0x6af2b055, 0x6abd4459, 0x6a87f30c, 0x6a52bc61,
+  0x6a1da04b, 0x69e89ebc, 0x69b3b7a8, 0x697eeb00, 0x694a38b8, 0x6915a0c3,
+  0x68e12313, 0x68acbf9c, 0x6878764f, 0x68444721, 0x68103204, 0x67dc36eb,
+  0x67a855c9, 0x67748e91, 0x6740e136, 0x670d4dab, 0x66d9d3e4, 0x66a673d3,
+  0x66732d6c, 0x664000a1, 0x660ced67, 0x65d9f3b0, 0x65a7136f, 0x65744c98,
+  0x65419f1e, 0x650f0af5, 0x64dc900f, 0x64aa2e60, 0x6477e5dc, 0x6445b676,
+  0x6413a022, 0x63e1a2d2
+};
+
+/*! exp(-i/65536) in UQ31 */
+AI_STATIC_CONST ai_u32 g_sm_exp_lo[128] = {
+  0x80000000, 0x7fff8000, 0x7fff0001, 0x7ffe8002, 0x7ffe0004, 0x7ffd8006,
+  0x7ffd0009, 0x7ffc800c, 0x7ffc0010, 0x7ffb8014, 0x7ffb0019, 0x7ffa801e,
+  0x7ffa0024, 0x7ff9802a, 0x7ff90031, 0x7ff88038, 0x7ff80040, 0x7ff78048,
+  0x7ff70051, 0x7ff6805a, 0x7ff60064, 0x7ff5806e, 0x7ff50079, 0x7ff48084,
+  0x7ff40090, 0x7ff3809c, 0x7ff300a9, 0x7ff280b6, 0x7ff200c4, 0x7ff180d2,
+  0x7ff100e1, 0x7ff080f0, 0x7ff00100, 0x7fef8110, 0x7fef0121, 0x7fee8132,
+  0x7fee0144, 0x7fed8156, 0x7fed0169, 0x7fec817c, 0x7fec0190, 0x7feb81a4,
+  0x7feb01b9, 0x7fea81ce, 0x7fea01e4, 0x7fe981fa, 0x7fe90211, 0x7fe88228,
+  0x7fe80240, 0x7fe78258, 0x7fe70271, 0x7fe6828a, 0x7fe602a4, 0x7fe582be,
+  0x7fe502d9, 0x7fe482f4, 0x7fe40310, 0x7fe3832c, 0x7fe30349, 0x7fe28366,
+  0x7fe20384, 0x7fe183a2, 0x7fe103c1, 0x7fe083e0, 0x7fe00400, 0x7fdf8420,
+  0x7fdf0441, 0x7fde8462, 0x7fde0484, 0x7fdd84a6, 0x7fdd04c9, 0x7fdc84ec,
+  0x7fdc0510, 0x7fdb8534, 0x7fdb0558, 0x7fda857e, 0x7fda05a3, 0x7fd985ca,
+  0x7fd905f0, 0x7fd88618, 0x7fd8063f, 0x7fd78668, 0x7fd70690, 0x7fd686ba,
+  0x7fd606e3, 0x7fd5870d, 0x7fd50738, 0x7fd48763, 0x7fd4078f, 0x7fd387bb,
+  0x7fd307e8, 0x7fd28815, 0x7fd20843, 0x7fd18871, 0x7fd108a0, 0x7fd088cf,
+  0x7fd008ff, 0x7fcf892f, 0x7fcf0960, 0x7fce8991, 0x7fce09c3, 0x7fcd89f5,
+  0x7fcd0a28, 0x7fcc8a5b, 0x7fcc0a8f, 0x7fcb8ac3, 0x7fcb0af7, 0x7fca8b2d,
+  0x7fca0b62, 0x7fc98b99, 0x7fc90bcf, 0x7fc88c07, 0x7fc80c3e, 0x7fc78c76,
+  0x7fc70caf, 0x7fc68ce8, 0x7fc60d22, 0x7fc58d5c, 0x7fc50d97, 0x7fc48dd2,
+  0x7fc40e0e, 0x7fc38e4a, 0x7fc30e87, 0x7fc28ec4, 0x7fc20f02, 0x7fc18f40,
+  0x7fc10f7e, 0x7fc08fbe
+};
+
+/*!
+ * @brief exp(-t / 2^16) in UQ31
+ */
+AI_DECLARE_STATIC
+ai_u32 sm_exp_uq31(const ai_u64 t)
+{
+  if ( t>=SM_EXP_T_MAX ) return 0;
+  const ai_u64 e = ((ai_u64)g_sm_exp_hi[t >> 14] *
+                    g_sm_exp_mid[(t >> 7) & 127] + (1u << 30)) >> 31;
+  return (ai_u32)((e * g_sm_exp_lo[t & 127] + (1u << 30)) >> 31);
+}
+
+/*!
+ * @brief s * e >> 31 for a sum s of UQ31 values, without overflow
+ */
+AI_DECLARE_STATIC
+ai_u64 sm_mul_uq31(const ai_u64 s, const ai_u32 e)
+{
+  return (s >> 31) * e + (((s & 0x7FFFFFFFu) * e + (1u << 30)) >> 31);
+}
+
+/*!
+ * @brief exp argument in units of 2^-16 of a difference of two inputs, in
+ * input LSBs: the shifts align the input fraction bits on 16
+ */
+#define SM_EXP_ARG(diff_, lshift_, rshift_) \
+  (((ai_u64)(diff_) << (lshift_)) >> (rshift_))
+
+/*!
+ * @brief per array constants of the fixed point channel kernels
+ */
+typedef struct {
+  ai_u32 lshift;    /*!< 16 - input fbits, when positive */
+  ai_u32 rshift;    /*!< input fbits - 16, when positive */
+  ai_u32 shift;     /*!< 62 - output fbits */
+  ai_u64 half;      /*!< rounding term of shift */
+  ai_u64 out_max;   /*!< saturation of the output format */
+} sm_fixed_params;
+
+typedef void (*func_sm_channel)(ai_ptr out, const ai_ptr in,
+                                const ai_size size,
+                                const sm_fixed_params* p);
+
+/*!
+ * @brief define the fixed point softmax of a single channel
+ * sm_channel_<name_> reading in_type_ values and writing out_type_ ones
+ * (the outputs are never negative)
+ */
+#define SM_CHANNEL_FIXED(name_, in_type_, out_type_) \
+AI_DECLARE_STATIC \
+void sm_channel_ ## name_(ai_ptr out, const ai_ptr in, const ai_size size, \
+                          const sm_fixed_params* p) \
+{ \
+  const in_type_* in_ptr = (const in_type_*)in; \
+  out_type_* out_ptr = (out_type_*)out; \
+  const ai_u32 lshift = p->lshift; \
+  const ai_u32 rshift = p->rshift; \
+  const ai_u32 shift = p->shift; \
+  const ai_u64 half = p->half; \
+  const ai_u64 out_max = p->out_max; \
+  /* pass 1: running maximum and sum of exp(x - max) in UQ31 */ \
+  ai_i32 max = in_ptr[0]; \
+  ai_u64 sum = SM_ONE_UQ31; \
+  for ( ai_size i=1; i<size; i++ ) { \
+    const ai_i32 x = in_ptr[i]; \
+    if ( x>max ) { \
+      sum = sm_mul_uq31(sum, sm_exp_uq31(SM_EXP_ARG(x - max, lshift, rshift))) + \
+            SM_ONE_UQ31; \
+      max = x; \
+    } else { \
+      sum += sm_exp_uq31(SM_EXP_ARG(max - x, lshift, rshift)); \
+    } \
+  } \
+  /* pass 2: exp(x - max) / sum. recip is 2^62 / sum <= 2^31, its product \
+   * with a UQ31 exp fits in 62 bits */ \
+  const ai_u64 recip = ((ai_u64)1 << 62) / sum; \
+  for ( ai_size i=0; i<size; i++ ) { \
+    const ai_u64 e = sm_exp_uq31(SM_EXP_ARG(max - in_ptr[i], lshift, rshift)); \
+    const ai_u64 y = (recip * e + half) >> shift; \
+    out_ptr[i] = (out_type_)AI_MIN(y, out_max); \
+  } \
+}
+
+SM_CHANNEL_FIXED(i8_u8, ai_i8, ai_u8)
+SM_CHANNEL_FIXED(u8_u8, ai_u8, ai_u8)
+SM_CHANNEL_FIXED(i16_u8, ai_i16, ai_u8)
+SM_CHANNEL_FIXED(u16_u8, ai_u16, ai_u8)
+SM_CHANNEL_FIXED(i8_u16, ai_i8, ai_u16)
+SM_CHANNEL_FIXED(u8_u16, ai_u8, ai_u16)
+SM_CHANNEL_FIXED(i16_u16, ai_i16, ai_u16)
+SM_CHANNEL_FIXED(u16_u16, ai_u16, ai_u16)
+
+/*! channel kernels indexed by [input 16 bits][input unsigned][output 16 bits] */
+AI_STATIC_CONST func_sm_channel g_sm_channel_funcs[2][2][2] = {
+  { { sm_channel_i8_u8, sm_channel_i8_u16 },
+    { sm_channel_u8_u8, sm_channel_u8_u16 } },
+  { { sm_channel_i16_u8, sm_channel_i16_u16 },
+    { sm_channel_u16_u8, sm_channel_u16_u16 } },
+};
+
+/******************************************************************************/
+AI_INTERNAL_API
+void sm_func_sm_array_fixed(ai_handle out, const ai_handle in,
+                            const ai_size in_size,
+                            const ai_size channel_size,
+                            const ai_size in_channel_step,
+                            const ai_size out_channel_step)
+{
+  const ai_array* in_array = (const ai_array*)in;
+  ai_array* out_array = (ai_array*)out;
+  const ai_array_format fmt_in = AI_ARRAY_OBJ_FMT(in_array);
+  const ai_array_format fmt_out = AI_ARRAY_OBJ_FMT(out_array);
+  const ai_i8 in_bits = AI_FMT_GET_BITS(fmt_in);
+  const ai_i8 out_bits = AI_FMT_GET_BITS(fmt_out);
+
+  if ( channel_size==0 ) return;
+  if ( (in_bits!=8 && in_bits!=16) || (out_bits!=8 && out_bits!=16) ||
+       AI_FMT_GET_TYPE(fmt_in)!=AI_FMT_Q ||
+       AI_FMT_GET_TYPE(fmt_out)!=AI_FMT_Q ) return;
+
+  const ai_i32 in_fbits = AI_FMT_GET_FBITS(fmt_in);
+  const ai_i32 out_fbits = AI_FMT_GET_FBITS(fmt_out);
+  sm_fixed_params p;
+  /* beyond 40 bits of left shift any non zero difference saturates t */
+  p.lshift = AI_CLAMP(SM_EXP_T_FBITS - in_fbits, 0, 40);
+  p.rshift = AI_CLAMP(in_fbits - SM_EXP_T_FBITS, 0, 63);
+  p.shift = AI_CLAMP(62 - out_fbits, 1, 63);
+  p.half = (ai_u64)1 << (p.shift - 1);
+  p.out_max = (AI_FMT_GET_SIGN(fmt_out))
+    ? (1u << (out_bits - 1)) - 1 : (1u << out_bits) - 1;
+
+  const func_sm_channel func = g_sm_channel_funcs[in_bits==16]
+    [AI_FMT_GET_SIGN(fmt_in)==0][out_bits==16];
+  const ai_size in_bytes = in_bits >> 3;
+  const ai_size out_bytes = out_bits >> 3;
+  ai_ptr in_ptr = in_array->data;
+  ai_ptr out_ptr = out_array->data;
+  for ( ai_size i=0; i<in_size; i+=channel_size ) {
+    func(out_ptr, in_ptr, channel_size, &p);
+    in_ptr += in_channel_step * in_bytes;
+    out_ptr += out_channel_step * out_bytes;
+  }
+}
+
+AI_INTERNAL_API
+void forward_sm_fixed(ai_layer *pLayer)
+{
+  const ai_layer_nl* l = (const ai_layer_nl*)pLayer;
+  ai_tensor* input = GET_TENSOR_IN(l->tensors, 0);
+  ai_tensor* output = GET_TENSOR_OUT(l->tensors, 0);
+  const ai_size channel_size = AI_SHAPE_CH(AI_TENSOR_SHAPE(input));
+
+  sm_func_sm_array_fixed(output->data, input->data,
+                         AI_ARRAY_OBJ_SIZE(input->data),
+                         channel_size, channel_size, channel_size);
+}
@@ -0,0 +1,478 @@
+/**
+  ******************************************************************************
+  * @file    aiProfiler.c
+  * @brief   Per c-node profiler built on the runtime observer API
+  ******************************************************************************
+  * @attention
+  *
+  * Counters backends:
+  *  - Linux: one perf_event group read with a single read() call (leader:
+  *    cycles), the TSC is used for the cycles if perf_event is not available
+  *  - Cortex-M7: DWT counters, the 8-bit event counters wrap: the values are
+  *    only exact for c-nodes shorter than 256 events of each kind
+  *
+  ******************************************************************************
+  */
+
+#if defined(__linux__)
+#define _GNU_SOURCE
+#endif
+
+/* System headers */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <inttypes.h>
+#include <string.h>
+
+#include "aiProfiler.h"
+#include "ai_platform_interface.h"
+#include "layers_common.h"
+
+#if defined(__linux__)
+#define PROF_USE_PERF_EVENT
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define PROF_HAS_TSC
+#endif
+#elif defined(__ARM_ARCH_7EM__)
+#define PROF_USE_DWT
+#include "bsp_ai.h"
+#endif
+
+#define PROF_CALIBRATION_ITER   (64)
+
+#define PROF_HAS(prof_, counter_) \
+    ((prof_)->available & (1U << (counter_)))
+
+static const char *prof_counter_names[AI_PROF_N_COUNTERS] = {
+    "cycles", "instructions", "cache_misses", "branch_misses"
+};
+
+/* -----------------------------------------------------------------------------
+ * Counters backends
+ * -----------------------------------------------------------------------------
+ */
+
+#if defined(PROF_USE_PERF_EVENT)
+
+static const uint64_t prof_perf_configs[AI_PROF_N_COUNTERS] = {
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES,
+    PERF_COUNT_HW_BRANCH_MISSES,
+};
+
+static int profPerfOpen(uint64_t config, int group_fd)
+{
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.read_format = PERF_FORMAT_GROUP;
+    attr.disabled = (group_fd == -1) ? 1 : 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(__NR_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+
+static void profBackendOpen(struct profiler_ctx *prof)
+{
+    for (int i = 0; i < AI_PROF_N_COUNTERS; i++)
+        prof->fds[i] = -1;
+
+    prof->fds[AI_PROF_CYCLES] = profPerfOpen(prof_perf_configs[AI_PROF_CYCLES], -1);
+    if (prof->fds[AI_PROF_CYCLES] < 0) {
+#if defined(PROF_HAS_TSC)
+        prof->available = 1U << AI_PROF_CYCLES;
+#endif
+        return;
+    }
+    prof->available = 1U << AI_PROF_CYCLES;
+    for (int i = AI_PROF_CYCLES + 1; i < AI_PROF_N_COUNTERS; i++) {
+        prof->fds[i] = profPerfOpen(prof_perf_configs[i], prof->fds[AI_PROF_CYCLES]);
+        if (prof->fds[i] >= 0)
+            prof->available |= 1U << i;
+    }
+    ioctl(prof->fds[AI_PROF_CYCLES], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(prof->fds[AI_PROF_CYCLES], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+static void profBackendClose(struct profiler_ctx *prof)
+{
+    for (int i = 0; i < AI_PROF_N_COUNTERS; i++) {
+        if (prof->fds[i] >= 0)
+            close(prof->fds[i]);
+        prof->fds[i] = -1;
+    }
+}
+
+static inline void profRead(struct profiler_ctx *prof, struct profiler_counters *c)
+{
+    /* group layout: nr, then the values in the order of the opened events */
+    uint64_t buf[1 + AI_PROF_N_COUNTERS];
+    int k = 1;
+
+    memset(c, 0, sizeof(*c));
+    if (prof->fds[AI_PROF_CYCLES] < 0) {
+#if defined(PROF_HAS_TSC)
+        c->v[AI_PROF_CYCLES] = __rdtsc();
+#endif
+        return;
+    }
+    if (read(prof->fds[AI_PROF_CYCLES], buf, sizeof(buf)) <= 0)
+        return;
+    for (int i = 0; i < AI_PROF_N_COUNTERS && k <= (int)buf[0]; i++)
+        if (PROF_HAS(prof, i))
+            c->v[i] = buf[k++];
+}
+
+static inline void profDelta(const struct profiler_counters *pre,
+        const struct profiler_counters *post, struct profiler_counters *d)
+{
+    for (int i = 0; i < AI_PROF_N_COUNTERS; i++)
+        d->v[i] = post->v[i] - pre->v[i];
+}
+
+static inline uint64_t profGetNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+#elif defined(PROF_USE_DWT)
+
+/* raw DWT snapshot: v[0] CYCCNT, v[1] CPI|EXC<<8|SLEEP<<16|LSU<<24, v[2] FOLD */
+#define PROF_DWT_EVT(v_, shift_)  (((v_) >> (shift_)) & 0xFFU)
+
+static uint32_t prof_dwt_last;
+static uint64_t prof_dwt_high;
+
+static void profBackendOpen(struct profiler_ctx *prof)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk | DWT_CTRL_CPIEVTENA_Msk |
+            DWT_CTRL_EXCEVTENA_Msk | DWT_CTRL_SLEEPEVTENA_Msk |
+            DWT_CTRL_LSUEVTENA_Msk | DWT_CTRL_FOLDEVTENA_Msk;
+    prof->available = (1U << AI_PROF_CYCLES) | (1U << AI_PROF_INSTRUCTIONS);
+}
+
+static void profBackendClose(struct profiler_ctx *prof)
+{
+    (void)prof;
+}
+
+static inline void profRead(struct profiler_ctx *prof, struct profiler_counters *c)
+{
+    (void)prof;
+    c->v[0] = DWT->CYCCNT;
+    c->v[1] = (DWT->CPICNT & 0xFFU) | ((DWT->EXCCNT & 0xFFU) << 8) |
+            ((DWT->SLEEPCNT & 0xFFU) << 16) | ((DWT->LSUCNT & 0xFFU) << 24);
+    c->v[2] = DWT->FOLDCNT & 0xFFU;
+    c->v[3] = 0;
+}
+
+static inline void profDelta(const struct profiler_counters *pre,
+        const struct profiler_counters *post, struct profiler_counters *d)
+{
+    const uint32_t cycles = (uint32_t)post->v[0] - (uint32_t)pre->v[0];
+    uint32_t stalls = 0;
+
+    for (int shift = 0; shift < 32; shift += 8)
+        stalls += (uint8_t)(PROF_DWT_EVT(post->v[1], shift) -
+                PROF_DWT_EVT(pre->v[1], shift));
+
+    /* instructions = cycles - CPI - EXC - SLEEP - LSU + FOLD */
+    d->v[AI_PROF_CYCLES] = cycles;
+    d->v[AI_PROF_INSTRUCTIONS] = cycles - stalls +
+            (uint8_t)(post->v[2] - pre->v[2]);
+    d->v[AI_PROF_CACHE_MISSES] = 0;
+    d->v[AI_PROF_BRANCH_MISSES] = 0;
+}
+
+static inline uint64_t profGetNs(void)
+{
+    /* 64-bit extension of CYCCNT, called at least once per wrap period */
+    const uint32_t now = DWT->CYCCNT;
+    if (now < prof_dwt_last)
+        prof_dwt_high += 1ULL << 32;
+    prof_dwt_last = now;
+    return ((prof_dwt_high | now) * 1000ULL) / (SystemCoreClock / 1000000U);
+}
+
+#else
+
+static void profBackendOpen(struct profiler_ctx *prof)
+{
+    prof->available = 0;
+}
+
+static void profBackendClose(struct profiler_ctx *prof)
+{
+    (void)prof;
+}
+
+static inline void profRead(struct profiler_ctx *prof, struct profiler_counters *c)
+{
+    (void)prof;
+    memset(c, 0, sizeof(*c));
+}
+
+static inline void profDelta(const struct profiler_counters *pre,
+        const struct profiler_counters *post, struct profiler_counters *d)
+{
+    for (int i = 0; i < AI_PROF_N_COUNTERS; i++)
+        d->v[i] = post->v[i] - pre->v[i];
+}
+
+static inline uint64_t profGetNs(void)
+{
+    return 0;
+}
+
+#endif
+
+/* -----------------------------------------------------------------------------
+ * Observer callback
+ * -----------------------------------------------------------------------------
+ */
+
+static inline int profHistBin(uint64_t cycles)
+{
+    const int bin = (cycles > 1) ? 63 - __builtin_clzll(cycles) : 0;
+    return (bin < AI_PROF_HIST_BINS) ? bin : AI_PROF_HIST_BINS - 1;
+}
+
+static ai_u32 profObserverCb(const ai_handle cookie, const ai_u32 flags,
+        const ai_observer_node *node)
+{
+    struct profiler_ctx *prof = (struct profiler_ctx *)cookie;
+    struct profiler_counters post, d;
+    struct profiler_node *sn;
+    uint64_t ns;
+
+    if (flags & AI_OBSERVER_PRE_EVT) {
+        prof->pre_ns = profGetNs();
+        profRead(prof, &prof->pre);
+        return 0;
+    }
+
+    if (!(flags & AI_OBSERVER_POST_EVT) || (node->c_idx >= prof->n_nodes))
+        return 0;
+
+    profRead(prof, &post);
+    ns = profGetNs() - prof->pre_ns;
+
+    profDelta(&prof->pre, &post, &d);
+    for (int i = 0; i < AI_PROF_N_COUNTERS; i++)
+        d.v[i] = (d.v[i] > prof->overhead.v[i]) ? d.v[i] - prof->overhead.v[i] : 0;
+
+    sn = &prof->nodes[node->c_idx];
+    sn->c_idx = node->c_idx;
+    sn->type = node->type;
+    sn->id = node->id;
+    sn->n_runs++;
+    sn->ns += ns;
+    for (int i = 0; i < AI_PROF_N_COUNTERS; i++)
+        sn->sum.v[i] += d.v[i];
+    if (d.v[AI_PROF_CYCLES] < sn->min_cycles)
+        sn->min_cycles = d.v[AI_PROF_CYCLES];
+    if (d.v[AI_PROF_CYCLES] > sn->max_cycles)
+        sn->max_cycles = d.v[AI_PROF_CYCLES];
+    sn->hist[profHistBin(d.v[AI_PROF_CYCLES])]++;
+
+    if (prof->n_events < prof->max_events) {
+        struct profiler_event *evt = &prof->events[prof->n_events++];
+        evt->c_idx = node->c_idx;
+        evt->ts = prof->pre_ns - prof->t0;
+        evt->dur = ns;
+        evt->counters = d;
+    } else if (prof->max_events) {
+        prof->n_dropped++;
+    }
+    return 0;
+}
+
+/* cost of a PRE/POST read pair without any work in between */
+static void profCalibrate(struct profiler_ctx *prof)
+{
+    struct profiler_counters pre, post, d;
+
+    for (int i = 0; i < AI_PROF_N_COUNTERS; i++)
+        prof->overhead.v[i] = UINT64_MAX;
+
+    for (int iter = 0; iter < PROF_CALIBRATION_ITER; iter++) {
+        profRead(prof, &pre);
+        profRead(prof, &post);
+        profDelta(&pre, &post, &d);
+        for (int i = 0; i < AI_PROF_N_COUNTERS; i++)
+            if (d.v[i] < prof->overhead.v[i])
+                prof->overhead.v[i] = d.v[i];
+    }
+}
+
+/* -----------------------------------------------------------------------------
+ * Exported/Public functions
+ * -----------------------------------------------------------------------------
+ */
+
+int aiProfilerInit(struct profiler_ctx *prof, ai_handle network, int n_nodes,
+        int max_events)
+{
+    if (!prof || (network == AI_HANDLE_NULL) || (n_nodes <= 0) || (max_events < 0))
+        return -1;
+
+    memset(prof, 0, sizeof(*prof));
+    prof->network = network;
+    prof->n_nodes = n_nodes;
+    prof->max_events = max_events;
+    prof->nodes = (struct profiler_node *)calloc(n_nodes, sizeof(struct profiler_node));
+    if (max_events)
+        prof->events = (struct profiler_event *)malloc(max_events * sizeof(struct profiler_event));
+    if (!prof->nodes || (max_events && !prof->events)) {
+        printf("W: unable to allocate the profiler buffers\r\n");
+        free(prof->nodes);
+        free(prof->events);
+        return -1;
+    }
+
+    profBackendOpen(prof);
+    profCalibrate(prof);
+    aiProfilerReset(prof);
+
+    if (!ai_platform_observer_register(network, profObserverCb,
+            (ai_handle)prof, AI_OBSERVER_PRE_EVT | AI_OBSERVER_POST_EVT)) {
+        printf("W: unable to register the profiler CB\r\n");
+        aiProfilerDeInit(prof);
+        return -1;
+    }
+    return 0;
+}
+
+void aiProfilerDeInit(struct profiler_ctx *prof)
+{
+    if (!prof || !prof->nodes)
+        return;
+
+    ai_platform_observer_unregister(prof->network, profObserverCb, (ai_handle)prof);
+    profBackendClose(prof);
+    free(prof->nodes);
+    free(prof->events);
+    memset(prof, 0, sizeof(*prof));
+}
+
+void aiProfilerReset(struct profiler_ctx *prof)
+{
+    if (!prof || !prof->nodes)
+        return;
+
+    memset(prof->nodes, 0, prof->n_nodes * sizeof(struct profiler_node));
+    for (int i = 0; i < prof->n_nodes; i++)
+        prof->nodes[i].min_cycles = UINT64_MAX;
+    prof->n_events = 0;
+    prof->n_dropped = 0;
+    prof->t0 = profGetNs();
+}
+
+void aiProfilerPrint(const struct profiler_ctx *prof, FILE *f)
+{
+    uint64_t total_ns = 0;
+
+    if (!prof || !prof->nodes)
+        return;
+
+    for (int i = 0; i < prof->n_nodes; i++)
+        total_ns += prof->nodes[i].ns;
+
+    fprintf(f, "\r\n Profile by c-node (average per execution)\r\n");
+    fprintf(f, " %-6s%-18s%-5s %10s %12s %12s %6s %10s %10s %7s\r\n",
+            "c_id", "type", "id", "ns", "cycles", "instr", "IPC",
+            "cache-miss", "br-miss", "time");
+    fprintf(f, " ---------------------------------------------------------"
+            "-----------------------------------------------\r\n");
+
+    for (int i = 0; i < prof->n_nodes; i++) {
+        const struct profiler_node *sn = &prof->nodes[i];
+        double avg[AI_PROF_N_COUNTERS];
+        if (!sn->n_runs)
+            continue;
+        for (int k = 0; k < AI_PROF_N_COUNTERS; k++)
+            avg[k] = (double)sn->sum.v[k] / (double)sn->n_runs;
+
+        fprintf(f, " %-6d%-18s%-5d %10.1f", sn->c_idx,
+                ai_layer_type_name(sn->type & (ai_u16)0x7FFF), (int)sn->id,
+                (double)sn->ns / (double)sn->n_runs);
+        for (int k = 0; k < AI_PROF_N_COUNTERS; k++) {
+            const int width = (k < AI_PROF_CACHE_MISSES) ? 12 : 10;
+            if (PROF_HAS(prof, k))
+                fprintf(f, " %*.1f", width, avg[k]);
+            else
+                fprintf(f, " %*s", width, "n/a");
+            if (k == AI_PROF_INSTRUCTIONS) {
+                if (PROF_HAS(prof, AI_PROF_INSTRUCTIONS) && (avg[AI_PROF_CYCLES] > 0.0))
+                    fprintf(f, " %6.2f", avg[AI_PROF_INSTRUCTIONS] / avg[AI_PROF_CYCLES]);
+                else
+                    fprintf(f, " %6s", "n/a");
+            }
+        }
+        fprintf(f, " %6.2f%%\r\n",
+                total_ns ? (100.0 * (double)sn->ns / (double)total_ns) : 0.0);
+
+        /* cycles distribution: non empty log2 buckets */
+        if (PROF_HAS(prof, AI_PROF_CYCLES)) {
+            fprintf(f, "       cycles min %" PRIu64 " max %" PRIu64 " |",
+                    sn->min_cycles, sn->max_cycles);
+            for (int b = 0; b < AI_PROF_HIST_BINS; b++)
+                if (sn->hist[b])
+                    fprintf(f, " 2^%d:%u", b, (unsigned)sn->hist[b]);
+            fprintf(f, "\r\n");
+        }
+    }
+    if (prof->n_dropped)
+        fprintf(f, " (%u executions not recorded in the trace)\r\n",
+                (unsigned)prof->n_dropped);
+}
+
+int aiProfilerWriteTrace(const struct profiler_ctx *prof, const char *path)
+{
+    FILE *f;
+
+    if (!prof || !prof->nodes || !path)
+        return -1;
+
+    f = fopen(path, "w");
+    if (!f) {
+        printf("E: unable to open the trace file \"%s\"\r\n", path);
+        return -1;
+    }
+
+    fprintf(f, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n");
+    for (int i = 0; i < prof->n_events; i++) {
+        const struct profiler_event *evt = &prof->events[i];
+        const struct profiler_node *sn = &prof->nodes[evt->c_idx];
+        /* complete event, timestamps in us */
+        fprintf(f, "  {\"name\": \"%s_%d\", \"cat\": \"c-node\", \"ph\": \"X\", "
+                "\"pid\": 0, \"tid\": 0, \"ts\": %.3f, \"dur\": %.3f, "
+                "\"args\": {\"c_idx\": %d",
+                ai_layer_type_name(sn->type & (ai_u16)0x7FFF), (int)sn->id,
+                (double)evt->ts * 1e-3, (double)evt->dur * 1e-3, evt->c_idx);
+        for (int k = 0; k < AI_PROF_N_COUNTERS; k++)
+            if (PROF_HAS(prof, k))
+                fprintf(f, ", \"%s\": %" PRIu64, prof_counter_names[k],
+                        evt->counters.v[k]);
+        fprintf(f, "}}%s\n", (i + 1 < prof->n_events) ? "," : "");
+    }
+    fprintf(f, "]}\n");
+
+    fclose(f);
+    return 0;
+}
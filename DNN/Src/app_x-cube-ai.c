@@ -50,11 +50,21 @@
   ******************************************************************************
   */
 /* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
 #include <string.h>
 #include "app_x-cube-ai.h"
 #include "bsp_ai.h"
 #include "aiSystemPerformance.h"
 #include "ai_datatypes_defines.h"
+#if defined(AI_PLATFORM_IO_BIND)
+#include "ai_platform_interface.h"
+#endif
+#if defined(AI_MNETWORK_WITH_WEIGHTS_FILE)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 
 /* USER CODE BEGIN includes */
 /* USER CODE END includes */
@@ -99,16 +109,103 @@ static const ai_network_entry_t networks[AI_MNETWORK_NUMBER] = {
         .extActBufferStartAddr = AI_NETWORK_DATA_ACTIVATIONS_START_ADDR,
         .actBufferSize = AI_NETWORK_DATA_ACTIVATIONS_SIZE
     },
+#if defined(AI_MNETWORK_WITH_NETWORK_Q)
+    {
+        .name = (const char *)AI_NETWORK_Q_MODEL_NAME,
+        .config = AI_NETWORK_Q_DATA_CONFIG,
+        .ai_get_info = ai_network_q_get_info,
+        .ai_create = ai_network_q_create,
+        .ai_destroy = ai_network_q_destroy,
+        .ai_get_error = ai_network_q_get_error,
+        .ai_init = ai_network_q_init,
+        .ai_run = ai_network_q_run,
+        .ai_forward = ai_network_q_forward,
+        .ai_data_weights_get_default = ai_network_q_data_weights_get,
+        .params = { AI_NETWORK_Q_DATA_WEIGHTS(0),
+                AI_NETWORK_Q_DATA_ACTIVATIONS(0)},
+        .extActBufferStartAddr = AI_NETWORK_Q_DATA_ACTIVATIONS_START_ADDR,
+        .actBufferSize = AI_NETWORK_Q_DATA_ACTIVATIONS_SIZE
+    },
+#endif
+};
+
+#if defined(AI_MNETWORK_WITH_TFLITE)
+#include "core_tflite.h"
+
+/* models loaded by ai_mnetwork_load(), a slot without model is free */
+struct network_loaded {
+    ai_network_entry_t entry;
+    ai_buffer config;       /* the model, passed to ai_tflite_create() */
+    ai_handle model;
 };
 
+AI_STATIC struct network_loaded gloaded[AI_MNETWORK_LOADED_NUMBER] = {0};
+
+#define AI_MNETWORK_ENTRY_NUMBER  (AI_MNETWORK_NUMBER + AI_MNETWORK_LOADED_NUMBER)
+#else
+#define AI_MNETWORK_ENTRY_NUMBER  (AI_MNETWORK_NUMBER)
+#endif
+
+/* Instance states: a slot is reserved by ai_mnetwork_create (FREE->CREATED),
+ * published when initialized (READY) and handed to one thread at a time by
+ * ai_mnetwork_pool_acquire (READY->BUSY). ai_mnetwork_destroy takes an
+ * instance which is not acquired (CREATED/READY->DESTROYING) before
+ * releasing it. All the transitions are CAS on the state field, no lock is
+ * taken. */
+#define AI_MNETWORK_INST_FREE       (0x0U)
+#define AI_MNETWORK_INST_CREATED    (0x1U)
+#define AI_MNETWORK_INST_READY      (0x2U)
+#define AI_MNETWORK_INST_BUSY       (0x3U)
+#define AI_MNETWORK_INST_DESTROYING (0x4U)
+
+#define AI_MNETWORK_STATE_GET(inst_) \
+  __atomic_load_n(&(inst_)->state, __ATOMIC_ACQUIRE)
+
+#define AI_MNETWORK_STATE_SET(inst_, state_) \
+  __atomic_store_n(&(inst_)->state, (state_), __ATOMIC_RELEASE)
+
+#define AI_MNETWORK_STATE_CAS(inst_, from_, to_) \
+  __extension__ ({ ai_u32 _from = (from_); \
+    __atomic_compare_exchange_n(&(inst_)->state, &_from, (to_), false, \
+      __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE); })
+
 struct network_instance {
      const ai_network_entry_t *entry;
      ai_handle handle;
      ai_network_params params;
+     ai_u32 state;
+     /* buffers registered by ai_mnetwork_bind_io(), passed to each run by
+      * the closed runtime, bound again after a weights switch else */
+     ai_buffer inputs[AI_MNETWORK_IN_NUM];
+     ai_buffer outputs[AI_MNETWORK_OUT_NUM];
+     ai_bool bound;
+     /* published weights followed by the instance and their generation */
+     ai_bool weights_shared;
+     ai_u32 weights_gen;
+     /* set while the weights are read (initialization, run): an idle
+      * instance switches to the published weights before its next run */
+     ai_u32 weights_busy;
+};
+
+/* Instances of the networks (see AI_MNETWORK_INSTANCE_NUMBER) */
+AI_STATIC struct network_instance gnetworks[AI_MNETWORK_INSTANCE_NUMBER] = {0};
+
+/* Published weights blobs of a generated network: blob[gen & 1] is the
+ * current one (NULL: compiled-in weights), the other one is the previous
+ * one, kept until no running instance uses it. A blob mapped by
+ * ai_mnetwork_weights_load() (mapped != 0) is unmapped when replaced. The
+ * publications are serialized by the lock field (CAS 0->1). */
+struct network_weights {
+    const ai_u8 *blob[2];
+    ai_size mapped[2];
+    ai_u32 gen;
+    ai_u32 lock;
 };
 
-/* Number of instance is aligned on the number of network */
-AI_STATIC struct network_instance gnetworks[AI_MNETWORK_NUMBER] = {0};
+AI_STATIC struct network_weights gweights[AI_MNETWORK_NUMBER] = {0};
+
+/* first slot tried by the next ai_mnetwork_pool_acquire() call */
+AI_STATIC ai_u32 gnetworks_next = 0;
 
 AI_DECLARE_STATIC
 ai_bool ai_mnetwork_is_valid(const char* name,
@@ -120,13 +217,112 @@ ai_bool ai_mnetwork_is_valid(const char* name,
     return false;
 }
 
+/* generated networks first, then the loaded models (NULL: free slot) */
 AI_DECLARE_STATIC
-struct network_instance *ai_mnetwork_handle(struct network_instance *inst)
+const ai_network_entry_t *ai_mnetwork_entry(int idx)
+{
+    if (idx < AI_MNETWORK_NUMBER)
+        return &networks[idx];
+#if defined(AI_MNETWORK_WITH_TFLITE)
+    idx -= AI_MNETWORK_NUMBER;
+    if ((idx < AI_MNETWORK_LOADED_NUMBER) && gloaded[idx].model)
+        return &gloaded[idx].entry;
+#endif
+    return NULL;
+}
+
+/* published weights of a network, NULL for a loaded model */
+AI_DECLARE_STATIC
+struct network_weights *ai_mnetwork_weights(const ai_network_entry_t *entry)
 {
     for (int i=0; i<AI_MNETWORK_NUMBER; i++) {
-        if ((inst) && (&gnetworks[i] == inst))
-            return inst;
-        else if ((!inst) && (gnetworks[i].entry == NULL))
+        if (entry == &networks[i])
+            return &gweights[i];
+    }
+    return NULL;
+}
+
+/* the current weights, the generation is recorded before the blob is read
+ * and confirmed after: a publication can not replace the blob in use */
+AI_DECLARE_STATIC
+ai_handle ai_mnetwork_weights_get(struct network_instance *inn,
+        struct network_weights *wts)
+{
+    const ai_mnetwork_weights_header *header;
+    ai_u32 gen;
+
+    do {
+        gen = __atomic_load_n(&wts->gen, __ATOMIC_SEQ_CST);
+        __atomic_store_n(&inn->weights_gen, gen, __ATOMIC_SEQ_CST);
+    } while (gen != __atomic_load_n(&wts->gen, __ATOMIC_SEQ_CST));
+
+    header = (const ai_mnetwork_weights_header *)wts->blob[gen & 1];
+    if (!header)
+        return inn->entry->ai_data_weights_get_default();
+    return AI_HANDLE_PTR(wts->blob[gen & 1] + header->header_size);
+}
+
+/* mark the weights of an instance in use: set before the generation is
+ * read, a publication then waits for the instance to be synchronized */
+AI_DECLARE_STATIC
+void ai_mnetwork_weights_enter(struct network_instance *inn)
+{
+    __atomic_store_n(&inn->weights_busy, 1, __ATOMIC_SEQ_CST);
+}
+
+AI_DECLARE_STATIC
+void ai_mnetwork_weights_leave(struct network_instance *inn)
+{
+    __atomic_store_n(&inn->weights_busy, 0, __ATOMIC_SEQ_CST);
+}
+
+/* switch an instance to the last published weights, between two runs (the
+ * weights of the instance marked in use) */
+AI_DECLARE_STATIC
+ai_bool ai_mnetwork_weights_sync(struct network_instance *inn)
+{
+    struct network_weights *wts;
+    ai_network_params par;
+
+    if (!__atomic_load_n(&inn->weights_shared, __ATOMIC_RELAXED))
+        return true;
+    wts = ai_mnetwork_weights(inn->entry);
+    if (__atomic_load_n(&wts->gen, __ATOMIC_ACQUIRE) == inn->weights_gen)
+        return true;
+
+    par = inn->params;
+    par.params.data = ai_mnetwork_weights_get(inn, wts);
+    if (!inn->entry->ai_init(inn->handle, &par))
+        return false;
+    inn->params = par;
+#if defined(AI_PLATFORM_IO_BIND)
+    /* the initialization drops the binding */
+    if (inn->bound)
+        return (ai_platform_network_bind_io(inn->handle,
+                inn->inputs, inn->outputs) > 0);
+#endif
+    return true;
+}
+
+AI_DECLARE_STATIC
+struct network_instance *ai_mnetwork_handle(struct network_instance *inst)
+{
+    const uintptr_t offset = (uintptr_t)inst - (uintptr_t)&gnetworks[0];
+
+    if ((!inst) || (offset >= sizeof(gnetworks)) ||
+            (offset % sizeof(gnetworks[0])))
+        return NULL;
+    if (AI_MNETWORK_STATE_GET(inst) == AI_MNETWORK_INST_FREE)
+        return NULL;
+    return inst;
+}
+
+AI_DECLARE_STATIC
+struct network_instance *ai_mnetwork_reserve_handle(void)
+{
+    for (int i=0; i<AI_MNETWORK_INSTANCE_NUMBER; i++) {
+        if (AI_MNETWORK_STATE_CAS(&gnetworks[i],
+                AI_MNETWORK_INST_FREE, AI_MNETWORK_INST_CREATED))
             return &gnetworks[i];
     }
     return NULL;
@@ -135,11 +331,10 @@ struct network_instance *ai_mnetwork_handle(struct network_instance *inst)
 AI_DECLARE_STATIC
 void ai_mnetwork_release_handle(struct network_instance *inst)
 {
-    for (int i=0; i<AI_MNETWORK_NUMBER; i++) {
-        if ((inst) && (&gnetworks[i] == inst)) {
-            gnetworks[i].entry = NULL;
-            return;
-        }
+    if (inst) {
+        inst->entry = NULL;
+        inst->handle = AI_HANDLE_NULL;
+        AI_MNETWORK_STATE_SET(inst, AI_MNETWORK_INST_FREE);
     }
 }
 
@@ -148,8 +343,10 @@ const char* ai_mnetwork_find(const char *name, ai_int idx)
 {
     const ai_network_entry_t *entry;
 
-    for (int i=0; i<AI_MNETWORK_NUMBER; i++) {
-        entry = &networks[i];
+    for (int i=0; i<AI_MNETWORK_ENTRY_NUMBER; i++) {
+        entry = ai_mnetwork_entry(i);
+        if (!entry)
+            continue;
         if (ai_mnetwork_is_valid(name, entry))
             return entry->name;
         else {
@@ -167,17 +364,11 @@ ai_error ai_mnetwork_create(const char *name, ai_handle* network,
     const ai_network_entry_t *entry;
     const ai_network_entry_t *found = NULL;
     ai_error err;
-    struct network_instance *inst = ai_mnetwork_handle(NULL);
+    struct network_instance *inst;
 
-    if (!inst) {
-        err.type = AI_ERROR_ALLOCATION_FAILED;
-        err.code = AI_ERROR_CODE_NETWORK;
-        return err;
-    }
-
-    for (int i=0; i<AI_MNETWORK_NUMBER; i++) {
-        entry = &networks[i];
-        if (ai_mnetwork_is_valid(name, entry)) {
+    for (int i=0; i<AI_MNETWORK_ENTRY_NUMBER; i++) {
+        entry = ai_mnetwork_entry(i);
+        if (entry && ai_mnetwork_is_valid(name, entry)) {
             found = entry;
             break;
         }
@@ -189,6 +380,13 @@ ai_error ai_mnetwork_create(const char *name, ai_handle* network,
         return err;
     }
 
+    inst = ai_mnetwork_reserve_handle();
+    if (!inst) {
+        err.type = AI_ERROR_ALLOCATION_FAILED;
+        err.code = AI_ERROR_CODE_NETWORK;
+        return err;
+    }
+
     if (network_config == NULL)
         err = found->ai_create(network, found->config);
     else
@@ -198,6 +396,8 @@ ai_error ai_mnetwork_create(const char *name, ai_handle* network,
         inst->handle = *network;
         *network = (ai_handle*)inst;
     }
+    else
+        ai_mnetwork_release_handle(inst);
 
     return err;
 }
@@ -206,14 +406,25 @@ AI_API_ENTRY
 ai_handle ai_mnetwork_destroy(ai_handle network)
 {
     struct network_instance *inn;
+    ai_u32 state = AI_MNETWORK_INST_READY;
     inn =  ai_mnetwork_handle((struct network_instance *)network);
-    if (inn) {
-        ai_handle hdl = inn->entry->ai_destroy(inn->handle);
-        if (hdl != inn->handle) {
-            ai_mnetwork_release_handle(inn);
-            network = AI_HANDLE_NULL;
-        }
+    if (!inn)
+        return network;
+    /* an instance acquired from the pool can not be destroyed: the instance
+     * is taken from the READY (or CREATED) state, a concurrent
+     * ai_mnetwork_pool_acquire() can not hand it out anymore */
+    if (!AI_MNETWORK_STATE_CAS(inn, state, AI_MNETWORK_INST_DESTROYING)) {
+        state = AI_MNETWORK_INST_CREATED;
+        if (!AI_MNETWORK_STATE_CAS(inn, state, AI_MNETWORK_INST_DESTROYING))
+            return network;
+    }
+    ai_handle hdl = inn->entry->ai_destroy(inn->handle);
+    if (hdl != inn->handle) {
+        ai_mnetwork_release_handle(inn);
+        network = AI_HANDLE_NULL;
     }
+    else
+        AI_MNETWORK_STATE_SET(inn, state);
     return network;
 }
 
@@ -247,12 +458,18 @@ AI_API_ENTRY
 ai_bool ai_mnetwork_init(ai_handle network, const ai_network_params* params)
 {
     struct network_instance *inn;
+    struct network_weights *wts;
     ai_network_params par;
 
     /* TODO: adding check ai_buffer activations/weights shape coherence */
 
     inn =  ai_mnetwork_handle((struct network_instance *)network);
     if (inn) {
+        /* without user weights a generated network follows the
+         * published ones */
+        wts = params->params.n_batches ? NULL : ai_mnetwork_weights(inn->entry);
+        __atomic_store_n(&inn->weights_shared, (wts != NULL), __ATOMIC_SEQ_CST);
+        ai_mnetwork_weights_enter(inn);
         par = inn->entry->params;
         if (params->activations.n_batches)
             par.activations = params->activations;
@@ -260,9 +477,23 @@ ai_bool ai_mnetwork_init(ai_handle network, const ai_network_params* params)
             par.activations.data = params->activations.data;
         if (params->params.n_batches)
             par.params = params->params;
+        else if (wts)
+            par.params.data = ai_mnetwork_weights_get(inn, wts);
         else
             par.params.data = inn->entry->ai_data_weights_get_default();
-        return inn->entry->ai_init(inn->handle, &par);
+#if defined(AI_PLATFORM_IO_BIND)
+        inn->bound = false;
+#endif
+        if (!inn->entry->ai_init(inn->handle, &par)) {
+            ai_mnetwork_weights_leave(inn);
+            return false;
+        }
+        ai_mnetwork_weights_leave(inn);
+        inn->params = par;
+        /* published: the instance can be handed out by the pool */
+        AI_MNETWORK_STATE_CAS(inn, AI_MNETWORK_INST_CREATED,
+                AI_MNETWORK_INST_READY);
+        return true;
     }
     else
         return false;
@@ -273,24 +504,355 @@ ai_i32 ai_mnetwork_run(ai_handle network, const ai_buffer* input,
         ai_buffer* output)
 {
     struct network_instance* inn;
+    ai_i32 n_batches;
     inn =  ai_mnetwork_handle((struct network_instance *)network);
-    if (inn)
-        return inn->entry->ai_run(inn->handle, input, output);
-    else
+    if (!inn)
+        return 0;
+    ai_mnetwork_weights_enter(inn);
+    if (!ai_mnetwork_weights_sync(inn)) {
+        ai_mnetwork_weights_leave(inn);
         return 0;
+    }
+#if defined(AI_PLATFORM_IO_BIND)
+    inn->bound = false;
+#endif
+    n_batches = inn->entry->ai_run(inn->handle, input, output);
+    ai_mnetwork_weights_leave(inn);
+    return n_batches;
 }
 
 AI_API_ENTRY
 ai_i32 ai_mnetwork_forward(ai_handle network, const ai_buffer* input)
+{
+    struct network_instance *inn;
+    ai_i32 n_batches;
+    inn =  ai_mnetwork_handle((struct network_instance *)network);
+    if (!inn)
+        return 0;
+    ai_mnetwork_weights_enter(inn);
+    if (!ai_mnetwork_weights_sync(inn)) {
+        ai_mnetwork_weights_leave(inn);
+        return 0;
+    }
+#if defined(AI_PLATFORM_IO_BIND)
+    inn->bound = false;
+#endif
+    n_batches = inn->entry->ai_forward(inn->handle, input);
+    ai_mnetwork_weights_leave(inn);
+    return n_batches;
+}
+
+AI_API_ENTRY
+ai_i32 ai_mnetwork_bind_io(ai_handle network, const ai_buffer* input,
+        ai_buffer* output)
+{
+    struct network_instance* inn;
+    inn =  ai_mnetwork_handle((struct network_instance *)network);
+    if (!inn)
+        return 0;
+    inn->bound = false;
+#if defined(AI_PLATFORM_IO_BIND)
+    const ai_i32 n_batches = ai_platform_network_bind_io(inn->handle,
+            input, output);
+    if (n_batches <= 0)
+        return n_batches;
+    /* kept to bind them again after a weights switch */
+    memcpy(inn->inputs, input, sizeof(inn->inputs));
+    memcpy(inn->outputs, output, sizeof(inn->outputs));
+    inn->bound = true;
+    return n_batches;
+#else
+    /* closed runtime: the buffers are only kept to be passed to each run */
+    if (!input || !output)
+        return 0;
+    memcpy(inn->inputs, input, sizeof(inn->inputs));
+    memcpy(inn->outputs, output, sizeof(inn->outputs));
+    inn->bound = true;
+    return (ai_i32)input[0].n_batches;
+#endif
+}
+
+AI_API_ENTRY
+ai_i32 ai_mnetwork_run_bound(ai_handle network)
+{
+    struct network_instance* inn;
+    ai_i32 n_batches = 0;
+    inn =  ai_mnetwork_handle((struct network_instance *)network);
+    if (!inn)
+        return 0;
+    ai_mnetwork_weights_enter(inn);
+    if (ai_mnetwork_weights_sync(inn)) {
+#if defined(AI_PLATFORM_IO_BIND)
+        n_batches = ai_platform_network_process_bound(inn->handle);
+#else
+        if (inn->bound)
+            n_batches = inn->entry->ai_run(inn->handle, inn->inputs,
+                    inn->outputs);
+#endif
+    }
+    ai_mnetwork_weights_leave(inn);
+    return n_batches;
+}
+
+AI_API_ENTRY
+ai_handle ai_mnetwork_pool_acquire(const char *name)
+{
+    const ai_u32 first = __atomic_fetch_add(&gnetworks_next, 1,
+            __ATOMIC_RELAXED);
+
+    for (int i=0; i<AI_MNETWORK_INSTANCE_NUMBER; i++) {
+        struct network_instance *inst =
+                &gnetworks[(first + i) % AI_MNETWORK_INSTANCE_NUMBER];
+        if (AI_MNETWORK_STATE_GET(inst) != AI_MNETWORK_INST_READY)
+            continue;
+        if (name && !ai_mnetwork_is_valid(name, inst->entry))
+            continue;
+        if (!AI_MNETWORK_STATE_CAS(inst, AI_MNETWORK_INST_READY,
+                AI_MNETWORK_INST_BUSY))
+            continue;
+        /* an idle instance switches to the last published weights */
+        ai_mnetwork_weights_enter(inst);
+        if (ai_mnetwork_weights_sync(inst)) {
+            ai_mnetwork_weights_leave(inst);
+            return (ai_handle)inst;
+        }
+        ai_mnetwork_weights_leave(inst);
+        AI_MNETWORK_STATE_SET(inst, AI_MNETWORK_INST_READY);
+    }
+    return AI_HANDLE_NULL;
+}
+
+AI_API_ENTRY
+ai_bool ai_mnetwork_pool_release(ai_handle network)
 {
     struct network_instance *inn;
     inn =  ai_mnetwork_handle((struct network_instance *)network);
     if (inn)
-        return inn->entry->ai_forward(inn->handle, input);
+        return AI_MNETWORK_STATE_CAS(inn, AI_MNETWORK_INST_BUSY,
+                AI_MNETWORK_INST_READY);
     else
-        return 0;
+        return false;
+}
+
+AI_DECLARE_STATIC
+ai_u32 ai_mnetwork_weights_checksum(const ai_u8 *data, ai_u32 size)
+{
+    /* FNV-1a */
+    ai_u32 hash = 0x811C9DC5U;
+    while (size--) {
+        hash ^= *data++;
+        hash *= 0x01000193U;
+    }
+    return hash;
+}
+
+/* publish a blob, mapped: size of the mapping owned by the table (0: none) */
+AI_DECLARE_STATIC
+ai_bool ai_mnetwork_weights_set(ai_handle network, const ai_u8 *blob,
+        ai_size mapped)
+{
+    const ai_mnetwork_weights_header *header =
+            (const ai_mnetwork_weights_header *)blob;
+    struct network_instance *inn;
+    struct network_weights *wts;
+    ai_network_report report;
+    ai_u32 gen, next;
+
+    inn =  ai_mnetwork_handle((struct network_instance *)network);
+    if (!inn || !blob || ((uintptr_t)blob & 0x3))
+        return false;
+    wts = ai_mnetwork_weights(inn->entry);
+    if (!wts || !inn->entry->ai_get_info(inn->handle, &report))
+        return false;
+
+    if ((header->magic != AI_MNETWORK_WEIGHTS_MAGIC) ||
+            (header->version != AI_MNETWORK_WEIGHTS_VERSION) ||
+            (header->header_size < sizeof(*header)) ||
+            (header->header_size % AI_MNETWORK_WEIGHTS_ALIGN) ||
+            (header->size != AI_BUFFER_SIZE(&inn->entry->params.params)))
+        return false;
+    if (!report.model_signature ||
+            strncmp(header->signature, report.model_signature,
+                    AI_MNETWORK_SIGNATURE_SIZE))
+        return false;
+    if (header->checksum != ai_mnetwork_weights_checksum(
+            blob + header->header_size, header->size))
+        return false;
+
+    /* one publication at a time */
+    for (;;) {
+        ai_u32 unlocked = 0;
+        if (__atomic_compare_exchange_n(&wts->lock, &unlocked, 1, false,
+                __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+            break;
+    }
+
+    /* the previous blob is replaced: no running instance may still use it,
+     * the idle ones switch to the current blob before their next run */
+    gen = __atomic_load_n(&wts->gen, __ATOMIC_SEQ_CST);
+    for (int i=0; i<AI_MNETWORK_INSTANCE_NUMBER; i++) {
+        struct network_instance *inst = &gnetworks[i];
+        if ((AI_MNETWORK_STATE_GET(inst) != AI_MNETWORK_INST_FREE) &&
+                (inst->entry == inn->entry) &&
+                __atomic_load_n(&inst->weights_shared, __ATOMIC_SEQ_CST) &&
+                __atomic_load_n(&inst->weights_busy, __ATOMIC_SEQ_CST) &&
+                (__atomic_load_n(&inst->weights_gen, __ATOMIC_SEQ_CST) != gen)) {
+            __atomic_store_n(&wts->lock, 0, __ATOMIC_RELEASE);
+            return false;
+        }
+    }
+
+    next = (gen + 1) & 1;
+#if defined(AI_MNETWORK_WITH_WEIGHTS_FILE)
+    if (wts->mapped[next])
+        munmap((void *)wts->blob[next], wts->mapped[next]);
+#endif
+    wts->blob[next] = blob;
+    wts->mapped[next] = mapped;
+    __atomic_store_n(&wts->gen, gen + 1, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&wts->lock, 0, __ATOMIC_RELEASE);
+    return true;
+}
+
+AI_API_ENTRY
+ai_bool ai_mnetwork_weights_header_init(ai_mnetwork_weights_header* header,
+        const char *signature, const ai_handle weights, ai_u32 size)
+{
+    if (!header || !signature ||
+            (strlen(signature) >= AI_MNETWORK_SIGNATURE_SIZE))
+        return false;
+    memset(header, 0, sizeof(*header));
+    header->magic = AI_MNETWORK_WEIGHTS_MAGIC;
+    header->version = AI_MNETWORK_WEIGHTS_VERSION;
+    header->header_size = AI_MNETWORK_WEIGHTS_ALIGN;
+    strcpy(header->signature, signature);
+    header->size = size;
+    header->checksum = ai_mnetwork_weights_checksum((const ai_u8 *)weights,
+            size);
+    return true;
 }
 
+AI_API_ENTRY
+ai_bool ai_mnetwork_weights_publish(ai_handle network, const ai_handle blob)
+{
+    return ai_mnetwork_weights_set(network, (const ai_u8 *)blob, 0);
+}
+
+#if defined(AI_MNETWORK_WITH_WEIGHTS_FILE)
+AI_API_ENTRY
+ai_bool ai_mnetwork_weights_load(ai_handle network, const char *path)
+{
+    const ai_mnetwork_weights_header *header;
+    struct stat st;
+    void *blob;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+    if (fstat(fd, &st) || (st.st_size < (off_t)sizeof(*header))) {
+        close(fd);
+        return false;
+    }
+    /* read-only shared pages: the blob is not copied */
+    blob = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (blob == MAP_FAILED)
+        return false;
+
+    header = (const ai_mnetwork_weights_header *)blob;
+    if ((((ai_u64)header->header_size + header->size) > (ai_u64)st.st_size) ||
+            !ai_mnetwork_weights_set(network, blob, (ai_size)st.st_size)) {
+        munmap(blob, (size_t)st.st_size);
+        return false;
+    }
+    return true;
+}
+#endif
+
+#if defined(AI_MNETWORK_WITH_TFLITE)
+AI_DECLARE_STATIC
+ai_handle ai_mnetwork_loaded_weights(void)
+{
+    /* the weights of a loaded model are the ones of its file */
+    return AI_HANDLE_NULL;
+}
+
+AI_API_ENTRY
+ai_error ai_mnetwork_load(const char *path, ai_handle* network)
+{
+    struct network_loaded *slot = NULL;
+    ai_handle model;
+    ai_error err;
+
+    for (int i=0; i<AI_MNETWORK_LOADED_NUMBER; i++) {
+        if (!gloaded[i].model) {
+            slot = &gloaded[i];
+            break;
+        }
+    }
+    if (!slot) {
+        err.type = AI_ERROR_ALLOCATION_FAILED;
+        err.code = AI_ERROR_CODE_NETWORK;
+        return err;
+    }
+
+    err = core_tflite_load(&model, path, AI_MNETWORK_LOADED_N_BATCHES);
+    if (err.type != AI_ERROR_NONE)
+        return err;
+
+    /* the name identifies the model: no duplicate */
+    if (ai_mnetwork_find(core_tflite_get_name(model), -1)) {
+        core_tflite_close(model);
+        err.type = AI_ERROR_INVALID_PARAM;
+        err.code = AI_ERROR_CODE_IN_USE;
+        return err;
+    }
+
+    memset(slot, 0, sizeof(*slot));
+    slot->entry.name = core_tflite_get_name(model);
+    slot->entry.config = &slot->config;
+    slot->entry.ai_get_info = ai_tflite_get_info;
+    slot->entry.ai_create = ai_tflite_create;
+    slot->entry.ai_destroy = ai_tflite_destroy;
+    slot->entry.ai_get_error = ai_tflite_get_error;
+    slot->entry.ai_init = ai_tflite_init;
+    slot->entry.ai_run = ai_tflite_run;
+    slot->entry.ai_forward = ai_tflite_forward;
+    slot->entry.ai_data_weights_get_default = ai_mnetwork_loaded_weights;
+    core_tflite_get_params(model, &slot->entry.params);
+    slot->entry.extActBufferStartAddr = AI_NETWORK_DATA_ACTIVATIONS_START_ADDR;
+    slot->entry.actBufferSize = AI_BUFFER_SIZE(&slot->entry.params.activations);
+    slot->config.data = model;
+    slot->model = model;
+
+    err = ai_mnetwork_create(slot->entry.name, network, NULL);
+    if (err.type != AI_ERROR_NONE)
+        ai_mnetwork_unload(slot->entry.name);
+    return err;
+}
+
+AI_API_ENTRY
+ai_bool ai_mnetwork_unload(const char *name)
+{
+    for (int i=0; i<AI_MNETWORK_LOADED_NUMBER; i++) {
+        struct network_loaded *slot = &gloaded[i];
+        if (!slot->model || !ai_mnetwork_is_valid(name, &slot->entry))
+            continue;
+        /* the instances refer to the model */
+        for (int j=0; j<AI_MNETWORK_INSTANCE_NUMBER; j++) {
+            if ((AI_MNETWORK_STATE_GET(&gnetworks[j]) != AI_MNETWORK_INST_FREE) &&
+                    (gnetworks[j].entry == &slot->entry))
+                return false;
+        }
+        core_tflite_close(slot->model);
+        memset(slot, 0, sizeof(*slot));
+        return true;
+    }
+    return false;
+}
+#endif
+
 AI_API_ENTRY
  int ai_mnetwork_get_private_handle(ai_handle network,
          ai_handle *phandle,
@@ -20,6 +20,7 @@
 
 
 #include "network.h"
+#include "network_data.h"
 
 #include "ai_platform_interface.h"
 #include "ai_math_helpers.h"
@@ -58,9 +59,6 @@
 #undef AI_TOOLS_COMPILE_TIME
 #define AI_TOOLS_COMPILE_TIME    __DATE__ " " __TIME__
 
-#undef AI_NETWORK_N_BATCHES
-#define AI_NETWORK_N_BATCHES         (1)
-
 /**  Forward network declaration section  *************************************/
 AI_STATIC ai_network AI_NET_OBJ_INSTANCE;
 
@@ -225,7 +223,7 @@ AI_NETWORK_OBJ_DECLARE(
                      1, 1, 64, 1,
                      NULL),
   AI_BUFFER_OBJ_INIT(AI_BUFFER_FORMAT_U8,
-                     1, 1, 20, 1,
+                     1, 1, AI_NETWORK_DATA_ACTIVATIONS_BATCH_SIZE, AI_NETWORK_N_BATCHES,
                      NULL),
   AI_TENSOR_LIST_IO_OBJ_INIT(AI_FLAG_NONE, AI_NETWORK_IN_NUM, &input_0_output),
   AI_TENSOR_LIST_IO_OBJ_INIT(AI_FLAG_NONE, AI_NETWORK_OUT_NUM, &dense_1_output),
@@ -245,12 +243,12 @@ ai_bool network_configure_activations(
 
   {
     /* Updating activations (byte) offsets */
-    input_0_output_array.data = AI_PTR(NULL);
-    input_0_output_array.data_start = AI_PTR(NULL);
-    dense_output_array.data = AI_PTR(activations + 0);
-    dense_output_array.data_start = AI_PTR(activations + 0);
-    dense_1_output_array.data = AI_PTR(NULL);
-    dense_1_output_array.data_start = AI_PTR(NULL);
+    AI_NETWORK_ARRAY(net_ctx, input_0_output_array)->data = AI_PTR(NULL);
+    AI_NETWORK_ARRAY(net_ctx, input_0_output_array)->data_start = AI_PTR(NULL);
+    AI_NETWORK_ARRAY(net_ctx, dense_output_array)->data = AI_PTR(activations + 0*AI_NETWORK_N_BATCHES);
+    AI_NETWORK_ARRAY(net_ctx, dense_output_array)->data_start = AI_PTR(activations + 0*AI_NETWORK_N_BATCHES);
+    AI_NETWORK_ARRAY(net_ctx, dense_1_output_array)->data = AI_PTR(NULL);
+    AI_NETWORK_ARRAY(net_ctx, dense_1_output_array)->data_start = AI_PTR(NULL);
     
   }
   return true;
@@ -271,18 +269,18 @@ ai_bool network_configure_weights(
   {
     /* Updating weights (byte) offsets */
     
-    dense_1_bias_array.format |= AI_FMT_FLAG_CONST;
-    dense_1_bias_array.data = AI_PTR(weights + 60);
-    dense_1_bias_array.data_start = AI_PTR(weights + 60);
-    dense_1_weights_array.format |= AI_FMT_FLAG_CONST;
-    dense_1_weights_array.data = AI_PTR(weights + 40);
-    dense_1_weights_array.data_start = AI_PTR(weights + 40);
-    dense_bias_array.format |= AI_FMT_FLAG_CONST;
-    dense_bias_array.data = AI_PTR(weights + 20);
-    dense_bias_array.data_start = AI_PTR(weights + 20);
-    dense_weights_array.format |= AI_FMT_FLAG_CONST;
-    dense_weights_array.data = AI_PTR(weights + 0);
-    dense_weights_array.data_start = AI_PTR(weights + 0);
+    AI_NETWORK_ARRAY(net_ctx, dense_1_bias_array)->format |= AI_FMT_FLAG_CONST;
+    AI_NETWORK_ARRAY(net_ctx, dense_1_bias_array)->data = AI_PTR(weights + 60);
+    AI_NETWORK_ARRAY(net_ctx, dense_1_bias_array)->data_start = AI_PTR(weights + 60);
+    AI_NETWORK_ARRAY(net_ctx, dense_1_weights_array)->format |= AI_FMT_FLAG_CONST;
+    AI_NETWORK_ARRAY(net_ctx, dense_1_weights_array)->data = AI_PTR(weights + 40);
+    AI_NETWORK_ARRAY(net_ctx, dense_1_weights_array)->data_start = AI_PTR(weights + 40);
+    AI_NETWORK_ARRAY(net_ctx, dense_bias_array)->format |= AI_FMT_FLAG_CONST;
+    AI_NETWORK_ARRAY(net_ctx, dense_bias_array)->data = AI_PTR(weights + 20);
+    AI_NETWORK_ARRAY(net_ctx, dense_bias_array)->data_start = AI_PTR(weights + 20);
+    AI_NETWORK_ARRAY(net_ctx, dense_weights_array)->format |= AI_FMT_FLAG_CONST;
+    AI_NETWORK_ARRAY(net_ctx, dense_weights_array)->data = AI_PTR(weights + 0);
+    AI_NETWORK_ARRAY(net_ctx, dense_weights_array)->data_start = AI_PTR(weights + 0);
   }
 
   return true;
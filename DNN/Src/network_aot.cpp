@@ -0,0 +1,61 @@
+/**
+  ******************************************************************************
+  * @file    network_aot.cpp
+  * @author  AST Embedded Analytics Research Platform
+  * @date    Fri Oct 16 16:47:32 2026
+  * @brief   AI ahead-of-time compiled network (model "network")
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2018 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software component is licensed by ST under Ultimate Liberty license
+  * SLA0044, the "License"; You may not use this file except in compliance with
+  * the License. You may obtain a copy of the License at:
+  *                             www.st.com/SLA0044
+  *
+  ******************************************************************************
+  */
+
+#include <cmath>
+
+#include "network_aot.h"
+
+namespace {
+
+/* one sample, 1 c-node(s), 1 MACC */
+inline void forward(float* out, const float* in)
+{
+  /* c-node 0: dense 1x1 (id 0), unrolled */
+  out[0] = 10.0100079f + 6.01397371f * in[0];
+}
+
+} /* namespace */
+
+AI_API_ENTRY
+ai_i32 ai_network_aot_run(
+  ai_handle network, const ai_buffer* input, ai_buffer* output)
+{
+  (void)network;
+  if (!input || !output || !input->data || !output->data)
+    return 0;
+  if ((AI_BUFFER_FMT_GET_TYPE(input->format) != AI_BUFFER_FMT_TYPE_FLOAT) ||
+      (AI_BUFFER_FMT_GET_TYPE(output->format) != AI_BUFFER_FMT_TYPE_FLOAT) ||
+      (AI_BUFFER_SIZE(input) != AI_NETWORK_AOT_IN_1_SIZE) ||
+      (AI_BUFFER_SIZE(output) != AI_NETWORK_AOT_OUT_1_SIZE))
+    return 0;
+
+  const ai_i32 n_batches = (input->n_batches > 0) ? input->n_batches : 1;
+  if ((output->n_batches > 0) ? (output->n_batches < n_batches) : (n_batches > 1))
+    return 0;
+
+  const float* in = static_cast<const float*>(input->data);
+  float* out = static_cast<float*>(output->data);
+  for (ai_i32 b = 0; b < n_batches; b++) {
+    forward(out, in);
+    in += AI_NETWORK_AOT_IN_1_SIZE;
+    out += AI_NETWORK_AOT_OUT_1_SIZE;
+  }
+  return n_batches;
+}
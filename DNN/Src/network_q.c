@@ -0,0 +1,354 @@
+/**
+  ******************************************************************************
+  * @file    network_q.c
+  * @author  AST Embedded Analytics Research Platform
+  * @date    Fri Oct 16 16:33:14 2026
+  * @brief   AI Tool Automatic Code Generator for Embedded NN computing
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2018 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software component is licensed by ST under Ultimate Liberty license
+  * SLA0044, the "License"; You may not use this file except in compliance with
+  * the License. You may obtain a copy of the License at:
+  *                             www.st.com/SLA0044
+  *
+  ******************************************************************************
+  */
+
+
+#include "network_q.h"
+#include "network_q_data.h"
+
+#include "ai_platform_interface.h"
+#include "ai_math_helpers.h"
+
+#include "core_common.h"
+#include "layers.h"
+
+#undef AI_TOOLS_VERSION_MAJOR
+#undef AI_TOOLS_VERSION_MINOR
+#undef AI_TOOLS_VERSION_MICRO
+#define AI_TOOLS_VERSION_MAJOR 5
+#define AI_TOOLS_VERSION_MINOR 1
+#define AI_TOOLS_VERSION_MICRO 1
+
+
+#undef AI_TOOLS_API_VERSION_MAJOR
+#undef AI_TOOLS_API_VERSION_MINOR
+#undef AI_TOOLS_API_VERSION_MICRO
+#define AI_TOOLS_API_VERSION_MAJOR 1
+#define AI_TOOLS_API_VERSION_MINOR 3
+#define AI_TOOLS_API_VERSION_MICRO 0
+
+#undef AI_NET_OBJ_INSTANCE
+#define AI_NET_OBJ_INSTANCE g_network_q
+ 
+#undef AI_NETWORK_Q_MODEL_SIGNATURE
+#define AI_NETWORK_Q_MODEL_SIGNATURE     "5ef79deea9e120e0877bd85b1dc378c9"
+
+#ifndef AI_TOOLS_REVISION_ID
+#define AI_TOOLS_REVISION_ID     "(rev-5.1.1)"
+#endif
+
+#undef AI_TOOLS_DATE_TIME
+#define AI_TOOLS_DATE_TIME   "Fri Oct 16 16:33:14 2026"
+
+#undef AI_TOOLS_COMPILE_TIME
+#define AI_TOOLS_COMPILE_TIME    __DATE__ " " __TIME__
+
+/**  Forward network declaration section  *************************************/
+AI_STATIC ai_network AI_NET_OBJ_INSTANCE;
+
+
+/**  Forward network array declarations  **************************************/
+AI_STATIC ai_array dense_0_bias_array;   /* Array #0 */
+AI_STATIC ai_array dense_0_weights_array;   /* Array #1 */
+AI_STATIC ai_array input_0_output_array;   /* Array #2 */
+AI_STATIC ai_array dense_0_output_array;   /* Array #3 */
+
+
+/**  Forward network tensor declarations  *************************************/
+AI_STATIC ai_tensor dense_0_bias;   /* Tensor #0 */
+AI_STATIC ai_tensor dense_0_weights;   /* Tensor #1 */
+AI_STATIC ai_tensor input_0_output;   /* Tensor #2 */
+AI_STATIC ai_tensor dense_0_output;   /* Tensor #3 */
+
+
+/**  Forward network tensor chain declarations  *******************************/
+AI_STATIC_CONST ai_tensor_chain dense_0_chain;   /* Chain #0 */
+
+
+/**  Forward network layer declarations  **************************************/
+AI_STATIC ai_layer_dense dense_0_layer; /* Layer #0 */
+
+
+/**  Array declarations section  **********************************************/
+/* Array#0 */
+AI_ARRAY_OBJ_DECLARE(
+  dense_0_bias_array, AI_ARRAY_FORMAT_S32,
+  NULL, NULL, 1, AI_STATIC)
+
+/* Array#1 */
+AI_ARRAY_OBJ_DECLARE(
+  dense_0_weights_array, AI_ARRAY_FORMAT_S8,
+  NULL, NULL, 1, AI_STATIC)
+
+/* Array#2 */
+AI_ARRAY_OBJ_DECLARE(
+  input_0_output_array, AI_ARRAY_FORMAT_S8|AI_FMT_FLAG_IS_IO,
+  NULL, NULL, 1, AI_STATIC)
+
+/* Array#3 */
+AI_ARRAY_OBJ_DECLARE(
+  dense_0_output_array, AI_ARRAY_FORMAT_S8|AI_FMT_FLAG_IS_IO,
+  NULL, NULL, 1, AI_STATIC)
+
+/**  Integer quantization info section  ***************************************/
+AI_INTQ_INFO_LIST_OBJ_DECLARE(dense_0_weights_intq, AI_STATIC_CONST,
+  AI_BUFFER_META_FLAG_SCALE_FLOAT|AI_BUFFER_META_FLAG_ZEROPOINT_S8, 1,
+  AI_PACK_INTQ_INFO(
+    AI_PACK_INTQ_SCALE(0.0473541245f),
+    AI_PACK_INTQ_ZP(0)))
+
+AI_INTQ_INFO_LIST_OBJ_DECLARE(input_0_output_intq, AI_STATIC_CONST,
+  AI_BUFFER_META_FLAG_SCALE_FLOAT|AI_BUFFER_META_FLAG_ZEROPOINT_S8, 1,
+  AI_PACK_INTQ_INFO(
+    AI_PACK_INTQ_SCALE(0.0784313753f),
+    AI_PACK_INTQ_ZP(63)))
+
+AI_INTQ_INFO_LIST_OBJ_DECLARE(dense_0_output_intq, AI_STATIC_CONST,
+  AI_BUFFER_META_FLAG_SCALE_FLOAT|AI_BUFFER_META_FLAG_ZEROPOINT_S8, 1,
+  AI_PACK_INTQ_INFO(
+    AI_PACK_INTQ_SCALE(0.471684188f),
+    AI_PACK_INTQ_ZP(42)))
+
+/**  Tensor declarations section  *********************************************/
+/* Tensor #0 */
+AI_TENSOR_OBJ_DECLARE(
+  dense_0_bias, AI_STATIC,
+  0x0, 0x0,
+  AI_SHAPE_INIT(4, 1, 1, 1, 1), AI_STRIDE_INIT(4, 4, 4, 4, 4),
+  1, &dense_0_bias_array, NULL)
+
+/* Tensor #1 */
+AI_TENSOR_OBJ_DECLARE(
+  dense_0_weights, AI_STATIC,
+  0x0, 0x0,
+  AI_SHAPE_INIT(4, 1, 1, 1, 1), AI_STRIDE_INIT(4, 1, 1, 1, 1),
+  1, &dense_0_weights_array, &dense_0_weights_intq)
+
+/* Tensor #2 */
+AI_TENSOR_OBJ_DECLARE(
+  input_0_output, AI_STATIC,
+  0x0, 0x0,
+  AI_SHAPE_INIT(4, 1, 1, 1, 1), AI_STRIDE_INIT(4, 1, 1, 1, 1),
+  1, &input_0_output_array, &input_0_output_intq)
+
+/* Tensor #3 */
+AI_TENSOR_OBJ_DECLARE(
+  dense_0_output, AI_STATIC,
+  0x0, 0x0,
+  AI_SHAPE_INIT(4, 1, 1, 1, 1), AI_STRIDE_INIT(4, 1, 1, 1, 1),
+  1, &dense_0_output_array, &dense_0_output_intq)
+
+
+
+/**  Layer declarations section  **********************************************/
+
+
+AI_TENSOR_CHAIN_OBJ_DECLARE(
+  dense_0_chain, AI_STATIC_CONST, 4,
+  AI_TENSOR_LIST_OBJ_INIT(AI_FLAG_NONE, 1, &input_0_output),
+  AI_TENSOR_LIST_OBJ_INIT(AI_FLAG_NONE, 1, &dense_0_output),
+  AI_TENSOR_LIST_OBJ_INIT(AI_FLAG_NONE, 2, &dense_0_weights, &dense_0_bias),
+  AI_TENSOR_LIST_OBJ_EMPTY
+)
+
+AI_LAYER_OBJ_DECLARE(
+  dense_0_layer, 0,
+  DENSE_TYPE,
+  dense, forward_dense_integer_SSSA_ch,
+  &AI_NET_OBJ_INSTANCE, &dense_0_layer, AI_STATIC,
+  .tensors = &dense_0_chain, 
+)
+
+
+AI_NETWORK_OBJ_DECLARE(
+  AI_NET_OBJ_INSTANCE, AI_STATIC,
+  AI_BUFFER_OBJ_INIT(AI_BUFFER_FORMAT_U8,
+                     1, 1, 8, 1,
+                     NULL),
+  AI_BUFFER_OBJ_INIT(AI_BUFFER_FORMAT_U8,
+                     1, 1, AI_NETWORK_Q_DATA_ACTIVATIONS_BATCH_SIZE, AI_NETWORK_Q_N_BATCHES,
+                     NULL),
+  AI_TENSOR_LIST_IO_OBJ_INIT(AI_FLAG_NONE, AI_NETWORK_Q_IN_NUM, &input_0_output),
+  AI_TENSOR_LIST_IO_OBJ_INIT(AI_FLAG_NONE, AI_NETWORK_Q_OUT_NUM, &dense_0_output),
+  &dense_0_layer, 0, NULL)
+
+
+
+AI_DECLARE_STATIC
+ai_bool network_q_configure_activations(
+  ai_network* net_ctx, const ai_buffer* activation_buffer)
+{
+  AI_ASSERT(net_ctx &&  activation_buffer && activation_buffer->data)
+
+  ai_ptr activations = AI_PTR(AI_PTR_ALIGN(activation_buffer->data, 4));
+  AI_ASSERT(activations)
+  AI_UNUSED(net_ctx)
+  AI_UNUSED(activations)
+
+  {
+    /* Updating activations (byte) offsets */
+    AI_NETWORK_ARRAY(net_ctx, input_0_output_array)->data = AI_PTR(NULL);
+    AI_NETWORK_ARRAY(net_ctx, input_0_output_array)->data_start = AI_PTR(NULL);
+    AI_NETWORK_ARRAY(net_ctx, dense_0_output_array)->data = AI_PTR(NULL);
+    AI_NETWORK_ARRAY(net_ctx, dense_0_output_array)->data_start = AI_PTR(NULL);
+    
+  }
+  return true;
+}
+
+
+
+AI_DECLARE_STATIC
+ai_bool network_q_configure_weights(
+  ai_network* net_ctx, const ai_buffer* weights_buffer)
+{
+  AI_ASSERT(net_ctx &&  weights_buffer && weights_buffer->data)
+
+  ai_ptr weights = AI_PTR(weights_buffer->data);
+  AI_ASSERT(weights)
+  AI_UNUSED(net_ctx)
+
+  {
+    /* Updating weights (byte) offsets */
+    
+    AI_NETWORK_ARRAY(net_ctx, dense_0_bias_array)->format |= AI_FMT_FLAG_CONST;
+    AI_NETWORK_ARRAY(net_ctx, dense_0_bias_array)->data = AI_PTR(weights + 4);
+    AI_NETWORK_ARRAY(net_ctx, dense_0_bias_array)->data_start = AI_PTR(weights + 4);
+    AI_NETWORK_ARRAY(net_ctx, dense_0_weights_array)->format |= AI_FMT_FLAG_CONST;
+    AI_NETWORK_ARRAY(net_ctx, dense_0_weights_array)->data = AI_PTR(weights + 0);
+    AI_NETWORK_ARRAY(net_ctx, dense_0_weights_array)->data_start = AI_PTR(weights + 0);
+  }
+
+  return true;
+}
+
+
+/**  PUBLIC APIs SECTION  *****************************************************/
+
+AI_API_ENTRY
+ai_bool ai_network_q_get_info(
+  ai_handle network, ai_network_report* report)
+{
+  ai_network* net_ctx = AI_NETWORK_ACQUIRE_CTX(network);
+
+  if ( report && net_ctx )
+  {
+    ai_network_report r = {
+      .model_name        = AI_NETWORK_Q_MODEL_NAME,
+      .model_signature   = AI_NETWORK_Q_MODEL_SIGNATURE,
+      .model_datetime    = AI_TOOLS_DATE_TIME,
+      
+      .compile_datetime  = AI_TOOLS_COMPILE_TIME,
+      
+      .runtime_revision  = ai_platform_runtime_get_revision(),
+      .runtime_version   = ai_platform_runtime_get_version(),
+
+      .tool_revision     = AI_TOOLS_REVISION_ID,
+      .tool_version      = {AI_TOOLS_VERSION_MAJOR, AI_TOOLS_VERSION_MINOR,
+                            AI_TOOLS_VERSION_MICRO, 0x0},
+      .tool_api_version  = {AI_TOOLS_API_VERSION_MAJOR, AI_TOOLS_API_VERSION_MINOR,
+                            AI_TOOLS_API_VERSION_MICRO, 0x0},
+
+      .api_version            = ai_platform_api_get_version(),
+      .interface_api_version  = ai_platform_interface_api_get_version(),
+      
+      .n_macc            = 1,
+      .n_inputs          = 0,
+      .inputs            = NULL,
+      .n_outputs         = 0,
+      .outputs           = NULL,
+      .activations       = AI_STRUCT_INIT,
+      .params            = AI_STRUCT_INIT,
+      .n_nodes           = 0,
+      .signature         = 0x0,
+    };
+
+    if ( !ai_platform_api_get_network_report(network, &r) ) return false;
+
+    *report = r;
+    return true;
+  }
+
+  return false;
+}
+
+AI_API_ENTRY
+ai_error ai_network_q_get_error(ai_handle network)
+{
+  return ai_platform_network_get_error(network);
+}
+
+AI_API_ENTRY
+ai_error ai_network_q_create(
+  ai_handle* network, const ai_buffer* network_config)
+{
+  return ai_platform_network_create(
+    network, network_config, 
+    &AI_NET_OBJ_INSTANCE,
+    AI_TOOLS_API_VERSION_MAJOR, AI_TOOLS_API_VERSION_MINOR, AI_TOOLS_API_VERSION_MICRO);
+}
+
+AI_API_ENTRY
+ai_handle ai_network_q_destroy(ai_handle network)
+{
+  return ai_platform_network_destroy(network);
+}
+
+AI_API_ENTRY
+ai_bool ai_network_q_init(
+  ai_handle network, const ai_network_params* params)
+{
+  ai_network* net_ctx = ai_platform_network_init(network, params);
+  if ( !net_ctx ) return false;
+
+  ai_bool ok = true;
+  ok &= network_q_configure_weights(net_ctx, &params->params);
+  ok &= network_q_configure_activations(net_ctx, &params->activations);
+
+  ok &= ai_platform_network_post_init(network);
+
+  return ok;
+}
+
+
+AI_API_ENTRY
+ai_i32 ai_network_q_run(
+  ai_handle network, const ai_buffer* input, ai_buffer* output)
+{
+  return ai_platform_network_process(network, input, output);
+}
+
+AI_API_ENTRY
+ai_i32 ai_network_q_forward(ai_handle network, const ai_buffer* input)
+{
+  return ai_platform_network_process(network, input, NULL);
+}
+
+
+#undef AI_NETWORK_Q_MODEL_SIGNATURE
+#undef AI_NET_OBJ_INSTANCE
+#undef AI_TOOLS_VERSION_MAJOR
+#undef AI_TOOLS_VERSION_MINOR
+#undef AI_TOOLS_VERSION_MICRO
+#undef AI_TOOLS_API_VERSION_MAJOR
+#undef AI_TOOLS_API_VERSION_MINOR
+#undef AI_TOOLS_API_VERSION_MICRO
+#undef AI_TOOLS_DATE_TIME
+#undef AI_TOOLS_COMPILE_TIME
+
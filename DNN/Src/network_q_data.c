@@ -0,0 +1,14 @@
+#include "network_q_data.h"
+
+ai_handle ai_network_q_data_weights_get(void)
+{
+
+  AI_ALIGNED(4)
+  static const ai_u8 s_network_q_weights[ 8 ] = {
+    0x7f, 0x00, 0x00, 0x00, 0x87, 0x0a, 0x00, 0x00
+  };
+
+  return AI_HANDLE_PTR(s_network_q_weights);
+
+}
+